@@ -0,0 +1,58 @@
+/*
+ * RescueNet AI - DS18B20 probes over OneWire
+ *
+ * Binds TempSensor to the OneWire and DallasTemperature libraries, the
+ * same way on both boards. esp32_hal.h and nano_hal.h include it.
+ */
+
+#ifndef DS18B20_TEMP_H
+#define DS18B20_TEMP_H
+
+#include <rescuenet.h>
+
+#include <OneWire.h>
+#include <DallasTemperature.h>
+
+class Ds18b20Temp : public TempSensor {
+public:
+  explicit Ds18b20Temp(uint8_t pin) : oneWire(pin), sensors(&oneWire) {}
+
+  void begin() override {
+    sensors.begin();
+    // requestTemperatures() returns at once; TempProbes times the conversion
+    sensors.setWaitForConversion(false);
+  }
+
+  uint8_t search(TempProbeRom* roms, uint8_t max) override {
+    uint8_t n = 0;
+    oneWire.reset_search();
+    while (n < max && oneWire.search(roms[n].bytes)) {
+      // DS18B20s only, and only addresses that came through whole
+      if (roms[n].bytes[0] == 0x28 && OneWire::crc8(roms[n].bytes, 7) == roms[n].bytes[7]) n++;
+    }
+    return n;
+  }
+
+  bool setResolution(const TempProbeRom& rom, uint8_t bits) override {
+    return sensors.setResolution(rom.bytes, bits, true);
+  }
+
+  bool startConversion() override {
+    sensors.requestTemperatures();
+    return true;
+  }
+
+  bool readRaw(const TempProbeRom& rom, int16_t& sixteenths) override {
+    // 1/128 C, after the scratchpad CRC check
+    int32_t raw = sensors.getTemp(rom.bytes);
+    if (raw == DEVICE_DISCONNECTED_RAW) return false;
+    sixteenths = (int16_t)(raw / 8);
+    return true;
+  }
+
+private:
+  OneWire oneWire;
+  DallasTemperature sensors;
+};
+
+#endif
@@ -11,6 +11,7 @@
  * - SIM800L GSM Module (for SMS emergency alerts)
  * - OLED Display 128x64 (optional)
  * - GPS Module (optional)
+ * - microSD card module (optional, vitals history)
  * - Buzzer for emergency alerts
  * - LED indicators
  * - Antenna for SIM800L
@@ -19,16 +20,16 @@
 #include <WiFi.h>
 #include <WebSocketsClient.h>
 #include <ArduinoJson.h>
-#include <OneWire.h>
-#include <DallasTemperature.h>
 #include <Wire.h>
-#include <MPU6050.h>
-#include <MAX30105.h>
-#include <heartRate.h>
-#include <SSD1306Wire.h>
-#include <HTTPClient.h>
 #include <HardwareSerial.h>
+#include <LittleFS.h>
+#include <SD.h>
+#include <SPI.h>
 #include <time.h>
+#include <rescuenet.h>
+#include <async_tcp_port.h>
+#include "esp32_hal.h"
+#include "web_assets.h"
 
 // Pin Definitions
 #define TEMP_SENSOR_PIN 4
@@ -45,58 +46,177 @@
 #define SIM800L_RST_PIN 14
 #define SIM800L_PWR_PIN 15
 
+// microSD on the HSPI bus; the default VSPI pins clash with the LEDs
+// and the SIM800L
+#define SD_SCK_PIN 25
+#define SD_MISO_PIN 26
+#define SD_MOSI_PIN 27
+#define SD_CS_PIN 32
+
+// GPS on the second hardware UART; its driver ring holds a second of
+// NMEA at 9600 baud, so the 100 ms GPS task never loses a sentence
+#define GPS_RX_PIN 34
+#define GPS_TX_PIN 33
+#define GPS_BAUD 9600
+#define GPS_RX_BUFFER 1024
+#define GPS_RATE_MS 1000
+
 // WiFi Configuration
 const char* ssid = "YOUR_WIFI_SSID";
 const char* password = "YOUR_WIFI_PASSWORD";
 
 // SIM800L Configuration
 HardwareSerial sim800l(2);
-String emergencyContact = "+1234567890"; // Emergency contact number
+HardwareSerial gpsSerial(1);
+const char* emergencyContact = "+1234567890"; // Emergency contact number
 bool smsEnabled = true;
-bool sim800lReady = false;
 
 // Server Configuration
 const char* serverHost = "192.168.1.100"; // Change to your server IP
 const int serverPort = 8080;
 const char* apiEndpoint = "http://192.168.1.100:3000/api/health-data";
+const char* emergencyEndpoint = "http://192.168.1.100:3000/api/emergency";
+
+// Telemetry over MQTT instead of HTTP: set to 1 to publish batches and
+// alerts to the broker below, QoS 1 from an outbox on flash. The
+// dashboard's messages come back on <prefix>/command.
+#define TELEMETRY_MQTT 0
+const char* mqttHost = "192.168.1.100";
+const uint16_t mqttBrokerPort = 1883;
+#define MQTT_CLIENT_ID "rescuenet-1234567890"  // rescuenet-<userId>
+#define MQTT_TOPIC_PREFIX "rescuenet/1234567890"  // rescuenet/<userId>
+#define OUTBOX_PATH "/outbox.log"
+#define OUTBOX_BYTES (32UL * 4096)
+#define OUTBOX_SECTOR 4096
+#define MQTT_TASK_MS 10
+
+// Offline backlog: 64 sectors of 4 KB, over 5 hours of readings
+#define BACKLOG_PATH "/backlog.log"
+#define BACKLOG_BYTES (64UL * 4096)
+#define BACKLOG_SECTOR 4096
+
+// Vitals history on SD: 16 MB holds a sample every 5 s for two months
+#define HISTORY_PATH "/history.bin"
+#define HISTORY_BYTES (16UL * 1024 * 1024)
+#define HISTORY_BLOCK 4096
+#define HISTORY_TASK_MS MONITOR_VITALS_TASK_MS
+#define WEB_TASK_MS 10
+#define MEMORY_TASK_MS 60000
+#define WIFI_TASK_MS 500
+
+// Sensor trace for replaying on a PC (host/bench/replay_bench): 1 writes
+// it to TRACE_PATH on the SD card, 2 prints it on the console as lines
+// among the messages. Typing f, h or t on the console marks a fall, a
+// heart rate or a temperature emergency starting then.
+#define RECORD_TRACE 0
+#define TRACE_PATH "/trace.rnt"
+#define TRACE_TASK_MS 100
+#define TRACE_FLUSH_MS 5000
+
+// Sensing and the alarm on the application core, ahead of everything;
+// HTTP, SMS and the WebSocket on the protocol core next to the WiFi stack
+#define ACQUISITION_CORE 1
+#define ACQUISITION_PRIORITY 5
+#define NETWORK_CORE 0
+#define NETWORK_PRIORITY 2
+#define MONITOR_STACK_BYTES 8192
+
+// Sent on every WebSocket connect
+#define SUBSCRIBE_TEMPLATE "{\"type\":\"subscribe\",\"userId\":\"%u\"}"
 
 // User Configuration
-String userId = "1234567890"; // User's phone number
-
-// Sensor Objects
-OneWire oneWire(TEMP_SENSOR_PIN);
-DallasTemperature temperatureSensor(&oneWire);
-MPU6050 mpu;
-MAX30105 particleSensor;
-SSD1306Wire display(0x3c, SDA_PIN, SCL_PIN);
+const char* userId = "1234567890"; // User's phone number
+
+// Hardware back-ends for the shared monitor
+Max30105Ppg particleSensor;
+Mpu6050Imu mpu;
+Ds18b20Temp temperatureSensor(TEMP_SENSOR_PIN);
+WireOledBus oledBus(Wire);
+OledRenderer statusDisplay(oledBus);
+StreamPort sim800lPort(sim800l);
+Sim800l modem(sim800lPort, SIM800L_PWR_PIN, SIM800L_RST_PIN);
+StreamPort gpsPort(gpsSerial);
+#if RECORD_TRACE
+// The monitor and the GPS receiver read through the recording drivers
+TraceWriter traceWriter;
+TracingPpg tracedPpg(particleSensor, traceWriter);
+TracingImu tracedImu(mpu, traceWriter);
+TracingTemp tracedTemp(temperatureSensor, traceWriter);
+TracingSerial tracedGpsPort(gpsPort, traceWriter);
+File traceFile;
+#define PPG_DRIVER &tracedPpg
+#define IMU_DRIVER &tracedImu
+#define TEMP_DRIVER &tracedTemp
+#define GPS_PORT tracedGpsPort
+#else
+#define PPG_DRIVER &particleSensor
+#define IMU_DRIVER &mpu
+#define TEMP_DRIVER &temperatureSensor
+#define GPS_PORT gpsPort
+#endif
+GpsReceiver gps(GPS_PORT);
+Esp32Http httpPort;
+FsLogStorage backlogStorage(LittleFS, BACKLOG_PATH, BACKLOG_BYTES, BACKLOG_SECTOR);
+RecordLog backlog(&backlogStorage);
+SPIClass sdSpi(HSPI);
+FsLogStorage historyStorage(SD, HISTORY_PATH, HISTORY_BYTES, HISTORY_BLOCK);
+HistoryLog history(&historyStorage);
+HistoryCursor historyCursor;
+
+// Serves the dashboard, /history and /events on the local network. The
+// last hour of history is kept in RAM; older ranges come from the card.
+HistoryRing recentHistory;
+AsyncTcpPort webPort(80);
+HttpServer webServer(webPort, recentHistory);
+
+#if TELEMETRY_MQTT
+// Posts from the monitor become messages in the outbox; the client sends
+// them from the network loop and never waits on the broker
+FsLogStorage outboxStorage(LittleFS, OUTBOX_PATH, OUTBOX_BYTES, OUTBOX_SECTOR);
+RecordLog outbox(&outboxStorage);
+AsyncTcpClient mqttTcp;
+const MqttConfig mqttConfig = {mqttHost, mqttBrokerPort, MQTT_CLIENT_ID, MQTT_TOPIC_PREFIX, nullptr, nullptr};
+MqttClient mqtt(mqttTcp, outbox, mqttConfig);
+MqttPort mqttPort(mqtt);
+#define TELEMETRY_PORT &mqttPort
+#define TELEMETRY_URL "telemetry"
+#define ALERT_URL "alert"
+#else
+#define TELEMETRY_PORT &httpPort
+#define TELEMETRY_URL apiEndpoint
+#define ALERT_URL emergencyEndpoint
+#endif
 
 // WebSocket Client
 WebSocketsClient webSocket;
+WebSocketChannel dashboardChannel(webSocket);
+
+// Detection, alerting and reporting run in the portable monitor. Readings
+// go up in batches of binary records over HTTP only; the WebSocket carries
+// the dashboard's messages to the device. What cannot be sent waits in
+// the backlog on flash and is replayed in order once WiFi is back. The
+// monitor runs as two loops, one per core, so a slow POST or SMS never
+// holds up the sensor FIFOs. On battery the monitor slows down and light
+// sleeps while the wearer is calm, more so below 30 %.
+const MonitorHal monitorHal = {
+  PPG_DRIVER, IMU_DRIVER, TEMP_DRIVER, TELEMETRY_PORT,
+  &dashboardChannel, smsEnabled ? &modem : nullptr, &statusDisplay, esp32LocalTime, &backlog,
+  esp32BatteryLevel, esp32LowPower, &gps
+};
+const MonitorConfig monitorConfig = {
+  userId, TELEMETRY_URL, ALERT_URL, emergencyContact,
+  BUZZER_PIN, LED_STATUS_PIN, LED_EMERGENCY_PIN, BUTTON_EMERGENCY_PIN, 0, true, POWER_AUTO
+};
+HealthMonitor monitor(monitorHal, monitorConfig);
 
-// Global Variables
-float heartRate = 0;
-float temperature = 0;
-float bloodPressure = 0; // Simulated for now
-float accelX, accelY, accelZ;
-bool emergencyDetected = false;
 bool wifiConnected = false;
-unsigned long lastSensorRead = 0;
-unsigned long lastDataSend = 0;
-unsigned long lastDisplayUpdate = 0;
-unsigned long buttonPressTime = 0;
-bool buttonPressed = false;
-
-// Emergency thresholds
-const float HEART_RATE_MIN = 50.0;
-const float HEART_RATE_MAX = 120.0;
-const float TEMP_MIN = 35.0;
-const float TEMP_MAX = 38.5;
-const float FALL_THRESHOLD = 15.0;
+TaskHandle_t acquisitionHandle;
+TaskHandle_t networkHandle;
 
 void setup() {
   Serial.begin(115200);
   Serial.println("RescueNet AI - ESP32 Health Monitor Starting...");
-    // Initialize pins
+  // Initialize pins
   pinMode(BUZZER_PIN, OUTPUT);
   pinMode(LED_STATUS_PIN, OUTPUT);
   pinMode(LED_EMERGENCY_PIN, OUTPUT);
@@ -107,100 +227,206 @@ void setup() {
   // Initialize I2C
   Wire.begin(SDA_PIN, SCL_PIN);
   
-  // Initialize sensors
-  initializeSensors();
-  
   // Initialize display
   initializeDisplay();
   
-  // Initialize SIM800L
-  initializeSIM800L();
+  // Backlog file; the monitor mounts the log in begin()
+  if (!LittleFS.begin(true) || !backlogStorage.begin()) {
+    Serial.println("LittleFS unavailable; no offline backlog");
+  }
+#if TELEMETRY_MQTT
+  if (!outboxStorage.begin() || !outbox.begin()) {
+    Serial.println("No MQTT outbox; telemetry is not sent");
+  }
+  mqtt.onMessage(mqttMessage, nullptr);
+  mqtt.begin();
+#endif
+
+  // Vitals history; without a card the device runs as before
+  sdSpi.begin(SD_SCK_PIN, SD_MISO_PIN, SD_MOSI_PIN, SD_CS_PIN);
+  if (!SD.begin(SD_CS_PIN, sdSpi) || !historyStorage.begin() || !history.begin()) {
+    Serial.println("SD card unavailable; no vitals history");
+  }
+#if RECORD_TRACE
+  traceWriter.start("esp32");
+#if RECORD_TRACE == 1
+  traceFile = SD.open(TRACE_PATH, FILE_WRITE);
+  if (!traceFile) Serial.println("No trace file; nothing is recorded");
+#endif
+#endif
+
+  // GPS: NAV-PVT where the receiver has it, NMEA otherwise
+  gpsSerial.setRxBufferSize(GPS_RX_BUFFER);
+  gpsSerial.begin(GPS_BAUD, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
+  gps.begin(GPS_BAUD, GPS_RATE_MS, true);
+
+  // Initialize sensors
+  monitor.begin(MONITOR_PIPELINED);
+  
+  // Initialize SIM800L; the monitor's modem task runs the power-up sequence
+  sim800l.begin(9600, SERIAL_8N1, SIM800L_RX_PIN, SIM800L_TX_PIN);
+  if (smsEnabled) {
+    modem.begin();
+  }
   
   // Connect to WiFi
   connectToWiFi();
   
   // Initialize WebSocket connection
   initializeWebSocket();
+
+  webServer.setAssets(WEB_ASSETS, WEB_ASSET_COUNT);
+  webServer.attachArchive(&history, &historyCursor);
+  webPort.begin();
+  monitor.networkTasks().every(WEB_TASK_MS, webTask, nullptr, "web");
+  monitor.networkTasks().every(HISTORY_TASK_MS, historyTask, nullptr, "history", HISTORY_TASK_MS);
+  monitor.networkTasks().every(WIFI_TASK_MS, wifiTask, nullptr, "wifi");
+#if TELEMETRY_MQTT
+  monitor.networkTasks().every(MQTT_TASK_MS, mqttTask, nullptr, "mqtt");
+#endif
+  monitor.networkTasks().every(MEMORY_TASK_MS, memoryTask, nullptr, "memory", MEMORY_TASK_MS);
+#if RECORD_TRACE
+  monitor.networkTasks().every(TRACE_TASK_MS, traceTask, nullptr, "trace");
+#endif
+  monitor.tasks().every(MEMORY_TASK_MS, powerTask, nullptr, "power", MEMORY_TASK_MS);
   
   // Configure time
   configTime(0, 0, "pool.ntp.org", "time.nist.gov");
   
   Serial.println("System initialized successfully!");
-  displayMessage("System Ready", "Monitoring...");
+  monitor.displayMessage("System Ready", "Monitoring...");
   digitalWrite(LED_STATUS_PIN, HIGH);
+
+  xTaskCreatePinnedToCore(acquisitionTask, "acquisition", MONITOR_STACK_BYTES, nullptr, ACQUISITION_PRIORITY,
+                          &acquisitionHandle, ACQUISITION_CORE);
+  xTaskCreatePinnedToCore(networkTask, "network", MONITOR_STACK_BYTES, nullptr, NETWORK_PRIORITY,
+                          &networkHandle, NETWORK_CORE);
 }
 
+// Both loops run on tasks of their own; the Arduino loop task is not needed
 void loop() {
-  // Handle WebSocket
-  webSocket.loop();
-  
-  // Check emergency button
-  checkEmergencyButton();
-  
-  // Read sensors every 5 seconds
-  if (millis() - lastSensorRead > 5000) {
-    readSensors();
-    detectEmergency();
-    lastSensorRead = millis();
+  vTaskDelete(NULL);
+}
+
+void acquisitionTask(void*) {
+  for (;;) monitor.loop();
+}
+
+void networkTask(void*) {
+  for (;;) monitor.networkLoop();
+}
+
+// Readings go to the backlog while WiFi is down
+void wifiTask(void*) {
+  wifiConnected = WiFi.status() == WL_CONNECTED;
+  monitor.setNetworkConnected(wifiConnected);
+}
+
+// Appends the current readings once the clock is set, to RAM and the
+// card, and pushes them to the dashboards listening. On the network loop
+// with the web server, which reads both.
+void historyTask(void*) {
+  struct tm now;
+  if (!getLocalTime(&now, 0)) return;
+  const Vitals& vitals = monitor.vitals();
+  HistorySample sample;
+  sample.timestamp = telemetrySeconds(now);
+  sample.heartRate = vitals.heartRate;
+  sample.spO2 = vitals.spO2;
+  sample.temperature = vitals.temperature;
+  sample.bloodPressureSys = (uint8_t)vitals.bloodPressure;
+  sample.bloodPressureDia = 0;
+  sample.flags = TELEMETRY_FLAG_WALL_CLOCK | (monitor.inEmergency() ? TELEMETRY_FLAG_EMERGENCY : 0);
+  sample.batteryLevel = TELEMETRY_BATTERY_UNKNOWN;
+  recentHistory.append(sample);
+  webServer.publish(sample);
+  if (history.ready()) {
+    history.append(sample);
+    history.poll();
   }
-    // Send data every 30 seconds
-  if (millis() - lastDataSend > 30000) {
-    sendHealthData();
-    lastDataSend = millis();
+}
+
+void webTask(void*) {
+  webServer.poll();
+}
+
+#if TELEMETRY_MQTT
+void mqttTask(void*) {
+  mqtt.poll();
+}
+
+// Commands are the dashboard's WebSocket messages, sent to the broker
+void mqttMessage(const char*, const uint8_t* payload, size_t length, void*) {
+  handleWebSocketMessage(payload, length);
+}
+#endif
+
+#if RECORD_TRACE
+// Takes the trace out of the writer's ring, on the network loop so a slow
+// card never holds up the sensors. The alert is marked when the monitor
+// raises it, and the console keys mark what the wearer is doing.
+void traceTask(void*) {
+  static bool alerted = false;
+  if (!alerted && monitor.inEmergency()) {
+    alerted = true;
+    traceWriter.alert();
   }
-  
-  // Check SIM800L status
-  checkSIM800LStatus();
-  
-  // Update display every 2 seconds
-  if (millis() - lastDisplayUpdate > 2000) {
-    updateDisplay();
-    lastDisplayUpdate = millis();
+  while (Serial.available() > 0) {
+    switch (Serial.read()) {
+      case 'f': traceWriter.label(TRACE_LABEL_FALL); break;
+      case 'h': traceWriter.label(TRACE_LABEL_HEART_RATE); break;
+      case 't': traceWriter.label(TRACE_LABEL_TEMPERATURE); break;
+    }
   }
-  
-  // Handle emergency state
-  if (emergencyDetected) {
-    handleEmergency();
+#if RECORD_TRACE == 1
+  static unsigned long flushedAt = 0;
+  if (!traceFile) return;
+  traceWriter.drain(traceFile, false, SIZE_MAX);
+  if (millis() - flushedAt >= TRACE_FLUSH_MS) {
+    flushedAt = millis();
+    traceFile.flush();
   }
-  
-  delay(100);
+#else
+  traceWriter.drain(Serial, true, Serial.availableForWrite());
+#endif
+}
+#endif
+
+// Low-water marks: the heap should settle once every buffer is in place,
+// and the task stacks show what the message buffers cost. Then how the
+// handoff between the two loops is doing.
+void memoryTask(void*) {
+  Serial.print("Heap free min: ");
+  Serial.print(ESP.getMinFreeHeap());
+  Serial.print(" bytes, stack free min: acquisition ");
+  Serial.print(uxTaskGetStackHighWaterMark(acquisitionHandle));
+  Serial.print(", network ");
+  Serial.print(uxTaskGetStackHighWaterMark(networkHandle));
+  Serial.println(" bytes");
+
+  const PipelineStats& stats = monitor.handoff().stats();
+  Serial.printf("Handoff: jobs wait %u/%u us, alert %u/%u us, events wait %u/%u us (mean/max), "
+                "dropped %u readings %u alerts %u events\n",
+                stats.jobWait.meanUs(), stats.jobWait.maxUs, stats.alertWork.meanUs(), stats.alertWork.maxUs,
+                stats.eventWait.meanUs(), stats.eventWait.maxUs, stats.readingsDropped, stats.alertsDropped,
+                stats.eventsDropped);
 }
 
-void initializeSensors() {
-  Serial.println("Initializing sensors...");
-  
-  // Temperature sensor
-  temperatureSensor.begin();
-  
-  // MPU6050 accelerometer
-  if (mpu.begin()) {
-    Serial.println("MPU6050 initialized");
-    mpu.setAccelerometerRange(MPU6050_RANGE_8_G);
-    mpu.setGyroRange(MPU6050_RANGE_500_DEG);
-    mpu.setFilterBandwidth(MPU6050_BAND_21_HZ);
-  } else {
-    Serial.println("Failed to initialize MPU6050");
-  }
-  
-  // MAX30105 heart rate sensor
-  if (particleSensor.begin()) {
-    Serial.println("MAX30105 initialized");
-    particleSensor.setup();
-    particleSensor.setPulseAmplitudeRed(0x0A);
-    particleSensor.setPulseAmplitudeGreen(0);
-  } else {
-    Serial.println("Failed to initialize MAX30105");
-  }
+// Power policy, activity level and the average draw since boot. On the
+// acquisition loop, which keeps the ledger.
+void powerTask(void*) {
+  const PowerLedger& power = monitor.powerLedger();
+  const DutyCycle& duty = monitor.dutyCycle();
+  float hours = power.elapsedMs / 3600000.0f;
+  Serial.printf("Power: policy %u, %s, asleep %u%%, about %.1f mA\n", duty.policy(),
+                duty.level() == ACTIVITY_STABLE ? "stable" : "active",
+                power.elapsedMs ? (unsigned)(100ULL * power.sleepMs / power.elapsedMs) : 0,
+                hours > 0 ? chargeMah(power, ESP32_POWER_MODEL) / hours : 0.0f);
 }
 
 void initializeDisplay() {
-  display.init();
-  display.flipScreenVertically();
-  display.setFont(ArialMT_Plain_10);
-  display.clear();
-  display.drawString(0, 0, "RescueNet AI");
-  display.drawString(0, 16, "Initializing...");
-  display.display();
+  // Upside down, as the enclosure mounts it
+  if (!statusDisplay.begin(true)) Serial.println("Failed to initialize OLED");
 }
 
 void connectToWiFi() {
@@ -219,11 +445,12 @@ void connectToWiFi() {
     Serial.println();
     Serial.print("Connected! IP address: ");
     Serial.println(WiFi.localIP());
-    displayMessage("WiFi Connected", WiFi.localIP().toString());
+    monitor.displayMessage("WiFi Connected", WiFi.localIP().toString().c_str());
   } else {
     Serial.println("Failed to connect to WiFi");
-    displayMessage("WiFi Failed", "Check settings");
+    monitor.displayMessage("WiFi Failed", "Check settings");
   }
+  monitor.setNetworkConnected(wifiConnected);
 }
 
 void initializeWebSocket() {
@@ -241,16 +468,18 @@ void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
       Serial.println("WebSocket Disconnected");
       break;
       
-    case WStype_CONNECTED:
+    case WStype_CONNECTED: {
       Serial.printf("WebSocket Connected to: %s\n", payload);
       // Subscribe to user-specific messages
-      String subscribeMessage = "{\"type\":\"subscribe\",\"userId\":\"" + userId + "\"}";
-      webSocket.sendTXT(subscribeMessage);
+      TextBuffer<messageMax(SUBSCRIBE_TEMPLATE)> subscribeMessage;
+      formatMessage(subscribeMessage, PSTR(SUBSCRIBE_TEMPLATE), userId);
+      webSocket.sendTXT(subscribeMessage.c_str(), subscribeMessage.length());
       break;
+    }
       
     case WStype_TEXT:
       Serial.printf("Received: %s\n", payload);
-      handleWebSocketMessage((char*)payload);
+      handleWebSocketMessage(payload, length);
       break;
       
     default:
@@ -258,414 +487,12 @@ void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
   }
 }
 
-void handleWebSocketMessage(String message) {
-  DynamicJsonDocument doc(1024);
-  deserializeJson(doc, message);
-  
-  String type = doc["type"];
-  
-  if (type == "emergency_response") {
-    Serial.println("Emergency response received!");
-    displayMessage("Emergency", "Help is coming!");
-    // Flash LED to indicate response
-    for (int i = 0; i < 10; i++) {
-      digitalWrite(LED_EMERGENCY_PIN, HIGH);
-      delay(100);
-      digitalWrite(LED_EMERGENCY_PIN, LOW);
-      delay(100);
-    }
-  } else if (type == "health_alert") {
-    String alert = doc["data"]["message"];
-    displayMessage("Health Alert", alert);
-    tone(BUZZER_PIN, 1000, 500);
-  }
-}
-
-void readSensors() {
-  // Read temperature
-  temperatureSensor.requestTemperatures();
-  temperature = temperatureSensor.getTempCByIndex(0);
-  if (temperature == DEVICE_DISCONNECTED_C) {
-    temperature = 36.5 + random(-10, 10) / 10.0; // Fallback simulation
-  }
-  
-  // Read accelerometer
-  sensors_event_t a, g, temp;
-  mpu.getEvent(&a, &g, &temp);
-  accelX = a.acceleration.x;
-  accelY = a.acceleration.y;
-  accelZ = a.acceleration.z;
-  
-  // Read heart rate
-  long irValue = particleSensor.getIR();
-  if (checkForBeat(irValue)) {
-    static unsigned long lastBeat = 0;
-    long delta = millis() - lastBeat;
-    lastBeat = millis();
-    
-    static byte rateArray[4];
-    static byte rateSpot = 0;
-    
-    rateArray[rateSpot++] = (byte)(60000 / delta);
-    rateSpot %= 4;
-    
-    long total = 0;
-    for (byte i = 0; i < 4; i++) {
-      total += rateArray[i];
-    }
-    heartRate = total / 4;
-  }
-  
-  // Simulate blood pressure (would need actual BP sensor)
-  bloodPressure = 100 + random(-20, 40);
-  
-  Serial.printf("Vitals - HR: %.1f, Temp: %.1f°C, BP: %.1f, Accel: %.1f,%.1f,%.1f\n", 
-                heartRate, temperature, bloodPressure, accelX, accelY, accelZ);
-}
-
-void detectEmergency() {
-  bool emergency = false;
-  String reason = "";
-  
-  // Check vital signs
-  if (heartRate > HEART_RATE_MAX || heartRate < HEART_RATE_MIN) {
-    emergency = true;
-    reason = "Abnormal heart rate: " + String(heartRate) + " BPM";
-  }
-  
-  if (temperature > TEMP_MAX || temperature < TEMP_MIN) {
-    emergency = true;
-    if (reason.length() > 0) reason += "; ";
-    reason += "Abnormal temperature: " + String(temperature) + "°C";
-  }
-  
-  // Check for fall detection
-  float totalAccel = sqrt(accelX*accelX + accelY*accelY + accelZ*accelZ);
-  if (totalAccel > FALL_THRESHOLD) {
-    emergency = true;
-    if (reason.length() > 0) reason += "; ";
-    reason += "Fall detected";
-  }
-  
-  if (emergency && !emergencyDetected) {
-    emergencyDetected = true;
-    triggerEmergency(reason);
-  }
-}
-
-void checkEmergencyButton() {
-  bool currentState = digitalRead(BUTTON_EMERGENCY_PIN) == LOW;
-  
-  if (currentState && !buttonPressed) {
-    buttonPressTime = millis();
-    buttonPressed = true;
-  } else if (!currentState && buttonPressed) {
-    buttonPressed = false;
-    // Check if button was held for more than 2 seconds
-    if (millis() - buttonPressTime > 2000) {
-      triggerEmergency("Manual emergency button pressed");
-    }
-  }
-}
-
-void triggerEmergency(String reason) {
-  Serial.println("EMERGENCY TRIGGERED: " + reason);
-  
-  // Visual and audio alerts
-  digitalWrite(LED_EMERGENCY_PIN, HIGH);
-  tone(BUZZER_PIN, 2000, 1000);
-  
-  displayMessage("EMERGENCY!", reason);
-  
-  // Send emergency notification via WebSocket
-  sendEmergencyAlert(reason);
-  
-  // Send emergency SMS
-  sendEmergencySMS();
-  
-  emergencyDetected = true;
-}
-
-void handleEmergency() {
-  // Flash emergency LED
-  static unsigned long lastFlash = 0;
-  if (millis() - lastFlash > 500) {
-    digitalWrite(LED_EMERGENCY_PIN, !digitalRead(LED_EMERGENCY_PIN));
-    lastFlash = millis();
-  }
-  
-  // Periodic emergency beep
-  static unsigned long lastBeep = 0;
-  if (millis() - lastBeep > 5000) {
-    tone(BUZZER_PIN, 1500, 200);
-    lastBeep = millis();
-  }
-}
-
-void sendHealthData() {
-  if (!wifiConnected) return;
-  
-  // Create JSON payload
-  DynamicJsonDocument doc(1024);
-  doc["userId"] = userId;
-  doc["timestamp"] = getTimeString();
-  
-  JsonObject vitals = doc.createNestedObject("vitals");
-  vitals["heartRate"] = heartRate;
-  vitals["temperature"] = temperature;
-  vitals["bloodPressure"] = bloodPressure;
-  
-  JsonObject location = doc.createNestedObject("location");
-  location["lat"] = 21.1458; // Nagpur coordinates (would use GPS in production)
-  location["lng"] = 79.0882;
-  
-  JsonObject accelerometer = doc.createNestedObject("accelerometer");
-  accelerometer["x"] = accelX;
-  accelerometer["y"] = accelY;
-  accelerometer["z"] = accelZ;
-  
-  String jsonString;
-  serializeJson(doc, jsonString);
-  
-  // Send via HTTP
-  HTTPClient http;
-  http.begin(apiEndpoint);
-  http.addHeader("Content-Type", "application/json");
-  
-  int httpResponseCode = http.POST(jsonString);
-  
-  if (httpResponseCode > 0) {
-    String response = http.getString();
-    Serial.println("Data sent successfully: " + String(httpResponseCode));
-  } else {
-    Serial.println("Error sending data: " + String(httpResponseCode));
-  }
-  
-  http.end();
-  
-  // Also send via WebSocket if connected
-  if (webSocket.isConnected()) {
-    webSocket.sendTXT(jsonString);
-  }
-}
-
-void sendEmergencyAlert(String reason) {
-  if (!wifiConnected) return;
-  
-  DynamicJsonDocument doc(1024);
-  doc["userId"] = userId;
-  doc["reason"] = reason;
-  doc["timestamp"] = getTimeString();
-  
-  JsonObject location = doc.createNestedObject("location");
-  location["lat"] = 21.1458;
-  location["lng"] = 79.0882;
-  
-  JsonObject vitals = doc.createNestedObject("vitals");
-  vitals["heartRate"] = heartRate;
-  vitals["temperature"] = temperature;
-  vitals["bloodPressure"] = bloodPressure;
-  
-  String jsonString;
-  serializeJson(doc, jsonString);
-  
-  // Send emergency alert
-  HTTPClient http;
-  http.begin("http://192.168.1.100:3000/api/emergency");
-  http.addHeader("Content-Type", "application/json");
-  
-  int httpResponseCode = http.POST(jsonString);
-  
-  if (httpResponseCode > 0) {
-    Serial.println("Emergency alert sent: " + String(httpResponseCode));
-  } else {
-    Serial.println("Failed to send emergency alert: " + String(httpResponseCode));
-  }
-  
-  http.end();
-}
-
-// SIM800L Functions
-void initializeSIM800L() {
-  Serial.println("Initializing SIM800L GSM Module...");
-  
-  // Power cycle SIM800L
-  digitalWrite(SIM800L_PWR_PIN, LOW);
-  delay(1000);
-  digitalWrite(SIM800L_PWR_PIN, HIGH);
-  delay(2000);
-  
-  // Reset SIM800L
-  digitalWrite(SIM800L_RST_PIN, LOW);
-  delay(100);
-  digitalWrite(SIM800L_RST_PIN, HIGH);
-  delay(3000);
-  
-  // Initialize serial communication
-  sim800l.begin(9600, SERIAL_8N1, SIM800L_RX_PIN, SIM800L_TX_PIN);
-  delay(3000);
-  
-  // Check if SIM800L is responsive
-  sim800l.println("AT");
-  delay(1000);
-  
-  if (sim800l.available()) {
-    String response = sim800l.readString();
-    if (response.indexOf("OK") > -1) {
-      Serial.println("SIM800L: Connected successfully");
-      sim800lReady = true;
-      
-      // Configure SMS settings
-      configureSMS();
-    } else {
-      Serial.println("SIM800L: Failed to respond");
-      sim800lReady = false;
-    }
-  } else {
-    Serial.println("SIM800L: No response");
-    sim800lReady = false;
-  }
-}
+// Parsed in a fixed document on the stack; the strings point into it
+void handleWebSocketMessage(const uint8_t* payload, size_t length) {
+  StaticJsonDocument<512> doc;
+  if (deserializeJson(doc, payload, length)) return;
 
-void configureSMS() {
-  Serial.println("Configuring SMS settings...");
-  
-  // Set SMS text mode
-  sim800l.println("AT+CMGF=1");
-  delay(1000);
-  
-  // Set character set
-  sim800l.println("AT+CSCS=\"GSM\"");
-  delay(1000);
-  
-  // Check network registration
-  sim800l.println("AT+CREG?");
-  delay(1000);
-  
-  // Check signal strength
-  sim800l.println("AT+CSQ");
-  delay(1000);
-  
-  Serial.println("SMS configuration complete");
-}
-
-bool sendSMS(String phoneNumber, String message) {
-  if (!sim800lReady || !smsEnabled) {
-    Serial.println("SIM800L not ready or SMS disabled");
-    return false;
-  }
-  
-  Serial.println("Sending SMS to: " + phoneNumber);
-  Serial.println("Message: " + message);
-  
-  // Set SMS recipient
-  sim800l.println("AT+CMGS=\"" + phoneNumber + "\"");
-  delay(1000);
-  
-  // Send message
-  sim800l.print(message);
-  delay(100);
-  
-  // Send Ctrl+Z to send SMS
-  sim800l.println((char)26);
-  delay(5000);
-  
-  // Check response
-  if (sim800l.available()) {
-    String response = sim800l.readString();
-    Serial.println("SMS Response: " + response);
-    
-    if (response.indexOf("OK") > -1) {
-      Serial.println("SMS sent successfully");
-      return true;
-    }
-  }
-  
-  Serial.println("Failed to send SMS");
-  return false;
-}
-
-void sendEmergencySMS() {
-  if (!sim800lReady) {
-    Serial.println("Cannot send emergency SMS - SIM800L not ready");
-    return;
-  }
-  
-  String emergencyMessage = "🚨 EMERGENCY ALERT - RescueNet AI 🚨\n";
-  emergencyMessage += "User: " + userId + "\n";
-  emergencyMessage += "Time: " + getTimeString() + "\n";
-  emergencyMessage += "Heart Rate: " + String((int)heartRate) + " BPM\n";
-  emergencyMessage += "Temperature: " + String(temperature, 1) + "°C\n";
-  emergencyMessage += "SpO2: " + String((int)spO2) + "%\n";
-  emergencyMessage += "Location: GPS coordinates if available\n";
-  emergencyMessage += "Please respond immediately!";
-  
-  // Send to emergency contact
-  bool smsSent = sendSMS(emergencyContact, emergencyMessage);
-  
-  if (smsSent) {
-    Serial.println("Emergency SMS sent successfully");
-    displayMessage("Emergency SMS", "Sent to contact");
-  } else {
-    Serial.println("Failed to send emergency SMS");
-    displayMessage("SMS Failed", "Check SIM card");
-  }
-}
-
-void checkSIM800LStatus() {
-  if (!sim800lReady) return;
-  
-  // Check signal strength periodically
-  static unsigned long lastSignalCheck = 0;
-  if (millis() - lastSignalCheck > 60000) { // Check every minute
-    sim800l.println("AT+CSQ");
-    delay(1000);
-    
-    if (sim800l.available()) {
-      String response = sim800l.readString();
-      Serial.println("Signal strength: " + response);
-    }
-    
-    lastSignalCheck = millis();
-  }
-}
-
-void updateDisplay() {
-  display.clear();
-  
-  // Title
-  display.setFont(ArialMT_Plain_10);
-  display.drawString(0, 0, "RescueNet AI");
-  
-  // WiFi status
-  display.drawString(85, 0, wifiConnected ? "WiFi OK" : "No WiFi");
-  
-  // Vitals
-  display.setFont(ArialMT_Plain_16);
-  display.drawString(0, 16, "HR: " + String((int)heartRate));
-  display.drawString(0, 32, "Temp: " + String(temperature, 1) + "C");
-  display.drawString(0, 48, "Status: " + String(emergencyDetected ? "EMERGENCY" : "Normal"));
-  
-  display.display();
-}
-
-void displayMessage(String title, String message) {
-  display.clear();
-  display.setFont(ArialMT_Plain_16);
-  display.drawString(0, 0, title);
-  display.setFont(ArialMT_Plain_10);
-  display.drawString(0, 20, message);
-  display.display();
-}
-
-String getTimeString() {
-  time_t now;
-  struct tm timeinfo;
-  if (!getLocalTime(&timeinfo)) {
-    return String(millis());
-  }
-  
-  char timeString[64];
-  strftime(timeString, sizeof(timeString), "%Y-%m-%dT%H:%M:%S.000Z", &timeinfo);
-  return String(timeString);
+  const char* type = doc["type"] | "";
+  const char* text = doc["data"]["message"] | "";
+  monitor.handleServerMessage(type, text);
 }
@@ -0,0 +1,175 @@
+/*
+ * RescueNet AI - ESP32 HAL back-ends
+ *
+ * Binds the rescuenet HAL interfaces to the drivers used by
+ * esp32_enhanced.ino. Only that sketch includes this file.
+ */
+
+#ifndef ESP32_HAL_H
+#define ESP32_HAL_H
+
+#include <rescuenet.h>
+#include <stream_port.h>
+#include <max3010x_fifo.h>
+#include <mpu6050_fifo.h>
+#include <oled_wire.h>
+
+#include "ds18b20_temp.h"
+
+#include <Wire.h>
+#include <MAX30105.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <WebSocketsClient.h>
+#include <FS.h>
+#include <esp_pm.h>
+#include <time.h>
+
+// Battery through a 1:2 divider on an ADC1 pin; ADC2 is unusable with WiFi on
+#ifndef BATTERY_SENSE_PIN
+#define BATTERY_SENSE_PIN 35
+#endif
+
+class Max30105Ppg : public PpgSensor {
+public:
+  bool begin() override { return sensor.begin(); }
+
+  bool configure(uint16_t sampleRateHz, uint8_t averaging) override {
+    // Red + IR (SpO2 mode), 411 us pulses, 4096 nA full scale; enables FIFO rollover.
+    // Red now carries signal, so it keeps the same drive current as IR.
+    sensor.setup(0x1F, averaging, 2, sampleRateHz, 411, 4096);
+    sensor.setPulseAmplitudeGreen(0);
+    return true;
+  }
+
+  uint8_t readFifo(PpgSample* out, uint8_t maxSamples, uint8_t& overflowed) override {
+    return max3010xReadFifo(Wire, out, maxSamples, overflowed);
+  }
+
+private:
+  MAX30105 sensor;
+};
+
+class Mpu6050Imu : public ImuSensor {
+public:
+  bool begin() override { return mpu6050Begin(Wire); }
+  bool configure(uint16_t sampleRateHz) override { return mpu6050ConfigureFifo(Wire, sampleRateHz); }
+
+  uint8_t readFifo(ImuSample* out, uint8_t maxSamples, bool& overflowed) override {
+    return mpu6050ReadFifo(Wire, out, maxSamples, overflowed);
+  }
+};
+
+class Esp32Http : public HttpPort {
+public:
+  // One client for every request; with reuse on, end() leaves the TCP
+  // connection open and the next begin() to the same host takes it up
+  Esp32Http() { http.setReuse(true); }
+
+  int post(const char* url, const char* contentType, const char* body, size_t length) override {
+    http.begin(client, url);
+    http.addHeader("Content-Type", contentType);
+    int httpResponseCode = http.POST((uint8_t*)body, length);
+    if (httpResponseCode > 0) {
+      http.getString();  // Drain the response
+    }
+    http.end();
+    return httpResponseCode;
+  }
+
+private:
+  WiFiClient client;
+  HTTPClient http;
+};
+
+class WebSocketChannel : public MessageChannel {
+public:
+  explicit WebSocketChannel(WebSocketsClient& client) : client(client) {}
+
+  void loop() override { client.loop(); }
+  bool isConnected() override { return client.isConnected(); }
+  bool sendText(const char* text, size_t length) override { return client.sendTXT(text, length); }
+
+private:
+  WebSocketsClient& client;
+};
+
+// The store-and-forward log in a file of fixed size on LittleFS or SD. The
+// file is created erased (0xFF) once and then only written in place.
+class FsLogStorage : public LogStorage {
+public:
+  FsLogStorage(fs::FS& fs, const char* path, uint32_t size, uint32_t sectorSize)
+    : fs(fs), path(path), bytes(size), sector(sectorSize) {}
+
+  // Call after the file system is mounted
+  bool begin() {
+    if (!fs.exists(path) || fs.open(path, FILE_READ).size() != bytes) {
+      File blank = fs.open(path, FILE_WRITE);
+      if (!blank) return false;
+      uint8_t erased[512];
+      memset(erased, 0xFF, sizeof(erased));
+      for (uint32_t done = 0; done < bytes; done += sizeof(erased)) blank.write(erased, sizeof(erased));
+      blank.close();
+    }
+    file = fs.open(path, "r+");
+    return file;
+  }
+
+  uint32_t size() override { return bytes; }
+  uint32_t eraseSize() override { return sector; }
+
+  bool read(uint32_t offset, uint8_t* data, size_t length) override {
+    return file && file.seek(offset) && file.read(data, length) == length;
+  }
+
+  bool write(uint32_t offset, const uint8_t* data, size_t length) override {
+    if (!file || !file.seek(offset) || file.write(data, length) != length) return false;
+    file.flush();
+    return true;
+  }
+
+  bool erase(uint32_t offset) override {
+    uint8_t erased[512];
+    memset(erased, 0xFF, sizeof(erased));
+    if (!file || !file.seek(offset)) return false;
+    for (uint32_t done = 0; done < sector; done += sizeof(erased)) {
+      if (file.write(erased, sizeof(erased)) != sizeof(erased)) return false;
+    }
+    file.flush();
+    return true;
+  }
+
+private:
+  fs::FS& fs;
+  const char* path;
+  uint32_t bytes;
+  uint32_t sector;
+  File file;
+};
+
+// No wait for SNTP: the default 5 s timeout would stall the monitor's
+// loop on every reading until the clock is set
+inline bool esp32LocalTime(struct tm* out) {
+  return getLocalTime(out, 0);
+}
+
+// Below 2.5 V at the pin there is no cell, just USB power
+inline uint8_t esp32BatteryLevel() {
+  uint32_t millivolts = analogReadMilliVolts(BATTERY_SENSE_PIN) * 2;
+  return millivolts < 2500 ? TELEMETRY_BATTERY_UNKNOWN : batteryPercent((uint16_t)millivolts);
+}
+
+// Automatic light sleep whenever both cores idle. The FreeRTOS tick must
+// be tickless (CONFIG_FREERTOS_USE_TICKLESS_IDLE) and power management
+// enabled for esp_pm_configure() to take it; WiFi then stays associated
+// through DTIM modem sleep.
+inline void esp32LowPower(bool enabled) {
+  esp_pm_config_esp32_t pm = {};
+  pm.max_freq_mhz = 80;
+  pm.min_freq_mhz = enabled ? 10 : 80;
+  pm.light_sleep_enable = enabled;
+  esp_pm_configure(&pm);
+  WiFi.setSleep(true);
+}
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * RescueNet AI - Arduino Nano HAL back-ends
+ *
+ * Binds the rescuenet HAL interfaces to the drivers used by
+ * nano_enhanced.ino. Only that sketch includes this file.
+ */
+
+#ifndef NANO_HAL_H
+#define NANO_HAL_H
+
+#include <rescuenet.h>
+#include <stream_port.h>
+#include <max3010x_fifo.h>
+#include <mpu6050_fifo.h>
+#include <oled_wire.h>
+
+#include "ds18b20_temp.h"
+
+#include <Wire.h>
+
+// Registers directly, as SparkFun's MAX30105 object would take 55 bytes
+class Max30105Ppg : public PpgSensor {
+public:
+  bool begin() override { return max3010xBegin(Wire); }
+
+  bool configure(uint16_t sampleRateHz, uint8_t averaging) override {
+    return max3010xConfigure(Wire, sampleRateHz, averaging);
+  }
+
+  uint8_t readFifo(PpgSample* out, uint8_t maxSamples, uint8_t& overflowed) override {
+    return max3010xReadFifo(Wire, out, maxSamples, overflowed);
+  }
+};
+
+class Mpu6050Imu : public ImuSensor {
+public:
+  bool begin() override { return mpu6050Begin(Wire); }
+  bool configure(uint16_t sampleRateHz) override { return mpu6050ConfigureFifo(Wire, sampleRateHz); }
+
+  uint8_t readFifo(ImuSample* out, uint8_t maxSamples, bool& overflowed) override {
+    return mpu6050ReadFifo(Wire, out, maxSamples, overflowed);
+  }
+};
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ * RescueNet AI - Dashboard assets
+ *
+ * Generated by utils/embedAssets.js from codes/web; do not edit.
+ */
+
+#ifndef RESCUENET_WEB_ASSETS_H
+#define RESCUENET_WEB_ASSETS_H
+
+#include <http_server.h>
+
+// index.html: 5784 bytes, 2024 gzipped
+static const uint8_t ASSET_INDEX_HTML[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xa5, 0x58, 0x79, 0x6f, 0xdb, 0x38,
+  0x16, 0xff, 0xbf, 0x9f, 0xe2, 0x8d, 0x8b, 0x56, 0x72, 0x47, 0x92, 0x65, 0xb9, 0x4e, 0x53, 0xd9,
+  0x72, 0x76, 0x9a, 0xa6, 0xc7, 0xa2, 0x17, 0x9a, 0x74, 0x07, 0x83, 0x20, 0x58, 0xd0, 0xd2, 0xb3,
+  0xc4, 0x8d, 0x44, 0x0a, 0x24, 0x7d, 0x4d, 0xd0, 0xef, 0xbe, 0xa0, 0x0e, 0x5b, 0x56, 0xe4, 0x36,
+  0xc5, 0x38, 0x08, 0x6c, 0xf1, 0x9d, 0xfc, 0xf1, 0x5d, 0xd4, 0xf4, 0xb7, 0xd7, 0x9f, 0xcf, 0xaf,
+  0xfe, 0xfa, 0x72, 0x01, 0x89, 0xca, 0xd2, 0xd9, 0xa3, 0x69, 0xfd, 0x85, 0x24, 0x9a, 0x3d, 0x02,
+  0x00, 0x98, 0x2a, 0xaa, 0x52, 0x9c, 0x7d, 0x45, 0x19, 0x2e, 0xf1, 0x13, 0x2a, 0xf8, 0xe3, 0x3d,
+  0xbc, 0x26, 0x32, 0x99, 0x73, 0x22, 0xa2, 0xe9, 0xa0, 0xa4, 0x96, 0x9c, 0x19, 0x2a, 0x02, 0x61,
+  0x42, 0x84, 0x44, 0x15, 0xf4, 0xbe, 0x5d, 0xbd, 0xb1, 0x4f, 0x7b, 0x4d, 0x12, 0x23, 0x19, 0x06,
+  0xbd, 0x15, 0xc5, 0x75, 0xce, 0x85, 0xea, 0x41, 0xc8, 0x99, 0x42, 0xa6, 0x82, 0xde, 0x9a, 0x46,
+  0x2a, 0x09, 0x22, 0x5c, 0xd1, 0x10, 0xed, 0xe2, 0xc1, 0x02, 0xca, 0xa8, 0xa2, 0x24, 0xb5, 0x65,
+  0x48, 0x52, 0x0c, 0x86, 0x8e, 0x5b, 0xab, 0x92, 0x6a, 0x5b, 0x5b, 0xd4, 0x9f, 0x67, 0x70, 0x07,
+  0x19, 0x11, 0x31, 0x65, 0x3e, 0xb8, 0x13, 0xc8, 0x49, 0x14, 0x51, 0x16, 0x17, 0xbf, 0xe7, 0x7c,
+  0x63, 0x4b, 0xfa, 0x77, 0xf1, 0x38, 0xe7, 0x22, 0x42, 0x61, 0xcf, 0xf9, 0x66, 0x02, 0xdf, 0x77,
+  0xc2, 0x73, 0x1e, 0x6d, 0xe1, 0x6e, 0xf7, 0xa8, 0x3f, 0x0b, 0xce, 0x94, 0xbd, 0x20, 0x19, 0x4d,
+  0xb7, 0x3e, 0x18, 0x97, 0x18, 0x73, 0x84, 0x6f, 0xef, 0x0d, 0x0b, 0xae, 0x48, 0xc2, 0x33, 0x62,
+  0xc1, 0x5b, 0x64, 0xb8, 0x22, 0x16, 0xfc, 0x07, 0x45, 0x44, 0x18, 0xb1, 0x40, 0x12, 0x26, 0x6d,
+  0x89, 0x82, 0x2e, 0x26, 0x07, 0x9a, 0xe6, 0x24, 0xbc, 0x8d, 0x05, 0x5f, 0xb2, 0xc8, 0x87, 0x94,
+  0x32, 0x24, 0xc2, 0x8e, 0x05, 0x89, 0x28, 0x32, 0x65, 0x0e, 0x47, 0xe3, 0x08, 0x63, 0x0b, 0x1e,
+  0x9f, 0x9c, 0xbc, 0x40, 0x24, 0xe0, 0x3e, 0xb1, 0xe0, 0xf1, 0x8b, 0x93, 0xe7, 0x73, 0xe2, 0xc1,
+  0xd0, 0x75, 0x9f, 0xf4, 0x0f, 0x55, 0x65, 0x94, 0xd9, 0x09, 0xd2, 0x38, 0x51, 0xbe, 0x26, 0xaf,
+  0x92, 0x43, 0x72, 0xc8, 0x53, 0x2e, 0x7c, 0x78, 0x3c, 0x1a, 0x8d, 0xf6, 0x84, 0xfd, 0x2e, 0x1d,
+  0x0d, 0x34, 0xa1, 0x0c, 0x45, 0x81, 0xd5, 0xa6, 0x84, 0xd8, 0x87, 0xa1, 0xe7, 0xba, 0xf9, 0x66,
+  0xb2, 0x87, 0x0f, 0xc8, 0x52, 0xf1, 0x06, 0x86, 0x5e, 0x41, 0x6e, 0x2a, 0x22, 0x22, 0x6a, 0xe1,
+  0xd5, 0xdc, 0xa5, 0x88, 0xe7, 0xc4, 0xf4, 0xc6, 0x63, 0xab, 0xfe, 0x77, 0x9d, 0x97, 0xe3, 0xd6,
+  0x56, 0x0e, 0x95, 0x1f, 0xaa, 0x2a, 0xcf, 0x48, 0x63, 0xb4, 0x94, 0x3e, 0x0c, 0xc7, 0x6d, 0x86,
+  0xd2, 0x51, 0x7b, 0xce, 0x95, 0xe2, 0x59, 0xb7, 0x86, 0x8d, 0x2d, 0x13, 0x12, 0xf1, 0xb5, 0xde,
+  0xcd, 0x69, 0xbe, 0x81, 0x91, 0x97, 0x6f, 0x4a, 0xbf, 0x5c, 0xab, 0xf8, 0x73, 0x86, 0xfd, 0x4e,
+  0x8c, 0x74, 0xc4, 0x17, 0x00, 0x29, 0xdc, 0x28, 0x9b, 0xa4, 0x34, 0x66, 0x3e, 0x84, 0xc8, 0x14,
+  0x8a, 0x49, 0x07, 0x5f, 0x32, 0x84, 0xbb, 0x1d, 0xee, 0x5e, 0x38, 0xc2, 0xb1, 0x3b, 0x29, 0x63,
+  0x47, 0xd2, 0xbf, 0xd1, 0x07, 0xcf, 0xf1, 0x30, 0x9b, 0xb4, 0x3d, 0x1e, 0xb6, 0x01, 0x95, 0x8a,
+  0xa8, 0xa5, 0xb4, 0xe7, 0x24, 0x8a, 0xb1, 0x05, 0x6c, 0x44, 0x65, 0x9e, 0x92, 0xad, 0x0f, 0x94,
+  0xe9, 0xe8, 0xb1, 0xe7, 0x29, 0x0f, 0x6f, 0x8f, 0x60, 0xa9, 0x77, 0xfa, 0x53, 0x3c, 0xbd, 0x7b,
+  0x78, 0x16, 0xfe, 0xae, 0xab, 0xb8, 0x9a, 0xf3, 0x34, 0x3a, 0x24, 0x17, 0x48, 0x28, 0x41, 0x98,
+  0x5c, 0x70, 0x91, 0xf9, 0xb0, 0xcc, 0x73, 0x14, 0x21, 0x91, 0x78, 0x3c, 0xce, 0x1f, 0xbf, 0x1c,
+  0x93, 0x31, 0x39, 0xe9, 0x0c, 0xcf, 0x75, 0x42, 0x15, 0x76, 0x62, 0x5f, 0xa1, 0xc0, 0xb8, 0xc8,
+  0x48, 0x0a, 0x77, 0x87, 0x1a, 0x3d, 0x0c, 0xc3, 0x17, 0xc3, 0x2e, 0xd4, 0x30, 0x43, 0x11, 0x23,
+  0x0b, 0xb7, 0x6d, 0x11, 0x7c, 0xf1, 0x3c, 0x1c, 0x85, 0x13, 0x20, 0x8c, 0x66, 0x44, 0x51, 0xce,
+  0x7c, 0xc8, 0x97, 0xa9, 0x44, 0x18, 0x4a, 0xa0, 0x6c, 0xa1, 0x4b, 0x0b, 0x36, 0x15, 0xfe, 0xeb,
+  0x16, 0xb7, 0x0b, 0x41, 0x32, 0x94, 0x15, 0xdf, 0x1d, 0x8c, 0xdd, 0x27, 0x70, 0x07, 0x3c, 0x27,
+  0x21, 0x55, 0x5b, 0x1f, 0x5c, 0x67, 0x3c, 0x81, 0xef, 0x4d, 0x1f, 0xa2, 0xba, 0x06, 0x1e, 0x3b,
+  0xb6, 0x58, 0xd0, 0x16, 0x9e, 0x7a, 0xc5, 0x56, 0x98, 0xe5, 0x29, 0x51, 0x68, 0x87, 0x3c, 0x5d,
+  0x66, 0x4c, 0xfa, 0x20, 0x30, 0x47, 0xa2, 0x4c, 0x9d, 0x7b, 0xf6, 0x82, 0x2a, 0x4b, 0x67, 0x7b,
+  0x46, 0x36, 0xa6, 0xa7, 0x4f, 0xd4, 0x82, 0xe1, 0x42, 0xf4, 0x5b, 0x39, 0x14, 0x93, 0xbc, 0x1d,
+  0xfd, 0x0d, 0xcf, 0x32, 0x54, 0x82, 0x86, 0x76, 0x4a, 0xe6, 0xa8, 0xc1, 0x3c, 0x38, 0xe4, 0x13,
+  0xd7, 0x9d, 0xec, 0xc2, 0x76, 0x3c, 0x1e, 0x4f, 0x3a, 0x04, 0x57, 0x24, 0x5d, 0x62, 0x2d, 0x58,
+  0x45, 0xb3, 0x8e, 0xe5, 0xfb, 0xd1, 0x72, 0x2f, 0x01, 0xda, 0xa5, 0x22, 0x19, 0x75, 0x64, 0xc9,
+  0x4f, 0x72, 0x22, 0x24, 0x6c, 0x45, 0x24, 0xdc, 0x41, 0x5d, 0xa5, 0x5c, 0xf7, 0xc9, 0x04, 0x76,
+  0xd5, 0xef, 0xb4, 0xc1, 0x3e, 0x1d, 0x54, 0xcd, 0x60, 0x3a, 0x28, 0x1b, 0xd6, 0x54, 0x17, 0xf4,
+  0xaa, 0x4f, 0x44, 0x74, 0x05, 0x61, 0x4a, 0xa4, 0x0c, 0x7a, 0xbb, 0xfa, 0xd7, 0xdb, 0xf7, 0x8d,
+  0x03, 0x7a, 0xe1, 0x6b, 0x91, 0xd8, 0x0d, 0x8e, 0x82, 0x2b, 0x19, 0x1e, 0x6d, 0x7d, 0xc9, 0xb0,
+  0xc5, 0xdb, 0xd0, 0xd8, 0xcc, 0xeb, 0x1e, 0xd0, 0xa8, 0x5e, 0xe9, 0xcd, 0xce, 0x39, 0x63, 0x18,
+  0x2a, 0xca, 0xe2, 0xe9, 0x20, 0xa2, 0xab, 0x86, 0x43, 0xad, 0xc7, 0x86, 0xb6, 0x5d, 0xac, 0xf5,
+  0x8e, 0x5b, 0x0c, 0x0b, 0x72, 0x73, 0xa5, 0x19, 0x07, 0xbd, 0xd9, 0x3b, 0x24, 0x42, 0xc1, 0x57,
+  0xa2, 0xb0, 0x34, 0xd4, 0xc1, 0x59, 0x1c, 0x7c, 0xe9, 0x6d, 0x22, 0x7a, 0x33, 0xdb, 0x2e, 0x39,
+  0x5f, 0x7d, 0xf9, 0xd8, 0xf2, 0xed, 0x57, 0x6d, 0x5f, 0xe6, 0x9f, 0xbd, 0x87, 0x58, 0x95, 0x39,
+  0xf7, 0xf6, 0x76, 0x9f, 0xfc, 0x43, 0xab, 0x57, 0x98, 0xe5, 0x28, 0x88, 0x5a, 0x8a, 0x07, 0x6d,
+  0x59, 0x27, 0xe6, 0xde, 0xf8, 0xd3, 0x08, 0xe3, 0xc9, 0xf9, 0x3f, 0xf4, 0xe0, 0x55, 0xca, 0x79,
+  0x04, 0x5f, 0x04, 0x4a, 0xf9, 0x40, 0x27, 0xe6, 0x0d, 0x17, 0xb2, 0xec, 0xdd, 0x2f, 0xc4, 0x48,
+  0xe5, 0x4b, 0x32, 0x6a, 0x9c, 0xb4, 0x05, 0x29, 0x91, 0x0a, 0x12, 0xbe, 0x14, 0xd3, 0x41, 0x32,
+  0x9a, 0x4d, 0xab, 0xdc, 0x2a, 0x4f, 0xf8, 0x3c, 0x21, 0x42, 0xf5, 0x66, 0xd3, 0x41, 0xb9, 0x3a,
+  0x7b, 0x90, 0xf2, 0x06, 0xa8, 0x3f, 0xd2, 0xae, 0xc1, 0xfc, 0x75, 0xfd, 0x32, 0x27, 0xac, 0x1b,
+  0xc9, 0x0f, 0xda, 0xd2, 0x32, 0x8f, 0x88, 0x42, 0x5f, 0xa7, 0x7d, 0x4e, 0x58, 0xc5, 0xae, 0xad,
+  0x95, 0x84, 0xa8, 0x84, 0xae, 0xa4, 0xed, 0x6d, 0x35, 0x7f, 0xca, 0x50, 0xd0, 0x5c, 0xed, 0x7d,
+  0x18, 0x0c, 0xe0, 0x92, 0x64, 0x79, 0x8a, 0x12, 0x88, 0x84, 0x41, 0x42, 0xa5, 0xe2, 0x62, 0x0b,
+  0x84, 0x45, 0x30, 0xc0, 0x15, 0x32, 0x25, 0x41, 0x22, 0x8b, 0x40, 0x25, 0x98, 0xf9, 0x4d, 0xa9,
+  0xbb, 0x9e, 0xea, 0xf9, 0x12, 0x43, 0xce, 0x22, 0x69, 0xe9, 0x6c, 0xf1, 0x5f, 0x78, 0x8e, 0x6b,
+  0x95, 0x11, 0xec, 0xbf, 0x3c, 0xd5, 0xbf, 0x8b, 0x80, 0xf2, 0x47, 0x27, 0xce, 0x89, 0x6b, 0xe9,
+  0x83, 0xf5, 0xaf, 0x87, 0x9e, 0x6b, 0xb9, 0x37, 0x56, 0x6f, 0x91, 0x92, 0x58, 0xf6, 0xfc, 0xd3,
+  0x46, 0xd1, 0xe3, 0x4c, 0x2a, 0x78, 0xf7, 0xf9, 0xdb, 0x57, 0x08, 0x60, 0xa4, 0xab, 0x74, 0x8b,
+  0xf4, 0xe6, 0xc3, 0x1f, 0x6f, 0xff, 0x7b, 0xf1, 0xf1, 0xe2, 0xeb, 0xdb, 0x8b, 0x4f, 0xe7, 0x7f,
+  0x41, 0x00, 0xee, 0xc6, 0xf5, 0xf6, 0x4c, 0x29, 0x2a, 0x90, 0xd5, 0x4e, 0x02, 0xb8, 0xbe, 0x99,
+  0x3c, 0xda, 0x91, 0x16, 0x4b, 0x16, 0xea, 0x1e, 0x08, 0x91, 0x20, 0x6b, 0x93, 0x46, 0x16, 0xdc,
+  0xe2, 0xd6, 0x2a, 0xab, 0x72, 0xbf, 0xd5, 0xbc, 0x4a, 0x5b, 0xd5, 0x39, 0x06, 0x10, 0xf1, 0x70,
+  0x99, 0x21, 0x53, 0x4e, 0x8c, 0xea, 0x22, 0x45, 0xfd, 0xf3, 0xd5, 0xf6, 0x7d, 0x64, 0xd2, 0xa8,
+  0x3f, 0xe9, 0x90, 0x2b, 0x0a, 0x36, 0x04, 0x95, 0xbc, 0xd3, 0x7a, 0x0c, 0x53, 0x3d, 0xf9, 0xfe,
+  0xa9, 0x17, 0xbb, 0x84, 0xcb, 0x02, 0xbf, 0x67, 0x6f, 0x3f, 0x97, 0xe2, 0xef, 0x8a, 0xd5, 0x2e,
+  0xf9, 0x50, 0x6d, 0xf6, 0xcc, 0x31, 0xaa, 0x73, 0x7d, 0xb9, 0xd8, 0x28, 0xd3, 0xf0, 0x22, 0xa3,
+  0xd3, 0xdb, 0x9c, 0x53, 0x7d, 0xbe, 0x41, 0x8d, 0x9b, 0xb3, 0xa0, 0xa9, 0x42, 0x61, 0x4a, 0x08,
+  0x66, 0x20, 0xaf, 0x6f, 0x71, 0x7b, 0x03, 0x33, 0x70, 0x5b, 0xb2, 0x74, 0x01, 0x66, 0x29, 0xe9,
+  0xa4, 0xc8, 0x62, 0x95, 0xc0, 0x14, 0xbc, 0x3e, 0x08, 0x54, 0x4b, 0xc1, 0xba, 0xcc, 0x14, 0xc9,
+  0xad, 0xcd, 0x54, 0x52, 0x19, 0xc9, 0x9b, 0x26, 0x3a, 0x5d, 0x4b, 0xf9, 0x1a, 0x02, 0xf8, 0x48,
+  0x54, 0xe2, 0x64, 0x94, 0x99, 0x8e, 0xe3, 0x94, 0x5a, 0xfa, 0x16, 0x24, 0x34, 0x4e, 0x76, 0x34,
+  0xb2, 0x69, 0xd0, 0xba, 0x14, 0x15, 0x19, 0xd2, 0xe0, 0x2e, 0xa4, 0x6d, 0xad, 0xdf, 0x82, 0x61,
+  0xb7, 0x84, 0xd2, 0xc5, 0xa3, 0xf6, 0xf6, 0xfa, 0x70, 0xab, 0x36, 0x0c, 0x6f, 0x1c, 0x05, 0x76,
+  0x11, 0xa8, 0x2d, 0x69, 0xb5, 0x71, 0xa4, 0x12, 0xfc, 0x16, 0x2f, 0x75, 0x4b, 0xd6, 0x47, 0xa1,
+  0x03, 0xec, 0x3e, 0x93, 0x9e, 0x65, 0xff, 0xac, 0x22, 0xc3, 0xbb, 0x4f, 0x9e, 0x63, 0x4c, 0xd9,
+  0x17, 0xa2, 0x12, 0xb3, 0x7d, 0x6f, 0x28, 0x3d, 0x59, 0x70, 0x71, 0x41, 0xc2, 0xc4, 0x34, 0xa5,
+  0x05, 0xb4, 0xaf, 0x71, 0x3c, 0x8c, 0xe0, 0xfd, 0x4e, 0x74, 0x38, 0x98, 0xb2, 0x70, 0xb7, 0xd8,
+  0x54, 0x1f, 0x06, 0x65, 0x82, 0x3d, 0x2b, 0x03, 0x75, 0x72, 0x44, 0x6e, 0x0b, 0x41, 0x1d, 0x8c,
+  0x36, 0x0c, 0x5d, 0xb0, 0xc1, 0xac, 0xa2, 0xa1, 0x00, 0x4e, 0xab, 0x29, 0x60, 0x7d, 0x06, 0xe6,
+  0x8e, 0xcd, 0x6b, 0x87, 0x49, 0x11, 0x2a, 0x70, 0xb6, 0xdb, 0xf1, 0x15, 0x37, 0x37, 0x16, 0x6c,
+  0xfb, 0xe0, 0x17, 0x4b, 0x19, 0x5f, 0xed, 0x96, 0x0e, 0x05, 0xbf, 0xf7, 0x8f, 0xe1, 0x6a, 0x76,
+  0x50, 0x16, 0x34, 0x4d, 0x6b, 0xbc, 0x0d, 0x3d, 0xcf, 0x19, 0xdd, 0x3c, 0x57, 0x3a, 0x13, 0xf4,
+  0xe1, 0x3b, 0x8a, 0xbf, 0xa1, 0x1b, 0x8c, 0xcc, 0x61, 0xdf, 0x82, 0xe7, 0x16, 0x0c, 0xbd, 0xfe,
+  0x0f, 0x24, 0x52, 0xbe, 0x6e, 0x0b, 0xec, 0xb7, 0x7c, 0x70, 0x8d, 0xba, 0x5f, 0x6d, 0x64, 0xc2,
+  0xd7, 0xa6, 0x6c, 0x17, 0x98, 0x63, 0x15, 0xc5, 0x48, 0x84, 0xd1, 0x77, 0x74, 0xc2, 0x9e, 0x97,
+  0x2f, 0x05, 0x74, 0x5e, 0x3a, 0x89, 0xd8, 0x99, 0x6f, 0x03, 0x7c, 0x54, 0x91, 0xae, 0xc0, 0x1d,
+  0xaa, 0xf4, 0xf2, 0xaf, 0x2b, 0xd3, 0x25, 0xbc, 0x43, 0x99, 0x5e, 0x6e, 0x00, 0xf3, 0x40, 0x65,
+  0xf3, 0x2e, 0x55, 0xf3, 0xfc, 0xda, 0xbd, 0x81, 0xdf, 0x75, 0xa4, 0xce, 0xf3, 0xeb, 0xe1, 0x0d,
+  0x9c, 0x81, 0x31, 0x30, 0xe0, 0x77, 0xa8, 0x9f, 0x7d, 0x30, 0x8c, 0x87, 0x5a, 0xa8, 0xfa, 0xe0,
+  0x3d, 0x33, 0x0c, 0xd7, 0xf0, 0x9a, 0x28, 0x2c, 0xd2, 0xe1, 0x99, 0x9e, 0xa8, 0xdd, 0xbe, 0xa3,
+  0xf8, 0x07, 0xae, 0xdf, 0xad, 0x5c, 0xd1, 0x0c, 0x2f, 0x95, 0xa0, 0x2c, 0x36, 0x8f, 0x55, 0x04,
+  0xb5, 0xfc, 0x51, 0x37, 0x30, 0x4a, 0x8e, 0xee, 0x2a, 0xbb, 0xbf, 0xa3, 0x15, 0xd9, 0x58, 0x74,
+  0x3e, 0x78, 0xda, 0x6a, 0x67, 0x7d, 0xf8, 0x2d, 0x08, 0xc0, 0x3d, 0x94, 0x2f, 0xb5, 0xb6, 0x76,
+  0xb2, 0x57, 0x77, 0x06, 0xc6, 0x45, 0xfd, 0x60, 0x68, 0x94, 0x3e, 0x15, 0xb7, 0x47, 0xa3, 0x53,
+  0x49, 0x31, 0x53, 0x7c, 0x22, 0x59, 0x91, 0x27, 0x07, 0x77, 0x6e, 0x0d, 0xb5, 0x79, 0xa0, 0xb5,
+  0x7d, 0xb9, 0x2c, 0x94, 0x1f, 0xdc, 0x50, 0x8d, 0x9f, 0x84, 0x3e, 0x89, 0xa2, 0xfb, 0x91, 0x5f,
+  0x77, 0x99, 0x7c, 0x29, 0x13, 0x53, 0xfe, 0xb0, 0xf6, 0xca, 0x23, 0x35, 0x76, 0x9d, 0xd0, 0x14,
+  0xc1, 0xac, 0x35, 0x55, 0x45, 0xf9, 0xe9, 0xd3, 0x5a, 0xf7, 0xb5, 0xab, 0xab, 0xf3, 0xb4, 0x2e,
+  0x77, 0x35, 0x9f, 0x4c, 0xe8, 0x42, 0xb5, 0xcf, 0xb6, 0x4a, 0xcf, 0x56, 0x60, 0xe9, 0x09, 0xc1,
+  0xa8, 0x26, 0x43, 0xc3, 0x02, 0x9d, 0x95, 0x16, 0x18, 0xd5, 0x7d, 0xda, 0xe8, 0xe4, 0xde, 0x4d,
+  0x7a, 0x9a, 0xb3, 0xc8, 0x17, 0x2d, 0x31, 0x7a, 0xfe, 0xf2, 0x34, 0x9a, 0x1f, 0x01, 0x6a, 0x30,
+  0x80, 0xab, 0x04, 0xf7, 0xd3, 0x23, 0x70, 0x16, 0xa2, 0xa5, 0x87, 0x2c, 0x06, 0xb8, 0x42, 0xb1,
+  0x2d, 0x02, 0xb6, 0x74, 0x5f, 0xcf, 0x65, 0x54, 0x01, 0x95, 0xa0, 0xc8, 0x2d, 0xb2, 0x3d, 0xd8,
+  0xa8, 0xc2, 0xc4, 0x34, 0xea, 0x91, 0xed, 0x2c, 0xa3, 0x6c, 0xa9, 0x50, 0x06, 0x27, 0xee, 0x53,
+  0xfd, 0xb2, 0x82, 0xa8, 0xe0, 0x7f, 0x92, 0x33, 0xa3, 0x7f, 0xe0, 0xb1, 0xa3, 0x4d, 0x98, 0x42,
+  0x77, 0x0d, 0xe1, 0xd4, 0x71, 0x1d, 0x04, 0xe0, 0xb9, 0x2e, 0x9c, 0x81, 0x70, 0xb4, 0x88, 0xa9,
+  0x6b, 0xf4, 0xf5, 0x4d, 0x97, 0x60, 0x4a, 0xa5, 0xd2, 0xb2, 0xfa, 0x7b, 0xd7, 0x88, 0x48, 0x14,
+  0xf5, 0x5b, 0xcc, 0x21, 0xd1, 0xbe, 0x99, 0x65, 0x77, 0xfa, 0xde, 0x22, 0x2e, 0x28, 0x23, 0x69,
+  0xba, 0xad, 0xc9, 0x47, 0x9a, 0x50, 0x35, 0x7c, 0x96, 0xa9, 0x7b, 0xa1, 0x1f, 0x2e, 0xf9, 0x52,
+  0x84, 0x68, 0x1a, 0xd5, 0x5c, 0x6a, 0x74, 0x34, 0x9c, 0x92, 0xe2, 0x70, 0x96, 0xa1, 0x94, 0x24,
+  0xd6, 0xc1, 0x8e, 0xda, 0x88, 0x8e, 0xc7, 0x7f, 0x5f, 0x7e, 0xfe, 0xe4, 0xe4, 0xfa, 0xd5, 0xac,
+  0x89, 0x4e, 0x44, 0x14, 0xe9, 0xff, 0x48, 0x01, 0x0a, 0xc1, 0x85, 0xce, 0xd8, 0xd2, 0xc9, 0x9f,
+  0xa7, 0x7e, 0x2b, 0x4d, 0x8d, 0xaf, 0x7a, 0x34, 0xae, 0xee, 0xb9, 0xc6, 0x04, 0xbe, 0x77, 0x37,
+  0xb9, 0xe9, 0xa0, 0x1e, 0xc8, 0xa7, 0x83, 0xf2, 0xe6, 0x3e, 0x1d, 0x94, 0x2f, 0xa0, 0xff, 0x0f,
+  0x69, 0x2c, 0xf8, 0xca, 0x98, 0x16, 0x00, 0x00,
+};
+
+static const HttpAsset WEB_ASSETS[] = {
+  {"/", "text/html; charset=utf-8", ASSET_INDEX_HTML, sizeof(ASSET_INDEX_HTML), "\"ef9f27c274890810\"", true},
+};
+#define WEB_ASSET_COUNT (sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0]))
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * RescueNet AI - Host Arduino shim
+ *
+ * Just enough of the Arduino core API for the RescueNet firmware library
+ * to build on Linux. Time is virtual: millis()/micros() read a simulated
+ * clock and delay() advances it instantly, so a sketch loop that sleeps
+ * for seconds on the board replays in microseconds here while keeping
+ * its timing semantics. Pin writes are recorded so the simulation can
+ * observe LEDs and the buzzer. simRealTime() switches the clock to wall
+ * time, with delay() sleeping, for runs where several threads share it.
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "WString.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define DEC 10
+#define HEX 16
+
+#define PROGMEM
+#define PSTR(string_literal) (string_literal)
+#define F(string_literal) (string_literal)
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration = 0);
+void noTone(uint8_t pin);
+
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+void yield();
+void noInterrupts();
+void interrupts();
+
+// Subset of Print used by the firmware for logging
+class Print {
+public:
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* data, size_t size);
+
+  size_t print(const char* text);
+  size_t print(const String& text) { return print(text.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int value, int base = DEC) { return print((long)value, base); }
+  size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+
+  size_t println() { return print("\r\n"); }
+  template <typename T>
+  size_t println(const T& value) {
+    size_t n = print(value);
+    return n + println();
+  }
+  template <typename T>
+  size_t println(const T& value, int format) {
+    size_t n = print(value, format);
+    return n + println();
+  }
+};
+
+// Console serial port; echoes to stdout unless muted by the simulation
+class HostSerial : public Print {
+public:
+  void begin(unsigned long) {}
+  int available() { return 0; }
+  int read() { return -1; }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* data, size_t size) override;
+  void setEcho(bool enabled) { echo = enabled; }
+  unsigned long bytesWritten() const { return written; }
+
+private:
+  bool echo = true;
+  unsigned long written = 0;
+};
+
+extern HostSerial Serial;
+
+// Simulation controls (host only)
+void simSetMillis(unsigned long ms);
+void simAdvanceMicros(unsigned long us);
+// Off by default; while on, simAdvanceMicros() still moves the clock ahead
+void simRealTime(bool enabled);
+int simPinState(uint8_t pin);
+void simSetPinInput(uint8_t pin, int value);
+void simSetAnalogInput(uint8_t pin, int value);
+unsigned long simToneCount();
+
+#endif
@@ -0,0 +1,224 @@
+/*
+ * RescueNet AI - Host Arduino shim: String implementation
+ */
+
+#include "WString.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+void formatUnsigned(char* out, size_t size, unsigned long value, unsigned char base) {
+  char digits[33];
+  int n = 0;
+  if (base < 2 || base > 16) base = 10;
+  do {
+    unsigned long d = value % base;
+    digits[n++] = (char)(d < 10 ? '0' + d : 'A' + d - 10);
+    value /= base;
+  } while (value > 0 && n < (int)sizeof(digits));
+  size_t i = 0;
+  while (n > 0 && i + 1 < size) out[i++] = digits[--n];
+  out[i] = '\0';
+}
+
+void formatSigned(char* out, size_t size, long value, unsigned char base) {
+  if (value < 0 && base == 10) {
+    out[0] = '-';
+    formatUnsigned(out + 1, size - 1, 0UL - (unsigned long)value, base);
+  } else {
+    formatUnsigned(out, size, (unsigned long)value, base);
+  }
+}
+
+}  // namespace
+
+String::String(const char* cstr) : buffer(nullptr), capacity(0), len(0) {
+  assign(cstr ? cstr : "", cstr ? (unsigned int)strlen(cstr) : 0);
+}
+
+String::String(const String& other) : buffer(nullptr), capacity(0), len(0) {
+  assign(other.buffer, other.len);
+}
+
+String::String(char c) : buffer(nullptr), capacity(0), len(0) {
+  assign(&c, 1);
+}
+
+String::String(int value, unsigned char base) : buffer(nullptr), capacity(0), len(0) {
+  char tmp[34];
+  formatSigned(tmp, sizeof(tmp), value, base);
+  assign(tmp, (unsigned int)strlen(tmp));
+}
+
+String::String(unsigned int value, unsigned char base) : buffer(nullptr), capacity(0), len(0) {
+  char tmp[34];
+  formatUnsigned(tmp, sizeof(tmp), value, base);
+  assign(tmp, (unsigned int)strlen(tmp));
+}
+
+String::String(long value, unsigned char base) : buffer(nullptr), capacity(0), len(0) {
+  char tmp[34];
+  formatSigned(tmp, sizeof(tmp), value, base);
+  assign(tmp, (unsigned int)strlen(tmp));
+}
+
+String::String(unsigned long value, unsigned char base) : buffer(nullptr), capacity(0), len(0) {
+  char tmp[34];
+  formatUnsigned(tmp, sizeof(tmp), value, base);
+  assign(tmp, (unsigned int)strlen(tmp));
+}
+
+String::String(float value, unsigned char decimalPlaces) : buffer(nullptr), capacity(0), len(0) {
+  char tmp[48];
+  snprintf(tmp, sizeof(tmp), "%.*f", (int)decimalPlaces, (double)value);
+  assign(tmp, (unsigned int)strlen(tmp));
+}
+
+String::String(double value, unsigned char decimalPlaces) : buffer(nullptr), capacity(0), len(0) {
+  char tmp[48];
+  snprintf(tmp, sizeof(tmp), "%.*f", (int)decimalPlaces, value);
+  assign(tmp, (unsigned int)strlen(tmp));
+}
+
+String::~String() {
+  delete[] buffer;
+}
+
+String& String::operator=(const String& other) {
+  if (this != &other) assign(other.buffer, other.len);
+  return *this;
+}
+
+String& String::operator=(const char* cstr) {
+  assign(cstr ? cstr : "", cstr ? (unsigned int)strlen(cstr) : 0);
+  return *this;
+}
+
+String& String::operator+=(const char* cstr) {
+  if (cstr) concat(cstr, (unsigned int)strlen(cstr));
+  return *this;
+}
+
+bool String::reserve(unsigned int size) {
+  if (buffer && capacity >= size) return true;
+  // Same growth policy as the AVR/ESP32 cores: exactly what is asked for
+  char* grown = new char[size + 1];
+  if (buffer) {
+    memcpy(grown, buffer, len + 1);
+    delete[] buffer;
+  } else {
+    grown[0] = '\0';
+  }
+  buffer = grown;
+  capacity = size;
+  return true;
+}
+
+void String::assign(const char* data, unsigned int count) {
+  if (data >= buffer && buffer && data < buffer + capacity + 1) {
+    // Self-assignment of a substring; move in place
+    memmove(buffer, data, count);
+  } else {
+    reserve(count);
+    memcpy(buffer, data, count);
+  }
+  len = count;
+  buffer[len] = '\0';
+}
+
+String& String::concat(const char* data, unsigned int count) {
+  if (count == 0) return *this;
+  unsigned int newLen = len + count;
+  if (data >= buffer && data < buffer + len) {
+    // Appending part of ourselves: copy out before the buffer moves
+    String tmp;
+    tmp.assign(data, count);
+    reserve(newLen);
+    memcpy(buffer + len, tmp.buffer, count);
+  } else {
+    reserve(newLen);
+    memcpy(buffer + len, data, count);
+  }
+  len = newLen;
+  buffer[len] = '\0';
+  return *this;
+}
+
+bool String::equals(const char* cstr) const {
+  return strcmp(buffer, cstr ? cstr : "") == 0;
+}
+
+int String::indexOf(char c, unsigned int fromIndex) const {
+  if (fromIndex >= len) return -1;
+  const char* hit = strchr(buffer + fromIndex, c);
+  return hit ? (int)(hit - buffer) : -1;
+}
+
+int String::indexOf(const char* needle, unsigned int fromIndex) const {
+  if (fromIndex > len || !needle) return -1;
+  const char* hit = strstr(buffer + fromIndex, needle);
+  return hit ? (int)(hit - buffer) : -1;
+}
+
+bool String::startsWith(const char* prefix) const {
+  size_t n = strlen(prefix);
+  return n <= len && strncmp(buffer, prefix, n) == 0;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+  if (endIndex > len) endIndex = len;
+  String out;
+  if (beginIndex < endIndex) out.assign(buffer + beginIndex, endIndex - beginIndex);
+  return out;
+}
+
+void String::trim() {
+  unsigned int begin = 0;
+  while (begin < len && (buffer[begin] == ' ' || buffer[begin] == '\t' ||
+                         buffer[begin] == '\r' || buffer[begin] == '\n')) {
+    begin++;
+  }
+  unsigned int end = len;
+  while (end > begin && (buffer[end - 1] == ' ' || buffer[end - 1] == '\t' ||
+                         buffer[end - 1] == '\r' || buffer[end - 1] == '\n')) {
+    end--;
+  }
+  memmove(buffer, buffer + begin, end - begin);
+  len = end - begin;
+  buffer[len] = '\0';
+}
+
+long String::toInt() const {
+  return atol(buffer);
+}
+
+float String::toFloat() const {
+  return (float)atof(buffer);
+}
+
+String operator+(const String& lhs, const String& rhs) {
+  String out(lhs);
+  out += rhs;
+  return out;
+}
+
+String operator+(const String& lhs, const char* rhs) {
+  String out(lhs);
+  out += rhs;
+  return out;
+}
+
+String operator+(const char* lhs, const String& rhs) {
+  String out(lhs);
+  out += rhs;
+  return out;
+}
+
+String operator+(const String& lhs, char rhs) {
+  String out(lhs);
+  out += rhs;
+  return out;
+}
@@ -0,0 +1,71 @@
+/*
+ * RescueNet AI - Host Arduino shim: String
+ *
+ * Minimal stand-in for the Arduino core String class so the firmware
+ * sources compile on a workstation. Storage is allocated with new[] so
+ * the heap counters in host/sim/heap_stats.cpp see the same allocation
+ * churn the sketches cause on the boards.
+ */
+
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+#include <stddef.h>
+
+class String {
+public:
+  String(const char* cstr = "");
+  String(const String& other);
+  explicit String(char c);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(float value, unsigned char decimalPlaces = 2);
+  explicit String(double value, unsigned char decimalPlaces = 2);
+  ~String();
+
+  String& operator=(const String& other);
+  String& operator=(const char* cstr);
+
+  String& operator+=(const String& other) { return concat(other.buffer, other.len); }
+  String& operator+=(const char* cstr);
+  String& operator+=(char c) { return concat(&c, 1); }
+
+  bool operator==(const String& other) const { return equals(other.buffer); }
+  bool operator==(const char* cstr) const { return equals(cstr); }
+  bool operator!=(const String& other) const { return !equals(other.buffer); }
+  bool operator!=(const char* cstr) const { return !equals(cstr); }
+
+  unsigned int length() const { return len; }
+  const char* c_str() const { return buffer; }
+  char charAt(unsigned int index) const { return index < len ? buffer[index] : 0; }
+  char operator[](unsigned int index) const { return charAt(index); }
+
+  int indexOf(char c, unsigned int fromIndex = 0) const;
+  int indexOf(const char* needle, unsigned int fromIndex = 0) const;
+  int indexOf(const String& needle, unsigned int fromIndex = 0) const { return indexOf(needle.buffer, fromIndex); }
+  bool startsWith(const char* prefix) const;
+  String substring(unsigned int beginIndex) const { return substring(beginIndex, len); }
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+  void trim();
+  long toInt() const;
+  float toFloat() const;
+  bool reserve(unsigned int size);
+
+private:
+  String& concat(const char* data, unsigned int count);
+  bool equals(const char* cstr) const;
+  void assign(const char* data, unsigned int count);
+
+  char* buffer;
+  unsigned int capacity;
+  unsigned int len;
+};
+
+String operator+(const String& lhs, const String& rhs);
+String operator+(const String& lhs, const char* rhs);
+String operator+(const char* lhs, const String& rhs);
+String operator+(const String& lhs, char rhs);
+
+#endif
@@ -0,0 +1,192 @@
+/*
+ * RescueNet AI - Host Arduino shim: virtual clock, pins and console
+ */
+
+#include "Arduino.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <thread>
+
+HostSerial Serial;
+
+namespace {
+
+// Virtual time in microseconds since "boot"
+unsigned long long clockMicros = 0;
+
+// simRealTime(): the clock follows steady_clock from clockMicros on
+bool realTime = false;
+std::chrono::steady_clock::time_point realStart;
+
+unsigned long long nowMicros() {
+  if (!realTime) return clockMicros;
+  return clockMicros + (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - realStart).count();
+}
+
+const int PIN_COUNT = 64;
+int pinOutput[PIN_COUNT];
+int pinInput[PIN_COUNT] = {
+  HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH,
+  HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH,
+  HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH,
+  HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH,
+};
+int analogInput[PIN_COUNT];
+unsigned long toneCount = 0;
+
+// Deterministic LCG so simulated runs are reproducible
+unsigned long randomState = 1;
+
+}  // namespace
+
+unsigned long millis() {
+  return (unsigned long)(nowMicros() / 1000ULL);
+}
+
+unsigned long micros() {
+  return (unsigned long)nowMicros();
+}
+
+void delay(unsigned long ms) {
+  if (realTime) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  } else {
+    clockMicros += (unsigned long long)ms * 1000ULL;
+  }
+}
+
+void delayMicroseconds(unsigned int us) {
+  if (realTime) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+  } else {
+    clockMicros += us;
+  }
+}
+
+void yield() {}
+void noInterrupts() {}
+void interrupts() {}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin < PIN_COUNT) pinOutput[pin] = value;
+}
+
+int digitalRead(uint8_t pin) {
+  if (pin >= PIN_COUNT) return LOW;
+  return pinInput[pin];
+}
+
+int analogRead(uint8_t pin) {
+  return pin < PIN_COUNT ? analogInput[pin] : 0;
+}
+
+void tone(uint8_t, unsigned int, unsigned long) {
+  toneCount++;
+}
+
+void noTone(uint8_t) {}
+
+long random(long howBig) {
+  if (howBig <= 0) return 0;
+  randomState = randomState * 1103515245UL + 12345UL;
+  return (long)((randomState >> 16) % (unsigned long)howBig);
+}
+
+long random(long howSmall, long howBig) {
+  if (howSmall >= howBig) return howSmall;
+  return howSmall + random(howBig - howSmall);
+}
+
+void randomSeed(unsigned long seed) {
+  randomState = seed ? seed : 1;
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+size_t Print::write(const uint8_t* data, size_t size) {
+  size_t n = 0;
+  while (size--) n += write(*data++);
+  return n;
+}
+
+size_t Print::print(const char* text) {
+  return write((const uint8_t*)text, strlen(text));
+}
+
+// Stack buffers, like Arduino's Print::printNumber; no String involved
+size_t Print::print(long value, int base) {
+  if (value < 0 && base == 10) {
+    return print('-') + print(0UL - (unsigned long)value, base);
+  }
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  char digits[8 * sizeof(long) + 1];
+  char* p = digits + sizeof(digits) - 1;
+  *p = '\0';
+  if (base < 2 || base > 16) base = 10;
+  do {
+    unsigned long d = value % (unsigned long)base;
+    *--p = (char)(d < 10 ? '0' + d : 'A' + d - 10);
+    value /= (unsigned long)base;
+  } while (value);
+  return print((const char*)p);
+}
+
+size_t Print::print(double value, int digits) {
+  char tmp[48];
+  snprintf(tmp, sizeof(tmp), "%.*f", digits, value);
+  return print((const char*)tmp);
+}
+
+size_t HostSerial::write(uint8_t c) {
+  written++;
+  if (echo) fputc(c, stdout);
+  return 1;
+}
+
+size_t HostSerial::write(const uint8_t* data, size_t size) {
+  written += size;
+  if (echo) fwrite(data, 1, size, stdout);
+  return size;
+}
+
+void simSetMillis(unsigned long ms) {
+  clockMicros = (unsigned long long)ms * 1000ULL;
+  realStart = std::chrono::steady_clock::now();
+}
+
+void simAdvanceMicros(unsigned long us) {
+  clockMicros += us;
+}
+
+void simRealTime(bool enabled) {
+  if (enabled == realTime) return;
+  clockMicros = nowMicros();
+  realStart = std::chrono::steady_clock::now();
+  realTime = enabled;
+}
+
+int simPinState(uint8_t pin) {
+  return pin < PIN_COUNT ? pinOutput[pin] : LOW;
+}
+
+void simSetPinInput(uint8_t pin, int value) {
+  if (pin < PIN_COUNT) pinInput[pin] = value;
+}
+
+void simSetAnalogInput(uint8_t pin, int value) {
+  if (pin < PIN_COUNT) analogInput[pin] = value;
+}
+
+unsigned long simToneCount() {
+  return toneCount;
+}
@@ -0,0 +1,229 @@
+/*
+ * RescueNet AI - Vital-sign anomaly detector benchmark
+ *
+ * Replays the labeled vital traces of host/sim/vital_traces.h through
+ * the fixed thresholds detectEmergency() used to apply and through the
+ * personalized VitalTrackers it applies now (anomaly_detector.h), and
+ * reports:
+ *
+ *   accuracy     per trace kind, what each detector raised: false alarms
+ *                on the normal traces and before the onset, the anomalous
+ *                traces caught and how long after the onset; then the
+ *                precision and recall over all traces and false alarms
+ *                per day of normal readings
+ *   throughput   tracker updates per second on this workstation, the
+ *                heap they use (none) and the memory of one tracker
+ *
+ * A detector's alarm counts once per raise; a trace's first alarm after
+ * the onset is its detection, later ones are not counted either way.
+ *
+ * Usage: anomaly_bench [--quick]
+ */
+
+#include <Arduino.h>
+#include <anomaly_detector.h>
+#include <health_monitor.h>
+
+#include "../sim/heap_stats.h"
+#include "../sim/vital_traces.h"
+#include "bench_util.h"
+
+#include <map>
+#include <string>
+
+namespace {
+
+// The rule detectEmergency() had: any reading outside the thresholds,
+// raised again once the readings are back inside
+class FixedThresholds {
+public:
+  // Movement made no difference to it
+  bool update(float heartRate, float temperature, bool) {
+    bool out = heartRate > HEART_RATE_MAX || (heartRate > 0 && heartRate < HEART_RATE_MIN) ||
+               temperature > TEMP_MAX || temperature < TEMP_MIN;
+    bool raised = out && !active;
+    active = out;
+    return raised;
+  }
+
+private:
+  bool active = false;
+};
+
+// Both trackers, fed the way detectEmergency() feeds them
+class Personalized {
+public:
+  Personalized() : heartRate(HEART_RATE_LIMITS), temperature(TEMP_LIMITS) {}
+
+  bool update(float hr, float temp, bool moving) {
+    bool raised = hr > 0 && heartRate.update(hr, moving);
+    raised |= temperature.update(temp, moving);
+    return raised;
+  }
+
+private:
+  VitalTracker heartRate;
+  VitalTracker temperature;
+};
+
+struct Score {
+  unsigned falseAlarms = 0;  // On normal traces or before the onset
+  unsigned caught = 0;
+  unsigned missed = 0;
+  std::vector<double> delayMin;
+  size_t normalReadings = 0;
+};
+
+template <typename Detector>
+void replay(const VitalTrace& trace, Score& score) {
+  Detector detector;
+  bool detected = false;
+  for (size_t i = 0; i < trace.heartRate.size(); i++) {
+    bool raised = detector.update(trace.heartRate[i], trace.temperature[i], trace.moving[i] != 0);
+    bool afterOnset = trace.anomalous && i >= trace.onset;
+    if (!afterOnset) score.normalReadings++;
+    if (!raised) continue;
+    if (!afterOnset) {
+      score.falseAlarms++;
+    } else if (!detected) {
+      detected = true;
+      score.caught++;
+      score.delayMin.push_back((double)(i - trace.onset) * VITAL_TRACE_READING_MS / 60000.0);
+    }
+  }
+  if (trace.anomalous && !detected) score.missed++;
+}
+
+double precision(const Score& s) {
+  return s.caught + s.falseAlarms ? (double)s.caught / (s.caught + s.falseAlarms) : 0.0;
+}
+
+double recall(const Score& s) {
+  return s.caught + s.missed ? (double)s.caught / (s.caught + s.missed) : 0.0;
+}
+
+double falsePerDay(const Score& s) {
+  double days = (double)s.normalReadings * VITAL_TRACE_READING_MS / 86400000.0;
+  return days > 0 ? s.falseAlarms / days : 0.0;
+}
+
+std::string cell(const Score& s, bool anomalous) {
+  char text[48];
+  if (!anomalous) {
+    snprintf(text, sizeof(text), "%u false", s.falseAlarms);
+  } else {
+    std::vector<double> delays = s.delayMin;
+    snprintf(text, sizeof(text), "%u/%u  %.1f min  %u false", s.caught, s.caught + s.missed,
+             delays.empty() ? 0.0 : benchPercentile(delays, 50), s.falseAlarms);
+  }
+  return text;
+}
+
+void add(Score& total, const Score& s) {
+  total.falseAlarms += s.falseAlarms;
+  total.caught += s.caught;
+  total.missed += s.missed;
+  total.normalReadings += s.normalReadings;
+  total.delayMin.insert(total.delayMin.end(), s.delayMin.begin(), s.delayMin.end());
+}
+
+void runAccuracy(const std::vector<VitalTrace>& traces) {
+  // Per kind, in the order the traces come
+  std::vector<std::string> kinds;
+  std::map<std::string, bool> anomalous;
+  std::map<std::string, Score> fixed;
+  std::map<std::string, Score> personal;
+  for (size_t t = 0; t < traces.size(); t++) {
+    const VitalTrace& trace = traces[t];
+    if (!fixed.count(trace.label)) kinds.push_back(trace.label);
+    anomalous[trace.label] = trace.anomalous;
+    replay<FixedThresholds>(trace, fixed[trace.label]);
+    replay<Personalized>(trace, personal[trace.label]);
+  }
+
+  printf("accuracy: %zu traces, caught/traces, median delay, false alarms\n", traces.size());
+  printf("  %-22s %-30s %-30s\n", "trace", "fixed thresholds", "personalized");
+  Score fixedTotal, personalTotal;
+  bool athleteQuiet = true;
+  bool artifactsQuiet = true;
+  bool slowCaught = true;
+  for (size_t k = 0; k < kinds.size(); k++) {
+    const std::string& kind = kinds[k];
+    printf("  %-22s %-30s %-30s\n", kind.c_str(), cell(fixed[kind], anomalous[kind]).c_str(),
+           cell(personal[kind], anomalous[kind]).c_str());
+    add(fixedTotal, fixed[kind]);
+    add(personalTotal, personal[kind]);
+    if (kind == "athlete at rest") athleteQuiet = personal[kind].falseAlarms == 0;
+    if (kind == "artifacts") artifactsQuiet = personal[kind].falseAlarms == 0;
+    if (kind.compare(0, 4, "slow") == 0) slowCaught &= personal[kind].missed == 0;
+  }
+  printf("  %-22s %-30s %-30s\n", "", "precision / recall", "precision / recall");
+  char f[40], p[40];
+  snprintf(f, sizeof(f), "%.2f / %.2f", precision(fixedTotal), recall(fixedTotal));
+  snprintf(p, sizeof(p), "%.2f / %.2f", precision(personalTotal), recall(personalTotal));
+  printf("  %-22s %-30s %-30s\n", "all", f, p);
+  snprintf(f, sizeof(f), "%.1f", falsePerDay(fixedTotal));
+  snprintf(p, sizeof(p), "%.1f", falsePerDay(personalTotal));
+  printf("  %-22s %-30s %-30s\n", "false alarms per day", f, p);
+
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%.2f -> %.2f", precision(fixedTotal), precision(personalTotal));
+  check("precision above the fixed thresholds", precision(personalTotal) > precision(fixedTotal), detail);
+  snprintf(detail, sizeof(detail), "%.2f -> %.2f", recall(fixedTotal), recall(personalTotal));
+  check("recall at least the fixed thresholds'", recall(personalTotal) >= recall(fixedTotal), detail);
+  check("no alarm for an athlete at rest", athleteQuiet);
+  check("single-reading artifacts ignored", artifactsQuiet);
+  check("slow rises under the thresholds caught", slowCaught);
+}
+
+struct ThroughputRun {
+  const std::vector<VitalTrace>* traces;
+  int passes;
+  uint64_t updates;
+  uint64_t ns;
+  uint64_t alarms;
+};
+
+void replayAll(void* arg) {
+  ThroughputRun* run = (ThroughputRun*)arg;
+  uint64_t start = benchNowNs();
+  for (int pass = 0; pass < run->passes; pass++) {
+    for (size_t t = 0; t < run->traces->size(); t++) {
+      const VitalTrace& trace = (*run->traces)[t];
+      Personalized detector;
+      for (size_t i = 0; i < trace.heartRate.size(); i++) {
+        run->alarms += detector.update(trace.heartRate[i], trace.temperature[i], trace.moving[i] != 0);
+      }
+      // Two trackers per reading
+      run->updates += 2 * trace.heartRate.size();
+    }
+  }
+  run->ns = benchNowNs() - start;
+}
+
+void runThroughput(const std::vector<VitalTrace>& traces, int passes) {
+  ThroughputRun run = {&traces, passes, 0, 0, 0};
+  HeapStats before = heapStats();
+  size_t stack = stackHighWater(replayAll, &run);
+  uint64_t allocations = heapStats().allocations - before.allocations;
+  double perSecond = run.updates * 1e9 / (double)run.ns;
+
+  printf("throughput: %llu tracker updates in %d passes\n", (unsigned long long)run.updates, passes);
+  printf("  %.1f M updates/s, %.1f ns each; %zu bytes per tracker, stack %zu bytes, %llu allocations\n",
+         perSecond / 1e6, (double)run.ns / run.updates, sizeof(VitalTracker), stack,
+         (unsigned long long)allocations);
+  check("over a million updates per second", perSecond > 1e6);
+  check("updates use no heap", allocations == 0);
+  check("a tracker fits in 32 bytes of state", sizeof(VitalTracker) <= 32 + sizeof(void*));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  Serial.setEcho(false);
+  std::vector<VitalTrace> traces = makeVitalTraces(quick ? 4 : 20);
+  runAccuracy(traces);
+  runThroughput(traces, quick ? 5 : 50);
+  return benchResult();
+}
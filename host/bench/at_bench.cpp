@@ -0,0 +1,309 @@
+/*
+ * RescueNet AI - AT engine benchmark
+ *
+ * Plays scripted modem conversations through AtEngine and checks each
+ * outcome: final results, information lines, '>' prompts, +CME/+CMS
+ * errors, timeouts, command echo, replies split into small chunks, and
+ * URCs (+CMTI, +CREG, RING) arriving between a command and its answer.
+ *
+ * The SIM800L set-up and an SMS are also run the old way (write, delay a
+ * fixed guess, read everything, look for "OK") to compare how long the
+ * loop is held and how many URCs are lost.
+ *
+ * Last, host CPU cost per command and per received byte.
+ *
+ * Usage: at_bench [--quick]
+ */
+
+#include <Arduino.h>
+#include <at_engine.h>
+
+#include "../sim/scripted_modem.h"
+#include "bench_util.h"
+
+#include <string>
+
+namespace {
+
+const unsigned long POLL_MS = 5;
+
+struct Outcome {
+  int calls = 0;
+  AtStatus status = AT_ABORTED;
+  int16_t errorCode = -1;
+  std::string info;
+  uint32_t latencyMs = 0;
+};
+
+void record(const AtResult& result, void* context) {
+  Outcome* outcome = static_cast<Outcome*>(context);
+  outcome->calls++;
+  outcome->status = result.status;
+  outcome->errorCode = result.errorCode;
+  outcome->info = result.info;
+  outcome->latencyMs = result.latencyMs;
+}
+
+void collectUrc(const char* line, void* context) {
+  static_cast<std::vector<std::string>*>(context)->push_back(line);
+}
+
+struct Case {
+  ScriptedModem modem;
+  AtEngine engine;
+  std::vector<std::string> urcs;
+
+  Case() : engine(modem) {
+    simSetMillis(0);
+    engine.onUrc(collectUrc, &urcs);
+  }
+
+  void runFor(unsigned long ms) {
+    unsigned long end = millis() + ms;
+    while (millis() < end) {
+      engine.poll();
+      delay(POLL_MS);
+    }
+    engine.poll();
+  }
+};
+
+std::string describe(const Outcome& o) {
+  static const char* const NAMES[] = {"OK", "ERROR", "TIMEOUT", "ABORTED"};
+  char text[128];
+  snprintf(text, sizeof(text), "%s code %d info \"%s\" %lu ms", NAMES[o.status], o.errorCode, o.info.c_str(),
+           (unsigned long)o.latencyMs);
+  return text;
+}
+
+void runScenarios() {
+  printf("scenarios:\n");
+  {
+    Case c;
+    c.modem.expect("AT", "\r\nOK\r\n");
+    Outcome o;
+    c.engine.send("AT", record, &o);
+    c.runFor(100);
+    check("plain OK", o.calls == 1 && o.status == AT_OK && o.latencyMs <= 20 + POLL_MS, describe(o));
+  }
+  {
+    Case c;
+    c.modem.expect("AT+CSQ", "\r\n+CMTI: \"SM\",3\r\n\r\n+CSQ: 18,0\r\n\r\n+CREG: 1\r\n\r\nOK\r\n");
+    Outcome o;
+    c.engine.send("AT+CSQ", record, &o);
+    c.runFor(100);
+    check("URCs inside an answer", o.status == AT_OK && o.info == "+CSQ: 18,0" && c.urcs.size() == 2,
+          describe(o));
+  }
+  {
+    Case c;
+    c.modem.setEcho(true);
+    c.modem.expect("AT+CREG?", "\r\n+CREG: 0,5\r\n\r\nOK\r\n");
+    Outcome o;
+    c.engine.send("AT+CREG?", record, &o);
+    c.runFor(100);
+    check("echo on", o.status == AT_OK && o.info == "+CREG: 0,5" && c.urcs.empty(), describe(o));
+  }
+  {
+    Case c;
+    c.modem.setChunking(3, 2);
+    c.modem.expect("AT+CSQ", "\r\n+CSQ: 21,0\r\n\r\nOK\r\n");
+    // Between the information line and OK, which arrive 20-32 ms
+    c.modem.inject("\r\nRING\r\n", 29);
+    Outcome o;
+    c.engine.send("AT+CSQ", record, &o);
+    c.runFor(200);
+    check("reply in 3-byte chunks", o.status == AT_OK && o.info == "+CSQ: 21,0", describe(o));
+    check("RING between chunks", c.urcs.size() == 1 && c.urcs[0] == "RING");
+  }
+  {
+    Case c;
+    c.modem.expect("AT+CMGS=\"+1234567890\"", "\r\n> ", 40);
+    c.modem.expectBody("Help", "\r\n+CMGS: 7\r\n\r\nOK\r\n", 3000);
+    Outcome o;
+    c.engine.sendWithPayload("AT+CMGS=\"+1234567890\"", "Help", 5000, 60000, record, &o);
+    c.runFor(4000);
+    check("SMS prompt and body", o.status == AT_OK && o.info == "+CMGS: 7" && c.modem.errors().empty(),
+          describe(o));
+  }
+  {
+    Case c;
+    c.modem.expect("AT+CMGS=\"+1234567890\"", "\r\n> ");
+    c.modem.expectBody("Help", "\r\n+CMS ERROR: 500\r\n", 500);
+    Outcome o;
+    c.engine.sendWithPayload("AT+CMGS=\"+1234567890\"", "Help", 5000, 60000, record, &o);
+    c.runFor(1000);
+    check("+CMS ERROR", o.status == AT_ERROR && o.errorCode == 500, describe(o));
+  }
+  {
+    Case c;
+    c.modem.expect("AT+CMGS=\"+1234567890\"", "");
+    Outcome o;
+    c.engine.sendWithPayload("AT+CMGS=\"+1234567890\"", "Help", 5000, 60000, record, &o);
+    c.runFor(6000);
+    check("no prompt", o.status == AT_TIMEOUT && o.latencyMs >= 5000 && o.latencyMs <= 5000 + POLL_MS,
+          describe(o));
+  }
+  {
+    Case c;
+    c.modem.expect("AT+CSQ", "");
+    c.modem.expect("AT", "\r\nOK\r\n");
+    Outcome first, second;
+    c.engine.send("AT+CSQ", record, &first, 300);
+    c.engine.send("AT", record, &second);
+    c.runFor(500);
+    check("timeout, then the queue moves on", first.status == AT_TIMEOUT && second.status == AT_OK,
+          describe(first) + " / " + describe(second));
+  }
+  {
+    Case c;
+    c.modem.inject("\r\n+CMTI: \"SM\",12\r\n", 10);
+    c.modem.inject("\r\n+CREG: 1\r\n", 20);
+    c.runFor(50);
+    check("URCs while idle", c.urcs.size() == 2 && c.urcs[0] == "+CMTI: \"SM\",12");
+  }
+  {
+    Case c;
+    Outcome o[AT_QUEUE_DEPTH + 1];
+    int accepted = 0;
+    for (int i = 0; i <= AT_QUEUE_DEPTH; i++) {
+      c.modem.expect("AT", "\r\nOK\r\n");
+      accepted += c.engine.send("AT", record, &o[i]) ? 1 : 0;
+    }
+    c.runFor(200);
+    check("full queue refuses", accepted == AT_QUEUE_DEPTH && c.engine.stats().rejected == 1);
+  }
+}
+
+// The v4.0 sketch: println, delay(guess), read everything, indexOf("OK")
+struct LegacyResult {
+  unsigned long blockedMs;
+  int urcsLost;
+  bool configured;
+  bool smsSent;
+};
+
+std::string legacyExchange(ScriptedModem& modem, const char* command, unsigned long waitMs) {
+  modem.println(command);
+  delay(waitMs);
+  std::string response;
+  while (modem.available()) response += (char)modem.read();
+  return response;
+}
+
+int countUrcs(const std::string& response) {
+  int count = 0;
+  for (size_t at = response.find("+CMTI"); at != std::string::npos; at = response.find("+CMTI", at + 1)) count++;
+  return count;
+}
+
+void scriptSetup(ScriptedModem& modem) {
+  modem.expect("AT", "\r\nOK\r\n");
+  modem.expect("AT+CMGF=1", "\r\nOK\r\n");
+  modem.expect("AT+CSCS=\"GSM\"", "\r\nOK\r\n");
+  modem.expect("AT+CREG?", "\r\n+CREG: 0,1\r\n\r\nOK\r\n");
+  modem.expect("AT+CSQ", "\r\n+CSQ: 18,0\r\n\r\nOK\r\n");
+  modem.expect("AT+CMGS=\"+1234567890\"", "\r\n> ");
+  modem.expectBody("EMERGENCY", "\r\n+CMGS: 4\r\n\r\nOK\r\n", 3000);
+  // Two messages arrive during set-up
+  modem.inject("\r\n+CMTI: \"SM\",1\r\n", 1500);
+  modem.inject("\r\n+CMTI: \"SM\",2\r\n", 2500);
+}
+
+void runComparison() {
+  printf("SIM800L set-up + one SMS, 20 ms modem, 3 s network:\n");
+
+  simSetMillis(0);
+  ScriptedModem oldModem;
+  scriptSetup(oldModem);
+  LegacyResult legacy = {0, 2, false, false};
+  legacy.configured = legacyExchange(oldModem, "AT", 1000).find("OK") != std::string::npos;
+  std::string discarded;
+  discarded += legacyExchange(oldModem, "AT+CMGF=1", 1000);
+  discarded += legacyExchange(oldModem, "AT+CSCS=\"GSM\"", 1000);
+  discarded += legacyExchange(oldModem, "AT+CREG?", 1000);
+  discarded += legacyExchange(oldModem, "AT+CSQ", 1000);
+  legacyExchange(oldModem, "AT+CMGS=\"+1234567890\"", 1000);
+  oldModem.print("EMERGENCY");
+  delay(100);
+  oldModem.write((uint8_t)26);
+  oldModem.print("\r\n");
+  delay(5000);
+  std::string response;
+  while (oldModem.available()) response += (char)oldModem.read();
+  legacy.smsSent = response.find("OK") != std::string::npos;
+  legacy.blockedMs = millis();
+  // The old code threw the configuration replies away, URCs included
+  legacy.urcsLost = countUrcs(discarded);
+
+  simSetMillis(0);
+  ScriptedModem newModem;
+  scriptSetup(newModem);
+  AtEngine engine(newModem);
+  std::vector<std::string> urcs;
+  engine.onUrc(collectUrc, &urcs);
+  static const char* const SETUP[] = {"AT", "AT+CMGF=1", "AT+CSCS=\"GSM\"", "AT+CREG?", "AT+CSQ"};
+  Outcome setup[5], sms;
+  for (int i = 0; i < 5; i++) {
+    // Queue depth permitting; the rest are queued from the poll loop
+    if (i < AT_QUEUE_DEPTH) engine.send(SETUP[i], record, &setup[i]);
+  }
+  int queuedSetup = AT_QUEUE_DEPTH < 5 ? AT_QUEUE_DEPTH : 5;
+  bool smsQueued = false;
+  unsigned long longestPollMs = 0;
+  unsigned long done = 0;
+  while (millis() < 20000 && !done) {
+    unsigned long before = millis();
+    engine.poll();
+    longestPollMs = std::max(longestPollMs, millis() - before);
+    if (queuedSetup < 5 && engine.queued() < AT_QUEUE_DEPTH) {
+      engine.send(SETUP[queuedSetup], record, &setup[queuedSetup]);
+      queuedSetup++;
+    }
+    if (queuedSetup == 5 && !smsQueued && engine.idle()) {
+      smsQueued = engine.sendWithPayload("AT+CMGS=\"+1234567890\"", "EMERGENCY", 5000, 60000, record, &sms);
+    }
+    if (sms.calls) done = millis();
+    delay(POLL_MS);
+  }
+  const AtStats& s = engine.stats();
+
+  printf("  %-10s %10s %12s %10s %8s\n", "", "done after", "loop held", "URCs lost", "SMS");
+  printf("  %-10s %7lu ms %9lu ms %10d %8s\n", "old", legacy.blockedMs, legacy.blockedMs, legacy.urcsLost,
+         legacy.smsSent ? "sent" : "failed");
+  printf("  %-10s %7lu ms %9lu ms %10d %8s\n", "engine", done, longestPollMs, 2 - (int)urcs.size(),
+         sms.status == AT_OK ? "sent" : "failed");
+  printf("  modem latency: %lu commands, mean %.1f ms, max %lu ms\n", (unsigned long)s.commands,
+         s.commands ? (double)s.latencyTotalMs / s.commands : 0.0, (unsigned long)s.latencyMaxMs);
+  check("engine keeps every URC", urcs.size() == 2);
+  check("engine sends the SMS", sms.status == AT_OK && done > 0 && done < legacy.blockedMs);
+}
+
+void runThroughput(unsigned long commands) {
+  simSetMillis(0);
+  ScriptedModem modem;
+  for (unsigned long i = 0; i < commands; i++) modem.expect("AT+CSQ", "\r\n+CSQ: 18,0\r\n\r\nOK\r\n", 0);
+  AtEngine engine(modem);
+  Outcome o;
+  uint64_t cpuNs = 0;
+  for (unsigned long i = 0; i < commands; i++) {
+    uint64_t start = benchNowNs();
+    engine.send("AT+CSQ", record, &o);
+    while (!engine.idle()) engine.poll();
+    cpuNs += benchNowNs() - start;
+  }
+  printf("throughput: %lu commands, %.0f ns/command, %.1f ns/byte received, %u bytes of engine state\n",
+         commands, (double)cpuNs / commands, (double)cpuNs / modem.bytesRead(), (unsigned)sizeof(AtEngine));
+  check("every command answered", engine.stats().ok == commands && modem.errors().empty());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  Serial.setEcho(false);
+  runScenarios();
+  runComparison();
+  runThroughput(quick ? 2000 : 200000);
+  return benchResult();
+}
@@ -0,0 +1,415 @@
+/*
+ * RescueNet AI - Store-and-forward backlog benchmark
+ *
+ * Runs the record log (record_log.h) on FileLogStorage, a file that
+ * behaves like NOR flash, and checks what it is for:
+ *
+ *   write cost  storage writes, bytes programmed per payload byte and
+ *               append time, for a sync after every record (what the
+ *               v5 logToSD() open/append/close amounts to) against
+ *               page-buffered writes; then erase counts per sector after
+ *               many passes of the ring
+ *   power cuts  writes stopped part way at random points, over and over
+ *               on the same log: after each reset every record must be
+ *               intact and in order, nothing synced and unacknowledged
+ *               may be missing and nothing durably acknowledged may come
+ *               back
+ *   outage      TelemetryUploader with the log behind it through a WiFi
+ *               outage, with and without a reset in the middle: every
+ *               reading reaches the server once and in order, in batches
+ *   monitor     an alert raised offline reaches the emergency URL once
+ *               the network is back
+ *
+ * Usage: backlog_bench [--quick]
+ */
+
+#include <Arduino.h>
+#include <health_monitor.h>
+#include <record_log.h>
+#include <telemetry_uploader.h>
+
+#include "../sim/heap_stats.h"
+#include "../sim/sim_hal.h"
+#include "../sim/sim_records.h"
+#include "bench_util.h"
+
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const LOG_PATH = "backlog_bench.log";
+const uint32_t SECTOR = 4096;
+const uint32_t SECTORS = 16;
+const unsigned long SAMPLE_MS = 5000;
+const unsigned long POLL_MS = 1000;
+const char* const URL = "/api/health-data";
+const char* const EMERGENCY_URL = "/api/emergency";
+
+// ---------------------------------------------------------------- Write cost
+
+struct WriteCost {
+  double writesPerRecord;
+  double amplification;
+  double appendNs;
+  uint64_t allocations;
+  LogStats stats;
+};
+
+WriteCost runWriteCost(bool syncEach, uint32_t records) {
+  FileLogStorage storage(LOG_PATH, SECTORS * SECTOR, SECTOR);
+  storage.remove();
+  storage.open();
+  RecordLog log(&storage);
+  log.begin();
+
+  uint8_t record[TELEMETRY_HEALTH_SIZE];
+  uint8_t replayed[TELEMETRY_HEALTH_SIZE];
+  uint64_t allocations = 0;
+  uint64_t appendNs = 0;
+  for (uint32_t i = 0; i < records; i++) {
+    encodeTelemetry(simReading(i), record, sizeof(record));
+    HeapStats before = heapStats();
+    uint64_t started = benchNowNs();
+    log.append(record, sizeof(record));
+    if (syncEach) log.sync();
+    appendNs += benchNowNs() - started;
+    // Delivered in batches of 12, as the uploader replays
+    if (log.pending() == 12) {
+      while (log.read(replayed, sizeof(replayed))) {}
+      log.commit();
+    }
+    allocations += heapStats().allocations - before.allocations;
+  }
+  log.sync();
+
+  WriteCost cost;
+  cost.stats = log.stats();
+  cost.writesPerRecord = (double)cost.stats.writes / records;
+  cost.amplification = log.writeAmplification();
+  cost.appendNs = (double)appendNs / records;
+  cost.allocations = allocations;
+
+  if (!syncEach) {
+    const std::vector<unsigned long>& erases = storage.eraseCounts();
+    unsigned long low = erases[0], high = erases[0];
+    for (size_t i = 1; i < erases.size(); i++) {
+      low = std::min(low, erases[i]);
+      high = std::max(high, erases[i]);
+    }
+    double passes = (double)storage.bytesWritten() / (SECTORS * SECTOR);
+    printf("  wear after %.1f passes of the ring: erases per sector %lu..%lu\n", passes, low, high);
+    check("erases spread evenly over the ring", high - low <= 1 && high <= (unsigned long)passes + 2);
+  }
+  storage.remove();
+  return cost;
+}
+
+void runWriteCosts(uint32_t records) {
+  printf("write cost: %lu health records of %d bytes, %lu x %lu byte sectors, %d byte pages\n",
+         (unsigned long)records, TELEMETRY_HEALTH_SIZE, (unsigned long)SECTORS, (unsigned long)SECTOR,
+         LOG_PAGE_SIZE);
+  WriteCost each = runWriteCost(true, records);
+  WriteCost paged = runWriteCost(false, records);
+  printf("  %-18s %14s %14s %12s %10s\n", "policy", "writes/record", "bytes/payload", "append ns", "erases");
+  printf("  %-18s %14.2f %14.2f %12.0f %10lu\n", "sync per record", each.writesPerRecord, each.amplification,
+         each.appendNs, (unsigned long)each.stats.erases);
+  printf("  %-18s %14.2f %14.2f %12.0f %10lu\n", "page buffered", paged.writesPerRecord, paged.amplification,
+         paged.appendNs, (unsigned long)paged.stats.erases);
+  // On an SD card every write() rewrites at least one 512 byte block
+  printf("  SD blocks rewritten per record: %.2f against %.2f\n", paged.writesPerRecord, each.writesPerRecord);
+  check("page buffering cuts storage writes 3x", paged.writesPerRecord * 3 < each.writesPerRecord);
+  check("every byte programmed once", paged.amplification < 1.3 && each.amplification < 1.3);
+  check("append, read and commit use no heap", paged.allocations == 0);
+  check("no records dropped", paged.stats.dropped == 0 && each.stats.dropped == 0);
+}
+
+// ---------------------------------------------------------------- Power cuts
+
+// Test record: its id, then a pattern derived from it
+size_t makeRecord(uint32_t id, uint8_t* out) {
+  size_t length = 20 + id * 7 % (TELEMETRY_MAX_SIZE - 20);
+  out[0] = (uint8_t)id;
+  out[1] = (uint8_t)(id >> 8);
+  out[2] = (uint8_t)(id >> 16);
+  out[3] = (uint8_t)(id >> 24);
+  for (size_t i = 4; i < length; i++) out[i] = (uint8_t)(id * 31 + i);
+  return length;
+}
+
+bool recordIntact(const uint8_t* data, size_t length, uint32_t& id) {
+  id = (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+  uint8_t expected[TELEMETRY_MAX_SIZE];
+  return length == makeRecord(id, expected) && memcmp(data, expected, length) == 0;
+}
+
+void runPowerCuts(int trials) {
+  FileLogStorage storage(LOG_PATH, SECTORS * SECTOR, SECTOR);
+  storage.remove();
+  storage.open();
+  srand(11);
+
+  // What the test knows from outside the log
+  uint32_t nextId = 1;
+  uint32_t committed = 0;     // Last id acknowledged, in RAM
+  uint32_t syncedId = 0;      // Last id appended before a sync() that completed
+  uint32_t durableAck = 0;    // Acknowledged before that sync()
+  int corrupt = 0, lost = 0, resurrected = 0, disordered = 0;
+  uint32_t recoveredTotal = 0;
+  std::vector<double> mountUs;
+
+  for (int trial = 0; trial < trials; trial++) {
+    RecordLog log(&storage);
+    uint64_t started = benchNowNs();
+    if (!log.begin()) {
+      check("log mounts after a power cut", false);
+      return;
+    }
+    mountUs.push_back((benchNowNs() - started) / 1000.0);
+
+    // Everything pending must be intact, in order and cover what was synced
+    uint8_t data[TELEMETRY_MAX_SIZE];
+    size_t length;
+    uint32_t first = 0, last = 0;
+    while ((length = log.read(data, sizeof(data))) > 0) {
+      uint32_t id;
+      if (!recordIntact(data, length, id)) {
+        corrupt++;
+        continue;
+      }
+      if (first == 0) first = id;
+      else if (id != last + 1) disordered++;
+      last = id;
+    }
+    log.rewind();
+    if (trial > 0) {
+      recoveredTotal += log.pending();
+      if (first == 0) {
+        if (syncedId > committed) lost++;
+      } else {
+        if (first > committed + 1 || last < syncedId) lost++;
+        if (first <= durableAck) resurrected++;
+      }
+    }
+    // The log's view is now the truth: ids go on from what survived
+    nextId = (first ? last : committed) + 1;
+    if (first) committed = first - 1;
+    syncedId = nextId - 1;
+    durableAck = committed;
+
+    storage.cutPowerAfter(storage.bytesWritten() + 64 + rand() % 6000);
+    while (!storage.powerLost()) {
+      int op = rand() % 12;
+      if (op < 7) {
+        size_t n = makeRecord(nextId, data);
+        if (!log.append(data, n)) break;
+        nextId++;
+      } else if (op < 9) {
+        // A replay batch that the server acknowledged
+        uint32_t id = committed;
+        for (int i = rand() % 8; i >= 0 && (length = log.read(data, sizeof(data))) > 0; i--) {
+          recordIntact(data, length, id);
+        }
+        log.commit();
+        committed = id;
+      } else if (op == 9) {
+        // One the server refused
+        for (int i = rand() % 4; i >= 0 && log.read(data, sizeof(data)) > 0; i--) {}
+        log.rewind();
+      } else if (log.sync() && !storage.powerLost()) {
+        syncedId = nextId - 1;
+        durableAck = committed;
+      }
+    }
+    storage.reopen();
+  }
+
+  printf("power cuts: %d resets, %lu unacknowledged records recovered, mount p50 %.0f us p99 %.0f us\n", trials,
+         (unsigned long)recoveredTotal, benchPercentile(mountUs, 50), benchPercentile(mountUs, 99));
+  check("no corrupt record returned", corrupt == 0, std::to_string(corrupt));
+  check("records come back in order", disordered == 0, std::to_string(disordered));
+  check("synced and unacknowledged records survive", lost == 0, std::to_string(lost));
+  check("durably acknowledged records stay gone", resurrected == 0, std::to_string(resurrected));
+  storage.remove();
+}
+
+// ---------------------------------------------------------------- Outage
+
+// The parts a reset wipes
+struct Device {
+  RecordLog log;
+  TelemetryUploader uploader;
+
+  Device(LogStorage* storage, HttpPort* http, bool withBacklog)
+    : log(storage), uploader(http, URL, UPLOAD_BINARY, 6, 30000) {
+    if (withBacklog && log.begin()) uploader.setBacklog(&log, EMERGENCY_URL);
+  }
+};
+
+struct OutageResult {
+  uint32_t taken;
+  uint32_t received;
+  uint32_t duplicates;
+  uint32_t outOfOrder;
+  unsigned long drainMs;
+  size_t replayRequests;
+  size_t largestBatch;
+};
+
+OutageResult runOutage(bool withBacklog, bool reset, unsigned long minutes, unsigned long outageMinutes) {
+  simSetMillis(0);
+  FileLogStorage storage(LOG_PATH, SECTORS * SECTOR, SECTOR);
+  storage.remove();
+  storage.open();
+  SimHttp http;
+  http.setLatencyMs(80);
+  Device* device = new Device(&storage, &http, withBacklog);
+
+  const unsigned long outageStart = 5 * 60000UL;
+  const unsigned long outageEnd = outageStart + outageMinutes * 60000UL;
+  const unsigned long end = minutes * 60000UL;
+  bool resetDone = false;
+  OutageResult r;
+  memset(&r, 0, sizeof(r));
+  unsigned long nextSample = SAMPLE_MS;
+  while (millis() < end) {
+    bool online = millis() < outageStart || millis() >= outageEnd;
+    http.setFailing(!online);
+    if (reset && !resetDone && millis() >= (outageStart + outageEnd) / 2) {
+      // RAM goes; the storage stays
+      delete device;
+      device = new Device(&storage, &http, withBacklog);
+      resetDone = true;
+    }
+    if (millis() >= nextSample) {
+      device->uploader.add(simReading(r.taken++));
+      nextSample += SAMPLE_MS;
+    }
+    device->uploader.poll(online);
+    if (withBacklog && online && millis() > outageEnd && r.drainMs == 0 && device->log.pending() == 0) {
+      r.drainMs = millis() - outageEnd;
+    }
+    delay(POLL_MS);
+  }
+  // Whatever the last batch holds
+  while (device->uploader.flush()) {}
+
+  // What the server took, in arrival order; posts while it was down failed
+  std::vector<bool> seen(r.taken, false);
+  int32_t previous = -1;
+  for (size_t i = 0; i < http.requests().size(); i++) {
+    const SimHttp::Request& request = http.requests()[i];
+    if (request.startedMs >= outageStart && request.startedMs < outageEnd) continue;
+    size_t records = request.body.size() / TELEMETRY_HEALTH_SIZE;
+    if (request.startedMs >= outageEnd && request.startedMs < outageEnd + r.drainMs) {
+      r.replayRequests++;
+      r.largestBatch = std::max(r.largestBatch, records);
+    }
+    for (size_t at = 0; at < records * TELEMETRY_HEALTH_SIZE; at += TELEMETRY_HEALTH_SIZE) {
+      TelemetryRecord rec;
+      char userId[TELEMETRY_USER_ID_MAX + 1];
+      char reason[TELEMETRY_REASON_MAX + 1];
+      if (!decodeTelemetry((const uint8_t*)request.body.data() + at, TELEMETRY_HEALTH_SIZE, rec, userId, reason) ||
+          rec.sequence >= r.taken) {
+        continue;
+      }
+      if (seen[rec.sequence]) r.duplicates++;
+      seen[rec.sequence] = true;
+      if ((int32_t)rec.sequence <= previous) r.outOfOrder++;
+      previous = rec.sequence;
+    }
+  }
+  for (uint32_t i = 0; i < r.taken; i++) r.received += seen[i] ? 1 : 0;
+  delete device;
+  storage.remove();
+  return r;
+}
+
+void runOutages(unsigned long minutes, unsigned long outageMinutes) {
+  printf("outage: a reading every %lu s for %lu min, WiFi down for %lu min from minute 5\n", SAMPLE_MS / 1000, minutes,
+         outageMinutes);
+  printf("  %-26s %8s %9s %6s %6s %10s %15s\n", "set-up", "readings", "received", "dup", "order", "drain s",
+         "replay requests");
+  OutageResult none = runOutage(false, false, minutes, outageMinutes);
+  OutageResult spool = runOutage(true, false, minutes, outageMinutes);
+  OutageResult resetRun = runOutage(true, true, minutes, outageMinutes);
+  const OutageResult* rows[] = {&none, &spool, &resetRun};
+  const char* names[] = {"RAM batch only (v4.1)", "backlog", "backlog, reset mid-outage"};
+  for (int i = 0; i < 3; i++) {
+    const OutageResult& r = *rows[i];
+    printf("  %-26s %8lu %9lu %6lu %6lu %10.0f %9lu of <=%lu\n", names[i], (unsigned long)r.taken,
+           (unsigned long)r.received, (unsigned long)r.duplicates, (unsigned long)r.outOfOrder, r.drainMs / 1000.0,
+           (unsigned long)r.replayRequests, (unsigned long)r.largestBatch);
+  }
+  check("RAM alone loses most of the outage", none.received + 100 < none.taken);
+  check("backlog delivers every reading once, in order",
+        spool.received == spool.taken && spool.duplicates == 0 && spool.outOfOrder == 0);
+  uint32_t backlogged = (uint32_t)(outageMinutes * 60000UL / SAMPLE_MS);
+  check("replay is batched", spool.replayRequests * (UPLOAD_BATCH_SAMPLES - 1) <= backlogged + UPLOAD_BATCH_SAMPLES &&
+        spool.largestBatch == UPLOAD_BATCH_SAMPLES);
+  // A reset loses RAM: the unposted batch and a page not yet synced
+  uint32_t bound = 6 + LOG_SYNC_MS / SAMPLE_MS + 1;
+  check("a reset loses at most RAM's share", resetRun.taken - resetRun.received <= bound &&
+        resetRun.duplicates == 0 && resetRun.outOfOrder == 0,
+        std::to_string(resetRun.taken - resetRun.received) + " lost");
+}
+
+// ---------------------------------------------------------------- Monitor
+
+void runMonitor() {
+  simSetMillis(0);
+  FileLogStorage storage(LOG_PATH, SECTORS * SECTOR, SECTOR);
+  storage.remove();
+  storage.open();
+  RecordLog backlog(&storage);
+  SimBoard board;
+  MonitorHal hal = {&board.ppg, &board.imu, &board.temp, &board.http, nullptr, nullptr, &board.display,
+                    nullptr, &backlog, nullptr, nullptr, nullptr};
+  MonitorConfig config = {"1234567890", URL, EMERGENCY_URL, "", 2, 5, 18, NO_PIN, 0, true, POWER_FIXED};
+  HealthMonitor monitor(hal, config);
+  monitor.begin();
+
+  monitor.setNetworkConnected(false);
+  unsigned long end = millis() + 2 * 60000UL;
+  while (millis() < end) monitor.loop();
+  monitor.triggerEmergency("Manual emergency button pressed");
+  end = millis() + 60000UL;
+  while (millis() < end) monitor.loop();
+  uint32_t stored = backlog.pending();
+  size_t before = board.http.requests().size();
+
+  monitor.setNetworkConnected(true);
+  end = millis() + 60000UL;
+  while (millis() < end) monitor.loop();
+
+  size_t alerts = 0, healthPosts = 0;
+  bool alertAfterReadings = false;
+  for (size_t i = before; i < board.http.requests().size(); i++) {
+    const SimHttp::Request& request = board.http.requests()[i];
+    if (request.url == EMERGENCY_URL) {
+      alerts++;
+      alertAfterReadings = healthPosts > 0;
+    } else {
+      healthPosts++;
+    }
+  }
+  printf("monitor: %lu records stored offline, then %lu alert and %lu reading posts; %lu pending\n",
+         (unsigned long)stored, (unsigned long)alerts, (unsigned long)healthPosts, (unsigned long)backlog.pending());
+  check("offline alert is stored", stored > 24 && before == 0);
+  check("alert replayed in its place", alerts == 1 && alertAfterReadings);
+  check("backlog drains", backlog.pending() == 0 && monitor.uploads().stats().dropped == 0);
+  storage.remove();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  Serial.setEcho(false);
+  runWriteCosts(quick ? 5000 : 40000);
+  runPowerCuts(quick ? 150 : 2000);
+  runOutages(quick ? 40 : 120, quick ? 20 : 60);
+  runMonitor();
+  return benchResult();
+}
@@ -0,0 +1,62 @@
+/*
+ * RescueNet AI - Helpers shared by the host benchmarks
+ */
+
+#ifndef HOST_BENCH_UTIL_H
+#define HOST_BENCH_UTIL_H
+
+#include <algorithm>
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+inline uint64_t benchNowNs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Nearest-rank percentile; sorts the samples in place
+template <typename T>
+T benchPercentile(std::vector<T>& samples, double percentile) {
+  if (samples.empty()) return T();
+  std::sort(samples.begin(), samples.end());
+  size_t rank = (size_t)(percentile / 100.0 * (double)(samples.size() - 1) + 0.5);
+  return samples[std::min(rank, samples.size() - 1)];
+}
+
+template <typename T>
+double benchMean(const std::vector<T>& samples) {
+  if (samples.empty()) return 0.0;
+  double total = 0;
+  for (size_t i = 0; i < samples.size(); i++) total += (double)samples[i];
+  return total / (double)samples.size();
+}
+
+// Checks failed so far; main() returns benchResult() for ctest
+inline int& benchFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+inline int benchResult() {
+  return benchFailures() == 0 ? 0 : 1;
+}
+
+// One line per checked property, with what was measured after it
+inline void check(const char* name, bool ok, const std::string& detail = "") {
+  printf("  %-48s %s%s%s\n", name, ok ? "ok" : "FAIL", detail.empty() ? "" : "  ", detail.c_str());
+  if (!ok) benchFailures()++;
+}
+
+// "--quick" shortens every run so the benchmarks fit in a regression pass
+inline bool benchQuick(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--quick") == 0) return true;
+  }
+  return false;
+}
+
+#endif
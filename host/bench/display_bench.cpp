@@ -0,0 +1,235 @@
+/*
+ * RescueNet AI - Status display benchmark
+ *
+ * Draws the monitor's dashboard frame after frame (heart rate and
+ * temperature drifting, WiFi and status changing now and then, an alert
+ * message every so often) on an OledRenderer over the simulated SSD1306
+ * and reports per frame:
+ *
+ *   - I2C bytes and transactions, and their time on a 400 kHz bus,
+ *     sending only the changed cells against resending the whole panel
+ *     (what the frame-buffer drivers did every update)
+ *   - CPU time to draw, diff and render a frame on this workstation
+ *   - the longest single transaction, i.e. the longest poll() holds up
+ *     the loop
+ *
+ * and checks that the panel's display RAM always matches a fresh
+ * full render of the same frame, that a panel which stops acknowledging
+ * costs one dropped frame and no more, and that HealthMonitor drives
+ * the renderer through its poll task.
+ *
+ * Usage: display_bench [--quick]
+ */
+
+#include <Arduino.h>
+#include <health_monitor.h>
+#include <oled_renderer.h>
+#include <text_format.h>
+
+#include "../sim/sim_hal.h"
+#include "bench_util.h"
+
+#include <string>
+
+namespace {
+
+// What HealthMonitor shows, frame by frame
+struct Screen {
+  bool message;
+  bool wifi;
+  bool emergency;
+  int heartRate;
+  float temperature;
+};
+
+// Same layout as HealthMonitor::updateDisplay() and displayMessage()
+void draw(TextDisplay& display, const Screen& s) {
+  display.clear();
+  if (s.message) {
+    display.drawText(0, 0, "Health Alert", 2);
+    display.drawText(0, 20, "Heart rate high", 1);
+    return;
+  }
+  display.drawText(0, 0, "RescueNet AI", 1);
+  display.drawText(85, 0, s.wifi ? "WiFi OK" : "No WiFi", 1);
+  TextBuffer<DISPLAY_LINE_MAX> line;
+  formatMessage(line, PSTR(DISPLAY_HEART_RATE_TEMPLATE), s.heartRate);
+  display.drawText(0, 16, line.c_str(), 2);
+  line.clear();
+  formatMessage(line, PSTR(DISPLAY_TEMPERATURE_TEMPLATE), s.temperature);
+  display.drawText(0, 32, line.c_str(), 2);
+  display.drawText(0, 48, s.emergency ? "Status: EMERGENCY" : "Status: Normal", 1);
+}
+
+std::vector<Screen> makeScreens(size_t count) {
+  std::vector<Screen> screens;
+  screens.reserve(count);
+  Screen s = {false, true, false, 72, 36.6f};
+  uint32_t state = 12345;
+  for (size_t i = 0; i < count; i++) {
+    state = state * 1103515245u + 12345u;
+    s.heartRate += (int)((state >> 16) % 5) - 2;
+    if (s.heartRate < 55) s.heartRate = 55;
+    if (s.heartRate > 110) s.heartRate = 110;
+    if (i % 15 == 0) s.temperature += ((state >> 8) & 1) ? 0.1f : -0.1f;
+    s.wifi = (i / 400) % 4 != 3;
+    s.emergency = i % 500 >= 480;
+    // An alert held for three frames every 150
+    s.message = i % 150 >= 147;
+    screens.push_back(s);
+  }
+  return screens;
+}
+
+// Draws, flushes and polls one frame out; returns the polls it took
+unsigned long showFrame(OledRenderer& renderer, const Screen& screen, bool full) {
+  draw(renderer, screen);
+  if (full) renderer.invalidate();
+  renderer.flush();
+  unsigned long polls = 1;
+  while (renderer.poll()) polls++;
+  return polls;
+}
+
+// A fresh panel and renderer with only this frame on it
+bool matchesFreshRender(const SimOledBus& panel, const Screen& screen) {
+  SimOledBus fresh;
+  OledRenderer reference(fresh);
+  reference.begin();
+  showFrame(reference, screen, false);
+  return memcmp(fresh.ram(), panel.ram(), 8 * 128) == 0;
+}
+
+struct RunResult {
+  double bytesPerFrame;
+  unsigned long bytesMax;
+  double transfersPerFrame;
+  double pollsPerFrame;
+  double busMsPerFrame;
+  double cpuUsPerFrame;
+  double cpuUsMax;
+  uint8_t largestTransaction;
+  bool matched;
+};
+
+RunResult runSequence(const std::vector<Screen>& screens, bool full) {
+  SimOledBus panel;
+  OledRenderer renderer(panel);
+  renderer.begin();
+  while (renderer.poll()) {
+  }
+  panel.resetCounters();
+
+  RunResult result = {};
+  result.matched = true;
+  unsigned long polls = 0;
+  std::vector<double> cpu;
+  cpu.reserve(screens.size());
+  for (size_t i = 0; i < screens.size(); i++) {
+    uint64_t start = benchNowNs();
+    polls += showFrame(renderer, screens[i], full);
+    cpu.push_back((benchNowNs() - start) / 1000.0);
+    if (renderer.stats().frameBytes > result.bytesMax) result.bytesMax = renderer.stats().frameBytes;
+    if (i % 25 == 0 && !matchesFreshRender(panel, screens[i])) result.matched = false;
+  }
+  double frames = (double)screens.size();
+  result.bytesPerFrame = panel.bytesSent() / frames;
+  result.transfersPerFrame = panel.transactions() / frames;
+  result.pollsPerFrame = polls / frames;
+  result.busMsPerFrame = panel.busUs() / 1000.0 / frames;
+  result.cpuUsPerFrame = benchMean(cpu);
+  result.cpuUsMax = benchPercentile(cpu, 100);
+  result.largestTransaction = panel.largestTransaction();
+  if (!matchesFreshRender(panel, screens.back())) result.matched = false;
+  return result;
+}
+
+void runFrames(size_t count) {
+  std::vector<Screen> screens = makeScreens(count);
+  RunResult full = runSequence(screens, true);
+  RunResult delta = runSequence(screens, false);
+
+  printf("frames: %zu dashboard updates, 400 kHz I2C\n", count);
+  printf("  %-22s %12s %10s %12s %10s %12s %12s %12s\n", "", "bytes/frame", "max", "transfers", "polls",
+         "bus ms", "cpu us", "cpu us max");
+  const char* labels[] = {"whole panel", "changed cells"};
+  const RunResult* results[] = {&full, &delta};
+  for (int k = 0; k < 2; k++) {
+    const RunResult& r = *results[k];
+    printf("  %-22s %12.1f %10lu %12.1f %10.1f %12.2f %12.2f %12.2f\n", labels[k], r.bytesPerFrame, r.bytesMax,
+           r.transfersPerFrame, r.pollsPerFrame, r.busMsPerFrame, r.cpuUsPerFrame, r.cpuUsMax);
+  }
+  double longestUs = (delta.largestTransaction + 2) * 9 * 1e6 / 400000;
+  printf("  longest transaction %u bytes + address and control, %.0f us on the bus\n",
+         delta.largestTransaction, longestUs);
+
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%.0f -> %.0f bytes", full.bytesPerFrame, delta.bytesPerFrame);
+  check("changed cells send under 1/5 of the panel", delta.bytesPerFrame * 5 < full.bytesPerFrame, detail);
+  check("panel matches a fresh render, whole panel", full.matched);
+  check("panel matches a fresh render, changed cells", delta.matched);
+  snprintf(detail, sizeof(detail), "%u bytes", delta.largestTransaction);
+  check("no transaction over OLED_CHUNK_BYTES", delta.largestTransaction <= OLED_CHUNK_BYTES, detail);
+}
+
+void runFailures() {
+  std::vector<Screen> screens = makeScreens(3);
+  SimOledBus panel;
+  OledRenderer renderer(panel);
+  renderer.begin();
+  showFrame(renderer, screens[0], false);
+
+  // The panel stops acknowledging in the middle of the next frame
+  draw(renderer, screens[1]);
+  renderer.flush();
+  renderer.poll();
+  panel.setFailing(true);
+  unsigned long polls = 0;
+  while (renderer.poll()) polls++;
+  panel.setFailing(false);
+  showFrame(renderer, screens[2], false);
+
+  printf("failures: panel gone for one frame\n");
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%u dropped after %lu polls", renderer.stats().dropped, polls);
+  check("one frame dropped, retries bounded", renderer.stats().dropped == 1 && polls < OLED_MAX_RETRIES, detail);
+  check("next frame repaints the whole panel", matchesFreshRender(panel, screens[2]));
+}
+
+void runMonitor() {
+  SimBoard board;
+  SimOledBus panel;
+  OledRenderer renderer(panel);
+  MonitorHal hal = {&board.ppg, &board.imu, &board.temp, &board.http, &board.channel, nullptr, &renderer,
+                    nullptr, nullptr, nullptr, nullptr, nullptr};
+  MonitorConfig config = {"1234567890", "http://host/api/health-data", "http://host/api/emergency", "+1234567890",
+                          2, 5, 18, 0, 3000, false, POWER_FIXED};
+  simSetMillis(0);
+  simSetPinInput(0, HIGH);
+  HealthMonitor monitor(hal, config);
+  renderer.begin();
+  monitor.begin();
+  monitor.setNetworkConnected(true);
+  monitor.displayMessage("System Ready", "Monitoring...");
+  while (millis() < 120000UL) monitor.loop();
+
+  const OledStats& stats = renderer.stats();
+  printf("monitor: 120 s of HealthMonitor::loop()\n");
+  printf("  %lu frames, %.1f bytes and %.1f transactions per frame\n", (unsigned long)stats.frames,
+         stats.frames ? (double)stats.bytesTotal / stats.frames : 0.0,
+         stats.frames ? (double)stats.transfersTotal / stats.frames : 0.0);
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%lu frames", (unsigned long)stats.frames);
+  check("poll task puts every frame on the panel", stats.frames >= 55 && !renderer.busy(), detail);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  Serial.setEcho(false);
+  runFrames(quick ? 1000 : 10000);
+  runFailures();
+  runMonitor();
+  return benchResult();
+}
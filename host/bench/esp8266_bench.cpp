@@ -0,0 +1,294 @@
+/*
+ * RescueNet AI - ESP8266 HTTP transport benchmark
+ *
+ * Posts health readings every 30 s through a simulated ESP-01 on a
+ * 9600 baud SoftwareSerial link, three ways:
+ *
+ *   old        the previous Esp8266Http::post: String request, CIPSTART,
+ *              CIPSEND, CIPCLOSE per post, each followed by a fixed delay
+ *   reconnect  Esp8266Http against a server that drops idle connections
+ *              after 5 s (Node's default), so every post opens one
+ *   keep-alive Esp8266Http against a server keeping them for 65 s
+ *
+ * For each: time spent inside post(), AT commands and serial bytes per
+ * post, HTTP bytes/s, TCP connects and heap allocations per post. Then a
+ * large body split over several CIPSEND segments, and a link that breaks
+ * under every fifth post, which must still all arrive. Last, the same
+ * posts in steps (startPost(), then pollPost() every 10 ms as the upload
+ * task does): the longest step must stay well inside the 320 ms the
+ * PPG's 32-sample FIFO holds at 100 samples/s, which a whole post at
+ * 9600 baud does not.
+ *
+ * Usage: esp8266_bench [--quick]
+ */
+
+#include <Arduino.h>
+#include <esp8266_http.h>
+
+#include "../sim/heap_stats.h"
+#include "../sim/sim_hal.h"
+#include "bench_util.h"
+
+#include <string>
+
+namespace {
+
+const unsigned long UPLOAD_PERIOD_MS = 30000;
+const char* const SERVER_IP = "192.168.1.100";
+const char* const SERVER_PORT = "3000";
+const char* const URL = "/api/health-data";
+const char* const CONTENT_TYPE = "application/json";
+const unsigned long STEP_PERIOD_MS = 10;
+const unsigned long PPG_FIFO_MS = 320;
+const char* const BODY =
+  "{\"deviceId\":\"RESCUENET_NANO_001\",\"timestamp\":1234567,\"heartRate\":72.0,"
+  "\"spO2\":98.0,\"bodyTemperature\":36.6,\"ambientTemperature\":24.1,"
+  "\"accelX\":0.01,\"accelY\":-0.02,\"accelZ\":0.98,\"fallDetected\":false,"
+  "\"batteryLevel\":87.0,\"emergencyActive\":false}";
+
+// The transport as it was before keep-alive, kept here for comparison
+class LegacyEsp8266Http : public HttpPort {
+public:
+  LegacyEsp8266Http(SerialPort& port) : port(port) {}
+
+  int post(const char* url, const char* contentType, const char* body, size_t length) override {
+    String startCmd = "AT+CIPSTART=\"TCP\",\"" + String(SERVER_IP) + "\"," + String(SERVER_PORT);
+    port.println(startCmd);
+    delay(2000);
+    if (!find("OK")) return -1;
+
+    String httpRequest = "POST " + String(url) + " HTTP/1.1\r\n";
+    httpRequest += "Host: " + String(SERVER_IP) + ":" + String(SERVER_PORT) + "\r\n";
+    httpRequest += "Content-Type: " + String(contentType) + "\r\n";
+    httpRequest += "Content-Length: " + String((unsigned long)length) + "\r\n";
+    httpRequest += "Connection: close\r\n\r\n";
+    httpRequest += body;
+
+    String sendCmd = "AT+CIPSEND=" + String(httpRequest.length());
+    port.println(sendCmd);
+    delay(1000);
+
+    int status = -1;
+    if (find(">")) {
+      port.print(httpRequest);
+      delay(2000);
+      if (find("OK")) status = 200;
+    }
+
+    port.println("AT+CIPCLOSE");
+    delay(1000);
+    return status;
+  }
+
+private:
+  bool find(const char* token, unsigned long timeoutMs = 1000) {
+    size_t matched = 0;
+    size_t tokenLength = strlen(token);
+    unsigned long start = millis();
+    while (millis() - start < timeoutMs) {
+      if (!port.available()) {
+        delay(1);
+        continue;
+      }
+      char c = (char)port.read();
+      if (c == token[matched]) {
+        if (++matched == tokenLength) return true;
+      } else {
+        matched = (c == token[0]) ? 1 : 0;
+      }
+    }
+    return false;
+  }
+
+  SerialPort& port;
+};
+
+struct RunResult {
+  int posts;
+  int ok;
+  double msPerPost;
+  unsigned long msMax;
+  double commandsPerPost;
+  double serialBytesPerPost;
+  double bytesPerSecond;
+  unsigned long connects;
+  double allocationsPerPost;
+  size_t delivered;
+};
+
+// Posts every UPLOAD_PERIOD_MS; only the time inside post() is counted
+RunResult runPosts(HttpPort& http, SimEsp8266& module, int posts, const char* body) {
+  RunResult r = {posts, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  size_t length = strlen(body);
+  unsigned long commandsBefore = module.commandCount();
+  unsigned long long bytesBefore = module.bytesFromHost();
+  unsigned long connectsBefore = module.connects();
+  size_t requestsBefore = module.requests().size();
+  uint64_t allocations = 0;
+  unsigned long busyMs = 0;
+  for (int i = 0; i < posts; i++) {
+    delay(UPLOAD_PERIOD_MS);
+    unsigned long start = millis();
+    HeapStats before = heapStats();
+    int status = http.post(URL, CONTENT_TYPE, body, length);
+    allocations += heapStats().allocations - before.allocations;
+    unsigned long elapsed = millis() - start;
+    busyMs += elapsed;
+    if (elapsed > r.msMax) r.msMax = elapsed;
+    if (status == 200) r.ok++;
+  }
+  r.delivered = module.requests().size() - requestsBefore;
+  r.msPerPost = (double)busyMs / posts;
+  r.commandsPerPost = (double)(module.commandCount() - commandsBefore) / posts;
+  r.serialBytesPerPost = (double)(module.bytesFromHost() - bytesBefore) / posts;
+  r.bytesPerSecond = busyMs ? (double)length * posts * 1000.0 / busyMs : 0;
+  r.connects = module.connects() - connectsBefore;
+  r.allocationsPerPost = (double)allocations / posts;
+  return r;
+}
+
+void printRow(const char* name, const RunResult& r) {
+  printf("  %-11s %4d/%-4d %8.0f %7lu %8.1f %9.0f %9.0f %8lu %8.1f\n", name, r.ok, r.posts, r.msPerPost, r.msMax,
+         r.commandsPerPost, r.serialBytesPerPost, r.bytesPerSecond, r.connects, r.allocationsPerPost);
+}
+
+void runComparison(int posts) {
+  printf("comparison: %d posts of %u bytes, %lu s apart, 9600 baud\n", posts, (unsigned)strlen(BODY),
+         UPLOAD_PERIOD_MS / 1000);
+  printf("  %-11s %9s %8s %7s %8s %9s %9s %8s %8s\n", "transport", "ok", "ms/post", "max", "AT/post", "tx B/post",
+         "body B/s", "connects", "allocs");
+
+  simSetMillis(0);
+  SimEsp8266 oldModule;
+  oldModule.setKeepAliveMs(65000);
+  LegacyEsp8266Http legacy(oldModule);
+  RunResult old = runPosts(legacy, oldModule, posts, BODY);
+  printRow("old", old);
+
+  simSetMillis(0);
+  SimEsp8266 shortModule;
+  Esp8266Http shortHttp(shortModule, SERVER_IP, SERVER_PORT);
+  RunResult reconnect = runPosts(shortHttp, shortModule, posts, BODY);
+  printRow("reconnect", reconnect);
+
+  simSetMillis(0);
+  SimEsp8266 module;
+  module.setKeepAliveMs(65000);
+  Esp8266Http http(module, SERVER_IP, SERVER_PORT);
+  RunResult kept = runPosts(http, module, posts, BODY);
+  printRow("keep-alive", kept);
+  printf("  driver: %lu bytes/s, last post %lu ms in %u AT commands\n", (unsigned long)http.bytesPerSecond(),
+         (unsigned long)http.stats().lastRequestMs, (unsigned)http.stats().lastAtCommands);
+
+  check("old transport delivers", old.delivered == (size_t)posts);
+  check("every reconnecting post succeeds", reconnect.ok == posts && reconnect.delivered == (size_t)posts);
+  check("every kept-alive post succeeds", kept.ok == posts && kept.delivered == (size_t)posts);
+  check("one TCP connection when kept alive", kept.connects == 1);
+  check("body arrives intact", module.lastBody() == BODY);
+  check("no heap allocations per post", reconnect.allocationsPerPost == 0 && kept.allocationsPerPost == 0);
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%.0f ms vs %.0f ms", kept.msPerPost, old.msPerPost);
+  check("kept-alive post faster than old", kept.msPerPost * 10 < old.msPerPost, detail);
+  check("reconnecting post faster than old", reconnect.msPerPost * 5 < old.msPerPost);
+}
+
+void runLargeBody() {
+  simSetMillis(0);
+  SimEsp8266 module;
+  module.setBaud(115200);
+  Esp8266Http http(module, SERVER_IP, SERVER_PORT);
+  std::string batch = "[";
+  while (batch.size() < 3000) {
+    if (batch.size() > 1) batch += ",";
+    batch += BODY;
+  }
+  batch += "]";
+  RunResult r = runPosts(http, module, 4, batch.c_str());
+  printf("large body: %u bytes at 115200 baud, %.0f ms/post, %.1f AT/post, %.0f bytes/s\n", (unsigned)batch.size(),
+         r.msPerPost, r.commandsPerPost, r.bytesPerSecond);
+  unsigned segments = (unsigned)((batch.size() + 200) / ESP8266_SEND_CHUNK + 1);
+  check("large body delivered", r.ok == 4 && module.lastBody() == batch);
+  check("split into CIPSEND segments", r.commandsPerPost >= segments && r.commandsPerPost <= segments + 1);
+  check("no heap allocations per post", r.allocationsPerPost == 0);
+}
+
+void runBrokenLink(int posts) {
+  simSetMillis(0);
+  SimEsp8266 module;
+  module.setKeepAliveMs(65000);
+  Esp8266Http http(module, SERVER_IP, SERVER_PORT);
+  RunResult r = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  for (int i = 0; i < posts; i += 5) {
+    module.failSends(1);
+    RunResult part = runPosts(http, module, 5, BODY);
+    r.ok += part.ok;
+    r.delivered += part.delivered;
+    if (part.msMax > r.msMax) r.msMax = part.msMax;
+  }
+  const Esp8266Stats& stats = http.stats();
+  printf("broken link: %lu posts, %lu reconnects, %lu connects, worst post %lu ms\n", (unsigned long)stats.requests,
+         (unsigned long)stats.reconnects, (unsigned long)stats.connects, r.msMax);
+  check("every post survives the broken link", r.ok == posts && r.delivered == (size_t)posts);
+  check("one reconnect per break", stats.reconnects == (uint32_t)(posts / 5) && stats.failures == 0);
+}
+
+// Posts every UPLOAD_PERIOD_MS in steps; msMax is the longest call
+RunResult runStepped(Esp8266Http& http, SimEsp8266& module, int posts) {
+  RunResult r = {posts, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  size_t length = strlen(BODY);
+  size_t requestsBefore = module.requests().size();
+  unsigned long postMs = 0;
+  for (int i = 0; i < posts; i++) {
+    delay(UPLOAD_PERIOD_MS);
+    unsigned long started = millis();
+    int status = http.startPost(URL, CONTENT_TYPE, BODY, length);
+    unsigned long elapsed = millis() - started;
+    if (elapsed > r.msMax) r.msMax = elapsed;
+    while (status == HTTP_PENDING) {
+      delay(STEP_PERIOD_MS);
+      unsigned long start = millis();
+      status = http.pollPost();
+      elapsed = millis() - start;
+      if (elapsed > r.msMax) r.msMax = elapsed;
+    }
+    postMs += millis() - started;
+    if (status == 200) r.ok++;
+  }
+  r.delivered = module.requests().size() - requestsBefore;
+  r.msPerPost = (double)postMs / posts;
+  return r;
+}
+
+void runStepped(int posts) {
+  simSetMillis(0);
+  SimEsp8266 blockingModule;
+  Esp8266Http blocking(blockingModule, SERVER_IP, SERVER_PORT);
+  RunResult whole = runPosts(blocking, blockingModule, posts, BODY);
+
+  simSetMillis(0);
+  SimEsp8266 module;
+  Esp8266Http http(module, SERVER_IP, SERVER_PORT);
+  RunResult stepped = runStepped(http, module, posts);
+  printf("stepped: %d reconnecting posts at 9600 baud, %.0f ms start to status, longest step %lu ms "
+         "(driver %u ms), whole post blocks %lu ms\n", posts, stepped.msPerPost, stepped.msMax,
+         (unsigned)http.stats().stepMsMax, whole.msMax);
+  check("every stepped post succeeds", stepped.ok == posts && stepped.delivered == (size_t)posts);
+  check("stepped body arrives intact", module.lastBody() == BODY);
+  check("driver times its steps", http.stats().stepMsMax == stepped.msMax);
+  check("a whole post outlasts the PPG FIFO", whole.msMax > PPG_FIFO_MS);
+  char detail[32];
+  snprintf(detail, sizeof(detail), "%lu ms", stepped.msMax);
+  check("longest step under a quarter of the FIFO", stepped.msMax * 4 < PPG_FIFO_MS, detail);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  Serial.setEcho(false);
+  runComparison(quick ? 20 : 200);
+  runLargeBody();
+  runBrokenLink(quick ? 20 : 200);
+  runStepped(quick ? 20 : 200);
+  return benchResult();
+}
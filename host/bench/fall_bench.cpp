@@ -0,0 +1,177 @@
+/*
+ * RescueNet AI - Fall detection benchmark
+ *
+ * Replays labeled IMU traces through FallDetector at 100 Hz and reports,
+ * per trace type, how many falls were caught and how long after the
+ * impact, and how many everyday activities raised a false alarm. The
+ * same traces are scored against the old rule (one sample every 5 s,
+ * |a| > 15 m/s^2) at five loop phases.
+ *
+ * Traces are the synthetic set from host/sim/motion_traces plus any CSV
+ * files given on the command line: one "ax,ay,az,gx,gy,gz" line per
+ * sample in raw counts at +-8 g / +-500 deg/s, 100 Hz, with a
+ * "# fall=<impact sample>" or "# fall=none" header line.
+ *
+ * Usage: fall_bench [--quick] [trace.csv ...]
+ */
+
+#include <Arduino.h>
+#include <fall_detector.h>
+
+#include "../sim/motion_traces.h"
+#include "bench_util.h"
+
+#include <map>
+
+namespace {
+
+const uint16_t RATE_HZ = 100;
+// A fall counts as caught when confirmed within this long after the impact
+const size_t DETECT_WINDOW_SAMPLES = 10 * RATE_HZ;
+// Old loop: one reading every 5 s against FALL_THRESHOLD (15 m/s^2)
+const size_t LEGACY_PERIOD_SAMPLES = 5 * RATE_HZ;
+const float LEGACY_THRESHOLD_G = 15.0f / 9.80665f;
+
+bool load(const char* path, MotionTrace& trace) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  trace.label = path;
+  trace.fall = false;
+  trace.impactIndex = 0;
+  trace.samples.clear();
+  char line[128];
+  bool labeled = false;
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#') {
+      unsigned long impact;
+      if (strstr(line, "fall=none")) {
+        labeled = true;
+      } else if (sscanf(line, "# fall=%lu", &impact) == 1) {
+        trace.fall = true;
+        trace.impactIndex = impact;
+        labeled = true;
+      }
+      continue;
+    }
+    int v[6];
+    if (sscanf(line, "%d,%d,%d,%d,%d,%d", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) != 6) continue;
+    ImuSample s = {(int16_t)v[0], (int16_t)v[1], (int16_t)v[2], (int16_t)v[3], (int16_t)v[4], (int16_t)v[5]};
+    trace.samples.push_back(s);
+  }
+  fclose(f);
+  return labeled && !trace.samples.empty();
+}
+
+struct Outcome {
+  std::vector<size_t> detections;  // Samples where a fall was confirmed
+  int legacyHits;                  // Loop phases (of 5) where the old rule fired
+};
+
+Outcome replay(const MotionTrace& trace, uint64_t& cpuNs) {
+  Outcome outcome;
+  FallDetector detector(RATE_HZ);
+  uint64_t start = benchNowNs();
+  for (size_t i = 0; i < trace.samples.size(); i++) {
+    if (detector.addSample(trace.samples[i])) outcome.detections.push_back(i);
+  }
+  cpuNs += benchNowNs() - start;
+
+  outcome.legacyHits = 0;
+  const float limit = LEGACY_THRESHOLD_G * IMU_ACCEL_LSB_PER_G;
+  for (int phase = 0; phase < 5; phase++) {
+    for (size_t i = (size_t)phase * RATE_HZ; i < trace.samples.size(); i += LEGACY_PERIOD_SAMPLES) {
+      const ImuSample& s = trace.samples[i];
+      float magnitude = sqrtf((float)s.ax * s.ax + (float)s.ay * s.ay + (float)s.az * s.az);
+      if (magnitude > limit) {
+        outcome.legacyHits++;
+        break;
+      }
+    }
+  }
+  return outcome;
+}
+
+struct Tally {
+  int traces = 0;
+  int detected = 0;        // Falls caught / activities that alarmed
+  int legacyHits = 0;      // Out of traces * 5 phases
+  std::vector<long> latencyMs;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  std::vector<MotionTrace> traces = makeMotionTraces(RATE_HZ, quick ? 4 : 25);
+  for (int i = 1; i < argc; i++) {
+    if (argv[i][0] == '-') continue;
+    MotionTrace trace;
+    if (!load(argv[i], trace)) {
+      fprintf(stderr, "cannot read %s\n", argv[i]);
+      return 2;
+    }
+    traces.push_back(trace);
+  }
+
+  std::map<std::string, Tally> byLabel;
+  std::vector<std::string> order;
+  uint64_t cpuNs = 0;
+  size_t totalSamples = 0;
+  size_t adlSamples = 0;
+  int falls = 0, caught = 0, adls = 0, falseAlarms = 0;
+  int legacyFallHits = 0, legacyAdlHits = 0;
+
+  for (size_t t = 0; t < traces.size(); t++) {
+    const MotionTrace& trace = traces[t];
+    Outcome outcome = replay(trace, cpuNs);
+    totalSamples += trace.samples.size();
+
+    if (!byLabel.count(trace.label)) order.push_back(trace.label);
+    Tally& tally = byLabel[trace.label];
+    tally.traces++;
+    tally.legacyHits += outcome.legacyHits;
+
+    if (trace.fall) {
+      falls++;
+      legacyFallHits += outcome.legacyHits;
+      for (size_t d = 0; d < outcome.detections.size(); d++) {
+        size_t at = outcome.detections[d];
+        if (at >= trace.impactIndex && at - trace.impactIndex <= DETECT_WINDOW_SAMPLES) {
+          caught++;
+          tally.detected++;
+          tally.latencyMs.push_back((long)((at - trace.impactIndex) * 1000 / RATE_HZ));
+          break;
+        }
+      }
+    } else {
+      adls++;
+      adlSamples += trace.samples.size();
+      legacyAdlHits += outcome.legacyHits;
+      falseAlarms += (int)outcome.detections.size();
+      if (!outcome.detections.empty()) tally.detected++;
+    }
+  }
+
+  printf("%-20s %6s %9s %18s %14s\n", "trace", "count", "detected", "latency mean/max", "old rule");
+  for (size_t i = 0; i < order.size(); i++) {
+    Tally& tally = byLabel[order[i]];
+    char latency[32] = "-";
+    if (!tally.latencyMs.empty()) {
+      snprintf(latency, sizeof(latency), "%.0f / %ld ms", benchMean(tally.latencyMs),
+               benchPercentile(tally.latencyMs, 100));
+    }
+    printf("%-20s %6d %9d %18s %8.0f %%\n", order[i].c_str(), tally.traces, tally.detected, latency,
+           100.0 * tally.legacyHits / (tally.traces * 5));
+  }
+
+  double adlHours = (double)adlSamples / RATE_HZ / 3600.0;
+  printf("falls:      %d/%d detected (%.0f %%), old rule %.0f %%\n", caught, falls,
+         falls ? 100.0 * caught / falls : 0.0, falls ? 100.0 * legacyFallHits / (falls * 5) : 0.0);
+  printf("activities: %d false alarms in %d traces (%.1f /h), old rule fired in %.0f %%\n", falseAlarms,
+         adls, adlHours > 0 ? falseAlarms / adlHours : 0.0, adls ? 100.0 * legacyAdlHits / (adls * 5) : 0.0);
+  printf("cost:       %.1f ns/sample, %u bytes of detector state\n",
+         totalSamples ? (double)cpuNs / totalSamples : 0.0, (unsigned)sizeof(FallDetector));
+
+  // Every synthetic fall must be caught and no activity may alarm
+  return (caught == falls && falseAlarms == 0) ? 0 : 1;
+}
@@ -0,0 +1,323 @@
+/*
+ * RescueNet AI - Motion-aware heart rate fusion benchmark
+ *
+ * Straps the simulated MAX3010x to the simulated MPU6050: every step
+ * shows up in the IR counts (SimPpgSensor::setMotionCoupling) while the
+ * heart rate follows its own schedule. A session of rest, walking, rest,
+ * running and recovery runs through PpgAcquisition + MotionAcquisition
+ * at 100 Hz, once with the beat detector alone (what detectEmergency()
+ * got before) and once with HeartRateFusion attached, and reports:
+ *
+ *   accuracy   per phase, once a second: mean absolute error against the
+ *              true rate, readings off by more than 20 BPM, the mean
+ *              confidence, and the wrong readings alerting would have
+ *              acted on (off by more than 20 BPM at a confidence of at
+ *              least HR_ALERT_MIN_CONFIDENCE; the detector alone has no
+ *              confidence, so every rate it has counts)
+ *   cost       ns per PPG sample for the detector alone and with the
+ *              canceller and tracker in front of it, the same per IMU
+ *              sample for the reference, the heap they use (none) and
+ *              the RAM of one HeartRateFusion against its budget; the
+ *              Nano cycle count is measured on the board with
+ *              examples/HeartRateFusionCycles
+ *
+ * Usage: fusion_bench [--quick]
+ */
+
+#include <Arduino.h>
+#include <health_monitor.h>
+#include <heart_rate_fusion.h>
+#include <motion_acquisition.h>
+#include <ppg_acquisition.h>
+
+#include "../sim/heap_stats.h"
+#include "../sim/motion_traces.h"
+#include "../sim/sim_hal.h"
+#include "bench_util.h"
+
+#include <math.h>
+#include <string>
+
+namespace {
+
+const uint16_t RATE_HZ = 100;
+const unsigned long DRAIN_MS = 20;
+// IR counts per g of motion: a walking step moves the reading about as
+// much as the pulse, a running stride several times more
+const float COUPLING_PER_G = 3000.0f;
+const float SPIKE_BPM = 20.0f;
+
+struct Phase {
+  const char* label;
+  unsigned long seconds;
+  float heartRate;  // Stepped towards over the phase, see rateAt()
+  bool moving;
+};
+
+// Rest, a walk, rest, a run, recovery
+const Phase PHASES[] = {
+  {"rest", 90, 70, false},
+  {"walk", 120, 96, true},
+  {"rest after walk", 60, 76, false},
+  {"run", 180, 142, true},
+  {"recovery", 120, 88, false},
+};
+const size_t PHASE_COUNT = sizeof(PHASES) / sizeof(PHASES[0]);
+
+struct Session {
+  std::vector<ImuSample> motion;
+  unsigned long phaseStartMs[PHASE_COUNT + 1];
+};
+
+Session makeSession(uint32_t seed, unsigned long scale) {
+  Session session;
+  MotionTraceBuilder builder(RATE_HZ, seed);
+  unsigned long at = 0;
+  for (size_t p = 0; p < PHASE_COUNT; p++) {
+    session.phaseStartMs[p] = at;
+    unsigned long ms = PHASES[p].seconds * 1000UL / scale;
+    if (!PHASES[p].moving) {
+      builder.still(ms);
+    } else if (PHASES[p].heartRate > 120) {
+      builder.run(ms);
+    } else {
+      builder.walk(ms);
+    }
+    at += ms;
+  }
+  session.phaseStartMs[PHASE_COUNT] = at;
+  session.motion = builder.samples();
+  return session;
+}
+
+// True rate: from the last phase's to this one's in 10 s steps over the
+// first half of the phase, as the simulated pulse restarts its phase on
+// every change
+float rateAt(const Session& session, unsigned long ms, size_t& phase) {
+  phase = 0;
+  while (phase + 1 < PHASE_COUNT && ms >= session.phaseStartMs[phase + 1]) phase++;
+  float from = phase ? PHASES[phase - 1].heartRate : PHASES[0].heartRate;
+  float to = PHASES[phase].heartRate;
+  unsigned long length = session.phaseStartMs[phase + 1] - session.phaseStartMs[phase];
+  unsigned long into = ms - session.phaseStartMs[phase];
+  unsigned long steps = length / 2 / 10000UL;
+  if (steps == 0) return to;
+  unsigned long step = into / 10000UL;
+  if (step >= steps) return to;
+  return from + (to - from) * (float)(step + 1) / (float)steps;
+}
+
+struct PhaseScore {
+  double absError = 0;
+  unsigned readings = 0;  // With a rate
+  unsigned seconds = 0;
+  unsigned spikes = 0;
+  unsigned acted = 0;     // Spikes confident enough to alert on
+  double confidence = 0;
+};
+
+struct SessionScore {
+  PhaseScore phases[PHASE_COUNT];
+  uint32_t rejected = 0;
+};
+
+void runSession(const Session& session, bool fused, SessionScore& score) {
+  simSetMillis(0);
+  SimPpgSensor ppgSensor;
+  SimImuSensor imuSensor;
+  ppgSensor.setMotionCoupling(&imuSensor, COUPLING_PER_G);
+  PpgAcquisition ppg(&ppgSensor);
+  MotionAcquisition motion(&imuSensor);
+  HeartRateFusion fusion;
+  if (fused) {
+    ppg.setFusion(&fusion);
+    motion.setFusion(&fusion);
+  }
+  motion.begin(RATE_HZ);
+  ppg.begin(RATE_HZ * 4, 4);
+  imuSensor.play(session.motion, 0);
+
+  unsigned long end = session.phaseStartMs[PHASE_COUNT];
+  unsigned long nextReading = 1000;
+  float truth = 0;
+  while (millis() < end) {
+    delay(DRAIN_MS);
+    size_t phase;
+    float rate = rateAt(session, millis(), phase);
+    if (rate != truth) {
+      truth = rate;
+      ppgSensor.setHeartRate(truth);
+    }
+    motion.poll();
+    motion.process();
+    ppg.poll();
+    ppg.process();
+
+    if (millis() < nextReading) continue;
+    nextReading += 1000;
+    PhaseScore& s = score.phases[phase];
+    s.seconds++;
+    float reading = ppg.heartRate();
+    uint8_t confidence = ppg.heartRateConfidence();
+    s.confidence += confidence;
+    if (reading <= 0) continue;
+    float error = fabsf(reading - truth);
+    s.readings++;
+    s.absError += error;
+    if (error > SPIKE_BPM) {
+      s.spikes++;
+      if (confidence >= HR_ALERT_MIN_CONFIDENCE) s.acted++;
+    }
+  }
+  score.rejected = fusion.beatsRejected();
+}
+
+double mae(const PhaseScore& s) {
+  return s.readings ? s.absError / s.readings : 0.0;
+}
+
+void add(PhaseScore& total, const PhaseScore& s) {
+  total.absError += s.absError;
+  total.readings += s.readings;
+  total.seconds += s.seconds;
+  total.spikes += s.spikes;
+  total.acted += s.acted;
+  total.confidence += s.confidence;
+}
+
+void runAccuracy(int sessions, unsigned long scale) {
+  SessionScore raw[8];
+  SessionScore fused[8];
+  uint32_t rejected = 0;
+  for (int i = 0; i < sessions; i++) {
+    Session session = makeSession(100 + i * 31, scale);
+    runSession(session, false, raw[i]);
+    runSession(session, true, fused[i]);
+    rejected += fused[i].rejected;
+  }
+
+  printf("accuracy: %d sessions, once a second: MAE BPM, readings off > %.0f BPM, acted on, mean confidence\n",
+         sessions, SPIKE_BPM);
+  printf("  %-16s %-32s %-32s\n", "phase", "detector alone", "fused");
+  PhaseScore rawRest, fusedRest, rawMoving, fusedMoving;
+  for (size_t p = 0; p < PHASE_COUNT; p++) {
+    PhaseScore r, f;
+    for (int i = 0; i < sessions; i++) {
+      add(r, raw[i].phases[p]);
+      add(f, fused[i].phases[p]);
+    }
+    char left[48], right[48];
+    snprintf(left, sizeof(left), "%5.1f  %4u  %4u", mae(r), r.spikes, r.acted);
+    snprintf(right, sizeof(right), "%5.1f  %4u  %4u  %3.0f %%", mae(f), f.spikes, f.acted,
+             f.seconds ? f.confidence / f.seconds : 0.0);
+    printf("  %-16s %-32s %-32s\n", PHASES[p].label, left, right);
+    add(PHASES[p].moving ? rawMoving : rawRest, r);
+    add(PHASES[p].moving ? fusedMoving : fusedRest, f);
+  }
+  printf("  beats the tracker rejected: %lu\n", (unsigned long)rejected);
+
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%.1f -> %.1f BPM", mae(rawMoving), mae(fusedMoving));
+  check("error while moving below the detector's", mae(fusedMoving) < mae(rawMoving) / 2, detail);
+  snprintf(detail, sizeof(detail), "%u -> %u", rawMoving.acted + rawRest.acted, fusedMoving.acted + fusedRest.acted);
+  check("wrong readings reaching alerting cut", fusedMoving.acted + fusedRest.acted <= (rawMoving.acted + rawRest.acted) / 10,
+        detail);
+  snprintf(detail, sizeof(detail), "%.1f -> %.1f BPM", mae(rawRest), mae(fusedRest));
+  check("error at rest no worse", mae(fusedRest) <= mae(rawRest) + 0.5, detail);
+  double restConfidence = fusedRest.seconds ? fusedRest.confidence / fusedRest.seconds : 0.0;
+  snprintf(detail, sizeof(detail), "%.0f %%", restConfidence);
+  check("confident at rest", restConfidence >= 80, detail);
+}
+
+// ---------------------------------------------------------------- cost
+
+struct CostRun {
+  const std::vector<PpgSample>* ppg;
+  const std::vector<ImuSample>* imu;
+  int passes;
+  uint64_t detectorNs;
+  uint64_t fusedNs;
+  uint64_t motionNs;
+  uint64_t beats;
+};
+
+void measureCost(void* arg) {
+  CostRun* run = (CostRun*)arg;
+  const std::vector<PpgSample>& ppg = *run->ppg;
+  const std::vector<ImuSample>& imu = *run->imu;
+  for (int pass = 0; pass < run->passes; pass++) {
+    PulseDetector alone(RATE_HZ);
+    uint64_t start = benchNowNs();
+    for (size_t i = 0; i < ppg.size(); i++) run->beats += alone.addSample((int32_t)ppg[i].ir);
+    run->detectorNs += benchNowNs() - start;
+
+    // References first, as the IMU side runs ahead of the PPG side
+    HeartRateFusion fusion;
+    PulseDetector detector(RATE_HZ);
+    size_t chunk = HR_FUSION_REF_RING / 2;
+    for (size_t at = 0; at < ppg.size(); at += chunk) {
+      size_t stop = at + chunk < ppg.size() ? at + chunk : ppg.size();
+      start = benchNowNs();
+      for (size_t i = at; i < stop && i < imu.size(); i++) fusion.addMotion(imu[i]);
+      uint64_t mid = benchNowNs();
+      for (size_t i = at; i < stop; i++) {
+        if (detector.addSample(fusion.cancel((int32_t)ppg[i].ir))) fusion.addBeat();
+      }
+      run->fusedNs += benchNowNs() - mid;
+      run->motionNs += mid - start;
+    }
+    run->beats += (uint64_t)fusion.heartRate();
+  }
+}
+
+void runCost(int passes, unsigned long scale) {
+  // One session's streams, recorded from the simulated parts
+  Session session = makeSession(7, scale);
+  simSetMillis(0);
+  SimPpgSensor ppgSensor;
+  SimImuSensor imuSensor;
+  ppgSensor.setMotionCoupling(&imuSensor, COUPLING_PER_G);
+  ppgSensor.configure(RATE_HZ * 4, 4);
+  imuSensor.configure(RATE_HZ);
+  imuSensor.play(session.motion, 0);
+  std::vector<PpgSample> ppg;
+  std::vector<ImuSample> imu;
+  for (unsigned long ms = 0; ms < session.phaseStartMs[PHASE_COUNT]; ms += 10) {
+    size_t phase;
+    ppgSensor.setHeartRate(rateAt(session, ms, phase));
+    unsigned long long us = (unsigned long long)ms * 1000ULL;
+    PpgSample p = {ppgSensor.redAt(us), ppgSensor.irAt(us)};
+    ppg.push_back(p);
+    imu.push_back(imuSensor.sampleAt(us));
+  }
+
+  CostRun run = {&ppg, &imu, passes, 0, 0, 0, 0};
+  HeapStats before = heapStats();
+  size_t stack = stackHighWater(measureCost, &run);
+  uint64_t allocations = heapStats().allocations - before.allocations;
+  double samples = (double)ppg.size() * passes;
+  double detectorNs = run.detectorNs / samples;
+  double fusedNs = run.fusedNs / samples;
+  double motionNs = run.motionNs / samples;
+
+  printf("cost: %.0f PPG and IMU samples\n", samples);
+  printf("  detector alone %.1f ns/sample, canceller + tracker + detector %.1f ns/sample, reference %.1f ns/sample\n",
+         detectorNs, fusedNs, motionNs);
+  printf("  %zu bytes per HeartRateFusion (budget %d), stack %zu bytes, %llu allocations\n",
+         sizeof(HeartRateFusion), HR_FUSION_RAM_BUDGET, stack, (unsigned long long)allocations);
+  // 10 ms between samples; the fusion may take a small share of it
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%.2f %% of the 10 ms sample period", (fusedNs + motionNs) / 1e5);
+  check("fused per-sample cost within 1 % of the period", fusedNs + motionNs < 100000.0, detail);
+  check("fusion uses no heap", allocations == 0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  Serial.setEcho(false);
+  runAccuracy(quick ? 2 : 8, quick ? 2 : 1);
+  runCost(quick ? 3 : 30, quick ? 2 : 1);
+  return benchResult();
+}
@@ -0,0 +1,450 @@
+/*
+ * RescueNet AI - GPS benchmark
+ *
+ * Replays synthetic receiver output (gps_traces.h) and reports:
+ *
+ *   - parse cost per byte and heap allocations per fix for GpsParser on
+ *     NMEA and on UBX NAV-PVT, against the String based GGA reader the
+ *     first ESP32 sketch used (readStringUntil, substring, toFloat)
+ *   - fixes recovered against the fixes sent, damaged sentences caught,
+ *     and the position, altitude and time error of what came out
+ *   - bytes the UART ring drops at 9600 baud: a 64 byte ring read every
+ *     100 ms, as SoftwareSerial was, against the 1 KB driver ring
+ *     GpsReceiver drains, with and without a 500 ms stall of the loop
+ *   - the switch to UBX: a receiver that acknowledges everything, one
+ *     without NAV-PVT (NEO-6M) and one that never answers
+ *
+ * and checks that HealthMonitor reports the fix, and its time, in the
+ * records it uploads and in the alert SMS. A recorded NMEA log given as an argument is parsed
+ * as well, one second per RMC.
+ *
+ * Usage: gps_bench [--quick] [log.nmea]
+ */
+
+#include <Arduino.h>
+#include <gps_receiver.h>
+#include <health_monitor.h>
+
+#include "../sim/gps_traces.h"
+#include "../sim/heap_stats.h"
+#include "../sim/sim_hal.h"
+#include "bench_util.h"
+
+#include <math.h>
+#include <string>
+
+namespace {
+
+std::string joined(const GpsTrace& trace) {
+  std::string bytes;
+  bytes.reserve(trace.bytes);
+  for (size_t i = 0; i < trace.bursts.size(); i++) bytes += trace.bursts[i].bytes;
+  return bytes;
+}
+
+// Meters between two 1e-7 degree positions, flat earth
+double distanceM(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2) {
+  double north = (lat2 - lat1) * 1e-7 * 111320.0;
+  double east = (lon2 - lon1) * 1e-7 * 111320.0 * cos(lat1 * 1e-7 * M_PI / 180.0);
+  return sqrt(north * north + east * east);
+}
+
+struct ParseResult {
+  double nsPerByte;
+  uint64_t allocations;
+  std::vector<GpsFix> fixes;
+  GpsParserStats stats;
+};
+
+ParseResult parseAll(const std::string& bytes, int repeats) {
+  ParseResult result;
+  GpsParser parser;
+  uint64_t best = UINT64_MAX;
+  for (int r = 0; r < repeats; r++) {
+    parser.reset();
+    result.fixes.clear();
+    result.fixes.reserve(bytes.size() / 64);
+    HeapStats before = heapStats();
+    uint64_t start = benchNowNs();
+    for (size_t i = 0; i < bytes.size(); i++) {
+      if (parser.feed((uint8_t)bytes[i])) result.fixes.push_back(parser.fix());
+    }
+    uint64_t elapsed = benchNowNs() - start;
+    result.allocations = heapStats().allocations - before.allocations;
+    if (elapsed < best) best = elapsed;
+  }
+  result.nsPerByte = (double)best / bytes.size();
+  result.stats = parser.stats();
+  return result;
+}
+
+// What the first ESP32 sketch did with each line: GGA only, no checksum
+double convertDMSToDD(String dms, String direction) {
+  if (dms.length() < 4) return 0.0;
+  double degrees = dms.substring(0, 2).toFloat();
+  double minutes = dms.substring(2).toFloat();
+  double dd = degrees + minutes / 60.0;
+  if (direction == "S" || direction == "W") dd = -dd;
+  return dd;
+}
+
+struct BaselineFix {
+  double latitude;
+  double longitude;
+};
+
+void readGpsLine(const String& line, std::vector<BaselineFix>& fixes) {
+  if (!line.startsWith("$GPGGA")) return;
+  int commaIndex[15];
+  int commaCount = 0;
+  for (unsigned i = 0; i < line.length() && commaCount < 15; i++) {
+    if (line.charAt(i) == ',') commaIndex[commaCount++] = i;
+  }
+  if (commaCount < 6) return;
+  String latStr = line.substring(commaIndex[1] + 1, commaIndex[2]);
+  String latDir = line.substring(commaIndex[2] + 1, commaIndex[3]);
+  String lngStr = line.substring(commaIndex[3] + 1, commaIndex[4]);
+  String lngDir = line.substring(commaIndex[4] + 1, commaIndex[5]);
+  if (latStr.length() > 0 && lngStr.length() > 0) {
+    BaselineFix fix = {convertDMSToDD(latStr, latDir), convertDMSToDD(lngStr, lngDir)};
+    fixes.push_back(fix);
+  }
+}
+
+struct BaselineResult {
+  double nsPerByte;
+  uint64_t allocations;
+  std::vector<BaselineFix> fixes;
+};
+
+BaselineResult parseBaseline(const std::string& bytes, int repeats) {
+  BaselineResult result;
+  uint64_t best = UINT64_MAX;
+  for (int r = 0; r < repeats; r++) {
+    result.fixes.clear();
+    result.fixes.reserve(bytes.size() / 64);
+    HeapStats before = heapStats();
+    uint64_t start = benchNowNs();
+    String line;
+    for (size_t i = 0; i < bytes.size(); i++) {
+      char c = bytes[i];
+      if (c == '\n') {
+        readGpsLine(line, result.fixes);
+        line = "";
+      } else {
+        line += c;
+      }
+    }
+    uint64_t elapsed = benchNowNs() - start;
+    result.allocations = heapStats().allocations - before.allocations;
+    if (elapsed < best) best = elapsed;
+  }
+  result.nsPerByte = (double)best / bytes.size();
+  return result;
+}
+
+struct Accuracy {
+  size_t matched;
+  double positionM;
+  int32_t altitudeMm;
+  uint32_t timeMs;
+  unsigned satellites;  // Mismatches
+};
+
+Accuracy compare(const std::vector<GpsFix>& fixes, const std::vector<GpsTruth>& truth) {
+  Accuracy a = {0, 0, 0, 0, 0};
+  size_t n = fixes.size() < truth.size() ? fixes.size() : truth.size();
+  for (size_t i = 0; i < n; i++) {
+    const GpsFix& f = fixes[i];
+    const GpsTruth& t = truth[i];
+    double position = distanceM(t.latitude, t.longitude, f.latitude, f.longitude);
+    if (position > a.positionM) a.positionM = position;
+    int32_t altitude = abs(f.altitudeMm - t.altitudeMm);
+    if (altitude > a.altitudeMm) a.altitudeMm = altitude;
+    int64_t time = ((int64_t)f.utcSeconds * 1000 + f.utcMillis) - ((int64_t)t.utcSeconds * 1000 + t.utcMillis);
+    uint32_t timeError = (uint32_t)(time < 0 ? -time : time);
+    if (timeError > a.timeMs) a.timeMs = timeError;
+    if (f.satellites != t.satellites) a.satellites++;
+    a.matched++;
+  }
+  return a;
+}
+
+void runParse(unsigned seconds) {
+  const unsigned corruptEvery = 37;
+  GpsTrace nmea = makeNmeaTrace(seconds, 11, corruptEvery);
+  GpsTrace ubx = makeUbxTrace(seconds, 200, 12);
+  std::string nmeaBytes = joined(nmea);
+  std::string ubxBytes = joined(ubx);
+
+  ParseResult parsedNmea = parseAll(nmeaBytes, 5);
+  ParseResult parsedUbx = parseAll(ubxBytes, 5);
+  BaselineResult baseline = parseBaseline(nmeaBytes, 5);
+
+  printf("parse: %u s of NMEA (%zu bytes, %u sentences, %u damaged) and of NAV-PVT at 5 Hz (%zu bytes)\n", seconds,
+         nmea.bytes, nmea.sentences, nmea.corrupted, ubx.bytes);
+  printf("  %-26s %10s %10s %14s\n", "", "ns/byte", "fixes", "allocs/fix");
+  printf("  %-26s %10.1f %10zu %14.1f\n", "String GGA reader", baseline.nsPerByte, baseline.fixes.size(),
+         baseline.fixes.empty() ? 0.0 : (double)baseline.allocations / baseline.fixes.size());
+  printf("  %-26s %10.1f %10zu %14.1f\n", "GpsParser, NMEA", parsedNmea.nsPerByte, parsedNmea.fixes.size(),
+         parsedNmea.fixes.empty() ? 0.0 : (double)parsedNmea.allocations / parsedNmea.fixes.size());
+  printf("  %-26s %10.1f %10zu %14.1f\n", "GpsParser, UBX", parsedUbx.nsPerByte, parsedUbx.fixes.size(),
+         parsedUbx.fixes.empty() ? 0.0 : (double)parsedUbx.allocations / parsedUbx.fixes.size());
+
+  // The String reader takes damaged sentences and reads ddd of longitude
+  // as dd; each of its fixes against the nearest one sent
+  double baselineError = 0;
+  unsigned baselineOff = 0;
+  for (size_t i = 0; i < baseline.fixes.size(); i++) {
+    int32_t latitude = (int32_t)lround(baseline.fixes[i].latitude * 1e7);
+    int32_t longitude = (int32_t)lround(baseline.fixes[i].longitude * 1e7);
+    double best = 1e12;
+    for (size_t k = 0; k < nmea.fixes.size(); k++) {
+      double d = distanceM(nmea.fixes[k].latitude, nmea.fixes[k].longitude, latitude, longitude);
+      if (d < best) best = d;
+    }
+    if (best > baselineError) baselineError = best;
+    if (best > 1.0) baselineOff++;
+  }
+  printf("  String GGA reader: worst position error %.0f km, %u of %zu fixes off by over 1 m\n",
+         baselineError / 1000, baselineOff, baseline.fixes.size());
+
+  Accuracy nmeaAccuracy = compare(parsedNmea.fixes, nmea.fixes);
+  Accuracy ubxAccuracy = compare(parsedUbx.fixes, ubx.fixes);
+  printf("  GpsParser error: NMEA %.3f m, %d mm altitude, %u ms; UBX %.3f m, %d mm, %u ms\n", nmeaAccuracy.positionM,
+         nmeaAccuracy.altitudeMm, nmeaAccuracy.timeMs, ubxAccuracy.positionM, ubxAccuracy.altitudeMm,
+         ubxAccuracy.timeMs);
+
+  char detail[96];
+  snprintf(detail, sizeof(detail), "%zu of %zu", parsedNmea.fixes.size(), nmea.fixes.size());
+  check("every intact NMEA fix recovered", parsedNmea.fixes.size() == nmea.fixes.size(), detail);
+  snprintf(detail, sizeof(detail), "%lu of %u", (unsigned long)parsedNmea.stats.errors, nmea.corrupted);
+  check("every damaged sentence rejected", parsedNmea.stats.errors == nmea.corrupted, detail);
+  snprintf(detail, sizeof(detail), "%.3f m, %d mm", nmeaAccuracy.positionM, nmeaAccuracy.altitudeMm);
+  check("NMEA fixes as sent (< 2 cm, 0 mm)",
+        nmeaAccuracy.positionM < 0.02 && nmeaAccuracy.altitudeMm == 0 && nmeaAccuracy.satellites == 0, detail);
+  check("NMEA fixes carry their UTC", nmeaAccuracy.timeMs == 0);
+  snprintf(detail, sizeof(detail), "%zu of %zu", parsedUbx.fixes.size(), ubx.fixes.size());
+  check("every NAV-PVT fix recovered", parsedUbx.fixes.size() == ubx.fixes.size(), detail);
+  check("NAV-PVT fixes exact, UTC to the ms",
+        ubxAccuracy.positionM == 0 && ubxAccuracy.altitudeMm == 0 && ubxAccuracy.timeMs == 0 &&
+          ubxAccuracy.satellites == 0);
+  snprintf(detail, sizeof(detail), "%llu + %llu", (unsigned long long)parsedNmea.allocations,
+           (unsigned long long)parsedUbx.allocations);
+  check("no heap allocations while parsing", parsedNmea.allocations == 0 && parsedUbx.allocations == 0, detail);
+  snprintf(detail, sizeof(detail), "%.1f per fix", baseline.fixes.empty() ? 0.0 :
+           (double)baseline.allocations / baseline.fixes.size());
+  check("the String reader allocates for every fix", baseline.allocations >= baseline.fixes.size(), detail);
+  // Wall clock: shown, not checked, as it moves with the machine's load
+  printf("  NMEA parsing at %.1fx the String reader's speed\n",
+         parsedNmea.nsPerByte > 0 ? baseline.nsPerByte / parsedNmea.nsPerByte : 0.0);
+}
+
+struct UartResult {
+  unsigned long dropped;
+  size_t fixes;
+  uint16_t drainMax;
+};
+
+// The trace into a ring of ringBytes, drained by GpsReceiver every
+// pollMs; every stallEveryMs the loop is held up for stallMs
+UartResult runUart(const GpsTrace& trace, size_t ringBytes, unsigned long pollMs, unsigned long stallEveryMs,
+                   unsigned long stallMs) {
+  simSetMillis(0);
+  SimGpsPort port(9600, ringBytes);
+  GpsReceiver receiver(port);
+  receiver.begin(9600, 1000, false);
+  port.play(trace, 0);
+  UartResult result = {0, 0, 0};
+  unsigned long end = trace.bursts.back().atMs + 2000;
+  unsigned long nextStall = stallEveryMs;
+  while (millis() < end) {
+    if (receiver.poll()) result.fixes++;
+    if (stallEveryMs && millis() >= nextStall) {
+      delay(stallMs);
+      nextStall += stallEveryMs;
+    }
+    delay(pollMs);
+  }
+  result.dropped = port.dropped();
+  result.drainMax = receiver.stats().drainMax;
+  return result;
+}
+
+void runUarts(unsigned seconds) {
+  GpsTrace trace = makeNmeaTrace(seconds, 21);
+  UartResult softSerial = runUart(trace, 64, 100, 0, 0);
+  UartResult driver = runUart(trace, 1024, MONITOR_GPS_TASK_MS, 0, 0);
+  UartResult stalled = runUart(trace, 1024, MONITOR_GPS_TASK_MS, 7000, 500);
+
+  printf("uart: %u s of NMEA at 9600 baud, %zu fixes sent\n", seconds, trace.fixes.size());
+  printf("  %-34s %12s %10s %12s\n", "", "bytes lost", "fixes", "most/poll");
+  printf("  %-34s %12lu %10zu %12u\n", "64 B ring, read every 100 ms", softSerial.dropped, softSerial.fixes,
+         softSerial.drainMax);
+  printf("  %-34s %12lu %10zu %12u\n", "1 KB ring, GpsReceiver 100 ms", driver.dropped, driver.fixes,
+         driver.drainMax);
+  printf("  %-34s %12lu %10zu %12u\n", "1 KB ring, 500 ms stalls", stalled.dropped, stalled.fixes,
+         stalled.drainMax);
+
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%zu of %zu fixes", softSerial.fixes, trace.fixes.size());
+  check("64 B ring loses fixes", softSerial.dropped > 0 && softSerial.fixes < trace.fixes.size(), detail);
+  snprintf(detail, sizeof(detail), "%zu of %zu fixes", driver.fixes, trace.fixes.size());
+  check("1 KB ring loses nothing", driver.dropped == 0 && driver.fixes == trace.fixes.size(), detail);
+  snprintf(detail, sizeof(detail), "%zu of %zu fixes", stalled.fixes, trace.fixes.size());
+  check("1 KB ring rides out 500 ms stalls", stalled.dropped == 0 && stalled.fixes == trace.fixes.size(), detail);
+}
+
+struct SwitchResult {
+  uint8_t mode;
+  unsigned long configMs;
+  uint16_t sent;
+  uint16_t refused;
+  size_t fixes;
+  bool ubxOnly;
+};
+
+// begin() against a receiver, then 10 s of its output in whichever
+// protocol it ended up with
+SwitchResult runSwitch(bool answer, bool navPvt) {
+  simSetMillis(0);
+  SimGpsPort port(9600, 1024);
+  port.setConfigReplies(answer, navPvt);
+  GpsReceiver receiver(port);
+  receiver.begin(9600, 200, true);
+  SwitchResult result = {};
+  while (receiver.mode() == GPS_MODE_CONFIGURING && millis() < 10000) {
+    receiver.poll();
+    delay(MONITOR_GPS_TASK_MS);
+  }
+  result.configMs = millis();
+  result.mode = receiver.mode();
+  result.sent = receiver.stats().configSent;
+  result.refused = receiver.stats().configRefused;
+  result.ubxOnly = port.ubxOnly();
+
+  GpsTrace trace = result.mode == GPS_MODE_UBX ? makeUbxTrace(10, 200, 31) : makeNmeaTrace(10, 31);
+  port.play(trace, millis());
+  unsigned long end = millis() + 11000;
+  while (millis() < end) {
+    if (receiver.poll()) result.fixes++;
+    delay(MONITOR_GPS_TASK_MS);
+  }
+  return result;
+}
+
+void runSwitches() {
+  SwitchResult ublox8 = runSwitch(true, true);
+  SwitchResult neo6 = runSwitch(true, false);
+  SwitchResult silent = runSwitch(false, false);
+
+  printf("switch: to NAV-PVT at 5 Hz\n");
+  printf("  %-30s %8s %10s %8s %8s %10s\n", "", "mode", "config ms", "sent", "refused", "fixes/10s");
+  const char* labels[] = {"u-blox 8", "NEO-6M, no NAV-PVT", "no answer"};
+  const char* modes[] = {"NMEA", "config", "UBX"};
+  const SwitchResult* results[] = {&ublox8, &neo6, &silent};
+  for (int k = 0; k < 3; k++) {
+    const SwitchResult& r = *results[k];
+    printf("  %-30s %8s %10lu %8u %8u %10zu\n", labels[k], modes[r.mode], r.configMs, r.sent, r.refused, r.fixes);
+  }
+
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%zu fixes", ublox8.fixes);
+  check("u-blox 8 switched to UBX at 5 Hz",
+        ublox8.mode == GPS_MODE_UBX && ublox8.ubxOnly && ublox8.sent == 3 && ublox8.fixes >= 45, detail);
+  snprintf(detail, sizeof(detail), "%zu fixes", neo6.fixes);
+  check("NEO-6M stays on NMEA", neo6.mode == GPS_MODE_NMEA && neo6.refused == 1 && neo6.fixes >= 6, detail);
+  snprintf(detail, sizeof(detail), "%u sent, %lu ms", silent.sent, silent.configMs);
+  check("silent receiver given up after the retries",
+        silent.mode == GPS_MODE_NMEA && silent.sent == GPS_CONFIG_RETRIES &&
+          silent.configMs <= (GPS_CONFIG_RETRIES + 1) * GPS_ACK_TIMEOUT_MS,
+        detail);
+}
+
+void runMonitor() {
+  SimBoard board;
+  simSetMillis(0);
+  simSetPinInput(0, HIGH);
+  SimGpsPort port(9600, 1024);
+  GpsReceiver receiver(port);
+  Sim800l modem(board.modem, 15, 14);
+  MonitorHal hal = {&board.ppg, &board.imu, &board.temp, &board.http, nullptr, &modem, nullptr,
+                    nullptr, nullptr, nullptr, nullptr, &receiver};
+  MonitorConfig config = {"1234567890", "http://host/api/health-data", "http://host/api/emergency", "+1234567890",
+                          2, 5, 18, 0, 3000, false, POWER_FIXED};
+  HealthMonitor monitor(hal, config);
+  receiver.begin(9600, 1000, false);
+  GpsTrace trace = makeNmeaTrace(180, 41);
+  port.play(trace, 0);
+  monitor.begin();
+  monitor.setNetworkConnected(true);
+  modem.begin();
+  while (millis() < 60000UL) monitor.loop();
+
+  size_t located = 0;
+  size_t timed = 0;
+  size_t readings = 0;
+  for (size_t i = 0; i < board.http.requests().size(); i++) {
+    const std::string& body = board.http.requests()[i].body;
+    for (size_t at = body.find("\"userId\""); at != std::string::npos; at = body.find("\"userId\"", at + 1)) {
+      readings++;
+    }
+    for (size_t at = body.find("\"lat\":21.14"); at != std::string::npos; at = body.find("\"lat\":21.14", at + 1)) {
+      located++;
+    }
+    for (size_t at = body.find("2026-03-14T10:1"); at != std::string::npos;
+         at = body.find("2026-03-14T10:1", at + 1)) {
+      timed++;
+    }
+  }
+  printf("monitor: 60 s of HealthMonitor::loop() with the receiver on NMEA\n");
+  printf("  %zu readings uploaded, %zu with a location, %zu with GPS time\n", readings, located, timed);
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%zu of %zu", located, readings);
+  check("readings carry the GPS position", readings >= 5 && located >= readings - 1, detail);
+  snprintf(detail, sizeof(detail), "%zu of %zu", timed, readings);
+  check("readings carry GPS time without NTP", timed >= readings - 1, detail);
+
+  // A fever alert, with the fix still held
+  board.temp.setCelsius(39.4f);
+  while (millis() < 150000UL && board.modem.sentMessages().empty()) monitor.loop();
+  std::string sms = board.modem.sentMessages().empty() ? "" : board.modem.sentMessages()[0].text;
+  size_t line = sms.find("Location: ");
+  std::string location = line == std::string::npos ? "none" : sms.substr(line, sms.find('\n', line) - line);
+  printf("  alert SMS %s\n", location.c_str());
+  check("alert SMS carries the GPS position", location.compare(0, 15, "Location: 21.14") == 0, location.c_str());
+}
+
+void runLog(const char* path) {
+  GpsTrace trace = loadNmeaLog(path);
+  if (trace.bytes == 0) {
+    check("recorded log readable", false, path);
+    return;
+  }
+  std::string bytes = joined(trace);
+  ParseResult parsed = parseAll(bytes, 3);
+  printf("log: %s, %zu bytes, %u sentences over %zu s\n", path, trace.bytes, trace.sentences, trace.bursts.size());
+  printf("  %.1f ns/byte, %lu good sentences, %lu errors, %zu fixes\n", parsed.nsPerByte,
+         (unsigned long)parsed.stats.sentences, (unsigned long)parsed.stats.errors, parsed.fixes.size());
+  if (!parsed.fixes.empty()) {
+    const GpsFix& last = parsed.fixes.back();
+    printf("  last fix %.7f, %.7f, %.1f m, %u satellites, UTC %lu\n", last.latitude / 1e7, last.longitude / 1e7,
+           last.altitudeMm / 1000.0, last.satellites, (unsigned long)last.utcSeconds);
+  }
+  check("recorded log parsed", parsed.stats.sentences > 0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  Serial.setEcho(false);
+  runParse(quick ? 600 : 3600);
+  runUarts(quick ? 60 : 600);
+  runSwitches();
+  runMonitor();
+  for (int i = 1; i < argc; i++) {
+    if (argv[i][0] != '-') runLog(argv[i]);
+  }
+  return benchResult();
+}
@@ -0,0 +1,325 @@
+/*
+ * RescueNet AI - Vitals history benchmark
+ *
+ * Runs the SD history log (history_log.h) on FileLogStorage and measures
+ * what the dashboard and the card care about:
+ *
+ *   writes      samples appended every 5 s for days, page buffered and
+ *               synced by poll(), against a JSON line appended per sample
+ *               with open/append/close (the v5 logToSD()): storage writes
+ *               and bytes per sample, append time, heap use, erases
+ *   range reads one hour windows and the last ten minutes, through the
+ *               sparse index, against a scan of the JSON file: block reads
+ *               and time per query, and the samples returned checked
+ *               against what was written
+ *   remount     a fresh log on the same file finds the head and serves
+ *               the same ranges; a cursor at the end picks up new samples
+ *               and one lapped by the writer resumes at the oldest page
+ *   power cuts  writes stopped part way at random points: after each
+ *               reset the history must read back in order, intact and
+ *               with every sample that was synced
+ *
+ * Usage: history_bench [--quick]
+ */
+
+#include <Arduino.h>
+#include <history_log.h>
+#include <telemetry.h>
+
+#include "../sim/heap_stats.h"
+#include "../sim/sim_hal.h"
+#include "../sim/sim_records.h"
+#include "bench_util.h"
+
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const LOG_PATH = "history_bench.log";
+const char* const TEXT_PATH = "history_bench.txt";
+const uint32_t BLOCK = 4096;
+
+bool sampleIntact(const HistorySample& s) {
+  HistorySample expected = simHistorySample(s.timestamp);
+  return s.heartRate == expected.heartRate && s.spO2 == expected.spO2 &&
+         (int)(s.temperature * 100 + 0.5f) == (int)(expected.temperature * 100 + 0.5f) &&
+         s.bloodPressureSys == expected.bloodPressureSys && s.bloodPressureDia == expected.bloodPressureDia &&
+         s.flags == expected.flags && s.batteryLevel == expected.batteryLevel;
+}
+
+// Reads from..to and checks the samples are the ones written, in order,
+// with none missing from the part of the range the log still holds
+bool readRange(HistoryLog& log, uint32_t from, uint32_t to, uint32_t& count) {
+  static HistoryCursor cursor;
+  count = 0;
+  if (!log.seek(cursor, from, to)) return false;
+  uint32_t oldest = log.oldestTimestamp();
+  uint32_t first = from > oldest ? from : oldest;
+  uint32_t steps = (first - SIM_HISTORY_START + SIM_HISTORY_STEP_S - 1) / SIM_HISTORY_STEP_S;
+  uint32_t expect = SIM_HISTORY_START + steps * SIM_HISTORY_STEP_S;
+  HistorySample s;
+  bool ok = true;
+  while (log.next(cursor, s)) {
+    if (s.timestamp != expect || !sampleIntact(s)) ok = false;
+    expect = s.timestamp + SIM_HISTORY_STEP_S;
+    count++;
+  }
+  uint32_t last = to < log.newestTimestamp() ? to : log.newestTimestamp();
+  return ok && (count == 0 || expect > last);
+}
+
+// ---------------------------------------------------------------- Writes
+
+// The v5 logToSD(): open, append one JSON line, close
+void appendTextLine(const HistorySample& s) {
+  char line[128];
+  size_t length = formatHistoryLine(s, line, sizeof(line));
+  FILE* file = fopen(TEXT_PATH, "ab");
+  if (!file) return;
+  fwrite(line, 1, length, file);
+  fclose(file);
+}
+
+void runWrites(FileLogStorage& storage, HistoryLog& log, uint32_t samples) {
+  printf("writes: %lu samples every %lus (%.1f days), %lu KB ring of %d byte pages, %lu byte erase blocks\n",
+         (unsigned long)samples, (unsigned long)SIM_HISTORY_STEP_S,
+         samples * SIM_HISTORY_STEP_S / 86400.0, (unsigned long)(storage.size() / 1024), HISTORY_PAGE_SIZE,
+         (unsigned long)BLOCK);
+  remove(TEXT_PATH);
+
+  uint64_t logNs = 0, textNs = 0;
+  uint64_t allocations = 0;
+  for (uint32_t i = 0; i < samples; i++) {
+    HistorySample s = simHistorySample(SIM_HISTORY_START + i * SIM_HISTORY_STEP_S);
+    simSetMillis(millis() + SIM_HISTORY_STEP_S * 1000);
+    HeapStats before = heapStats();
+    uint64_t started = benchNowNs();
+    log.append(s);
+    log.poll();
+    logNs += benchNowNs() - started;
+    allocations += heapStats().allocations - before.allocations;
+
+    started = benchNowNs();
+    appendTextLine(s);
+    textNs += benchNowNs() - started;
+  }
+  log.sync();
+
+  const HistoryStats& stats = log.stats();
+  FILE* text = fopen(TEXT_PATH, "rb");
+  long textBytes = 0;
+  if (text) {
+    fseek(text, 0, SEEK_END);
+    textBytes = ftell(text);
+    fclose(text);
+  }
+  double logWrites = (double)stats.writes / samples;
+  printf("  %-22s %14s %14s %12s %10s\n", "policy", "writes/sample", "bytes/sample", "append ns", "erases");
+  printf("  %-22s %14.3f %14.1f %12.0f %10lu\n", "JSON line per sample", 1.0, (double)textBytes / samples,
+         (double)textNs / samples, 0UL);
+  printf("  %-22s %14.3f %14.1f %12.0f %10lu\n", "history pages", logWrites, (double)stats.bytesWritten / samples,
+         (double)logNs / samples, (unsigned long)stats.erases);
+  // Every write() on a card rewrites at least one 512 byte block
+  printf("  SD blocks written per hour: %.0f against %.0f\n", logWrites * 3600 / SIM_HISTORY_STEP_S,
+         3600.0 / SIM_HISTORY_STEP_S);
+  check("page buffering cuts storage writes 10x", logWrites * 10 < 1.0);
+  check("append and poll use no heap", allocations == 0);
+  uint32_t pagesPerPass = storage.size() / HISTORY_PAGE_SIZE;
+  uint32_t pagesWritten = (samples + HISTORY_SAMPLES_PER_PAGE - 1) / HISTORY_SAMPLES_PER_PAGE;
+  check("one erase per block per pass of the ring",
+        stats.erases <= (pagesWritten - pagesPerPass) / (BLOCK / HISTORY_PAGE_SIZE) + 1);
+}
+
+// ---------------------------------------------------------------- Range reads
+
+struct QueryCost {
+  std::vector<double> us;
+  std::vector<double> reads;
+  uint32_t samples = 0;
+  bool correct = true;
+};
+
+void query(HistoryLog& log, uint32_t from, uint32_t to, QueryCost& cost) {
+  uint32_t readsBefore = log.stats().pageReads;
+  uint64_t started = benchNowNs();
+  uint32_t count;
+  if (!readRange(log, from, to, count)) cost.correct = false;
+  cost.us.push_back((benchNowNs() - started) / 1000.0);
+  cost.reads.push_back(log.stats().pageReads - readsBefore);
+  cost.samples += count;
+}
+
+uint32_t scanText(uint32_t from, uint32_t to) {
+  FILE* file = fopen(TEXT_PATH, "rb");
+  if (!file) return 0;
+  char line[160];
+  uint32_t count = 0;
+  while (fgets(line, sizeof(line), file)) {
+    uint32_t t = (uint32_t)strtoul(line + 5, nullptr, 10);
+    if (t >= from && t <= to) count++;
+  }
+  fclose(file);
+  return count;
+}
+
+void runRangeReads(HistoryLog& log, int queries) {
+  uint32_t oldest = log.oldestTimestamp();
+  uint32_t newest = log.newestTimestamp();
+  printf("range reads: %lu h held, index stride %lu pages\n", (unsigned long)((newest - oldest) / 3600),
+         (unsigned long)log.stride());
+  srand(12);
+  QueryCost hours, recent;
+  std::vector<double> scanUs;
+  uint32_t scanMatches = 0, hourMatches = 0;
+  for (int q = 0; q < queries; q++) {
+    uint32_t from = oldest + (uint32_t)((uint64_t)rand() * (newest - oldest - 3600) / RAND_MAX);
+    uint32_t before = hours.samples;
+    query(log, from, from + 3600 - 1, hours);
+    hourMatches += hours.samples - before;
+    query(log, newest - 600 + 1, newest, recent);
+    if (q < 10) {
+      uint64_t started = benchNowNs();
+      scanMatches += scanText(from, from + 3600 - 1);
+      scanUs.push_back((benchNowNs() - started) / 1000.0);
+      if (q == 9) {
+        // Only ten scans; compare against the same ten queries
+        check("index and full scan agree", hourMatches == scanMatches);
+      }
+    }
+  }
+  printf("  %-22s %10s %12s %12s %12s\n", "query", "samples", "block reads", "p50 us", "p99 us");
+  printf("  %-22s %10.0f %12.1f %12.1f %12.1f\n", "1 h window", (double)hours.samples / queries,
+         benchMean(hours.reads), benchPercentile(hours.us, 50), benchPercentile(hours.us, 99));
+  printf("  %-22s %10.0f %12.1f %12.1f %12.1f\n", "last 10 min", (double)recent.samples / queries,
+         benchMean(recent.reads), benchPercentile(recent.us, 50), benchPercentile(recent.us, 99));
+  printf("  %-22s %10s %12s %12.1f %12.1f\n", "1 h, scan of JSON file", "", "", benchPercentile(scanUs, 50),
+         benchPercentile(scanUs, 99));
+  check("every range returns the samples written", hours.correct && recent.correct);
+  // Pages in range, the binary search and oldestTimestamp()'s header
+  double search = 1;
+  for (uint32_t n = log.stride(); n > 1; n /= 2) search++;
+  check("1 h window reads its pages plus log2(stride)",
+        benchMean(hours.reads) <= 3600.0 / SIM_HISTORY_STEP_S / HISTORY_SAMPLES_PER_PAGE + 2 + search + 1);
+  check("last 10 minutes read their pages plus log2(stride)",
+        benchMean(recent.reads) <= 600.0 / SIM_HISTORY_STEP_S / HISTORY_SAMPLES_PER_PAGE + 2 + search + 1);
+  remove(TEXT_PATH);
+}
+
+// ---------------------------------------------------------------- Remount
+
+void runRemount(FileLogStorage& storage, HistoryLog& written) {
+  printf("remount\n");
+  uint32_t oldest = written.oldestTimestamp();
+  uint32_t newest = written.newestTimestamp();
+  storage.reopen();
+  static HistoryLog log(&storage);
+  uint64_t started = benchNowNs();
+  bool mounted = log.begin();
+  double mountUs = (benchNowNs() - started) / 1000.0;
+  printf("  mount %.0f us, %lu block reads\n", mountUs, (unsigned long)log.stats().pageReads);
+  check("remount finds the same oldest and newest sample",
+        mounted && log.oldestTimestamp() == oldest && log.newestTimestamp() == newest);
+  uint32_t count;
+  check("whole history reads back after remount", readRange(log, 0, 0xFFFFFFFFUL, count));
+
+  // A live tail: a cursor at the end returns samples appended later
+  static HistoryCursor tail;
+  HistorySample s;
+  log.seek(tail, newest, 0xFFFFFFFFUL);
+  bool ok = log.next(tail, s) && s.timestamp == newest && !log.next(tail, s);
+  uint32_t t = newest;
+  for (int i = 0; i < 40; i++) {
+    t += SIM_HISTORY_STEP_S;
+    log.append(simHistorySample(t));
+    ok = ok && log.next(tail, s) && s.timestamp == t && sampleIntact(s) && !log.next(tail, s);
+  }
+  check("cursor at the end picks up new samples", ok);
+
+  // A reader the writer laps finishes the page it holds, then resumes at
+  // the oldest page still held
+  static HistoryCursor slow;
+  log.seek(slow, 0, 0xFFFFFFFFUL);
+  log.next(slow, s);
+  uint32_t expect = s.timestamp;
+  uint32_t lap = storage.size() / HISTORY_PAGE_SIZE * HISTORY_SAMPLES_PER_PAGE;
+  for (uint32_t i = 0; i < lap; i++) {
+    t += SIM_HISTORY_STEP_S;
+    log.append(simHistorySample(t));
+  }
+  int jumps = 0;
+  ok = true;
+  while (ok && log.next(slow, s)) {
+    if (s.timestamp != expect + SIM_HISTORY_STEP_S) {
+      jumps++;
+      ok = s.timestamp == log.oldestTimestamp();
+    }
+    expect = s.timestamp;
+    ok = ok && sampleIntact(s);
+  }
+  check("lapped cursor resumes at the oldest sample", ok && jumps == 1 && expect == t);
+  log.sync();
+}
+
+// ---------------------------------------------------------------- Power cuts
+
+void runPowerCuts(int trials) {
+  // Small ring so the cuts land on wraps and erases as well
+  FileLogStorage storage(LOG_PATH, 16 * BLOCK, BLOCK);
+  storage.remove();
+  storage.open();
+  srand(13);
+
+  uint32_t nextTime = SIM_HISTORY_START;
+  uint32_t syncedTime = 0;  // Newest sample appended before a completed sync()
+  int broken = 0, lost = 0;
+  std::vector<double> mountUs;
+  static HistoryLog log(&storage);
+  for (int trial = 0; trial < trials; trial++) {
+    uint64_t started = benchNowNs();
+    if (!log.begin()) {
+      check("log mounts after a power cut", false);
+      return;
+    }
+    mountUs.push_back((benchNowNs() - started) / 1000.0);
+
+    uint32_t count;
+    if (trial > 0 && !readRange(log, 0, 0xFFFFFFFFUL, count)) broken++;
+    if (log.newestTimestamp() < syncedTime) lost++;
+    // Writing resumes after the newest sample that made it
+    if (!log.empty()) nextTime = log.newestTimestamp() + SIM_HISTORY_STEP_S;
+
+    storage.cutPowerAfter(storage.bytesWritten() + 1 + rand() % 3000);
+    while (!storage.powerLost()) {
+      log.append(simHistorySample(nextTime));
+      nextTime += SIM_HISTORY_STEP_S;
+      if (rand() % 8 == 0 && log.sync() && !storage.powerLost()) syncedTime = nextTime - SIM_HISTORY_STEP_S;
+    }
+    storage.reopen();
+  }
+  printf("power cuts: %d, mount p50 %.0f us\n", trials, benchPercentile(mountUs, 50));
+  check("history in order and intact after every cut", broken == 0, "broken " + std::to_string(broken));
+  check("no synced sample lost", lost == 0, "lost " + std::to_string(lost));
+  storage.remove();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  Serial.setEcho(false);
+  // Ring of 1 MB (a day and a half) or 4 MB, written 1.5 times round
+  uint32_t bytes = quick ? 1024UL * 1024 : 4096UL * 1024;
+  FileLogStorage storage(LOG_PATH, bytes, BLOCK);
+  storage.remove();
+  storage.open();
+  static HistoryLog log(&storage);
+  log.begin();
+  runWrites(storage, log, bytes / HISTORY_PAGE_SIZE * HISTORY_SAMPLES_PER_PAGE * 3 / 2);
+  runRangeReads(log, quick ? 200 : 2000);
+  runRemount(storage, log);
+  storage.remove();
+  runPowerCuts(quick ? 200 : 2000);
+  return benchResult();
+}
@@ -0,0 +1,567 @@
+/*
+ * RescueNet AI - Dashboard web server benchmark
+ *
+ * Runs the dashboard server (http_server.h) on loopback sockets
+ * (host/sim/posix_tcp.h) against real HTTP clients on threads of their
+ * own, and measures what a phone or laptop on the device's WiFi sees:
+ *
+ *   load      N clients fetching the dashboard page over and over on
+ *             kept-alive connections, against a one-at-a-time server
+ *             that builds the page in a String per request and closes
+ *             the connection after it (the v2.1 handleRoot()):
+ *             requests/s, p50/p99 latency, bytes on the wire and heap
+ *             allocations per request, bytes sent from flash uncopied
+ *   cache     the page again with its ETag: 304 and no body; unknown
+ *             paths and methods get 404 and 405
+ *   history   the last half hour from the RAM ring as NDJSON and as a JSON
+ *             array, with every sample once and in order; an older
+ *             range from the SD history; a second archive request at
+ *             the same time turned away with 503
+ *   events    /events subscribers get every published sample, and how
+ *             long after; one that stops reading loses samples without
+ *             holding up the others
+ *
+ * The server polls in wall time (simRealTime()) on its own thread, so
+ * the load figures depend on the machine; compare the two servers run
+ * by run rather than with the device. Only what does not depend on it
+ * is checked: every request answered, bytes, copies and allocations.
+ *
+ * Usage: http_bench [--quick] [--clients N]
+ */
+
+#include <Arduino.h>
+#include <history_log.h>
+#include <history_ring.h>
+#include <http_server.h>
+#include <telemetry.h>
+
+#include "../../codes/web_assets.h"
+#include "../sim/heap_stats.h"
+#include "../sim/posix_tcp.h"
+#include "../sim/sim_hal.h"
+#include "../sim/sim_records.h"
+#include "bench_util.h"
+
+#include <atomic>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const char* const LOG_PATH = "http_bench.log";
+const uint32_t LOG_BYTES = 1024UL * 1024;
+const uint32_t LOG_BLOCK = 4096;
+// Samples on the card from before the ring's
+const uint32_t ARCHIVE_SAMPLES = 2000;
+const size_t RESPONSE_BYTES = 64 * 1024;
+const uint64_t EXCHANGE_TIMEOUT_NS = 5000000000ULL;
+
+// Reads from a blocking socket until the whole response is in: the
+// headers and Content-Length bytes of body. Returns the body length, or
+// -1; status gets the status code.
+long readResponse(int socket, char* buffer, size_t capacity, int& status) {
+  size_t used = 0;
+  size_t headerEnd = 0;
+  long bodyLength = -1;
+  for (;;) {
+    if (headerEnd && used >= headerEnd + (size_t)bodyLength) return bodyLength;
+    if (used == capacity) return -1;
+    ssize_t n = recv(socket, buffer + used, capacity - used, 0);
+    if (n <= 0) return -1;
+    used += (size_t)n;
+    if (!headerEnd) {
+      char* end = (char*)memmem(buffer, used, "\r\n\r\n", 4);
+      if (!end) continue;
+      headerEnd = (size_t)(end - buffer) + 4;
+      status = atoi(buffer + 9);
+      char* length = (char*)memmem(buffer, headerEnd, "Content-Length: ", 16);
+      bodyLength = length ? atol(length + 16) : 0;
+    }
+  }
+}
+
+// ---------------------------------------------------------------- load
+
+struct LoadResult {
+  uint32_t requests;
+  uint32_t failed;
+  double seconds;
+  std::vector<uint64_t> latencyNs;
+  uint64_t allocations;
+  uint64_t bytesOnWire;
+};
+
+// Starts the clients together once the server is up and times them until
+// the last finishes. keepAlive clients hold one connection; the others
+// connect for every request.
+void runClients(uint16_t port, uint8_t clients, uint32_t perClient, bool keepAlive, LoadResult& result,
+                std::atomic<uint64_t>& wireBytes) {
+  std::vector<std::vector<uint64_t>> latencies(clients);
+  std::vector<std::vector<char>> buffers(clients);
+  for (uint8_t i = 0; i < clients; i++) {
+    latencies[i].reserve(perClient);
+    buffers[i].resize(RESPONSE_BYTES);
+  }
+  std::atomic<uint32_t> failed(0);
+  std::atomic<uint8_t> ready(0);
+  std::atomic<bool> go(false);
+  std::vector<std::thread> threads;
+  for (uint8_t i = 0; i < clients; i++) {
+    threads.emplace_back([&, i] {
+      const char* request = keepAlive ? "GET / HTTP/1.1\r\nHost: rescuenet\r\nAccept-Encoding: gzip\r\n\r\n"
+                                      : "GET / HTTP/1.1\r\nHost: rescuenet\r\nConnection: close\r\n\r\n";
+      int socket = keepAlive ? tcpConnect(port) : -1;
+      ready++;
+      while (!go.load()) std::this_thread::yield();
+      for (uint32_t r = 0; r < perClient; r++) {
+        uint64_t start = benchNowNs();
+        if (!keepAlive) socket = tcpConnect(port);
+        int status = 0;
+        long length = -1;
+        if (socket >= 0 && tcpSendAll(socket, request, strlen(request))) {
+          length = readResponse(socket, buffers[i].data(), RESPONSE_BYTES, status);
+        }
+        if (length <= 0 || status != 200) {
+          failed++;
+          if (socket >= 0) close(socket);
+          socket = tcpConnect(port);
+          continue;
+        }
+        latencies[i].push_back(benchNowNs() - start);
+        if (!keepAlive) {
+          close(socket);
+          socket = -1;
+        }
+      }
+      if (socket >= 0) close(socket);
+    });
+  }
+  while (ready.load() < clients) std::this_thread::yield();
+  uint64_t allocationsBefore = heapStats().allocations;
+  uint64_t wireBefore = wireBytes.load();
+  uint64_t start = benchNowNs();
+  go.store(true);
+  for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+  result.seconds = (double)(benchNowNs() - start) / 1e9;
+  result.allocations = heapStats().allocations - allocationsBefore;
+  result.bytesOnWire = wireBytes.load() - wireBefore;
+  result.failed = failed.load();
+  result.requests = 0;
+  for (uint8_t i = 0; i < clients; i++) {
+    result.requests += (uint32_t)latencies[i].size();
+    result.latencyNs.insert(result.latencyNs.end(), latencies[i].begin(), latencies[i].end());
+  }
+}
+
+// The page as written, for the baseline to build; next to this file in
+// the source tree
+std::string readPage() {
+  std::string path = __FILE__;
+  path = path.substr(0, path.find_last_of('/') + 1) + "../../codes/web/index.html";
+  std::string text;
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) return text;
+  char chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) text.append(chunk, n);
+  fclose(file);
+  return text;
+}
+
+// The v2.1 way: accept, read the request, build the page in a String,
+// send it uncompressed and close
+void baselineServer(int listener, const std::string& page, std::atomic<bool>& running,
+                    std::atomic<uint64_t>& wireBytes) {
+  std::vector<std::string> lines;
+  for (size_t start = 0; start < page.size();) {
+    size_t end = page.find('\n', start);
+    if (end == std::string::npos) end = page.size();
+    lines.push_back(page.substr(start, end - start));
+    start = end + 1;
+  }
+  while (running.load()) {
+    int socket = accept(listener, nullptr, nullptr);
+    if (socket < 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    char request[1024];
+    size_t used = 0;
+    while (used < sizeof(request)) {
+      ssize_t n = recv(socket, request + used, sizeof(request) - used, 0);
+      if (n <= 0) break;
+      used += (size_t)n;
+      if (memmem(request, used, "\r\n\r\n", 4)) break;
+    }
+    String html;
+    for (size_t i = 0; i < lines.size(); i++) {
+      html += lines[i].c_str();
+      html += "\n";
+    }
+    String response = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: ";
+    response += String((unsigned long)html.length());
+    response += "\r\nConnection: close\r\n\r\n";
+    response += html;
+    tcpSendAll(socket, response.c_str(), response.length());
+    wireBytes += response.length();
+    close(socket);
+  }
+}
+
+void printLoad(const char* label, LoadResult& result) {
+  uint32_t total = result.requests ? result.requests : 1;
+  double p50 = (double)benchPercentile(result.latencyNs, 50.0) / 1000.0;
+  double p99 = (double)benchPercentile(result.latencyNs, 99.0) / 1000.0;
+  printf("  %-12s %7.0f req/s  p50 %6.0f us  p99 %6.0f us  %5.0f B/req  %5.2f allocs/req\n", label,
+         result.requests / result.seconds, p50, p99, (double)result.bytesOnWire / total,
+         (double)result.allocations / total);
+}
+
+void runLoad(uint8_t clients, uint32_t perClient) {
+  std::string page = readPage();
+  printf("load: %u clients x %u requests for / (%u B page, %u B gzipped)\n", clients, perClient,
+         (unsigned)page.size(),
+         (unsigned)WEB_ASSETS[0].length);
+  simRealTime(true);
+
+  // Async server
+  PosixTcpServer tcp;
+  tcp.begin();
+  static HistoryRing ring;
+  static HttpServer server(tcp, ring);
+  server.setAssets(WEB_ASSETS, WEB_ASSET_COUNT);
+  std::atomic<bool> running(true);
+  std::atomic<uint64_t> wire(0);
+  std::thread poller([&] {
+    uint32_t lastSent = 0;
+    while (running.load()) {
+      server.poll();
+      uint32_t sent = server.stats().bytesSent;
+      wire += sent - lastSent;
+      lastSent = sent;
+      std::this_thread::yield();
+    }
+  });
+  LoadResult async;
+  runClients(tcp.port(), clients, perClient, true, async, wire);
+  running.store(false);
+  poller.join();
+
+  // One-at-a-time server
+  LoadResult baseline;
+  std::atomic<bool> baselineRunning(true);
+  std::atomic<uint64_t> baselineWire(0);
+  // Blocking accept on the listener's port through a plain socket
+  int listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addressLength = sizeof(address);
+  bind(listenSocket, (sockaddr*)&address, sizeof(address));
+  listen(listenSocket, 64);
+  getsockname(listenSocket, (sockaddr*)&address, &addressLength);
+  struct timeval wait = {0, 10000};
+  setsockopt(listenSocket, SOL_SOCKET, SO_RCVTIMEO, &wait, sizeof(wait));
+  std::thread sync([&] { baselineServer(listenSocket, page, baselineRunning, baselineWire); });
+  runClients(ntohs(address.sin_port), clients, perClient, false, baseline, baselineWire);
+  baselineRunning.store(false);
+  sync.join();
+  close(listenSocket);
+  simRealTime(false);
+
+  uint32_t expected = (uint32_t)clients * perClient;
+  double asyncRate = async.requests / async.seconds;
+  double baselineRate = baseline.requests / baseline.seconds;
+  printLoad("String+close", baseline);
+  printLoad("async", async);
+  char detail[96];
+  snprintf(detail, sizeof(detail), "%u of %u, %u of %u", (unsigned)async.requests, (unsigned)expected,
+           (unsigned)baseline.requests, (unsigned)expected);
+  check("every request answered by both servers", async.requests == expected && baseline.requests == expected,
+        detail);
+  // Wall clock: shown, not checked, as it moves with the machine's load
+  printf("  async serves %.1fx the requests per second\n", asyncRate / baselineRate);
+  snprintf(detail, sizeof(detail), "%.2f vs %.2f", (double)async.allocations / expected,
+           (double)baseline.allocations / expected);
+  check("async allocates nothing per request", async.allocations < expected / 100 + clients, detail);
+  snprintf(detail, sizeof(detail), "%.0f vs %.0f B", (double)async.bytesOnWire / expected,
+           (double)baseline.bytesOnWire / expected);
+  check("gzipped page is under half the bytes", async.bytesOnWire * 2 < baseline.bytesOnWire, detail);
+  snprintf(detail, sizeof(detail), "%llu B copied, %llu B from flash", (unsigned long long)tcp.bytesCopied(),
+           (unsigned long long)tcp.bytesReferenced());
+  check("page bodies sent from flash, never copied",
+        tcp.bytesReferenced() == (uint64_t)expected * WEB_ASSETS[0].length, detail);
+}
+
+// ---------------------------------------------------------------- exchanges
+
+// One request on its own connection, the server polled in this thread
+// until the response is complete (the server closes the connection)
+std::string exchange(HttpServer& server, uint16_t port, const std::string& request) {
+  std::string response;
+  int socket = tcpConnect(port);
+  if (socket < 0 || !tcpSendAll(socket, request.data(), request.size())) return response;
+  uint64_t start = benchNowNs();
+  char buffer[4096];
+  while (benchNowNs() - start < EXCHANGE_TIMEOUT_NS) {
+    server.poll();
+    ssize_t n = recv(socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (n == 0) break;
+    if (n > 0) response.append(buffer, (size_t)n);
+  }
+  close(socket);
+  return response;
+}
+
+int statusOf(const std::string& response) {
+  return response.size() > 12 ? atoi(response.c_str() + 9) : 0;
+}
+
+// The body with chunked transfer coding undone; empty when malformed
+std::string bodyOf(const std::string& response) {
+  size_t p = response.find("\r\n\r\n");
+  if (p == std::string::npos) return "";
+  p += 4;
+  if (response.find("Transfer-Encoding: chunked") == std::string::npos) return response.substr(p);
+  std::string body;
+  for (;;) {
+    size_t end = response.find("\r\n", p);
+    if (end == std::string::npos) return "";
+    unsigned long size = strtoul(response.c_str() + p, nullptr, 16);
+    p = end + 2;
+    if (size == 0) return body;
+    if (p + size + 2 > response.size()) return "";
+    body.append(response, p, size);
+    p += size + 2;
+  }
+}
+
+// Counts the samples in an NDJSON or JSON array body and checks each is
+// the next one expected
+bool samplesInBody(const std::string& body, uint32_t from, uint32_t& count) {
+  count = 0;
+  uint32_t expected = from;
+  for (size_t p = body.find("{\"t\":"); p != std::string::npos; p = body.find("{\"t\":", p + 1)) {
+    uint32_t timestamp = (uint32_t)strtoul(body.c_str() + p + 5, nullptr, 10);
+    if (timestamp != expected) return false;
+    char line[128];
+    size_t length = formatHistoryLine(simHistorySample(timestamp), line, sizeof(line));
+    if (body.compare(p, length - 1, line, length - 1) != 0) return false;
+    expected += SIM_HISTORY_STEP_S;
+    count++;
+  }
+  return true;
+}
+
+void runCache(HttpServer& server, uint16_t port) {
+  printf("cache and errors\n");
+  std::string full = exchange(server, port, "GET / HTTP/1.1\r\nConnection: close\r\n\r\n");
+  std::string etag = WEB_ASSETS[0].etag;
+  bool tagged = full.find("ETag: " + etag) != std::string::npos &&
+                full.find("Content-Encoding: gzip") != std::string::npos;
+  check("page carries its ETag and gzip encoding", statusOf(full) == 200 && tagged);
+  std::string cached = exchange(server, port, "GET / HTTP/1.1\r\nIf-None-Match: " + etag + "\r\nConnection: close\r\n\r\n");
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%u B vs %u B", (unsigned)cached.size(), (unsigned)full.size());
+  check("matching If-None-Match gets 304 and no body",
+        statusOf(cached) == 304 && bodyOf(cached).empty(), detail);
+  std::string stale = exchange(server, port, "GET / HTTP/1.1\r\nIf-None-Match: \"0\"\r\nConnection: close\r\n\r\n");
+  check("a stale ETag gets the page", statusOf(stale) == 200 && bodyOf(stale).size() == WEB_ASSETS[0].length);
+  int missing = statusOf(exchange(server, port, "GET /nope HTTP/1.1\r\nConnection: close\r\n\r\n"));
+  int method = statusOf(exchange(server, port, "POST / HTTP/1.1\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"));
+  snprintf(detail, sizeof(detail), "%d, %d", missing, method);
+  check("unknown path 404, unknown method 405", missing == 404 && method == 405, detail);
+}
+
+void runHistory(HttpServer& server, HistoryLog& log, uint16_t port) {
+  printf("history: %u samples on the card, the last %u of them in RAM\n",
+         (unsigned)(ARCHIVE_SAMPLES + HISTORY_RING_SAMPLES), (unsigned)HISTORY_RING_SAMPLES);
+  uint32_t ringStart = SIM_HISTORY_START + ARCHIVE_SAMPLES * SIM_HISTORY_STEP_S;
+  uint32_t newest = ringStart + (HISTORY_RING_SAMPLES - 1) * SIM_HISTORY_STEP_S;
+  const uint32_t HALF_HOUR = 1800;
+
+  uint32_t reads = log.stats().pageReads;
+  uint64_t start = benchNowNs();
+  std::string ndjson = exchange(server, port, "GET /history?minutes=30 HTTP/1.1\r\nConnection: close\r\n\r\n");
+  double ndjsonMs = (double)(benchNowNs() - start) / 1e6;
+  std::string body = bodyOf(ndjson);
+  uint32_t count = 0;
+  bool ordered = samplesInBody(body, newest - HALF_HOUR, count);
+  char detail[96];
+  snprintf(detail, sizeof(detail), "%u samples, %u B in %.1f ms", (unsigned)count, (unsigned)body.size(), ndjsonMs);
+  check("last half hour as NDJSON, every sample in order",
+        statusOf(ndjson) == 200 && ordered && count == HALF_HOUR / SIM_HISTORY_STEP_S + 1, detail);
+  check("served from RAM without reading the card", log.stats().pageReads == reads);
+
+  std::string json = exchange(server, port, "GET /history?minutes=30&format=json HTTP/1.1\r\nConnection: close\r\n\r\n");
+  body = bodyOf(json);
+  ordered = samplesInBody(body, newest - HALF_HOUR, count);
+  bool array = body.size() > 2 && body[0] == '[' && body.compare(body.size() - 2, 2, "]\n") == 0;
+  snprintf(detail, sizeof(detail), "%u samples", (unsigned)count);
+  check("last half hour as a JSON array",
+        statusOf(json) == 200 && array && ordered && count == HALF_HOUR / SIM_HISTORY_STEP_S + 1, detail);
+
+  uint32_t from = SIM_HISTORY_START + 100 * SIM_HISTORY_STEP_S;
+  uint32_t to = from + 999 * SIM_HISTORY_STEP_S;
+  char request[128];
+  snprintf(request, sizeof(request), "GET /history?from=%lu&to=%lu HTTP/1.1\r\nConnection: close\r\n\r\n",
+           (unsigned long)from, (unsigned long)to);
+  reads = log.stats().pageReads;
+  std::string archived = exchange(server, port, request);
+  ordered = samplesInBody(bodyOf(archived), from, count);
+  snprintf(detail, sizeof(detail), "%u samples, %u page reads", (unsigned)count,
+           (unsigned)(log.stats().pageReads - reads));
+  check("an older range comes from the card", statusOf(archived) == 200 && ordered && count == 1000, detail);
+
+  // Two archive requests in the same poll: the cursor is taken
+  int first = tcpConnect(port);
+  int second = tcpConnect(port);
+  tcpSendAll(first, request, strlen(request));
+  tcpSendAll(second, request, strlen(request));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  std::string responses[2];
+  int sockets[2] = {first, second};
+  bool open[2] = {true, true};
+  start = benchNowNs();
+  while ((open[0] || open[1]) && benchNowNs() - start < EXCHANGE_TIMEOUT_NS) {
+    server.poll();
+    for (int i = 0; i < 2; i++) {
+      char buffer[4096];
+      ssize_t n = open[i] ? recv(sockets[i], buffer, sizeof(buffer), MSG_DONTWAIT) : -1;
+      if (n == 0) open[i] = false;
+      if (n > 0) responses[i].append(buffer, (size_t)n);
+    }
+  }
+  close(first);
+  close(second);
+  int a = statusOf(responses[0]);
+  int b = statusOf(responses[1]);
+  snprintf(detail, sizeof(detail), "%d and %d", a, b);
+  check("a second archive request at once gets 503", (a == 200 && b == 503) || (a == 503 && b == 200), detail);
+  std::string after = exchange(server, port, request);
+  check("and the card is free again after", statusOf(after) == 200);
+
+  std::string none = exchange(server, port, "GET /history?from=1&to=2 HTTP/1.1\r\nConnection: close\r\n\r\n");
+  check("an empty range gets 204", statusOf(none) == 204);
+}
+
+// ---------------------------------------------------------------- events
+
+void runEvents(HttpServer& server, HistoryRing& ring, PosixTcpServer& tcp, uint32_t events) {
+  const int readers = 3;
+  printf("events: %d subscribers reading, 1 stopped, %u samples published\n", readers, (unsigned)events);
+  // Small kernel buffers so the stopped subscriber backs up quickly
+  tcp.setSendBuffer(4096);
+  int sockets[readers + 1];
+  for (int i = 0; i <= readers; i++) {
+    sockets[i] = tcpConnect(tcp.port(), i == readers ? 2048 : 0);
+    const char* request = "GET /events HTTP/1.1\r\nAccept: text/event-stream\r\n\r\n";
+    tcpSendAll(sockets[i], request, strlen(request));
+  }
+  uint64_t start = benchNowNs();
+  while (server.subscribers() < readers + 1 && benchNowNs() - start < EXCHANGE_TIMEOUT_NS) server.poll();
+  check("every subscriber connected", server.subscribers() == readers + 1);
+
+  std::vector<std::string> received(readers);
+  std::vector<uint32_t> counts(readers, 0);
+  std::vector<uint64_t> latencyNs;
+  latencyNs.reserve(events * readers);
+  uint32_t dropsBefore = server.stats().eventsDropped;
+  uint32_t base = ring.newestTimestamp() + SIM_HISTORY_STEP_S;
+  bool intact = true;
+  for (uint32_t e = 0; e < events; e++) {
+    HistorySample sample = simHistorySample(base + e * SIM_HISTORY_STEP_S);
+    uint64_t published = benchNowNs();
+    server.publish(sample);
+    for (int r = 0; r < readers; r++) {
+      // Until this event is in, then its delay
+      while (counts[r] <= e && benchNowNs() - published < EXCHANGE_TIMEOUT_NS) {
+        server.poll();
+        char buffer[2048];
+        ssize_t n = recv(sockets[r], buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (n <= 0) continue;
+        received[r].append(buffer, (size_t)n);
+        size_t p;
+        while ((p = received[r].find("\n\n")) != std::string::npos) {
+          std::string message = received[r].substr(0, p);
+          received[r].erase(0, p + 2);
+          if (message.compare(0, 6, "data: ") != 0) continue;
+          uint32_t timestamp = (uint32_t)strtoul(message.c_str() + 11, nullptr, 10);
+          if (timestamp != base + counts[r] * SIM_HISTORY_STEP_S) intact = false;
+          counts[r]++;
+        }
+      }
+      latencyNs.push_back(benchNowNs() - published);
+    }
+  }
+  uint32_t dropped = server.stats().eventsDropped - dropsBefore;
+  bool all = true;
+  for (int r = 0; r < readers; r++) all = all && counts[r] == events;
+  char detail[96];
+  snprintf(detail, sizeof(detail), "p50 %.0f us, p99 %.0f us", (double)benchPercentile(latencyNs, 50.0) / 1000.0,
+           (double)benchPercentile(latencyNs, 99.0) / 1000.0);
+  check("readers get every sample, in order", all && intact, detail);
+  snprintf(detail, sizeof(detail), "%u of %u dropped", (unsigned)dropped, (unsigned)events);
+  check("stopped subscriber drops samples, others don't", dropped > 0 && dropped < events, detail);
+  for (int i = 0; i <= readers; i++) close(sockets[i]);
+  start = benchNowNs();
+  while (server.subscribers() > 0 && benchNowNs() - start < EXCHANGE_TIMEOUT_NS) server.poll();
+  check("closed subscribers are let go", server.subscribers() == 0);
+  tcp.setSendBuffer(0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  uint8_t clients = 8;
+  for (int i = 1; i + 1 < argc; i++) {
+    if (strcmp(argv[i], "--clients") == 0) clients = (uint8_t)atoi(argv[i + 1]);
+  }
+  if (clients < 1 || clients > HTTP_MAX_CONNECTIONS) clients = HTTP_MAX_CONNECTIONS;
+  Serial.setEcho(false);
+  printf("RescueNet dashboard server benchmark%s\n\n", quick ? " (quick)" : "");
+
+  runLoad(clients, quick ? 250 : 2500);
+  printf("\n");
+
+  simRealTime(true);
+  FileLogStorage storage(LOG_PATH, LOG_BYTES, LOG_BLOCK);
+  storage.remove();
+  storage.open();
+  HistoryLog log(&storage);
+  log.begin();
+  static HistoryRing ring;
+  for (uint32_t i = 0; i < ARCHIVE_SAMPLES + HISTORY_RING_SAMPLES; i++) {
+    HistorySample sample = simHistorySample(SIM_HISTORY_START + i * SIM_HISTORY_STEP_S);
+    log.append(sample);
+    ring.append(sample);
+  }
+  log.sync();
+  static HistoryCursor cursor;
+  PosixTcpServer tcp;
+  tcp.begin();
+  static HttpServer server(tcp, ring);
+  server.setAssets(WEB_ASSETS, WEB_ASSET_COUNT);
+  server.attachArchive(&log, &cursor);
+
+  runCache(server, tcp.port());
+  printf("\n");
+  runHistory(server, log, tcp.port());
+  printf("\n");
+  runEvents(server, ring, tcp, quick ? 300 : 3000);
+  simRealTime(false);
+  storage.close();
+  storage.remove();
+
+  printf("\n%s\n", benchFailures() == 0 ? "All checks passed" : "Some checks FAILED");
+  return benchResult();
+}
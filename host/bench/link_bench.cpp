@@ -0,0 +1,352 @@
+/*
+ * RescueNet AI - Sensor link benchmark
+ *
+ * Compares the framed link of sensor_link.h with the v5 split design,
+ * where the ESP32 polled the Nano over I2C with Wire.requestFrom(8, 32)
+ * and the Nano's onRequest handler read the sensors and formatted a CSV
+ * String for every request:
+ *
+ *   encoding  wire bytes, encode time and heap allocations per sample,
+ *             and the work done in the I2C request handler
+ *   lossy     frames through a link that drops and corrupts bytes: no
+ *             corrupted sample may get through, and the sequence numbers
+ *             must account for every frame that did not
+ *   pull      I2C-style 32 byte reads of ready frames; when the reader
+ *             stalls the sender drops new samples and counts them
+ *   commands  ESP32 to Nano commands, with one lost on the way
+ *   cobs      random buffers, zero runs and 254 byte blocks round trip
+ *
+ * The v5 handler also ran a 750 ms DS18B20 conversion; that time is not
+ * in the host figures.
+ *
+ * Usage: link_bench [--quick]
+ */
+
+#include <Arduino.h>
+#include <sensor_link.h>
+
+#include "../sim/heap_stats.h"
+#include "bench_util.h"
+
+#include <deque>
+#include <math.h>
+#include <string>
+
+namespace {
+
+const unsigned long SAMPLE_MS = 100;
+const uint8_t I2C_READ = 32;
+
+LinkSample makeSample(uint32_t i) {
+  LinkSample s;
+  s.timestamp = 1000 + i * SAMPLE_MS;
+  s.heartRate = 55.0f + (float)(i * 37 % 900) / 10.0f;
+  s.spO2 = 90.0f + (float)(i * 13 % 100) / 10.0f;
+  s.temperature = 35.5f + (float)(i * 7 % 300) / 100.0f;
+  s.accelX = sinf((float)i) * 2.0f;
+  s.accelY = cosf((float)i) * 2.0f;
+  s.accelZ = 9.81f;
+  s.flags = (uint8_t)(i % 97 == 0 ? TELEMETRY_FLAG_FALL : 0);
+  return s;
+}
+
+bool sameSample(const LinkSample& a, const LinkSample& b) {
+  return a.timestamp == b.timestamp && fabsf(a.heartRate - b.heartRate) <= 0.051f &&
+         fabsf(a.spO2 - b.spO2) <= 0.051f && fabsf(a.temperature - b.temperature) <= 0.0051f &&
+         fabsf(a.accelX - b.accelX) <= 0.0051f && fabsf(a.accelY - b.accelY) <= 0.0051f &&
+         fabsf(a.accelZ - b.accelZ) <= 0.0051f && a.flags == b.flags;
+}
+
+// One direction of a UART that can lose and corrupt bytes
+class LossyPipe : public SerialPort {
+public:
+  LossyPipe() : dropRate(0), flipRate(0), seed(12345), bytes(0) {}
+
+  void setFaults(double drop, double flip) {
+    dropRate = drop;
+    flipRate = flip;
+  }
+
+  int available() override { return (int)queue.size(); }
+  int read() override {
+    if (queue.empty()) return -1;
+    uint8_t c = queue.front();
+    queue.pop_front();
+    return c;
+  }
+  size_t write(const uint8_t* data, size_t length) override {
+    for (size_t i = 0; i < length; i++) {
+      bytes++;
+      if (chance(dropRate)) continue;
+      uint8_t c = data[i];
+      if (chance(flipRate)) c ^= (uint8_t)(1 << (next() % 8));
+      queue.push_back(c);
+    }
+    return length;
+  }
+  using SerialPort::write;
+
+  unsigned long long written() const { return bytes; }
+
+private:
+  uint32_t next() {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 8;
+  }
+  bool chance(double p) { return p > 0 && (next() % 1000000) < (uint32_t)(p * 1000000); }
+
+  std::deque<uint8_t> queue;
+  double dropRate;
+  double flipRate;
+  uint32_t seed;
+  unsigned long long bytes;
+};
+
+// Counts what the sender hands the UART without keeping it
+class CountingPort : public SerialPort {
+public:
+  CountingPort() : bytes(0) {}
+  int available() override { return 0; }
+  int read() override { return -1; }
+  size_t write(const uint8_t*, size_t length) override {
+    bytes += length;
+    return length;
+  }
+  using SerialPort::write;
+
+  unsigned long long bytes;
+};
+
+struct Collector {
+  std::vector<LinkSample> samples;
+};
+
+void collect(const LinkSample& sample, void* context) {
+  static_cast<Collector*>(context)->samples.push_back(sample);
+}
+
+// v5 nano_sensors.cpp requestEvent(), minus the sensor reads
+String legacyRequest(const LinkSample& s) {
+  bool fall = (s.flags & TELEMETRY_FLAG_FALL) != 0;
+  return String(s.temperature) + "," + String((int)s.heartRate) + "," + String(fall) + "," + String(310.0f);
+}
+
+void runEncoding(uint32_t count) {
+  printf("encoding: %u samples, one every %lu ms\n", (unsigned)count, SAMPLE_MS);
+  printf("  %-10s %12s %10s %12s %14s\n", "format", "wire B/smp", "ns/smp", "allocs/smp", "handler ns");
+
+  // v5: one 32 byte request per reading, the reply formatted on demand
+  HeapStats before = heapStats();
+  uint64_t start = benchNowNs();
+  size_t textBytes = 0;
+  for (uint32_t i = 0; i < count; i++) textBytes += legacyRequest(makeSample(i)).length();
+  uint64_t legacyNs = benchNowNs() - start;
+  uint64_t legacyAllocs = heapStats().allocations - before.allocations;
+  double legacyPerSample = (double)legacyNs / count;
+  printf("  %-10s %12.1f %10.0f %12.1f %14.0f\n", "csv/i2c", (double)I2C_READ, legacyPerSample,
+         (double)legacyAllocs / count, legacyPerSample);
+
+  // Framed: the batch is encoded in the main loop, the handler only copies
+  LinkSender sender;
+  CountingPort port;
+  before = heapStats();
+  start = benchNowNs();
+  for (uint32_t i = 0; i < count; i++) {
+    sender.add(makeSample(i));
+    sender.flush(port);
+  }
+  sender.seal();
+  sender.flush(port);
+  uint64_t framedNs = benchNowNs() - start;
+  uint64_t framedAllocs = heapStats().allocations - before.allocations;
+
+  // The request handler on its own: 32 bytes of ready frames per call
+  LinkSender pull;
+  std::vector<uint64_t> handler;
+  handler.reserve(count);
+  uint8_t chunk[I2C_READ];
+  for (uint32_t i = 0; i < count; i++) {
+    pull.add(makeSample(i));
+    start = benchNowNs();
+    pull.copyReady(chunk, sizeof(chunk));
+    handler.push_back(benchNowNs() - start);
+  }
+  double wirePerSample = (double)port.bytes / count;
+  printf("  %-10s %12.1f %10.0f %12.1f %14.0f\n", "framed", wirePerSample, (double)framedNs / count,
+         (double)framedAllocs / count, benchMean(handler));
+  double textPerSample = (double)textBytes / count;
+  printf("  v5 text averaged %.1f of the 32 bytes read, with no time stamp or sequence\n", textPerSample);
+
+  check("framed sample smaller than the v5 text", wirePerSample < textPerSample);
+  check("framed encoding without the heap", framedAllocs == 0);
+  check("handler only copies: faster than formatting", benchMean(handler) < legacyPerSample);
+  check("every sample framed", sender.stats().samples == count && sender.stats().dropped == 0);
+}
+
+// Returns false if a corrupted sample got through
+bool runLossy(uint32_t count, double drop, double flip) {
+  LinkSender sender;
+  LossyPipe pipe;
+  Collector got;
+  LinkReceiver receiver(collect, &got);
+  for (uint32_t i = 0; i < count; i++) {
+    // The first frame goes over a clean line: losses before it cannot show
+    pipe.setFaults(i < LINK_BATCH_SAMPLES ? 0 : drop, i < LINK_BATCH_SAMPLES ? 0 : flip);
+    sender.add(makeSample(i));
+    sender.flush(pipe);
+    receiver.poll(pipe);
+  }
+  // A last frame over a clean line so trailing losses show as a gap
+  sender.seal();
+  sender.flush(pipe);
+  receiver.poll(pipe);
+  pipe.setFaults(0, 0);
+  sender.add(makeSample(count));
+  sender.seal();
+  sender.flush(pipe);
+  receiver.poll(pipe);
+
+  const LinkStats& rx = receiver.stats();
+  uint32_t sent = sender.stats().frames;
+  bool intact = true;
+  for (size_t i = 0; i < got.samples.size(); i++) {
+    uint32_t index = (got.samples[i].timestamp - 1000) / SAMPLE_MS;
+    intact = intact && sameSample(got.samples[i], makeSample(index));
+  }
+  printf("  drop %-6.4f flip %-6.4f  frames %6u  received %6u  lost %6u  bad %5u  overruns %3u\n", drop, flip,
+         (unsigned)sent, (unsigned)rx.frames, (unsigned)rx.lost, (unsigned)rx.badFrames, (unsigned)rx.overruns);
+  char detail[64];
+  snprintf(detail, sizeof(detail), "sent %u = received %u + lost %u", (unsigned)sent, (unsigned)rx.frames,
+           (unsigned)rx.lost);
+  check("  sequence numbers account for every frame", sent == rx.frames + rx.lost, detail);
+  return intact;
+}
+
+void runLossyLinks(uint32_t count) {
+  printf("lossy: %u samples per run\n", (unsigned)count);
+  bool intact = true;
+  intact = runLossy(count, 0, 0) && intact;
+  intact = runLossy(count, 0.0005, 0) && intact;
+  intact = runLossy(count, 0, 0.0005) && intact;
+  intact = runLossy(count, 0.002, 0.002) && intact;
+  check("no corrupted sample delivered", intact);
+
+  // A receiver that starts mid-frame picks up at the next delimiter
+  LinkSender sender;
+  LossyPipe pipe;
+  Collector got;
+  LinkReceiver receiver(collect, &got);
+  for (uint32_t i = 0; i < 3 * LINK_BATCH_SAMPLES; i++) {
+    sender.add(makeSample(i));
+    sender.flush(pipe);
+  }
+  for (int i = 0; i < 10; i++) pipe.read();
+  receiver.poll(pipe);
+  check("joining mid-stream resynchronises",
+        got.samples.size() == 2 * LINK_BATCH_SAMPLES && receiver.stats().badFrames == 1);
+}
+
+void runPull(uint32_t count) {
+  printf("pull: 32 byte reads, reader stalls for a while\n");
+  LinkSender sender;
+  Collector got;
+  LinkReceiver receiver(collect, &got);
+  uint8_t chunk[I2C_READ];
+  uint32_t stallFrom = count / 3;
+  uint32_t stallTo = stallFrom + 20 * LINK_BATCH_SAMPLES;
+  unsigned long reads = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    sender.add(makeSample(i));
+    // One read per sample period keeps up with the frames
+    if (i < stallFrom || i >= stallTo) {
+      sender.copyReady(chunk, sizeof(chunk));
+      receiver.feed(chunk, sizeof(chunk));
+      reads++;
+    }
+  }
+  sender.seal();
+  while (sender.framesReady()) {
+    sender.copyReady(chunk, sizeof(chunk));
+    receiver.feed(chunk, sizeof(chunk));
+    reads++;
+  }
+  const LinkStats& tx = sender.stats();
+  printf("  reads %lu  frames %u  samples %u  dropped at the sender %u  lost %u\n", reads,
+         (unsigned)receiver.stats().frames, (unsigned)got.samples.size(), (unsigned)tx.dropped,
+         (unsigned)receiver.stats().lost);
+  check("stalled reader: drops counted at the sender", tx.dropped > 0 && tx.samples + tx.dropped == count);
+  check("no frame lost once sealed", receiver.stats().lost == 0 && receiver.stats().badFrames == 0);
+  check("every kept sample arrives", got.samples.size() == tx.samples);
+}
+
+struct CommandLog {
+  std::vector<LinkCommand> commands;
+};
+
+void onCommand(const LinkCommand& command, void* context) {
+  static_cast<CommandLog*>(context)->commands.push_back(command);
+}
+
+void runCommands() {
+  printf("commands: ESP32 to sensor board\n");
+  LinkSender sender;
+  CommandLog log;
+  sender.onCommand(onCommand, &log);
+  LinkReceiver receiver(nullptr, nullptr);
+  LossyPipe downlink;
+  bool values = true;
+  for (uint16_t i = 0; i < 100; i++) {
+    // The 50th goes out on a line that eats it
+    downlink.setFaults(i == 50 ? 1.0 : 0, 0);
+    receiver.sendCommand(downlink, LINK_COMMAND_SAMPLE_PERIOD, (uint16_t)(100 + i));
+    size_t before = log.commands.size();
+    sender.receive(downlink);
+    if (log.commands.size() > before) {
+      values = values && log.commands.back().code == LINK_COMMAND_SAMPLE_PERIOD &&
+               log.commands.back().value == 100 + i;
+    }
+  }
+  printf("  commands %u  received %u  lost %u\n", 100, (unsigned)log.commands.size(),
+         (unsigned)sender.commandStats().lost);
+  check("commands arrive with their values", log.commands.size() == 99 && values);
+  check("a lost command shows in the sequence", sender.commandStats().lost == 1);
+}
+
+void runCobs(uint32_t rounds) {
+  printf("cobs: %u random buffers\n", (unsigned)rounds);
+  uint8_t in[600];
+  uint8_t encoded[610];
+  uint8_t decoded[610];
+  uint32_t seed = 99;
+  bool ok = true;
+  for (uint32_t r = 0; r < rounds && ok; r++) {
+    seed = seed * 1103515245u + 12345u;
+    size_t length = 1 + (seed >> 8) % sizeof(in);
+    uint8_t mode = (uint8_t)(r % 3);
+    for (size_t i = 0; i < length; i++) {
+      seed = seed * 1103515245u + 12345u;
+      // Mixed bytes, mostly zeros, or no zeros at all (254 byte blocks)
+      uint8_t b = (uint8_t)(seed >> 16);
+      in[i] = mode == 0 ? b : mode == 1 ? (uint8_t)(b < 200 ? 0 : b) : (uint8_t)(b | 1);
+    }
+    size_t n = cobsEncode(in, length, encoded);
+    ok = n <= length + length / 254 + 1 && memchr(encoded, 0, n) == nullptr;
+    ok = ok && cobsDecode(encoded, n, decoded) == length && memcmp(in, decoded, length) == 0;
+  }
+  check("round trip, no zero in the encoding", ok);
+  uint8_t bad[] = {3, 1, 0};
+  check("embedded zero rejected", cobsDecode(bad, sizeof(bad), decoded) == 0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  Serial.setEcho(false);
+  runEncoding(quick ? 20000 : 1000000);
+  runLossyLinks(quick ? 20000 : 500000);
+  runPull(quick ? 2000 : 100000);
+  runCommands();
+  runCobs(quick ? 3000 : 100000);
+  return benchResult();
+}
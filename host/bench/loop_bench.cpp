@@ -0,0 +1,260 @@
+/*
+ * RescueNet AI - Main loop benchmark
+ *
+ * Runs HealthMonitor::loop() against the simulated board and reports:
+ *  - CPU cost of one loop() iteration on this workstation (the simulated
+ *    delay() calls are free, so this is pure firmware work),
+ *  - heap allocations and bytes per iteration,
+ *  - the scheduler's per-task run time, lateness and deadline misses,
+ *  - end-to-end alert latency in device time, from the moment an
+ *    emergency condition starts (for falls: the impact) to the alert POST
+ *    and the SMS delivery,
+ *  - the deepest stack loop() reaches in steady state and through an
+ *    alert, and the heap allocations of both without the modem (the
+ *    simulated SIM800L allocates for its own bookkeeping); the firmware
+ *    builds every message in fixed buffers, so there should be none.
+ *
+ * Usage: loop_bench [--quick]
+ */
+
+#include <Arduino.h>
+#include <health_monitor.h>
+
+#include "../sim/heap_stats.h"
+#include "../sim/motion_traces.h"
+#include "../sim/sim_hal.h"
+#include "../sim/sim_rig.h"
+#include "bench_util.h"
+
+namespace {
+
+// With the SIM800L on the board's modem, or without one
+struct Rig : SimRig {
+  Sim800l modem;
+
+  explicit Rig(bool withModem = true)
+    : SimRig(simMonitorConfig(), modemParts(withModem ? &modem : nullptr)),
+      modem(board.modem, SIM800L_PWR_PIN, SIM800L_RST_PIN) {}
+
+  static MonitorHal modemParts(Sim800l* modem) {
+    MonitorHal parts = MonitorHal();
+    parts.modem = modem;
+    return parts;
+  }
+
+  void boot() {
+    SimRig::boot();
+    modem.begin();
+  }
+};
+
+// First emergency POST at or after startMs
+long alertPostAt(const SimHttp& http, unsigned long startMs) {
+  for (size_t i = 0; i < http.requests().size(); i++) {
+    const SimHttp::Request& r = http.requests()[i];
+    if (r.startedMs >= startMs && r.url == EMERGENCY_URL) return (long)r.completedMs;
+  }
+  return -1;
+}
+
+long smsDeliveredAt(const SimModem& modem, unsigned long startMs) {
+  for (size_t i = 0; i < modem.sentMessages().size(); i++) {
+    if (modem.sentMessages()[i].submittedMs >= startMs) return (long)modem.sentMessages()[i].deliveredMs;
+  }
+  return -1;
+}
+
+void runSteadyState(unsigned long virtualSeconds) {
+  Rig rig;
+  rig.board.http.setRecordBodies(false);
+  rig.boot();
+
+  std::vector<uint64_t> costs;
+  costs.reserve(virtualSeconds * 120);
+  HeapStats before = heapStats();
+  heapResetPeak();
+  unsigned long end = millis() + virtualSeconds * 1000UL;
+  while (millis() < end) {
+    uint64_t start = benchNowNs();
+    rig.monitor.loop();
+    costs.push_back(benchNowNs() - start);
+  }
+  HeapStats after = heapStats();
+
+  size_t iterations = costs.size();
+  double allocs = (double)(after.allocations - before.allocations) / (double)iterations;
+  double bytes = (double)(after.bytesAllocated - before.bytesAllocated) / (double)iterations;
+  double mean = benchMean(costs);
+  uint64_t p50 = benchPercentile(costs, 50);
+  uint64_t p99 = benchPercentile(costs, 99);
+  uint64_t worst = costs.back();
+
+  printf("steady state: %lu virtual s, %zu iterations\n", virtualSeconds, iterations);
+  printf("  loop cost     mean %.0f ns  p50 %llu ns  p99 %llu ns  max %llu ns\n", mean,
+         (unsigned long long)p50, (unsigned long long)p99, (unsigned long long)worst);
+  printf("  heap churn    %.2f allocs/iter  %.1f bytes/iter  %llu allocs in all  peak in use %lld bytes\n", allocs,
+         bytes, (unsigned long long)(after.allocations - before.allocations),
+         (long long)(after.peakBytesInUse - before.bytesInUse));
+  printf("  uplink        %zu POSTs  %llu bytes\n", rig.board.http.requests().size(),
+         rig.board.http.bytesSent());
+
+  const Scheduler& tasks = rig.monitor.tasks();
+  printf("  %-8s %8s %18s %18s %7s %8s\n", "task", "runs", "run us mean/max", "late us mean/max", "missed",
+         "skipped");
+  for (TaskId id = 0; id < SCHEDULER_MAX_TASKS; id++) {
+    const TaskStats* s = tasks.stats(id);
+    if (!s) continue;
+    char run[32], late[32];
+    snprintf(run, sizeof(run), "%lu / %lu", (unsigned long)(s->runs ? s->runUsTotal / s->runs : 0),
+             (unsigned long)s->runUsMax);
+    snprintf(late, sizeof(late), "%lu / %lu", (unsigned long)(s->runs ? s->lateUsTotal / s->runs : 0),
+             (unsigned long)s->lateUsMax);
+    printf("  %-8s %8lu %18s %18s %7u %8u\n", tasks.name(id), (unsigned long)s->runs, run, late,
+           s->missedDeadlines, s->skipped);
+  }
+}
+
+enum Scenario { FEVER, BUTTON, FALL };
+
+const char* scenarioName(Scenario s) {
+  switch (s) {
+    case FEVER: return "fever onset";
+    case BUTTON: return "button hold";
+    default: return "forward fall";
+  }
+}
+
+// Returns the number of trials where no alert was raised
+int runLatency(Scenario scenario, int trials) {
+  std::vector<long> postLatency;
+  std::vector<long> smsLatency;
+  int missed = 0;
+  unsigned long imuLost = 0;
+
+  for (int trial = 0; trial < trials; trial++) {
+    Rig rig;
+    rig.boot();
+    // Let the monitor settle, then start the event at a varying loop phase
+    unsigned long settle = millis() + 40000UL;
+    while (millis() < settle) rig.monitor.loop();
+    unsigned long onset = millis() + (unsigned long)(trial * 997L % 5000L);
+    while (millis() < onset) rig.monitor.loop();
+    onset = millis();
+
+    if (scenario == FEVER) rig.board.temp.setCelsius(39.4f);
+    if (scenario == BUTTON) simSetPinInput(BUTTON_EMERGENCY_PIN, LOW);
+    if (scenario == FALL) {
+      // Latency counts from the impact, not from the walk leading up to it
+      MotionTrace fall = makeMotionTraces(100, 1)[0];
+      rig.board.imu.play(fall.samples, onset);
+      onset += fall.impactIndex * 10;
+    }
+
+    unsigned long deadline = onset + 60000UL;
+    while (millis() < deadline && !rig.monitor.inEmergency()) {
+      if (scenario == BUTTON && millis() - onset >= 2500) simSetPinInput(BUTTON_EMERGENCY_PIN, HIGH);
+      rig.monitor.loop();
+    }
+    simSetPinInput(BUTTON_EMERGENCY_PIN, HIGH);
+    // The SMS goes out from the modem task after the alert is raised
+    while (millis() < deadline && rig.board.modem.sentMessages().empty()) rig.monitor.loop();
+
+    long post = alertPostAt(rig.board.http, onset);
+    long sms = smsDeliveredAt(rig.board.modem, onset);
+    imuLost += rig.monitor.motionStream().stats().fifoOverflows;
+    if (post < 0) {
+      missed++;
+      continue;
+    }
+    postLatency.push_back(post - (long)onset);
+    if (sms >= 0) smsLatency.push_back(sms - (long)onset);
+  }
+
+  printf("  %-16s trials %d  missed %d", scenarioName(scenario), trials, missed);
+  if (!postLatency.empty()) {
+    printf("  POST mean %.0f ms p99 %ld ms", benchMean(postLatency), benchPercentile(postLatency, 99));
+  }
+  if (!smsLatency.empty()) {
+    printf("  SMS mean %.0f ms p99 %ld ms", benchMean(smsLatency), benchPercentile(smsLatency, 99));
+  }
+  // Blocking for longer than the 850 ms IMU FIFO loses samples, and with them falls
+  if (imuLost) printf("  IMU samples lost %lu", imuLost);
+  printf("\n");
+  return missed;
+}
+
+struct MemoryRun {
+  Rig* rig;
+  bool withModem;
+  bool fever;
+  unsigned long virtualMs;
+  uint64_t allocations;
+};
+
+// Runs loop() for virtualMs; with fever set, from the onset until the
+// alert and the SMS are out
+void runMemory(void* arg) {
+  MemoryRun* run = (MemoryRun*)arg;
+  Rig& rig = *run->rig;
+  HeapStats before = heapStats();
+  unsigned long end = millis() + run->virtualMs;
+  if (run->fever) rig.board.temp.setCelsius(39.4f);
+  bool alerted = false;
+  while (millis() < end) {
+    rig.monitor.loop();
+    // The POST and the SMS are out within 10 s of the alert (runLatency)
+    if (run->fever && !alerted && rig.monitor.inEmergency()) {
+      alerted = true;
+      end = millis() + 10000UL;
+    }
+  }
+  run->allocations = heapStats().allocations - before.allocations;
+}
+
+// Stack high water and heap allocations of one stretch after a settled boot
+MemoryRun measureMemory(bool withModem, bool fever, size_t& stack) {
+  Rig rig(withModem);
+  rig.board.http.setRecordBodies(false);
+  rig.boot();
+  unsigned long settle = millis() + 40000UL;
+  while (millis() < settle) rig.monitor.loop();
+  MemoryRun run = {&rig, withModem, fever, 60000UL, 0};
+  stack = stackHighWater(runMemory, &run);
+  return run;
+}
+
+// Returns the allocations the firmware made without the modem
+uint64_t runMemoryReport() {
+  printf("memory (60 virtual s, or until the alert is out):\n");
+  printf("  %-26s %12s %8s\n", "run", "stack bytes", "allocs");
+  uint64_t firmwareAllocations = 0;
+  const char* names[] = {"steady state", "fever alert", "steady state, no modem", "fever alert, no modem"};
+  for (int i = 0; i < 4; i++) {
+    size_t stack = 0;
+    bool withModem = i < 2;
+    MemoryRun run = measureMemory(withModem, i % 2 == 1, stack);
+    printf("  %-26s %12zu %8llu\n", names[i], stack, (unsigned long long)run.allocations);
+    if (!withModem) firmwareAllocations += run.allocations;
+  }
+  return firmwareAllocations;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  Serial.setEcho(false);
+
+  runSteadyState(quick ? 120 : 3600);
+
+  int trials = quick ? 5 : 50;
+  printf("alert latency (device time):\n");
+  int feverMissed = runLatency(FEVER, trials);
+  int buttonMissed = runLatency(BUTTON, trials);
+  int fallMissed = runLatency(FALL, trials);
+
+  uint64_t allocations = runMemoryReport();
+
+  // Every emergency must raise an alert, without touching the heap
+  return (feverMissed == 0 && buttonMissed == 0 && fallMissed == 0 && allocations == 0) ? 0 : 1;
+}
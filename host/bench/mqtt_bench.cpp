@@ -0,0 +1,667 @@
+/*
+ * RescueNet AI - MQTT client benchmark
+ *
+ * Runs the MQTT client (mqtt_client.h) against a simulated broker
+ * (host/sim/mqtt_broker.h) in virtual time, with the outbox a RecordLog
+ * on FileLogStorage, and measures:
+ *
+ *   throughput  a queue of messages through a 40 ms round trip with 1,
+ *               2 and 4 messages in flight: messages/s, PUBLISH to
+ *               PUBACK time, CPU per message; then a steady 10 messages/s
+ *               and how long each takes to reach the broker
+ *   outage      the broker down for a minute while readings go on: the
+ *               longest the loop is held up, the reconnect attempts and
+ *               their spacing, every message delivered once afterwards;
+ *               against the v4.0 reconnectMQTT() loop of connect() and
+ *               delay(5000)
+ *   dead links  a broker that takes TCP but never answers CONNECT, and
+ *               one that stops acknowledging: both noticed within their
+ *               timeouts, and the unacknowledged messages sent again
+ *               with DUP and the same packet ids
+ *   reset       the device resetting with messages unacknowledged: they
+ *               come back from flash and are delivered in order
+ *   commands    messages on <prefix>/command reach the handler and are
+ *               acknowledged
+ *   monitor     HealthMonitor posting through MqttPort: batches of
+ *               records on <prefix>/telemetry, an alert on <prefix>/alert
+ *
+ * With --broker host:port the throughput run also goes to a real broker
+ * (e.g. mosquitto) over loopback or the LAN, in wall time.
+ *
+ * Usage: mqtt_bench [--quick] [--broker host:port]
+ */
+
+#include <Arduino.h>
+#include <health_monitor.h>
+#include <mqtt_client.h>
+#include <record_log.h>
+#include <telemetry.h>
+
+#include "../sim/mqtt_broker.h"
+#include "../sim/posix_tcp.h"
+#include "../sim/sim_hal.h"
+#include "bench_util.h"
+
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const LOG_PATH = "mqtt_bench.log";
+const uint32_t SECTOR = 4096;
+const uint32_t SECTORS = 16;
+const unsigned long ROUND_TRIP_MS = 40;
+const unsigned long POLL_US = 2000;
+const size_t MESSAGE_BYTES = 224;  // Four health records
+const uint32_t BACKLOG = 64;
+const unsigned long MESSAGE_MS = 500;  // Outage runs
+const char* const PREFIX = "rescuenet/1234567890";
+const MqttConfig CONFIG = {"broker.local", 1883, "rescuenet-1234567890", PREFIX, nullptr, nullptr};
+
+std::string topic(const char* leaf) {
+  return std::string(PREFIX) + "/" + leaf;
+}
+
+// Test message: its id, then a pattern derived from it
+size_t makeMessage(uint32_t id, uint8_t* out) {
+  memcpy(out, &id, sizeof(id));
+  for (size_t i = sizeof(id); i < MESSAGE_BYTES; i++) out[i] = (uint8_t)(id * 13 + i);
+  return MESSAGE_BYTES;
+}
+
+// What the broker got on the telemetry topic, against what was published
+struct Delivery {
+  uint32_t unique;
+  uint32_t duplicates;
+  uint32_t outOfOrder;
+  uint32_t damaged;
+  uint32_t flaggedDup;
+};
+
+Delivery delivery(const SimBroker& broker, uint32_t published) {
+  Delivery d;
+  memset(&d, 0, sizeof(d));
+  std::vector<bool> seen(published, false);
+  int64_t previous = -1;
+  std::string telemetry = topic("telemetry");
+  for (const BrokerMessage& m : broker.messages()) {
+    if (m.topic != telemetry) continue;
+    uint32_t id = 0;
+    uint8_t expected[MESSAGE_BYTES];
+    if (m.payload.size() == MESSAGE_BYTES) memcpy(&id, m.payload.data(), sizeof(id));
+    if (m.payload.size() != MESSAGE_BYTES || id >= published ||
+        memcmp(m.payload.data(), expected, makeMessage(id, expected)) != 0) {
+      d.damaged++;
+      continue;
+    }
+    if (m.dup) d.flaggedDup++;
+    if (seen[id]) {
+      d.duplicates++;
+      continue;
+    }
+    seen[id] = true;
+    d.unique++;
+    if ((int64_t)id <= previous) d.outOfOrder++;
+    previous = id;
+  }
+  return d;
+}
+
+// Outbox and client, the parts a reset wipes
+struct Device {
+  RecordLog outbox;
+  MqttClient client;
+
+  Device(LogStorage* storage, TcpClientPort& tcp) : outbox(storage), client(tcp, outbox, CONFIG) {
+    outbox.begin();
+    client.begin();
+  }
+};
+
+// Blank flash for each run
+void erase(FileLogStorage& storage) {
+  storage.remove();
+  storage.open();
+}
+
+void pollFor(MqttClient& client, unsigned long ms) {
+  unsigned long end = millis() + ms;
+  while ((long)(millis() - end) < 0) {
+    client.poll();
+    simAdvanceMicros(POLL_US);
+  }
+}
+
+// ---------------------------------------------------------------- Throughput
+
+struct Throughput {
+  double perSecond;
+  double ackMeanMs;
+  uint32_t ackMaxMs;
+  double cpuNsPerMessage;
+  Delivery delivered;
+  size_t problems;
+};
+
+Throughput runThroughput(uint8_t inFlight, uint32_t messages) {
+  simSetMillis(0);
+  FileLogStorage storage(LOG_PATH, SECTORS * SECTOR, SECTOR);
+  erase(storage);
+  SimBroker broker;
+  broker.setRoundTrip(ROUND_TRIP_MS);
+  Device device(&storage, broker);
+  device.client.setInFlight(inFlight);
+  pollFor(device.client, 200);
+
+  uint8_t message[MESSAGE_BYTES];
+  uint32_t published = 0;
+  unsigned long started = millis();
+  uint64_t cpuNs = 0;
+  while ((published < messages || device.outbox.pending() > 0) && millis() - started < 3600000UL) {
+    // A backlog always ahead of the window, within what the log holds
+    while (published < messages && device.outbox.pending() < BACKLOG) {
+      device.client.publish(MQTT_TELEMETRY, message, makeMessage(published++, message));
+    }
+    uint64_t t = benchNowNs();
+    device.client.poll();
+    cpuNs += benchNowNs() - t;
+    simAdvanceMicros(POLL_US);
+  }
+
+  Throughput r;
+  unsigned long elapsed = millis() - started;
+  r.perSecond = elapsed ? messages * 1000.0 / elapsed : 0;
+  const MqttStats& stats = device.client.stats();
+  r.ackMeanMs = stats.acked ? (double)stats.ackMsTotal / stats.acked : 0;
+  r.ackMaxMs = stats.ackMsMax;
+  r.cpuNsPerMessage = (double)cpuNs / messages;
+  r.delivered = delivery(broker, messages);
+  r.problems = broker.errors().size();
+  storage.remove();
+  return r;
+}
+
+void runSteady(uint32_t messages) {
+  simSetMillis(0);
+  FileLogStorage storage(LOG_PATH, SECTORS * SECTOR, SECTOR);
+  erase(storage);
+  SimBroker broker;
+  broker.setRoundTrip(ROUND_TRIP_MS);
+  Device device(&storage, broker);
+  pollFor(device.client, 200);
+
+  std::vector<unsigned long> publishedAt(messages);
+  uint8_t message[MESSAGE_BYTES];
+  unsigned long next = millis();
+  uint32_t published = 0;
+  while (published < messages || device.outbox.pending() > 0) {
+    if (published < messages && (long)(millis() - next) >= 0) {
+      publishedAt[published] = millis();
+      device.client.publish(MQTT_TELEMETRY, message, makeMessage(published, message));
+      published++;
+      next += 100;
+    }
+    device.client.poll();
+    simAdvanceMicros(POLL_US);
+  }
+
+  std::vector<double> latencies;
+  std::string telemetry = topic("telemetry");
+  for (const BrokerMessage& m : broker.messages()) {
+    uint32_t id;
+    if (m.topic != telemetry || m.payload.size() != MESSAGE_BYTES) continue;
+    memcpy(&id, m.payload.data(), sizeof(id));
+    if (id < messages) latencies.push_back((double)(m.atMs - publishedAt[id]));
+  }
+  double p50 = benchPercentile(latencies, 50), p99 = benchPercentile(latencies, 99);
+  printf("  steady 10 messages/s: publish() to broker p50 %.0f ms, p99 %.0f ms\n", p50, p99);
+  // Half a round trip on the wire and at most one poll to pick it up
+  check("steady messages reach the broker without queueing", p99 <= ROUND_TRIP_MS / 2 + 2 * POLL_US / 1000 + 1);
+  storage.remove();
+}
+
+void runThroughputs(uint32_t messages) {
+  printf("throughput: %lu messages of %lu bytes, %lu ms round trip, polled every %lu ms\n", (unsigned long)messages,
+         (unsigned long)MESSAGE_BYTES, ROUND_TRIP_MS, POLL_US / 1000);
+  printf("  %-10s %12s %14s %12s %14s\n", "in flight", "messages/s", "ack mean ms", "ack max ms", "CPU ns/msg");
+  const uint8_t windows[] = {1, 2, MQTT_INFLIGHT_MAX};
+  Throughput results[3];
+  bool allDelivered = true;
+  for (int i = 0; i < 3; i++) {
+    Throughput& r = results[i] = runThroughput(windows[i], messages);
+    printf("  %-10u %12.1f %14.1f %12lu %14.0f\n", windows[i], r.perSecond, r.ackMeanMs, (unsigned long)r.ackMaxMs,
+           r.cpuNsPerMessage);
+    allDelivered = allDelivered && r.delivered.unique == messages && r.delivered.duplicates == 0 &&
+                   r.delivered.outOfOrder == 0 && r.delivered.damaged == 0 && r.problems == 0;
+  }
+  check("every message delivered once, in order", allDelivered);
+  check("in-flight window multiplies throughput", results[2].perSecond > results[0].perSecond * (MQTT_INFLIGHT_MAX - 1),
+        std::to_string((int)(results[2].perSecond / results[0].perSecond)) + "x");
+  printf("  client RAM: %lu bytes\n", (unsigned long)sizeof(MqttClient));
+  runSteady(messages / 4);
+}
+
+// ---------------------------------------------------------------- Outage
+
+// The v4.0 loop: delay(100) between passes, a reading when one is due,
+// and when the broker is gone reconnectMQTT() tries every 5 s until it
+// is back. Readings are QoS 0; those due while it waits are never taken.
+struct Baseline {
+  unsigned long longestLoopMs;
+  uint32_t readingsTaken;
+  uint32_t readingsDelivered;
+};
+
+bool baselineConnect(SimBroker& broker) {
+  // PubSubClient::connect(): blocks on TCP, then up to 15 s for CONNACK
+  broker.connect(CONFIG.host, CONFIG.port);
+  while (broker.status() == TCP_CONNECTING) delay(1);
+  if (broker.status() != TCP_CONNECTED) return false;
+  static const uint8_t connect[] = {0x10, 0x1B, 0, 4, 'M', 'Q', 'T', 'T', 4, 0x02, 0, 15, 0, 15,
+                                    'R', 'e', 's', 'c', 'u', 'e', 'N', 'e', 't', 'D', 'e', 'v', 'i', 'c', 'e'};
+  broker.write(connect, sizeof(connect));
+  unsigned long started = millis();
+  uint8_t ack[4];
+  while (millis() - started < 15000) {
+    if (broker.read(ack, sizeof(ack)) == 4 && ack[0] == 0x20 && ack[3] == 0) return true;
+    if (broker.status() != TCP_CONNECTED) return false;
+    delay(1);
+  }
+  broker.close();
+  return false;
+}
+
+Baseline runBaseline(unsigned long outageStart, unsigned long outageEnd, unsigned long end) {
+  simSetMillis(0);
+  SimBroker broker;
+  broker.setRoundTrip(ROUND_TRIP_MS);
+  Baseline b;
+  memset(&b, 0, sizeof(b));
+  bool connected = false;
+  unsigned long nextReading = 0;
+  while (millis() < end) {
+    unsigned long started = millis();
+    broker.setDown(millis() >= outageStart && millis() < outageEnd);
+    if (millis() >= outageStart && millis() < outageEnd && connected) {
+      broker.dropConnection();
+    }
+    connected = broker.status() == TCP_CONNECTED;
+    // reconnectMQTT()
+    while (!connected) {
+      connected = baselineConnect(broker);
+      if (!connected) delay(5000);
+      broker.setDown(millis() >= outageStart && millis() < outageEnd);
+    }
+    if (millis() >= nextReading) {
+      static const uint8_t reading[] = {0x30, 0x05, 0, 1, 'x', 'h', 'r'};
+      broker.write(reading, sizeof(reading));
+      b.readingsTaken++;
+      nextReading = millis() + MESSAGE_MS;
+    }
+    b.longestLoopMs = std::max(b.longestLoopMs, millis() - started);
+    delay(100);
+  }
+  for (const BrokerMessage& m : broker.messages()) b.readingsDelivered += m.topic == "x" ? 1 : 0;
+  return b;
+}
+
+void runOutage() {
+  const unsigned long outageStart = 10000, outageEnd = 70000, end = 150000;
+  printf("outage: a message every %lu ms for %lu s, broker down from %lu s to %lu s\n", MESSAGE_MS, end / 1000,
+         outageStart / 1000, outageEnd / 1000);
+
+  simSetMillis(0);
+  FileLogStorage storage(LOG_PATH, SECTORS * SECTOR, SECTOR);
+  erase(storage);
+  SimBroker broker;
+  broker.setRoundTrip(ROUND_TRIP_MS);
+  Device device(&storage, broker);
+  uint8_t message[MESSAGE_BYTES];
+  uint32_t published = 0;
+  unsigned long nextMessage = 0;
+  unsigned long longestLoopUs = 0;
+  uint64_t longestPollNs = 0;
+  bool dropped = false;
+  unsigned long recoveredMs = 0;
+  while (millis() < end) {
+    unsigned long started = micros();
+    bool down = millis() >= outageStart && millis() < outageEnd;
+    broker.setDown(down);
+    if (down && !dropped) {
+      broker.dropConnection();
+      dropped = true;
+    }
+    if ((long)(millis() - nextMessage) >= 0) {
+      device.client.publish(MQTT_TELEMETRY, message, makeMessage(published++, message));
+      nextMessage += MESSAGE_MS;
+    }
+    uint64_t t = benchNowNs();
+    device.client.poll();
+    longestPollNs = std::max(longestPollNs, benchNowNs() - t);
+    longestLoopUs = std::max(longestLoopUs, micros() - started);
+    if (!down && millis() > outageEnd && recoveredMs == 0 && device.outbox.pending() == 0) {
+      recoveredMs = millis() - outageEnd;
+    }
+    simAdvanceMicros(POLL_US);
+  }
+  pollFor(device.client, 5000);
+
+  // Attempts during the outage, and the gaps between them
+  std::vector<unsigned long> gaps;
+  const std::vector<unsigned long>& attempts = broker.attemptTimes();
+  std::string spacing;
+  for (size_t i = 1; i < attempts.size(); i++) {
+    if (attempts[i - 1] < outageStart || attempts[i - 1] >= outageEnd) continue;
+    gaps.push_back(attempts[i] - attempts[i - 1]);
+    spacing += (spacing.empty() ? "" : " ") + std::to_string((attempts[i] - attempts[i - 1] + 500) / 1000);
+  }
+  bool growing = gaps.size() >= 4;
+  for (size_t i = 0; i + 1 < gaps.size() && i < 4; i++) growing = growing && gaps[i + 1] > gaps[i];
+  Delivery d = delivery(broker, published);
+
+  Baseline v4 = runBaseline(outageStart, outageEnd, end);
+  printf("  %-28s %16s %10s %10s\n", "client", "longest loop ms", "readings", "delivered");
+  printf("  %-28s %16lu %10lu %10lu\n", "v4.0 reconnectMQTT()", v4.longestLoopMs, (unsigned long)v4.readingsTaken,
+         (unsigned long)v4.readingsDelivered);
+  printf("  %-28s %16.3f %10lu %10lu\n", "MqttClient", longestLoopUs / 1000.0, (unsigned long)published,
+         (unsigned long)d.unique);
+  printf("  reconnect attempts %lu, seconds apart: %s; longest poll() %.1f us; drained %.1f s after\n",
+         (unsigned long)attempts.size(), spacing.c_str(), longestPollNs / 1000.0, recoveredMs / 1000.0);
+  check("v4.0 loop stalls and misses readings", v4.longestLoopMs >= outageEnd - outageStart - 5000 &&
+        v4.readingsTaken + (outageEnd - outageStart - 5000) / MESSAGE_MS < published);
+  check("poll() never waits", longestLoopUs < 1000, std::to_string(longestLoopUs) + " us virtual");
+  check("reconnect backs off", growing && gaps.size() < 12, std::to_string(gaps.size()) + " retries");
+  check("backoff is capped", !gaps.empty() && *std::max_element(gaps.begin(), gaps.end()) <= MQTT_BACKOFF_MAX_MS);
+  check("every message delivered once, in order",
+        d.unique == published && d.duplicates == 0 && d.outOfOrder == 0 && d.damaged == 0);
+  check("will marks the device offline, then online",
+        device.client.stats().disconnects == 1 && broker.retainedStatus() == "online" && broker.errors().empty());
+  storage.remove();
+}
+
+// ---------------------------------------------------------------- Dead links
+
+void runDeadLinks() {
+  printf("dead links: no CONNACK, then PUBACKs held back\n");
+  simSetMillis(0);
+  FileLogStorage storage(LOG_PATH, SECTORS * SECTOR, SECTOR);
+  erase(storage);
+  SimBroker broker;
+  broker.setRoundTrip(ROUND_TRIP_MS);
+  broker.setBlackhole(true);
+  Device device(&storage, broker);
+  pollFor(device.client, 30000);
+  const MqttStats& stats = device.client.stats();
+  unsigned long firstGap = broker.attemptTimes().size() > 1 ? broker.attemptTimes()[1] : 0;
+  printf("  no CONNACK: %lu attempts in 30 s, the second at %.1f s\n", (unsigned long)broker.connectAttempts(),
+         firstGap / 1000.0);
+  check("unanswered CONNECT times out", stats.failures >= 1 && !device.client.connected() &&
+        firstGap >= MQTT_CONNECT_TIMEOUT_MS && firstGap < MQTT_CONNECT_TIMEOUT_MS + 2 * MQTT_BACKOFF_MIN_MS);
+
+  broker.setBlackhole(false);
+  pollFor(device.client, MQTT_BACKOFF_MAX_MS);
+  bool connected = device.client.connected();
+  broker.setHoldAcks(true);
+  uint8_t message[MESSAGE_BYTES];
+  const uint32_t messages = 12;
+  for (uint32_t i = 0; i < messages; i++) device.client.publish(MQTT_TELEMETRY, message, makeMessage(i, message));
+  pollFor(device.client, 1000);
+  size_t firstSent = broker.messages().size();
+  uint8_t heldInFlight = device.client.inFlight();
+  std::vector<uint16_t> firstIds;
+  for (const BrokerMessage& m : broker.messages()) {
+    if (m.topic == topic("telemetry")) firstIds.push_back(m.id);
+  }
+  broker.setHoldAcks(false);
+  unsigned long heldAt = millis();
+  while (device.client.stats().disconnects == 0 && millis() - heldAt < 60000) pollFor(device.client, 10);
+  unsigned long noticedMs = millis() - heldAt;
+  pollFor(device.client, 10000);
+
+  std::vector<uint16_t> resentIds;
+  for (size_t i = firstSent; i < broker.messages().size(); i++) {
+    const BrokerMessage& m = broker.messages()[i];
+    if (m.topic == topic("telemetry") && m.dup) resentIds.push_back(m.id);
+  }
+  Delivery d = delivery(broker, messages);
+  printf("  PUBACKs held: %u in flight, link dropped after %.1f s, %lu resent with DUP, %lu duplicates\n",
+         heldInFlight, noticedMs / 1000.0, (unsigned long)resentIds.size(), (unsigned long)d.duplicates);
+  check("window stops at the in-flight limit", connected && heldInFlight == MQTT_INFLIGHT_MAX &&
+        firstIds.size() == MQTT_INFLIGHT_MAX);
+  check("missing PUBACKs end the session", noticedMs <= MQTT_ACK_TIMEOUT_MS + 500);
+  check("resent with DUP and the same packet ids", resentIds == firstIds);
+  check("all delivered in order after", d.unique == messages && d.outOfOrder == 0 && broker.errors().empty());
+  storage.remove();
+}
+
+// ---------------------------------------------------------------- Reset
+
+void runReset() {
+  printf("reset: the device restarts with messages unacknowledged\n");
+  simSetMillis(0);
+  FileLogStorage storage(LOG_PATH, SECTORS * SECTOR, SECTOR);
+  erase(storage);
+  SimBroker broker;
+  broker.setRoundTrip(ROUND_TRIP_MS);
+  Device* device = new Device(&storage, broker);
+  pollFor(device->client, 500);
+  broker.setHoldAcks(true);
+  uint8_t message[MESSAGE_BYTES];
+  const uint32_t messages = 30;
+  for (uint32_t i = 0; i < messages; i++) {
+    // Alerts are synced at once; the rest with the next page or sync
+    device->client.publish(i % 10 == 9 ? MQTT_ALERT : MQTT_TELEMETRY, message, makeMessage(i, message));
+  }
+  device->outbox.sync();
+  pollFor(device->client, 500);
+
+  // RAM and the connection go; the flash stays
+  delete device;
+  broker.dropConnection();
+  broker.setHoldAcks(false);
+  storage.reopen();
+  broker.clearMessages();
+  device = new Device(&storage, broker);
+  uint32_t recovered = device->outbox.pending();
+  pollFor(device->client, 5000);
+
+  uint32_t unique = 0, outOfOrder = 0, alerts = 0;
+  int64_t previous = -1;
+  for (const BrokerMessage& m : broker.messages()) {
+    uint32_t id;
+    if (m.payload.size() != MESSAGE_BYTES) continue;
+    memcpy(&id, m.payload.data(), sizeof(id));
+    if (m.topic == topic("alert")) alerts++;
+    if ((int64_t)id <= previous) outOfOrder++;
+    previous = id;
+    unique++;
+  }
+  printf("  %lu messages recovered from the outbox, %lu delivered after the reset, %lu alerts\n",
+         (unsigned long)recovered, (unsigned long)unique, (unsigned long)alerts);
+  check("unacknowledged messages survive the reset", recovered == messages);
+  check("and are delivered in order on their topics",
+        unique == messages && outOfOrder == 0 && alerts == messages / 10 && device->outbox.pending() == 0);
+  delete device;
+  storage.remove();
+}
+
+// ---------------------------------------------------------------- Commands
+
+struct Commands {
+  std::vector<std::string> payloads;
+  std::string topic;
+};
+
+void onCommand(const char* topicName, const uint8_t* payload, size_t length, void* context) {
+  Commands* commands = (Commands*)context;
+  commands->topic = topicName;
+  commands->payloads.push_back(std::string((const char*)payload, length));
+}
+
+void runCommands() {
+  printf("commands: the dashboard's messages on %s/command\n", PREFIX);
+  simSetMillis(0);
+  FileLogStorage storage(LOG_PATH, SECTORS * SECTOR, SECTOR);
+  erase(storage);
+  SimBroker broker;
+  broker.setRoundTrip(ROUND_TRIP_MS);
+  Device device(&storage, broker);
+  Commands commands;
+  device.client.onMessage(onCommand, &commands);
+  pollFor(device.client, 500);
+  const char* sent = "{\"type\":\"emergency_response\",\"data\":{\"message\":\"Help is coming\"}}";
+  bool pushed = broker.push(topic("command").c_str(), sent);
+  pollFor(device.client, 500);
+  // The subscription is kept by the broker across a reconnect
+  broker.dropConnection();
+  pollFor(device.client, 3000);
+  bool again = broker.push(topic("command").c_str(), sent);
+  pollFor(device.client, 500);
+  check("subscribed and delivered to the handler", pushed && again && commands.payloads.size() == 2 &&
+        commands.payloads[0] == sent && commands.topic == topic("command"));
+  check("commands acknowledged", broker.pushesAcked() == 2 && device.client.stats().received == 2);
+  storage.remove();
+}
+
+// ---------------------------------------------------------------- Monitor
+
+void runMonitor() {
+  printf("monitor: readings and an alert through MqttPort\n");
+  simSetMillis(0);
+  FileLogStorage storage(LOG_PATH, SECTORS * SECTOR, SECTOR);
+  erase(storage);
+  SimBroker broker;
+  broker.setRoundTrip(ROUND_TRIP_MS);
+  RecordLog outbox(&storage);
+  outbox.begin();
+  MqttClient client(broker, outbox, CONFIG);
+  client.begin();
+  MqttPort port(client);
+  SimBoard board;
+  MonitorHal hal = {&board.ppg, &board.imu, &board.temp, &port, nullptr, nullptr, &board.display,
+                    nullptr, nullptr, nullptr, nullptr, nullptr};
+  MonitorConfig config = {"1234567890", "telemetry", "alert", "", 2, 5, 18, NO_PIN, 0, true, POWER_FIXED};
+  HealthMonitor monitor(hal, config);
+  monitor.begin();
+  monitor.setNetworkConnected(true);
+
+  unsigned long end = millis() + 3 * 60000UL;
+  while (millis() < end) {
+    monitor.loop();
+    client.poll();
+  }
+  monitor.triggerEmergency("Manual emergency button pressed");
+  end = millis() + 10000UL;
+  while (millis() < end) {
+    monitor.loop();
+    client.poll();
+  }
+
+  uint32_t records = 0, damaged = 0, alerts = 0, telemetryMessages = 0;
+  for (const BrokerMessage& m : broker.messages()) {
+    bool isAlert = m.topic == topic("alert");
+    if (!isAlert && m.topic != topic("telemetry")) continue;
+    (isAlert ? alerts : telemetryMessages)++;
+    size_t at = 0;
+    while (at < m.payload.size()) {
+      TelemetryRecord record;
+      char userId[TELEMETRY_USER_ID_MAX + 1];
+      char reason[TELEMETRY_REASON_MAX + 1];
+      const uint8_t* data = (const uint8_t*)m.payload.data() + at;
+      size_t length = data[3] == TELEMETRY_EMERGENCY ? TELEMETRY_HEALTH_SIZE + 1 + data[TELEMETRY_HEALTH_SIZE - 2]
+                                                     : TELEMETRY_HEALTH_SIZE;
+      if (at + length > m.payload.size() || !decodeTelemetry(data, length, record, userId, reason)) {
+        damaged++;
+        break;
+      }
+      records++;
+      at += length;
+    }
+  }
+  printf("  %lu records in %lu telemetry messages, %lu alert message(s)\n", (unsigned long)records,
+         (unsigned long)telemetryMessages, (unsigned long)alerts);
+  check("readings arrive as whole records", records > 0 && telemetryMessages > 0 && damaged == 0);
+  check("alert arrives on the alert topic", alerts == 1 && outbox.pending() == 0);
+  storage.remove();
+}
+
+// ---------------------------------------------------------------- Real broker
+
+void runBroker(const char* address, uint32_t messages) {
+  std::string host(address);
+  uint16_t port = 1883;
+  size_t colon = host.rfind(':');
+  if (colon != std::string::npos) {
+    port = (uint16_t)atoi(host.c_str() + colon + 1);
+    host.resize(colon);
+  }
+  printf("broker %s:%u: %lu messages of %lu bytes in wall time\n", host.c_str(), port, (unsigned long)messages,
+         (unsigned long)MESSAGE_BYTES);
+  simRealTime(true);
+  FileLogStorage storage(LOG_PATH, SECTORS * SECTOR, SECTOR);
+  erase(storage);
+  PosixTcpClient tcp;
+  MqttConfig config = CONFIG;
+  config.host = host.c_str();
+  config.port = port;
+  RecordLog outbox(&storage);
+  outbox.begin();
+  MqttClient client(tcp, outbox, config);
+  client.begin();
+  unsigned long deadline = millis() + 5000;
+  while (!client.connected() && millis() < deadline) client.poll();
+  if (!client.connected()) {
+    check("connects to the broker", false);
+    simRealTime(false);
+    return;
+  }
+  uint8_t message[MESSAGE_BYTES];
+  uint64_t started = benchNowNs();
+  uint32_t published = 0;
+  while ((published < messages || outbox.pending() > 0) && benchNowNs() - started < 60000000000ULL) {
+    while (published < messages && outbox.pending() < BACKLOG) {
+      client.publish(MQTT_TELEMETRY, message, makeMessage(published++, message));
+    }
+    client.poll();
+  }
+  double seconds = (benchNowNs() - started) / 1e9;
+  const MqttStats& stats = client.stats();
+  printf("  %.0f messages/s, ack mean %.2f ms, max %lu ms\n", stats.acked / seconds,
+         stats.acked ? (double)stats.ackMsTotal / stats.acked : 0.0, (unsigned long)stats.ackMsMax);
+  check("every message acknowledged", stats.acked == messages && outbox.pending() == 0);
+  simRealTime(false);
+  storage.remove();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  const char* brokerAddress = nullptr;
+  for (int i = 1; i + 1 < argc; i++) {
+    if (strcmp(argv[i], "--broker") == 0) brokerAddress = argv[i + 1];
+  }
+  Serial.setEcho(false);
+  randomSeed(7);
+  printf("RescueNet MQTT client benchmark%s\n\n", quick ? " (quick)" : "");
+
+  runThroughputs(quick ? 400 : 4000);
+  printf("\n");
+  runOutage();
+  printf("\n");
+  runDeadLinks();
+  printf("\n");
+  runReset();
+  printf("\n");
+  runCommands();
+  printf("\n");
+  runMonitor();
+  if (brokerAddress) {
+    printf("\n");
+    runBroker(brokerAddress, quick ? 1000 : 10000);
+  }
+
+  printf("\n%s\n", benchFailures() == 0 ? "All checks passed" : "Some checks FAILED");
+  return benchResult();
+}
@@ -0,0 +1,360 @@
+/*
+ * RescueNet AI - Two-core pipeline benchmark
+ *
+ * Checks the handoff between the acquisition and network loops of
+ * monitor_pipeline.h on real threads, then runs the monitor both ways
+ * against a slow server:
+ *
+ *   ring      SpscRing with a producer and a consumer thread: items
+ *             arrive whole and in order, every refused push is counted,
+ *             and a slow consumer makes the producer drop rather than
+ *             wait; pushes per second with a lossless producer
+ *   pipeline  MonitorPipeline the same way, with alerts among readings:
+ *             no alert is lost while readings are shed
+ *   monitor   HealthMonitor as one loop, then as two threads, in real
+ *             time with alert POSTs that take HTTP_LATENCY_MS: sensor
+ *             FIFO overflows, worst lateness of the PPG drain, alert
+ *             latency from the button press to the POST completing, the
+ *             latency of each pipeline stage, and the radio time the
+ *             network loop hands back to the power ledger
+ *
+ * The monitor section runs in wall time (simRealTime()), so its figures
+ * vary with the machine; the checks only compare the two layouts.
+ *
+ * Usage: pipeline_bench [--quick]
+ */
+
+#include <Arduino.h>
+#include <health_monitor.h>
+
+#include "../sim/sim_hal.h"
+#include "../sim/sim_rig.h"
+#include "bench_util.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+namespace {
+
+// Longer than the 320 ms the PPG FIFO holds at 100 Hz
+const unsigned long HTTP_LATENCY_MS = 500;
+const unsigned long PRESS_EVERY_MS = 1000;
+const unsigned long DASHBOARD_EVERY_MS = 700;
+
+// ---------------------------------------------------------------- ring
+
+// Large enough that a torn copy would show in the check word
+struct Item {
+  uint32_t sequence;
+  uint32_t payload[14];
+  uint32_t check;
+};
+
+Item makeItem(uint32_t sequence) {
+  Item item;
+  item.sequence = sequence;
+  for (int i = 0; i < 14; i++) item.payload[i] = sequence * 2654435761u + (uint32_t)i;
+  item.check = ~sequence;
+  return item;
+}
+
+bool intact(const Item& item) {
+  if (item.check != ~item.sequence) return false;
+  for (int i = 0; i < 14; i++) {
+    if (item.payload[i] != item.sequence * 2654435761u + (uint32_t)i) return false;
+  }
+  return true;
+}
+
+struct RingRun {
+  uint32_t produced;
+  uint32_t consumed;
+  uint32_t dropped;
+  size_t highWater;
+  bool whole;
+  bool ordered;
+  double seconds;
+};
+
+// lossless: the producer retries a refused push instead of dropping it,
+// so refusals count retries.
+// slowEvery: the consumer sleeps 50 us after that many items.
+RingRun runRing(uint32_t count, bool lossless, uint32_t slowEvery) {
+  SpscRing<Item, 64> ring;
+  std::atomic<bool> done(false);
+  RingRun run = {count, 0, 0, 0, true, true, 0};
+
+  uint64_t start = benchNowNs();
+  std::thread consumer([&] {
+    Item item;
+    uint32_t next = 0;
+    bool first = true;
+    for (;;) {
+      if (!ring.pop(item)) {
+        if (done.load(std::memory_order_acquire) && ring.empty()) break;
+        std::this_thread::yield();
+        continue;
+      }
+      run.whole = run.whole && intact(item);
+      // Drops leave gaps; anything else out of order is a fault
+      if (!first && item.sequence < next) run.ordered = false;
+      if (lossless && item.sequence != next) run.ordered = false;
+      first = false;
+      next = item.sequence + 1;
+      run.consumed++;
+      if (slowEvery && run.consumed % slowEvery == 0) std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  });
+  for (uint32_t i = 0; i < count; i++) {
+    Item item = makeItem(i);
+    while (!ring.push(item) && lossless) std::this_thread::yield();
+  }
+  done.store(true, std::memory_order_release);
+  consumer.join();
+  run.seconds = (double)(benchNowNs() - start) / 1e9;
+  run.dropped = ring.droppedCount();
+  run.highWater = ring.highWaterMark();
+  return run;
+}
+
+void printRing(const char* label, const RingRun& run) {
+  printf("  %-16s %9u %9u %9u %6u %9.2f\n", label, (unsigned)run.produced, (unsigned)run.consumed,
+         (unsigned)run.dropped, (unsigned)run.highWater, run.produced / run.seconds / 1e6);
+}
+
+void runRings(uint32_t count) {
+  printf("ring: SpscRing<64 byte item, 64>, producer and consumer threads\n");
+  printf("  %-16s %9s %9s %9s %6s %9s\n", "run", "produced", "consumed", "refused", "depth", "Mitems/s");
+  RingRun lossless = runRing(count, true, 0);
+  printRing("lossless", lossless);
+  RingRun dropping = runRing(count, false, 0);
+  printRing("drop when full", dropping);
+  RingRun slow = runRing(count / 4, false, 64);
+  printRing("slow consumer", slow);
+
+  check("lossless: every item, whole and in order", lossless.consumed == count && lossless.whole && lossless.ordered);
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%u = %u + %u", (unsigned)dropping.produced, (unsigned)dropping.consumed,
+           (unsigned)dropping.dropped);
+  check("dropping: produced = consumed + dropped", dropping.produced == dropping.consumed + dropping.dropped,
+        detail);
+  check("dropping: items whole and in order", dropping.whole && dropping.ordered);
+  check("slow consumer: producer sheds instead of waiting",
+        slow.dropped > 0 && slow.produced == slow.consumed + slow.dropped && slow.whole && slow.ordered);
+  check("depth never above capacity", lossless.highWater <= 64 && slow.highWater <= 64);
+}
+
+// ---------------------------------------------------------------- pipeline
+
+void runPipeline(uint32_t count) {
+  printf("pipeline: MonitorPipeline, one alert per 50 readings, network side 5x slower\n");
+  // Stage latencies are stamped with micros()
+  simRealTime(true);
+  MonitorPipeline pipeline;
+  std::atomic<bool> done(false);
+  std::atomic<uint32_t> readingsTaken(0);
+  std::atomic<uint32_t> alertsTaken(0);
+  uint32_t alertsSent = 0;
+  bool alertsInOrder = true;
+
+  std::thread network([&] {
+    PipelineJob job;
+    uint32_t lastAlert = 0;
+    for (;;) {
+      if (!pipeline.takeJob(job)) {
+        if (done.load(std::memory_order_acquire)) break;
+        std::this_thread::yield();
+        continue;
+      }
+      uint32_t sequence;
+      memcpy(&sequence, job.record, sizeof(sequence));
+      if (job.kind == PIPELINE_JOB_ALERT) {
+        if (alertsTaken.load() > 0 && sequence <= lastAlert) alertsInOrder = false;
+        lastAlert = sequence;
+        alertsTaken++;
+      } else {
+        readingsTaken++;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+  });
+
+  uint8_t record[TELEMETRY_MAX_SIZE];
+  memset(record, 0, sizeof(record));
+  for (uint32_t i = 0; i < count; i++) {
+    memcpy(record, &i, sizeof(i));
+    bool alert = i % 50 == 49;
+    if (alert) alertsSent++;
+    pipeline.submit(alert ? PIPELINE_JOB_ALERT : PIPELINE_JOB_READING, record, sizeof(record));
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  // A held alert goes in as the network side makes room
+  for (;;) {
+    pipeline.retryHeld();
+    const PipelineStats& stats = pipeline.stats();
+    if (readingsTaken + alertsTaken + stats.readingsDropped + stats.alertsDropped == count) break;
+    std::this_thread::yield();
+  }
+  done.store(true, std::memory_order_release);
+  network.join();
+  simRealTime(false);
+
+  const PipelineStats& stats = pipeline.stats();
+  printf("  readings %u taken, %u dropped; alerts %u taken, %u held, %u dropped; depth %u\n",
+         (unsigned)readingsTaken, (unsigned)stats.readingsDropped, (unsigned)alertsTaken,
+         (unsigned)stats.alertsHeld, (unsigned)stats.alertsDropped, (unsigned)pipeline.jobHighWater());
+  printf("  queue wait mean %u us, max %u us\n", (unsigned)stats.jobWait.meanUs(), (unsigned)stats.jobWait.maxUs);
+  check("readings shed under backpressure", stats.readingsDropped > 0);
+  check("alerts waited for room, none lost", stats.alertsHeld > 0 && stats.alertsDropped == 0 &&
+                                                 alertsTaken == alertsSent);
+  check("alerts delivered in order", alertsInOrder);
+}
+
+// ---------------------------------------------------------------- monitor
+
+// What a sketch would add on the network side: a dashboard message now and then
+void dashboardTask(void* self) {
+  static_cast<HealthMonitor*>(self)->handleServerMessage("health_alert", "Drink some water");
+}
+
+struct MonitorRun {
+  uint32_t ppgOverflows;
+  uint32_t motionOverflows;
+  uint32_t ppgLateMaxUs;
+  unsigned presses;
+  unsigned alerts;
+  std::vector<unsigned long> alertLatencyMs;
+  PipelineStats stages;
+  size_t jobDepth;
+  size_t eventDepth;
+  uint32_t radioMs;
+};
+
+uint32_t lateMaxUs(const Scheduler& tasks, const char* name) {
+  for (TaskId id = 0; id < SCHEDULER_MAX_TASKS; id++) {
+    const char* taskName = tasks.name(id);
+    if (taskName && strcmp(taskName, name) == 0) return tasks.stats(id)->lateUsMax;
+  }
+  return 0;
+}
+
+MonitorRun runMonitor(MonitorMode mode, unsigned long durationMs) {
+  SimRig rig(simMonitorConfig(POWER_FIXED, true));
+  rig.board.http.setLatencyMs(HTTP_LATENCY_MS);
+  simRealTime(false);
+  rig.boot(mode);
+  rig.monitor.networkTasks().every(DASHBOARD_EVERY_MS, dashboardTask, &rig.monitor, "dashboard");
+  simRealTime(true);
+
+  std::atomic<bool> stop(false);
+  std::thread acquisition([&] {
+    while (!stop.load()) rig.monitor.loop();
+  });
+  std::thread network;
+  if (rig.monitor.pipelined()) {
+    network = std::thread([&] {
+      while (!stop.load()) rig.monitor.networkLoop();
+    });
+  }
+
+  // The button, as the sketch's ISR would latch it
+  std::vector<unsigned long> pressedAt;
+  unsigned long end = millis() + durationMs;
+  unsigned long nextPress = millis() + 200;
+  while (millis() < end) {
+    if ((long)(millis() - nextPress) >= 0) {
+      pressedAt.push_back(millis());
+      rig.monitor.requestManualEmergency();
+      nextPress += PRESS_EVERY_MS;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  // Let the last alert finish
+  std::this_thread::sleep_for(std::chrono::milliseconds(HTTP_LATENCY_MS + 100));
+  stop.store(true);
+  acquisition.join();
+  if (network.joinable()) network.join();
+  simRealTime(false);
+
+  MonitorRun run;
+  run.ppgOverflows = rig.monitor.ppgStream().stats().fifoOverflows;
+  run.motionOverflows = rig.monitor.motionStream().stats().fifoOverflows;
+  run.ppgLateMaxUs = lateMaxUs(rig.monitor.tasks(), "ppg");
+  run.presses = (unsigned)pressedAt.size();
+  run.alerts = 0;
+  size_t press = 0;
+  const std::vector<SimHttp::Request>& requests = rig.board.http.requests();
+  for (size_t i = 0; i < requests.size(); i++) {
+    if (requests[i].url != EMERGENCY_URL) continue;
+    run.alerts++;
+    if (press < pressedAt.size()) run.alertLatencyMs.push_back(requests[i].completedMs - pressedAt[press++]);
+  }
+  run.radioMs = rig.monitor.powerLedger().radioMs;
+  memset(&run.stages, 0, sizeof(run.stages));
+  run.jobDepth = run.eventDepth = 0;
+  if (rig.monitor.pipelined()) {
+    run.stages = rig.monitor.handoff().stats();
+    run.jobDepth = rig.monitor.handoff().jobHighWater();
+    run.eventDepth = rig.monitor.handoff().eventHighWater();
+  }
+  return run;
+}
+
+void printMonitor(const char* label, MonitorRun& run) {
+  double mean = benchMean(run.alertLatencyMs);
+  unsigned long worst = benchPercentile(run.alertLatencyMs, 100);
+  printf("  %-12s %9u %9u %11.1f %8u/%-3u %10.0f %9lu\n", label, (unsigned)run.ppgOverflows,
+         (unsigned)run.motionOverflows, run.ppgLateMaxUs / 1000.0, run.alerts, run.presses, mean, worst);
+}
+
+void printStage(const char* label, const StageLatency& stage) {
+  printf("  %-28s %6u %10u %10u\n", label, (unsigned)stage.count, (unsigned)stage.meanUs(),
+         (unsigned)stage.maxUs);
+}
+
+void runMonitors(unsigned long durationMs) {
+  printf("monitor: %lu ms wall time, alert POST %lu ms, button every %lu ms\n", durationMs, HTTP_LATENCY_MS,
+         PRESS_EVERY_MS);
+  printf("  %-12s %9s %9s %11s %12s %10s %9s\n", "layout", "ppg lost", "imu lost", "ppg late ms", "alerts",
+         "alert ms", "worst ms");
+  MonitorRun single = runMonitor(MONITOR_SINGLE_LOOP, durationMs);
+  printMonitor("single loop", single);
+  MonitorRun split = runMonitor(MONITOR_PIPELINED, durationMs);
+  printMonitor("two threads", split);
+
+  printf("  %-28s %6s %10s %10s\n", "stage", "count", "mean us", "max us");
+  printStage("jobs ring wait", split.stages.jobWait);
+  printStage("alert POST on network", split.stages.alertWork);
+  printStage("events ring wait", split.stages.eventWait);
+  printf("  jobs depth %u, events depth %u; dropped: readings %u, alerts %u, events %u\n",
+         (unsigned)split.jobDepth, (unsigned)split.eventDepth, (unsigned)split.stages.readingsDropped,
+         (unsigned)split.stages.alertsDropped, (unsigned)split.stages.eventsDropped);
+  printf("  radio time in the ledger: single loop %lu ms, two threads %lu ms\n", (unsigned long)single.radioMs,
+         (unsigned long)split.radioMs);
+
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%u -> %u samples", (unsigned)single.ppgOverflows,
+           (unsigned)split.ppgOverflows);
+  check("single loop: POSTs overflow the PPG FIFO", single.ppgOverflows > 0);
+  check("two threads: fewer PPG samples lost", split.ppgOverflows < single.ppgOverflows, detail);
+  check("two threads: PPG drain late by less than a POST", split.ppgLateMaxUs < HTTP_LATENCY_MS * 1000);
+  check("every press alerted in both layouts",
+        single.alerts == single.presses && split.alerts == split.presses && split.presses > 0);
+  check("dashboard messages reach the display", split.stages.eventWait.count > 0);
+  // The last POST may finish after the acquisition loop's last events pass
+  snprintf(detail, sizeof(detail), "%lu ms for %u alerts", (unsigned long)split.radioMs, split.alerts);
+  check("two threads: alert POSTs reach the power ledger",
+        split.alerts > 0 && split.radioMs >= (split.alerts - 1) * HTTP_LATENCY_MS, detail);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  Serial.setEcho(false);
+  runRings(quick ? 200000 : 5000000);
+  runPipeline(quick ? 2000 : 20000);
+  runMonitors(quick ? 3000 : 10000);
+  return benchResult();
+}
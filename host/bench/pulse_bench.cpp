@@ -0,0 +1,156 @@
+/*
+ * RescueNet AI - Beat detector benchmark
+ *
+ * Feeds PulseDetector 100 Hz streams from two kinds of front end and
+ * compares the reported rate with the simulated truth:
+ *
+ *   - MAX3010x IR counts (the SimPpgSensor waveform), at full and weak
+ *     perfusion, with and without sensor noise
+ *   - a 10-bit analog pulse sensor on A0 like the v2.1 Nano, once centred
+ *     on mid-scale and once with a lower baseline (looser contact)
+ *
+ * The analog streams also run through the v2.1 calculateHeartRate() logic
+ * (fixed PULSE_THRESHOLD 550, 300 ms lockout, 60000 / mean interval) as
+ * the baseline being replaced.
+ *
+ * Host ns/sample is printed for reference only; the Nano cycle count is
+ * measured on the board with examples/PulseDetectorCycles, against the
+ * 160000 cycles a 16 MHz ATmega328 has per 10 ms sample.
+ *
+ * Usage: pulse_bench [--quick]
+ */
+
+#include <Arduino.h>
+#include <pulse_detector.h>
+
+#include "../sim/sim_hal.h"
+#include "../sim/sim_random.h"
+#include "bench_util.h"
+
+#include <math.h>
+
+namespace {
+
+const uint16_t RATE_HZ = 100;
+const unsigned long PERIOD_US = 1000000UL / RATE_HZ;
+
+// v2.1 rescue_nano.ino: readPulseSensor() + calculateHeartRate()
+class LegacyThreshold {
+public:
+  void addSample(int value, unsigned long nowMs) {
+    if (value > 550 && nowMs - lastBeatMs > 300) {
+      lastBeatMs = nowMs;
+      beatTimes[beatIndex] = nowMs;
+      beatIndex = (beatIndex + 1) % 5;
+      if (beatCount < 5) beatCount++;
+      if (beatCount < 2) return;
+      unsigned long total = 0;
+      int valid = 0;
+      for (int i = 1; i < beatCount; i++) {
+        unsigned long interval = beatTimes[i] - beatTimes[i - 1];
+        if (interval > 300 && interval < 2000) {
+          total += interval;
+          valid++;
+        }
+      }
+      if (valid > 0) heartRate = constrain((int)(60000 / (total / valid)), 40, 180);
+    }
+  }
+
+  int heartRate = 0;
+
+private:
+  unsigned long beatTimes[5] = {0};
+  unsigned long lastBeatMs = 0;
+  int beatIndex = 0;
+  int beatCount = 0;
+};
+
+enum Source { MAX_IR, ANALOG };
+
+struct Case {
+  const char* label;
+  Source source;
+  float perfusion;
+  int noise;       // Peak noise in sensor counts
+  int baseline;    // ADC mid-level for the analog sensor
+  bool checked;    // Must stay within tolerance
+};
+
+struct Result {
+  float detectorBpm;
+  int legacyBpm;
+  uint16_t beats;
+  double nsPerSample;
+};
+
+Result run(const Case& c, float bpm, unsigned long seconds) {
+  SimPpgSensor wave;
+  wave.setHeartRate(bpm);
+  wave.setPerfusion(c.perfusion);
+  PulseDetector detector(RATE_HZ);
+  LegacyThreshold legacy;
+  SimRandom noise;
+
+  uint64_t cpuNs = 0;
+  unsigned long samples = seconds * RATE_HZ;
+  for (unsigned long i = 0; i < samples; i++) {
+    unsigned long long t = (unsigned long long)i * PERIOD_US;
+    int32_t ir = (int32_t)wave.irAt(t);
+    int32_t value;
+    if (c.source == MAX_IR) {
+      value = ir + noise.centered(c.noise);
+    } else {
+      // 1200 counts of IR pulse map to ~60 ADC counts
+      value = c.baseline + (ir - 80000) / 20 + noise.centered(c.noise);
+      value = constrain(value, 0, 1023);
+      legacy.addSample((int)value, (unsigned long)(t / 1000));
+    }
+    uint64_t start = benchNowNs();
+    detector.addSample(value);
+    cpuNs += benchNowNs() - start;
+  }
+
+  Result r;
+  r.detectorBpm = detector.bpmTenths() / 10.0f;
+  r.legacyBpm = legacy.heartRate;
+  r.beats = detector.beats();
+  r.nsPerSample = (double)cpuNs / samples;
+  return r;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  unsigned long seconds = quick ? 30 : 300;
+
+  printf("PulseDetector: %u bytes of RAM (budget %u)\n",
+         (unsigned)sizeof(PulseDetector), (unsigned)PULSE_DETECTOR_RAM_BUDGET);
+
+  const Case cases[] = {
+    {"MAX IR, clean", MAX_IR, 1.0f, 0, 0, true},
+    {"MAX IR, noise +-150", MAX_IR, 1.0f, 150, 0, true},
+    {"MAX IR, weak (0.3)", MAX_IR, 0.3f, 0, 0, true},
+    {"MAX IR, weak + noise", MAX_IR, 0.3f, 100, 0, false},
+    {"A0 mid-scale, noise +-4", ANALOG, 1.0f, 4, 512, true},
+    {"A0 low baseline, noise +-4", ANALOG, 1.0f, 4, 470, true},
+  };
+  const float rates[] = {40, 60, 72, 100, 140, 180};
+
+  for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+    printf("%s:\n", cases[c].label);
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+      Result r = run(cases[c], rates[i], seconds);
+      float expectedBeats = rates[i] * seconds / 60.0f;
+      float error = fabsf(r.detectorBpm - rates[i]);
+      printf("  HR %3.0f  detector %5.1f (err %4.1f, beats %4u/%4.0f)", rates[i], r.detectorBpm,
+             error, (unsigned)r.beats, expectedBeats);
+      if (cases[c].source == ANALOG) printf("  v2.1 threshold %3d", r.legacyBpm);
+      printf("  %5.1f ns/sample\n", r.nsPerSample);
+      if (cases[c].checked && error > 3.0f) benchFailures()++;
+    }
+  }
+
+  return benchResult();
+}
@@ -0,0 +1,571 @@
+/*
+ * RescueNet AI - Trace record and replay benchmark
+ *
+ * Records labeled sensor traces (sensor_trace.h) off the simulated board
+ * through the recording drivers (trace_recorder.h) while HealthMonitor
+ * runs on it, as a device would, then plays each back through a fresh
+ * monitor (trace_replay.h) and reports:
+ *
+ *   - the recorder: trace bytes per second, how full its ring got, a
+ *     console capture with the sketch's messages in between read back,
+ *     records lost to a slow drain, and damaged bytes skipped
+ *   - replay speed: sensor samples per second of host time, and how
+ *     many times faster than real time the detection code ran
+ *   - detection, against each trace's labels: alert latency from the
+ *     labeled onset, the false negative rate over labeled traces, and
+ *     false positives over unlabeled ones and per hour of normal wear
+ *   - memory: the deepest stack and the peak heap of the replayed loop
+ *
+ * and checks that replay raises the alerts the live run did. Traces
+ * named on the command line (a card's file or a console capture) are
+ * replayed and scored with the rest.
+ *
+ * As a regression baseline: --write-baseline file keeps the alert of
+ * every trace and the memory figures, and a later run with --baseline
+ * file fails on a detection that changed, an alert more than a second
+ * later, or 10 % more stack or heap. Throughput is shown against the
+ * baseline but not checked; it depends on the machine. --save dir
+ * writes the synthetic traces out as files.
+ *
+ * Usage: replay_bench [--quick] [--save dir] [--baseline file]
+ *                     [--write-baseline file] [trace ...]
+ */
+
+#include <Arduino.h>
+#include <health_monitor.h>
+#include <sensor_trace.h>
+#include <trace_recorder.h>
+
+#include "../sim/gps_traces.h"
+#include "../sim/heap_stats.h"
+#include "../sim/motion_traces.h"
+#include "../sim/sim_hal.h"
+#include "../sim/sim_rig.h"
+#include "../sim/trace_replay.h"
+#include "bench_util.h"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+namespace {
+
+const uint16_t IMU_RATE_HZ = 100;
+const uint32_t GPS_BAUD = 9600;
+// An alert this long after the labeled onset still counts for it
+const unsigned long MATCH_WINDOW_MS = 60000;
+// Replay and the live run may differ by the bus time the replay skips
+const long AGREE_MS = 1000;
+
+class StringPrint : public Print {
+public:
+  size_t write(uint8_t c) override {
+    data += (char)c;
+    return 1;
+  }
+  size_t write(const uint8_t* bytes, size_t size) override {
+    data.append((const char*)bytes, size);
+    return size;
+  }
+  std::string data;
+};
+
+const char* labelName(uint8_t label) {
+  switch (label) {
+    case TRACE_LABEL_FALL: return "fall";
+    case TRACE_LABEL_HEART_RATE: return "heart rate";
+    case TRACE_LABEL_TEMPERATURE: return "temperature";
+    default: return "-";
+  }
+}
+
+// ---------------------------------------------------------------- recording
+
+struct Scenario {
+  std::string name;
+  uint8_t label;      // What starts at the onset; 0 for nothing
+  float heartRate;    // From the onset on; 0 leaves it
+  float celsius;
+  const MotionTrace* motion;
+};
+
+std::string fileName(const std::string& label) {
+  std::string name;
+  for (size_t i = 0; i < label.size(); i++) {
+    bool word = isalnum((unsigned char)label[i]);
+    if (word) {
+      name += label[i];
+    } else if (!name.empty() && name[name.size() - 1] != '-') {
+      name += '-';
+    }
+  }
+  return name;
+}
+
+std::vector<Scenario> makeScenarios(const std::vector<MotionTrace>& motions) {
+  std::vector<Scenario> scenarios;
+  scenarios.push_back({"rest", 0, 0, 0, nullptr});
+  scenarios.push_back({"warm-day", 0, 0, 37.4f, nullptr});
+  scenarios.push_back({"calm-heart", 0, 58.0f, 0, nullptr});
+  scenarios.push_back({"tachycardia", TRACE_LABEL_HEART_RATE, 150.0f, 0, nullptr});
+  scenarios.push_back({"bradycardia", TRACE_LABEL_HEART_RATE, 38.0f, 0, nullptr});
+  scenarios.push_back({"fever", TRACE_LABEL_TEMPERATURE, 0, 39.6f, nullptr});
+  scenarios.push_back({"hypothermia", TRACE_LABEL_TEMPERATURE, 0, 34.2f, nullptr});
+  std::map<std::string, int> seen;
+  for (size_t i = 0; i < motions.size(); i++) {
+    const MotionTrace& motion = motions[i];
+    std::string name = fileName(motion.label) + "-" + std::to_string(++seen[motion.label]);
+    scenarios.push_back({name, (uint8_t)(motion.fall ? TRACE_LABEL_FALL : 0), 0, 0, &motion});
+  }
+  return scenarios;
+}
+
+struct Recording {
+  std::string name;
+  std::string bytes;
+  long liveAlertMs;  // Since the start, -1 for none
+  unsigned long durationMs;
+  uint32_t ppgRead;  // Samples the live monitor read
+  uint32_t imuRead;
+  TraceWriterStats writer;
+};
+
+// One run of the monitor on the simulated board with the recorder in
+// between. text frames the trace as console lines, with the messages a
+// sketch prints in between; drainEveryMs 0 drains after every pass.
+Recording record(const Scenario& scenario, unsigned long onsetMs, unsigned long afterMs, bool text = false,
+                 unsigned long drainEveryMs = 0) {
+  simSetMillis(0);
+  simSetPinInput(BUTTON_EMERGENCY_PIN, HIGH);
+  randomSeed(11);
+  unsigned long durationMs = onsetMs + afterMs;
+
+  SimBoard board;
+  board.http.setRecordBodies(false);
+  TraceWriter writer;
+  TracingPpg ppg(board.ppg, writer);
+  TracingImu imu(board.imu, writer);
+  TracingTemp temp(board.temp, writer);
+  SimGpsPort uart(GPS_BAUD, 1024);
+  uart.play(makeNmeaTrace(durationMs / 1000 + 1, 5), 0);
+  TracingSerial gpsPort(uart, writer);
+  GpsReceiver gps(gpsPort);
+  MonitorHal hal = {&ppg, &imu, &temp, &board.http,
+                    &board.channel, nullptr, &board.display, nullptr, nullptr,
+                    nullptr, nullptr, &gps};
+  HealthMonitor monitor(hal, simMonitorConfig());
+
+  writer.start(scenario.name.c_str());
+  gps.begin(GPS_BAUD, 1000, false);
+  monitor.begin();
+  monitor.setNetworkConnected(true);
+
+  StringPrint sink;
+  Recording out;
+  out.name = scenario.name;
+  out.liveAlertMs = -1;
+  out.durationMs = durationMs;
+  bool started = false;
+  unsigned long labelAt = onsetMs;
+  if (scenario.motion && scenario.motion->fall) labelAt += scenario.motion->impactIndex * 1000UL / IMU_RATE_HZ;
+  bool labeled = scenario.label == 0;
+  unsigned long nextDrain = 0;
+  unsigned long nextMessage = 0;
+
+  while (millis() < durationMs) {
+    if (!started && millis() >= onsetMs) {
+      started = true;
+      if (scenario.heartRate) board.ppg.setHeartRate(scenario.heartRate);
+      if (scenario.celsius) board.temp.setCelsius(scenario.celsius);
+      if (scenario.motion) board.imu.play(scenario.motion->samples, millis());
+    }
+    if (!labeled && millis() >= labelAt) {
+      labeled = true;
+      writer.label(scenario.label);
+    }
+    monitor.loop();
+    if (out.liveAlertMs < 0 && monitor.inEmergency()) {
+      out.liveAlertMs = (long)millis();
+      writer.alert();
+    }
+    if (text && millis() >= nextMessage) {
+      // What the sketch prints; every other one cut short by a record
+      nextMessage = millis() + 700;
+      sink.print((nextMessage / 700) % 2 ? "Heart Rate: 72 BPM, Temp: 36.6 C\r\n" : "WebSocket disconn");
+    }
+    if (millis() >= nextDrain) {
+      nextDrain = millis() + drainEveryMs;
+      writer.drain(sink, text, drainEveryMs ? 512 : SIZE_MAX);
+    }
+  }
+  while (!writer.idle()) writer.drain(sink, text, SIZE_MAX);
+
+  out.bytes = text ? traceFromText(sink.data) : sink.data;
+  out.ppgRead = monitor.ppgStream().stats().samplesRead;
+  out.imuRead = monitor.motionStream().stats().samplesRead;
+  out.writer = writer.stats();
+  out.writer.bytes = (uint32_t)sink.data.size();
+  return out;
+}
+
+// ---------------------------------------------------------------- replay
+
+struct ReplayRun {
+  ReplayBoard* board;
+  HealthMonitor* monitor;
+  long alertMs;
+  double wallSeconds;
+  uint64_t allocations;
+  int64_t heapPeak;
+};
+
+void runReplay(void* arg) {
+  ReplayRun* run = (ReplayRun*)arg;
+  HeapStats before = heapStats();
+  heapResetPeak();
+  uint64_t started = benchNowNs();
+  while (!run->board->finished()) {
+    run->monitor->loop();
+    if (run->alertMs < 0 && run->monitor->inEmergency()) run->alertMs = (long)(run->board->traceUs() / 1000);
+  }
+  run->wallSeconds = (benchNowNs() - started) / 1e9;
+  HeapStats after = heapStats();
+  run->allocations = after.allocations - before.allocations;
+  run->heapPeak = after.peakBytesInUse - before.bytesInUse;
+}
+
+struct Result {
+  std::string name;
+  uint8_t label;
+  long onsetMs;      // First label, -1 for none
+  long deviceAlertMs;
+  long alertMs;
+  double durationS;
+  double normalS;    // Before the onset, or all of it
+  uint64_t samples;  // PPG and IMU samples and probe reads
+  double wallSeconds;
+  size_t stack;
+  int64_t heapPeak;
+  uint64_t allocations;
+  unsigned mismatches;
+  uint32_t damaged;
+  bool truePositive;
+  bool falseNegative;
+  bool falsePositive;
+};
+
+Result replay(const std::string& name, const SensorTrace& trace) {
+  simSetMillis(0);
+  simSetPinInput(BUTTON_EMERGENCY_PIN, HIGH);
+  randomSeed(11);
+  ReplayBoard board(trace);
+  board.http.setRecordBodies(false);
+  MonitorHal hal = {&board.ppg, &board.imu, &board.temp, &board.http,
+                    &board.channel, nullptr, &board.display, nullptr, nullptr,
+                    nullptr, nullptr, &board.gps};
+  HealthMonitor monitor(hal, simMonitorConfig());
+  board.gps.begin(GPS_BAUD, 1000, false);
+  monitor.begin();
+  monitor.setNetworkConnected(true);
+
+  ReplayRun run = {&board, &monitor, -1, 0, 0, 0};
+  Result r;
+  r.stack = stackHighWater(runReplay, &run);
+  r.name = name;
+  r.label = trace.labels.empty() ? 0 : trace.labels[0].label;
+  r.onsetMs = trace.labels.empty() ? -1 : (long)(trace.labels[0].atUs / 1000);
+  r.deviceAlertMs = trace.alerts.empty() ? -1 : (long)(trace.alerts[0].atUs / 1000);
+  r.alertMs = run.alertMs;
+  r.durationS = trace.durationUs / 1e6;
+  r.normalS = r.onsetMs < 0 ? r.durationS : r.onsetMs / 1000.0;
+  r.samples = board.ppg.replayed() + board.imu.replayed() + board.temp.replayed();
+  r.wallSeconds = run.wallSeconds;
+  r.heapPeak = run.heapPeak;
+  r.allocations = run.allocations;
+  r.mismatches = board.ppg.rateMismatches() + board.imu.rateMismatches();
+  r.damaged = trace.reader.damaged;
+
+  bool early = r.alertMs >= 0 && (r.onsetMs < 0 || r.alertMs < r.onsetMs);
+  r.truePositive = r.onsetMs >= 0 && r.alertMs >= r.onsetMs && r.alertMs - r.onsetMs <= (long)MATCH_WINDOW_MS;
+  r.falseNegative = r.onsetMs >= 0 && !r.truePositive;
+  r.falsePositive = early;
+  return r;
+}
+
+std::string msText(long ms) {
+  return ms < 0 ? "-" : std::to_string(ms);
+}
+
+// ---------------------------------------------------------------- baseline
+
+struct Baseline {
+  std::map<std::string, long> alerts;  // Since the start, -1 for none
+  size_t stack = 0;
+  int64_t heap = 0;
+  double samplesPerSecond = 0;
+};
+
+bool loadBaseline(const char* path, Baseline& out) {
+  std::ifstream in(path);
+  if (!in) return false;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream words(line);
+    std::string key;
+    words >> key;
+    if (key == "trace") {
+      std::string name;
+      long alert;
+      if (words >> name >> alert) out.alerts[name] = alert;
+    } else if (key == "stack") {
+      words >> out.stack;
+    } else if (key == "heap") {
+      words >> out.heap;
+    } else if (key == "samples_per_s") {
+      words >> out.samplesPerSecond;
+    }
+  }
+  return true;
+}
+
+void writeBaseline(const char* path, const std::vector<Result>& results, size_t stack, int64_t heap,
+                   double samplesPerSecond) {
+  std::ofstream out(path);
+  out << "# replay_bench baseline: the first alert of every trace in ms from its start (-1 none)\n";
+  for (size_t i = 0; i < results.size(); i++) out << "trace " << results[i].name << " " << results[i].alertMs << "\n";
+  out << "stack " << stack << "\n";
+  out << "heap " << heap << "\n";
+  out << "samples_per_s " << (long long)samplesPerSecond << "\n";
+}
+
+void compareBaseline(const Baseline& base, const std::vector<Result>& results, size_t stack, int64_t heap,
+                     double samplesPerSecond) {
+  printf("baseline\n");
+  int changed = 0;
+  int later = 0;
+  int compared = 0;
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result& r = results[i];
+    std::map<std::string, long>::const_iterator it = base.alerts.find(r.name);
+    if (it == base.alerts.end()) continue;
+    compared++;
+    long was = it->second;
+    if ((was < 0) != (r.alertMs < 0)) {
+      printf("  %-24s alert %s -> %s\n", r.name.c_str(), msText(was).c_str(), msText(r.alertMs).c_str());
+      changed++;
+    } else if (r.alertMs > was + AGREE_MS) {
+      printf("  %-24s alert %ld -> %ld ms\n", r.name.c_str(), was, r.alertMs);
+      later++;
+    }
+  }
+  char detail[96];
+  snprintf(detail, sizeof(detail), "%d of %d traces", changed, compared);
+  check("no detection changed", changed == 0, detail);
+  snprintf(detail, sizeof(detail), "%d of %d traces", later, compared);
+  check("no alert more than a second later", later == 0, detail);
+  snprintf(detail, sizeof(detail), "%zu -> %zu bytes", base.stack, stack);
+  check("stack within 10 % of the baseline", stack <= base.stack + base.stack / 10, detail);
+  snprintf(detail, sizeof(detail), "%lld -> %lld bytes", (long long)base.heap, (long long)heap);
+  check("heap within 10 % of the baseline", heap <= base.heap + base.heap / 10 + 64, detail);
+  printf("  throughput %.0f -> %.0f samples/s (%.2fx)\n", base.samplesPerSecond, samplesPerSecond,
+         base.samplesPerSecond > 0 ? samplesPerSecond / base.samplesPerSecond : 0.0);
+}
+
+// ---------------------------------------------------------------- recorder checks
+
+void runRecorder(const Scenario& rest) {
+  printf("recorder\n");
+  Recording binary = record(rest, 20000, 10000);
+  Recording text = record(rest, 20000, 10000, true);
+  double seconds = binary.durationMs / 1000.0;
+  printf("  trace        %.0f B/s on a card, %.0f B/s as console lines, ring high water %u of %u B\n",
+         binary.writer.bytes / seconds, text.writer.bytes / seconds, binary.writer.ringHighWater,
+         (unsigned)TRACE_RING_BYTES);
+
+  char detail[96];
+  snprintf(detail, sizeof(detail), "%zu bytes, %u records", text.bytes.size(), text.writer.records);
+  check("console capture reads back as the card's trace", text.bytes == binary.bytes, detail);
+
+  SensorTrace parsed;
+  parseTrace(binary.bytes, parsed);
+  snprintf(detail, sizeof(detail), "PPG %zu/%u  IMU %zu/%u", parsed.ppg.size(), binary.ppgRead, parsed.imu.size(),
+           binary.imuRead);
+  check("trace holds every sample the monitor read",
+        parsed.ppg.size() == binary.ppgRead && parsed.imu.size() == binary.imuRead && parsed.reader.damaged == 0,
+        detail);
+  check("probe reads and GPS bytes recorded", !parsed.temps.empty() && !parsed.gps.empty() &&
+                                                  parsed.tempSearches.size() == 1);
+
+  // Drained 512 bytes every 2 s: a card that keeps stalling
+  Recording slow = record(rest, 20000, 10000, false, 2000);
+  SensorTrace lossy;
+  parseTrace(slow.bytes, lossy);
+  snprintf(detail, sizeof(detail), "%u lost, %u reported", slow.writer.lost, lossy.lostRecords);
+  check("records lost to a slow drain are reported", slow.writer.lost > 0 && lossy.lostRecords > 0 &&
+                                                         lossy.lostRecords <= slow.writer.lost,
+        detail);
+
+  // A byte changed every 4 KB
+  std::string damaged = binary.bytes;
+  for (size_t i = 2048; i < damaged.size(); i += 4096) damaged[i] ^= 0x5A;
+  SensorTrace survived;
+  parseTrace(damaged, survived);
+  size_t hits = (binary.bytes.size() - 2048 + 4095) / 4096;
+  snprintf(detail, sizeof(detail), "%u of %u records, %u bytes skipped", survived.records, parsed.records,
+           survived.reader.damaged);
+  check("damaged records skipped, the rest read",
+        survived.records + hits >= parsed.records && survived.records < parsed.records, detail);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  const char* saveDir = nullptr;
+  const char* baselinePath = nullptr;
+  const char* writeBaselinePath = nullptr;
+  std::vector<const char*> files;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--quick") == 0) continue;
+    if (i + 1 < argc && strcmp(argv[i], "--save") == 0) {
+      saveDir = argv[++i];
+    } else if (i + 1 < argc && strcmp(argv[i], "--baseline") == 0) {
+      baselinePath = argv[++i];
+    } else if (i + 1 < argc && strcmp(argv[i], "--write-baseline") == 0) {
+      writeBaselinePath = argv[++i];
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+  Serial.setEcho(false);
+  printf("RescueNet trace record and replay benchmark%s\n\n", quick ? " (quick)" : "");
+
+  std::vector<MotionTrace> motions = makeMotionTraces(IMU_RATE_HZ, quick ? 1 : 3);
+  std::vector<Scenario> scenarios = makeScenarios(motions);
+  runRecorder(scenarios[0]);
+  printf("\n");
+
+  // The onset once the monitor has learned the wearer (ANOMALY_WARMUP_READINGS
+  // at a reading per 5 s); until then a heart rate only alerts past the hard limits
+  unsigned long onsetMs = ANOMALY_WARMUP_READINGS * 5000UL + 30000UL;
+  unsigned long afterMs = quick ? 60000UL : 120000UL;
+  std::vector<Result> results;
+  std::vector<Recording> recordings;
+  for (size_t i = 0; i < scenarios.size(); i++) {
+    recordings.push_back(record(scenarios[i], onsetMs, afterMs));
+    if (saveDir) {
+      std::ofstream out(std::string(saveDir) + "/" + scenarios[i].name + ".rnt", std::ios::binary);
+      out << recordings.back().bytes;
+    }
+  }
+  int disagreements = 0;
+  long agreeWorst = 0;
+  for (size_t i = 0; i < recordings.size(); i++) {
+    SensorTrace trace;
+    parseTrace(recordings[i].bytes, trace);
+    results.push_back(replay(recordings[i].name, trace));
+    const Result& r = results.back();
+    long live = recordings[i].liveAlertMs;
+    if ((live < 0) != (r.alertMs < 0)) {
+      disagreements++;
+    } else if (live >= 0) {
+      long gap = labs(live - r.alertMs);
+      if (gap > agreeWorst) agreeWorst = gap;
+      if (gap > AGREE_MS) disagreements++;
+    }
+  }
+  size_t synthetic = results.size();
+  for (size_t i = 0; i < files.size(); i++) {
+    SensorTrace trace;
+    if (!parseTrace(loadTraceBytes(files[i]), trace)) {
+      printf("%s: no trace\n", files[i]);
+      benchFailures()++;
+      continue;
+    }
+    std::string name = files[i];
+    size_t slash = name.find_last_of('/');
+    if (slash != std::string::npos) name = name.substr(slash + 1);
+    results.push_back(replay(name, trace));
+  }
+
+  printf("detection: %zu traces of %.0f s, onset at %.0f s (%zu from files)\n", results.size(),
+         (onsetMs + afterMs) / 1000.0, onsetMs / 1000.0, results.size() - synthetic);
+  printf("  %-24s %-11s %9s %9s %9s %9s  %s\n", "trace", "label", "onset ms", "device", "replay", "latency",
+         "result");
+  int labeled = 0, normal = 0, tp = 0, fn = 0, fp = 0;
+  double normalHours = 0;
+  uint64_t samples = 0;
+  double wall = 0, traced = 0;
+  size_t stack = 0;
+  int64_t heap = 0;
+  uint64_t allocations = 0;
+  unsigned mismatches = 0;
+  std::vector<long> latencies[4];
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result& r = results[i];
+    const char* verdict = r.truePositive ? "TP" : r.falseNegative ? "FN" : r.falsePositive ? "FP" : "TN";
+    if (r.falsePositive && r.falseNegative) verdict = "FP+FN";
+    printf("  %-24s %-11s %9s %9s %9s %9s  %s\n", r.name.c_str(), labelName(r.label), msText(r.onsetMs).c_str(),
+           msText(r.deviceAlertMs).c_str(), msText(r.alertMs).c_str(),
+           r.truePositive ? msText(r.alertMs - r.onsetMs).c_str() : "-", verdict);
+    if (r.onsetMs >= 0) {
+      labeled++;
+    } else {
+      normal++;
+    }
+    tp += r.truePositive;
+    fn += r.falseNegative;
+    fp += r.falsePositive;
+    if (r.truePositive) latencies[r.label & 3].push_back(r.alertMs - r.onsetMs);
+    normalHours += r.normalS / 3600.0;
+    samples += r.samples;
+    wall += r.wallSeconds;
+    traced += r.durationS;
+    if (r.stack > stack) stack = r.stack;
+    if (r.heapPeak > heap) heap = r.heapPeak;
+    allocations += r.allocations;
+    mismatches += r.mismatches;
+  }
+  printf("  false negatives  %d of %d labeled (%.1f %%)\n", fn, labeled, labeled ? 100.0 * fn / labeled : 0.0);
+  printf("  false positives  %d of %d unlabeled (%.1f %%), %.2f per hour of normal wear\n", fp, normal,
+         normal ? 100.0 * fp / normal : 0.0, normalHours > 0 ? fp / normalHours : 0.0);
+  for (uint8_t label = TRACE_LABEL_FALL; label <= TRACE_LABEL_TEMPERATURE; label++) {
+    std::vector<long>& l = latencies[label];
+    if (l.empty()) continue;
+    printf("  latency %-11s n %zu  mean %.0f ms  p99 %ld ms  max %ld ms\n", labelName(label), l.size(), benchMean(l),
+           benchPercentile(l, 99), *std::max_element(l.begin(), l.end()));
+  }
+  double samplesPerSecond = wall > 0 ? samples / wall : 0;
+  printf("  replay           %llu samples in %.2f s: %.0f samples/s, %.0fx real time\n",
+         (unsigned long long)samples, wall, samplesPerSecond, wall > 0 ? traced / wall : 0.0);
+  printf("  memory           stack %zu B, heap peak %lld B, %.1f allocations per trace\n", stack, (long long)heap,
+         results.empty() ? 0.0 : (double)allocations / results.size());
+
+  char detail[96];
+  snprintf(detail, sizeof(detail), "%d differ, worst %ld ms apart", disagreements, agreeWorst);
+  check("replay alerts as the live run did", disagreements == 0, detail);
+  snprintf(detail, sizeof(detail), "%u", mismatches);
+  check("replay asked for the recorded sensor rates", mismatches == 0, detail);
+  snprintf(detail, sizeof(detail), "%.0fx", wall > 0 ? traced / wall : 0.0);
+  check("replay runs over 100x real time", wall > 0 && traced / wall > 100, detail);
+  snprintf(detail, sizeof(detail), "%d of %d", fn, labeled);
+  check("every labeled emergency alerted", fn == 0, detail);
+  snprintf(detail, sizeof(detail), "%d of %d", fp, normal);
+  check("no alert without an emergency", fp == 0, detail);
+
+  if (baselinePath) {
+    printf("\n");
+    Baseline base;
+    if (!loadBaseline(baselinePath, base)) {
+      printf("%s: no baseline\n", baselinePath);
+      benchFailures()++;
+    } else {
+      compareBaseline(base, results, stack, heap, samplesPerSecond);
+    }
+  }
+  if (writeBaselinePath) writeBaseline(writeBaselinePath, results, stack, heap, samplesPerSecond);
+
+  printf("\n%s\n", benchFailures() == 0 ? "All checks passed" : "Some checks FAILED");
+  return benchResult();
+}
@@ -0,0 +1,148 @@
+/*
+ * RescueNet AI - Scheduler benchmark
+ *
+ * Three runs of the cooperative scheduler in device (virtual) time:
+ *
+ *   - overhead: a full task table at mixed periods, idling with
+ *     delay(idleMs()) like HealthMonitor::loop(); host ns per dispatch
+ *   - drift: a 40 ms task polled at uneven 1-3 ms intervals must be
+ *     released exactly once per period, with lateness bounded by the
+ *     polling gap rather than growing over the run
+ *   - slow neighbour: a 10 ms sampling task next to a modem task that
+ *     works in 5 ms steps, compared with the old loop where the SMS send
+ *     blocked for 6.1 s; reports the sampler's worst gap and misses
+ *
+ * Usage: sched_bench [--quick]
+ */
+
+#include <Arduino.h>
+#include <scheduler.h>
+
+#include "bench_util.h"
+
+namespace {
+
+struct Counter {
+  uint32_t runs;
+  unsigned long lastMs;
+  unsigned long maxGapMs;
+};
+
+void countTask(void* context) {
+  Counter* c = static_cast<Counter*>(context);
+  unsigned long now = millis();
+  if (c->runs && now - c->lastMs > c->maxGapMs) c->maxGapMs = now - c->lastMs;
+  c->lastMs = now;
+  c->runs++;
+}
+
+// Stands in for one step of a modem exchange: a few ms of UART work
+void slowStepTask(void* context) {
+  countTask(context);
+  delay(5);
+}
+
+bool runOverhead(unsigned long virtualSeconds) {
+  static const uint32_t PERIODS[] = {10, 20, 40, 40, 50, 100, 250, 1000, 2000, 5000, 30000, 60000};
+  const uint8_t count = sizeof(PERIODS) / sizeof(PERIODS[0]) < SCHEDULER_MAX_TASKS
+                          ? sizeof(PERIODS) / sizeof(PERIODS[0]) : SCHEDULER_MAX_TASKS;
+  simSetMillis(0);
+  Scheduler scheduler;
+  Counter counters[SCHEDULER_MAX_TASKS];
+  memset(counters, 0, sizeof(counters));
+  for (uint8_t i = 0; i < count; i++) scheduler.every(PERIODS[i], countTask, &counters[i], "task", i);
+
+  uint64_t cpuNs = 0;
+  unsigned long calls = 0;
+  unsigned long end = virtualSeconds * 1000UL;
+  while (millis() < end) {
+    uint64_t start = benchNowNs();
+    scheduler.run();
+    uint32_t idle = scheduler.idleMs();
+    cpuNs += benchNowNs() - start;
+    calls++;
+    if (idle) delay(idle);
+  }
+
+  bool exact = true;
+  for (uint8_t i = 0; i < count; i++) {
+    // Released at i, i + period, ... up to the end
+    uint32_t expected = (end - 1 - i) / PERIODS[i] + 1;
+    if (counters[i].runs != expected) exact = false;
+  }
+  printf("overhead: %u tasks, %lu virtual s, %lu run() calls, %lu dispatches\n", count, virtualSeconds,
+         calls, (unsigned long)scheduler.dispatches());
+  printf("  %.0f ns per run()+idleMs(), %.0f ns per dispatch, %u bytes of scheduler state\n",
+         (double)cpuNs / calls, (double)cpuNs / scheduler.dispatches(), (unsigned)sizeof(Scheduler));
+  printf("  release counts %s\n", exact ? "exact" : "WRONG");
+  return exact;
+}
+
+bool runDrift(unsigned long virtualSeconds) {
+  simSetMillis(0);
+  Scheduler scheduler;
+  Counter counter = {0, 0, 0};
+  TaskId id = scheduler.every(40, countTask, &counter, "sample");
+  // A loop that comes back at uneven points, as if busy with other work
+  unsigned long end = virtualSeconds * 1000UL;
+  uint32_t seed = 1;
+  while (millis() < end) {
+    scheduler.run();
+    seed = seed * 1103515245UL + 12345UL;
+    delay((seed >> 16) % 3 + 1);
+  }
+
+  const TaskStats* s = scheduler.stats(id);
+  uint32_t expected = (millis() - 1) / 40 + 1;
+  bool ok = counter.runs == expected && s->skipped == 0 && s->lateUsMax <= 2000;
+  printf("drift: 40 ms task over %lu virtual s: %lu releases (expected %lu), max late %lu us, skipped %u\n",
+         virtualSeconds, (unsigned long)counter.runs, (unsigned long)expected, (unsigned long)s->lateUsMax,
+         s->skipped);
+  return ok;
+}
+
+bool runSlowNeighbour(unsigned long virtualSeconds) {
+  simSetMillis(0);
+  Scheduler scheduler;
+  Counter sampler = {0, 0, 0};
+  Counter modem = {0, 0, 0};
+  TaskId samplerId = scheduler.every(10, countTask, &sampler, "sample");
+  scheduler.every(50, slowStepTask, &modem, "modem", 7);  // Overlaps every fifth sample
+  unsigned long end = virtualSeconds * 1000UL;
+  while (millis() < end) {
+    scheduler.run();
+    uint32_t idle = scheduler.idleMs();
+    if (idle) delay(idle);
+  }
+  const TaskStats* s = scheduler.stats(samplerId);
+
+  // The old loop: sample, then once a minute an SMS-style blocking send
+  Counter legacy = {0, 0, 0};
+  simSetMillis(0);
+  unsigned long lastSend = 0;
+  while (millis() < end) {
+    countTask(&legacy);
+    if (millis() - lastSend >= 60000UL) {
+      delay(6100);  // CMGS wait + body + final result wait
+      lastSend = millis();
+    }
+    delay(10);
+  }
+
+  printf("slow neighbour: 10 ms sampler next to 5 ms modem steps every 50 ms\n");
+  printf("  scheduler    max gap %lu ms, max late %lu us, missed %u, skipped %u\n", sampler.maxGapMs,
+         (unsigned long)s->lateUsMax, s->missedDeadlines, s->skipped);
+  printf("  old loop     max gap %lu ms\n", legacy.maxGapMs);
+  // A step may delay a sample, never drop it
+  return s->skipped == 0 && sampler.maxGapMs <= 15;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  bool ok = runOverhead(quick ? 600 : 86400);
+  ok &= runDrift(quick ? 600 : 86400);
+  ok &= runSlowNeighbour(quick ? 600 : 3600);
+  return ok ? 0 : 1;
+}
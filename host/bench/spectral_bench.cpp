@@ -0,0 +1,235 @@
+/*
+ * RescueNet AI - Spectral heart rate benchmark
+ *
+ * Runs the same 100 Hz MAX3010x IR streams (the SimPpgSensor waveform)
+ * through the time-domain PulseDetector and through SpectralHeartRate and
+ * reports:
+ *
+ *   accuracy   rate error after a minute at 40..180 BPM, clean, with
+ *              sensor noise and at weak perfusion
+ *   latency    after a step in the rate, how long until each estimate is
+ *              within 5 BPM of the new one and stays there, for a few
+ *              window / hop settings
+ *   cpu        ns per sample (the spectral one amortizes its FFT over the
+ *              hop), us per FFT and the share of one core that is at
+ *              100 Hz; the ESP32 figures come from
+ *              examples/SpectralHeartRateTiming
+ *
+ * Usage: spectral_bench [--quick]
+ */
+
+#include <Arduino.h>
+#include <pulse_detector.h>
+#include <spectral_hr.h>
+
+#include "../sim/sim_hal.h"
+#include "../sim/sim_random.h"
+#include "bench_util.h"
+
+#include <math.h>
+#include <string>
+
+namespace {
+
+const uint16_t RATE_HZ = 100;
+const unsigned long PERIOD_US = 1000000UL / RATE_HZ;
+
+struct Case {
+  const char* label;
+  float perfusion;
+  int noise;     // Peak noise in sensor counts
+  bool checked;  // The spectral rate must stay within tolerance
+};
+
+// One stream, sample by sample, into both estimators
+class Stream {
+public:
+  Stream(const Case& c, float bpm) : noiseAmplitude(c.noise), detector(RATE_HZ) {
+    wave.setHeartRate(bpm);
+    wave.setPerfusion(c.perfusion);
+    spectrum.setSampleRate(RATE_HZ);
+  }
+
+  bool configure(uint16_t window, uint16_t hop) { return spectrum.configure(window, hop); }
+  void setHeartRate(float bpm) { wave.setHeartRate(bpm); }
+
+  void run(unsigned long samples) {
+    for (unsigned long i = 0; i < samples; i++) step();
+  }
+
+  void step() {
+    unsigned long long t = (unsigned long long)index++ * PERIOD_US;
+    int32_t value = (int32_t)wave.irAt(t) + noise.centered(noiseAmplitude);
+    uint64_t start = benchNowNs();
+    detector.addSample(value);
+    uint64_t mid = benchNowNs();
+    if (spectrum.addSample(value)) transformNs += benchNowNs() - mid;
+    uint64_t end = benchNowNs();
+    detectorNs += mid - start;
+    spectralNs += end - mid;
+  }
+
+  float detectorBpm() const { return detector.bpmTenths() / 10.0f; }
+  float spectralBpm() const { return spectrum.heartRate(); }
+  uint8_t quality() const { return spectrum.quality(); }
+  uint32_t transforms() const { return spectrum.transforms(); }
+  unsigned long samples() const { return index; }
+
+  uint64_t detectorNs = 0;
+  uint64_t spectralNs = 0;
+  uint64_t transformNs = 0;
+
+private:
+  SimPpgSensor wave;
+  SimRandom noise;
+  int noiseAmplitude;
+  PulseDetector detector;
+  SpectralHeartRate spectrum;
+  unsigned long index = 0;
+};
+
+void runAccuracy(unsigned long seconds) {
+  const Case cases[] = {
+    {"clean", 1.0f, 0, true},
+    {"noise +-150", 1.0f, 150, true},
+    {"weak (0.3)", 0.3f, 0, true},
+    {"weak + noise +-100", 0.3f, 100, true},
+    {"faint (0.15) + noise +-150", 0.15f, 150, false},
+  };
+  const float rates[] = {40, 60, 72, 100, 140, 180};
+
+  printf("accuracy: %lu s per run, error in BPM (spectral quality)\n", seconds);
+  printf("  %-28s", "case");
+  for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) printf("   HR %3.0f       ", rates[r]);
+  printf("\n");
+  double worstChecked = 0;
+  double detectorTotal = 0, spectralTotal = 0;
+  int hardRuns = 0;
+  for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+    printf("  %-28s", cases[c].label);
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+      Stream stream(cases[c], rates[r]);
+      stream.run(seconds * RATE_HZ);
+      float detectorError = stream.detectorBpm() > 0 ? fabsf(stream.detectorBpm() - rates[r]) : rates[r];
+      float spectralError = stream.spectralBpm() > 0 ? fabsf(stream.spectralBpm() - rates[r]) : rates[r];
+      printf("  %5.1f %5.1f(%2u)", detectorError, spectralError, stream.quality());
+      if (cases[c].checked && spectralError > worstChecked) worstChecked = spectralError;
+      if (cases[c].noise && cases[c].perfusion < 1) {
+        detectorTotal += detectorError;
+        spectralTotal += spectralError;
+        hardRuns++;
+      }
+    }
+    printf("\n");
+  }
+  printf("  (each cell: detector error, spectral error)\n");
+
+  char detail[64];
+  snprintf(detail, sizeof(detail), "worst %.1f BPM", worstChecked);
+  check("spectral within 3 BPM where it is checked", worstChecked <= 3.0, detail);
+  snprintf(detail, sizeof(detail), "mean %.1f -> %.1f BPM", detectorTotal / hardRuns, spectralTotal / hardRuns);
+  check("spectral closer than beats on weak + noisy", spectralTotal <= detectorTotal, detail);
+}
+
+// Seconds after the step until within 5 BPM for good, or -1
+struct Settle {
+  double detector;
+  double spectral;
+};
+
+Settle settleAfterStep(uint16_t window, uint16_t hop, float from, float to) {
+  Case clean = {"", 1.0f, 20, true};
+  Stream stream(clean, from);
+  stream.configure(window, hop);
+  stream.run(40UL * RATE_HZ);
+  stream.setHeartRate(to);
+  unsigned long start = stream.samples();
+  long detectorSince = -1, spectralSince = -1;
+  for (unsigned long i = 0; i < 40UL * RATE_HZ; i++) {
+    stream.step();
+    long at = (long)(stream.samples() - start);
+    bool detectorIn = fabsf(stream.detectorBpm() - to) <= 5;
+    bool spectralIn = fabsf(stream.spectralBpm() - to) <= 5;
+    if (!detectorIn) detectorSince = -1;
+    else if (detectorSince < 0) detectorSince = at;
+    if (!spectralIn) spectralSince = -1;
+    else if (spectralSince < 0) spectralSince = at;
+  }
+  Settle s = {detectorSince < 0 ? -1 : (double)detectorSince / RATE_HZ,
+              spectralSince < 0 ? -1 : (double)spectralSince / RATE_HZ};
+  return s;
+}
+
+struct Setting {
+  uint16_t window;
+  uint16_t hop;
+};
+
+const Setting SETTINGS[] = {
+  {128, 12},
+  {256, 25},
+  {256, 6},
+};
+const size_t SETTING_COUNT = sizeof(SETTINGS) / sizeof(SETTINGS[0]);
+
+void runLatency() {
+  const float steps[][2] = {{72, 120}, {120, 72}, {72, 45}};
+  SpectralHeartRate probe;
+  probe.setSampleRate(RATE_HZ);
+  float outRate = probe.outputRateHz();
+  printf("latency: s from a step until within 5 BPM for good (detector / spectral)\n");
+  printf("  %-24s", "window, hop");
+  for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) printf("   %3.0f -> %-3.0f   ", steps[s][0], steps[s][1]);
+  printf("\n");
+  bool bounded = true;
+  for (size_t k = 0; k < SETTING_COUNT; k++) {
+    char label[48];
+    snprintf(label, sizeof(label), "%.2f s, %.2f s", SETTINGS[k].window / outRate, SETTINGS[k].hop / outRate);
+    printf("  %-24s", label);
+    // Half a window for the peak to cross over, a hop, and slack for the
+    // bins between the two rates
+    double limit = SETTINGS[k].window / outRate * 0.75 + SETTINGS[k].hop / outRate + 2;
+    for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+      Settle settle = settleAfterStep(SETTINGS[k].window, SETTINGS[k].hop, steps[s][0], steps[s][1]);
+      printf("  %5.1f / %5.1f   ", settle.detector, settle.spectral);
+      if (settle.spectral < 0 || settle.spectral > limit) bounded = false;
+    }
+    printf("\n");
+  }
+  check("spectral settles within 3/4 window + hop", bounded);
+}
+
+void runCpu(unsigned long seconds) {
+  Case clean = {"", 1.0f, 20, true};
+  printf("cpu: %lu s at 72 BPM, host\n", seconds);
+  printf("  %-24s %14s %14s %12s %12s\n", "window, hop", "detector ns", "spectral ns", "us per FFT", "core share");
+  bool light = true;
+  for (size_t k = 0; k < SETTING_COUNT; k++) {
+    Stream stream(clean, 72);
+    stream.configure(SETTINGS[k].window, SETTINGS[k].hop);
+    stream.run(seconds * RATE_HZ);
+    double samples = (double)stream.samples();
+    double detectorNs = stream.detectorNs / samples;
+    double spectralNs = stream.spectralNs / samples;
+    double fftUs = stream.transforms() ? stream.transformNs / 1000.0 / stream.transforms() : 0;
+    // Per second of signal, at RATE_HZ
+    double share = (detectorNs + spectralNs) * RATE_HZ / 1e9 * 100;
+    char label[32];
+    snprintf(label, sizeof(label), "%u, %u", SETTINGS[k].window, SETTINGS[k].hop);
+    printf("  %-24s %14.1f %14.1f %12.1f %11.3f%%\n", label, detectorNs, spectralNs, fftUs, share);
+    if (share > 1.0) light = false;
+  }
+  printf("  %zu bytes per SpectralHeartRate, %zu per PulseDetector\n", sizeof(SpectralHeartRate),
+         sizeof(PulseDetector));
+  check("both under 1 % of a host core", light);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  runAccuracy(quick ? 30 : 60);
+  runLatency();
+  runCpu(quick ? 60 : 600);
+  return benchResult();
+}
@@ -0,0 +1,170 @@
+/*
+ * RescueNet AI - SpO2 estimator benchmark
+ *
+ * Replays red/IR waveforms through Spo2Estimator and reports throughput
+ * (samples per second of CPU time), accuracy against the known
+ * saturation, how often a reading is available and the reported signal
+ * quality.
+ *
+ * Waveforms come from CSV recordings given on the command line (one
+ * "red,ir" pair per line at 100 Hz; a "# spo2=<percent>" comment line
+ * gives the reference value), or, when none are given, from a fixed set
+ * of synthetic recordings made with the simulated sensor plus sensor
+ * noise: normal and hypoxic saturation, weak perfusion and heavy noise.
+ *
+ * Usage: spo2_bench [--quick] [recording.csv ...]
+ */
+
+#include <Arduino.h>
+#include <spo2_estimator.h>
+
+#include "../sim/sim_hal.h"
+#include "bench_util.h"
+
+#include <stdlib.h>
+#include <string>
+
+namespace {
+
+const uint16_t RATE_HZ = 100;
+
+struct Recording {
+  std::string name;
+  float truth;
+  std::vector<PpgSample> samples;
+};
+
+// Deterministic approximately-normal noise (sum of uniforms)
+float noise(unsigned long& state, float sigma) {
+  float total = 0;
+  for (int i = 0; i < 4; i++) {
+    state = state * 1664525UL + 1013904223UL;
+    total += (float)((state >> 8) & 0xFFFF) / 65535.0f - 0.5f;
+  }
+  return total * sigma * 1.7f;
+}
+
+Recording synthesize(const char* name, float spo2, float bpm, float perfusion, float noiseCounts,
+                     unsigned long seconds) {
+  Recording rec;
+  rec.name = name;
+  rec.truth = spo2;
+  SimPpgSensor sensor;
+  sensor.setSpO2(spo2);
+  sensor.setHeartRate(bpm);
+  sensor.setPerfusion(perfusion);
+  unsigned long state = 12345;
+  unsigned long count = seconds * RATE_HZ;
+  rec.samples.reserve(count);
+  for (unsigned long i = 0; i < count; i++) {
+    unsigned long long t = (unsigned long long)i * (1000000ULL / RATE_HZ);
+    PpgSample s;
+    s.red = (uint32_t)((float)sensor.redAt(t) + noise(state, noiseCounts));
+    s.ir = (uint32_t)((float)sensor.irAt(t) + noise(state, noiseCounts));
+    rec.samples.push_back(s);
+  }
+  return rec;
+}
+
+bool load(const char* path, Recording& rec) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  rec.name = path;
+  rec.truth = 0;
+  char line[128];
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#') {
+      const char* tag = strstr(line, "spo2=");
+      if (tag) rec.truth = (float)atof(tag + 5);
+      continue;
+    }
+    unsigned long red, ir;
+    if (sscanf(line, "%lu,%lu", &red, &ir) == 2) {
+      PpgSample s = {(uint32_t)red, (uint32_t)ir};
+      rec.samples.push_back(s);
+    }
+  }
+  fclose(f);
+  return !rec.samples.empty();
+}
+
+struct Score {
+  double samplesPerSecond;
+  double meanAbsError;
+  double validFraction;
+  double meanQuality;
+};
+
+Score evaluate(const Recording& rec, int repeats) {
+  Score score = {0, 0, 0, 0};
+  Spo2Estimator estimator(RATE_HZ);
+
+  // Throughput: the estimator alone, several passes over the recording
+  uint64_t start = benchNowNs();
+  uint32_t sink = 0;
+  for (int r = 0; r < repeats; r++) {
+    estimator.reset();
+    for (size_t i = 0; i < rec.samples.size(); i++) {
+      sink += estimator.addSample(rec.samples[i].red, rec.samples[i].ir);
+    }
+  }
+  uint64_t elapsed = benchNowNs() - start;
+  score.samplesPerSecond = (double)rec.samples.size() * repeats * 1e9 / (double)(elapsed ? elapsed : 1);
+  if (sink == 0xFFFFFFFF) printf(" ");
+
+  // Accuracy: one pass, scored after each completed cycle once valid
+  estimator.reset();
+  unsigned long cycles = 0, validCycles = 0;
+  double errorSum = 0, qualitySum = 0;
+  for (size_t i = 0; i < rec.samples.size(); i++) {
+    if (!estimator.addSample(rec.samples[i].red, rec.samples[i].ir)) continue;
+    cycles++;
+    if (!estimator.valid()) continue;
+    validCycles++;
+    errorSum += fabs(estimator.spO2Tenths() / 10.0 - rec.truth);
+    qualitySum += estimator.quality();
+  }
+  score.validFraction = cycles ? (double)validCycles / cycles : 0;
+  score.meanAbsError = validCycles ? errorSum / validCycles : 0;
+  score.meanQuality = validCycles ? qualitySum / validCycles : 0;
+  return score;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  unsigned long seconds = quick ? 60 : 600;
+  int repeats = quick ? 3 : 20;
+
+  std::vector<Recording> recordings;
+  for (int i = 1; i < argc; i++) {
+    if (argv[i][0] == '-') continue;
+    Recording rec;
+    if (load(argv[i], rec)) {
+      recordings.push_back(rec);
+    } else {
+      fprintf(stderr, "cannot read %s\n", argv[i]);
+      return 2;
+    }
+  }
+  bool synthetic = recordings.empty();
+  if (synthetic) {
+    recordings.push_back(synthesize("normal 98%, 72 BPM", 98, 72, 1.0f, 20, seconds));
+    recordings.push_back(synthesize("normal 95%, 110 BPM", 95, 110, 1.0f, 20, seconds));
+    recordings.push_back(synthesize("hypoxic 88%, 90 BPM", 88, 90, 1.0f, 20, seconds));
+    recordings.push_back(synthesize("hypoxic 80%, 60 BPM", 80, 60, 1.0f, 20, seconds));
+    recordings.push_back(synthesize("weak perfusion 0.2%", 97, 72, 0.13f, 20, seconds));
+    recordings.push_back(synthesize("heavy noise", 97, 72, 1.0f, 300, seconds));
+  }
+
+  printf("%-24s %10s %8s %7s %8s\n", "recording", "Msample/s", "MAE %", "valid", "quality");
+  for (size_t i = 0; i < recordings.size(); i++) {
+    Score s = evaluate(recordings[i], repeats);
+    printf("%-24s %10.1f %8.2f %6.0f%% %8.0f\n", recordings[i].name.c_str(),
+           s.samplesPerSecond / 1e6, s.meanAbsError, s.validFraction * 100, s.meanQuality);
+    // Clean synthetic recordings must be accurate to within 2 %
+    if (synthetic && i < 4 && (s.meanAbsError > 2.0 || s.validFraction < 0.9)) benchFailures()++;
+  }
+  return benchResult();
+}
@@ -0,0 +1,313 @@
+/*
+ * RescueNet AI - Telemetry format benchmark
+ *
+ * Compares the JSON health payload HealthMonitor used to build with
+ * String, the same JSON from the messages.h template in a fixed buffer,
+ * and the binary record of telemetry.h:
+ *
+ *   codec     encode time, payload size, heap allocations and peak heap
+ *             per record, for the payload alone
+ *   uplink    HealthMonitor::sendHealthData() on the Nano set-up: the
+ *             ESP8266 transport on a simulated ESP-01 at 9600 baud, so
+ *             time in the post includes the bytes on the serial link
+ *
+ * and checks the record itself: values survive a round trip within the
+ * field resolution, out of range values are clamped, and every single
+ * bit error, truncation and unknown version is rejected.
+ *
+ * Usage: telemetry_bench [--quick]
+ */
+
+#include <Arduino.h>
+#include <esp8266_http.h>
+#include <health_monitor.h>
+#include <messages.h>
+#include <telemetry.h>
+
+#include "../sim/heap_stats.h"
+#include "../sim/sim_hal.h"
+#include "bench_util.h"
+
+#include <math.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+namespace {
+
+const char* const USER_ID = "1234567890";
+
+// Deterministic spread of plausible readings
+TelemetryRecord makeRecord(uint32_t i) {
+  TelemetryRecord r;
+  memset(&r, 0, sizeof(r));
+  r.kind = TELEMETRY_HEALTH;
+  r.sequence = (uint16_t)i;
+  r.flags = TELEMETRY_FLAG_LOCATION;
+  r.timestamp = 1700000000UL + i * 30;
+  r.userId = USER_ID;
+  r.heartRate = 55.0f + (i * 37 % 900) / 10.0f;
+  r.spO2 = 90.0f + (i * 13 % 100) / 10.0f;
+  r.temperature = 35.5f + (i * 7 % 300) / 100.0f;
+  r.bloodPressureSys = 90.0f + (float)(i % 60);
+  r.bloodPressureDia = 60.0f + (float)(i % 30);
+  r.latitude = 21.1458 + (i % 1000) * 1e-5;
+  r.longitude = 79.0882 - (i % 1000) * 1e-5;
+  r.altitude = 310.0f;
+  r.accelX = sinf((float)i) * 2.0f;
+  r.accelY = cosf((float)i) * 2.0f;
+  r.accelZ = 9.81f;
+  r.batteryLevel = (uint8_t)(100 - i % 100);
+  return r;
+}
+
+// HealthMonitor::healthJson() with the record's values
+String jsonPayload(const TelemetryRecord& r) {
+  String json = "{";
+  json += "\"userId\":\"" + String(r.userId) + "\",";
+  json += "\"timestamp\":\"" + String(r.timestamp) + "\",";
+  json += "\"vitals\":{";
+  json += "\"heartRate\":" + String(r.heartRate) + ",";
+  json += "\"temperature\":" + String(r.temperature) + ",";
+  json += "\"spO2\":" + String(r.spO2, 1) + ",";
+  json += "\"bloodPressure\":" + String(r.bloodPressureSys);
+  json += "},";
+  json += "\"location\":{\"lat\":21.1458,\"lng\":79.0882},";
+  json += "\"accelerometer\":{";
+  json += "\"x\":" + String(r.accelX) + ",";
+  json += "\"y\":" + String(r.accelY) + ",";
+  json += "\"z\":" + String(r.accelZ);
+  json += "}}";
+  return json;
+}
+
+struct CodecResult {
+  double nsPerRecord;
+  double bytesPerRecord;
+  double allocationsPerRecord;
+  long long peakHeap;
+};
+
+template <typename Encode>
+CodecResult measure(const std::vector<TelemetryRecord>& records, Encode encode) {
+  CodecResult result = {0, 0, 0, 0};
+  uint64_t bytes = 0;
+  HeapStats before = heapStats();
+  heapResetPeak();
+  uint64_t start = benchNowNs();
+  for (size_t i = 0; i < records.size(); i++) bytes += encode(records[i]);
+  uint64_t elapsed = benchNowNs() - start;
+  HeapStats after = heapStats();
+  result.nsPerRecord = (double)elapsed / records.size();
+  result.bytesPerRecord = (double)bytes / records.size();
+  result.allocationsPerRecord = (double)(after.allocations - before.allocations) / records.size();
+  result.peakHeap = (long long)(after.peakBytesInUse - before.bytesInUse);
+  return result;
+}
+
+void runCodec(uint32_t count) {
+  std::vector<TelemetryRecord> records;
+  records.reserve(count);
+  for (uint32_t i = 0; i < count; i++) records.push_back(makeRecord(i));
+  printf("codec: %u health records\n", (unsigned)count);
+  printf("  %-8s %10s %9s %12s %10s\n", "format", "ns/record", "bytes", "allocs/rec", "peak heap");
+
+  CodecResult json = measure(records, [](const TelemetryRecord& r) { return (size_t)jsonPayload(r).length(); });
+  printf("  %-8s %10.0f %9.1f %12.1f %10lld\n", "json", json.nsPerRecord, json.bytesPerRecord,
+         json.allocationsPerRecord, json.peakHeap);
+
+  CodecResult templated = measure(records, [](const TelemetryRecord& r) {
+    TextBuffer<HEALTH_JSON_MAX> out;
+    writeHealthJson(out, r);
+    return out.length();
+  });
+  printf("  %-8s %10.0f %9.1f %12.1f %10lld\n", "template", templated.nsPerRecord, templated.bytesPerRecord,
+         templated.allocationsPerRecord, templated.peakHeap);
+
+  CodecResult binary = measure(records, [](const TelemetryRecord& r) {
+    uint8_t out[TELEMETRY_HEALTH_SIZE];
+    return encodeTelemetry(r, out, sizeof(out));
+  });
+  printf("  %-8s %10.0f %9.1f %12.1f %10lld\n", "binary", binary.nsPerRecord, binary.bytesPerRecord,
+         binary.allocationsPerRecord, binary.peakHeap);
+
+  check("binary record is the fixed size", binary.bytesPerRecord == TELEMETRY_HEALTH_SIZE);
+  check("binary under a third of the JSON", binary.bytesPerRecord * 3 < json.bytesPerRecord);
+  check("binary encodes without the heap", binary.allocationsPerRecord == 0 && binary.peakHeap == 0);
+  check("binary encodes faster", binary.nsPerRecord < json.nsPerRecord);
+  check("template JSON without the heap", templated.allocationsPerRecord == 0 && templated.peakHeap == 0);
+  check("template JSON faster than String", templated.nsPerRecord < json.nsPerRecord);
+  // Records whose location is the one jsonPayload() writes
+  bool same = true;
+  for (uint32_t i = 0; i < records.size(); i += 1000) {
+    TextBuffer<HEALTH_JSON_MAX> out;
+    writeHealthJson(out, records[i]);
+    same = same && jsonPayload(records[i]) == out.c_str();
+  }
+  check("template JSON matches the String JSON", same);
+}
+
+bool near(double a, double b, double tolerance) {
+  return fabs(a - b) <= tolerance;
+}
+
+void runRoundTrip(uint32_t records) {
+  printf("round trip: %u records\n", (unsigned)records);
+  uint32_t mismatches = 0;
+  char userId[TELEMETRY_USER_ID_MAX + 1];
+  char reason[TELEMETRY_REASON_MAX + 1];
+  for (uint32_t i = 0; i < records; i++) {
+    TelemetryRecord in = makeRecord(i);
+    uint8_t out[TELEMETRY_HEALTH_SIZE];
+    TelemetryRecord back;
+    size_t n = encodeTelemetry(in, out, sizeof(out));
+    bool ok = n == TELEMETRY_HEALTH_SIZE && decodeTelemetry(out, n, back, userId, reason) &&
+              back.kind == in.kind && back.sequence == in.sequence && back.flags == in.flags &&
+              back.timestamp == in.timestamp && strcmp(back.userId, USER_ID) == 0 &&
+              near(back.heartRate, in.heartRate, 0.05) && near(back.spO2, in.spO2, 0.05) &&
+              near(back.temperature, in.temperature, 0.005) && near(back.bloodPressureSys, in.bloodPressureSys, 0.5) &&
+              near(back.latitude, in.latitude, 0.6e-7) && near(back.longitude, in.longitude, 0.6e-7) &&
+              near(back.altitude, in.altitude, 0.5) && near(back.accelX, in.accelX, 0.005) &&
+              near(back.accelY, in.accelY, 0.005) && near(back.accelZ, in.accelZ, 0.005) &&
+              back.batteryLevel == in.batteryLevel && back.reason[0] == '\0';
+    if (!ok) mismatches++;
+  }
+  check("values within field resolution", mismatches == 0);
+
+  // Emergency record with its reason; an overlong one is cut
+  TelemetryRecord alert = makeRecord(7);
+  alert.kind = TELEMETRY_EMERGENCY;
+  alert.flags |= TELEMETRY_FLAG_EMERGENCY | TELEMETRY_FLAG_FALL;
+  alert.reason = "Fall detected";
+  uint8_t out[TELEMETRY_MAX_SIZE];
+  TelemetryRecord back;
+  size_t n = encodeTelemetry(alert, out, sizeof(out));
+  check("emergency record carries its reason", n == TELEMETRY_HEALTH_SIZE + 1 + 13 &&
+        decodeTelemetry(out, n, back, userId, reason) && strcmp(back.reason, "Fall detected") == 0 &&
+        back.kind == TELEMETRY_EMERGENCY);
+  std::string longReason(100, 'x');
+  alert.reason = longReason.c_str();
+  n = encodeTelemetry(alert, out, sizeof(out));
+  check("reason cut at TELEMETRY_REASON_MAX", n == TELEMETRY_MAX_SIZE &&
+        decodeTelemetry(out, n, back, userId, reason) && strlen(back.reason) == TELEMETRY_REASON_MAX);
+  check("too small a buffer is refused", encodeTelemetry(alert, out, TELEMETRY_MAX_SIZE - 1) == 0);
+
+  // Out of range values saturate instead of wrapping
+  TelemetryRecord wild = makeRecord(1);
+  wild.temperature = 1000.0f;
+  wild.accelX = -500.0f;
+  wild.heartRate = -3.0f;
+  wild.latitude = NAN;
+  n = encodeTelemetry(wild, out, sizeof(out));
+  decodeTelemetry(out, n, back, userId, reason);
+  check("out of range values clamp", near(back.temperature, 327.67, 0.001) && near(back.accelX, -327.68, 0.001) &&
+        back.heartRate == 0 && back.latitude == 0);
+
+  // A 16 character user id fills the field without a terminator
+  TelemetryRecord longId = makeRecord(2);
+  longId.userId = "+911234567890123456";
+  n = encodeTelemetry(longId, out, sizeof(out));
+  check("user id cut at 16 characters", decodeTelemetry(out, n, back, userId, reason) &&
+        strcmp(back.userId, "+911234567890123") == 0);
+
+  // Every single bit error is caught by the CRC
+  n = encodeTelemetry(makeRecord(3), out, sizeof(out));
+  uint32_t missed = 0;
+  for (size_t bit = 0; bit < n * 8; bit++) {
+    out[bit / 8] ^= (uint8_t)(1 << (bit % 8));
+    if (decodeTelemetry(out, n, back, userId, reason)) missed++;
+    out[bit / 8] ^= (uint8_t)(1 << (bit % 8));
+  }
+  check("every single bit error rejected", missed == 0);
+  check("truncated record rejected", !decodeTelemetry(out, n - 1, back, userId, reason));
+  out[2] = TELEMETRY_VERSION + 1;
+  check("unknown version rejected", !decodeTelemetry(out, n, back, userId, reason));
+
+  struct tm t;
+  memset(&t, 0, sizeof(t));
+  t.tm_year = 2024 - 1900;
+  t.tm_mon = 1;
+  t.tm_mday = 29;
+  t.tm_hour = 12;
+  t.tm_min = 34;
+  t.tm_sec = 56;
+  check("wall clock to seconds", telemetrySeconds(t) == 1709210096UL);
+}
+
+struct UplinkResult {
+  double msPerPost;
+  double bodyBytes;
+  double wireBytes;
+  double allocationsPerPost;
+};
+
+// The Nano: monitor -> Esp8266Http -> ESP-01 at 9600 baud, no dashboard
+UplinkResult runUplink(bool binary, int posts) {
+  simSetMillis(0);
+  SimBoard board;
+  SimEsp8266 module;
+  module.setKeepAliveMs(65000);
+  Esp8266Http http(module, "192.168.1.100", "3000");
+  MonitorHal hal = {&board.ppg, &board.imu, &board.temp, &http, nullptr, nullptr, nullptr, nullptr, nullptr,
+                    nullptr, nullptr, nullptr};
+  MonitorConfig config = {USER_ID, "/api/health-data", "/api/emergency", "", 2, 5, 18, NO_PIN, 0, binary,
+                          POWER_FIXED};
+  HealthMonitor monitor(hal, config);
+  monitor.begin();
+  monitor.setNetworkConnected(true);
+  for (int i = 0; i < 50; i++) monitor.loop();
+  monitor.readSensors();
+  monitor.sendHealthData();  // Opens the connection
+
+  unsigned long long wireBefore = module.bytesFromHost();
+  uint32_t sentBefore = http.stats().bytesSent;
+  size_t bodiesBefore = 0;
+  for (size_t i = 0; i < module.requests().size(); i++) bodiesBefore += module.requests()[i].bodyLength;
+  uint64_t allocations = 0;
+  unsigned long busyMs = 0;
+  for (int i = 0; i < posts; i++) {
+    delay(30000);
+    monitor.readSensors();
+    unsigned long start = millis();
+    HeapStats before = heapStats();
+    monitor.sendHealthData();
+    allocations += heapStats().allocations - before.allocations;
+    busyMs += millis() - start;
+  }
+  size_t bodies = 0;
+  for (size_t i = 0; i < module.requests().size(); i++) bodies += module.requests()[i].bodyLength;
+
+  UplinkResult r;
+  r.msPerPost = (double)busyMs / posts;
+  r.bodyBytes = (double)(bodies - bodiesBefore) / posts;
+  r.wireBytes = (double)(module.bytesFromHost() - wireBefore) / posts;
+  r.allocationsPerPost = (double)allocations / posts;
+  if (http.stats().failures || (http.stats().bytesSent - sentBefore) == 0) r.msPerPost = -1;
+  return r;
+}
+
+void runUplinks(int posts) {
+  printf("uplink: %d posts from the Nano set-up, ESP8266 at 9600 baud\n", posts);
+  printf("  %-8s %9s %11s %11s %12s\n", "format", "ms/post", "body bytes", "wire bytes", "allocs/post");
+  UplinkResult json = runUplink(false, posts);
+  printf("  %-8s %9.0f %11.1f %11.1f %12.1f\n", "json", json.msPerPost, json.bodyBytes, json.wireBytes,
+         json.allocationsPerPost);
+  UplinkResult binary = runUplink(true, posts);
+  printf("  %-8s %9.0f %11.1f %11.1f %12.1f\n", "binary", binary.msPerPost, binary.bodyBytes, binary.wireBytes,
+         binary.allocationsPerPost);
+  check("both uplinks deliver", json.msPerPost > 0 && binary.msPerPost > 0);
+  check("binary post is a 56 byte body", binary.bodyBytes == TELEMETRY_HEALTH_SIZE);
+  check("binary post spends less time on the link", binary.msPerPost < json.msPerPost);
+  check("neither post allocates", json.allocationsPerPost == 0 && binary.allocationsPerPost == 0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  Serial.setEcho(false);
+  runCodec(quick ? 2000 : 200000);
+  runRoundTrip(quick ? 2000 : 100000);
+  runUplinks(quick ? 10 : 100);
+  return benchResult();
+}
@@ -0,0 +1,361 @@
+/*
+ * RescueNet AI - Temperature probe benchmark
+ *
+ * Runs DS18B20 probes on the simulated OneWire bus (sim_hal.h), where
+ * every transaction and conversion costs its virtual time, and reports:
+ *
+ *   - the loop before and after: HealthMonitor reading the temperature
+ *     the way the sketches did (a conversion waited out in
+ *     requestTemperatures(), then getTempCByIndex() searching the bus
+ *     again) against TempProbes converting in the background, with the
+ *     vitals task's run time, how late the PPG and IMU tasks ran behind
+ *     it, the samples their FIFOs lost and the bus time per reading
+ *   - several probes by ROM: one search at boot, a resolution per use
+ *     and its conversion time, and a poll that comes too soon
+ *   - the filter: noise on the body probe before and after smoothing,
+ *     the 85 C power-on value, a lone spike and a real step
+ *   - faults: a bad CRC, a probe unplugged and a probe plugged in late
+ *
+ * Usage: temp_bench [--quick]
+ */
+
+#include <Arduino.h>
+#include <health_monitor.h>
+#include <temp_probes.h>
+
+#include "../sim/sim_hal.h"
+#include "../sim/sim_rig.h"
+#include "bench_util.h"
+
+#include <math.h>
+#include <string>
+
+namespace {
+
+// DallasTemperature as the sketches used it: requestTemperatures() waits
+// out a 12 bit conversion, and getTempCByIndex(0) searches the bus for
+// probe 0 before reading its scratchpad
+class BlockingTempBus : public TempSensor {
+public:
+  explicit BlockingTempBus(SimTempSensor& bus) : bus(bus) {}
+
+  void begin() override { bus.begin(); }
+  uint8_t search(TempProbeRom* roms, uint8_t max) override { return bus.search(roms, max); }
+  bool setResolution(const TempProbeRom& rom, uint8_t bits) override { return bus.setResolution(rom, bits); }
+
+  bool startConversion() override {
+    bus.startConversion();
+    delay(TEMP_CONVERSION_MS(12));
+    return true;
+  }
+
+  bool readRaw(const TempProbeRom& rom, int16_t& sixteenths) override {
+    TempProbeRom found[TEMP_PROBES_MAX];
+    bus.search(found, TEMP_PROBES_MAX);
+    return bus.readRaw(rom, sixteenths);
+  }
+
+private:
+  SimTempSensor& bus;
+};
+
+// The board's probes read in the background, or through the blocking
+// bus on top of them
+struct Rig : SimRig {
+  BlockingTempBus blocking;
+
+  explicit Rig(bool background)
+    : SimRig(simMonitorConfig(), tempParts(background ? nullptr : &blocking)), blocking(board.temp) {}
+
+  static MonitorHal tempParts(TempSensor* temp) {
+    MonitorHal parts = MonitorHal();
+    parts.temp = temp;
+    return parts;
+  }
+
+  void boot() {
+    board.http.setRecordBodies(false);
+    SimRig::boot();
+  }
+
+  const TaskStats* task(const char* name) const {
+    const Scheduler& tasks = monitor.tasks();
+    for (TaskId id = 0; id < SCHEDULER_MAX_TASKS; id++) {
+      if (tasks.stats(id) && strcmp(tasks.name(id), name) == 0) return tasks.stats(id);
+    }
+    return nullptr;
+  }
+};
+
+// ---------------------------------------------------------------- loop
+
+struct LoopRun {
+  uint32_t vitalsUsMean;
+  uint32_t vitalsUsMax;
+  uint32_t ppgLateUsMax;
+  uint32_t motionLateUsMax;
+  uint32_t lost;
+  double busMsPerReading;
+  float celsius;
+};
+
+LoopRun runLoop(bool background, unsigned long virtualMs) {
+  Rig rig(background);
+  rig.board.temp.setCelsius(37.2f);
+  rig.boot();
+  // From the first reading on, boot and the bus search left out
+  unsigned long long busBefore = rig.board.temp.busUs();
+  unsigned long readsBefore = rig.board.temp.reads();
+  rig.monitor.tasks().resetStats();
+
+  unsigned long end = millis() + virtualMs;
+  while (millis() < end) rig.monitor.loop();
+
+  LoopRun run;
+  const TaskStats* vitals = rig.task("vitals");
+  const TaskStats* ppg = rig.task("ppg");
+  const TaskStats* motion = rig.task("motion");
+  run.vitalsUsMean = vitals && vitals->runs ? vitals->runUsTotal / vitals->runs : 0;
+  run.vitalsUsMax = vitals ? vitals->runUsMax : 0;
+  run.ppgLateUsMax = ppg ? ppg->lateUsMax : 0;
+  run.motionLateUsMax = motion ? motion->lateUsMax : 0;
+  run.lost = rig.monitor.ppgStream().stats().fifoOverflows + rig.monitor.motionStream().stats().fifoOverflows;
+  unsigned long reads = rig.board.temp.reads() - readsBefore;
+  // The blocking read also waits out the conversion, which is not bus time
+  double waitUs = background ? 0.0 : (double)reads * TEMP_CONVERSION_MS(12) * 1000.0;
+  run.busMsPerReading = reads ? ((rig.board.temp.busUs() - busBefore) + waitUs) / reads / 1000.0 : 0.0;
+  run.celsius = rig.monitor.temperatureProbes().celsius();
+  return run;
+}
+
+void runLoopReport(unsigned long virtualMs) {
+  printf("loop: %lu s (virtual), one body probe, a reading every vitals tick\n", virtualMs / 1000);
+  printf("  %-11s %16s %13s %15s %11s %14s %8s\n", "read", "vitals us mean", "vitals us max", "ppg late us max",
+         "imu late us", "FIFO overflows", "ms/read");
+  LoopRun runs[2];
+  for (int background = 0; background < 2; background++) {
+    LoopRun& run = runs[background];
+    run = runLoop(background != 0, virtualMs);
+    printf("  %-11s %16lu %13lu %15lu %11lu %14lu %8.1f\n", background ? "background" : "blocking",
+           (unsigned long)run.vitalsUsMean, (unsigned long)run.vitalsUsMax, (unsigned long)run.ppgLateUsMax,
+           (unsigned long)run.motionLateUsMax, (unsigned long)run.lost, run.busMsPerReading);
+  }
+  const LoopRun& before = runs[0];
+  const LoopRun& after = runs[1];
+
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%lu -> %lu us", (unsigned long)before.vitalsUsMax,
+           (unsigned long)after.vitalsUsMax);
+  check("vitals tick no longer waits on a conversion", after.vitalsUsMax * 20 < before.vitalsUsMax, detail);
+  snprintf(detail, sizeof(detail), "%lu -> %lu", (unsigned long)before.lost, (unsigned long)after.lost);
+  check("no FIFO overflows behind the temperature", after.lost == 0, detail);
+  // The FIFOs hold a few hundred ms; the display and uplink tasks share the loop as well
+  snprintf(detail, sizeof(detail), "%lu us", (unsigned long)after.ppgLateUsMax);
+  check("PPG task late by less than a FIFO's worth", after.ppgLateUsMax < 100000UL, detail);
+  snprintf(detail, sizeof(detail), "%.2f / %.2f C", before.celsius, after.celsius);
+  check("both read the body probe", fabs(before.celsius - 37.2f) < 0.1f && fabs(after.celsius - 37.2f) < 0.1f,
+        detail);
+}
+
+// ---------------------------------------------------------------- probes
+
+void runProbes() {
+  printf("probes: three on one bus, polled as the vitals task does\n");
+  SimTempSensor bus;
+  bus.setProbeCount(3);
+  bus.setCelsius(36.9f, 0);
+  bus.setCelsius(21.3f, 1);
+  bus.setCelsius(30.1f, 2);
+  simSetMillis(0);
+
+  TempProbes probes(&bus);
+  probes.setUse(2, TEMP_USE_FAST);
+  uint8_t found = probes.begin();
+  for (int i = 0; i < 30; i++) {
+    delay(1000);
+    probes.poll();
+  }
+
+  printf("  %-6s %-18s %5s %10s %10s\n", "probe", "rom", "bits", "conv ms", "celsius");
+  for (uint8_t i = 0; i < probes.count(); i++) {
+    const TempProbe& p = probes.probe(i);
+    char rom[20];
+    for (int b = 0; b < 8; b++) snprintf(rom + b * 2, 3, "%02X", p.rom.bytes[b]);
+    printf("  %-6u %-18s %5u %10u %10.4f\n", i, rom, bus.resolution(i), TEMP_CONVERSION_MS(p.use.bits),
+           probes.celsius(i));
+  }
+
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%u found, %lu searches", found, bus.searches());
+  check("probes found once and kept by ROM", found == 3 && bus.searches() == 1, detail);
+  check("resolution set per use", bus.resolution(0) == 12 && bus.resolution(1) == 9 && bus.resolution(2) == 10);
+  // 21.3 C at 9 bits is 21.0 or 21.5; 30.1 C at 10 bits is 30.0 or 30.25
+  snprintf(detail, sizeof(detail), "%.4f / %.4f / %.4f C", probes.celsius(0), probes.celsius(1), probes.celsius(2));
+  check("readings quantized at each resolution",
+        fabs(probes.celsius(0) - 36.9f) <= 0.0625f && probes.celsius(1) == 21.0f && probes.celsius(2) == 30.0f,
+        detail);
+  snprintf(detail, sizeof(detail), "%lu conversions, %lu reads", bus.conversions(), bus.reads());
+  check("one conversion per poll for every probe", bus.conversions() == 31 && bus.reads() == 90, detail);
+
+  // 100 ms in: the 9 bit probe is done, the 12 and 10 bit ones are not
+  unsigned long conversions = bus.conversions();
+  unsigned long reads = bus.reads();
+  uint16_t early = probes.stats().early;
+  delay(100);
+  probes.poll();
+  check("early poll collects only the finished probe", bus.reads() == reads + 1 && probes.probe(1).pending == false);
+  check("early poll leaves the conversion running",
+        bus.conversions() == conversions && probes.stats().early == early + 1);
+  delay(TEMP_CONVERSION_MS(12) - 100);
+  probes.poll();
+  check("the rest collected once converted", bus.reads() == reads + 3 && bus.conversions() == conversions + 1);
+
+  printf("  longest poll %lu us, %.1f ms of bus time per probe read\n", (unsigned long)probes.stats().busUsMax,
+         bus.busUs() / 1000.0 / bus.reads());
+}
+
+// ---------------------------------------------------------------- filter
+
+double sd(const std::vector<double>& values, double truth) {
+  double sum = 0;
+  for (size_t i = 0; i < values.size(); i++) sum += (values[i] - truth) * (values[i] - truth);
+  return sqrt(sum / values.size());
+}
+
+void runFilter(int readings) {
+  printf("filter: body probe at 37.0 C, 0.15 C of noise, a reading every 5 s\n");
+  SimTempSensor bus;
+  bus.setCelsius(37.0f);
+  bus.setNoise(0.15f);
+  simSetMillis(0);
+  TempProbes probes(&bus);
+  probes.begin();
+
+  std::vector<double> raw, smoothed;
+  for (int i = 0; i < readings; i++) {
+    delay(5000);
+    probes.poll();
+    // The first few fill the average
+    if (i < 8) continue;
+    raw.push_back(probes.probe(0).lastRaw / 16.0);
+    smoothed.push_back(probes.celsius());
+  }
+  double rawSd = sd(raw, 37.0);
+  double smoothSd = sd(smoothed, 37.0);
+  printf("  error sd     raw %.3f C  smoothed %.3f C\n", rawSd, smoothSd);
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%.3f -> %.3f C", rawSd, smoothSd);
+  check("smoothing halves the noise", smoothSd < rawSd / 2, detail);
+
+  bus.setNoise(0);
+  for (int i = 0; i < 8; i++) {
+    delay(5000);
+    probes.poll();
+  }
+  float settled = probes.celsius();
+  uint16_t rejected = probes.stats().rejected;
+
+  // The conversion in flight is lost with the power; the one after reads true
+  bus.powerGlitch(0);
+  delay(5000);
+  probes.poll();
+  snprintf(detail, sizeof(detail), "%.3f C", probes.celsius());
+  check("85 C power-on value dropped", probes.celsius() == settled && probes.stats().rejected == rejected + 1,
+        detail);
+
+  // One conversion at 44 C, then back
+  bus.setCelsius(44.0f);
+  delay(5000);
+  probes.poll();
+  bus.setCelsius(37.0f);
+  float during = probes.celsius();
+  delay(5000);
+  probes.poll();
+  snprintf(detail, sizeof(detail), "%.3f / %.3f C", during, probes.celsius());
+  check("lone spike dropped", during == settled && fabs(probes.celsius() - 37.0f) < 0.05f, detail);
+
+  // A fever: held once, taken on the second reading that agrees
+  bus.setCelsius(39.5f);
+  int polls = 0;
+  while (polls < 10 && fabs(probes.celsius() - 39.5f) > 0.05f) {
+    delay(5000);
+    probes.poll();
+    polls++;
+  }
+  snprintf(detail, sizeof(detail), "%.2f C after %d readings", probes.celsius(), polls);
+  check("real step taken on confirmation", polls == 2, detail);
+}
+
+// ---------------------------------------------------------------- faults
+
+void runFaults() {
+  printf("faults\n");
+  SimTempSensor bus;
+  bus.setProbeCount(2);
+  bus.setCelsius(22.0f, 1);
+  simSetMillis(0);
+  TempProbes probes(&bus);
+  probes.begin();
+  for (int i = 0; i < 3; i++) {
+    delay(1000);
+    probes.poll();
+  }
+
+  bus.corruptReads(1);
+  delay(1000);
+  probes.poll();
+  char detail[64];
+  snprintf(detail, sizeof(detail), "%u failed, %lu searches", probes.stats().failedReads, bus.searches());
+  check("bad CRC skipped, probe kept", probes.stats().failedReads == 1 && bus.searches() == 1 &&
+                                           fabs(probes.celsius(0) - 36.6f) <= 0.0625f,
+        detail);
+
+  bus.setPresent(1, false);
+  int polls = 0;
+  while (polls < 10 && probes.count() == 2) {
+    delay(1000);
+    probes.poll();
+    polls++;
+  }
+  snprintf(detail, sizeof(detail), "after %d polls, %lu searches", polls, bus.searches());
+  check("unplugged probe dropped after the fail limit", probes.count() == 1 && polls == TEMP_FAIL_LIMIT, detail);
+  delay(1000);
+  probes.poll();
+  check("the other keeps its reading", fabs(probes.celsius(0) - 36.6f) <= 0.0625f);
+
+  SimTempSensor late;
+  late.setPresent(0, false);
+  TempProbes empty(&late);
+  uint8_t atBoot = empty.begin();
+  delay(1000);
+  empty.poll();
+  late.setPresent(0, true);
+  polls = 0;
+  while (polls < 5 && empty.celsius() == TEMP_DISCONNECTED_C) {
+    delay(1000);
+    empty.poll();
+    polls++;
+  }
+  snprintf(detail, sizeof(detail), "%u at boot, reading after %d polls", atBoot, polls);
+  check("probe plugged in after boot found", atBoot == 0 && empty.count() == 1 && polls <= 2, detail);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  Serial.setEcho(false);
+  randomSeed(7);
+  printf("RescueNet temperature probe benchmark%s\n\n", quick ? " (quick)" : "");
+
+  runLoopReport(quick ? 60000UL : 300000UL);
+  printf("\n");
+  runProbes();
+  printf("\n");
+  runFilter(quick ? 200 : 2000);
+  printf("\n");
+  runFaults();
+
+  printf("\n%s\n", benchFailures() == 0 ? "All checks passed" : "Some checks FAILED");
+  return benchResult();
+}
@@ -0,0 +1,218 @@
+/*
+ * RescueNet AI - Batched upload benchmark
+ *
+ * Feeds a health reading every 5 s (the vitals task period) into
+ * TelemetryUploader for an hour of device time and compares flush
+ * policies: a request per reading, as v4.0 did, against batches closed
+ * by size or age. The transport is Esp8266Http on a simulated ESP-01 at
+ * 115200 baud, so "air bytes" are everything the board hands the WiFi
+ * module: AT commands, HTTP headers and bodies. For each policy and
+ * body format:
+ *
+ *   req/min     POST requests per minute
+ *   air B/min   bytes to the module per minute
+ *   busy ms/min time the caller spent blocked in poll(), polling every
+ *               MONITOR_UPLOAD_STEP_MS while a post goes out in steps
+ *   latency     reading taken to server acknowledgement, mean and max
+ *   allocs      heap allocations per reading
+ *
+ * Then server outages: a short one must lose nothing, a long one must
+ * keep the newest readings. Last, the monitor itself: every
+ * reading goes over HTTP and none over the dashboard WebSocket.
+ *
+ * Usage: upload_bench [--quick]
+ */
+
+#include <Arduino.h>
+#include <esp8266_http.h>
+#include <health_monitor.h>
+#include <telemetry_uploader.h>
+
+#include "../sim/heap_stats.h"
+#include "../sim/sim_hal.h"
+#include "../sim/sim_records.h"
+#include "bench_util.h"
+
+#include <string>
+
+namespace {
+
+const unsigned long SAMPLE_MS = 5000;
+const unsigned long POLL_MS = 1000;
+const char* const URL = "/api/health-data";
+
+struct Policy {
+  const char* name;
+  uint8_t samples;
+  uint32_t maxAgeMs;
+};
+
+struct PolicyResult {
+  float requestsPerMinute;
+  double airBytesPerMinute;
+  double busyMsPerMinute;
+  uint32_t latencyMean;
+  uint32_t latencyMax;
+  double allocationsPerSample;
+  UploadStats stats;
+};
+
+PolicyResult runPolicy(const Policy& policy, UploadFormat format, unsigned long minutes) {
+  simSetMillis(0);
+  SimEsp8266 module;
+  module.setBaud(115200);
+  module.setKeepAliveMs(65000);
+  Esp8266Http http(module, "192.168.1.100", "3000");
+  TelemetryUploader uploader(&http, URL, format, policy.samples, policy.maxAgeMs);
+
+  uint64_t allocations = 0;
+  unsigned long blockedMs = 0;
+  uint32_t taken = 0;
+  unsigned long end = minutes * 60000UL;
+  unsigned long nextSample = SAMPLE_MS;
+  while (millis() < end) {
+    HeapStats before = heapStats();
+    if (millis() >= nextSample) {
+      uploader.add(simReading(taken++));
+      nextSample += SAMPLE_MS;
+    }
+    unsigned long start = millis();
+    uploader.poll(true);
+    blockedMs += millis() - start;
+    allocations += heapStats().allocations - before.allocations;
+    delay(uploader.busy() ? MONITOR_UPLOAD_STEP_MS : POLL_MS);
+  }
+
+  PolicyResult r;
+  r.stats = uploader.stats();
+  r.requestsPerMinute = uploader.requestsPerMinute();
+  r.airBytesPerMinute = (double)module.bytesFromHost() / minutes;
+  r.busyMsPerMinute = (double)blockedMs / minutes;
+  r.latencyMean = uploader.meanLatencyMs();
+  r.latencyMax = r.stats.latencyMsMax;
+  r.allocationsPerSample = taken ? (double)allocations / taken : 0;
+  return r;
+}
+
+void runPolicies(unsigned long minutes) {
+  static const Policy POLICIES[] = {
+    {"per reading", 1, 0},
+    {"6 / 30 s", 6, 30000},
+    {"12 / 60 s", 12, 60000},
+    {"12 / 20 s", 12, 20000},
+  };
+  const int count = sizeof(POLICIES) / sizeof(POLICIES[0]);
+  printf("policies: a reading every %lu s for %lu min, ESP8266 at 115200 baud\n", SAMPLE_MS / 1000, minutes);
+  printf("  %-6s %-12s %8s %10s %12s %16s %8s\n", "format", "policy", "req/min", "air B/min", "busy ms/min",
+         "latency mean/max", "allocs");
+
+  PolicyResult results[2][count];
+  for (int f = 0; f < 2; f++) {
+    UploadFormat format = f == 0 ? UPLOAD_JSON : UPLOAD_BINARY;
+    for (int p = 0; p < count; p++) {
+      PolicyResult& r = results[f][p];
+      r = runPolicy(POLICIES[p], format, minutes);
+      char latency[32];
+      snprintf(latency, sizeof(latency), "%lu / %lu ms", (unsigned long)r.latencyMean, (unsigned long)r.latencyMax);
+      printf("  %-6s %-12s %8.2f %10.0f %12.0f %16s %8.1f\n", f == 0 ? "json" : "binary", POLICIES[p].name,
+             r.requestsPerMinute, r.airBytesPerMinute, r.busyMsPerMinute, latency, r.allocationsPerSample);
+    }
+  }
+
+  for (int f = 0; f < 2; f++) {
+    bool delivered = true;
+    for (int p = 0; p < count; p++) {
+      const UploadStats& s = results[f][p].stats;
+      delivered = delivered && s.failures == 0 && s.dropped == 0 && s.delivered + 12 >= s.samples;
+    }
+    check(f == 0 ? "json: every reading delivered" : "binary: every reading delivered", delivered);
+  }
+  const PolicyResult& single = results[1][0];
+  const PolicyResult& batched = results[1][1];
+  check("6 per batch cuts requests sixfold", batched.requestsPerMinute * 5.5f < single.requestsPerMinute);
+  check("batching cuts bytes on air", batched.airBytesPerMinute * 2 < single.airBytesPerMinute);
+  check("age bound holds", results[1][3].latencyMax <= 20000 + POLL_MS + 1000 &&
+        results[1][1].latencyMax <= 30000 + POLL_MS + 1000);
+  check("binary batches use no heap", batched.allocationsPerSample == 0);
+  check("binary under json on air", batched.airBytesPerMinute < results[0][1].airBytesPerMinute);
+}
+
+void runOutage() {
+  simSetMillis(0);
+  SimHttp http;
+  http.setLatencyMs(80);
+  TelemetryUploader uploader(&http, URL, UPLOAD_BINARY, 6, 30000);
+
+  // 25 s outage: the readings fit in the room left above the batch size
+  uint32_t taken = 0;
+  unsigned long nextSample = SAMPLE_MS;
+  unsigned long end = 5 * 60000UL;
+  while (millis() < end) {
+    http.setFailing(millis() >= 60000 && millis() < 85000);
+    if (millis() >= nextSample) {
+      uploader.add(simReading(taken++));
+      nextSample += SAMPLE_MS;
+    }
+    uploader.poll(true);
+    delay(POLL_MS);
+  }
+  uploader.flush();
+  const UploadStats& s = uploader.stats();
+  printf("outage 25 s: %lu readings, %lu delivered, %lu dropped, %lu failed requests, max latency %lu ms\n",
+         (unsigned long)s.samples, (unsigned long)s.delivered, (unsigned long)s.dropped, (unsigned long)s.failures,
+         (unsigned long)s.latencyMsMax);
+  check("short outage loses nothing", s.delivered == taken && s.dropped == 0 && s.failures > 0);
+  check("retried after UPLOAD_RETRY_MS", s.latencyMsMax < 25000 + 30000 + UPLOAD_RETRY_MS + POLL_MS);
+
+  // 5 min outage: only the newest UPLOAD_BATCH_SAMPLES are kept
+  simSetMillis(0);
+  SimHttp down;
+  TelemetryUploader full(&down, URL, UPLOAD_BINARY, 6, 30000);
+  down.setFailing(true);
+  for (int i = 0; i < 60; i++) {
+    full.add(simReading(i));
+    full.poll(true);
+    delay(SAMPLE_MS);
+  }
+  down.setFailing(false);
+  delay(UPLOAD_RETRY_MS);
+  full.poll(true);
+  printf("outage 5 min: %lu readings, %lu delivered, %lu dropped\n", (unsigned long)full.stats().samples,
+         (unsigned long)full.stats().delivered, (unsigned long)full.stats().dropped);
+  check("long outage keeps the newest readings", full.stats().delivered == UPLOAD_BATCH_SAMPLES &&
+        full.stats().dropped == 60 - UPLOAD_BATCH_SAMPLES);
+}
+
+void runMonitor() {
+  simSetMillis(0);
+  SimBoard board;
+  board.http.setRecordBodies(false);
+  MonitorHal hal = {&board.ppg, &board.imu, &board.temp, &board.http, &board.channel, nullptr, &board.display,
+                    nullptr, nullptr, nullptr, nullptr, nullptr};
+  MonitorConfig config = {"1234567890", URL, "/api/emergency", "", 2, 5, 18, NO_PIN, 0, true, POWER_FIXED};
+  HealthMonitor monitor(hal, config);
+  monitor.begin();
+  monitor.setNetworkConnected(true);
+  unsigned long end = millis() + 10 * 60000UL;
+  while (millis() < end) monitor.loop();
+
+  const UploadStats& s = monitor.uploads().stats();
+  printf("monitor 10 min: %lu readings, %lu POSTs, %lu delivered, %llu body bytes, %lu WebSocket messages\n",
+         (unsigned long)s.samples, (unsigned long)board.http.requests().size(), (unsigned long)s.delivered,
+         board.http.bytesSent(), board.channel.messagesSent());
+  check("one reading per vitals period", s.samples >= 119 && s.samples <= 120);
+  check("readings go over HTTP only", board.channel.messagesSent() == 0 && s.delivered + UPLOAD_BATCH_SAMPLES >= s.samples);
+  // The 30 s age limit closes each batch on its seventh reading
+  check("batches close on age", board.http.requests().size() >= 16 && board.http.requests().size() <= 18);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = benchQuick(argc, argv);
+  Serial.setEcho(false);
+  runPolicies(quick ? 20 : 60);
+  runOutage();
+  runMonitor();
+  return benchResult();
+}
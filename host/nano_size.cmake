@@ -0,0 +1,62 @@
+# RescueNet AI - Nano RAM check
+#
+# Builds codes/nano_enhanced.ino for the Arduino Nano with arduino-cli and
+# adds up the .data and .bss avr-size reports: every global, string and
+# vtable the sketch, the library and the core keep in RAM. What is left
+# of NANO_RAM_BYTES must be at least NANO_STACK_RAM_BYTES (ram_budget.h).
+# Needs the AVR core and the sketch's libraries:
+#
+#   arduino-cli core install arduino:avr
+#   arduino-cli lib install OneWire DallasTemperature
+#
+# Run through the nano_size target, which passes ARDUINO_CLI, SOURCE_DIR
+# and BINARY_DIR.
+
+# arduino-cli builds every .ino in a folder; the sketch gets one of its own
+set(SKETCH_DIR ${BINARY_DIR}/nano_enhanced)
+file(MAKE_DIRECTORY ${SKETCH_DIR})
+foreach(file nano_enhanced.ino nano_hal.h ds18b20_temp.h)
+  configure_file(${SOURCE_DIR}/codes/${file} ${SKETCH_DIR}/${file} COPYONLY)
+endforeach()
+
+execute_process(
+  COMMAND ${ARDUINO_CLI} compile --fqbn arduino:avr:nano --library ${SOURCE_DIR}/lib/rescuenet
+          --build-path ${BINARY_DIR}/build ${SKETCH_DIR}
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "arduino-cli could not build the Nano sketch")
+endif()
+
+# The toolchain arduino-cli installed, unless there is one on the PATH
+file(GLOB AVR_GCC_BINS $ENV{HOME}/.arduino15/packages/arduino/tools/avr-gcc/*/bin)
+find_program(AVR_SIZE avr-size HINTS ${AVR_GCC_BINS})
+if(NOT AVR_SIZE)
+  message(FATAL_ERROR "avr-size not found")
+endif()
+execute_process(
+  COMMAND ${AVR_SIZE} -A ${BINARY_DIR}/build/nano_enhanced.ino.elf
+  OUTPUT_VARIABLE sections
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "avr-size could not read the Nano sketch")
+endif()
+foreach(section data bss)
+  string(REGEX MATCH "\n\\.${section} +([0-9]+)" match "${sections}")
+  if(NOT match)
+    message(FATAL_ERROR "No .${section} in the avr-size output:\n${sections}")
+  endif()
+  set(${section} ${CMAKE_MATCH_1})
+endforeach()
+
+file(READ ${SOURCE_DIR}/lib/rescuenet/src/ram_budget.h budget)
+string(REGEX MATCH "#define NANO_RAM_BYTES ([0-9]+)" match "${budget}")
+set(ram ${CMAKE_MATCH_1})
+string(REGEX MATCH "#define NANO_STACK_RAM_BYTES ([0-9]+)" match "${budget}")
+set(stack ${CMAKE_MATCH_1})
+
+math(EXPR used "${data} + ${bss}")
+math(EXPR left "${ram} - ${used}")
+message(STATUS "Nano RAM: .data ${data} + .bss ${bss} = ${used} of ${ram} bytes, ${left} left for the stack")
+if(left LESS stack)
+  message(FATAL_ERROR "The Nano sketch leaves less than NANO_STACK_RAM_BYTES (${stack}) for the stack")
+endif()
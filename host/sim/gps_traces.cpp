@@ -0,0 +1,346 @@
+/*
+ * RescueNet AI - Synthetic GPS streams and a simulated receiver
+ */
+
+#include "gps_traces.h"
+
+#include <Arduino.h>
+
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+// Nagpur, and a walk north-east at about 1.3 m/s (1e-7 degree is ~1 cm)
+const int32_t START_LATITUDE = 211458000;
+const int32_t START_LONGITUDE = 790882000;
+const int32_t STEP_LATITUDE = 90;
+const int32_t STEP_LONGITUDE = 97;
+const int32_t START_ALTITUDE_DM = 3102;
+const char* SPEED_KNOTS = "2.585";
+const uint32_t SPEED_MM_S = 1330;
+const char* DATE = "140326";
+
+// Epochs at the start without a fix, and before damage starts
+const unsigned NMEA_NO_FIX_EPOCHS = 3;
+const unsigned UBX_NO_FIX_EPOCHS = 2;
+const unsigned CLEAN_EPOCHS = 5;
+
+const uint16_t PVT_LENGTH = 92;
+
+struct Random {
+  uint32_t state;
+  uint32_t next() {
+    state = state * 1103515245u + 12345u;
+    return state >> 16;
+  }
+  int32_t jitter(int32_t range) { return (int32_t)(next() % (2 * range + 1)) - range; }
+};
+
+std::string sentence(const char* body) {
+  uint8_t checksum = 0;
+  for (const char* p = body; *p; p++) checksum ^= (uint8_t)*p;
+  char tail[8];
+  snprintf(tail, sizeof(tail), "*%02X\r\n", checksum);
+  return std::string("$") + body + tail;
+}
+
+// A digit past the middle of the body changed; the checksum no longer fits
+void damage(std::string& text) {
+  size_t star = text.find('*');
+  for (size_t i = star / 2; i < star; i++) {
+    if (text[i] >= '0' && text[i] <= '9') {
+      text[i] = (char)('0' + (text[i] - '0' + 1) % 10);
+      return;
+    }
+  }
+  text[1] = text[1] == 'G' ? 'X' : 'G';
+}
+
+// ddmm.mmmmm (or dddmm.mmmmm) for a 1e-7 degree value, and the value the
+// text stands for
+std::string nmeaAngle(int32_t value, int degreeDigits, int32_t& encoded) {
+  uint32_t v = (uint32_t)(value < 0 ? -value : value);
+  uint32_t degrees = v / 10000000UL;
+  uint32_t minutes = (v % 10000000UL * 6 + 5) / 10;  // 1e-5 minute
+  char text[20];
+  snprintf(text, sizeof(text), "%0*u%02u.%05u", degreeDigits, (unsigned)degrees, (unsigned)(minutes / 100000),
+           (unsigned)(minutes % 100000));
+  encoded = (int32_t)(degrees * 10000000UL + (minutes * 10 + 3) / 6);
+  return text;
+}
+
+void put16(std::string& out, size_t at, uint16_t value) {
+  out[at] = (char)value;
+  out[at + 1] = (char)(value >> 8);
+}
+
+void put32(std::string& out, size_t at, uint32_t value) {
+  put16(out, at, (uint16_t)value);
+  put16(out, at + 2, (uint16_t)(value >> 16));
+}
+
+std::string ubxFrame(uint8_t cls, uint8_t id, const std::string& payload) {
+  std::string frame(payload.size() + UBX_OVERHEAD, '\0');
+  GpsParser::frameUbx(cls, id, (const uint8_t*)payload.data(), (uint16_t)payload.size(), (uint8_t*)&frame[0],
+                      frame.size());
+  return frame;
+}
+
+}  // namespace
+
+GpsTrace makeNmeaTrace(unsigned seconds, uint32_t seed, unsigned corruptEvery) {
+  GpsTrace trace;
+  trace.sentences = 0;
+  trace.corrupted = 0;
+  trace.bytes = 0;
+  Random random = {seed};
+  unsigned counted = 0;
+
+  for (unsigned k = 0; k < seconds; k++) {
+    uint32_t utc = GPS_TRACE_START_UTC + k;
+    uint32_t day = utc % 86400UL;
+    char time[16];
+    snprintf(time, sizeof(time), "%02u%02u%02u.00", (unsigned)(day / 3600), (unsigned)(day / 60 % 60),
+             (unsigned)(day % 60));
+
+    bool fix = k >= NMEA_NO_FIX_EPOCHS;
+    GpsTruth truth = {};
+    std::vector<std::string> bodies;
+    char body[96];
+    if (fix) {
+      std::string lat = nmeaAngle(START_LATITUDE + (int32_t)k * STEP_LATITUDE + random.jitter(20), 2,
+                                  truth.latitude);
+      std::string lon = nmeaAngle(START_LONGITUDE + (int32_t)k * STEP_LONGITUDE + random.jitter(20), 3,
+                                  truth.longitude);
+      int32_t altitudeDm = START_ALTITUDE_DM + random.jitter(5);
+      truth.altitudeMm = altitudeDm * 100;
+      truth.satellites = (uint8_t)(7 + random.next() % 4);
+      truth.utcSeconds = utc;
+      unsigned hdop = 90 + random.next() % 60;
+
+      snprintf(body, sizeof(body), "GPRMC,%s,A,%s,N,%s,E,%s,45.0,%s,,,A", time, lat.c_str(), lon.c_str(),
+               SPEED_KNOTS, DATE);
+      bodies.push_back(body);
+      snprintf(body, sizeof(body), "GPVTG,45.0,T,,M,%s,N,4.787,K,A", SPEED_KNOTS);
+      bodies.push_back(body);
+      snprintf(body, sizeof(body), "GPGGA,%s,%s,N,%s,E,1,%02u,%u.%02u,%d.%d,M,-95.3,M,,", time, lat.c_str(),
+               lon.c_str(), truth.satellites, hdop / 100, hdop % 100, (int)(altitudeDm / 10),
+               (int)(altitudeDm % 10));
+      bodies.push_back(body);
+      bodies.push_back("GPGSA,A,3,05,07,13,15,18,20,24,30,,,,,2.10,1.01,1.84");
+      bodies.push_back("GPGSV,3,1,11,05,45,120,32,07,62,015,38,13,22,301,29,15,31,204,33");
+      bodies.push_back("GPGSV,3,2,11,18,12,055,21,20,71,268,41,24,18,160,25,30,40,330,36");
+      bodies.push_back("GPGSV,3,3,11,02,05,090,,09,08,190,,28,03,250,");
+      snprintf(body, sizeof(body), "GPGLL,%s,N,%s,E,%s,A,A", lat.c_str(), lon.c_str(), time);
+      bodies.push_back(body);
+    } else {
+      snprintf(body, sizeof(body), "GPRMC,%s,V,,,,,,,%s,,,N", time, DATE);
+      bodies.push_back(body);
+      bodies.push_back("GPVTG,,,,,,,,,N");
+      snprintf(body, sizeof(body), "GPGGA,%s,,,,,0,00,99.99,,,,,,", time);
+      bodies.push_back(body);
+      bodies.push_back("GPGSA,A,1,,,,,,,,,,,,,99.99,99.99,99.99");
+      bodies.push_back("GPGSV,1,1,00");
+      snprintf(body, sizeof(body), "GPGLL,,,,,%s,V,N", time);
+      bodies.push_back(body);
+    }
+
+    GpsBurst burst;
+    burst.atMs = k * 1000UL;
+    bool ggaIntact = true;
+    for (size_t i = 0; i < bodies.size(); i++) {
+      std::string text = sentence(bodies[i].c_str());
+      if (corruptEvery && k >= CLEAN_EPOCHS && ++counted % corruptEvery == 0) {
+        damage(text);
+        trace.corrupted++;
+        if (bodies[i].compare(2, 3, "GGA") == 0) ggaIntact = false;
+      }
+      burst.bytes += text;
+      trace.sentences++;
+    }
+    if (fix && ggaIntact) trace.fixes.push_back(truth);
+    trace.bytes += burst.bytes.size();
+    trace.bursts.push_back(burst);
+  }
+  return trace;
+}
+
+GpsTrace makeUbxTrace(unsigned seconds, uint16_t rateMs, uint32_t seed) {
+  GpsTrace trace;
+  trace.sentences = 0;
+  trace.corrupted = 0;
+  trace.bytes = 0;
+  Random random = {seed};
+
+  unsigned epochs = seconds * 1000UL / rateMs;
+  for (unsigned k = 0; k < epochs; k++) {
+    uint32_t ms = k * (uint32_t)rateMs;
+    // The receiver rounds to the nearest second and reports the rest in nano
+    uint32_t second = ms / 1000 + (ms % 1000 >= 500 ? 1 : 0);
+    int32_t nano = ((int32_t)ms - (int32_t)second * 1000) * 1000000L;
+    uint32_t utc = GPS_TRACE_START_UTC + second;
+    uint32_t day = utc % 86400UL;
+
+    bool fix = k >= UBX_NO_FIX_EPOCHS;
+    GpsTruth truth = {};
+    truth.utcSeconds = GPS_TRACE_START_UTC + ms / 1000;
+    truth.utcMillis = (uint16_t)(ms % 1000);
+    truth.latitude = START_LATITUDE + (int32_t)(ms * STEP_LATITUDE / 1000) + random.jitter(20);
+    truth.longitude = START_LONGITUDE + (int32_t)(ms * STEP_LONGITUDE / 1000) + random.jitter(20);
+    truth.altitudeMm = START_ALTITUDE_DM * 100 + random.jitter(400);
+    truth.satellites = (uint8_t)(7 + random.next() % 4);
+
+    std::string payload(PVT_LENGTH, '\0');
+    put32(payload, 0, (uint32_t)(ms + 518400000UL));  // iTOW
+    put16(payload, 4, 2026);
+    payload[6] = 3;
+    payload[7] = 14;
+    payload[8] = (char)(day / 3600);
+    payload[9] = (char)(day / 60 % 60);
+    payload[10] = (char)(day % 60);
+    payload[11] = 0x07;  // Date, time, fully resolved
+    put32(payload, 16, (uint32_t)nano);
+    if (fix) {
+      payload[20] = 3;
+      payload[21] = 0x01;  // gnssFixOK
+      payload[23] = (char)truth.satellites;
+      put32(payload, 24, (uint32_t)truth.longitude);
+      put32(payload, 28, (uint32_t)truth.latitude);
+      put32(payload, 32, (uint32_t)(truth.altitudeMm - 95300));  // Above the ellipsoid
+      put32(payload, 36, (uint32_t)truth.altitudeMm);
+      put32(payload, 60, SPEED_MM_S);
+      put16(payload, 76, (uint16_t)(150 + random.next() % 80));
+    }
+
+    GpsBurst burst;
+    burst.atMs = ms;
+    burst.bytes = ubxFrame(UBX_CLASS_NAV, UBX_NAV_PVT, payload);
+    if (fix) trace.fixes.push_back(truth);
+    trace.sentences++;
+    trace.bytes += burst.bytes.size();
+    trace.bursts.push_back(burst);
+  }
+  return trace;
+}
+
+GpsTrace loadNmeaLog(const char* path) {
+  GpsTrace trace;
+  trace.sentences = 0;
+  trace.corrupted = 0;
+  trace.bytes = 0;
+  std::ifstream in(path, std::ios::binary);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line.size() < 7 || line[0] != '$') continue;
+    // NEO-6M and most others start each epoch with RMC
+    if (trace.bursts.empty() || line.compare(3, 3, "RMC") == 0) {
+      GpsBurst burst;
+      burst.atMs = trace.bursts.size() * 1000UL;
+      trace.bursts.push_back(burst);
+    }
+    trace.bursts.back().bytes += line + "\r\n";
+    trace.bytes += line.size() + 2;
+    trace.sentences++;
+  }
+  return trace;
+}
+
+SimGpsPort::SimGpsPort(uint32_t baud, size_t ringBytes)
+  : baud(baud), capacity(ringBytes), lineFreeUs(0), delivered(0), overflowed(0), configs(0), answer(false),
+    navPvt(true), replyMs(50), ubxOutput(false) {}
+
+void SimGpsPort::play(const GpsTrace& trace, unsigned long startMs) {
+  for (size_t i = 0; i < trace.bursts.size(); i++) schedule(startMs + trace.bursts[i].atMs, trace.bursts[i].bytes);
+}
+
+void SimGpsPort::setConfigReplies(bool answerConfig, bool hasNavPvt, unsigned long replyDelayMs) {
+  answer = answerConfig;
+  navPvt = hasNavPvt;
+  replyMs = replyDelayMs;
+}
+
+void SimGpsPort::schedule(unsigned long atMs, const std::string& bytes) {
+  GpsBurst burst = {atMs, bytes};
+  std::deque<GpsBurst>::iterator it = scheduled.end();
+  while (it != scheduled.begin() && (it - 1)->atMs > atMs) --it;
+  scheduled.insert(it, burst);
+}
+
+void SimGpsPort::queue(uint64_t atUs, const std::string& bytes) {
+  uint64_t byteUs = 10000000ULL / baud;  // Start, eight data and stop bits
+  uint64_t at = atUs > lineFreeUs ? atUs : lineFreeUs;
+  for (size_t i = 0; i < bytes.size(); i++) {
+    at += byteUs;
+    Arrival arrival = {at, (uint8_t)bytes[i]};
+    arrivals.push_back(arrival);
+  }
+  lineFreeUs = at;
+}
+
+void SimGpsPort::arrive() {
+  uint64_t now = micros();
+  while (!scheduled.empty() && scheduled.front().atMs * 1000ULL <= now) {
+    queue(scheduled.front().atMs * 1000ULL, scheduled.front().bytes);
+    scheduled.pop_front();
+  }
+  while (!arrivals.empty() && arrivals.front().atUs <= now) {
+    if (ring.size() < capacity) {
+      ring.push_back(arrivals.front().byte);
+      delivered++;
+    } else {
+      overflowed++;
+    }
+    arrivals.pop_front();
+  }
+}
+
+int SimGpsPort::available() {
+  arrive();
+  return (int)ring.size();
+}
+
+int SimGpsPort::read() {
+  arrive();
+  if (ring.empty()) return -1;
+  uint8_t byte = ring.front();
+  ring.pop_front();
+  return byte;
+}
+
+size_t SimGpsPort::write(const uint8_t* data, size_t length) {
+  written.append((const char*)data, length);
+  for (;;) {
+    size_t start = written.find((char)UBX_SYNC1);
+    if (start == std::string::npos) {
+      written.clear();
+      break;
+    }
+    written.erase(0, start);
+    if (written.size() < 6) break;
+    size_t payloadLength = (uint8_t)written[4] | ((size_t)(uint8_t)written[5] << 8);
+    if (written.size() < payloadLength + UBX_OVERHEAD) break;
+
+    uint8_t cls = (uint8_t)written[2];
+    uint8_t id = (uint8_t)written[3];
+    std::string payload = written.substr(6, payloadLength);
+    written.erase(0, payloadLength + UBX_OVERHEAD);
+    if (cls != UBX_CLASS_CFG) continue;
+    configs++;
+    if (!answer) continue;
+
+    bool ack = true;
+    if (id == UBX_CFG_MSG && payload.size() >= 2 && (uint8_t)payload[0] == UBX_CLASS_NAV &&
+        (uint8_t)payload[1] == UBX_NAV_PVT) {
+      ack = navPvt;
+    }
+    if (id == UBX_CFG_PRT && ack && payload.size() >= 16) ubxOutput = ((uint8_t)payload[14] & 0x03) == 0x01;
+    std::string reply;
+    reply += (char)cls;
+    reply += (char)id;
+    schedule(millis() + replyMs, ubxFrame(UBX_CLASS_ACK, ack ? UBX_ACK_ACK : UBX_ACK_NAK, reply));
+  }
+  return length;
+}
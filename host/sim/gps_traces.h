@@ -0,0 +1,111 @@
+/*
+ * RescueNet AI - Synthetic GPS streams and a simulated receiver
+ *
+ * Builds what a receiver sends while the wearer walks through Nagpur:
+ * the NEO-6M's default NMEA set (RMC, VTG, GGA, GSA, three GSV and GLL)
+ * once a second, starting with a few epochs without a fix, with every
+ * so often a sentence damaged in transit; or one UBX NAV-PVT per epoch
+ * at any rate. Each trace carries the fixes a parser should get out of
+ * it, exactly as they were encoded.
+ *
+ * SimGpsPort plays bursts out at the UART's baud rate in virtual time
+ * into a receive ring of a given size, dropping what arrives while the
+ * ring is full the way the UART drivers do, and can answer UBX
+ * configuration with ACK-ACK or ACK-NAK like a u-blox receiver.
+ */
+
+#ifndef HOST_GPS_TRACES_H
+#define HOST_GPS_TRACES_H
+
+#include <gps_parser.h>
+#include <hal.h>
+
+#include <deque>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// 2026-03-14 10:15:00 UTC, when every trace starts
+#define GPS_TRACE_START_UTC 1773483300UL
+
+struct GpsBurst {
+  unsigned long atMs;  // Since the start of the trace
+  std::string bytes;
+};
+
+struct GpsTruth {
+  uint32_t utcSeconds;
+  uint16_t utcMillis;
+  int32_t latitude;  // 1e-7 degree
+  int32_t longitude;
+  int32_t altitudeMm;
+  uint8_t satellites;
+};
+
+struct GpsTrace {
+  std::vector<GpsBurst> bursts;
+  std::vector<GpsTruth> fixes;  // Those that arrive intact, in order
+  unsigned sentences;           // NMEA sentences or UBX messages
+  unsigned corrupted;
+  size_t bytes;
+};
+
+// seconds epochs of NMEA; every corruptEvery-th sentence after the
+// first few epochs gets a character changed (0: none)
+GpsTrace makeNmeaTrace(unsigned seconds, uint32_t seed, unsigned corruptEvery = 0);
+// NAV-PVT every rateMs for seconds
+GpsTrace makeUbxTrace(unsigned seconds, uint16_t rateMs, uint32_t seed);
+// A recorded NMEA log, one burst per second of its RMC times
+GpsTrace loadNmeaLog(const char* path);
+
+class SimGpsPort : public SerialPort {
+public:
+  SimGpsPort(uint32_t baud, size_t ringBytes);
+
+  int available() override;
+  int read() override;
+  size_t write(const uint8_t* data, size_t length) override;
+  using SerialPort::write;
+
+  // Bursts of the trace, from startMs of the virtual clock on
+  void play(const GpsTrace& trace, unsigned long startMs);
+  // Answers CFG messages after replyMs; refuses CFG-MSG for NAV-PVT
+  // when it is an older receiver
+  void setConfigReplies(bool answer, bool navPvt, unsigned long replyMs = 50);
+
+  // Everything played has been read
+  bool drained() const { return scheduled.empty() && arrivals.empty() && ring.empty(); }
+  unsigned long received() const { return delivered; }
+  unsigned long dropped() const { return overflowed; }
+  unsigned long configMessages() const { return configs; }
+  // The last CFG-PRT left the port with UBX output only
+  bool ubxOnly() const { return ubxOutput; }
+
+private:
+  struct Arrival {
+    uint64_t atUs;
+    uint8_t byte;
+  };
+
+  // Bursts go on the wire when due, so replies interleave with the trace
+  void schedule(unsigned long atMs, const std::string& bytes);
+  void queue(uint64_t atUs, const std::string& bytes);
+  void arrive();
+
+  uint32_t baud;
+  size_t capacity;
+  std::deque<GpsBurst> scheduled;  // atMs of the virtual clock
+  std::deque<Arrival> arrivals;
+  uint64_t lineFreeUs;  // The wire is busy until then
+  std::deque<uint8_t> ring;
+  unsigned long delivered;
+  unsigned long overflowed;
+  unsigned long configs;
+  bool answer;
+  bool navPvt;
+  unsigned long replyMs;
+  bool ubxOutput;
+  std::string written;  // Up to the next whole UBX frame
+};
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * RescueNet AI - Host heap accounting
+ */
+
+#include "heap_stats.h"
+
+#include <atomic>
+#include <new>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+// Each block carries its size in front so delete can account for it
+struct alignas(16) BlockHeader {
+  size_t size;
+};
+
+// Atomic so allocations from host worker threads are counted safely
+std::atomic<uint64_t> allocations(0);
+std::atomic<uint64_t> frees(0);
+std::atomic<uint64_t> bytesAllocated(0);
+std::atomic<int64_t> bytesInUse(0);
+std::atomic<int64_t> peakBytesInUse(0);
+
+void* allocate(size_t size) {
+  BlockHeader* block = (BlockHeader*)malloc(sizeof(BlockHeader) + size);
+  if (!block) throw std::bad_alloc();
+  block->size = size;
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  bytesAllocated.fetch_add(size, std::memory_order_relaxed);
+  int64_t inUse = bytesInUse.fetch_add((int64_t)size, std::memory_order_relaxed) + (int64_t)size;
+  int64_t peak = peakBytesInUse.load(std::memory_order_relaxed);
+  while (inUse > peak && !peakBytesInUse.compare_exchange_weak(peak, inUse, std::memory_order_relaxed)) {
+  }
+  return block + 1;
+}
+
+void release(void* ptr) {
+  if (!ptr) return;
+  BlockHeader* block = (BlockHeader*)ptr - 1;
+  frees.fetch_add(1, std::memory_order_relaxed);
+  bytesInUse.fetch_sub((int64_t)block->size, std::memory_order_relaxed);
+  free(block);
+}
+
+const uint8_t STACK_PAINT = 0xA5;
+
+struct StackRun {
+  void (*fn)(void*);
+  void* context;
+};
+
+void* runOnStack(void* arg) {
+  StackRun* run = (StackRun*)arg;
+  run->fn(run->context);
+  return nullptr;
+}
+
+void nothing(void*) {}
+
+size_t stackUsed(void (*fn)(void*), void* context, size_t stackBytes) {
+  // malloc, not new, so the stack stays out of the heap figures
+  uint8_t* stack = nullptr;
+  if (posix_memalign((void**)&stack, 4096, stackBytes) != 0) return 0;
+  memset(stack, STACK_PAINT, stackBytes);
+  StackRun run = {fn, context};
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstack(&attr, stack, stackBytes);
+  pthread_t thread;
+  size_t used = 0;
+  if (pthread_create(&thread, &attr, runOnStack, &run) == 0) {
+    pthread_join(thread, nullptr);
+    // The stack grows down; the first overwritten byte from the bottom marks the deepest point
+    size_t untouched = 0;
+    while (untouched < stackBytes && stack[untouched] == STACK_PAINT) untouched++;
+    used = stackBytes - untouched;
+  }
+  pthread_attr_destroy(&attr);
+  free(stack);
+  return used;
+}
+
+}  // namespace
+
+HeapStats heapStats() {
+  HeapStats out;
+  out.allocations = allocations.load();
+  out.frees = frees.load();
+  out.bytesAllocated = bytesAllocated.load();
+  out.bytesInUse = bytesInUse.load();
+  out.peakBytesInUse = peakBytesInUse.load();
+  return out;
+}
+
+void heapResetPeak() {
+  peakBytesInUse.store(bytesInUse.load());
+}
+
+size_t stackHighWater(void (*fn)(void*), void* context, size_t stackBytes) {
+  // Less what the thread start-up and its TLS take at the top of the stack
+  size_t baseline = stackUsed(nothing, nullptr, stackBytes);
+  size_t used = stackUsed(fn, context, stackBytes);
+  return used > baseline ? used - baseline : 0;
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void operator delete(void* ptr) noexcept { release(ptr); }
+void operator delete[](void* ptr) noexcept { release(ptr); }
+void operator delete(void* ptr, size_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { release(ptr); }
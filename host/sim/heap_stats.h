@@ -0,0 +1,38 @@
+/*
+ * RescueNet AI - Host heap accounting
+ *
+ * Replaces the global operator new/delete so the simulator can report how
+ * many allocations (and bytes) a stretch of firmware code performs. The
+ * host String shim allocates through new[], so this sees the same churn
+ * the Arduino String class causes on the boards.
+ *
+ * stackHighWater() is the stack side: it runs a function on a fresh
+ * stack painted with a known byte, like FreeRTOS does for
+ * uxTaskGetStackHighWaterMark(), and reports how deep it reached. Frame
+ * sizes differ from the boards' compilers, so compare runs against each
+ * other rather than with a board's stack size.
+ */
+
+#ifndef HOST_HEAP_STATS_H
+#define HOST_HEAP_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct HeapStats {
+  uint64_t allocations;
+  uint64_t frees;
+  uint64_t bytesAllocated;
+  int64_t bytesInUse;
+  int64_t peakBytesInUse;
+};
+
+HeapStats heapStats();
+// Restarts the peak tracker from the current usage
+void heapResetPeak();
+
+// Runs fn(context) on its own thread with a stackBytes stack and returns
+// the most of that stack it used, in bytes
+size_t stackHighWater(void (*fn)(void*), void* context, size_t stackBytes = 256 * 1024);
+
+#endif
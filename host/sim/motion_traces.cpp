@@ -0,0 +1,286 @@
+/*
+ * RescueNet AI - Synthetic labeled IMU traces
+ */
+
+#include "motion_traces.h"
+
+#include <math.h>
+
+namespace {
+
+const float PI_F = 3.14159265359f;
+
+void normalize(float v[3]) {
+  float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  if (length <= 0) return;
+  for (int i = 0; i < 3; i++) v[i] /= length;
+}
+
+int16_t toCounts(float value, float scale) {
+  float counts = value * scale;
+  if (counts > 32767.0f) return 32767;
+  if (counts < -32768.0f) return -32768;
+  return (int16_t)lrintf(counts);
+}
+
+// Parameter jitter: value scaled by 1 +- spread, fixed per (variant, slot)
+float jitter(float value, int variant, int slot, float spread) {
+  uint32_t h = (uint32_t)(variant * 2654435761UL) ^ (uint32_t)(slot * 40503UL);
+  h ^= h >> 13;
+  h *= 0x5bd1e995UL;
+  h ^= h >> 15;
+  float unit = (float)(h % 2001) / 1000.0f - 1.0f;
+  return value * (1.0f + spread * unit);
+}
+
+}  // namespace
+
+MotionTraceBuilder::MotionTraceBuilder(uint16_t sampleRateHz, uint32_t seed)
+  : rateHz(sampleRateHz), random(seed), impactAt(0) {
+  setPosture(0.005f, -0.008f, 1.0f);
+}
+
+void MotionTraceBuilder::setPosture(float x, float y, float z) {
+  posture[0] = x;
+  posture[1] = y;
+  posture[2] = z;
+  normalize(posture);
+}
+
+float MotionTraceBuilder::noise(float amplitude) {
+  return amplitude * random.uniform();
+}
+
+void MotionTraceBuilder::emit(float ax, float ay, float az, float gx, float gy, float gz) {
+  const float accelScale = (float)IMU_ACCEL_LSB_PER_G;
+  const float gyroScale = IMU_GYRO_LSB_PER_DPS_X10 / 10.0f;
+  ImuSample s;
+  s.ax = toCounts(ax, accelScale);
+  s.ay = toCounts(ay, accelScale);
+  s.az = toCounts(az, accelScale);
+  s.gx = toCounts(gx, gyroScale);
+  s.gy = toCounts(gy, gyroScale);
+  s.gz = toCounts(gz, gyroScale);
+  out.push_back(s);
+}
+
+void MotionTraceBuilder::still(unsigned long ms, float noiseG) {
+  size_t n = ms * rateHz / 1000;
+  for (size_t i = 0; i < n; i++) {
+    emit(posture[0] + noise(noiseG), posture[1] + noise(noiseG), posture[2] + noise(noiseG),
+         noise(2), noise(2), noise(2));
+  }
+}
+
+void MotionTraceBuilder::walk(unsigned long ms, float swingG, float stepHz) {
+  size_t n = ms * rateHz / 1000;
+  for (size_t i = 0; i < n; i++) {
+    float t = (float)i / rateHz;
+    float vertical = 1.0f + swingG * sinf(2 * PI_F * stepHz * t);
+    float sway = 0.15f * sinf(PI_F * stepHz * t);
+    emit(posture[0] * vertical + sway + noise(0.05f), posture[1] * vertical + noise(0.05f),
+         posture[2] * vertical + noise(0.05f), 25.0f * sinf(PI_F * stepHz * t) + noise(3),
+         10.0f * sinf(2 * PI_F * stepHz * t) + noise(3), noise(3));
+  }
+}
+
+void MotionTraceBuilder::run(unsigned long ms) {
+  const float strideHz = 2.7f;
+  size_t n = ms * rateHz / 1000;
+  for (size_t i = 0; i < n; i++) {
+    float phase = fmodf(strideHz * (float)i / rateHz, 1.0f);
+    // Flight phase near 0 g, then a stance peak of ~2.6 g
+    float vertical = phase < 0.35f ? 0.15f : 1.0f + 1.6f * sinf(PI_F * (phase - 0.35f) / 0.65f);
+    emit(posture[0] * vertical + noise(0.1f), posture[1] * vertical + noise(0.1f),
+         posture[2] * vertical + noise(0.1f), 60.0f * sinf(2 * PI_F * phase) + noise(5),
+         20.0f * cosf(2 * PI_F * phase) + noise(5), noise(5));
+  }
+}
+
+void MotionTraceBuilder::freeFall(unsigned long ms, float levelG, float x, float y, float z) {
+  float from[3] = {posture[0], posture[1], posture[2]};
+  float to[3] = {x, y, z};
+  normalize(to);
+  float dot = from[0] * to[0] + from[1] * to[1] + from[2] * to[2];
+  float angleDeg = acosf(fmaxf(-1.0f, fminf(1.0f, dot))) * 180.0f / PI_F;
+  size_t n = ms * rateHz / 1000;
+  float rateDps = n ? angleDeg * rateHz / n : 0;
+  for (size_t i = 0; i < n; i++) {
+    float k = (float)(i + 1) / n;
+    float dir[3] = {from[0] + (to[0] - from[0]) * k, from[1] + (to[1] - from[1]) * k,
+                    from[2] + (to[2] - from[2]) * k};
+    normalize(dir);
+    emit(dir[0] * levelG + noise(0.03f), dir[1] * levelG + noise(0.03f), dir[2] * levelG + noise(0.03f),
+         rateDps + noise(5), noise(5), noise(5));
+  }
+  setPosture(to[0], to[1], to[2]);
+}
+
+void MotionTraceBuilder::impact(unsigned long ms, float peakG) {
+  size_t n = ms * rateHz / 1000;
+  if (n == 0) n = 1;
+  impactAt = out.size() + n / 2;
+  for (size_t i = 0; i < n; i++) {
+    float shock = peakG * sinf(PI_F * (float)(i + 1) / (n + 1));
+    // Mostly along gravity with some lateral component
+    emit(posture[0] * shock + 0.3f * shock + noise(0.1f), posture[1] * shock + noise(0.1f),
+         posture[2] * shock + noise(0.1f), 150.0f + noise(20), -80.0f + noise(20), noise(20));
+  }
+}
+
+void MotionTraceBuilder::rotate(unsigned long ms, float x, float y, float z) {
+  float from[3] = {posture[0], posture[1], posture[2]};
+  float to[3] = {x, y, z};
+  normalize(to);
+  float dot = from[0] * to[0] + from[1] * to[1] + from[2] * to[2];
+  float angleDeg = acosf(fmaxf(-1.0f, fminf(1.0f, dot))) * 180.0f / PI_F;
+  size_t n = ms * rateHz / 1000;
+  float rateDps = n ? angleDeg * rateHz / n : 0;
+  for (size_t i = 0; i < n; i++) {
+    float k = (float)(i + 1) / n;
+    float dir[3] = {from[0] + (to[0] - from[0]) * k, from[1] + (to[1] - from[1]) * k,
+                    from[2] + (to[2] - from[2]) * k};
+    normalize(dir);
+    emit(dir[0] + noise(0.04f), dir[1] + noise(0.04f), dir[2] + noise(0.04f), rateDps + noise(3),
+         noise(3), noise(3));
+  }
+  setPosture(to[0], to[1], to[2]);
+}
+
+std::vector<MotionTrace> makeMotionTraces(uint16_t sampleRateHz, int variants) {
+  std::vector<MotionTrace> traces;
+  for (int v = 0; v < variants; v++) {
+    uint32_t seed = 1000u + (uint32_t)v * 7919u;
+
+    // ------------------------------------------------------------ falls
+    {
+      MotionTraceBuilder b(sampleRateHz, seed);
+      b.walk((unsigned long)jitter(6000, v, 1, 0.3f));
+      b.freeFall((unsigned long)jitter(300, v, 2, 0.2f), jitter(0.2f, v, 3, 0.5f), 0.1f, -1.0f, 0.15f);
+      b.impact(80, jitter(4.0f, v, 4, 0.25f));
+      b.still(300, 0.25f);
+      b.still(8000);
+      MotionTrace t = {"forward trip", true, b.impactIndex(), b.samples()};
+      traces.push_back(t);
+    }
+    {
+      MotionTraceBuilder b(sampleRateHz, seed + 1);
+      b.still((unsigned long)jitter(3000, v, 5, 0.3f));
+      b.freeFall((unsigned long)jitter(350, v, 6, 0.2f), 0.1f, -1.0f, 0.1f, 0.2f);
+      b.impact(60, jitter(5.0f, v, 7, 0.2f));
+      b.still(200, 0.3f);
+      b.still(8000);
+      MotionTrace t = {"backward slip", true, b.impactIndex(), b.samples()};
+      traces.push_back(t);
+    }
+    {
+      MotionTraceBuilder b(sampleRateHz, seed + 2);
+      b.walk((unsigned long)jitter(5000, v, 8, 0.3f));
+      b.freeFall((unsigned long)jitter(250, v, 9, 0.2f), 0.3f, 1.0f, 0.1f, 0.1f);
+      b.impact(70, jitter(3.0f, v, 10, 0.2f));
+      b.still(300, 0.2f);
+      b.still(8000);
+      MotionTrace t = {"sideways", true, b.impactIndex(), b.samples()};
+      traces.push_back(t);
+    }
+    {
+      // Fainting: a short, shallow drop and a soft landing
+      MotionTraceBuilder b(sampleRateHz, seed + 3);
+      b.still((unsigned long)jitter(4000, v, 11, 0.3f));
+      b.freeFall((unsigned long)jitter(150, v, 12, 0.2f), 0.5f, 0.2f, -0.95f, 0.1f);
+      b.impact(100, jitter(2.4f, v, 13, 0.1f));
+      b.still(300, 0.15f);
+      b.still(8000);
+      MotionTrace t = {"faint/slump", true, b.impactIndex(), b.samples()};
+      traces.push_back(t);
+    }
+    {
+      // Conscious on the floor: small arm and head movements
+      MotionTraceBuilder b(sampleRateHz, seed + 4);
+      b.walk((unsigned long)jitter(5000, v, 14, 0.3f));
+      b.freeFall((unsigned long)jitter(300, v, 15, 0.2f), 0.2f, 0.0f, -1.0f, 0.2f);
+      b.impact(80, jitter(3.5f, v, 16, 0.2f));
+      b.still(400, 0.25f);
+      for (int i = 0; i < 4; i++) {
+        b.still(1200, 0.05f);
+        b.rotate(300, 0.1f * (i % 2), -1.0f, 0.25f);
+      }
+      b.still(4000);
+      MotionTrace t = {"fall, moving after", true, b.impactIndex(), b.samples()};
+      traces.push_back(t);
+    }
+
+    // ------------------------------------------------------------ daily activities
+    {
+      MotionTraceBuilder b(sampleRateHz, seed + 10);
+      b.walk(30000, jitter(0.35f, v, 20, 0.2f), jitter(1.8f, v, 21, 0.15f));
+      MotionTrace t = {"walking", false, 0, b.samples()};
+      traces.push_back(t);
+    }
+    {
+      MotionTraceBuilder b(sampleRateHz, seed + 11);
+      b.walk(3000);
+      b.run(20000);
+      b.walk(3000);
+      MotionTrace t = {"running", false, 0, b.samples()};
+      traces.push_back(t);
+    }
+    {
+      MotionTraceBuilder b(sampleRateHz, seed + 12);
+      b.walk(20000, jitter(0.6f, v, 22, 0.15f), 2.0f);
+      MotionTrace t = {"stairs down", false, 0, b.samples()};
+      traces.push_back(t);
+    }
+    {
+      MotionTraceBuilder b(sampleRateHz, seed + 13);
+      b.walk(4000);
+      b.rotate(600, 0.42f, 0.0f, 0.9f);
+      b.impact(80, jitter(2.5f, v, 23, 0.2f));
+      b.still(8000);
+      MotionTrace t = {"sit down hard", false, 0, b.samples()};
+      traces.push_back(t);
+    }
+    {
+      MotionTraceBuilder b(sampleRateHz, seed + 14);
+      b.still(2000);
+      b.impact(200, 1.8f);
+      b.freeFall((unsigned long)jitter(350, v, 24, 0.2f), 0.05f, 0.0f, 0.0f, 1.0f);
+      b.impact(60, jitter(4.0f, v, 25, 0.2f));
+      if (v % 2) {
+        b.still(8000);
+      } else {
+        b.still(800);
+        b.walk(6000);
+      }
+      MotionTrace t = {"jump", false, 0, b.samples()};
+      traces.push_back(t);
+    }
+    {
+      MotionTraceBuilder b(sampleRateHz, seed + 15);
+      b.walk(5000);
+      b.freeFall((unsigned long)jitter(120, v, 26, 0.2f), 0.5f, 0.3f, 0.0f, 1.0f);
+      b.impact(60, jitter(2.3f, v, 27, 0.1f));
+      b.setPosture(0.005f, -0.008f, 1.0f);
+      b.walk(6000);
+      MotionTrace t = {"stumble, recover", false, 0, b.samples()};
+      traces.push_back(t);
+    }
+    {
+      MotionTraceBuilder b(sampleRateHz, seed + 16);
+      b.still(3000);
+      b.rotate((unsigned long)jitter(2000, v, 28, 0.3f), 0.0f, -1.0f, 0.1f);
+      b.still(10000);
+      MotionTrace t = {"lie down on bed", false, 0, b.samples()};
+      traces.push_back(t);
+    }
+    {
+      MotionTraceBuilder b(sampleRateHz, seed + 17);
+      b.still(3000);
+      b.impact(30, jitter(6.0f, v, 29, 0.2f));
+      b.still(8000);
+      MotionTrace t = {"bump/knock", false, 0, b.samples()};
+      traces.push_back(t);
+    }
+  }
+  return traces;
+}
@@ -0,0 +1,63 @@
+/*
+ * RescueNet AI - Synthetic labeled IMU traces
+ *
+ * Builds accel + gyro traces (raw counts at the hal.h ranges) for falls
+ * and for everyday activities that look like parts of a fall: running
+ * has a flight phase, jumps and stumbles have free fall and an impact,
+ * lying down ends horizontal. Shared by fall_bench and loop_bench.
+ */
+
+#ifndef HOST_MOTION_TRACES_H
+#define HOST_MOTION_TRACES_H
+
+#include <hal.h>
+
+#include "sim_random.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct MotionTrace {
+  std::string label;
+  bool fall;
+  size_t impactIndex;  // Sample of the impact for falls
+  std::vector<ImuSample> samples;
+};
+
+// Appends motion segments to a trace; the posture (gravity direction)
+// carries over from one segment to the next
+class MotionTraceBuilder {
+public:
+  MotionTraceBuilder(uint16_t sampleRateHz, uint32_t seed);
+
+  void setPosture(float x, float y, float z);
+  void still(unsigned long ms, float noiseG = 0.02f);
+  void walk(unsigned long ms, float swingG = 0.35f, float stepHz = 1.8f);
+  void run(unsigned long ms);
+  // Low-g phase, rotating towards the given posture on the way down
+  void freeFall(unsigned long ms, float levelG, float x, float y, float z);
+  // Half-sine shock of peakG; marks the impact sample
+  void impact(unsigned long ms, float peakG);
+  // Slow turn to the given posture (lying down, sitting back)
+  void rotate(unsigned long ms, float x, float y, float z);
+
+  size_t impactIndex() const { return impactAt; }
+  const std::vector<ImuSample>& samples() const { return out; }
+
+private:
+  void emit(float ax, float ay, float az, float gx, float gy, float gz);
+  float noise(float amplitude);
+
+  uint16_t rateHz;
+  SimRandom random;
+  float posture[3];
+  size_t impactAt;
+  std::vector<ImuSample> out;
+};
+
+// Falls first, then activities of daily living; `variants` of each with
+// jittered parameters. The first trace is a forward fall after walking.
+std::vector<MotionTrace> makeMotionTraces(uint16_t sampleRateHz, int variants);
+
+#endif
@@ -0,0 +1,244 @@
+/*
+ * RescueNet AI - Simulated MQTT broker for the client benchmarks
+ */
+
+#include "mqtt_broker.h"
+
+#include <Arduino.h>
+
+#include <algorithm>
+
+namespace {
+
+uint16_t get16(const std::string& body, size_t at) {
+  return (uint16_t)((uint8_t)body[at] << 8 | (uint8_t)body[at + 1]);
+}
+
+// A length-prefixed string at offset, which moves past it; false when
+// the body is too short
+bool getString(const std::string& body, size_t& offset, std::string& out) {
+  if (offset + 2 > body.size()) return false;
+  size_t length = get16(body, offset);
+  if (offset + 2 + length > body.size()) return false;
+  out = body.substr(offset + 2, length);
+  offset += 2 + length;
+  return true;
+}
+
+std::string put16(uint16_t value) {
+  return std::string(1, (char)(value >> 8)) + (char)(value & 0xFF);
+}
+
+std::string putString(const std::string& text) {
+  return put16((uint16_t)text.size()) + text;
+}
+
+}  // namespace
+
+SimBroker::SimBroker()
+  : roundTripMs(20), down(false), blackhole(false), holdAcks(false), state(CLOSED), openAtMs(0), handshaken(false),
+    attempts(0), accepted(0), willRetain(false), pushId(0), pushAcks(0) {}
+
+bool SimBroker::connect(const char*, uint16_t) {
+  if (state == OPEN) lose();
+  attempts++;
+  attemptMs.push_back(millis());
+  toBroker.clear();
+  toClient.clear();
+  parse.clear();
+  handshaken = false;
+  // A refusal takes as long to come back as an acceptance
+  state = down ? REFUSED : CONNECTING;
+  openAtMs = millis() + roundTripMs;
+  return true;
+}
+
+uint8_t SimBroker::status() {
+  if ((state == CONNECTING || state == REFUSED) && (long)(millis() - openAtMs) >= 0) {
+    state = state == CONNECTING ? OPEN : CLOSED;
+  }
+  advance();
+  return state == OPEN ? TCP_CONNECTED : state == CLOSED ? TCP_CLOSED : TCP_CONNECTING;
+}
+
+int SimBroker::read(uint8_t* out, size_t length) {
+  if (state != OPEN) return 0;
+  advance();
+  size_t n = 0;
+  unsigned long now = millis();
+  while (n < length && !toClient.empty() && (long)(now - toClient.front().atMs) >= 0) {
+    std::string& bytes = toClient.front().bytes;
+    size_t take = std::min(length - n, bytes.size());
+    memcpy(out + n, bytes.data(), take);
+    n += take;
+    if (take == bytes.size()) {
+      toClient.erase(toClient.begin());
+    } else {
+      bytes.erase(0, take);
+    }
+  }
+  return (int)n;
+}
+
+size_t SimBroker::write(const uint8_t* data, size_t length) {
+  if (state != OPEN || length == 0) return 0;
+  toBroker.push_back({millis() + roundTripMs / 2, std::string((const char*)data, length)});
+  return length;
+}
+
+void SimBroker::close() {
+  if (state == OPEN) lose();
+  state = CLOSED;
+  toBroker.clear();
+  toClient.clear();
+}
+
+void SimBroker::dropConnection() {
+  close();
+}
+
+bool SimBroker::push(const char* topic, const char* payload) {
+  if (state != OPEN || !handshaken || subscribed != topic) return false;
+  pushId = pushId == 0xFFFF ? 1 : pushId + 1;
+  reply(packet(0x32, putString(topic) + put16(pushId) + payload), millis() + roundTripMs / 2);
+  return true;
+}
+
+void SimBroker::advance() {
+  unsigned long now = millis();
+  while (state == OPEN && !toBroker.empty() && (long)(now - toBroker.front().atMs) >= 0) {
+    unsigned long atMs = toBroker.front().atMs;
+    parse += toBroker.front().bytes;
+    toBroker.erase(toBroker.begin());
+
+    while (state == OPEN) {
+      // Type, length of 1 to 4 bytes, body
+      size_t remaining = 0;
+      size_t at = 1;
+      int shift = 0;
+      bool whole = false;
+      while (at < parse.size() && at <= 4) {
+        uint8_t byte = (uint8_t)parse[at++];
+        remaining |= (size_t)(byte & 0x7F) << shift;
+        shift += 7;
+        if (!(byte & 0x80)) {
+          whole = true;
+          break;
+        }
+      }
+      if (!whole || parse.size() < at + remaining) break;
+      uint8_t type = (uint8_t)parse[0];
+      std::string body = parse.substr(at, remaining);
+      parse.erase(0, at + remaining);
+      handle(type, body, atMs);
+    }
+  }
+}
+
+void SimBroker::handle(uint8_t type, const std::string& body, unsigned long atMs) {
+  unsigned long replyAtMs = atMs + roundTripMs / 2;
+  if (!handshaken && (type & 0xF0) != 0x10) {
+    problems.push_back("packet before CONNECT");
+    return;
+  }
+
+  switch (type & 0xF0) {
+    case 0x10: {
+      size_t offset = 0;
+      std::string protocol, clientId;
+      if (!getString(body, offset, protocol) || protocol != "MQTT" || offset + 4 > body.size() ||
+          body[offset] != 4) {
+        problems.push_back("CONNECT is not MQTT 3.1.1");
+        return;
+      }
+      uint8_t flags = (uint8_t)body[offset + 1];
+      offset += 4;
+      if (flags & 0x02) problems.push_back("clean session requested");
+      if (!getString(body, offset, clientId) || clientId.empty()) problems.push_back("no client id");
+      willTopic.clear();
+      if (flags & 0x04) {
+        getString(body, offset, willTopic);
+        getString(body, offset, willMessage);
+        willRetain = (flags & 0x20) != 0;
+      }
+      if (blackhole) return;
+      handshaken = true;
+      accepted++;
+      // Session present from the second on: the subscription is kept
+      reply(packet(0x20, std::string(1, (char)(accepted > 1 ? 1 : 0)) + '\0'), replyAtMs);
+      return;
+    }
+    case 0x30: {
+      uint8_t qos = (type >> 1) & 0x03;
+      size_t offset = 0;
+      BrokerMessage message;
+      if (!getString(body, offset, message.topic) || offset + (qos ? 2 : 0) > body.size()) {
+        problems.push_back("short PUBLISH");
+        return;
+      }
+      message.qos = qos;
+      message.dup = (type & 0x08) != 0;
+      message.retain = (type & 0x01) != 0;
+      message.id = qos ? get16(body, offset) : 0;
+      if (qos) offset += 2;
+      if (qos > 1) problems.push_back("QoS 2 PUBLISH");
+      if (qos && message.id == 0) problems.push_back("packet id 0");
+      message.payload = body.substr(offset);
+      message.atMs = atMs;
+      if (message.retain) retained = message.payload;
+      received.push_back(message);
+      if (qos && !holdAcks) reply(packet(0x40, put16(message.id)), replyAtMs);
+      return;
+    }
+    case 0x40:
+      pushAcks++;
+      return;
+    case 0x80: {
+      size_t offset = 2;
+      std::string topic;
+      if (type != 0x82 || !getString(body, offset, topic) || offset >= body.size()) {
+        problems.push_back("bad SUBSCRIBE");
+        return;
+      }
+      subscribed = topic;
+      reply(packet(0x90, body.substr(0, 2) + '\x01'), replyAtMs);
+      return;
+    }
+    case 0xC0:
+      reply(packet(0xD0, ""), replyAtMs);
+      return;
+    case 0xE0:
+      // A clean goodbye: no will
+      willTopic.clear();
+      close();
+      return;
+    default:
+      problems.push_back("unexpected packet type");
+      return;
+  }
+}
+
+void SimBroker::reply(const std::string& bytes, unsigned long atMs) {
+  toClient.push_back({atMs, bytes});
+}
+
+void SimBroker::lose() {
+  if (handshaken && !willTopic.empty()) {
+    BrokerMessage will = {willTopic, willMessage, 1, false, willRetain, 0, millis()};
+    if (willRetain) retained = willMessage;
+    received.push_back(will);
+  }
+  handshaken = false;
+  state = CLOSED;
+}
+
+std::string SimBroker::packet(uint8_t type, const std::string& body) {
+  std::string bytes(1, (char)type);
+  size_t remaining = body.size();
+  do {
+    uint8_t byte = remaining & 0x7F;
+    remaining >>= 7;
+    bytes += (char)(remaining ? byte | 0x80 : byte);
+  } while (remaining);
+  return bytes + body;
+}
@@ -0,0 +1,108 @@
+/*
+ * RescueNet AI - Simulated MQTT broker for the client benchmarks
+ *
+ * A TcpClientPort with an MQTT 3.1.1 broker at the other end, in virtual
+ * time: what the client writes reaches the broker half a round trip
+ * later and the answers come back after the other half. The broker
+ * keeps what a real one would for a persistent session (the
+ * subscription, the retained status and the will) and records every
+ * PUBLISH it gets, duplicates included, so a run can check delivery.
+ * Faults are switches: refuse connections, accept TCP but never answer
+ * CONNECT, drop the connection, or hold PUBACKs back. Anything that
+ * breaks the protocol lands in errors().
+ */
+
+#ifndef HOST_MQTT_BROKER_H
+#define HOST_MQTT_BROKER_H
+
+#include <hal.h>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct BrokerMessage {
+  std::string topic;
+  std::string payload;
+  uint8_t qos;
+  bool dup;
+  bool retain;
+  uint16_t id;
+  unsigned long atMs;  // When the broker had it
+};
+
+class SimBroker : public TcpClientPort {
+public:
+  SimBroker();
+
+  bool connect(const char* host, uint16_t port) override;
+  uint8_t status() override;
+  int read(uint8_t* out, size_t length) override;
+  size_t write(const uint8_t* data, size_t length) override;
+  void close() override;
+
+  void setRoundTrip(unsigned long ms) { roundTripMs = ms; }
+  // Connections are refused while down
+  void setDown(bool value) { down = value; }
+  // TCP connects but CONNECT goes unanswered
+  void setBlackhole(bool value) { blackhole = value; }
+  // PUBLISH is taken but not acknowledged
+  void setHoldAcks(bool value) { holdAcks = value; }
+  // The network drops the connection; the will is published
+  void dropConnection();
+  // A QoS 1 message to the client, when it is subscribed to topic
+  bool push(const char* topic, const char* payload);
+
+  bool sessionOpen() const { return state == OPEN; }
+  unsigned long connectAttempts() const { return attempts; }
+  unsigned long sessions() const { return accepted; }
+  // Times of the connection attempts, for the backoff
+  const std::vector<unsigned long>& attemptTimes() const { return attemptMs; }
+  const std::vector<BrokerMessage>& messages() const { return received; }
+  void clearMessages() { received.clear(); }
+  const std::string& subscription() const { return subscribed; }
+  const std::string& retainedStatus() const { return retained; }
+  uint32_t pushesAcked() const { return pushAcks; }
+  const std::vector<std::string>& errors() const { return problems; }
+
+private:
+  enum ConnectionState { CLOSED, CONNECTING, REFUSED, OPEN };
+  struct InFlight {
+    unsigned long atMs;
+    std::string bytes;
+  };
+
+  void advance();
+  void handle(uint8_t type, const std::string& body, unsigned long atMs);
+  void reply(const std::string& bytes, unsigned long atMs);
+  void lose();
+  static std::string packet(uint8_t type, const std::string& body);
+
+  unsigned long roundTripMs;
+  bool down;
+  bool blackhole;
+  bool holdAcks;
+
+  uint8_t state;
+  unsigned long openAtMs;
+  bool handshaken;
+  unsigned long attempts;
+  unsigned long accepted;
+  std::vector<unsigned long> attemptMs;
+
+  std::vector<InFlight> toBroker;
+  std::vector<InFlight> toClient;
+  std::string parse;  // Bytes the broker has, not yet whole packets
+
+  std::string subscribed;
+  std::string willTopic;
+  std::string willMessage;
+  bool willRetain;
+  std::string retained;
+  uint16_t pushId;
+  uint32_t pushAcks;
+  std::vector<BrokerMessage> received;
+  std::vector<std::string> problems;
+};
+
+#endif
@@ -0,0 +1,197 @@
+/*
+ * RescueNet AI - TcpServerPort on host sockets
+ */
+
+#include "posix_tcp.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+void setNonBlocking(int socket) {
+  fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+}
+
+void setNoDelay(int socket) {
+  int one = 1;
+  setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+sockaddr_in loopback(uint16_t port) {
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  return address;
+}
+
+}  // namespace
+
+PosixTcpServer::PosixTcpServer(uint8_t maxConnections)
+  : listener(-1), listenPort(0), sendBuffer(0), sockets(maxConnections, -1), copied(0), referenced(0) {}
+
+PosixTcpServer::~PosixTcpServer() {
+  end();
+}
+
+bool PosixTcpServer::begin() {
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (listener < 0) return false;
+  int one = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in address = loopback(0);
+  socklen_t length = sizeof(address);
+  if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0 ||
+      getsockname(listener, (sockaddr*)&address, &length) != 0) {
+    end();
+    return false;
+  }
+  listenPort = ntohs(address.sin_port);
+  setNonBlocking(listener);
+  return true;
+}
+
+void PosixTcpServer::end() {
+  for (size_t i = 0; i < sockets.size(); i++) close((uint8_t)i);
+  if (listener >= 0) ::close(listener);
+  listener = -1;
+}
+
+int PosixTcpServer::accept() {
+  if (listener < 0) return -1;
+  int socket = ::accept(listener, nullptr, nullptr);
+  if (socket < 0) return -1;
+  for (size_t i = 0; i < sockets.size(); i++) {
+    if (sockets[i] < 0) {
+      setNonBlocking(socket);
+      setNoDelay(socket);
+      if (sendBuffer) setsockopt(socket, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+      sockets[i] = socket;
+      return (int)i;
+    }
+  }
+  ::close(socket);
+  return -1;
+}
+
+int PosixTcpServer::read(uint8_t connection, uint8_t* out, size_t length) {
+  if (connection >= sockets.size() || sockets[connection] < 0) return -1;
+  uint8_t peek;
+  ssize_t n = length ? recv(sockets[connection], out, length, MSG_DONTWAIT)
+                     : recv(sockets[connection], &peek, 1, MSG_DONTWAIT | MSG_PEEK);
+  if (n > 0) return length ? (int)n : 0;
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+  return -1;
+}
+
+size_t PosixTcpServer::write(uint8_t connection, const uint8_t* data, size_t length, bool stable) {
+  if (connection >= sockets.size() || sockets[connection] < 0 || length == 0) return 0;
+  ssize_t n = send(sockets[connection], data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (n <= 0) return 0;
+  if (stable) {
+    referenced += (uint64_t)n;
+  } else {
+    copied += (uint64_t)n;
+  }
+  return (size_t)n;
+}
+
+void PosixTcpServer::close(uint8_t connection) {
+  if (connection >= sockets.size() || sockets[connection] < 0) return;
+  ::close(sockets[connection]);
+  sockets[connection] = -1;
+}
+
+bool PosixTcpClient::connect(const char* host, uint16_t port) {
+  close();
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* found = nullptr;
+  if (getaddrinfo(host, nullptr, &hints, &found) != 0 || !found) return false;
+  sockaddr_in address = *(sockaddr_in*)found->ai_addr;
+  freeaddrinfo(found);
+  address.sin_port = htons(port);
+
+  socketFd = socket(AF_INET, SOCK_STREAM, 0);
+  if (socketFd < 0) return false;
+  setNonBlocking(socketFd);
+  setNoDelay(socketFd);
+  if (::connect(socketFd, (sockaddr*)&address, sizeof(address)) == 0) {
+    connected = true;
+  } else if (errno != EINPROGRESS) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+uint8_t PosixTcpClient::status() {
+  if (socketFd < 0) return TCP_CLOSED;
+  if (connected) return TCP_CONNECTED;
+  pollfd pending = {socketFd, POLLOUT, 0};
+  if (::poll(&pending, 1, 0) <= 0) return TCP_CONNECTING;
+  int error = 0;
+  socklen_t length = sizeof(error);
+  getsockopt(socketFd, SOL_SOCKET, SO_ERROR, &error, &length);
+  if (error) {
+    close();
+    return TCP_CLOSED;
+  }
+  connected = true;
+  return TCP_CONNECTED;
+}
+
+int PosixTcpClient::read(uint8_t* out, size_t length) {
+  if (!connected) return 0;
+  ssize_t n = recv(socketFd, out, length, MSG_DONTWAIT);
+  if (n > 0) return (int)n;
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+  close();
+  return 0;
+}
+
+size_t PosixTcpClient::write(const uint8_t* data, size_t length) {
+  if (!connected || length == 0) return 0;
+  ssize_t n = send(socketFd, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (n > 0) return (size_t)n;
+  if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) close();
+  return 0;
+}
+
+void PosixTcpClient::close() {
+  if (socketFd >= 0) ::close(socketFd);
+  socketFd = -1;
+  connected = false;
+}
+
+int tcpConnect(uint16_t port, int receiveBuffer) {
+  int s = socket(AF_INET, SOCK_STREAM, 0);
+  if (s < 0) return -1;
+  if (receiveBuffer) setsockopt(s, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+  sockaddr_in address = loopback(port);
+  if (connect(s, (sockaddr*)&address, sizeof(address)) != 0) {
+    ::close(s);
+    return -1;
+  }
+  setNoDelay(s);
+  return s;
+}
+
+bool tcpSendAll(int socket, const char* data, size_t length) {
+  while (length) {
+    ssize_t n = send(socket, data, length, MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    data += n;
+    length -= (size_t)n;
+  }
+  return true;
+}
@@ -0,0 +1,75 @@
+/*
+ * RescueNet AI - TcpServerPort on host sockets
+ *
+ * Listens on 127.0.0.1 at a port the kernel picks, with every socket
+ * non-blocking, so http_server.h can be driven by real HTTP clients in
+ * the benchmarks. Like AsyncTCP, write() takes what the send buffer has
+ * room for and no more; the bytes it would have had to copy (data not
+ * marked stable) are counted so a run shows what the flash assets save.
+ *
+ * PosixTcpClient is the outgoing side, for mqtt_client.h against a real
+ * broker: the connect is non-blocking too, status() finishing it.
+ */
+
+#ifndef HOST_POSIX_TCP_H
+#define HOST_POSIX_TCP_H
+
+#include <hal.h>
+
+#include <stdint.h>
+#include <vector>
+
+class PosixTcpServer : public TcpServerPort {
+public:
+  explicit PosixTcpServer(uint8_t maxConnections = 16);
+  ~PosixTcpServer();
+
+  bool begin();
+  void end();
+  uint16_t port() const { return listenPort; }
+  // Kernel send buffer of accepted sockets, 0 for the default; small
+  // values make a client that stops reading back up quickly
+  void setSendBuffer(int bytes) { sendBuffer = bytes; }
+
+  int accept() override;
+  int read(uint8_t connection, uint8_t* out, size_t length) override;
+  size_t write(uint8_t connection, const uint8_t* data, size_t length, bool stable) override;
+  void close(uint8_t connection) override;
+
+  uint64_t bytesCopied() const { return copied; }
+  uint64_t bytesReferenced() const { return referenced; }
+
+private:
+  int listener;
+  uint16_t listenPort;
+  int sendBuffer;
+  std::vector<int> sockets;  // -1 when the slot is free
+  uint64_t copied;
+  uint64_t referenced;
+};
+
+class PosixTcpClient : public TcpClientPort {
+public:
+  PosixTcpClient() : socketFd(-1), connected(false) {}
+  ~PosixTcpClient() { close(); }
+
+  // host is a numeric address or a name; the lookup itself blocks
+  bool connect(const char* host, uint16_t port) override;
+  uint8_t status() override;
+  int read(uint8_t* out, size_t length) override;
+  size_t write(const uint8_t* data, size_t length) override;
+  void close() override;
+
+private:
+  int socketFd;
+  bool connected;
+};
+
+// Blocking client helpers for the benchmarks
+
+// Connected socket to 127.0.0.1:port, or -1; receiveBuffer 0 keeps the
+// kernel default
+int tcpConnect(uint16_t port, int receiveBuffer = 0);
+bool tcpSendAll(int socket, const char* data, size_t length);
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * RescueNet AI - Scripted modem for AT engine tests
+ */
+
+#include "scripted_modem.h"
+
+#include <Arduino.h>
+
+#include <algorithm>
+
+ScriptedModem::ScriptedModem() {
+  pending.reserve(64);
+  rx.reserve(1024);
+  lineBuffer.reserve(128);
+}
+
+void ScriptedModem::expect(const char* command, const char* reply, unsigned long delayMs) {
+  Step step = {false, command, reply, delayMs};
+  steps.push_back(step);
+}
+
+void ScriptedModem::expectBody(const char* body, const char* reply, unsigned long delayMs) {
+  Step step = {true, body, reply, delayMs};
+  steps.push_back(step);
+}
+
+void ScriptedModem::inject(const char* bytes, unsigned long atMs) {
+  Pending p = {atMs, bytes};
+  pending.push_back(p);
+}
+
+void ScriptedModem::setChunking(size_t bytes, unsigned long gapMs) {
+  chunkBytes = bytes;
+  chunkGapMs = gapMs;
+}
+
+void ScriptedModem::rewind() {
+  next = 0;
+  pending.clear();
+  rx.clear();
+  rxPos = 0;
+  lineBuffer.clear();
+  inBody = false;
+  problems.clear();
+}
+
+void ScriptedModem::queue(const std::string& bytes, unsigned long atMs) {
+  if (chunkBytes == 0) {
+    Pending p = {atMs, bytes};
+    pending.push_back(p);
+    return;
+  }
+  for (size_t at = 0, i = 0; at < bytes.size(); at += chunkBytes, i++) {
+    Pending p = {atMs + i * chunkGapMs, bytes.substr(at, chunkBytes)};
+    pending.push_back(p);
+  }
+}
+
+int ScriptedModem::available() {
+  // Release every queued reply whose time has come, in time order
+  unsigned long now = millis();
+  std::stable_sort(pending.begin(), pending.end(),
+                   [](const Pending& a, const Pending& b) { return a.atMs < b.atMs; });
+  size_t due = 0;
+  while (due < pending.size() && pending[due].atMs <= now) rx += pending[due++].bytes;
+  pending.erase(pending.begin(), pending.begin() + due);
+  return (int)(rx.size() - rxPos);
+}
+
+int ScriptedModem::read() {
+  if (available() == 0) return -1;
+  int c = (uint8_t)rx[rxPos++];
+  delivered++;
+  if (rxPos == rx.size()) {
+    rx.clear();
+    rxPos = 0;
+  }
+  return c;
+}
+
+size_t ScriptedModem::write(const uint8_t* data, size_t length) {
+  written += length;
+  for (size_t i = 0; i < length; i++) {
+    char c = (char)data[i];
+    if (inBody) {
+      if (c == 26) {
+        inBody = false;
+        received(lineBuffer, true);
+        lineBuffer.clear();
+      } else if (c == 27) {
+        inBody = false;  // ESC aborts
+        lineBuffer.clear();
+      } else if (c == '\n' && lineBuffer.empty()) {
+        continue;  // Rest of the command's CR LF
+      } else {
+        lineBuffer += c;
+      }
+      continue;
+    }
+    if (c == '\r' || c == '\n') {
+      if (!lineBuffer.empty()) received(lineBuffer, false);
+      lineBuffer.clear();
+    } else {
+      lineBuffer += c;
+    }
+  }
+  return length;
+}
+
+void ScriptedModem::received(const std::string& text, bool body) {
+  unsigned long now = millis();
+  if (echo && !body) queue(text + "\r\n", now);
+
+  if (next < steps.size() && steps[next].body == body && steps[next].expected == text) {
+    const Step& step = steps[next++];
+    if (!step.reply.empty()) queue(step.reply, now + step.delayMs);
+    // A command followed by a body step is answered with a prompt
+    if (!body && next < steps.size() && steps[next].body) inBody = true;
+    return;
+  }
+  problems.push_back(std::string(body ? "unexpected body: " : "unexpected command: ") + text);
+  queue("\r\nERROR\r\n", now);
+}
@@ -0,0 +1,79 @@
+/*
+ * RescueNet AI - Scripted modem for AT engine tests
+ *
+ * A SerialPort that plays a fixed conversation: each step names the
+ * command line it expects and the bytes it answers with after a delay in
+ * virtual time. Body steps take the text written after a '>' prompt, up
+ * to Ctrl+Z. Unsolicited bytes can be injected at any time, and replies
+ * can be split into chunks that arrive apart, to exercise the line
+ * parser. Anything off script is recorded in errors() and answered with
+ * ERROR.
+ */
+
+#ifndef HOST_SCRIPTED_MODEM_H
+#define HOST_SCRIPTED_MODEM_H
+
+#include <hal.h>
+
+#include <string>
+#include <vector>
+
+class ScriptedModem : public SerialPort {
+public:
+  ScriptedModem();
+
+  int available() override;
+  int read() override;
+  size_t write(const uint8_t* data, size_t length) override;
+  using SerialPort::write;
+
+  // Answer command with reply delayMs after it is written; an empty reply
+  // leaves the command unanswered
+  void expect(const char* command, const char* reply, unsigned long delayMs = 20);
+  // Text written after the prompt, up to Ctrl+Z
+  void expectBody(const char* body, const char* reply, unsigned long delayMs = 20);
+  // Bytes that arrive at atMs whatever is written
+  void inject(const char* bytes, unsigned long atMs);
+  // Deliver replies in pieces of this many bytes, gapMs apart (0: whole)
+  void setChunking(size_t bytes, unsigned long gapMs);
+  // Echo command lines back like a modem with ATE1
+  void setEcho(bool value) { echo = value; }
+
+  bool finished() const { return next == steps.size(); }
+  const std::vector<std::string>& errors() const { return problems; }
+  unsigned long bytesWritten() const { return written; }
+  unsigned long bytesRead() const { return delivered; }
+  // Steps are kept, so the script can be played again
+  void rewind();
+
+private:
+  struct Step {
+    bool body;
+    std::string expected;
+    std::string reply;
+    unsigned long delayMs;
+  };
+  struct Pending {
+    unsigned long atMs;
+    std::string bytes;
+  };
+
+  void received(const std::string& text, bool body);
+  void queue(const std::string& bytes, unsigned long atMs);
+
+  std::vector<Step> steps;
+  size_t next = 0;
+  std::vector<Pending> pending;
+  std::string rx;
+  size_t rxPos = 0;
+  std::string lineBuffer;
+  bool inBody = false;
+  bool echo = false;
+  size_t chunkBytes = 0;
+  unsigned long chunkGapMs = 0;
+  unsigned long written = 0;
+  unsigned long delivered = 0;
+  std::vector<std::string> problems;
+};
+
+#endif
@@ -0,0 +1,701 @@
+/*
+ * RescueNet AI - Simulated HAL back-ends for the host build
+ */
+
+#include "sim_hal.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <utility>
+
+namespace {
+
+const float TWO_PI_F = 6.28318530718f;
+
+}  // namespace
+
+// ---------------------------------------------------------------- PPG
+
+float SimPpgSensor::pulseShape(unsigned long long timeUs) const {
+  // Systolic peak plus a smaller dicrotic wave, one cycle per beat
+  double period = 60.0e6 / heartRateBpm;
+  float phase = (float)fmod((double)timeUs, period) / (float)period;
+  float systolic = expf(-((phase - 0.15f) * (phase - 0.15f)) / 0.004f);
+  float dicrotic = 0.35f * expf(-((phase - 0.45f) * (phase - 0.45f)) / 0.006f);
+  return systolic + dicrotic;
+}
+
+float SimPpgSensor::artifactAt(unsigned long long timeUs) const {
+  if (!imu || couplingPerG == 0) return 0;
+  const unsigned long long LAG_US = 30000;
+  ImuSample s = imu->sampleAt(timeUs > LAG_US ? timeUs - LAG_US : 0);
+  float ax = (float)s.ax / IMU_ACCEL_LSB_PER_G;
+  float ay = (float)s.ay / IMU_ACCEL_LSB_PER_G;
+  float az = (float)s.az / IMU_ACCEL_LSB_PER_G;
+  float magnitude = sqrtf(ax * ax + ay * ay + az * az) - 1.0f;
+  return couplingPerG * (magnitude + 0.3f * ax);
+}
+
+uint32_t SimPpgSensor::irAt(unsigned long long timeUs) const {
+  if (!fingerPresent) return 1200;
+  // Slow respiratory baseline wander on top of the DC level
+  float wander = 300.0f * sinf(TWO_PI_F * (float)(timeUs % 4000000ULL) / 4.0e6f);
+  return (uint32_t)(80000.0f + wander + 1200.0f * perfusion * pulseShape(timeUs) + artifactAt(timeUs));
+}
+
+uint32_t SimPpgSensor::redAt(unsigned long long timeUs) const {
+  if (!fingerPresent) return 900;
+  // Empirical calibration SpO2 = 110 - 25 R, R = (ACred/DCred)/(ACir/DCir)
+  float ratio = (110.0f - spO2Percent) / 25.0f;
+  float dcRed = 68000.0f;
+  float acRed = ratio * (1200.0f / 80000.0f) * dcRed;
+  float wander = 250.0f * sinf(TWO_PI_F * (float)(timeUs % 4000000ULL) / 4.0e6f);
+  float artifact = artifactAt(timeUs) * dcRed / 80000.0f;
+  return (uint32_t)(dcRed + wander + acRed * perfusion * pulseShape(timeUs) + artifact);
+}
+
+bool SimPpgSensor::configure(uint16_t sampleRateHz, uint8_t averaging) {
+  if (sampleRateHz == 0 || averaging == 0) return false;
+  periodUs = 1000000UL * averaging / sampleRateHz;
+  nextSampleUs = micros() + periodUs;
+  return true;
+}
+
+uint8_t SimPpgSensor::readFifo(PpgSample* out, uint8_t maxSamples, uint8_t& overflowed) {
+  overflowed = 0;
+  if (periodUs == 0) return 0;
+
+  const unsigned long long FIFO_DEPTH = 32;
+  unsigned long long now = micros();
+  unsigned long long queued = now >= nextSampleUs ? (now - nextSampleUs) / periodUs + 1 : 0;
+  if (queued > FIFO_DEPTH) {
+    // Rollover mode: the oldest samples are overwritten; OVF_COUNTER saturates at 31
+    unsigned long long lost = queued - FIFO_DEPTH;
+    overflowed = lost > 31 ? 31 : (uint8_t)lost;
+    nextSampleUs += lost * periodUs;
+    generated += lost;
+    queued = FIFO_DEPTH;
+  }
+
+  uint8_t n = queued < maxSamples ? (uint8_t)queued : maxSamples;
+  for (uint8_t i = 0; i < n; i++) {
+    out[i].red = redAt(nextSampleUs);
+    out[i].ir = irAt(nextSampleUs);
+    nextSampleUs += periodUs;
+  }
+  generated += n;
+  return n;
+}
+
+// ---------------------------------------------------------------- IMU
+
+SimImuSensor::SimImuSensor() {
+  // Upright, a slight tilt and 1 g at +-8 g full scale
+  rest.ax = 21;
+  rest.ay = -33;
+  rest.az = IMU_ACCEL_LSB_PER_G;
+  rest.gx = rest.gy = rest.gz = 0;
+}
+
+bool SimImuSensor::configure(uint16_t sampleRateHz) {
+  if (sampleRateHz == 0) return false;
+  periodUs = 1000000UL / sampleRateHz;
+  nextSampleUs = micros() + periodUs;
+  return true;
+}
+
+void SimImuSensor::play(const std::vector<ImuSample>& samples, unsigned long startMs) {
+  trace = samples;
+  traceStartUs = (unsigned long long)startMs * 1000ULL;
+}
+
+ImuSample SimImuSensor::sampleAt(unsigned long long timeUs) const {
+  if (trace.empty() || timeUs < traceStartUs || periodUs == 0) return rest;
+  unsigned long long index = (timeUs - traceStartUs) / periodUs;
+  return index < trace.size() ? trace[index] : trace.back();
+}
+
+uint8_t SimImuSensor::readFifo(ImuSample* out, uint8_t maxSamples, bool& overflowed) {
+  overflowed = false;
+  if (periodUs == 0) return 0;
+
+  // 1024-byte FIFO / 12 bytes per accel + gyro sample
+  const unsigned long long FIFO_DEPTH = 85;
+  unsigned long long now = micros();
+  unsigned long long queued = now >= nextSampleUs ? (now - nextSampleUs) / periodUs + 1 : 0;
+  if (queued > FIFO_DEPTH) {
+    // The driver resets a FIFO that overflowed; everything queued is gone
+    overflowed = true;
+    nextSampleUs += queued * periodUs;
+    generated += queued;
+    lost += queued;
+    return 0;
+  }
+
+  uint8_t n = queued < maxSamples ? (uint8_t)queued : maxSamples;
+  for (uint8_t i = 0; i < n; i++) {
+    out[i] = sampleAt(nextSampleUs);
+    nextSampleUs += periodUs;
+  }
+  generated += n;
+  return n;
+}
+
+// ---------------------------------------------------------------- DS18B20
+
+namespace {
+
+const unsigned long ONEWIRE_RESET_US = 960;
+const unsigned long ONEWIRE_BYTE_US = 560;  // Eight 70 us slots
+const int16_t POWER_ON_RAW = 85 * 16;
+
+}  // namespace
+
+SimTempSensor::SimTempSensor() : probeCount(1) {
+  for (uint8_t i = 0; i < SIM_TEMP_PROBES; i++) {
+    Probe& probe = probes[i];
+    // Family 0x28, a serial, and a CRC byte nothing here checks
+    uint8_t rom[8] = {0x28, (uint8_t)(0x10 + i), 0x4F, 0x23, 0x07, 0x00, 0x00, (uint8_t)(0xA0 + i)};
+    memcpy(probe.rom.bytes, rom, sizeof(rom));
+    probe.celsius = i == 0 ? 36.6f : 22.0f;
+    probe.bits = 12;
+    probe.present = true;
+    probe.converting = false;
+    probe.startedUs = 0;
+    probe.scratchpad = POWER_ON_RAW;
+  }
+}
+
+void SimTempSensor::setProbeCount(uint8_t count) {
+  probeCount = count < SIM_TEMP_PROBES ? count : SIM_TEMP_PROBES;
+}
+
+void SimTempSensor::powerGlitch(uint8_t probe) {
+  probes[probe].scratchpad = POWER_ON_RAW;
+  probes[probe].converting = false;
+}
+
+void SimTempSensor::transaction(unsigned long bytes) {
+  unsigned long us = ONEWIRE_RESET_US + bytes * ONEWIRE_BYTE_US;
+  busTimeUs += us;
+  // Whole milliseconds on the clock: the monitor sleeps in them, and a
+  // bus that left it mid-millisecond would cost a fraction of one on
+  // every later wake-up, not just this once
+  delay((us + 999) / 1000);
+}
+
+int8_t SimTempSensor::find(const TempProbeRom& rom) const {
+  for (uint8_t i = 0; i < probeCount; i++) {
+    if (probes[i].present && memcmp(probes[i].rom.bytes, rom.bytes, sizeof(rom.bytes)) == 0) return (int8_t)i;
+  }
+  return -1;
+}
+
+uint8_t SimTempSensor::search(TempProbeRom* roms, uint8_t max) {
+  searchCount++;
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < probeCount && n < max; i++) {
+    if (!probes[i].present) continue;
+    // 64 bits of two reads and a write each
+    transaction(24);
+    roms[n++] = probes[i].rom;
+  }
+  // The pass that finds no more
+  transaction(0);
+  return n;
+}
+
+bool SimTempSensor::setResolution(const TempProbeRom& rom, uint8_t bits) {
+  // Match ROM, Write Scratchpad with TH, TL and the configuration
+  transaction(13);
+  int8_t i = find(rom);
+  if (i < 0 || bits < 9 || bits > 12) return false;
+  probes[i].bits = bits;
+  return true;
+}
+
+bool SimTempSensor::startConversion() {
+  conversionCount++;
+  transaction(2);
+  for (uint8_t i = 0; i < probeCount; i++) {
+    if (!probes[i].present) continue;
+    probes[i].converting = true;
+    probes[i].startedUs = micros();
+  }
+  return true;
+}
+
+bool SimTempSensor::readRaw(const TempProbeRom& rom, int16_t& sixteenths) {
+  readCount++;
+  // Match ROM, Read Scratchpad, nine bytes back
+  transaction(19);
+  int8_t i = find(rom);
+  if (i < 0) return false;
+  Probe& probe = probes[i];
+  if (probe.converting && micros() - probe.startedUs >= (750000UL >> (12 - probe.bits))) {
+    // Three uniform draws make a near-normal one of unit variance
+    float noise = noiseC * ((random(-1000, 1001) + random(-1000, 1001) + random(-1000, 1001)) / 1000.0f);
+    int16_t raw = (int16_t)lroundf((probe.celsius + noise) * 16.0f);
+    // Undefined low bits below 12 bits: the probe leaves them set
+    probe.scratchpad = raw | (int16_t)((1 << (12 - probe.bits)) - 1);
+    probe.converting = false;
+  }
+  if (corrupt) {
+    corrupt--;
+    return false;
+  }
+  sixteenths = probe.scratchpad;
+  return true;
+}
+
+// ---------------------------------------------------------------- SIM800L
+
+SimModem::SimModem() {
+  pending.reserve(64);
+  rx.reserve(4096);
+  lineBuffer.reserve(512);
+  smsNumber.reserve(32);
+  smsBody.reserve(512);
+  sent.reserve(64);
+}
+
+void SimModem::queue(const std::string& text, unsigned long atMs) {
+  Pending p = {atMs, text};
+  pending.push_back(p);
+}
+
+void SimModem::injectUrc(const char* line, unsigned long atMs) {
+  queue(std::string("\r\n") + line + "\r\n", atMs);
+}
+
+int SimModem::available() {
+  // Release every queued reply whose time has come, in order
+  unsigned long now = millis();
+  size_t kept = 0;
+  for (size_t i = 0; i < pending.size(); i++) {
+    if (pending[i].atMs <= now) {
+      rx += pending[i].bytes;
+    } else {
+      pending[kept++] = pending[i];
+    }
+  }
+  pending.resize(kept);
+  return (int)rx.size();
+}
+
+int SimModem::read() {
+  if (available() == 0) return -1;
+  int c = (uint8_t)rx[0];
+  rx.erase(0, 1);
+  return c;
+}
+
+size_t SimModem::write(const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    char c = (char)data[i];
+    if (inSmsBody) {
+      if (c == 26) {
+        // Ctrl+Z submits the message
+        inSmsBody = false;
+        unsigned long delivered = millis() + smsLatencyMs;
+        SentSms sms = {smsNumber, smsBody, millis(), delivered};
+        sent.push_back(sms);
+        char reply[32];
+        snprintf(reply, sizeof(reply), "\r\n+CMGS: %d\r\n\r\nOK\r\n", ++messageRef);
+        queue(reply, delivered);
+      } else if (c == 27) {
+        inSmsBody = false;  // ESC aborts
+      } else {
+        smsBody += c;
+      }
+      continue;
+    }
+    if (c == '\r' || c == '\n') {
+      if (!lineBuffer.empty()) handleLine(lineBuffer);
+      lineBuffer.clear();
+    } else {
+      lineBuffer += c;
+    }
+  }
+  return length;
+}
+
+void SimModem::handleLine(const std::string& line) {
+  commands++;
+  if (!responsive) return;
+
+  unsigned long at = millis() + latencyMs;
+  if (line.compare(0, 8, "AT+CMGS=") == 0) {
+    size_t open = line.find('"');
+    size_t close = line.find('"', open + 1);
+    smsNumber = (open != std::string::npos && close != std::string::npos)
+                  ? line.substr(open + 1, close - open - 1) : "";
+    smsBody.clear();
+    inSmsBody = true;
+    queue("\r\n> ", at);
+  } else if (line == "AT+CSQ") {
+    queue("\r\n+CSQ: 18,0\r\n\r\nOK\r\n", at);
+  } else if (line == "AT+CREG?") {
+    queue("\r\n+CREG: 0,1\r\n\r\nOK\r\n", at);
+  } else if (line.compare(0, 2, "AT") == 0) {
+    queue("\r\nOK\r\n", at);
+  } else {
+    queue("\r\nERROR\r\n", at);
+  }
+}
+
+// ---------------------------------------------------------------- HTTP
+
+int SimHttp::post(const char* url, const char* contentType, const char* body, size_t length) {
+  Request request;
+  if (recordBodies) {
+    request.url = url;
+    request.contentType = contentType;
+    request.body.assign(body, length);
+  }
+  request.length = length;
+  request.startedMs = millis();
+  // HTTPClient blocks for the whole exchange
+  delay(latencyMs);
+  request.completedMs = millis();
+  bytes += length;
+  log.push_back(std::move(request));
+  return failing ? -1 : 200;
+}
+
+// ---------------------------------------------------------------- ESP8266
+
+SimEsp8266::SimEsp8266() {
+  for (int i = 0; i < SLOTS; i++) {
+    pending[i].used = false;
+    pending[i].bytes.reserve(256);
+  }
+  rx.reserve(4096);
+  lineBuffer.reserve(128);
+  stream.reserve(8192);
+  body.reserve(8192);
+  log.reserve(4096);
+}
+
+void SimEsp8266::queue(const char* text, unsigned long atMs) {
+  for (int i = 0; i < SLOTS; i++) {
+    if (pending[i].used) continue;
+    pending[i].used = true;
+    pending[i].atMs = atMs;
+    pending[i].order = queued++;
+    pending[i].bytes.assign(text);
+    return;
+  }
+}
+
+void SimEsp8266::checkIdle() {
+  if (link && millis() >= lastActivityMs + keepAliveMs) {
+    link = false;
+    stream.clear();
+    queue("CLOSED\r\n", lastActivityMs + keepAliveMs);
+  }
+}
+
+int SimEsp8266::available() {
+  checkIdle();
+  // Release every queued reply whose time has come, in time order
+  unsigned long now = millis();
+  for (;;) {
+    int next = -1;
+    for (int i = 0; i < SLOTS; i++) {
+      const Pending& p = pending[i];
+      if (!p.used || p.atMs > now) continue;
+      if (next < 0 || p.atMs < pending[next].atMs ||
+          (p.atMs == pending[next].atMs && p.order < pending[next].order)) {
+        next = i;
+      }
+    }
+    if (next < 0) break;
+    rx += pending[next].bytes;
+    pending[next].used = false;
+  }
+  return (int)(rx.size() - rxPos);
+}
+
+int SimEsp8266::read() {
+  if (available() == 0) return -1;
+  int c = (uint8_t)rx[rxPos++];
+  if (rxPos == rx.size()) {
+    rx.clear();
+    rxPos = 0;
+  }
+  return c;
+}
+
+size_t SimEsp8266::write(const uint8_t* data, size_t length) {
+  // SoftwareSerial sends in the foreground: 10 bit times per byte
+  delayMicroseconds((unsigned int)(length * 10000000ULL / baud));
+  checkIdle();
+  received += length;
+  for (size_t i = 0; i < length; i++) {
+    char c = (char)data[i];
+    if (sendRemaining > 0) {
+      stream += c;
+      if (--sendRemaining == 0) {
+        char reply[48];
+        snprintf(reply, sizeof(reply), "\r\nRecv %zu bytes\r\n\r\nSEND OK\r\n", sendSize);
+        queue(reply, millis() + 10);
+        lastActivityMs = millis();
+        handleHttp();
+      }
+      continue;
+    }
+    if (c == '\n') {
+      if (!lineBuffer.empty()) handleLine(lineBuffer);
+      lineBuffer.clear();
+    } else if (c != '\r') {
+      lineBuffer += c;
+    }
+  }
+  return length;
+}
+
+void SimEsp8266::handleLine(const std::string& line) {
+  commands++;
+  unsigned long now = millis();
+  if (line == "AT+RST") {
+    link = false;
+    stream.clear();
+    queue("\r\nOK\r\n", now + 5);
+    queue("\r\n ets Jan  8 2013,rst cause:2\r\n\r\nready\r\n", now + 500);
+  } else if (line.compare(0, 8, "AT+CWJAP") == 0) {
+    queue("WIFI CONNECTED\r\nWIFI GOT IP\r\n\r\nOK\r\n", now + 3000);
+  } else if (line.compare(0, 11, "AT+CIPSTART") == 0) {
+    if (link) {
+      queue("ALREADY CONNECTED\r\n\r\nERROR\r\n", now + 5);
+    } else {
+      link = true;
+      connectCount++;
+      lastActivityMs = now + connectLatencyMs;
+      queue("CONNECT\r\n\r\nOK\r\n", now + connectLatencyMs);
+    }
+  } else if (line.compare(0, 11, "AT+CIPSEND=") == 0) {
+    if (link && sendFailures > 0) {
+      // Connection reset under the module's feet
+      sendFailures--;
+      link = false;
+      stream.clear();
+      queue("CLOSED\r\n", now + 2);
+    }
+    if (!link) {
+      queue("link is not valid\r\n\r\nERROR\r\n", now + 5);
+      return;
+    }
+    sendSize = sendRemaining = (size_t)atoi(line.c_str() + 11);
+    queue("\r\nOK\r\n> ", now + 5);
+  } else if (line == "AT+CIPCLOSE") {
+    queue(link ? "CLOSED\r\n\r\nOK\r\n" : "\r\nERROR\r\n", now + 5);
+    link = false;
+    stream.clear();
+  } else {
+    queue("\r\nOK\r\n", now + 5);
+  }
+}
+
+void SimEsp8266::handleHttp() {
+  // Answer every complete request in the stream
+  for (;;) {
+    size_t headerEnd = stream.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) return;
+    size_t lengthAt = stream.find("Content-Length: ");
+    size_t bodyLength = lengthAt < headerEnd ? (size_t)atoi(stream.c_str() + lengthAt + 16) : 0;
+    if (stream.size() < headerEnd + 4 + bodyLength) return;
+
+    Request request;
+    size_t pathStart = stream.find(' ') + 1;
+    size_t pathLength = stream.find(' ', pathStart) - pathStart;
+    if (pathLength >= sizeof(request.path)) pathLength = sizeof(request.path) - 1;
+    memcpy(request.path, stream.data() + pathStart, pathLength);
+    request.path[pathLength] = '\0';
+    request.bodyLength = bodyLength;
+    request.keepAlive = stream.find("Connection: keep-alive") < headerEnd;
+    unsigned long at = millis() + serverLatencyMs;
+    request.completedMs = at;
+    log.push_back(request);
+    body.assign(stream, headerEnd + 4, bodyLength);
+    stream.erase(0, headerEnd + 4 + bodyLength);
+
+    const char* reply = request.keepAlive
+      ? "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 16\r\n"
+        "Connection: keep-alive\r\n\r\n{\"success\":true}"
+      : "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 16\r\n"
+        "Connection: close\r\n\r\n{\"success\":true}";
+    char frame[192];
+    snprintf(frame, sizeof(frame), "\r\n+IPD,%zu:%s", strlen(reply), reply);
+    queue(frame, at);
+    lastActivityMs = at;
+    if (!request.keepAlive) {
+      link = false;
+      queue("CLOSED\r\n", at + 5);
+    }
+  }
+}
+
+// ---------------------------------------------------------------- WebSocket
+
+bool SimChannel::sendText(const char*, size_t length) {
+  if (!connected) return false;
+  messages++;
+  bytes += length;
+  return true;
+}
+
+// ---------------------------------------------------------------- Display
+
+void SimDisplay::drawText(int16_t, int16_t, const char* text, uint8_t) {
+  last = text;
+}
+
+// ---------------------------------------------------------------- OLED
+
+bool SimOledBus::count(uint8_t length) {
+  if (failing) return false;
+  transfers++;
+  bytes += length + 2u;
+  if (length > largest) largest = length;
+  busTime += (length + 2) * 9 * 1e6 / clockHz;
+  return true;
+}
+
+void SimOledBus::resetCounters() {
+  transfers = 0;
+  bytes = 0;
+  largest = 0;
+  busTime = 0;
+}
+
+bool SimOledBus::command(const uint8_t* data, uint8_t length) {
+  if (!count(length)) return false;
+  for (uint8_t i = 0; i < length; i++) {
+    uint8_t op = data[i];
+    switch (op) {
+      case 0x21:  // Column window
+        if (i + 2 >= length) return false;
+        columnStart = data[i + 1] & 0x7F;
+        columnEnd = data[i + 2] & 0x7F;
+        column = columnStart;
+        i += 2;
+        break;
+      case 0x22:  // Page window
+        if (i + 2 >= length) return false;
+        pageStart = data[i + 1] & 0x07;
+        pageEnd = data[i + 2] & 0x07;
+        page = pageStart;
+        i += 2;
+        break;
+      case 0xAE:
+        on = false;
+        break;
+      case 0xAF:
+        on = true;
+        break;
+      // One argument byte follows
+      case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3: case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+        i++;
+        break;
+      default:
+        break;
+    }
+  }
+  return true;
+}
+
+bool SimOledBus::data(const uint8_t* data, uint8_t length) {
+  if (!count(length)) return false;
+  // Horizontal addressing: across the column window, then the next page
+  for (uint8_t i = 0; i < length; i++) {
+    gddram[page * 128 + column] = data[i];
+    if (column++ == columnEnd) {
+      column = columnStart;
+      page = page == pageEnd ? pageStart : page + 1;
+    }
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------- Log storage
+
+FileLogStorage::FileLogStorage(const char* path, uint32_t size, uint32_t eraseSize)
+  : path(path), bytes(size), sector(eraseSize), erases(eraseSize ? size / eraseSize : 0, 0) {
+  scratch.reserve(eraseSize);
+}
+
+FileLogStorage::~FileLogStorage() {
+  close();
+}
+
+bool FileLogStorage::open() {
+  close();
+  file = fopen(path.c_str(), "r+b");
+  if (file) {
+    fseek(file, 0, SEEK_END);
+    if ((uint32_t)ftell(file) == bytes) return true;
+    fclose(file);
+  }
+  file = fopen(path.c_str(), "w+b");
+  if (!file) return false;
+  std::vector<uint8_t> blank(sector, 0xFF);
+  for (uint32_t offset = 0; offset < bytes; offset += sector) {
+    if (fwrite(blank.data(), 1, sector, file) != sector) return false;
+  }
+  fflush(file);
+  return true;
+}
+
+void FileLogStorage::close() {
+  if (file) fclose(file);
+  file = nullptr;
+}
+
+bool FileLogStorage::reopen() {
+  armed = dead = false;
+  return open();
+}
+
+void FileLogStorage::remove() {
+  close();
+  ::remove(path.c_str());
+}
+
+bool FileLogStorage::read(uint32_t offset, uint8_t* data, size_t length) {
+  if (!file || offset + length > bytes) return false;
+  fseek(file, offset, SEEK_SET);
+  return fread(data, 1, length, file) == length;
+}
+
+bool FileLogStorage::write(uint32_t offset, const uint8_t* data, size_t length) {
+  if (!file || dead || offset + length > bytes) return false;
+  size_t keep = length;
+  if (armed && written + length > cutAfter) {
+    // Only the first bytes make it before the supply drops
+    keep = (size_t)(cutAfter - written);
+    dead = true;
+  }
+  scratch.resize(keep);
+  if (keep && !read(offset, scratch.data(), keep)) return false;
+  for (size_t i = 0; i < keep; i++) scratch[i] &= data[i];
+  fseek(file, offset, SEEK_SET);
+  if (keep && fwrite(scratch.data(), 1, keep, file) != keep) return false;
+  fflush(file);
+  written += keep;
+  writes++;
+  return !dead;
+}
+
+bool FileLogStorage::erase(uint32_t offset) {
+  if (!file || dead || offset % sector != 0 || offset >= bytes) return false;
+  scratch.assign(sector, 0xFF);
+  fseek(file, offset, SEEK_SET);
+  if (fwrite(scratch.data(), 1, sector, file) != sector) return false;
+  fflush(file);
+  erases[offset / sector]++;
+  return true;
+}
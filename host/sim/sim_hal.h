@@ -0,0 +1,430 @@
+/*
+ * RescueNet AI - Simulated HAL back-ends for the host build
+ *
+ * Drop-in implementations of the hal.h interfaces driven by the virtual
+ * clock in the Arduino shim. Benchmarks set the physiological state
+ * (heart rate, temperature, falls) and observe what the firmware sends.
+ * Buffers are reserved up front so the sims themselves do not show up in
+ * the heap churn numbers.
+ */
+
+#ifndef HOST_SIM_HAL_H
+#define HOST_SIM_HAL_H
+
+#include <hal.h>
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+class SimImuSensor;
+
+// Synthetic PPG: DC level plus a pulse shaped AC component at a set rate,
+// sampled into a 32-deep FIFO that overflows like the MAX3010x
+class SimPpgSensor : public PpgSensor {
+public:
+  bool begin() override { return true; }
+  bool configure(uint16_t sampleRateHz, uint8_t averaging) override;
+  uint8_t readFifo(PpgSample* out, uint8_t maxSamples, uint8_t& overflowed) override;
+
+  void setHeartRate(float bpm) { heartRateBpm = bpm; }
+  void setSpO2(float percent) { spO2Percent = percent; }
+  void setFingerPresent(bool present) { fingerPresent = present; }
+  // Scales the pulsatile amplitude (1.0 = 1.5 % IR perfusion index)
+  void setPerfusion(float scale) { perfusion = scale; }
+  // Motion artifact: the IMU's acceleration magnitude off 1 g, 30 ms
+  // late, in IR counts per g, plus a sideways (X) share the magnitude
+  // does not show; 0 turns it off
+  void setMotionCoupling(const SimImuSensor* source, float countsPerG) {
+    imu = source;
+    couplingPerG = countsPerG;
+  }
+  float heartRate() const { return heartRateBpm; }
+  float spO2() const { return spO2Percent; }
+
+  // Waveform value at an arbitrary time
+  uint32_t irAt(unsigned long long timeUs) const;
+  uint32_t redAt(unsigned long long timeUs) const;
+
+  unsigned long long samplesGenerated() const { return generated; }
+
+private:
+  float pulseShape(unsigned long long timeUs) const;
+  float artifactAt(unsigned long long timeUs) const;
+
+  float heartRateBpm = 72.0f;
+  float spO2Percent = 98.0f;
+  float perfusion = 1.0f;
+  bool fingerPresent = true;
+  const SimImuSensor* imu = nullptr;
+  float couplingPerG = 0;
+  unsigned long periodUs = 0;
+  unsigned long long nextSampleUs = 0;
+  unsigned long long generated = 0;
+};
+
+// MPU6050 with an 85-sample FIFO: upright and still (1 g on Z) unless a
+// recorded or synthetic trace is playing; the last trace sample holds
+// afterwards (someone lying on the floor stays there)
+class SimImuSensor : public ImuSensor {
+public:
+  SimImuSensor();
+
+  bool begin() override { return true; }
+  bool configure(uint16_t sampleRateHz) override;
+  uint8_t readFifo(ImuSample* out, uint8_t maxSamples, bool& overflowed) override;
+
+  // Plays trace (sampled at the configured rate) from startMs on
+  void play(const std::vector<ImuSample>& trace, unsigned long startMs);
+  ImuSample sampleAt(unsigned long long timeUs) const;
+
+  unsigned long long samplesGenerated() const { return generated; }
+  unsigned long long samplesLost() const { return lost; }
+
+private:
+  ImuSample rest;
+  std::vector<ImuSample> trace;
+  unsigned long long traceStartUs = 0;
+  unsigned long periodUs = 0;
+  unsigned long long nextSampleUs = 0;
+  unsigned long long generated = 0;
+  unsigned long long lost = 0;
+};
+
+// DS18B20 probes on a OneWire bus. Every transaction costs the virtual
+// time it takes at standard speed (a reset about 1 ms, a byte 0.56 ms);
+// a conversion takes its resolution's time, and a probe read before it
+// is done returns what its scratchpad held, 85 C after power-on.
+#define SIM_TEMP_PROBES 4
+
+class SimTempSensor : public TempSensor {
+public:
+  SimTempSensor();
+
+  void begin() override {}
+  uint8_t search(TempProbeRom* roms, uint8_t max) override;
+  bool setResolution(const TempProbeRom& rom, uint8_t bits) override;
+  bool startConversion() override;
+  bool readRaw(const TempProbeRom& rom, int16_t& sixteenths) override;
+
+  // Probes on the bus, in ROM order; one to begin with
+  void setProbeCount(uint8_t count);
+  void setCelsius(float value, uint8_t probe = 0) { probes[probe].celsius = value; }
+  void setPresent(uint8_t probe, bool present) { probes[probe].present = present; }
+  // Noise on each conversion, standard deviation in C
+  void setNoise(float sd) { noiseC = sd; }
+  // The probe browns out: its scratchpad is back at 85 C until the next conversion
+  void powerGlitch(uint8_t probe);
+  // The next count reads fail their CRC
+  void corruptReads(uint8_t count) { corrupt = count; }
+
+  uint8_t resolution(uint8_t probe) const { return probes[probe].bits; }
+  unsigned long conversions() const { return conversionCount; }
+  unsigned long searches() const { return searchCount; }
+  unsigned long reads() const { return readCount; }
+  // Time on the bus; the clock moves on by it rounded up to whole ms
+  unsigned long long busUs() const { return busTimeUs; }
+
+private:
+  struct Probe {
+    TempProbeRom rom;
+    float celsius;
+    uint8_t bits;
+    bool present;
+    bool converting;
+    unsigned long startedUs;
+    int16_t scratchpad;
+  };
+
+  int8_t find(const TempProbeRom& rom) const;
+  void transaction(unsigned long bytes);
+
+  Probe probes[SIM_TEMP_PROBES];
+  uint8_t probeCount;
+  float noiseC = 0;
+  uint8_t corrupt = 0;
+  unsigned long conversionCount = 0;
+  unsigned long searchCount = 0;
+  unsigned long readCount = 0;
+  unsigned long long busTimeUs = 0;
+};
+
+// SIM800L that answers AT commands after a configurable latency
+class SimModem : public SerialPort {
+public:
+  SimModem();
+
+  int available() override;
+  int read() override;
+  size_t write(const uint8_t* data, size_t length) override;
+
+  void setResponseLatencyMs(unsigned long ms) { latencyMs = ms; }
+  void setSmsLatencyMs(unsigned long ms) { smsLatencyMs = ms; }
+  void setResponsive(bool value) { responsive = value; }
+  // Queue an unsolicited result (e.g. "+CMTI: \"SM\",3") at the given time
+  void injectUrc(const char* line, unsigned long atMs);
+
+  struct SentSms {
+    std::string number;
+    std::string text;
+    unsigned long submittedMs;
+    unsigned long deliveredMs;  // When "+CMGS" became readable
+  };
+  const std::vector<SentSms>& sentMessages() const { return sent; }
+  unsigned long commandCount() const { return commands; }
+
+private:
+  void handleLine(const std::string& line);
+  void queue(const std::string& text, unsigned long atMs);
+
+  struct Pending {
+    unsigned long atMs;
+    std::string bytes;
+  };
+  std::vector<Pending> pending;
+  std::string rx;
+  std::string lineBuffer;
+  bool inSmsBody = false;
+  std::string smsNumber;
+  std::string smsBody;
+  bool responsive = true;
+  unsigned long latencyMs = 20;
+  unsigned long smsLatencyMs = 3000;
+  unsigned long commands = 0;
+  int messageRef = 0;
+  std::vector<SentSms> sent;
+};
+
+// HTTP endpoint that records every POST; can stall or fail on request
+class SimHttp : public HttpPort {
+public:
+  SimHttp() { log.reserve(4096); }
+
+  int post(const char* url, const char* contentType, const char* body, size_t length) override;
+
+  // Virtual time a blocking request takes (handshake + round trip)
+  void setLatencyMs(unsigned long ms) { latencyMs = ms; }
+  void setFailing(bool value) { failing = value; }
+  // Keep URL and body text; turn off when measuring firmware heap churn
+  void setRecordBodies(bool value) { recordBodies = value; }
+
+  struct Request {
+    std::string url;
+    std::string contentType;
+    std::string body;
+    size_t length;
+    unsigned long startedMs;
+    unsigned long completedMs;
+  };
+  const std::vector<Request>& requests() const { return log; }
+  void clear() { log.clear(); }
+  unsigned long long bytesSent() const { return bytes; }
+
+private:
+  unsigned long latencyMs = 80;
+  bool failing = false;
+  bool recordBodies = true;
+  unsigned long long bytes = 0;
+  std::vector<Request> log;
+};
+
+// ESP-01 running the AT firmware, in single connection mode, in front of
+// an HTTP server that answers every complete POST with 200. Writes take
+// the time the bytes need on a SoftwareSerial link at the set baud rate.
+class SimEsp8266 : public SerialPort {
+public:
+  SimEsp8266();
+
+  int available() override;
+  int read() override;
+  size_t write(const uint8_t* data, size_t length) override;
+  using SerialPort::write;
+
+  void setBaud(unsigned long value) { baud = value; }
+  // TCP handshake time for AT+CIPSTART
+  void setConnectLatencyMs(unsigned long ms) { connectLatencyMs = ms; }
+  // Request fully received to the +IPD reply
+  void setServerLatencyMs(unsigned long ms) { serverLatencyMs = ms; }
+  // Server closes an idle keep-alive connection after this long (Node: 5 s)
+  void setKeepAliveMs(unsigned long ms) { keepAliveMs = ms; }
+  // The next n AT+CIPSEND find the link broken
+  void failSends(int n) { sendFailures = n; }
+
+  struct Request {
+    char path[32];
+    size_t bodyLength;
+    bool keepAlive;
+    unsigned long completedMs;
+  };
+  const std::vector<Request>& requests() const { return log; }
+  const std::string& lastBody() const { return body; }
+  unsigned long connects() const { return connectCount; }
+  unsigned long commandCount() const { return commands; }
+  unsigned long long bytesFromHost() const { return received; }
+  bool linkUp() const { return link; }
+
+private:
+  void handleLine(const std::string& line);
+  void handleHttp();
+  void queue(const char* text, unsigned long atMs);
+  void checkIdle();
+
+  // Reply slots keep their capacity, so nothing is allocated once running
+  static const int SLOTS = 16;
+  struct Pending {
+    bool used;
+    unsigned long atMs;
+    unsigned long order;
+    std::string bytes;
+  };
+  Pending pending[SLOTS];
+  unsigned long queued = 0;
+  std::string rx;
+  size_t rxPos = 0;
+  std::string lineBuffer;
+  std::string stream;  // HTTP bytes of the open connection
+  std::string body;
+  size_t sendRemaining = 0;
+  size_t sendSize = 0;
+  bool link = false;
+  unsigned long lastActivityMs = 0;
+  unsigned long baud = 9600;
+  unsigned long connectLatencyMs = 150;
+  unsigned long serverLatencyMs = 60;
+  unsigned long keepAliveMs = 5000;
+  int sendFailures = 0;
+  unsigned long connectCount = 0;
+  unsigned long commands = 0;
+  unsigned long long received = 0;
+  std::vector<Request> log;
+};
+
+class SimChannel : public MessageChannel {
+public:
+  void loop() override {}
+  bool isConnected() override { return connected; }
+  bool sendText(const char* text, size_t length) override;
+
+  void setConnected(bool value) { connected = value; }
+  unsigned long messagesSent() const { return messages; }
+  unsigned long long bytesSent() const { return bytes; }
+
+private:
+  bool connected = true;
+  unsigned long messages = 0;
+  unsigned long long bytes = 0;
+};
+
+class SimDisplay : public TextDisplay {
+public:
+  SimDisplay() { last.reserve(128); }
+
+  void clear() override {}
+  void drawText(int16_t x, int16_t y, const char* text, uint8_t size) override;
+  void flush() override { frames++; }
+
+  unsigned long framesPushed() const { return frames; }
+  const std::string& lastText() const { return last; }
+
+private:
+  unsigned long frames = 0;
+  std::string last;
+};
+
+// SSD1306 on I2C: keeps its display RAM so what a renderer sent can be
+// compared with what it meant, and counts the bus traffic and its time
+class SimOledBus : public OledBus {
+public:
+  bool command(const uint8_t* bytes, uint8_t length) override;
+  bool data(const uint8_t* bytes, uint8_t length) override;
+
+  // Bus clock for busUs(); every byte is 9 clocks
+  void setClockHz(uint32_t hz) { clockHz = hz; }
+  // Refuse every transaction, a panel that stopped acknowledging
+  void setFailing(bool value) { failing = value; }
+
+  // Display RAM, page by page: 8 x 128 bytes
+  const uint8_t* ram() const { return gddram; }
+  bool pixel(uint8_t x, uint8_t y) const { return (gddram[(y / 8) * 128 + x] >> (y % 8)) & 1; }
+  bool displayOn() const { return on; }
+
+  unsigned long transactions() const { return transfers; }
+  unsigned long long bytesSent() const { return bytes; }
+  uint8_t largestTransaction() const { return largest; }
+  // Time on the wire: address, control byte and payload
+  double busUs() const { return busTime; }
+  void resetCounters();
+
+private:
+  bool count(uint8_t length);
+
+  uint8_t gddram[8 * 128] = {};
+  uint8_t columnStart = 0, columnEnd = 127, pageStart = 0, pageEnd = 7;
+  uint8_t column = 0, page = 0;
+  bool on = false;
+  bool failing = false;
+  uint32_t clockHz = 400000;
+  unsigned long transfers = 0;
+  unsigned long long bytes = 0;
+  uint8_t largest = 0;
+  double busTime = 0;
+};
+
+// LogStorage on a file, the Linux back-end of the store-and-forward log.
+// Behaves like NOR flash: a write can only clear bits of what is there.
+// A power cut can be armed to stop a write part way through, after which
+// every write and erase fails until reopen().
+class FileLogStorage : public LogStorage {
+public:
+  FileLogStorage(const char* path, uint32_t size, uint32_t eraseSize);
+  ~FileLogStorage();
+
+  // Opens the file, creating it erased when missing or the wrong size
+  bool open();
+  void close();
+  // Closes and opens again with power restored: the device resetting
+  bool reopen();
+  // Removes the file, so the next open() starts blank
+  void remove();
+
+  uint32_t size() override { return bytes; }
+  uint32_t eraseSize() override { return sector; }
+  bool read(uint32_t offset, uint8_t* data, size_t length) override;
+  bool write(uint32_t offset, const uint8_t* data, size_t length) override;
+  bool erase(uint32_t offset) override;
+
+  // Power fails once bytesWritten() reaches this
+  void cutPowerAfter(uint64_t bytes) { cutAfter = bytes; armed = true; }
+  bool powerLost() const { return dead; }
+
+  uint64_t bytesWritten() const { return written; }
+  unsigned long writeCalls() const { return writes; }
+  const std::vector<unsigned long>& eraseCounts() const { return erases; }
+
+private:
+  std::string path;
+  uint32_t bytes;
+  uint32_t sector;
+  FILE* file = nullptr;
+  bool armed = false;
+  bool dead = false;
+  uint64_t cutAfter = 0;
+  uint64_t written = 0;
+  unsigned long writes = 0;
+  std::vector<unsigned long> erases;
+  std::vector<uint8_t> scratch;
+};
+
+// Convenience bundle wiring every simulated part into a MonitorHal-ready set
+struct SimBoard {
+  SimPpgSensor ppg;
+  SimImuSensor imu;
+  SimTempSensor temp;
+  SimModem modem;
+  SimHttp http;
+  SimChannel channel;
+  SimDisplay display;
+};
+
+#endif
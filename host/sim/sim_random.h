@@ -0,0 +1,40 @@
+/*
+ * RescueNet AI - Seeded noise for traces and benchmarks
+ *
+ * A xorshift32 generator, so every run of a bench draws the same noise
+ * and prints the same numbers. Traces seed one each; a bench that only
+ * needs repeatable noise takes the default seed.
+ */
+
+#ifndef HOST_SIM_RANDOM_H
+#define HOST_SIM_RANDOM_H
+
+#include <stdint.h>
+
+class SimRandom {
+public:
+  // xorshift never leaves 0, so seed 0 starts from 1
+  explicit SimRandom(uint32_t seed = 2463534242UL) : state(seed ? seed : 1) {}
+
+  uint32_t next() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  // Integer in [-amplitude, amplitude]; 0 still advances the stream
+  int centered(int amplitude) {
+    uint32_t value = next();
+    if (amplitude == 0) return 0;
+    return (int)(value % (uint32_t)(2 * amplitude + 1)) - amplitude;
+  }
+
+  // In [-1, 1] in steps of 1e-4
+  float uniform() { return (float)(next() % 20001) / 10000.0f - 1.0f; }
+
+private:
+  uint32_t state;
+};
+
+#endif
@@ -0,0 +1,42 @@
+/*
+ * RescueNet AI - Canned records for the benchmarks
+ */
+
+#include "sim_records.h"
+
+#include <Arduino.h>
+
+#include <string.h>
+
+TelemetryRecord simReading(uint32_t i) {
+  TelemetryRecord r;
+  memset(&r, 0, sizeof(r));
+  r.kind = TELEMETRY_HEALTH;
+  r.sequence = (uint16_t)i;
+  r.flags = TELEMETRY_FLAG_LOCATION;
+  r.timestamp = millis();
+  r.userId = "1234567890";
+  r.heartRate = 60.0f + (float)(i % 30);
+  r.spO2 = 97.0f;
+  r.temperature = 36.6f;
+  r.bloodPressureSys = 118.0f;
+  r.latitude = 21.1458;
+  r.longitude = 79.0882;
+  r.accelZ = 9.81f;
+  r.batteryLevel = TELEMETRY_BATTERY_UNKNOWN;
+  return r;
+}
+
+HistorySample simHistorySample(uint32_t timestamp) {
+  HistorySample s;
+  uint32_t i = (timestamp - SIM_HISTORY_START) / SIM_HISTORY_STEP_S;
+  s.timestamp = timestamp;
+  s.heartRate = 55.0f + (float)(i % 60) + 0.5f;
+  s.spO2 = 90.0f + (float)(i % 10);
+  s.temperature = 36.0f + (float)(i % 200) / 100.0f;
+  s.bloodPressureSys = (uint8_t)(110 + i % 20);
+  s.bloodPressureDia = (uint8_t)(70 + i % 10);
+  s.flags = TELEMETRY_FLAG_WALL_CLOCK;
+  s.batteryLevel = (uint8_t)(i % 101);
+  return s;
+}
@@ -0,0 +1,29 @@
+/*
+ * RescueNet AI - Canned records for the benchmarks
+ *
+ * Readings the store-and-forward benches feed the uploader, numbered so
+ * a server that sees them can tell a lost or repeated one, and the
+ * history samples the log and HTTP benches write: one every
+ * SIM_HISTORY_STEP_S seconds from SIM_HISTORY_START, each field derived
+ * from the timestamp so a sample read back can be checked on its own.
+ */
+
+#ifndef HOST_SIM_RECORDS_H
+#define HOST_SIM_RECORDS_H
+
+#include <history_log.h>
+#include <telemetry.h>
+
+#include <stdint.h>
+
+// 2023-11-14 22:13:20 UTC, the first history sample
+#define SIM_HISTORY_START 1700000000UL
+#define SIM_HISTORY_STEP_S 5
+
+// Health reading number i, stamped with the virtual clock, with a GPS fix
+TelemetryRecord simReading(uint32_t i);
+
+// The history sample taken at timestamp
+HistorySample simHistorySample(uint32_t timestamp);
+
+#endif
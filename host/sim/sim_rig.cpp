@@ -0,0 +1,34 @@
+/*
+ * RescueNet AI - Simulated device rig
+ */
+
+#include "sim_rig.h"
+
+const char* const HEALTH_URL = "http://192.168.1.100:3000/api/health-data";
+const char* const EMERGENCY_URL = "http://192.168.1.100:3000/api/emergency";
+
+MonitorConfig simMonitorConfig(uint8_t powerPolicy, bool binaryTelemetry) {
+  MonitorConfig config = {"1234567890", HEALTH_URL, EMERGENCY_URL, "+1234567890",
+                          BUZZER_PIN, LED_STATUS_PIN, LED_EMERGENCY_PIN,
+                          BUTTON_EMERGENCY_PIN, 0, binaryTelemetry, powerPolicy};
+  return config;
+}
+
+SimRig::SimRig(const MonitorConfig& config, const MonitorHal& parts) : monitor(withBoard(parts), config) {}
+
+void SimRig::boot(MonitorMode mode) {
+  simSetMillis(0);
+  simSetPinInput(BUTTON_EMERGENCY_PIN, HIGH);
+  monitor.begin(mode);
+  monitor.setNetworkConnected(true);
+}
+
+MonitorHal SimRig::withBoard(MonitorHal parts) {
+  if (!parts.ppg) parts.ppg = &board.ppg;
+  if (!parts.imu) parts.imu = &board.imu;
+  if (!parts.temp) parts.temp = &board.temp;
+  if (!parts.http) parts.http = &board.http;
+  if (!parts.channel) parts.channel = &board.channel;
+  if (!parts.display) parts.display = &board.display;
+  return parts;
+}
@@ -0,0 +1,49 @@
+/*
+ * RescueNet AI - Simulated device rig
+ *
+ * HealthMonitor on a SimBoard, wired the way the ESP32 sketch wires it:
+ * its pins, its server URLs and its MonitorConfig, for the benchmarks
+ * that run the whole monitor. A bench that needs more passes the parts
+ * it adds or swaps in (a modem, a battery hook, another temperature
+ * sensor); one with parts of its own derives from SimRig and hands their
+ * addresses over, as the monitor uses none of them before begin().
+ */
+
+#ifndef HOST_SIM_RIG_H
+#define HOST_SIM_RIG_H
+
+#include <health_monitor.h>
+
+#include "sim_hal.h"
+
+#include <stdint.h>
+
+const uint8_t BUZZER_PIN = 2;
+const uint8_t LED_STATUS_PIN = 5;
+const uint8_t LED_EMERGENCY_PIN = 18;
+const uint8_t BUTTON_EMERGENCY_PIN = 0;
+const uint8_t SIM800L_RST_PIN = 14;
+const uint8_t SIM800L_PWR_PIN = 15;
+
+extern const char* const HEALTH_URL;
+extern const char* const EMERGENCY_URL;
+
+// The sketch's config; JSON telemetry unless binaryTelemetry
+MonitorConfig simMonitorConfig(uint8_t powerPolicy = POWER_FIXED, bool binaryTelemetry = false);
+
+struct SimRig {
+  SimBoard board;
+  HealthMonitor monitor;
+
+  // parts: null fields take the board's sensors, HTTP, channel and
+  // display; the modem, GPS, backlog and hooks stay as given
+  explicit SimRig(const MonitorConfig& config = simMonitorConfig(), const MonitorHal& parts = MonitorHal());
+
+  // Virtual clock at 0, the button released, the monitor started and online
+  void boot(MonitorMode mode = MONITOR_SINGLE_LOOP);
+
+private:
+  MonitorHal withBoard(MonitorHal parts);
+};
+
+#endif
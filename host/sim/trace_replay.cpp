@@ -0,0 +1,203 @@
+/*
+ * RescueNet AI - Sensor trace replay
+ */
+
+#include "trace_replay.h"
+
+#include <Arduino.h>
+
+#include <fstream>
+#include <sstream>
+
+std::string traceFromText(const std::string& log) {
+  const size_t prefix = sizeof(TRACE_LINE_PREFIX) - 1;
+  std::string bytes;
+  uint8_t record[TRACE_RECORD_MAX];
+  size_t start = 0;
+  while (start < log.size()) {
+    size_t end = log.find('\n', start);
+    if (end == std::string::npos) end = log.size();
+    // Anywhere in the line: a message cut short by a record ends up in front of it
+    size_t at = log.find(TRACE_LINE_PREFIX, start);
+    if (at != std::string::npos && at < end) {
+      size_t n = traceDecodeLine(log.data() + at + prefix, end - at - prefix, record, sizeof(record));
+      bytes.append((const char*)record, n);
+    }
+    start = end + 1;
+  }
+  return bytes;
+}
+
+std::string loadTraceBytes(const char* path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream content;
+  content << in.rdbuf();
+  std::string bytes = content.str();
+  // A card's file starts with a record; a capture with text
+  if (!bytes.empty() && bytes[0] == TRACE_START) return bytes;
+  return traceFromText(bytes);
+}
+
+bool parseTrace(const std::string& bytes, SensorTrace& out) {
+  TraceReader reader((const uint8_t*)bytes.data(), bytes.size());
+  TraceRecord record;
+  bool started = false;
+  while (reader.next(record)) {
+    out.records++;
+    out.durationUs = record.timeUs;
+    switch (record.type) {
+      case TRACE_START:
+        started = true;
+        if (record.length > 5) out.name.assign((const char*)record.payload + 5, record.length - 5);
+        break;
+      case TRACE_PPG_RATE:
+      case TRACE_IMU_RATE: {
+        SensorTrace::Rate rate = {record.timeUs, (uint16_t)(record.payload[0] | record.payload[1] << 8),
+                                  record.type == TRACE_PPG_RATE ? record.payload[2] : (uint8_t)1};
+        (record.type == TRACE_PPG_RATE ? out.ppgRates : out.imuRates).push_back(rate);
+        break;
+      }
+      case TRACE_PPG: {
+        PpgSample samples[TRACE_PPG_PER_RECORD];
+        uint8_t lost = 0;
+        uint8_t n = traceDecodePpg(record, samples, TRACE_PPG_PER_RECORD, lost);
+        for (uint8_t i = 0; i < n; i++) out.ppg.push_back({record.timeUs, samples[i], (uint8_t)(i ? 0 : lost)});
+        break;
+      }
+      case TRACE_IMU: {
+        ImuSample samples[TRACE_IMU_PER_RECORD];
+        bool overflowed = false;
+        uint8_t n = traceDecodeImu(record, samples, TRACE_IMU_PER_RECORD, overflowed);
+        for (uint8_t i = 0; i < n; i++) {
+          out.imu.push_back({record.timeUs, samples[i], (uint8_t)(!i && overflowed ? 1 : 0)});
+        }
+        break;
+      }
+      case TRACE_TEMP_ROMS: {
+        SensorTrace::TempSearch search = {record.timeUs, {}};
+        for (uint8_t i = 0; i + 8 <= record.length; i += 8) {
+          TempProbeRom rom;
+          memcpy(rom.bytes, record.payload + i, 8);
+          search.roms.push_back(rom);
+        }
+        out.tempSearches.push_back(search);
+        break;
+      }
+      case TRACE_TEMP: {
+        SensorTrace::TempRead read;
+        read.atUs = record.timeUs;
+        if (traceDecodeTemp(record, read.rom, read.answered, read.sixteenths)) out.temps.push_back(read);
+        break;
+      }
+      case TRACE_GPS:
+        for (uint8_t i = 0; i < record.length; i++) out.gps.push_back({record.timeUs, record.payload[i], 0});
+        break;
+      case TRACE_LABEL:
+        if (record.length) out.labels.push_back({record.timeUs, record.payload[0]});
+        break;
+      case TRACE_ALERT:
+        out.alerts.push_back({record.timeUs, 0});
+        break;
+      case TRACE_LOST:
+        if (record.length >= 4) {
+          out.lostRecords += (uint32_t)(record.payload[0] | record.payload[1] << 8 | record.payload[2] << 16 |
+                                        (uint32_t)record.payload[3] << 24);
+        }
+        break;
+    }
+  }
+  out.reader = reader.stats();
+  return started;
+}
+
+namespace {
+
+// The rate in force at time; 0 before the first
+uint16_t rateAt(const std::vector<SensorTrace::Rate>& rates, uint64_t atUs, uint8_t* averaging = nullptr) {
+  uint16_t hz = 0;
+  for (size_t i = 0; i < rates.size() && rates[i].atUs <= atUs + TRACE_REPLAY_SLACK_US; i++) {
+    hz = rates[i].hz;
+    if (averaging) *averaging = rates[i].averaging;
+  }
+  return hz;
+}
+
+}  // namespace
+
+bool ReplayPpg::configure(uint16_t sampleRateHz, uint8_t averaging) {
+  uint8_t recordedAveraging = 0;
+  uint16_t hz = rateAt(trace.ppgRates, micros() - startUs, &recordedAveraging);
+  if (hz && (hz != sampleRateHz || recordedAveraging != averaging)) mismatches++;
+  return true;
+}
+
+uint8_t ReplayPpg::readFifo(PpgSample* out, uint8_t maxSamples, uint8_t& overflowed) {
+  uint64_t now = micros() - startUs;
+  uint8_t n = 0;
+  overflowed = 0;
+  while (n < maxSamples && next < trace.ppg.size() && trace.ppg[next].atUs <= now) {
+    overflowed += trace.ppg[next].lost;
+    out[n++] = trace.ppg[next++].value;
+  }
+  return n;
+}
+
+bool ReplayImu::configure(uint16_t sampleRateHz) {
+  uint16_t hz = rateAt(trace.imuRates, micros() - startUs);
+  if (hz && hz != sampleRateHz) mismatches++;
+  return true;
+}
+
+uint8_t ReplayImu::readFifo(ImuSample* out, uint8_t maxSamples, bool& overflowed) {
+  uint64_t now = micros() - startUs;
+  uint8_t n = 0;
+  overflowed = false;
+  while (n < maxSamples && next < trace.imu.size() && trace.imu[next].atUs <= now) {
+    overflowed |= trace.imu[next].lost != 0;
+    out[n++] = trace.imu[next++].value;
+  }
+  return n;
+}
+
+uint8_t ReplayTemp::search(TempProbeRom* roms, uint8_t max) {
+  uint64_t now = micros() - startUs;
+  const SensorTrace::TempSearch* found = nullptr;
+  for (size_t i = 0; i < trace.tempSearches.size(); i++) {
+    if (found && trace.tempSearches[i].atUs > now + TRACE_REPLAY_SLACK_US) break;
+    found = &trace.tempSearches[i];
+  }
+  if (!found) return 0;
+  uint8_t n = 0;
+  for (; n < max && n < found->roms.size(); n++) roms[n] = found->roms[n];
+  return n;
+}
+
+bool ReplayTemp::readRaw(const TempProbeRom& rom, int16_t& sixteenths) {
+  uint64_t now = micros() - startUs;
+  while (next < trace.temps.size() && trace.temps[next].atUs <= now + TRACE_REPLAY_SLACK_US) next++;
+  // The latest read of this probe
+  for (size_t i = next; i-- > 0;) {
+    const SensorTrace::TempRead& read = trace.temps[i];
+    if (memcmp(read.rom.bytes, rom.bytes, sizeof(rom.bytes)) != 0) continue;
+    reads++;
+    sixteenths = read.sixteenths;
+    return read.answered;
+  }
+  return false;
+}
+
+int ReplaySerial::available() {
+  uint64_t now = micros() - startUs;
+  size_t end = next;
+  while (end < trace.gps.size() && trace.gps[end].atUs <= now) end++;
+  return (int)(end - next);
+}
+
+int ReplaySerial::read() {
+  if (next >= trace.gps.size() || trace.gps[next].atUs > micros() - startUs) return -1;
+  return trace.gps[next++].value;
+}
+
+ReplayBoard::ReplayBoard(const SensorTrace& trace)
+  : trace(trace), startUs(micros()), ppg(trace, startUs), imu(trace, startUs), temp(trace, startUs),
+    gpsPort(trace, startUs), gps(gpsPort) {}
@@ -0,0 +1,182 @@
+/*
+ * RescueNet AI - Sensor trace replay
+ *
+ * Plays a trace (sensor_trace.h) back through the hal.h interfaces in
+ * virtual time, so the monitor sees what the device's drivers returned
+ * when they returned it, as fast as the host can run it. A trace is
+ * loaded from a card's file or from a console capture, where the
+ * TRACE_LINE_PREFIX lines are picked out from everything else.
+ *
+ * Time 0 of the trace (its first record) is the virtual clock when the
+ * replay board is made. Each FIFO burst becomes readable at the time it
+ * was read on the device, each probe read and each search answers with
+ * what was recorded nearest before the call, and the GPS bytes arrive
+ * when they were read. Only what the recording drivers returned is in
+ * the trace: code that polls more slowly than the device did sees the
+ * samples late rather than lost, and configure() at a rate other than
+ * the recorded one gets the recorded samples anyway and is counted.
+ */
+
+#ifndef HOST_TRACE_REPLAY_H
+#define HOST_TRACE_REPLAY_H
+
+#include <gps_receiver.h>
+#include <hal.h>
+#include <sensor_trace.h>
+
+#include "sim_hal.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// A probe read answers with a record up to this far after the call: the
+// device's bus time is not part of the replay, so its loop runs early
+#define TRACE_REPLAY_SLACK_US 100000ULL
+
+struct TraceMark {
+  uint64_t atUs;
+  uint8_t label;  // TraceLabel; 0 for the device's alerts
+};
+
+// A trace decoded into what each driver returns
+struct SensorTrace {
+  template <typename T>
+  struct Timed {
+    uint64_t atUs;
+    T value;
+    uint8_t lost;  // With the first sample of a burst: what the FIFO lost before it
+  };
+  struct Rate {
+    uint64_t atUs;
+    uint16_t hz;
+    uint8_t averaging;
+  };
+  struct TempRead {
+    uint64_t atUs;
+    TempProbeRom rom;
+    bool answered;
+    int16_t sixteenths;
+  };
+  struct TempSearch {
+    uint64_t atUs;
+    std::vector<TempProbeRom> roms;
+  };
+
+  std::string name;
+  uint64_t durationUs = 0;
+  std::vector<Rate> ppgRates;
+  std::vector<Rate> imuRates;
+  std::vector<Timed<PpgSample>> ppg;
+  std::vector<Timed<ImuSample>> imu;
+  std::vector<TempSearch> tempSearches;
+  std::vector<TempRead> temps;
+  std::vector<Timed<uint8_t>> gps;
+  std::vector<TraceMark> labels;
+  std::vector<TraceMark> alerts;
+  uint32_t records = 0;
+  uint32_t lostRecords = 0;  // TRACE_LOST totals
+  TraceReaderStats reader = {};
+};
+
+// The record bytes of a file: as it is, or the lines of a console capture
+std::string loadTraceBytes(const char* path);
+// The TRACE_LINE_PREFIX lines of a capture back to records
+std::string traceFromText(const std::string& log);
+// False when no record in bytes starts a trace
+bool parseTrace(const std::string& bytes, SensorTrace& out);
+
+class ReplayPpg : public PpgSensor {
+public:
+  ReplayPpg(const SensorTrace& trace, uint64_t startUs) : trace(trace), startUs(startUs) {}
+
+  bool begin() override { return !trace.ppg.empty(); }
+  bool configure(uint16_t sampleRateHz, uint8_t averaging) override;
+  uint8_t readFifo(PpgSample* out, uint8_t maxSamples, uint8_t& overflowed) override;
+
+  size_t replayed() const { return next; }
+  unsigned rateMismatches() const { return mismatches; }
+
+private:
+  const SensorTrace& trace;
+  uint64_t startUs;
+  size_t next = 0;
+  unsigned mismatches = 0;
+};
+
+class ReplayImu : public ImuSensor {
+public:
+  ReplayImu(const SensorTrace& trace, uint64_t startUs) : trace(trace), startUs(startUs) {}
+
+  bool begin() override { return !trace.imu.empty(); }
+  bool configure(uint16_t sampleRateHz) override;
+  uint8_t readFifo(ImuSample* out, uint8_t maxSamples, bool& overflowed) override;
+
+  size_t replayed() const { return next; }
+  unsigned rateMismatches() const { return mismatches; }
+
+private:
+  const SensorTrace& trace;
+  uint64_t startUs;
+  size_t next = 0;
+  unsigned mismatches = 0;
+};
+
+class ReplayTemp : public TempSensor {
+public:
+  ReplayTemp(const SensorTrace& trace, uint64_t startUs) : trace(trace), startUs(startUs) {}
+
+  void begin() override {}
+  uint8_t search(TempProbeRom* roms, uint8_t max) override;
+  bool setResolution(const TempProbeRom&, uint8_t) override { return true; }
+  bool startConversion() override { return true; }
+  bool readRaw(const TempProbeRom& rom, int16_t& sixteenths) override;
+
+  unsigned long replayed() const { return reads; }
+
+private:
+  const SensorTrace& trace;
+  uint64_t startUs;
+  size_t next = 0;  // First read not yet due
+  unsigned long reads = 0;
+};
+
+// The GPS UART; what the receiver writes (configuration) goes nowhere
+class ReplaySerial : public SerialPort {
+public:
+  ReplaySerial(const SensorTrace& trace, uint64_t startUs) : trace(trace), startUs(startUs) {}
+
+  int available() override;
+  int read() override;
+  size_t write(const uint8_t*, size_t length) override { return length; }
+  using SerialPort::write;
+
+  size_t replayed() const { return next; }
+
+private:
+  const SensorTrace& trace;
+  uint64_t startUs;
+  size_t next = 0;
+};
+
+// Every driver a MonitorHal needs; the outputs are the simulated ones
+struct ReplayBoard {
+  explicit ReplayBoard(const SensorTrace& trace);
+
+  const SensorTrace& trace;
+  uint64_t startUs;
+  ReplayPpg ppg;
+  ReplayImu imu;
+  ReplayTemp temp;
+  ReplaySerial gpsPort;
+  GpsReceiver gps;
+  SimHttp http;
+  SimChannel channel;
+  SimDisplay display;
+
+  // The trace's time at the virtual clock's now
+  uint64_t traceUs() const { return micros() - startUs; }
+  bool finished() const { return traceUs() >= trace.durationUs; }
+};
+
+#endif
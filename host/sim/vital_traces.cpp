@@ -0,0 +1,205 @@
+/*
+ * RescueNet AI - Synthetic labeled vital-sign traces
+ */
+
+#include "vital_traces.h"
+
+#include "sim_random.h"
+
+#include <math.h>
+
+namespace {
+
+const float PI_F = 3.14159265359f;
+const size_t READINGS_PER_MINUTE = 60000UL / VITAL_TRACE_READING_MS;
+
+// Readings from a heart rate and temperature level that segments move;
+// noise, the slow rhythms and spikes go on top
+class Builder {
+public:
+  Builder(const char* label, uint32_t seed, float heartRate, float temperature)
+    : random(seed), hr(heartRate), temp(temperature), hrNoise(2.0f), tempNoise(0.05f) {
+    trace.label = label;
+    trace.anomalous = false;
+    trace.onset = 0;
+  }
+
+  // Level for the given minutes
+  void hold(float minutes, bool moving = false) { ramp(minutes, hr, temp, moving); }
+
+  // Linear move to the new levels over the given minutes
+  void ramp(float minutes, float heartRate, float temperature, bool moving = false) {
+    size_t n = (size_t)(minutes * READINGS_PER_MINUTE);
+    float hr0 = hr;
+    float temp0 = temp;
+    for (size_t i = 1; i <= n; i++) {
+      float f = (float)i / n;
+      hr = hr0 + (heartRate - hr0) * f;
+      temp = temp0 + (temperature - temp0) * f;
+      emit(moving);
+    }
+  }
+
+  // Exponential return towards the levels, as after exercise
+  void recover(float minutes, float heartRate, float tauMinutes) {
+    size_t n = (size_t)(minutes * READINGS_PER_MINUTE);
+    float k = expf(-1.0f / (tauMinutes * READINGS_PER_MINUTE));
+    for (size_t i = 0; i < n; i++) {
+      hr = heartRate + (hr - heartRate) * k;
+      emit(false);
+    }
+  }
+
+  // One reading off by delta, like a motion artifact
+  void spike(float hrDelta, float tempDelta) {
+    emit(false);
+    trace.heartRate.back() += hrDelta;
+    trace.temperature.back() += tempDelta;
+  }
+
+  void markOnset() {
+    trace.anomalous = true;
+    trace.onset = trace.heartRate.size();
+  }
+
+  VitalTrace done() { return trace; }
+
+private:
+  // Sum of uniforms, close enough to a normal distribution
+  float gaussian(float sd) {
+    float total = 0;
+    for (int i = 0; i < 4; i++) {
+      total += random.uniform();
+    }
+    return sd * total * 0.866f;
+  }
+
+  void emit(bool moving) {
+    size_t i = trace.heartRate.size();
+    // Hour-long wander of heart rate and a circadian-like temperature swing
+    float hrWave = 3.0f * sinf(2 * PI_F * i / (60.0f * READINGS_PER_MINUTE));
+    float tempWave = 0.15f * sinf(2 * PI_F * i / (240.0f * READINGS_PER_MINUTE));
+    trace.heartRate.push_back(hr + hrWave + gaussian(hrNoise));
+    trace.temperature.push_back(temp + tempWave + gaussian(tempNoise));
+    trace.moving.push_back(moving ? 1 : 0);
+  }
+
+  SimRandom random;
+  float hr;
+  float temp;
+  float hrNoise;
+  float tempNoise;
+  VitalTrace trace;
+};
+
+// Parameter jitter: value scaled by 1 +- spread, fixed per (variant, slot)
+float jitter(float value, int variant, int slot, float spread) {
+  uint32_t h = (uint32_t)(variant * 2654435761UL) ^ (uint32_t)(slot * 40503UL);
+  h ^= h >> 13;
+  h *= 0x5bd1e995UL;
+  h ^= h >> 15;
+  float unit = (float)(h % 2001) / 1000.0f - 1.0f;
+  return value * (1.0f + spread * unit);
+}
+
+}  // namespace
+
+std::vector<VitalTrace> makeVitalTraces(int variants) {
+  std::vector<VitalTrace> traces;
+  for (int v = 0; v < variants; v++) {
+    uint32_t seed = 3000u + (uint32_t)v * 7919u;
+
+    // ------------------------------------------------------------ normal
+    {
+      Builder b("resting", seed, jitter(70, v, 1, 0.1f), jitter(36.6f, v, 2, 0.005f));
+      b.hold(180);
+      traces.push_back(b.done());
+    }
+    {
+      // Resting heart rate under the fixed 50 BPM limit
+      Builder b("athlete at rest", seed + 1, jitter(45, v, 3, 0.05f), jitter(36.4f, v, 4, 0.005f));
+      b.hold(180);
+      traces.push_back(b.done());
+    }
+    {
+      Builder b("exercise", seed + 2, jitter(68, v, 5, 0.1f), 36.6f);
+      b.hold(60);
+      b.ramp(3, jitter(135, v, 6, 0.08f), 37.2f, true);
+      b.hold(jitter(25, v, 7, 0.3f), true);
+      b.recover(10, jitter(68, v, 5, 0.1f), 2.5f);
+      b.ramp(20, jitter(68, v, 5, 0.1f), 36.6f);
+      b.hold(60);
+      traces.push_back(b.done());
+    }
+    {
+      Builder b("sleep", seed + 3, jitter(66, v, 8, 0.1f), 36.6f);
+      b.hold(60);
+      b.ramp(40, jitter(55, v, 9, 0.05f), 36.3f);
+      b.hold(120);
+      traces.push_back(b.done());
+    }
+    {
+      // Single readings off by a lot: motion artifacts, a loose probe
+      Builder b("artifacts", seed + 4, jitter(72, v, 10, 0.1f), 36.6f);
+      for (int i = 0; i < 18; i++) {
+        b.hold(jitter(10, v, 11 + i, 0.3f));
+        b.spike(i % 2 ? 60.0f : -30.0f, i % 3 ? 0.0f : 2.5f);
+      }
+      traces.push_back(b.done());
+    }
+
+    // ------------------------------------------------------------ anomalous
+    {
+      Builder b("tachycardia", seed + 10, jitter(72, v, 30, 0.1f), 36.6f);
+      b.hold(60);
+      b.markOnset();
+      b.ramp(1, jitter(128, v, 31, 0.06f), 36.7f);
+      b.hold(30);
+      traces.push_back(b.done());
+    }
+    {
+      Builder b("bradycardia", seed + 11, jitter(70, v, 32, 0.1f), 36.6f);
+      b.hold(60);
+      b.markOnset();
+      b.ramp(2, jitter(40, v, 33, 0.05f), 36.5f);
+      b.hold(30);
+      traces.push_back(b.done());
+    }
+    {
+      Builder b("fever", seed + 12, jitter(72, v, 34, 0.1f), 36.7f);
+      b.hold(60);
+      b.markOnset();
+      b.ramp(jitter(30, v, 35, 0.3f), 88, jitter(39.0f, v, 36, 0.01f));
+      b.hold(30);
+      traces.push_back(b.done());
+    }
+    {
+      // Under the fixed 38.5 C limit all along
+      Builder b("slow temperature rise", seed + 13, jitter(70, v, 37, 0.1f), 36.5f);
+      b.hold(60);
+      b.markOnset();
+      b.ramp(jitter(120, v, 38, 0.2f), 76, jitter(38.1f, v, 39, 0.005f));
+      b.hold(30);
+      traces.push_back(b.done());
+    }
+    {
+      // Under the fixed 120 BPM limit all along
+      Builder b("slow heart rate rise", seed + 14, jitter(66, v, 40, 0.1f), 36.6f);
+      b.hold(60);
+      b.markOnset();
+      b.ramp(jitter(120, v, 41, 0.2f), jitter(104, v, 42, 0.05f), 36.9f);
+      b.hold(30);
+      traces.push_back(b.done());
+    }
+    {
+      // Doubled from an athlete's resting rate, still under 120
+      Builder b("athlete tachycardia", seed + 15, jitter(46, v, 43, 0.05f), 36.4f);
+      b.hold(60);
+      b.markOnset();
+      b.ramp(2, jitter(98, v, 44, 0.05f), 36.5f);
+      b.hold(30);
+      traces.push_back(b.done());
+    }
+  }
+  return traces;
+}
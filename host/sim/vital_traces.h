@@ -0,0 +1,35 @@
+/*
+ * RescueNet AI - Synthetic labeled vital-sign traces
+ *
+ * Hours of readings, one per MONITOR_VITALS_TASK_MS, of heart rate,
+ * temperature and whether the wearer was moving, for people who are
+ * fine (at rest, an athlete, exercise, sleep, motion artifacts) and
+ * people who are not (sudden tachycardia or bradycardia, a fever, a
+ * slow rise in temperature or heart rate that stays under the fixed
+ * thresholds). Shared by anomaly_bench.
+ */
+
+#ifndef HOST_VITAL_TRACES_H
+#define HOST_VITAL_TRACES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define VITAL_TRACE_READING_MS 5000UL
+
+struct VitalTrace {
+  std::string label;
+  bool anomalous;
+  size_t onset;  // First reading of the anomaly
+  std::vector<float> heartRate;
+  std::vector<float> temperature;
+  std::vector<uint8_t> moving;
+};
+
+// Normal traces first, then anomalous ones; `variants` of each with
+// jittered parameters and their own noise
+std::vector<VitalTrace> makeVitalTraces(int variants);
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ * RescueNet AI - HeartRateFusion cycle count on the Nano
+ *
+ * Feeds HeartRateFusion a synthetic 100 Hz pulse with a walking-step
+ * artifact and the matching accelerometer samples, and times every
+ * addMotion() and cancel() call with Timer1 running at the CPU clock, so
+ * one tick is one cycle. Every 5 seconds it prints the min/mean/max
+ * cycles per sample pair against the 160000 cycles a 16 MHz ATmega328
+ * has between two samples, the free RAM and the fused rate.
+ *
+ * The host counterpart (accuracy, no cycle counts) is host/bench/fusion_bench.
+ */
+
+#include <rescuenet.h>
+#include <heart_rate_fusion.h>
+#include <pulse_detector.h>
+
+#define SAMPLE_RATE_HZ 100
+
+const uint32_t CYCLE_BUDGET = F_CPU / SAMPLE_RATE_HZ;
+
+HeartRateFusion fusion;
+PulseDetector detector(SAMPLE_RATE_HZ);
+
+unsigned long nextSampleUs = 0;
+unsigned long lastReport = 0;
+uint32_t sampleIndex = 0;
+uint16_t minCycles = 0xFFFF;
+uint16_t maxCycles = 0;
+uint32_t totalCycles = 0;
+uint16_t samples = 0;
+
+int freeRam() {
+  extern int __heap_start, *__brkval;
+  int v;
+  return (int)&v - (__brkval == 0 ? (int)&__heap_start : (int)__brkval);
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  // Timer1 free-running at clk/1; a sample pair is far below its 65536 tick wrap
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+
+  fusion.setPpgRate(SAMPLE_RATE_HZ);
+  fusion.setMotionRate(SAMPLE_RATE_HZ);
+
+  Serial.print("HeartRateFusion RAM: ");
+  Serial.print(sizeof(HeartRateFusion));
+  Serial.print(" / ");
+  Serial.println(HR_FUSION_RAM_BUDGET);
+  nextSampleUs = micros();
+}
+
+void loop() {
+  if ((long)(micros() - nextSampleUs) < 0) return;
+  nextSampleUs += 1000000UL / SAMPLE_RATE_HZ;
+
+  // 72 BPM pulse, 1.8 Hz steps of +-0.35 g, both in whole samples
+  float t = (float)sampleIndex / SAMPLE_RATE_HZ;
+  sampleIndex++;
+  float step = 0.35f * sin(2 * PI * 1.8f * t);
+  float pulse = fmod(t * 1.2f, 1.0f) < 0.15f ? 1200.0f : 0.0f;
+  ImuSample imu = {0, 0, (int16_t)(IMU_ACCEL_LSB_PER_G * (1.0f + step)), 0, 0, 0};
+  int32_t ir = 80000L + (int32_t)pulse + (int32_t)(3000.0f * step);
+
+  noInterrupts();
+  uint16_t start = TCNT1;
+  fusion.addMotion(imu);
+  int32_t clean = fusion.cancel(ir);
+  uint16_t cycles = TCNT1 - start;
+  interrupts();
+  if (detector.addSample(clean)) fusion.addBeat();
+
+  if (cycles < minCycles) minCycles = cycles;
+  if (cycles > maxCycles) maxCycles = cycles;
+  totalCycles += cycles;
+  samples++;
+
+  if (millis() - lastReport >= 5000) {
+    Serial.print("cycles/sample min ");
+    Serial.print(minCycles);
+    Serial.print(" mean ");
+    Serial.print(totalCycles / samples);
+    Serial.print(" max ");
+    Serial.print(maxCycles);
+    Serial.print(" of ");
+    Serial.print(CYCLE_BUDGET);
+    Serial.print("  free RAM ");
+    Serial.print(freeRam());
+    Serial.print("  HR ");
+    Serial.print(fusion.heartRate(), 1);
+    Serial.print(" (");
+    Serial.print(fusion.confidence());
+    Serial.println("%)");
+
+    minCycles = 0xFFFF;
+    maxCycles = 0;
+    totalCycles = 0;
+    samples = 0;
+    lastReport = millis();
+  }
+}
@@ -0,0 +1,87 @@
+/*
+ * RescueNet AI - PulseDetector cycle count on the Nano
+ *
+ * Samples a pulse sensor on A0 at 100 Hz and times every
+ * PulseDetector::addSample() call with Timer1 running at the CPU clock,
+ * so one tick is one cycle. Every 5 seconds it prints the min/mean/max
+ * cycles per sample against the 160000 cycles a 16 MHz ATmega328 has
+ * between two samples, the free RAM and the current rate.
+ *
+ * The host counterpart (accuracy, no cycle counts) is host/bench/pulse_bench.
+ */
+
+#include <rescuenet.h>
+#include <pulse_detector.h>
+
+#define PULSE_PIN A0
+#define SAMPLE_RATE_HZ 100
+
+const uint32_t CYCLE_BUDGET = F_CPU / SAMPLE_RATE_HZ;
+
+PulseDetector detector(SAMPLE_RATE_HZ);
+
+unsigned long nextSampleUs = 0;
+unsigned long lastReport = 0;
+uint16_t minCycles = 0xFFFF;
+uint16_t maxCycles = 0;
+uint32_t totalCycles = 0;
+uint16_t samples = 0;
+
+int freeRam() {
+  extern int __heap_start, *__brkval;
+  int v;
+  return (int)&v - (__brkval == 0 ? (int)&__heap_start : (int)__brkval);
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  // Timer1 free-running at clk/1; addSample() is far below its 65536 tick wrap
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+
+  Serial.print("PulseDetector RAM: ");
+  Serial.print(sizeof(PulseDetector));
+  Serial.print(" / ");
+  Serial.println(PULSE_DETECTOR_RAM_BUDGET);
+  nextSampleUs = micros();
+}
+
+void loop() {
+  if ((long)(micros() - nextSampleUs) < 0) return;
+  nextSampleUs += 1000000UL / SAMPLE_RATE_HZ;
+
+  int value = analogRead(PULSE_PIN);
+
+  noInterrupts();
+  uint16_t start = TCNT1;
+  detector.addSample(value);
+  uint16_t cycles = TCNT1 - start;
+  interrupts();
+
+  if (cycles < minCycles) minCycles = cycles;
+  if (cycles > maxCycles) maxCycles = cycles;
+  totalCycles += cycles;
+  samples++;
+
+  if (millis() - lastReport >= 5000) {
+    Serial.print("cycles/sample min ");
+    Serial.print(minCycles);
+    Serial.print(" mean ");
+    Serial.print(totalCycles / samples);
+    Serial.print(" max ");
+    Serial.print(maxCycles);
+    Serial.print(" of ");
+    Serial.print(CYCLE_BUDGET);
+    Serial.print("  free RAM ");
+    Serial.print(freeRam());
+    Serial.print("  HR ");
+    Serial.println(detector.bpmTenths() / 10.0, 1);
+
+    minCycles = 0xFFFF;
+    maxCycles = 0;
+    totalCycles = 0;
+    samples = 0;
+    lastReport = millis();
+  }
+}
@@ -0,0 +1,97 @@
+/*
+ * RescueNet AI - SpectralHeartRate timing on the ESP32
+ *
+ * Feeds a synthetic 100 Hz pulse (with a dicrotic notch and some noise)
+ * to PulseDetector and SpectralHeartRate side by side and times every
+ * addSample() call with the CPU cycle counter. Every 5 seconds it prints,
+ * for each, the mean and max cycles per sample and the cycles of the
+ * slowest call against the 2.4 million a 240 MHz core has between two
+ * samples, plus both rates and the spectral quality.
+ *
+ * Build with and without ESP-DSP installed to compare its FFT with the
+ * portable one. The host counterpart (accuracy, latency) is
+ * host/bench/spectral_bench.
+ */
+
+#include <rescuenet.h>
+#include <pulse_detector.h>
+#include <spectral_hr.h>
+
+#define SAMPLE_RATE_HZ 100
+#define PULSE_BPM 84.0f
+
+const uint32_t CYCLE_BUDGET = 240000000UL / SAMPLE_RATE_HZ;
+
+PulseDetector detector(SAMPLE_RATE_HZ);
+SpectralHeartRate spectrum;
+
+struct Timing {
+  uint32_t total;
+  uint32_t max;
+  uint16_t samples;
+
+  void add(uint32_t cycles) {
+    total += cycles;
+    if (cycles > max) max = cycles;
+    samples++;
+  }
+  void print(const char* label) {
+    Serial.print(label);
+    Serial.print(" mean ");
+    Serial.print(samples ? total / samples : 0);
+    Serial.print(" max ");
+    Serial.print(max);
+    total = 0;
+    max = 0;
+    samples = 0;
+  }
+};
+
+Timing beats;
+Timing spectral;
+unsigned long nextSampleUs = 0;
+unsigned long lastReport = 0;
+uint32_t sampleIndex = 0;
+
+void setup() {
+  Serial.begin(115200);
+  spectrum.setSampleRate(SAMPLE_RATE_HZ);
+
+  Serial.print("SpectralHeartRate RAM: ");
+  Serial.println(sizeof(SpectralHeartRate));
+  nextSampleUs = micros();
+}
+
+void loop() {
+  if ((long)(micros() - nextSampleUs) < 0) return;
+  nextSampleUs += 1000000UL / SAMPLE_RATE_HZ;
+
+  float t = (float)sampleIndex / SAMPLE_RATE_HZ;
+  sampleIndex++;
+  float phase = fmodf(t * PULSE_BPM / 60.0f, 1.0f);
+  float pulse = expf(-sq((phase - 0.15f) / 0.06f)) + 0.3f * expf(-sq((phase - 0.45f) / 0.08f));
+  int32_t ir = 80000L - (int32_t)(1500.0f * pulse) + (int32_t)(esp_random() % 201) - 100;
+
+  uint32_t start = ESP.getCycleCount();
+  detector.addSample(ir);
+  uint32_t mid = ESP.getCycleCount();
+  spectrum.addSample(ir);
+  uint32_t end = ESP.getCycleCount();
+  beats.add(mid - start);
+  spectral.add(end - mid);
+
+  if (millis() - lastReport >= 5000) {
+    beats.print("beats cycles/sample");
+    spectral.print("  spectral");
+    Serial.print(" of ");
+    Serial.print(CYCLE_BUDGET);
+    Serial.print("  HR ");
+    Serial.print(detector.bpmTenths() / 10.0f, 1);
+    Serial.print(" / ");
+    Serial.print(spectrum.heartRate(), 1);
+    Serial.print(" (");
+    Serial.print(spectrum.quality());
+    Serial.println("%)");
+    lastReport = millis();
+  }
+}
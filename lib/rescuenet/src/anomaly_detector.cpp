@@ -0,0 +1,138 @@
+/*
+ * RescueNet AI - Personalized vital-sign anomaly detector
+ */
+
+#include "anomaly_detector.h"
+
+#include <math.h>
+
+VitalTracker::VitalTracker(const VitalLimits& limits) : limits(limits) {
+  reset();
+}
+
+void VitalTracker::reset() {
+  mean = (limits.low + limits.high) / 2;
+  spread = 0;
+  previous = mean;
+  cusumHigh = 0;
+  count = 0;
+  run = 0;
+  hardRun = 0;
+  runSide = 0;
+  clearRun = 0;
+  recovery = 0;
+  side = 0;
+  alarmCause = VITAL_CAUSE_NONE;
+}
+
+float VitalTracker::baseline() const {
+  return mean;
+}
+
+float VitalTracker::deviation() const {
+  // The thresholds as the band: the prior spread
+  float prior = (limits.high - limits.low) / (2 * ANOMALY_BAND_SD);
+  float variance = prior * prior;
+  if (learned()) {
+    variance = (variance * ANOMALY_PRIOR_READINGS + spread * count) / (ANOMALY_PRIOR_READINGS + count);
+  }
+  float floor = limits.minSd * limits.minSd;
+  return sqrtf(variance > floor ? variance : floor);
+}
+
+float VitalTracker::lowLimit() const {
+  if (!learned()) return limits.hardLow;
+  float low = mean - ANOMALY_BAND_SD * deviation();
+  return low > limits.hardLow ? low : limits.hardLow;
+}
+
+float VitalTracker::highLimit() const {
+  if (!learned()) return limits.high;
+  float high = mean + ANOMALY_BAND_SD * deviation();
+  return high < limits.hardHigh ? high : limits.hardHigh;
+}
+
+bool VitalTracker::update(float value, bool exertion) {
+  if (exertion) {
+    recovery = ANOMALY_RECOVERY_READINGS;
+  } else if (recovery > 0) {
+    recovery--;
+  }
+  bool exerting = recovery > 0;
+
+  float sd = deviation();
+  float low = lowLimit();
+  float high = exerting ? limits.hardHigh : highLimit();
+  int8_t out = value < low ? -1 : value > high ? 1 : 0;
+  bool hard = value <= limits.hardLow || value >= limits.hardHigh;
+
+  if (learned()) {
+    float z = (value - mean) / sd;
+    if (z > ANOMALY_CUSUM_CLIP_SD) z = ANOMALY_CUSUM_CLIP_SD;
+    if (z < -ANOMALY_CUSUM_CLIP_SD) z = -ANOMALY_CUSUM_CLIP_SD;
+    cusumHigh = exerting ? 0 : cusumHigh + z - ANOMALY_CUSUM_SLACK_SD;
+    if (cusumHigh < 0) cusumHigh = 0;
+  }
+
+  hardRun = hard ? (hardRun < 255 ? hardRun + 1 : 255) : 0;
+
+  if (out != 0 && out == runSide) {
+    if (run < 255) run++;
+  } else {
+    run = out != 0 ? 1 : 0;
+    runSide = out;
+  }
+
+  if (side == 0) {
+    if (hardRun >= ANOMALY_HARD_READINGS) {
+      raise(value <= limits.hardLow ? -1 : 1, VITAL_CAUSE_HARD);
+    } else if (run >= ANOMALY_CONFIRM_READINGS) {
+      raise(runSide, VITAL_CAUSE_BAND);
+    } else if (cusumHigh >= ANOMALY_CUSUM_LIMIT_SD) {
+      raise(1, VITAL_CAUSE_DRIFT);
+    }
+    if (side != 0) return true;
+
+    // Only what looks normal teaches the baseline
+    bool drifting = cusumHigh >= ANOMALY_CUSUM_LIMIT_SD / 2;
+    if (out == 0 && !exerting && !drifting) learn(value);
+    return false;
+  }
+
+  float margin = learned() ? ANOMALY_HYSTERESIS_SD * sd : 0;
+  bool settled = value >= low + margin && value <= high - margin &&
+                 cusumHigh <= ANOMALY_CUSUM_LIMIT_SD / 4;
+  clearRun = settled ? clearRun + 1 : 0;
+  if (clearRun >= ANOMALY_CLEAR_READINGS) {
+    side = 0;
+    alarmCause = VITAL_CAUSE_NONE;
+    clearRun = 0;
+  }
+  return false;
+}
+
+void VitalTracker::raise(int8_t direction, uint8_t why) {
+  side = direction;
+  alarmCause = why;
+  clearRun = 0;
+}
+
+void VitalTracker::learn(float value) {
+  float delta = value - mean;
+  float step = value - previous;
+  previous = value;
+  if (!learned()) {
+    // Welford; the prior mean is forgotten with the first reading
+    count++;
+    mean += delta / count;
+    spread += delta * (value - mean);
+    if (count == ANOMALY_WARMUP_READINGS) spread /= count - 1;
+    return;
+  }
+  if (count < 0xFFFF) count++;
+  const float alpha = 1.0f / ANOMALY_BASELINE_READINGS;
+  mean += alpha * delta;
+  // From successive differences, half their square: a slow drift the
+  // mean lags behind does not widen the band
+  spread += alpha * (step * step / 2 - spread);
+}
@@ -0,0 +1,123 @@
+/*
+ * RescueNet AI - Personalized vital-sign anomaly detector
+ *
+ * Replaces the fixed per-reading thresholds with a baseline learned from
+ * the wearer. Each vital has a VitalTracker, updated once per reading in
+ * constant time and a few dozen bytes:
+ *
+ *   baseline  Welford mean and variance over the first
+ *             ANOMALY_WARMUP_READINGS, then EWMAs with a time constant
+ *             of ANOMALY_BASELINE_READINGS of the mean and of the
+ *             variance of successive differences, which a slow drift
+ *             does not inflate. The configured
+ *             thresholds are the prior: their spread is worth
+ *             ANOMALY_PRIOR_READINGS readings, so the band starts as wide
+ *             as the thresholds and narrows to the wearer's own.
+ *   band      baseline +- ANOMALY_BAND_SD standard deviations, floored at
+ *             the vital's minSd and never beyond its hard limits. It
+ *             fires after ANOMALY_CONFIRM_READINGS in a row on one side,
+ *             so a single bad reading is not an alarm.
+ *   drift     upward CUSUM of the standardized readings, clipped at
+ *             ANOMALY_CUSUM_CLIP_SD, against the baseline with
+ *             ANOMALY_CUSUM_SLACK_SD slack, firing at
+ *             ANOMALY_CUSUM_LIMIT_SD: a slow rise that stays inside the
+ *             band still adds up, a lone spike does not. Slow falls are
+ *             what falling asleep looks like and are left to the band.
+ *   hard      ANOMALY_HARD_READINGS in a row at or beyond a hard limit
+ *             fire, warmed up or not. While warming up the band is the
+ *             configured high threshold over the hard low limit: the
+ *             wearer's level is not known yet, and a resting heart rate
+ *             of 45 is an athlete's as often as a patient's.
+ *
+ * The baseline stops learning while a reading is out of band, the CUSUM
+ * is half way to firing or an alarm is up, so what it is meant to catch
+ * is never learned as normal. An alarm clears after
+ * ANOMALY_CLEAR_READINGS inside the band narrowed by
+ * ANOMALY_HYSTERESIS_SD, with the CUSUM back down.
+ *
+ * Exertion (the wearer is moving) lifts the upper limit to the hard one
+ * and holds the upward CUSUM, for ANOMALY_RECOVERY_READINGS after the
+ * movement stops as well: a heart rate of 130 on a run, or the warmer
+ * skin after it, is not a deviation from the resting baseline.
+ */
+
+#ifndef RESCUENET_ANOMALY_DETECTOR_H
+#define RESCUENET_ANOMALY_DETECTOR_H
+
+#include <Arduino.h>
+
+#ifndef ANOMALY_WARMUP_READINGS
+#define ANOMALY_WARMUP_READINGS 60  // 5 minutes at one reading per 5 s
+#endif
+#ifndef ANOMALY_BASELINE_READINGS
+#define ANOMALY_BASELINE_READINGS 1440  // Two hours
+#endif
+#ifndef ANOMALY_PRIOR_READINGS
+#define ANOMALY_PRIOR_READINGS 120
+#endif
+#define ANOMALY_BAND_SD 4.0f
+#define ANOMALY_CONFIRM_READINGS 3
+#define ANOMALY_HARD_READINGS 2
+#define ANOMALY_CLEAR_READINGS 3
+#define ANOMALY_HYSTERESIS_SD 0.5f
+#define ANOMALY_CUSUM_SLACK_SD 2.5f
+#define ANOMALY_CUSUM_LIMIT_SD 10.0f
+#define ANOMALY_CUSUM_CLIP_SD 4.0f
+#define ANOMALY_RECOVERY_READINGS 120  // 10 minutes
+
+struct VitalLimits {
+  float low;       // Configured thresholds: the band until one is learned
+  float high;
+  float hardLow;   // Fires within ANOMALY_HARD_READINGS, learned band or not
+  float hardHigh;
+  float minSd;     // Floor of the learned standard deviation
+};
+
+enum VitalCause {
+  VITAL_CAUSE_NONE,
+  VITAL_CAUSE_HARD,
+  VITAL_CAUSE_BAND,
+  VITAL_CAUSE_DRIFT
+};
+
+class VitalTracker {
+public:
+  // limits is kept by reference: a constant that outlives the tracker
+  explicit VitalTracker(const VitalLimits& limits);
+
+  void reset();
+  // One reading; true on the reading that raises an alarm
+  bool update(float value, bool exertion = false);
+
+  bool alarmed() const { return side != 0; }
+  // -1 low, +1 high, 0 none
+  int8_t alarmSide() const { return side; }
+  VitalCause cause() const { return (VitalCause)alarmCause; }
+  bool learned() const { return count >= ANOMALY_WARMUP_READINGS; }
+
+  float baseline() const;
+  float deviation() const;
+  // The band a reading is judged against now
+  float lowLimit() const;
+  float highLimit() const;
+
+private:
+  void learn(float value);
+  void raise(int8_t direction, uint8_t why);
+
+  const VitalLimits& limits;
+  float mean;
+  float spread;    // Welford sum of squares while warming up, then the variance
+  float previous;  // Last reading learned
+  float cusumHigh;
+  uint16_t count;    // Readings learned, saturating
+  uint8_t run;       // Readings in a row out of band on runSide
+  int8_t runSide;
+  uint8_t hardRun;   // Readings in a row at a hard limit
+  uint8_t clearRun;  // Readings in a row back inside while alarmed
+  uint8_t recovery;  // Readings of exertion hold left
+  int8_t side;
+  uint8_t alarmCause;
+};
+
+#endif
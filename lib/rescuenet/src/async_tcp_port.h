@@ -0,0 +1,281 @@
+/*
+ * RescueNet AI - TcpServerPort over AsyncTCP
+ *
+ * The ESP32 transport for http_server.h. AsyncTCP calls back on its own
+ * task as connections open, data arrives and peers go away; this keeps
+ * what it hears in a slot per connection, under a spinlock, for the
+ * server to pick up in poll() on the network loop. Writes go straight to
+ * the client: flash data is queued by reference, everything else copied,
+ * and never more than the send window has room for.
+ *
+ * A request larger than ASYNC_TCP_RX_BYTES closes the connection; the
+ * server reads requests of a few hundred bytes. AsyncTcpClient is the
+ * outgoing side, for mqtt_client.h, built the same way. Header only; the
+ * host build never includes it.
+ */
+
+#ifndef RESCUENET_ASYNC_TCP_PORT_H
+#define RESCUENET_ASYNC_TCP_PORT_H
+
+#include <AsyncTCP.h>
+
+#include "hal.h"
+#include "http_server.h"
+
+#ifndef ASYNC_TCP_RX_BYTES
+#define ASYNC_TCP_RX_BYTES 1024
+#endif
+#ifndef ASYNC_CLIENT_RX_BYTES
+#define ASYNC_CLIENT_RX_BYTES 1024
+#endif
+
+class AsyncTcpPort : public TcpServerPort {
+public:
+  explicit AsyncTcpPort(uint16_t port) : server(port), lock(portMUX_INITIALIZER_UNLOCKED) {
+    for (uint8_t i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+      slots[i].port = this;
+      slots[i].client = nullptr;
+      slots[i].state = FREE;
+    }
+  }
+
+  void begin() {
+    server.onClient([](void* arg, AsyncClient* client) { ((AsyncTcpPort*)arg)->opened(client); }, this);
+    server.setNoDelay(true);
+    server.begin();
+  }
+
+  int accept() override {
+    int id = -1;
+    portENTER_CRITICAL(&lock);
+    for (uint8_t i = 0; i < HTTP_MAX_CONNECTIONS && id < 0; i++) {
+      if (slots[i].state == PENDING) {
+        slots[i].state = OPEN;
+        id = i;
+      }
+    }
+    portEXIT_CRITICAL(&lock);
+    return id;
+  }
+
+  int read(uint8_t connection, uint8_t* out, size_t length) override {
+    Slot& slot = slots[connection];
+    int n = 0;
+    portENTER_CRITICAL(&lock);
+    if (slot.state != OPEN) {
+      n = -1;
+    } else {
+      while ((size_t)n < length && slot.count) {
+        out[n++] = slot.rx[slot.head];
+        slot.head = (slot.head + 1) % ASYNC_TCP_RX_BYTES;
+        slot.count--;
+      }
+    }
+    portEXIT_CRITICAL(&lock);
+    return n;
+  }
+
+  size_t write(uint8_t connection, const uint8_t* data, size_t length, bool stable) override {
+    AsyncClient* client = openClient(connection);
+    if (!client || !client->canSend()) return 0;
+    size_t n = client->space();
+    if (n > length) n = length;
+    if (n == 0) return 0;
+    n = client->add((const char*)data, n, stable ? 0 : ASYNC_WRITE_FLAG_COPY);
+    client->send();
+    return n;
+  }
+
+  void close(uint8_t connection) override {
+    Slot& slot = slots[connection];
+    AsyncClient* client = nullptr;
+    portENTER_CRITICAL(&lock);
+    if (slot.state == OPEN && slot.client) {
+      // Freed when AsyncTCP reports the disconnect
+      slot.state = CLOSING;
+      client = slot.client;
+    } else if (slot.state == GONE) {
+      slot.state = FREE;
+    }
+    portEXIT_CRITICAL(&lock);
+    if (client) client->close(true);
+  }
+
+private:
+  enum SlotState { FREE, PENDING, OPEN, CLOSING, GONE };
+
+  struct Slot {
+    AsyncTcpPort* port;
+    AsyncClient* client;
+    volatile uint8_t state;
+    uint16_t head;
+    uint16_t count;
+    uint8_t rx[ASYNC_TCP_RX_BYTES];
+  };
+
+  AsyncClient* openClient(uint8_t connection) {
+    portENTER_CRITICAL(&lock);
+    AsyncClient* client = slots[connection].state == OPEN ? slots[connection].client : nullptr;
+    portEXIT_CRITICAL(&lock);
+    return client;
+  }
+
+  // On the AsyncTCP task from here on
+  void opened(AsyncClient* client) {
+    Slot* slot = nullptr;
+    portENTER_CRITICAL(&lock);
+    for (uint8_t i = 0; i < HTTP_MAX_CONNECTIONS && !slot; i++) {
+      if (slots[i].state == FREE) {
+        slot = &slots[i];
+        slot->client = client;
+        slot->head = 0;
+        slot->count = 0;
+        slot->state = PENDING;
+      }
+    }
+    portEXIT_CRITICAL(&lock);
+    if (!slot) {
+      client->onDisconnect([](void*, AsyncClient* c) { delete c; }, nullptr);
+      client->close(true);
+      return;
+    }
+    client->setNoDelay(true);
+    client->onData([](void* arg, AsyncClient*, void* data, size_t length) {
+      Slot* s = (Slot*)arg;
+      s->port->received(*s, (const uint8_t*)data, length);
+    }, slot);
+    client->onDisconnect([](void* arg, AsyncClient* c) {
+      Slot* s = (Slot*)arg;
+      s->port->closed(*s);
+      delete c;
+    }, slot);
+  }
+
+  void received(Slot& slot, const uint8_t* data, size_t length) {
+    bool overflow = false;
+    portENTER_CRITICAL(&lock);
+    if (slot.count + length > ASYNC_TCP_RX_BYTES) {
+      overflow = true;
+    } else {
+      for (size_t i = 0; i < length; i++) {
+        slot.rx[(slot.head + slot.count) % ASYNC_TCP_RX_BYTES] = data[i];
+        slot.count++;
+      }
+    }
+    portEXIT_CRITICAL(&lock);
+    if (overflow) slot.client->close(true);
+  }
+
+  void closed(Slot& slot) {
+    portENTER_CRITICAL(&lock);
+    slot.client = nullptr;
+    // The server hears of an open connection going through read()
+    slot.state = slot.state == OPEN ? GONE : FREE;
+    portEXIT_CRITICAL(&lock);
+  }
+
+  AsyncServer server;
+  portMUX_TYPE lock;
+  Slot slots[HTTP_MAX_CONNECTIONS];
+};
+
+class AsyncTcpClient : public TcpClientPort {
+public:
+  AsyncTcpClient() : client(nullptr), state(TCP_CLOSED), head(0), count(0), lock(portMUX_INITIALIZER_UNLOCKED) {}
+
+  bool connect(const char* host, uint16_t port) override {
+    close();
+    AsyncClient* c = new AsyncClient();
+    if (!c) return false;
+    head = 0;
+    count = 0;
+    state = TCP_CONNECTING;
+    client = c;
+    c->setNoDelay(true);
+    c->onConnect([](void* arg, AsyncClient* which) { ((AsyncTcpClient*)arg)->opened(which); }, this);
+    c->onData([](void* arg, AsyncClient*, void* data, size_t length) {
+      ((AsyncTcpClient*)arg)->received((const uint8_t*)data, length);
+    }, this);
+    c->onDisconnect([](void* arg, AsyncClient* gone) { ((AsyncTcpClient*)arg)->closed(gone); }, this);
+    // The lookup runs on the lwIP task; the result comes as onConnect or onDisconnect
+    if (!c->connect(host, port)) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  uint8_t status() override { return state; }
+
+  int read(uint8_t* out, size_t length) override {
+    int n = 0;
+    portENTER_CRITICAL(&lock);
+    while ((size_t)n < length && count) {
+      out[n++] = rx[head];
+      head = (head + 1) % ASYNC_CLIENT_RX_BYTES;
+      count--;
+    }
+    portEXIT_CRITICAL(&lock);
+    return n;
+  }
+
+  size_t write(const uint8_t* data, size_t length) override {
+    AsyncClient* c = client;
+    if (state != TCP_CONNECTED || !c || !c->canSend()) return 0;
+    size_t n = c->space();
+    if (n > length) n = length;
+    if (n == 0) return 0;
+    n = c->add((const char*)data, n, ASYNC_WRITE_FLAG_COPY);
+    c->send();
+    return n;
+  }
+
+  void close() override {
+    portENTER_CRITICAL(&lock);
+    AsyncClient* c = client;
+    client = nullptr;
+    state = TCP_CLOSED;
+    portEXIT_CRITICAL(&lock);
+    // Deleted when AsyncTCP reports the disconnect
+    if (c) c->close(true);
+  }
+
+private:
+  // On the AsyncTCP task; a client closed since is ignored
+  void opened(AsyncClient* c) {
+    portENTER_CRITICAL(&lock);
+    if (client == c) state = TCP_CONNECTED;
+    portEXIT_CRITICAL(&lock);
+  }
+
+  void received(const uint8_t* data, size_t length) {
+    bool overflow = false;
+    portENTER_CRITICAL(&lock);
+    if (count + length > ASYNC_CLIENT_RX_BYTES) {
+      overflow = true;
+    } else {
+      for (size_t i = 0; i < length; i++) rx[(head + count++) % ASYNC_CLIENT_RX_BYTES] = data[i];
+    }
+    portEXIT_CRITICAL(&lock);
+    if (overflow) close();
+  }
+
+  void closed(AsyncClient* gone) {
+    portENTER_CRITICAL(&lock);
+    if (client == gone) {
+      client = nullptr;
+      state = TCP_CLOSED;
+    }
+    portEXIT_CRITICAL(&lock);
+    delete gone;
+  }
+
+  AsyncClient* volatile client;
+  volatile uint8_t state;
+  uint16_t head;
+  uint16_t count;
+  uint8_t rx[ASYNC_CLIENT_RX_BYTES];
+  portMUX_TYPE lock;
+};
+
+#endif
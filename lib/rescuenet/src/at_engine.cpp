@@ -0,0 +1,204 @@
+/*
+ * RescueNet AI - Asynchronous AT command engine
+ */
+
+#include "at_engine.h"
+
+#include <stdlib.h>
+
+namespace {
+
+const uint8_t CTRL_Z = 26;
+const uint8_t ESC = 27;
+
+// Unsolicited lines that do not start with '+'
+const char* const PLAIN_URCS[] = {"RING", "Call Ready", "SMS Ready", "RDY", "NORMAL POWER DOWN",
+                                  "UNDER-VOLTAGE", "OVER-VOLTAGE"};
+const uint8_t PLAIN_URC_COUNT = sizeof(PLAIN_URCS) / sizeof(PLAIN_URCS[0]);
+
+// Final results other than OK that end a command unsuccessfully
+const char* const ERROR_RESULTS[] = {"ERROR", "NO CARRIER", "BUSY", "NO ANSWER", "NO DIALTONE"};
+const uint8_t ERROR_RESULT_COUNT = sizeof(ERROR_RESULTS) / sizeof(ERROR_RESULTS[0]);
+
+bool startsWith(const char* text, const char* prefix) {
+  return strncmp(text, prefix, strlen(prefix)) == 0;
+}
+
+bool plainUrc(const char* text) {
+  for (uint8_t i = 0; i < PLAIN_URC_COUNT; i++) {
+    if (startsWith(text, PLAIN_URCS[i])) return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+AtEngine::AtEngine(SerialPort& port)
+  : port(port), head(0), count(0), active(false), awaitingPrompt(false), sentAt(0), timeoutMs(0),
+    lineLength(0), lineCut(false), urcHandler(nullptr), urcContext(nullptr) {
+  prefix[0] = '\0';
+  info[0] = '\0';
+  resetStats();
+}
+
+void AtEngine::resetStats() {
+  memset(&counters, 0, sizeof(counters));
+}
+
+bool AtEngine::send(const char* command, AtCallback done, void* context, uint32_t timeoutMs) {
+  return enqueue(command, nullptr, timeoutMs, timeoutMs, done, context);
+}
+
+bool AtEngine::sendWithPayload(const char* command, const char* payload, uint32_t promptTimeoutMs,
+                               uint32_t resultTimeoutMs, AtCallback done, void* context) {
+  return enqueue(command, payload ? payload : "", promptTimeoutMs, resultTimeoutMs, done, context);
+}
+
+bool AtEngine::enqueue(const char* command, const char* payload, uint32_t timeoutMs, uint32_t resultTimeoutMs,
+                       AtCallback done, void* context) {
+  if (count >= AT_QUEUE_DEPTH || strlen(command) >= AT_COMMAND_MAX) {
+    counters.rejected++;
+    return false;
+  }
+  Command& cmd = queue[(head + count) % AT_QUEUE_DEPTH];
+  strcpy(cmd.text, command);
+  cmd.payload = payload;
+  cmd.timeoutMs = timeoutMs;
+  cmd.resultTimeoutMs = resultTimeoutMs;
+  cmd.done = done;
+  cmd.context = context;
+  count++;
+  if (!active) start();
+  return true;
+}
+
+void AtEngine::start() {
+  Command& cmd = queue[head];
+  // "AT+CSQ" answers with "+CSQ: ..."; plain commands have no prefix
+  uint8_t length = 0;
+  if (cmd.text[2] == '+') {
+    for (const char* p = cmd.text + 2; *p && *p != '=' && *p != '?' && length < AT_PREFIX_MAX - 1; p++) {
+      prefix[length++] = *p;
+    }
+  }
+  prefix[length] = '\0';
+
+  active = true;
+  awaitingPrompt = cmd.payload != nullptr;
+  timeoutMs = cmd.timeoutMs;
+  sentAt = millis();
+  port.println(cmd.text);
+}
+
+void AtEngine::poll() {
+  while (port.available() > 0) {
+    int c = port.read();
+    if (c < 0) break;
+    feed((char)c);
+  }
+
+  if (active && millis() - sentAt >= timeoutMs) {
+    if (awaitingPrompt) port.write(ESC);  // Leave the prompt if it shows up late
+    finish(AT_TIMEOUT, -1);
+  }
+  if (!active && count) start();
+}
+
+void AtEngine::feed(char c) {
+  if (c == '\r' || c == '\n') {
+    if (lineLength) handleLine();
+    lineLength = 0;
+    lineCut = false;
+    return;
+  }
+
+  // The prompt is "> " with no line ending after it
+  if (c == '>' && lineLength == 0 && awaitingPrompt) {
+    const Command& cmd = queue[head];
+    awaitingPrompt = false;
+    port.print(cmd.payload);
+    port.write(CTRL_Z);
+    // The result timeout runs from the submission; latency still counts from the command
+    timeoutMs = (millis() - sentAt) + cmd.resultTimeoutMs;
+    return;
+  }
+
+  if (lineLength < AT_LINE_MAX - 1) {
+    line[lineLength++] = c;
+  } else if (!lineCut) {
+    lineCut = true;
+    counters.longLines++;
+  }
+}
+
+void AtEngine::handleLine() {
+  line[lineLength] = '\0';
+  const char* text = line;
+  while (*text == ' ') text++;  // Left over after a prompt
+  if (!*text) return;
+
+  if (active) {
+    if (strcmp(text, queue[head].text) == 0) return;  // Echo (ATE1)
+
+    if (strcmp(text, "OK") == 0) {
+      finish(AT_OK, -1);
+      return;
+    }
+    for (uint8_t i = 0; i < ERROR_RESULT_COUNT; i++) {
+      if (strcmp(text, ERROR_RESULTS[i]) == 0) {
+        finish(AT_ERROR, -1);
+        return;
+      }
+    }
+    if (startsWith(text, "+CME ERROR:") || startsWith(text, "+CMS ERROR:")) {
+      finish(AT_ERROR, (int16_t)atoi(text + 11));
+      return;
+    }
+
+    bool response = prefix[0] ? startsWith(text, prefix) : (text[0] != '+' && !plainUrc(text));
+    if (response) {
+      if (!info[0]) {
+        strncpy(info, text, AT_INFO_MAX - 1);
+        info[AT_INFO_MAX - 1] = '\0';
+      }
+      return;
+    }
+  } else if (strcmp(text, "OK") == 0 || strcmp(text, "ERROR") == 0) {
+    return;  // Late answer to a command that already timed out
+  }
+
+  counters.urcs++;
+  if (urcHandler) urcHandler(text, urcContext);
+}
+
+void AtEngine::finish(AtStatus status, int16_t errorCode) {
+  Command& cmd = queue[head];
+  AtCallback done = cmd.done;
+  void* context = cmd.context;
+  uint32_t latency = active ? millis() - sentAt : 0;
+
+  active = false;
+  awaitingPrompt = false;
+  head = (head + 1) % AT_QUEUE_DEPTH;
+  count--;
+
+  if (status != AT_ABORTED) {
+    counters.commands++;
+    if (status == AT_OK) counters.ok++;
+    if (status == AT_ERROR) counters.errors++;
+    if (status == AT_TIMEOUT) counters.timeouts++;
+    counters.latencyTotalMs += latency;
+    if (latency > counters.latencyMaxMs) counters.latencyMaxMs = latency;
+  }
+
+  // The callback may queue (and so start) the next command
+  AtResult result = {status, errorCode, info, latency};
+  if (done) done(result, context);
+  info[0] = '\0';
+}
+
+void AtEngine::clear() {
+  for (uint8_t pending = count; pending > 0 && count > 0; pending--) finish(AT_ABORTED, -1);
+  lineLength = 0;
+  lineCut = false;
+}
@@ -0,0 +1,145 @@
+/*
+ * RescueNet AI - Asynchronous AT command engine
+ *
+ * Talks to a Hayes-style modem (SIM800L) over the SerialPort HAL without
+ * ever waiting. Commands go into a small fixed queue and are written one
+ * at a time; poll() feeds received bytes through an incremental line
+ * parser and completes the active command on its final result (OK,
+ * ERROR, +CME/+CMS ERROR) or its timeout, through a callback.
+ *
+ * Received lines are sorted as they arrive:
+ *   - the echo of the active command is dropped
+ *   - lines starting with the command's own prefix ("+CSQ" for
+ *     "AT+CSQ") are its information response; the first one is passed
+ *     to the callback
+ *   - any other "+XXX:" line, RING, "Call Ready" and the like are
+ *     unsolicited result codes and go to the URC handler, also while a
+ *     command is waiting, so they are never mistaken for its answer
+ *   - a '>' at the start of a line while a payload command is waiting
+ *     is the prompt: the payload and Ctrl+Z are written right away
+ *
+ * Latency (command written to final result) and result counts are kept
+ * in AtStats.
+ */
+
+#ifndef RESCUENET_AT_ENGINE_H
+#define RESCUENET_AT_ENGINE_H
+
+#include "hal.h"
+
+#ifndef AT_QUEUE_DEPTH
+#if defined(__AVR__)
+#define AT_QUEUE_DEPTH 2
+#else
+#define AT_QUEUE_DEPTH 4
+#endif
+#endif
+
+#ifndef AT_LINE_MAX
+#if defined(__AVR__)
+#define AT_LINE_MAX 48
+#else
+#define AT_LINE_MAX 96
+#endif
+#endif
+
+#define AT_COMMAND_MAX 40   // Command text, e.g. AT+CMGS="+911234567890"
+#define AT_INFO_MAX 40      // First information line kept for the callback
+#define AT_PREFIX_MAX 8     // "+CMGS" and friends
+#define AT_DEFAULT_TIMEOUT_MS 1000
+
+enum AtStatus {
+  AT_OK,
+  AT_ERROR,    // ERROR, +CME ERROR, +CMS ERROR, NO CARRIER, ...
+  AT_TIMEOUT,
+  AT_ABORTED   // Dropped by clear()
+};
+
+struct AtResult {
+  AtStatus status;
+  int16_t errorCode;   // Number from +CME/+CMS ERROR, -1 otherwise
+  const char* info;    // First information line, "" when there was none
+  uint32_t latencyMs;  // From writing the command to the final result
+};
+
+typedef void (*AtCallback)(const AtResult& result, void* context);
+typedef void (*UrcHandler)(const char* line, void* context);
+
+struct AtStats {
+  uint32_t commands;      // Completed, whatever the outcome
+  uint32_t ok;
+  uint32_t errors;
+  uint32_t timeouts;
+  uint32_t rejected;      // send() with a full queue or an oversized command
+  uint32_t urcs;
+  uint32_t longLines;     // Lines cut at AT_LINE_MAX
+  uint32_t latencyTotalMs;
+  uint32_t latencyMaxMs;
+};
+
+class AtEngine {
+public:
+  explicit AtEngine(SerialPort& port);
+
+  // Queues a command line (no CR/LF); false when the queue is full
+  bool send(const char* command, AtCallback done = nullptr, void* context = nullptr,
+            uint32_t timeoutMs = AT_DEFAULT_TIMEOUT_MS);
+  // Command that answers with a '>' prompt (AT+CMGS): payload and Ctrl+Z go
+  // out on the prompt, then the final result may take resultTimeoutMs.
+  // payload must stay valid until the callback runs.
+  bool sendWithPayload(const char* command, const char* payload, uint32_t promptTimeoutMs,
+                       uint32_t resultTimeoutMs, AtCallback done = nullptr, void* context = nullptr);
+
+  void onUrc(UrcHandler handler, void* context) {
+    urcHandler = handler;
+    urcContext = context;
+  }
+
+  // Reads whatever has arrived, completes and starts commands
+  void poll();
+  // Drops the active and queued commands (modem reset); callbacks get AT_ABORTED
+  void clear();
+
+  bool idle() const { return count == 0; }
+  uint8_t queued() const { return count; }
+  const AtStats& stats() const { return counters; }
+  void resetStats();
+
+private:
+  struct Command {
+    char text[AT_COMMAND_MAX];
+    const char* payload;
+    uint32_t timeoutMs;
+    uint32_t resultTimeoutMs;
+    AtCallback done;
+    void* context;
+  };
+
+  bool enqueue(const char* command, const char* payload, uint32_t timeoutMs, uint32_t resultTimeoutMs,
+               AtCallback done, void* context);
+  void start();
+  void feed(char c);
+  void handleLine();
+  void finish(AtStatus status, int16_t errorCode);
+
+  SerialPort& port;
+  Command queue[AT_QUEUE_DEPTH];  // queue[head] is the active one once started
+  uint8_t head;
+  uint8_t count;
+  bool active;
+  bool awaitingPrompt;
+  unsigned long sentAt;
+  unsigned long timeoutMs;
+  char prefix[AT_PREFIX_MAX];
+  char info[AT_INFO_MAX];
+
+  char line[AT_LINE_MAX];
+  uint8_t lineLength;
+  bool lineCut;
+
+  UrcHandler urcHandler;
+  void* urcContext;
+  AtStats counters;
+};
+
+#endif
@@ -0,0 +1,29 @@
+/*
+ * RescueNet AI - CRC-16/CCITT-FALSE
+ *
+ * Polynomial 0x1021, initial value 0xFFFF, no reflection; the check
+ * value of "123456789" is 0x29B1. Computed bit by bit, which costs no
+ * table in RAM or flash and is quick enough for records of a few dozen
+ * bytes. Pass the previous result as crc to continue over several
+ * pieces.
+ */
+
+#ifndef RESCUENET_CRC16_H
+#define RESCUENET_CRC16_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CRC16_INIT 0xFFFF
+
+inline uint16_t crc16Ccitt(const uint8_t* data, size_t length, uint16_t crc = CRC16_INIT) {
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+#endif
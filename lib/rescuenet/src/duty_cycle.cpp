@@ -0,0 +1,175 @@
+/*
+ * RescueNet AI - Adaptive sampling and duty cycling
+ */
+
+#include "duty_cycle.h"
+
+#include "telemetry.h"
+#include "telemetry_uploader.h"
+
+#include <string.h>
+
+namespace {
+
+// Indexed by policy, then level
+const DutyProfile PROFILES[3][2] = {
+  // POWER_FIXED: the old schedule at both levels
+  {{5000, 400, 4, 1, UPLOAD_BATCH_SAMPLES, UPLOAD_MAX_AGE_MS, false},
+   {5000, 400, 4, 1, UPLOAD_BATCH_SAMPLES, UPLOAD_MAX_AGE_MS, false}},
+  // POWER_ADAPTIVE
+  {{2000, 400, 4, 1, 4, 10000, true},
+   {15000, 200, 4, 10, UPLOAD_BATCH_SAMPLES, 60000, true}},
+  // POWER_SAVER
+  {{5000, 400, 4, 1, 6, 30000, true},
+   {30000, 200, 4, 10, UPLOAD_BATCH_SAMPLES, 120000, true}},
+};
+
+// LiPo discharge curve at light load
+const uint16_t CELL_MV[] = {4200, 4150, 4110, 4020, 3950, 3870, 3840, 3800, 3770, 3730, 3690, 3610, 3270};
+const uint8_t CELL_PERCENT[] = {100, 95, 90, 80, 70, 60, 50, 40, 30, 20, 10, 5, 0};
+
+float absolute(float value) {
+  return value < 0 ? -value : value;
+}
+
+}  // namespace
+
+const PowerModel ESP32_POWER_MODEL = {30.0f, 2.0f, 100.0f, 45.0f, 0.6f, 5.26f, 3.8f, 750.0f};
+
+const DutyProfile& dutyProfile(PowerPolicy policy, ActivityLevel level) {
+  if (policy > POWER_SAVER) policy = POWER_FIXED;
+  return PROFILES[policy][level];
+}
+
+PowerPolicy choosePolicy(uint8_t batteryLevel, PowerPolicy current) {
+  if (batteryLevel == TELEMETRY_BATTERY_UNKNOWN) return POWER_FIXED;
+  if (current == POWER_SAVER) {
+    return batteryLevel >= DUTY_SAVER_BELOW + DUTY_HYSTERESIS ? POWER_ADAPTIVE : POWER_SAVER;
+  }
+  return batteryLevel < DUTY_SAVER_BELOW ? POWER_SAVER : POWER_ADAPTIVE;
+}
+
+uint8_t batteryPercent(uint16_t millivolts) {
+  if (millivolts >= CELL_MV[0]) return 100;
+  for (uint8_t i = 1; i < sizeof(CELL_MV) / sizeof(CELL_MV[0]); i++) {
+    if (millivolts >= CELL_MV[i]) {
+      uint16_t span = CELL_MV[i - 1] - CELL_MV[i];
+      return (uint8_t)(CELL_PERCENT[i] +
+                       (uint32_t)(millivolts - CELL_MV[i]) * (CELL_PERCENT[i - 1] - CELL_PERCENT[i]) / span);
+    }
+  }
+  return 0;
+}
+
+float chargeMah(const PowerLedger& ledger, const PowerModel& model) {
+  uint32_t awakeMs = ledger.elapsedMs > ledger.sleepMs ? ledger.elapsedMs - ledger.sleepMs : 0;
+  float maMs = model.awakeMa * awakeMs + model.sleepMa * ledger.sleepMs + model.radioMa * ledger.radioMs +
+               model.wakeMaMs * ledger.wakeups + (model.ppgMa + model.imuMa) * ledger.elapsedMs +
+               model.ppgMaMsPerConversion * ledger.ppgConversions +
+               model.tempMaMsPerConversion * ledger.readings;
+  return maMs / 3600000.0f;
+}
+
+DutyCycle::DutyCycle()
+  : configured(POWER_FIXED), current(POWER_FIXED), activity(ACTIVITY_ACTIVE), calmSinceMs(0),
+    baselineHr(0), baselineTemp(0), lastMotion(0), lastMoving(0), primed(false) {
+#if POWER_LEDGER_ENABLED
+  accountedMs = 0;
+  conversionRemainder = 0;
+  memset(&counters, 0, sizeof(counters));
+#endif
+}
+
+void DutyCycle::begin(uint8_t policy, uint32_t nowMs) {
+  configured = policy;
+  current = policy == POWER_AUTO ? POWER_FIXED : (PowerPolicy)policy;
+  activity = ACTIVITY_ACTIVE;
+  calmSinceMs = nowMs;
+  primed = false;
+#if POWER_LEDGER_ENABLED
+  resetLedger(nowMs);
+#endif
+}
+
+bool DutyCycle::update(const DutyInputs& in, uint8_t batteryLevel, uint32_t nowMs) {
+#if POWER_LEDGER_ENABLED
+  account(nowMs);
+  counters.readings++;
+#endif
+  bool changed = false;
+  if (configured == POWER_AUTO) {
+    PowerPolicy chosen = choosePolicy(batteryLevel, current);
+    if (chosen != current) {
+      current = chosen;
+      changed = true;
+    }
+  }
+
+  bool trigger = in.emergency || in.nearLimit;
+  uint32_t motion = in.motionSamples - lastMotion;
+  uint32_t moving = in.movingSamples - lastMoving;
+  if (primed && motion > 0 && moving * 100 > motion * DUTY_MOVING_PERCENT) trigger = true;
+  if (in.heartRate > 0) {
+    if (baselineHr > 0 && absolute(in.heartRate - baselineHr) > DUTY_HR_DELTA) trigger = true;
+    // Follows slow drift, so only a change stands out
+    baselineHr = baselineHr > 0 ? baselineHr + (in.heartRate - baselineHr) / 4 : in.heartRate;
+  }
+  if (primed && absolute(in.temperature - baselineTemp) > DUTY_TEMP_DELTA) trigger = true;
+  baselineTemp = primed ? baselineTemp + (in.temperature - baselineTemp) / 4 : in.temperature;
+  lastMotion = in.motionSamples;
+  lastMoving = in.movingSamples;
+  primed = true;
+
+  if (trigger) {
+    calmSinceMs = nowMs;
+    return setLevel(ACTIVITY_ACTIVE, nowMs) || changed;
+  }
+  if (nowMs - calmSinceMs >= DUTY_CALM_MS) return setLevel(ACTIVITY_STABLE, nowMs) || changed;
+  return changed;
+}
+
+bool DutyCycle::poke(uint32_t nowMs) {
+  calmSinceMs = nowMs;
+  return setLevel(ACTIVITY_ACTIVE, nowMs);
+}
+
+bool DutyCycle::setLevel(ActivityLevel next, uint32_t nowMs) {
+  if (next == activity) return false;
+#if POWER_LEDGER_ENABLED
+  account(nowMs);
+  counters.switches++;
+#else
+  (void)nowMs;
+#endif
+  activity = next;
+  return true;
+}
+
+#if POWER_LEDGER_ENABLED
+void DutyCycle::idle(uint32_t ms) {
+  if (!profile().lightSleep || ms < DUTY_SLEEP_MIN_MS) return;
+  counters.sleepMs += ms;
+  counters.wakeups++;
+}
+
+void DutyCycle::account(uint32_t nowMs) {
+  uint32_t elapsed = nowMs - accountedMs;
+  accountedMs = nowMs;
+  counters.elapsedMs += elapsed;
+  if (activity == ACTIVITY_STABLE) counters.stableMs += elapsed;
+  uint32_t milli = elapsed * profile().ppgRateHz + conversionRemainder;
+  counters.ppgConversions += milli / 1000;
+  conversionRemainder = milli % 1000;
+}
+
+const PowerLedger& DutyCycle::ledger(uint32_t nowMs) {
+  account(nowMs);
+  return counters;
+}
+
+void DutyCycle::resetLedger(uint32_t nowMs) {
+  memset(&counters, 0, sizeof(counters));
+  accountedMs = nowMs;
+  conversionRemainder = 0;
+}
+#endif
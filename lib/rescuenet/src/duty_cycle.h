@@ -0,0 +1,177 @@
+/*
+ * RescueNet AI - Adaptive sampling and duty cycling
+ *
+ * Instead of fixed periods the monitor runs at one of two activity
+ * levels, each with a DutyProfile of sample, poll and upload rates:
+ *
+ *   active  something is changing: motion, a heart rate or temperature
+ *           away from its recent baseline or near an alert threshold,
+ *           an emergency, the button or a dashboard message
+ *   stable  DUTY_CALM_MS without any of that: the PPG samples slower,
+ *           sensor FIFOs are drained and other polls run pollStretch
+ *           times less often, readings and uploads are further apart,
+ *           and the idle time is spent in light sleep
+ *
+ * The power policy picks the profiles: POWER_FIXED is the old fixed
+ * schedule with nothing asleep, POWER_ADAPTIVE and POWER_SAVER switch
+ * between the levels, the saver with longer stable intervals.
+ * POWER_AUTO chooses from the battery level, with hysteresis, and stays
+ * fixed while the level is unknown (no battery sense, USB power).
+ *
+ * PowerLedger counts what costs charge, where there is RAM for it
+ * (POWER_LEDGER_ENABLED): time awake and in light sleep, wake-ups, PPG
+ * and temperature conversions and time inside HTTP requests. chargeMah()
+ * turns it into charge with a PowerModel of supply currents;
+ * ESP32_POWER_MODEL is the ESP32 board's, from the datasheets.
+ */
+
+#ifndef RESCUENET_DUTY_CYCLE_H
+#define RESCUENET_DUTY_CYCLE_H
+
+#include <Arduino.h>
+
+// Readings without a trigger before the monitor calls the wearer stable
+#ifndef DUTY_CALM_MS
+#define DUTY_CALM_MS 60000UL
+#endif
+// Triggers, against the running baseline of each reading
+#define DUTY_HR_DELTA 10.0f     // BPM
+#define DUTY_TEMP_DELTA 0.3f    // C
+#define DUTY_MOVING_PERCENT 10  // Of the IMU samples since the last reading
+// Within these of an alert threshold counts as a trigger too
+#define DUTY_HR_MARGIN 10.0f
+#define DUTY_TEMP_MARGIN 0.5f
+// Shorter idle periods are not worth a light sleep
+#define DUTY_SLEEP_MIN_MS 5
+// POWER_AUTO: saver below this battery level, back above it plus the hysteresis
+#define DUTY_SAVER_BELOW 30
+#define DUTY_HYSTERESIS 5
+
+enum PowerPolicy {
+  POWER_FIXED,
+  POWER_ADAPTIVE,
+  POWER_SAVER,
+  POWER_AUTO  // Configuration only: one of the above by battery level
+};
+
+enum ActivityLevel {
+  ACTIVITY_ACTIVE,
+  ACTIVITY_STABLE
+};
+
+struct DutyProfile {
+  uint32_t vitalsMs;     // Between readings
+  uint16_t ppgRateHz;    // ADC rate; the output rate is ppgRateHz / ppgAveraging
+  uint8_t ppgAveraging;
+  uint8_t pollStretch;   // Multiplies the drain, button, alarm, channel and modem periods
+  uint8_t uploadBatch;   // Capped at UPLOAD_BATCH_SAMPLES
+  uint32_t uploadAgeMs;
+  bool lightSleep;
+};
+
+struct DutyInputs {
+  float heartRate;         // 0 while there is no beat
+  float temperature;
+  uint32_t motionSamples;  // IMU samples processed so far
+  uint32_t movingSamples;  // ... of which moving (MotionStats)
+  bool nearLimit;          // A reading close to an alert threshold
+  bool emergency;
+};
+
+// PowerLedger and its accounting: 40 bytes the Nano goes without, as
+// there is no PowerModel of its board to turn them into charge
+#ifndef POWER_LEDGER_ENABLED
+#if defined(__AVR__)
+#define POWER_LEDGER_ENABLED 0
+#else
+#define POWER_LEDGER_ENABLED 1
+#endif
+#endif
+
+struct PowerLedger {
+  uint32_t elapsedMs;
+  uint32_t sleepMs;         // In light sleep; the rest is awake
+  uint32_t wakeups;         // Light sleep exits
+  uint32_t stableMs;        // At ACTIVITY_STABLE
+  uint32_t ppgConversions;  // ADC samples, one LED pulse pair each
+  uint32_t readings;        // One temperature conversion each
+  uint32_t radioMs;         // Inside HTTP requests
+  uint32_t switches;        // Activity level changes
+};
+
+// Supply currents in mA; per-event costs in mA*ms
+struct PowerModel {
+  float awakeMa;        // CPU running or idling, WiFi in modem sleep
+  float sleepMa;        // Light sleep with WiFi associated
+  float radioMa;        // On top of awake during a request
+  float wakeMaMs;       // Each wake-up: clocks, the I2C drains
+  float ppgMa;          // Front end powered
+  float ppgMaMsPerConversion;
+  float imuMa;          // Accel and gyro at any rate
+  float tempMaMsPerConversion;
+};
+
+// ESP32 at 80 MHz, MAX30102 at 6.4 mA LEDs and 411 us pulses, MPU6050,
+// DS18B20 (12 bit, 750 ms)
+extern const PowerModel ESP32_POWER_MODEL;
+
+const DutyProfile& dutyProfile(PowerPolicy policy, ActivityLevel level);
+// POWER_AUTO's choice for a battery level, given the current policy
+PowerPolicy choosePolicy(uint8_t batteryLevel, PowerPolicy current);
+// Single-cell LiPo voltage to charge in %
+uint8_t batteryPercent(uint16_t millivolts);
+float chargeMah(const PowerLedger& ledger, const PowerModel& model);
+
+class DutyCycle {
+public:
+  DutyCycle();
+
+  // policy may be POWER_AUTO
+  void begin(uint8_t policy, uint32_t nowMs);
+  // One reading; true when the profile changed (level or policy)
+  bool update(const DutyInputs& in, uint8_t batteryLevel, uint32_t nowMs);
+  // Button, dashboard message: active now; true when that changed the level
+  bool poke(uint32_t nowMs);
+#if POWER_LEDGER_ENABLED
+  // Idle time of the loop, spent in light sleep when the profile allows
+  void idle(uint32_t ms);
+  void addRadio(uint32_t ms) { counters.radioMs += ms; }
+#else
+  void idle(uint32_t) {}
+  void addRadio(uint32_t) {}
+#endif
+
+  PowerPolicy policy() const { return current; }
+  ActivityLevel level() const { return activity; }
+  const DutyProfile& profile() const { return dutyProfile(current, activity); }
+
+#if POWER_LEDGER_ENABLED
+  // Counts up to nowMs
+  const PowerLedger& ledger(uint32_t nowMs);
+  void resetLedger(uint32_t nowMs);
+#endif
+
+private:
+#if POWER_LEDGER_ENABLED
+  void account(uint32_t nowMs);
+#endif
+  bool setLevel(ActivityLevel next, uint32_t nowMs);
+
+  uint8_t configured;
+  PowerPolicy current;
+  ActivityLevel activity;
+  uint32_t calmSinceMs;
+  float baselineHr;
+  float baselineTemp;
+  uint32_t lastMotion;
+  uint32_t lastMoving;
+  bool primed;
+
+#if POWER_LEDGER_ENABLED
+  uint32_t accountedMs;
+  uint32_t conversionRemainder;  // ppgConversions * 1000 not yet counted
+  PowerLedger counters;
+#endif
+};
+
+#endif
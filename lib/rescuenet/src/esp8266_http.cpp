@@ -0,0 +1,470 @@
+/*
+ * RescueNet AI - HTTP over an ESP8266 (ESP-01) AT firmware link
+ */
+
+#include "esp8266_http.h"
+
+namespace {
+
+// Answers the module may give, one after the other in flash
+const char PROMPT[] PROGMEM = ">\0ERROR\0link is not valid\0CLOSED";
+const char SENT[] PROGMEM = "SEND OK\0SEND FAIL\0ERROR\0CLOSED";
+const char CONNECTED[] PROGMEM = "OK\0ALREADY CONNECTED\0ERROR\0CLOSED";
+const char RESULT[] PROGMEM = "OK\0ERROR\0FAIL";
+const char REPLY[] PROGMEM = "+IPD,\0CLOSED";
+const char READY[] PROGMEM = "ready";
+const char CLOSED[] PROGMEM = "CLOSED";
+const char FAILED[] PROGMEM = "ERROR";
+
+// The request's fixed pieces
+const char POST_LINE[] PROGMEM = "POST ";
+const char HOST_HEADER[] PROGMEM = " HTTP/1.1\r\nHost: ";
+const char PORT_SEPARATOR[] PROGMEM = ":";
+const char TYPE_HEADER[] PROGMEM = "\r\nContent-Type: ";
+const char LENGTH_HEADER[] PROGMEM = "\r\nContent-Length: ";
+const char HEADERS_END[] PROGMEM = "\r\nConnection: keep-alive\r\n\r\n";
+
+// scan() while none of the expected answers has come in, and once it is too late
+const int8_t SCAN_WAITING = -1;
+const int8_t SCAN_TIMEOUT = -2;
+
+// "POST ", url, ..., "\r\n\r\n", body
+const uint8_t PIECE_COUNT = 12;
+
+// Decimal text without the heap; returns the length
+uint8_t formatDecimal(uint32_t value, char* out) {
+  char digits[10];
+  uint8_t count = 0;
+  do {
+    digits[count++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value);
+  for (uint8_t i = 0; i < count; i++) out[i] = digits[count - 1 - i];
+  out[count] = '\0';
+  return count;
+}
+
+}  // namespace
+
+Esp8266Http::Esp8266Http(SerialPort& port, const char* serverIp, const char* serverPort)
+  : port(port), serverIp(serverIp), serverPort(serverPort), linkUp(false), step(STEP_IDLE), attempt(0),
+    url(nullptr), contentType(nullptr), body(nullptr), length(0), total(0), sent(0), segment(0), segmentLeft(0),
+    pieceIndex(0), pieceOffset(0), result(-1), tokens(nullptr), tokenCount(0), waitStart(0), waitMs(0),
+    frameLeft(0), frameStage(0) {
+  lengthText[0] = '\0';
+  memset(tokenStart, 0, sizeof(tokenStart));
+  memset(matched, 0, sizeof(matched));
+#if ESP8266_STATS
+  startedMs = 0;
+  commandsBefore = 0;
+  resetStats();
+#endif
+}
+
+bool Esp8266Http::begin(const char* ssid, const char* password) {
+  LOG_PORT.println("Initializing ESP8266...");
+
+  // Reset ESP8266
+  command(PSTR("AT+RST"));
+  waitFor(READY, 1, ESP8266_CONNECT_TIMEOUT_MS);
+  linkUp = false;
+
+  // Set to station mode, one connection at a time
+  command(PSTR("AT+CWMODE=1"));
+  waitFor(RESULT, 3, ESP8266_COMMAND_TIMEOUT_MS);
+  command(PSTR("AT+CIPMUX=0"));
+  waitFor(RESULT, 3, ESP8266_COMMAND_TIMEOUT_MS);
+
+  // Connect to WiFi
+  port.printFlash(PSTR("AT+CWJAP=\""));
+  port.print(ssid);
+  port.printFlash(PSTR("\",\""));
+  port.print(password);
+  port.printFlash(PSTR("\"\r\n"));
+#if ESP8266_STATS
+  counters.atCommands++;
+#endif
+  return waitFor(RESULT, 3, ESP8266_JOIN_TIMEOUT_MS) == 0;
+}
+
+void Esp8266Http::command(const char* text) {
+  port.printFlash(text);
+  port.printFlash(PSTR("\r\n"));
+#if ESP8266_STATS
+  counters.atCommands++;
+#endif
+}
+
+void Esp8266Http::expect(const char* list, uint8_t count, unsigned long timeoutMs) {
+  tokens = list;
+  tokenCount = count > 4 ? 4 : count;
+  uint8_t start = 0;
+  for (uint8_t i = 0; i < tokenCount; i++) {
+    tokenStart[i] = start;
+    start += (uint8_t)(strlen_P(list + start) + 1);
+  }
+  memset(matched, 0, sizeof(matched));
+  waitStart = millis();
+  waitMs = (uint16_t)timeoutMs;
+}
+
+int8_t Esp8266Http::scan() {
+  while (port.available() > 0) {
+    int c = port.read();
+    if (c < 0) break;
+    for (uint8_t i = 0; i < tokenCount; i++) {
+      const char* token = tokens + tokenStart[i];
+      if (c == (char)pgm_read_byte(token + matched[i])) {
+        if (pgm_read_byte(token + ++matched[i]) == '\0') return (int8_t)i;
+      } else {
+        matched[i] = (c == (char)pgm_read_byte(token)) ? 1 : 0;
+      }
+    }
+  }
+  return millis() - waitStart >= waitMs ? SCAN_TIMEOUT : SCAN_WAITING;
+}
+
+int8_t Esp8266Http::waitFor(const char* list, uint8_t count, unsigned long timeoutMs) {
+  expect(list, count, timeoutMs);
+  for (;;) {
+    int8_t found = scan();
+    if (found != SCAN_WAITING) return found >= 0 ? found : -1;
+    delay(1);
+  }
+}
+
+void Esp8266Http::drain() {
+  if (port.available() > 0 && waitFor(CLOSED, 1, 0) == 0) linkUp = false;
+}
+
+void Esp8266Http::disconnect() {
+  if (!linkUp || busy()) return;
+  command(PSTR("AT+CIPCLOSE"));
+  waitFor(RESULT, 3, ESP8266_COMMAND_TIMEOUT_MS);
+  linkUp = false;
+}
+
+int Esp8266Http::post(const char* url, const char* contentType, const char* body, size_t length) {
+  // A stepped request goes first; pollPost() still gets its status
+  int held = busy() ? complete() : HTTP_PENDING;
+  int status = startPost(url, contentType, body, length);
+  if (status == HTTP_PENDING) status = complete();
+  if (held != HTTP_PENDING) {
+    result = held;
+    step = STEP_DONE;
+  }
+  return status;
+}
+
+int Esp8266Http::complete() {
+  int status;
+  while ((status = pollPost()) == HTTP_PENDING) delay(1);
+  return status;
+}
+
+int Esp8266Http::startPost(const char* requestUrl, const char* type, const char* requestBody, size_t requestLength) {
+  if (busy()) return -1;
+#if ESP8266_STATS
+  startedMs = millis();
+  commandsBefore = counters.atCommands;
+  counters.requests++;
+#endif
+  drain();
+
+  url = requestUrl;
+  contentType = type;
+  body = requestBody;
+  length = requestLength;
+  formatDecimal((uint32_t)length, lengthText);
+  total = 0;
+  for (uint8_t i = 0; i < PIECE_COUNT; i++) {
+    size_t size;
+    bool flash;
+    piece(i, size, flash);
+    total += size;
+  }
+  sent = 0;
+  pieceIndex = 0;
+  pieceOffset = 0;
+  attempt = 0;
+  if (linkUp) {
+    startSegment();
+  } else {
+    startConnect();
+  }
+#if ESP8266_STATS
+  timeStep(startedMs);
+#endif
+  return HTTP_PENDING;
+}
+
+int Esp8266Http::pollPost() {
+#if ESP8266_STATS
+  unsigned long start = millis();
+  int status = advance();
+  timeStep(start);
+  return status;
+#else
+  return advance();
+#endif
+}
+
+#if ESP8266_STATS
+void Esp8266Http::timeStep(unsigned long start) {
+  unsigned long elapsed = millis() - start;
+  if (elapsed > counters.stepMsMax) counters.stepMsMax = elapsed > 0xFFFF ? 0xFFFF : (uint16_t)elapsed;
+}
+#endif
+
+int Esp8266Http::advance() {
+  int8_t found = SCAN_WAITING;
+  if (step != STEP_IDLE && step != STEP_DONE && step != STEP_WRITING && step != STEP_STATUS) {
+    found = scan();
+    if (found == SCAN_WAITING) return HTTP_PENDING;
+  }
+
+  switch (step) {
+    case STEP_IDLE:
+      return -1;
+
+    case STEP_DONE:
+      step = STEP_IDLE;
+      return result;
+
+    case STEP_CLOSING:
+      linkUp = false;
+      startConnect();
+      return HTTP_PENDING;
+
+    case STEP_CONNECTING:
+      linkUp = found == 0 || found == 1;
+      if (!linkUp) {
+        LOG_PORT.println("TCP connection failed");
+        return retry();
+      }
+#if ESP8266_STATS
+      counters.connects++;
+#endif
+      startSegment();
+      return HTTP_PENDING;
+
+    case STEP_PROMPT:
+      if (found == 0) {
+        segmentLeft = segment;
+        step = STEP_WRITING;
+        return HTTP_PENDING;
+      }
+      linkUp = false;
+      // "CLOSED" / "link is not valid" come ahead of the ERROR that ends
+      // the command; let it pass so it does not fail the reconnect
+      if (found >= 2) {
+        expect(FAILED, 1, ESP8266_COMMAND_TIMEOUT_MS);
+        step = STEP_REFUSED;
+        return HTTP_PENDING;
+      }
+      return retry();
+
+    case STEP_REFUSED:
+      return retry();
+
+    case STEP_WRITING:
+      writeSegment();
+      if (segmentLeft == 0) {
+        expect(SENT, 4, ESP8266_RESPONSE_TIMEOUT_MS);
+        step = STEP_SENT;
+      }
+      return HTTP_PENDING;
+
+    case STEP_SENT:
+      if (found != 0) {
+        linkUp = false;
+        return retry();
+      }
+      sent += segment;
+#if ESP8266_STATS
+      counters.bytesSent += segment;
+#endif
+      if (sent < total) {
+        startSegment();
+      } else {
+        // +IPD,<length>:HTTP/1.1 <status> ...
+        expect(REPLY, 2, ESP8266_RESPONSE_TIMEOUT_MS);
+        step = STEP_REPLY;
+      }
+      return HTTP_PENDING;
+
+    case STEP_REPLY:
+      if (found != 0) {
+        linkUp = false;
+        return retry();
+      }
+      frameLeft = 0;
+      frameStage = 0;
+      result = 0;
+      waitStart = millis();
+      step = STEP_STATUS;
+      return HTTP_PENDING;
+
+    case STEP_STATUS:
+      if (!readStatus()) return HTTP_PENDING;
+      return result > 0 ? finish(result) : retry();
+  }
+  return -1;
+}
+
+void Esp8266Http::startConnect() {
+  port.printFlash(PSTR("AT+CIPSTART=\"TCP\",\""));
+  port.print(serverIp);
+  port.printFlash(PSTR("\","));
+  port.print(serverPort);
+  port.printFlash(PSTR("\r\n"));
+#if ESP8266_STATS
+  counters.atCommands++;
+#endif
+  expect(CONNECTED, 4, ESP8266_CONNECT_TIMEOUT_MS);
+  step = STEP_CONNECTING;
+}
+
+void Esp8266Http::startSegment() {
+  segment = total - sent < ESP8266_SEND_CHUNK ? total - sent : ESP8266_SEND_CHUNK;
+  char segmentText[11];
+  formatDecimal((uint32_t)segment, segmentText);
+  port.printFlash(PSTR("AT+CIPSEND="));
+  port.print(segmentText);
+  port.printFlash(PSTR("\r\n"));
+#if ESP8266_STATS
+  counters.atCommands++;
+#endif
+  expect(PROMPT, 4, ESP8266_COMMAND_TIMEOUT_MS);
+  step = STEP_PROMPT;
+}
+
+void Esp8266Http::writeSegment() {
+  size_t budget = ESP8266_WRITE_STEP;
+  while (segmentLeft > 0 && budget > 0) {
+    size_t size;
+    bool flash;
+    const char* text = piece(pieceIndex, size, flash);
+    if (pieceOffset == size) {
+      pieceIndex++;
+      pieceOffset = 0;
+      continue;
+    }
+    size_t n = size - pieceOffset;
+    if (n > segmentLeft) n = segmentLeft;
+    if (n > budget) n = budget;
+    if (flash) {
+      port.writeFlash(text + pieceOffset, n);
+    } else {
+      port.write((const uint8_t*)text + pieceOffset, n);
+    }
+    pieceOffset += n;
+    segmentLeft -= n;
+    budget -= n;
+  }
+}
+
+const char* Esp8266Http::piece(uint8_t index, size_t& size, bool& flash) const {
+  const char* text;
+  // The fixed pieces are the even ones
+  flash = index < PIECE_COUNT - 1 && index % 2 == 0;
+  switch (index) {
+    case 0: text = POST_LINE; break;
+    case 1: text = url; break;
+    case 2: text = HOST_HEADER; break;
+    case 3: text = serverIp; break;
+    case 4: text = PORT_SEPARATOR; break;
+    case 5: text = serverPort; break;
+    case 6: text = TYPE_HEADER; break;
+    case 7: text = contentType; break;
+    case 8: text = LENGTH_HEADER; break;
+    case 9: text = lengthText; break;
+    case 10: text = HEADERS_END; break;
+    default:
+      size = length;
+      return body;
+  }
+  size = flash ? strlen_P(text) : strlen(text);
+  return text;
+}
+
+bool Esp8266Http::readStatus() {
+  // Frame length, then "HTTP/1.1 ", then the status digits
+  while (frameStage < 3 && port.available() > 0) {
+    int c = port.read();
+    if (frameStage == 0) {
+      if (c == ':') {
+        frameStage = 1;
+      } else {
+        frameLeft = (uint16_t)(frameLeft * 10 + (c - '0'));
+      }
+      continue;
+    }
+    frameLeft--;
+    if (frameStage == 1 && c == ' ') {
+      frameStage = 2;
+    } else if (frameStage == 2 && c >= '0' && c <= '9') {
+      result = result * 10 + (c - '0');
+    } else if (frameStage == 2) {
+      frameStage = 3;
+    }
+    // The rest of the frame is of no interest
+    if (frameLeft == 0) frameStage = 3;
+  }
+  if (frameStage < 3 && millis() - waitStart < ESP8266_RESPONSE_TIMEOUT_MS) return false;
+
+  // Skip what is left of this frame; later frames go at the next drain()
+  while (frameLeft > 0 && port.available() > 0) {
+    port.read();
+    frameLeft--;
+  }
+  if (result <= 0) result = -1;
+  return true;
+}
+
+int Esp8266Http::retry() {
+  // A connection the server dropped since the last post is reopened and
+  // the request sent once more
+  if (attempt > 0) return finish(-1);
+  attempt++;
+#if ESP8266_STATS
+  counters.reconnects++;
+#endif
+  sent = 0;
+  pieceIndex = 0;
+  pieceOffset = 0;
+  if (linkUp) {
+    command(PSTR("AT+CIPCLOSE"));
+    expect(RESULT, 3, ESP8266_COMMAND_TIMEOUT_MS);
+    step = STEP_CLOSING;
+  } else {
+    startConnect();
+  }
+  return HTTP_PENDING;
+}
+
+int Esp8266Http::finish(int status) {
+  step = STEP_IDLE;
+  if (status > 0) {
+    LOG_PORT.println("Data sent successfully");
+  } else {
+    LOG_PORT.println("Failed to send data");
+  }
+
+#if ESP8266_STATS
+  if (status <= 0) counters.failures++;
+  uint32_t elapsed = millis() - startedMs;
+  counters.lastRequestMs = elapsed;
+  counters.requestMsTotal += elapsed;
+  if (elapsed > counters.requestMsMax) counters.requestMsMax = elapsed;
+  counters.lastAtCommands = (uint16_t)(counters.atCommands - commandsBefore);
+#endif
+  return status;
+}
+
+#if ESP8266_STATS
+uint32_t Esp8266Http::bytesPerSecond() const {
+  if (counters.requestMsTotal == 0) return 0;
+  return (uint32_t)((float)counters.bytesSent * 1000.0f / (float)counters.requestMsTotal);
+}
+#endif
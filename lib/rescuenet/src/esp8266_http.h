@@ -0,0 +1,174 @@
+/*
+ * RescueNet AI - HTTP over an ESP8266 (ESP-01) AT firmware link
+ *
+ * Used by the Nano build, which has no TCP/IP stack of its own. One TCP
+ * connection is opened with AT+CIPSTART and kept for every later post
+ * ("Connection: keep-alive"); a post that finds it gone or broken closes
+ * it, reconnects and tries once more.
+ *
+ * The request is never assembled in RAM. Its length is worked out from
+ * the pieces (request line, headers, body), then it is written straight
+ * from those pieces, the fixed ones in flash like the AT commands and
+ * the answers looked for, in AT+CIPSEND segments of at most
+ * ESP8266_SEND_CHUNK bytes. Every wait ends on the module's answer
+ * (">", SEND OK, +IPD) instead of a fixed delay; the status code is read
+ * from the server's reply.
+ *
+ * startPost() only begins a request: each pollPost() then takes one
+ * step of it, an AT command or ESP8266_WRITE_STEP bytes of a segment or
+ * what the module has answered so far, the way AtEngine drives the
+ * SIM800L. The Nano's loop keeps draining its sensor FIFOs while the
+ * server takes its time. post() runs the same steps back to back, after
+ * finishing a stepped request first.
+ */
+
+#ifndef RESCUENET_ESP8266_HTTP_H
+#define RESCUENET_ESP8266_HTTP_H
+
+#include "hal.h"
+
+// Bytes per AT+CIPSEND; the AT firmware accepts up to 2048
+#ifndef ESP8266_SEND_CHUNK
+#define ESP8266_SEND_CHUNK 512
+#endif
+
+// Bytes of a segment per pollPost(); SoftwareSerial sends them before
+// it returns, 33 ms at 9600 baud
+#ifndef ESP8266_WRITE_STEP
+#define ESP8266_WRITE_STEP 32
+#endif
+
+#define ESP8266_COMMAND_TIMEOUT_MS 2000
+#define ESP8266_CONNECT_TIMEOUT_MS 5000
+#define ESP8266_JOIN_TIMEOUT_MS 15000
+#define ESP8266_RESPONSE_TIMEOUT_MS 5000
+
+// Request, command and timing counters: 48 bytes the Nano goes without
+#ifndef ESP8266_STATS
+#if defined(__AVR__)
+#define ESP8266_STATS 0
+#else
+#define ESP8266_STATS 1
+#endif
+#endif
+
+struct Esp8266Stats {
+  uint32_t requests;
+  uint32_t failures;
+  uint32_t connects;       // AT+CIPSTART that succeeded
+  uint32_t reconnects;     // Posts that had to reopen a broken connection
+  uint32_t atCommands;
+  uint32_t bytesSent;      // HTTP bytes handed to AT+CIPSEND
+  uint32_t requestMsTotal;  // From the start of a post to its status
+  uint32_t requestMsMax;
+  uint32_t lastRequestMs;
+  uint16_t lastAtCommands;  // AT round trips of the last post
+  uint16_t stepMsMax;       // Longest startPost()/pollPost(), what the loop waits at most
+};
+
+class Esp8266Http : public HttpPort {
+public:
+  Esp8266Http(SerialPort& port, const char* serverIp, const char* serverPort);
+
+  // Resets the module and joins the access point; waits for each answer
+  bool begin(const char* ssid, const char* password);
+
+  // url is the request path, e.g. "/api/health-data"
+  int post(const char* url, const char* contentType, const char* body, size_t length) override;
+  // One request at a time: -1 while another is under way
+  int startPost(const char* url, const char* contentType, const char* body, size_t length) override;
+  int pollPost() override;
+
+  bool connected() const { return linkUp; }
+  bool busy() const { return step != STEP_IDLE; }
+  // Waits for the module; not while a request is under way
+  void disconnect();
+
+#if ESP8266_STATS
+  const Esp8266Stats& stats() const { return counters; }
+  void resetStats() { memset(&counters, 0, sizeof(counters)); }
+  // HTTP bytes per second of request time
+  uint32_t bytesPerSecond() const;
+#endif
+
+private:
+  enum Step : uint8_t {
+    STEP_IDLE,
+    STEP_CLOSING,     // AT+CIPCLOSE ahead of a reconnect
+    STEP_CONNECTING,  // AT+CIPSTART
+    STEP_PROMPT,      // AT+CIPSEND, waiting for ">"
+    STEP_REFUSED,     // The ERROR that ends a refused AT+CIPSEND
+    STEP_WRITING,     // The segment, ESP8266_WRITE_STEP bytes a call
+    STEP_SENT,        // SEND OK
+    STEP_REPLY,       // +IPD
+    STEP_STATUS,      // The status line of the reply
+    STEP_DONE         // A status pollPost() has not collected
+  };
+
+  int advance();
+  void startConnect();
+  void startSegment();
+  void writeSegment();
+  bool readStatus();
+  // A second attempt over a new connection, or the end with -1
+  int retry();
+  int finish(int status);
+#if ESP8266_STATS
+  void timeStep(unsigned long start);
+#endif
+  // Steps a request through to its status
+  int complete();
+  // The request's pieces in order: request line, headers, body; the
+  // fixed ones are in flash
+  const char* piece(uint8_t index, size_t& size, bool& flash) const;
+
+  // text in flash (PSTR())
+  void command(const char* text);
+  // Expected answers, count of them back to back in flash: scan()
+  // reports which one came in, if any
+  void expect(const char* tokens, uint8_t count, unsigned long timeoutMs);
+  int8_t scan();
+  // Scans until one of the tokens shows up; its index, or -1 on timeout
+  int8_t waitFor(const char* tokens, uint8_t count, unsigned long timeoutMs);
+  // Drops leftovers of earlier replies, noticing a closed connection
+  void drain();
+
+  SerialPort& port;
+  const char* serverIp;
+  const char* serverPort;
+  bool linkUp;
+
+  // The request under way
+  Step step;
+  uint8_t attempt;
+  const char* url;
+  const char* contentType;
+  const char* body;
+  size_t length;
+  char lengthText[11];
+  size_t total;
+  size_t sent;
+  size_t segment;
+  size_t segmentLeft;
+  uint8_t pieceIndex;
+  size_t pieceOffset;
+  int result;
+
+  // Answer scan, and the reply's frame as it is read
+  const char* tokens;
+  uint8_t tokenCount;
+  uint8_t tokenStart[4];
+  uint8_t matched[4];
+  unsigned long waitStart;
+  uint16_t waitMs;     // The timeouts above fit
+  uint16_t frameLeft;  // +IPD frames are at most 2048 bytes
+  uint8_t frameStage;  // 0: frame length, 1: protocol, 2: status digits, 3: done
+
+#if ESP8266_STATS
+  unsigned long startedMs;
+  uint32_t commandsBefore;
+  Esp8266Stats counters;
+#endif
+};
+
+#endif
@@ -0,0 +1,175 @@
+/*
+ * RescueNet AI - Multi-stage fall detector
+ */
+
+#include "fall_detector.h"
+
+#include <string.h>
+
+namespace {
+
+// Gravity tracker while idle: 1/64 per sample, ~0.6 s at 100 Hz
+const uint8_t GRAVITY_SHIFT = 6;
+
+constexpr uint32_t squaredCounts(uint32_t gX10) {
+  return (gX10 * IMU_ACCEL_LSB_PER_G / 10) * (gX10 * IMU_ACCEL_LSB_PER_G / 10);
+}
+
+// Thresholds in squared counts
+const uint32_t FREE_FALL_SQUARED = squaredCounts(FALL_FREE_FALL_G_X10);
+const uint32_t IMPACT_SQUARED = squaredCounts(FALL_IMPACT_G_X10);
+const uint32_t STILL_LOW_SQUARED = squaredCounts(10 - FALL_STILL_BAND_G_X10);
+const uint32_t STILL_HIGH_SQUARED = squaredCounts(10 + FALL_STILL_BAND_G_X10);
+const uint32_t GYRO_STILL = (uint32_t)FALL_STILL_DPS * IMU_GYRO_LSB_PER_DPS_X10 / 10;
+const uint32_t GYRO_STILL_SQUARED = GYRO_STILL * GYRO_STILL;
+
+uint16_t msToSamples(uint32_t ms, uint16_t sampleRateHz) {
+  uint32_t samples = ms * sampleRateHz / 1000;
+  return samples ? (uint16_t)samples : 1;
+}
+
+}  // namespace
+
+FallDetector::FallDetector(uint16_t sampleRateHz) {
+  setSampleRate(sampleRateHz);
+  reset();
+}
+
+void FallDetector::setSampleRate(uint16_t sampleRateHz) {
+  freeFallSamples = msToSamples(FALL_FREE_FALL_MS, sampleRateHz);
+  impactWindow = msToSamples(FALL_IMPACT_WINDOW_MS, sampleRateHz);
+  settleSamples = msToSamples(FALL_SETTLE_MS, sampleRateHz);
+  inactivitySamples = msToSamples(FALL_INACTIVITY_MS, sampleRateHz);
+  activeLimit = (uint16_t)((uint32_t)inactivitySamples * FALL_ACTIVE_PERCENT / 100);
+}
+
+void FallDetector::reset() {
+  current = FALL_IDLE;
+  stateSamples = 0;
+  lowCount = 0;
+  activeCount = 0;
+  sinceImpact = 0;
+  lastConfirmDelay = 0;
+  memset(gravityQ4, 0, sizeof(gravityQ4));
+  memset(before, 0, sizeof(before));
+  memset(lyingSum, 0, sizeof(lyingSum));
+  primed = false;
+#if FALL_STATS
+  memset(&counters, 0, sizeof(counters));
+#endif
+}
+
+void FallDetector::enter(FallState next) {
+  current = next;
+  stateSamples = 0;
+}
+
+bool FallDetector::isStill(const ImuSample& sample) const {
+  uint32_t accel = (uint32_t)((int32_t)sample.ax * sample.ax) + (uint32_t)((int32_t)sample.ay * sample.ay) +
+                   (uint32_t)((int32_t)sample.az * sample.az);
+  uint32_t gyro = (uint32_t)((int32_t)sample.gx * sample.gx) + (uint32_t)((int32_t)sample.gy * sample.gy) +
+                  (uint32_t)((int32_t)sample.gz * sample.gz);
+  return accel > STILL_LOW_SQUARED && accel < STILL_HIGH_SQUARED && gyro < GYRO_STILL_SQUARED;
+}
+
+bool FallDetector::addSample(const ImuSample& sample) {
+  uint32_t accel = (uint32_t)((int32_t)sample.ax * sample.ax) + (uint32_t)((int32_t)sample.ay * sample.ay) +
+                   (uint32_t)((int32_t)sample.az * sample.az);
+  if (sinceImpact < 0xFFFF) sinceImpact++;
+  stateSamples++;
+
+  switch (current) {
+    case FALL_IDLE: {
+      int32_t axis[3] = {sample.ax, sample.ay, sample.az};
+      for (uint8_t i = 0; i < 3; i++) {
+        int32_t q4 = axis[i] * 16;
+        if (!primed) gravityQ4[i] = q4;
+        gravityQ4[i] += (q4 - gravityQ4[i]) >> GRAVITY_SHIFT;
+      }
+      primed = true;
+
+      lowCount = accel < FREE_FALL_SQUARED ? lowCount + 1 : 0;
+      if (lowCount >= freeFallSamples) {
+#if FALL_STATS
+        counters.freeFalls++;
+#endif
+        for (uint8_t i = 0; i < 3; i++) before[i] = (int16_t)(gravityQ4[i] >> 4);
+        lowCount = 0;
+        enter(FALL_FREE_FALL);
+      }
+      break;
+    }
+
+    case FALL_FREE_FALL:
+      if (accel > IMPACT_SQUARED) {
+#if FALL_STATS
+        counters.impacts++;
+#endif
+        sinceImpact = 0;
+        enter(FALL_SETTLING);
+      } else if (stateSamples > impactWindow) {
+#if FALL_STATS
+        counters.noImpact++;
+#endif
+        enter(FALL_IDLE);
+      }
+      break;
+
+    case FALL_SETTLING:
+      if (stateSamples >= settleSamples) {
+        memset(lyingSum, 0, sizeof(lyingSum));
+        activeCount = 0;
+        enter(FALL_INACTIVITY);
+      }
+      break;
+
+    case FALL_INACTIVITY: {
+      uint32_t gyro = (uint32_t)((int32_t)sample.gx * sample.gx) + (uint32_t)((int32_t)sample.gy * sample.gy) +
+                      (uint32_t)((int32_t)sample.gz * sample.gz);
+      bool still = accel > STILL_LOW_SQUARED && accel < STILL_HIGH_SQUARED && gyro < GYRO_STILL_SQUARED;
+      if (!still && ++activeCount > activeLimit) {
+#if FALL_STATS
+        counters.stillActive++;
+#endif
+        enter(FALL_IDLE);
+        break;
+      }
+      lyingSum[0] += sample.ax;
+      lyingSum[1] += sample.ay;
+      lyingSum[2] += sample.az;
+      if (stateSamples < inactivitySamples) break;
+
+      bool lying = orientationChanged();
+      // Whatever the outcome, the current posture is the new reference
+      for (uint8_t i = 0; i < 3; i++) gravityQ4[i] = lyingSum[i] / stateSamples * 16;
+      enter(FALL_IDLE);
+      if (!lying) {
+#if FALL_STATS
+        counters.upright++;
+#endif
+        break;
+      }
+#if FALL_STATS
+      counters.falls++;
+#endif
+      lastConfirmDelay = sinceImpact;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool FallDetector::orientationChanged() const {
+  // Down to ~1/256 g per count so the squared products fit 64 bits comfortably
+  int32_t a[3], b[3];
+  for (uint8_t i = 0; i < 3; i++) {
+    a[i] = before[i] >> 4;
+    b[i] = (int32_t)(lyingSum[i] / stateSamples) >> 4;
+  }
+  int64_t dot = (int64_t)a[0] * b[0] + (int64_t)a[1] * b[1] + (int64_t)a[2] * b[2];
+  if (dot <= 0) return true;  // 90 degrees or more
+  int64_t normA = (int64_t)a[0] * a[0] + (int64_t)a[1] * a[1] + (int64_t)a[2] * a[2];
+  int64_t normB = (int64_t)b[0] * b[0] + (int64_t)b[1] * b[1] + (int64_t)b[2] * b[2];
+  // cos^2(angle) = dot^2 / (|a|^2 |b|^2) below cos^2(FALL_TILT_DEG)
+  return dot * dot * 256 < (int64_t)FALL_TILT_COS2_Q8 * normA * normB;
+}
@@ -0,0 +1,128 @@
+/*
+ * RescueNet AI - Multi-stage fall detector
+ *
+ * Runs on every IMU sample (100-200 Hz) instead of one reading every
+ * 5 seconds, and only reports a fall after the whole sequence:
+ *
+ *   1. free fall: |a| below FALL_FREE_FALL_G_X10 for FALL_FREE_FALL_MS
+ *   2. impact: |a| above FALL_IMPACT_G_X10 within FALL_IMPACT_WINDOW_MS
+ *   3. settle: FALL_SETTLE_MS for bounces and rolling to a stop
+ *   4. inactivity: FALL_INACTIVITY_MS close to 1 g with little rotation;
+ *      more than FALL_ACTIVE_PERCENT moving samples means the wearer got
+ *      up or kept going (jump, run, stumble)
+ *   5. orientation: the mean gravity vector while lying differs from the
+ *      one before the fall by at least FALL_TILT_DEG
+ *
+ * All thresholds are compared on squared magnitudes in raw counts, so a
+ * sample costs six 16x16 multiplies and a few compares; the only wide
+ * arithmetic is the orientation test, once per candidate fall.
+ */
+
+#ifndef RESCUENET_FALL_DETECTOR_H
+#define RESCUENET_FALL_DETECTOR_H
+
+#include "hal.h"
+
+#ifndef FALL_FREE_FALL_G_X10
+#define FALL_FREE_FALL_G_X10 6
+#endif
+#ifndef FALL_FREE_FALL_MS
+#define FALL_FREE_FALL_MS 60
+#endif
+#ifndef FALL_IMPACT_G_X10
+#define FALL_IMPACT_G_X10 20
+#endif
+#ifndef FALL_IMPACT_WINDOW_MS
+#define FALL_IMPACT_WINDOW_MS 600
+#endif
+#ifndef FALL_SETTLE_MS
+#define FALL_SETTLE_MS 500
+#endif
+#ifndef FALL_INACTIVITY_MS
+#define FALL_INACTIVITY_MS 2000
+#endif
+#ifndef FALL_ACTIVE_PERCENT
+#define FALL_ACTIVE_PERCENT 10
+#endif
+// Still: within +-0.3 g of 1 g and turning slower than 40 deg/s
+#define FALL_STILL_BAND_G_X10 3
+#define FALL_STILL_DPS 40
+// 45 degrees, as cos^2 in Q8 (cos^2 45 = 0.5)
+#define FALL_TILT_DEG 45
+#define FALL_TILT_COS2_Q8 128
+
+enum FallState {
+  FALL_IDLE,
+  FALL_FREE_FALL,   // Waiting for the impact
+  FALL_SETTLING,
+  FALL_INACTIVITY
+};
+
+// How far candidate falls got, stage by stage: 24 bytes the Nano goes
+// without
+#ifndef FALL_STATS
+#if defined(__AVR__)
+#define FALL_STATS 0
+#else
+#define FALL_STATS 1
+#endif
+#endif
+
+struct FallStats {
+  uint32_t freeFalls;
+  uint32_t impacts;
+  uint32_t noImpact;     // Free fall without an impact (caught oneself)
+  uint32_t stillActive;  // Impact followed by movement (jump, run, stumble)
+  uint32_t upright;      // Still afterwards but not lying (sat down hard)
+  uint32_t falls;
+};
+
+class FallDetector {
+public:
+  explicit FallDetector(uint16_t sampleRateHz = 100);
+
+  void reset();
+  void setSampleRate(uint16_t sampleRateHz);
+
+  // Feed one sample; returns true when a fall is confirmed
+  bool addSample(const ImuSample& sample);
+  // Within the still band of the inactivity stage
+  bool isStill(const ImuSample& sample) const;
+
+  FallState state() const { return current; }
+  // Samples from the impact to the confirmation of the last fall
+  uint16_t confirmDelay() const { return lastConfirmDelay; }
+#if FALL_STATS
+  const FallStats& stats() const { return counters; }
+#endif
+
+private:
+  void enter(FallState next);
+  bool orientationChanged() const;
+
+  // Stage lengths in samples
+  uint16_t freeFallSamples;
+  uint16_t impactWindow;
+  uint16_t settleSamples;
+  uint16_t inactivitySamples;
+  uint16_t activeLimit;
+
+  FallState current;
+  uint16_t stateSamples;
+  uint16_t lowCount;
+  uint16_t activeCount;
+  uint16_t sinceImpact;
+  uint16_t lastConfirmDelay;
+
+  // Gravity before the fall (Q4 low-pass while idle) and the sum while lying
+  int32_t gravityQ4[3];
+  int16_t before[3];
+  int32_t lyingSum[3];
+  bool primed;
+
+#if FALL_STATS
+  FallStats counters;
+#endif
+};
+
+#endif
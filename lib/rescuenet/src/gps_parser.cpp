@@ -0,0 +1,548 @@
+/*
+ * RescueNet AI - Incremental NMEA / UBX parser
+ */
+
+#include "gps_parser.h"
+
+#include "telemetry.h"
+
+#include <string.h>
+#include <time.h>
+
+namespace {
+
+enum State {
+  IDLE,
+  NMEA_TYPE,
+  NMEA_FIELDS,
+  NMEA_CHECKSUM1,
+  NMEA_CHECKSUM2,
+  UBX_SYNC,
+  UBX_CLASS,
+  UBX_ID,
+  UBX_LENGTH1,
+  UBX_LENGTH2,
+  UBX_PAYLOAD,
+  UBX_CHECKSUM1,
+  UBX_CHECKSUM2
+};
+
+enum Kind {
+  KIND_OTHER,
+  KIND_GGA,
+  KIND_RMC
+};
+
+// NMEA fields of interest
+const uint8_t GGA_TIME = 1;
+const uint8_t GGA_LATITUDE = 2;
+const uint8_t GGA_NORTH_SOUTH = 3;
+const uint8_t GGA_LONGITUDE = 4;
+const uint8_t GGA_EAST_WEST = 5;
+const uint8_t GGA_QUALITY = 6;
+const uint8_t GGA_SATELLITES = 7;
+const uint8_t GGA_HDOP = 8;
+const uint8_t GGA_ALTITUDE = 9;
+const uint8_t RMC_TIME = 1;
+const uint8_t RMC_STATUS = 2;
+const uint8_t RMC_SPEED = 7;
+const uint8_t RMC_DATE = 9;
+
+// A sentence is at most 82 characters; anything with more fields is noise
+const uint8_t NMEA_MAX_FIELDS = 24;
+// Fraction digits kept; ddmm.mmmmm needs five
+const uint8_t NMEA_MAX_DECIMALS = 5;
+
+// NAV-PVT payload offsets, of the last byte of each value
+const uint16_t PVT_LENGTH = 92;
+const uint16_t PVT_YEAR = 5;
+const uint16_t PVT_MONTH = 6;
+const uint16_t PVT_DAY = 7;
+const uint16_t PVT_HOUR = 8;
+const uint16_t PVT_MINUTE = 9;
+const uint16_t PVT_SECOND = 10;
+const uint16_t PVT_VALID = 11;
+const uint16_t PVT_NANO = 19;
+const uint16_t PVT_FIX_TYPE = 20;
+const uint16_t PVT_FLAGS = 21;
+const uint16_t PVT_SATELLITES = 23;
+const uint16_t PVT_LONGITUDE = 27;
+const uint16_t PVT_LATITUDE = 31;
+const uint16_t PVT_HEIGHT_MSL = 39;
+const uint16_t PVT_GROUND_SPEED = 63;
+const uint16_t PVT_PDOP = 77;
+
+// Pending.flags: NAV-PVT valid bits, and gnssFixOK from its flags
+const uint8_t PVT_VALID_DATE_TIME = 0x03;
+const uint8_t PVT_FIX_OK = 0x80;
+
+// Scales digits with decimals fraction digits to want fraction digits
+uint32_t rescale(uint32_t value, uint8_t decimals, uint8_t want) {
+  for (; decimals < want; decimals++) value *= 10;
+  for (; decimals > want; decimals--) value /= 10;
+  return value;
+}
+
+// hhmmss.sss as milliseconds of the day
+uint32_t nmeaTime(uint32_t value, uint8_t decimals) {
+  uint32_t v = rescale(value, decimals, 3);
+  uint32_t hours = v / 10000000UL;
+  uint32_t minutes = v / 100000UL % 100;
+  return (hours * 60 + minutes) * 60000UL + v % 100000UL;
+}
+
+int8_t hexValue(uint8_t c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+}  // namespace
+
+GpsParser::GpsParser() {
+  reset();
+}
+
+void GpsParser::reset() {
+  state = IDLE;
+  memset(&pending, 0, sizeof(pending));
+  memset(&current, 0, sizeof(current));
+  memset(&counters, 0, sizeof(counters));
+  date = 0;
+  ackReady = false;
+}
+
+bool GpsParser::takeAck(uint8_t& cls, uint8_t& id, bool& acked) {
+  if (!ackReady) return false;
+  cls = ackClass;
+  id = ackId;
+  acked = ackAcked;
+  ackReady = false;
+  return true;
+}
+
+bool GpsParser::feed(uint8_t byte) {
+  counters.bytes++;
+  if (state >= UBX_SYNC) return feedUbx(byte);
+  if (state != IDLE) return feedNmea(byte);
+  start(byte);
+  return false;
+}
+
+void GpsParser::start(uint8_t byte) {
+  if (byte == '$') {
+    memset(&pending, 0, sizeof(pending));
+    memset(type, 0, sizeof(type));
+    checksum = 0;
+    state = NMEA_TYPE;
+  } else if (byte == UBX_SYNC1) {
+    state = UBX_SYNC;
+  }
+}
+
+bool GpsParser::feedNmea(uint8_t byte) {
+  if (byte == '$' || byte == '\r' || byte == '\n' || byte == UBX_SYNC1) {
+    // Cut off before its checksum: start over on whatever this starts
+    counters.errors++;
+    state = IDLE;
+    start(byte);
+    return false;
+  }
+
+  switch (state) {
+    case NMEA_TYPE:
+      checksum ^= byte;
+      if (byte != ',') {
+        // Only the last three letters matter: GPGGA, GNGGA, ...
+        type[0] = type[1];
+        type[1] = type[2];
+        type[2] = (char)byte;
+        return false;
+      }
+      if (memcmp(type, "GGA", 3) == 0) {
+        kind = KIND_GGA;
+      } else if (memcmp(type, "RMC", 3) == 0) {
+        kind = KIND_RMC;
+      } else {
+        kind = KIND_OTHER;
+      }
+      field = 1;
+      number = 0;
+      decimals = 0;
+      point = false;
+      negative = false;
+      digits = false;
+      letter = 0;
+      state = NMEA_FIELDS;
+      return false;
+
+    case NMEA_FIELDS:
+      if (byte == '*') {
+        endField();
+        expected = 0;
+        state = NMEA_CHECKSUM1;
+        return false;
+      }
+      checksum ^= byte;
+      if (byte == ',') {
+        endField();
+        if (++field > NMEA_MAX_FIELDS) {
+          counters.errors++;
+          state = IDLE;
+        }
+      } else if (kind != KIND_OTHER) {
+        nmeaDigit(byte);
+      }
+      return false;
+
+    case NMEA_CHECKSUM1:
+    case NMEA_CHECKSUM2: {
+      int8_t value = hexValue(byte);
+      if (value < 0) {
+        counters.errors++;
+        state = IDLE;
+        return false;
+      }
+      expected = (uint8_t)((expected << 4) | value);
+      if (state == NMEA_CHECKSUM1) {
+        state = NMEA_CHECKSUM2;
+        return false;
+      }
+      state = IDLE;
+      if (expected != checksum) {
+        counters.errors++;
+        return false;
+      }
+      counters.sentences++;
+      return commitNmea();
+    }
+  }
+  return false;
+}
+
+void GpsParser::nmeaDigit(uint8_t byte) {
+  if (byte >= '0' && byte <= '9') {
+    if (point && decimals >= NMEA_MAX_DECIMALS) return;
+    // Past nine digits a field is not one of ours; keep it from wrapping
+    if (number >= 400000000UL) return;
+    number = number * 10 + (byte - '0');
+    digits = true;
+    if (point) decimals++;
+  } else if (byte == '.') {
+    point = true;
+  } else if (byte == '-') {
+    negative = true;
+  } else if (!letter) {
+    letter = (char)byte;
+  }
+}
+
+void GpsParser::endField() {
+  if (kind == KIND_GGA) {
+    switch (field) {
+      case GGA_TIME:
+        pending.timeMs = nmeaTime(number, decimals);
+        break;
+      case GGA_LATITUDE:
+        pending.latitude = nmeaDegrees(number, decimals);
+        pending.position = digits;
+        break;
+      case GGA_NORTH_SOUTH:
+        if (letter == 'S') pending.latitude = -pending.latitude;
+        break;
+      case GGA_LONGITUDE:
+        pending.longitude = nmeaDegrees(number, decimals);
+        pending.position = pending.position && digits;
+        break;
+      case GGA_EAST_WEST:
+        if (letter == 'W') pending.longitude = -pending.longitude;
+        break;
+      case GGA_QUALITY:
+        // GGA has no 2D/3D; an altitude below makes it 3D
+        pending.quality = number ? GPS_FIX_2D : GPS_FIX_NONE;
+        break;
+      case GGA_SATELLITES:
+        pending.satellites = number > 255 ? 255 : (uint8_t)number;
+        break;
+      case GGA_HDOP: {
+        uint32_t dop = rescale(number, decimals, 2);
+        pending.dop = dop > 65535UL ? 65535 : (uint16_t)dop;
+        break;
+      }
+      case GGA_ALTITUDE:
+        if (digits) {
+          int32_t mm = (int32_t)rescale(number, decimals, 3);
+          pending.altitudeMm = negative ? -mm : mm;
+          if (pending.quality) pending.quality = GPS_FIX_3D;
+        }
+        break;
+    }
+  } else if (kind == KIND_RMC) {
+    switch (field) {
+      case RMC_TIME:
+        pending.timeMs = nmeaTime(number, decimals);
+        break;
+      case RMC_STATUS:
+        pending.active = letter == 'A';
+        break;
+      case RMC_SPEED:
+        // Knots to mm/s: 1852 m per 3600 s
+        pending.speedMmS = (uint32_t)((uint64_t)rescale(number, decimals, 3) * 1852 / 3600);
+        break;
+      case RMC_DATE:
+        if (digits) pending.date = number;
+        break;
+    }
+  }
+  number = 0;
+  decimals = 0;
+  point = false;
+  negative = false;
+  digits = false;
+  letter = 0;
+}
+
+bool GpsParser::commitNmea() {
+  if (kind == KIND_RMC) {
+    if (pending.date) date = pending.date;
+    if (pending.active) current.speedMmS = pending.speedMmS;
+    return false;
+  }
+  if (kind != KIND_GGA) return false;
+
+  if (!pending.quality || !pending.position) {
+    current.quality = GPS_FIX_NONE;
+    return false;
+  }
+  current.receivedMs = millis();
+  current.latitude = pending.latitude;
+  current.longitude = pending.longitude;
+  current.altitudeMm = pending.altitudeMm;
+  current.dopX100 = pending.dop;
+  current.satellites = pending.satellites;
+  current.quality = pending.quality;
+  current.source = GPS_SOURCE_NMEA;
+  if (date) {
+    // ddmmyy from the RMC before this GGA
+    setUtc((uint16_t)(2000 + date % 100), (uint8_t)(date / 100 % 100), (uint8_t)(date / 10000), pending.timeMs);
+  } else {
+    current.utcSeconds = 0;
+    current.utcMillis = (uint16_t)(pending.timeMs % 1000);
+  }
+  counters.fixes++;
+  return true;
+}
+
+bool GpsParser::feedUbx(uint8_t byte) {
+  if (state >= UBX_CLASS && state <= UBX_PAYLOAD) {
+    ckA += byte;
+    ckB += ckA;
+  }
+
+  switch (state) {
+    case UBX_SYNC:
+      if (byte == UBX_SYNC2) {
+        ckA = 0;
+        ckB = 0;
+        state = UBX_CLASS;
+      } else {
+        // A lone 0xB5: not UBX after all
+        state = IDLE;
+        start(byte);
+      }
+      return false;
+
+    case UBX_CLASS:
+      msgClass = byte;
+      state = UBX_ID;
+      return false;
+
+    case UBX_ID:
+      msgId = byte;
+      state = UBX_LENGTH1;
+      return false;
+
+    case UBX_LENGTH1:
+      length = byte;
+      state = UBX_LENGTH2;
+      return false;
+
+    case UBX_LENGTH2:
+      length |= (uint16_t)byte << 8;
+      if (length > UBX_MAX_PAYLOAD) {
+        counters.errors++;
+        state = IDLE;
+        return false;
+      }
+      memset(&pending, 0, sizeof(pending));
+      offset = 0;
+      shift = 0;
+      state = length ? UBX_PAYLOAD : UBX_CHECKSUM1;
+      return false;
+
+    case UBX_PAYLOAD:
+      ubxByte(byte);
+      if (++offset == length) state = UBX_CHECKSUM1;
+      return false;
+
+    case UBX_CHECKSUM1:
+      if (byte != ckA) {
+        counters.errors++;
+        state = IDLE;
+      } else {
+        state = UBX_CHECKSUM2;
+      }
+      return false;
+
+    case UBX_CHECKSUM2:
+      state = IDLE;
+      if (byte != ckB) {
+        counters.errors++;
+        return false;
+      }
+      counters.messages++;
+      return commitUbx();
+  }
+  return false;
+}
+
+void GpsParser::ubxByte(uint8_t byte) {
+  shift = (shift >> 8) | ((uint32_t)byte << 24);
+  if (msgClass != UBX_CLASS_NAV || msgId != UBX_NAV_PVT || length < PVT_LENGTH) return;
+
+  switch (offset) {
+    case PVT_YEAR:
+      pending.date = (shift >> 16) * 10000UL;
+      break;
+    case PVT_MONTH:
+      pending.date += byte * 100UL;
+      break;
+    case PVT_DAY:
+      pending.date += byte;
+      break;
+    case PVT_HOUR:
+      pending.timeMs = byte * 3600000UL;
+      break;
+    case PVT_MINUTE:
+      pending.timeMs += byte * 60000UL;
+      break;
+    case PVT_SECOND:
+      pending.timeMs += byte * 1000UL;
+      break;
+    case PVT_VALID:
+      pending.flags = byte & PVT_VALID_DATE_TIME;
+      break;
+    case PVT_NANO:
+      pending.nanos = (int32_t)shift;
+      break;
+    case PVT_FIX_TYPE:
+      // 4 is GNSS with dead reckoning
+      pending.quality = byte == 2 ? GPS_FIX_2D : (byte == 3 || byte == 4) ? GPS_FIX_3D : GPS_FIX_NONE;
+      break;
+    case PVT_FLAGS:
+      if (byte & 0x01) pending.flags |= PVT_FIX_OK;
+      break;
+    case PVT_SATELLITES:
+      pending.satellites = byte;
+      break;
+    case PVT_LONGITUDE:
+      pending.longitude = (int32_t)shift;
+      break;
+    case PVT_LATITUDE:
+      pending.latitude = (int32_t)shift;
+      break;
+    case PVT_HEIGHT_MSL:
+      pending.altitudeMm = (int32_t)shift;
+      break;
+    case PVT_GROUND_SPEED: {
+      int32_t speed = (int32_t)shift;
+      pending.speedMmS = speed < 0 ? 0 : (uint32_t)speed;
+      break;
+    }
+    case PVT_PDOP:
+      pending.dop = (uint16_t)(shift >> 16);
+      break;
+  }
+}
+
+bool GpsParser::commitUbx() {
+  if (msgClass == UBX_CLASS_ACK && length == 2) {
+    // Payload: class and id of the message acknowledged
+    ackClass = (uint8_t)(shift >> 16);
+    ackId = (uint8_t)(shift >> 24);
+    ackAcked = msgId == UBX_ACK_ACK;
+    ackReady = true;
+    return false;
+  }
+  if (msgClass != UBX_CLASS_NAV || msgId != UBX_NAV_PVT || length < PVT_LENGTH) return false;
+
+  if (!(pending.flags & PVT_FIX_OK) || !pending.quality) {
+    current.quality = GPS_FIX_NONE;
+    return false;
+  }
+  current.receivedMs = millis();
+  current.latitude = pending.latitude;
+  current.longitude = pending.longitude;
+  current.altitudeMm = pending.altitudeMm;
+  current.speedMmS = pending.speedMmS;
+  current.dopX100 = pending.dop;
+  current.satellites = pending.satellites;
+  current.quality = pending.quality;
+  current.source = GPS_SOURCE_UBX;
+  if ((pending.flags & PVT_VALID_DATE_TIME) == PVT_VALID_DATE_TIME) {
+    // The seconds are rounded; nano says by how much, either way
+    int32_t ms = (int32_t)pending.timeMs + pending.nanos / 1000000L;
+    setUtc((uint16_t)(pending.date / 10000), (uint8_t)(pending.date / 100 % 100), (uint8_t)(pending.date % 100),
+           (uint32_t)(ms < 0 ? 0 : ms));
+  } else {
+    current.utcSeconds = 0;
+    current.utcMillis = 0;
+  }
+  counters.fixes++;
+  return true;
+}
+
+void GpsParser::setUtc(uint16_t year, uint8_t month, uint8_t day, uint32_t timeMs) {
+  struct tm time;
+  memset(&time, 0, sizeof(time));
+  time.tm_year = year - 1900;
+  time.tm_mon = month - 1;
+  time.tm_mday = day;
+  uint32_t seconds = timeMs / 1000;
+  time.tm_hour = (int)(seconds / 3600);
+  time.tm_min = (int)(seconds / 60 % 60);
+  time.tm_sec = (int)(seconds % 60);
+  current.utcSeconds = telemetrySeconds(time);
+  current.utcMillis = (uint16_t)(timeMs % 1000);
+}
+
+int32_t GpsParser::nmeaDegrees(uint32_t value, uint8_t decimals) {
+  // dddmm.mmmmm: whole degrees, then minutes to 1e-7 degree (x 100 / 60)
+  uint32_t v = rescale(value, decimals, NMEA_MAX_DECIMALS);
+  uint32_t degrees = v / 10000000UL;
+  uint32_t minutes = v % 10000000UL;
+  return (int32_t)(degrees * 10000000UL + (minutes * 10 + 3) / 6);
+}
+
+size_t GpsParser::frameUbx(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t length, uint8_t* out,
+                           size_t capacity) {
+  size_t size = (size_t)length + UBX_OVERHEAD;
+  if (capacity < size) return 0;
+  out[0] = UBX_SYNC1;
+  out[1] = UBX_SYNC2;
+  out[2] = cls;
+  out[3] = id;
+  out[4] = (uint8_t)length;
+  out[5] = (uint8_t)(length >> 8);
+  if (length) memcpy(out + 6, payload, length);
+  uint8_t a = 0;
+  uint8_t b = 0;
+  for (size_t i = 2; i < size - 2; i++) {
+    a += out[i];
+    b += a;
+  }
+  out[size - 2] = a;
+  out[size - 1] = b;
+  return size;
+}
@@ -0,0 +1,162 @@
+/*
+ * RescueNet AI - Incremental NMEA / UBX parser
+ *
+ * Takes the GPS receiver's output one byte at a time, as it comes out of
+ * the UART ring, and never holds a sentence: every field is folded into
+ * integers as its characters arrive, and a finished sentence only
+ * commits the few values it carried once its checksum is good. NMEA and
+ * u-blox binary (UBX) may be interleaved, as they are while a receiver
+ * is being switched over.
+ *
+ *   NMEA  $..GGA (position, altitude, fix quality, satellites, HDOP) and
+ *         $..RMC (date, speed) from any talker; latitude and longitude
+ *         go from ddmm.mmmmm straight to 1e-7 degree integers, no floats
+ *         and no String
+ *   UBX   NAV-PVT (one message per fix with everything above), and
+ *         ACK-ACK / ACK-NAK for the configuration gps_receiver.h sends
+ *
+ * A fix is published on every good GGA with a position, or NAV-PVT
+ * with gnssFixOK, stamped with millis() of its last byte and, once the
+ * receiver knows the date, UTC.
+ */
+
+#ifndef RESCUENET_GPS_PARSER_H
+#define RESCUENET_GPS_PARSER_H
+
+#include <Arduino.h>
+
+#define UBX_SYNC1 0xB5
+#define UBX_SYNC2 0x62
+#define UBX_CLASS_NAV 0x01
+#define UBX_CLASS_ACK 0x05
+#define UBX_CLASS_CFG 0x06
+#define UBX_NAV_PVT 0x07
+#define UBX_ACK_NAK 0x00
+#define UBX_ACK_ACK 0x01
+#define UBX_CFG_PRT 0x00
+#define UBX_CFG_MSG 0x01
+#define UBX_CFG_RATE 0x08
+// Header, length and checksum around the payload
+#define UBX_OVERHEAD 8
+// Longer messages are taken as line noise
+#define UBX_MAX_PAYLOAD 1024
+
+enum GpsFixQuality {
+  GPS_FIX_NONE = 0,
+  GPS_FIX_2D = 2,
+  GPS_FIX_3D = 3
+};
+
+enum GpsSource {
+  GPS_SOURCE_NMEA = 1,
+  GPS_SOURCE_UBX = 2
+};
+
+struct GpsFix {
+  uint32_t receivedMs;  // millis() when its last byte was parsed
+  uint32_t utcSeconds;  // Since 1970; 0 until the receiver knows the date
+  uint16_t utcMillis;
+  int32_t latitude;     // 1e-7 degree, north positive
+  int32_t longitude;    // 1e-7 degree, east positive
+  int32_t altitudeMm;   // Above mean sea level
+  uint32_t speedMmS;    // Over ground
+  uint16_t dopX100;     // HDOP (NMEA) or PDOP (UBX)
+  uint8_t satellites;
+  uint8_t quality;      // GpsFixQuality
+  uint8_t source;       // GpsSource
+};
+
+struct GpsParserStats {
+  uint32_t bytes;
+  uint32_t sentences;  // NMEA with a good checksum, used or not
+  uint32_t messages;   // UBX with a good checksum
+  uint32_t errors;     // Bad checksums, overlong or broken frames
+  uint32_t fixes;
+};
+
+class GpsParser {
+public:
+  GpsParser();
+  void reset();
+
+  // One byte from the receiver; true when it completed a new fix
+  bool feed(uint8_t byte);
+
+  const GpsFix& fix() const { return current; }
+  bool hasFix() const { return current.quality != GPS_FIX_NONE; }
+  const GpsParserStats& stats() const { return counters; }
+
+  // The latest ACK-ACK (acked true) or ACK-NAK, once
+  bool takeAck(uint8_t& msgClass, uint8_t& msgId, bool& acked);
+
+  // Frames a UBX message with its checksum into out; its length, or 0
+  // when capacity is too small
+  static size_t frameUbx(uint8_t msgClass, uint8_t msgId, const uint8_t* payload, uint16_t length, uint8_t* out,
+                         size_t capacity);
+
+private:
+  // What one sentence or message carried, committed when it checks out
+  struct Pending {
+    uint32_t timeMs;  // UTC time of day
+    int32_t latitude;
+    int32_t longitude;
+    int32_t altitudeMm;
+    uint32_t speedMmS;
+    uint32_t date;    // ddmmyy; UBX: yyyymmdd
+    int32_t nanos;    // UBX: fraction of the second, may be negative
+    uint16_t dop;
+    uint8_t satellites;
+    uint8_t quality;
+    uint8_t flags;    // UBX valid / flags bits
+    bool active;      // RMC status A
+    bool position;
+  };
+
+  // The first byte of a sentence or message, or noise between them
+  void start(uint8_t byte);
+  bool feedNmea(uint8_t byte);
+  bool feedUbx(uint8_t byte);
+  void nmeaDigit(uint8_t byte);
+  void endField();
+  bool commitNmea();
+  void ubxByte(uint8_t byte);
+  bool commitUbx();
+  void setUtc(uint16_t year, uint8_t month, uint8_t day, uint32_t timeMs);
+  static int32_t nmeaDegrees(uint32_t value, uint8_t decimals);
+
+  uint8_t state;
+
+  // NMEA: sentence type, field number and the field so far
+  char type[3];
+  uint8_t kind;         // GGA, RMC or one the parser skips
+  uint8_t field;
+  uint8_t checksum;
+  uint8_t expected;
+  uint32_t number;      // Digits of the field, point removed
+  uint8_t decimals;     // Digits after the point in number
+  bool point;
+  bool negative;
+  bool digits;
+  char letter;          // First non-digit of the field (N/S/E/W/A/V)
+
+  // UBX: header, position in the payload and the running checksum
+  uint8_t msgClass;
+  uint8_t msgId;
+  uint16_t length;
+  uint16_t offset;
+  uint8_t ckA;
+  uint8_t ckB;
+  uint32_t shift;       // The last four payload bytes, little endian
+
+  Pending pending;
+  uint32_t date;        // Last RMC date, ddmmyy; 0 unknown
+  GpsFix current;
+  GpsParserStats counters;
+
+  uint8_t ackClass;
+  uint8_t ackId;
+  bool ackAcked;
+  bool ackReady;
+};
+
+#endif
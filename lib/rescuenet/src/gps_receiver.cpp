@@ -0,0 +1,142 @@
+/*
+ * RescueNet AI - GPS receiver on a hardware UART
+ */
+
+#include "gps_receiver.h"
+
+#include <string.h>
+
+namespace {
+
+enum Step {
+  STEP_RATE,
+  STEP_MESSAGE,
+  STEP_PORT
+};
+
+const uint8_t STEP_IDS[] = {UBX_CFG_RATE, UBX_CFG_MSG, UBX_CFG_PRT};
+
+// CFG-PRT for UART1: 8N1, UBX and NMEA in, UBX only out
+const uint8_t PRT_PORT_UART1 = 1;
+const uint32_t PRT_MODE_8N1 = 0x000008D0UL;
+const uint16_t PRT_IN_UBX_NMEA = 0x0003;
+const uint16_t PRT_OUT_UBX = 0x0001;
+// CFG-RATE: navigation solutions per measurement, aligned to GPS time
+const uint16_t RATE_NAV_CYCLES = 1;
+const uint16_t RATE_TIME_GPS = 1;
+
+const uint8_t CONFIG_PAYLOAD_MAX = 20;
+
+void put16(uint8_t* out, uint16_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+}
+
+void put32(uint8_t* out, uint32_t value) {
+  put16(out, (uint16_t)value);
+  put16(out + 2, (uint16_t)(value >> 16));
+}
+
+}  // namespace
+
+GpsReceiver::GpsReceiver(SerialPort& port)
+  : port(port), baud(9600), rateMs(1000), state(GPS_MODE_NMEA), step(0), lastStep(0), attempts(0), sentAt(0) {
+  memset(&counters, 0, sizeof(counters));
+}
+
+void GpsReceiver::begin(uint32_t portBaud, uint16_t measureMs, bool binary) {
+  baud = portBaud;
+  rateMs = measureMs;
+  parser.reset();
+  memset(&counters, 0, sizeof(counters));
+  state = GPS_MODE_NMEA;
+  if (!binary && rateMs == 1000) return;
+
+  step = STEP_RATE;
+  lastStep = binary ? STEP_PORT : STEP_RATE;
+  attempts = 0;
+  state = GPS_MODE_CONFIGURING;
+  send();
+}
+
+bool GpsReceiver::hasFix(uint32_t maxAgeMs) const {
+  return parser.hasFix() && millis() - parser.fix().receivedMs <= maxAgeMs;
+}
+
+bool GpsReceiver::poll() {
+  counters.polls++;
+  bool fresh = false;
+  uint16_t drained = 0;
+  while (drained < GPS_POLL_BYTES && port.available() > 0) {
+    int c = port.read();
+    if (c < 0) break;
+    if (parser.feed((uint8_t)c)) fresh = true;
+    drained++;
+  }
+  if (drained > counters.drainMax) counters.drainMax = drained;
+  if (drained == GPS_POLL_BYTES) counters.fullPolls++;
+
+  if (state == GPS_MODE_CONFIGURING) configure();
+  return fresh;
+}
+
+void GpsReceiver::configure() {
+  uint8_t cls;
+  uint8_t id;
+  bool acked;
+  if (parser.takeAck(cls, id, acked) && cls == UBX_CLASS_CFG && id == STEP_IDS[step]) {
+    if (!acked) {
+      counters.configRefused++;
+      state = GPS_MODE_NMEA;
+    } else if (step == lastStep) {
+      state = lastStep == STEP_PORT ? GPS_MODE_UBX : GPS_MODE_NMEA;
+    } else {
+      step++;
+      attempts = 0;
+      send();
+    }
+    return;
+  }
+  if (millis() - sentAt < GPS_ACK_TIMEOUT_MS) return;
+  if (attempts >= GPS_CONFIG_RETRIES) {
+    counters.configRefused++;
+    state = GPS_MODE_NMEA;
+    return;
+  }
+  send();
+}
+
+void GpsReceiver::send() {
+  uint8_t payload[CONFIG_PAYLOAD_MAX];
+  uint16_t length = 0;
+  memset(payload, 0, sizeof(payload));
+  switch (step) {
+    case STEP_RATE:
+      put16(payload, rateMs);
+      put16(payload + 2, RATE_NAV_CYCLES);
+      put16(payload + 4, RATE_TIME_GPS);
+      length = 6;
+      break;
+    case STEP_MESSAGE:
+      // NAV-PVT on every solution, on the port this arrives on
+      payload[0] = UBX_CLASS_NAV;
+      payload[1] = UBX_NAV_PVT;
+      payload[2] = 1;
+      length = 3;
+      break;
+    case STEP_PORT:
+      payload[0] = PRT_PORT_UART1;
+      put32(payload + 4, PRT_MODE_8N1);
+      put32(payload + 8, baud);
+      put16(payload + 12, PRT_IN_UBX_NMEA);
+      put16(payload + 14, PRT_OUT_UBX);
+      length = 20;
+      break;
+  }
+  uint8_t frame[CONFIG_PAYLOAD_MAX + UBX_OVERHEAD];
+  size_t size = GpsParser::frameUbx(UBX_CLASS_CFG, STEP_IDS[step], payload, length, frame, sizeof(frame));
+  port.write(frame, size);
+  attempts++;
+  counters.configSent++;
+  sentAt = millis();
+}
@@ -0,0 +1,92 @@
+/*
+ * RescueNet AI - GPS receiver on a hardware UART
+ *
+ * The GPS code the sketches used read a SoftwareSerial port through
+ * TinyGPS with delay(100) in between, so at 9600 baud a sentence could
+ * overflow the 64 byte receive buffer while the loop slept and the
+ * location came out as often as not from the fallback coordinates.
+ *
+ * Here the receiver sits on a hardware UART whose driver fills a ring
+ * from its interrupt (HardwareSerial's setRxBufferSize() sets how much
+ * it holds), and poll() drains at most GPS_POLL_BYTES of it per call
+ * into GpsParser (gps_parser.h); nothing blocks and nothing is copied.
+ *
+ * begin() can switch a u-blox receiver over from NMEA to one UBX
+ * NAV-PVT message per fix at a configurable rate: CFG-RATE, CFG-MSG and
+ * CFG-PRT, each sent from poll() once the one before was acknowledged.
+ * A receiver that refuses (NEO-6M has no NAV-PVT) or never answers is
+ * left on NMEA, which the parser reads just as well.
+ */
+
+#ifndef RESCUENET_GPS_RECEIVER_H
+#define RESCUENET_GPS_RECEIVER_H
+
+#include "gps_parser.h"
+#include "hal.h"
+
+// Bytes parsed per poll(); 9600 baud brings 96 per 100 ms
+#ifndef GPS_POLL_BYTES
+#define GPS_POLL_BYTES 256
+#endif
+
+// How long a configuration message waits for its ACK, and how often it
+// is sent before the receiver is left as it is
+#define GPS_ACK_TIMEOUT_MS 1000
+#define GPS_CONFIG_RETRIES 3
+
+// Older fixes are not reported as the wearer's location
+#ifndef GPS_FIX_MAX_AGE_MS
+#define GPS_FIX_MAX_AGE_MS 10000
+#endif
+
+enum GpsMode {
+  GPS_MODE_NMEA,
+  GPS_MODE_CONFIGURING,
+  GPS_MODE_UBX
+};
+
+struct GpsReceiverStats {
+  uint32_t polls;
+  uint16_t drainMax;        // Most bytes one poll() parsed
+  uint16_t fullPolls;       // Polls that stopped at GPS_POLL_BYTES
+  uint16_t configSent;      // Configuration messages, retries included
+  uint16_t configRefused;   // NAKs and timeouts that left it on NMEA
+};
+
+class GpsReceiver {
+public:
+  explicit GpsReceiver(SerialPort& port);
+
+  // baud is what the port runs at (CFG-PRT keeps it). With binary the
+  // receiver is moved to UBX NAV-PVT every rateMs; without, only its
+  // rate is set, and only when it is not the default second.
+  void begin(uint32_t baud, uint16_t rateMs = 1000, bool binary = true);
+
+  // Parses what has arrived and moves the configuration on; true when a
+  // new fix came in
+  bool poll();
+
+  const GpsFix& fix() const { return parser.fix(); }
+  // A fix, at most maxAgeMs old
+  bool hasFix(uint32_t maxAgeMs = GPS_FIX_MAX_AGE_MS) const;
+  uint8_t mode() const { return state; }
+  const GpsParserStats& parserStats() const { return parser.stats(); }
+  const GpsReceiverStats& stats() const { return counters; }
+
+private:
+  void send();
+  void configure();
+
+  SerialPort& port;
+  GpsParser parser;
+  uint32_t baud;
+  uint16_t rateMs;
+  uint8_t state;     // GpsMode
+  uint8_t step;      // Next configuration message
+  uint8_t lastStep;
+  uint8_t attempts;
+  uint32_t sentAt;
+  GpsReceiverStats counters;
+};
+
+#endif
@@ -0,0 +1,240 @@
+/*
+ * RescueNet AI - Hardware Abstraction Layer
+ *
+ * The detection and transport code talks to these interfaces instead of
+ * Wire, HardwareSerial, MAX30105, MPU6050, DallasTemperature and
+ * HTTPClient directly. Each board sketch wraps its real drivers
+ * (codes/esp32_hal.h, codes/nano_hal.h); the host build supplies
+ * simulated back-ends (host/sim) so the same code can be run and timed
+ * on a workstation.
+ */
+
+#ifndef RESCUENET_HAL_H
+#define RESCUENET_HAL_H
+
+#include <Arduino.h>
+#include <time.h>
+
+// The library reports what it does on Serial. The Nano leaves that out:
+// the UART's buffers and the messages, which AVR keeps in RAM like every
+// string, come to close to 900 of its 2048 bytes.
+#ifndef RESCUENET_LOG
+#if defined(__AVR__)
+#define RESCUENET_LOG 0
+#else
+#define RESCUENET_LOG 1
+#endif
+#endif
+
+#if RESCUENET_LOG
+#define LOG_PORT Serial
+#else
+// Takes what Serial would; inline and empty, so nothing is linked
+class NullLog {
+public:
+  template <typename T> size_t print(const T&, int = 0) { return 0; }
+  template <typename T> size_t println(const T&, int = 0) { return 0; }
+  size_t println() { return 0; }
+};
+#define LOG_PORT NullLog()
+#endif
+
+// Value DallasTemperature reports for a missing probe
+#define TEMP_DISCONNECTED_C -127.0f
+
+// One red/IR pair from the optical front end (18-bit ADC counts)
+struct PpgSample {
+  uint32_t red;
+  uint32_t ir;
+};
+
+// MAX30102/MAX30105 optical front end in SpO2 (red + IR) mode
+class PpgSensor {
+public:
+  virtual bool begin() = 0;
+  // ADC sample rate and on-chip averaging; output rate is sampleRateHz / averaging
+  virtual bool configure(uint16_t sampleRateHz, uint8_t averaging) = 0;
+  // Burst-reads up to maxSamples queued in the 32-deep hardware FIFO.
+  // overflowed receives how many samples the FIFO lost since the last read.
+  virtual uint8_t readFifo(PpgSample* out, uint8_t maxSamples, uint8_t& overflowed) = 0;
+};
+
+// Ranges every IMU back-end configures: +-8 g and +-500 deg/s
+#define IMU_ACCEL_LSB_PER_G 4096
+#define IMU_GYRO_LSB_PER_DPS_X10 655
+
+// One accelerometer + gyro sample in raw counts at the ranges above
+struct ImuSample {
+  int16_t ax, ay, az;
+  int16_t gx, gy, gz;
+};
+
+// MPU6050 accelerometer and gyro streaming through its 1 KB FIFO
+class ImuSensor {
+public:
+  virtual bool begin() = 0;
+  // Starts sampling accel + gyro into the FIFO at sampleRateHz
+  virtual bool configure(uint16_t sampleRateHz) = 0;
+  // Burst-reads up to maxSamples queued samples. overflowed is set when the
+  // FIFO filled up; its contents are then discarded and sampling restarts.
+  virtual uint8_t readFifo(ImuSample* out, uint8_t maxSamples, bool& overflowed) = 0;
+};
+
+// 64-bit ROM address of a probe on a OneWire bus: family, serial, CRC
+struct TempProbeRom {
+  uint8_t bytes[8];
+};
+
+// DS18B20 probes on one OneWire bus, driven by temp_probes.h. Each call
+// is one bus transaction of a few milliseconds; none waits for the
+// conversion itself, which takes 94 to 750 ms by resolution.
+class TempSensor {
+public:
+  virtual void begin() = 0;
+  // Searches the bus for up to max DS18B20s; the addresses are then cached
+  virtual uint8_t search(TempProbeRom* roms, uint8_t max) = 0;
+  // 9 to 12 bits
+  virtual bool setResolution(const TempProbeRom& rom, uint8_t bits) = 0;
+  // Starts a conversion on every probe at once (Skip ROM, Convert T)
+  virtual bool startConversion() = 0;
+  // One probe's last result in 1/16 C; false when it does not answer or
+  // the scratchpad fails its CRC
+  virtual bool readRaw(const TempProbeRom& rom, int16_t& sixteenths) = 0;
+};
+
+// Byte stream to a modem (SIM800L, ESP8266) on a hardware or software UART
+class SerialPort {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual size_t write(const uint8_t* data, size_t length) = 0;
+
+  size_t print(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+  size_t print(const String& text) { return write((const uint8_t*)text.c_str(), text.length()); }
+  size_t println(const char* text) { return print(text) + print("\r\n"); }
+  size_t println(const String& text) { return print(text) + print("\r\n"); }
+  size_t write(uint8_t c) { return write(&c, 1); }
+
+  // Text in flash (PSTR(), PROGMEM), passed on a few bytes at a time
+  size_t writeFlash(const char* text, size_t length) {
+    uint8_t chunk[16];
+    size_t written = 0;
+    while (length > 0) {
+      size_t n = length < sizeof(chunk) ? length : sizeof(chunk);
+      memcpy_P(chunk, text, n);
+      written += write(chunk, n);
+      text += n;
+      length -= n;
+    }
+    return written;
+  }
+  size_t printFlash(const char* text) { return writeFlash(text, strlen_P(text)); }
+};
+
+// startPost()/pollPost() while the answer is still to come
+#define HTTP_PENDING 0
+
+// Request/response HTTP client (HTTPClient on the ESP32)
+class HttpPort {
+public:
+  // Returns the HTTP status code, or a negative transport error like HTTPClient
+  virtual int post(const char* url, const char* contentType, const char* body, size_t length) = 0;
+  // Transports that talk to a module in steps (esp8266_http.h) take the
+  // request here and return HTTP_PENDING; pollPost() then moves it on a
+  // step per call and returns the status once there is one. The body
+  // must stay put until then. Others post there and then.
+  virtual int startPost(const char* url, const char* contentType, const char* body, size_t length) {
+    return post(url, contentType, body, length);
+  }
+  virtual int pollPost() { return -1; }
+};
+
+// Push channel to the dashboard (WebSocketsClient on the ESP32)
+class MessageChannel {
+public:
+  virtual void loop() = 0;
+  virtual bool isConnected() = 0;
+  virtual bool sendText(const char* text, size_t length) = 0;
+};
+
+// Small monochrome status display (SSD1306)
+class TextDisplay {
+public:
+  virtual void clear() = 0;
+  // size 1 is the small status font, 2 the large vitals font
+  virtual void drawText(int16_t x, int16_t y, const char* text, uint8_t size) = 0;
+  virtual void flush() = 0;
+  // Displays that send a flushed frame in steps (oled_renderer.h) send
+  // the next one here; true while there is more to send
+  virtual bool poll() { return false; }
+};
+
+// The SSD1306 controller on I2C, driven a page and a few columns at a
+// time by oled_renderer.h. Each call is one I2C transaction.
+class OledBus {
+public:
+  // Control byte 0x00: command bytes
+  virtual bool command(const uint8_t* bytes, uint8_t length) = 0;
+  // Control byte 0x40: display RAM from the current address on
+  virtual bool data(const uint8_t* bytes, uint8_t length) = 0;
+};
+
+// Listening TCP socket and its connections (AsyncTCP on the ESP32), for
+// http_server.h. Connections are numbered from 0 and nothing may block.
+class TcpServerPort {
+public:
+  // A newly accepted connection, or -1
+  virtual int accept() = 0;
+  // Up to length received bytes; 0 when none are waiting, -1 once the
+  // peer has gone. With length 0 it only checks for the latter.
+  virtual int read(uint8_t connection, uint8_t* out, size_t length) = 0;
+  // Queues bytes to send and returns how many were taken. stable data
+  // (flash) stays valid until sent, so it need not be copied.
+  virtual size_t write(uint8_t connection, const uint8_t* data, size_t length, bool stable) = 0;
+  virtual void close(uint8_t connection) = 0;
+};
+
+enum TcpStatus {
+  TCP_CLOSED,
+  TCP_CONNECTING,
+  TCP_CONNECTED
+};
+
+// Outgoing TCP connection (AsyncClient on the ESP32), for mqtt_client.h.
+// connect() only starts it; status() follows it. Nothing may block.
+class TcpClientPort {
+public:
+  virtual bool connect(const char* host, uint16_t port) = 0;
+  virtual uint8_t status() = 0;
+  // Up to length received bytes; 0 when none are waiting
+  virtual int read(uint8_t* out, size_t length) = 0;
+  // Queues bytes to send and returns how many were taken
+  virtual size_t write(const uint8_t* data, size_t length) = 0;
+  virtual void close() = 0;
+};
+
+// Flash partition, SD card or file holding the store-and-forward log
+// (record_log.h) or the vitals history (history_log.h). Erased bytes read 0xFF; write() is only ever asked to
+// program erased bytes, so it may behave like NOR flash.
+class LogStorage {
+public:
+  // A whole number of erase blocks
+  virtual uint32_t size() = 0;
+  virtual uint32_t eraseSize() = 0;
+  virtual bool read(uint32_t offset, uint8_t* data, size_t length) = 0;
+  virtual bool write(uint32_t offset, const uint8_t* data, size_t length) = 0;
+  // Sets the erase block starting at offset back to 0xFF
+  virtual bool erase(uint32_t offset) = 0;
+};
+
+// Wall clock (SNTP on the ESP32); returns false until time is known,
+// without waiting for it: it is called from the monitor's loop
+typedef bool (*LocalTimeFn)(struct tm* out);
+
+// Battery charge in %, or TELEMETRY_BATTERY_UNKNOWN without a battery sense
+typedef uint8_t (*BatteryLevelFn)();
+
+// Lets the board light-sleep through idle time (duty_cycle.h), or not
+typedef void (*LowPowerFn)(bool enabled);
+
+#endif
@@ -0,0 +1,688 @@
+/*
+ * RescueNet AI - Health monitor core
+ */
+
+#include "health_monitor.h"
+
+static_assert(EMERGENCY_SMS_MAX <= SIM800L_SMS_MAX, "the emergency SMS must fit the modem buffer");
+
+namespace {
+
+// PPG samples the MAX3010x FIFO holds
+const uint16_t PPG_FIFO_DEPTH = 32;
+
+// A stretched drain period, held to what fills a quarter less than the
+// buffer between drains at rateHz
+uint32_t drainPeriod(uint32_t periodMs, uint8_t stretch, uint16_t rateHz, uint16_t depth) {
+  uint32_t stretched = periodMs * stretch;
+  if (rateHz == 0) return stretched;
+  uint32_t limit = (uint32_t)depth * 750 / rateHz;
+  if (limit < periodMs) limit = periodMs;
+  return stretched < limit ? stretched : limit;
+}
+
+}  // namespace
+
+HealthMonitor::HealthMonitor(const MonitorHal& hal, const MonitorConfig& config)
+  : hal(hal), config(config), ppg(hal.ppg), motion(hal.imu), temps(hal.temp),
+    uploader(hal.http, config.healthDataUrl, config.binaryTelemetry ? UPLOAD_BINARY : UPLOAD_JSON),
+    mode(MONITOR_SINGLE_LOOP), heartRateTracker(HEART_RATE_LIMITS), temperatureTracker(TEMP_LIMITS),
+    exertionSamples(0), exertionMoving(0), exertion(false), ppgId(NO_TASK), motionId(NO_TASK), buttonId(NO_TASK),
+    alarmId(NO_TASK), vitalsId(NO_TASK), channelId(NO_TASK), modemId(NO_TASK), displayPollId(NO_TASK), uploadId(NO_TASK),
+    emergencyDetected(false), fallDetected(false),
+    wifiConnected(false), manualEmergencyRequested(false), displayHoldUntil(0), responseFlashes(0),
+    buttonPressTime(0), buttonPressed(false), telemetrySequence(0),
+    batteryLevel(TELEMETRY_BATTERY_UNKNOWN) {
+  memset(&current, 0, sizeof(current));
+}
+
+void HealthMonitor::begin(MonitorMode loopMode) {
+  LOG_PORT.println("Initializing sensors...");
+
+  // The Nano has a single loop whatever the sketch asks for
+  mode = MONITOR_PIPELINE_ENABLED ? loopMode : MONITOR_SINGLE_LOOP;
+  Scheduler& network = networkTasks();
+
+  if (hal.temp) {
+    LOG_PORT.print("Temperature probes: ");
+    LOG_PORT.println(temps.begin());
+  }
+
+  bool imuReady = false;
+  if (hal.imu) {
+#if HR_FUSION_ENABLED
+    // The IMU stream is the PPG's motion reference (heart_rate_fusion.h)
+    if (hal.ppg) motion.setFusion(&fusion);
+#endif
+    imuReady = hal.imu->begin() && motion.begin();
+    if (imuReady) {
+      LOG_PORT.println("MPU6050 initialized");
+    } else {
+      LOG_PORT.println("Failed to initialize MPU6050");
+    }
+  }
+
+  if (hal.ppg) {
+#if HR_FUSION_ENABLED
+    ppg.setFusion(imuReady ? &fusion : nullptr);
+#endif
+    if (hal.ppg->begin() && ppg.begin()) {
+      LOG_PORT.println("MAX30105 initialized");
+    } else {
+      LOG_PORT.println("Failed to initialize MAX30105");
+    }
+  }
+
+  if (hal.backlog) {
+    if (hal.backlog->begin()) {
+      uploader.setBacklog(hal.backlog, config.emergencyUrl);
+      LOG_PORT.print("Backlog records to send: ");
+      LOG_PORT.println((unsigned long)hal.backlog->pending());
+    } else {
+      LOG_PORT.println("Backlog storage unavailable");
+    }
+  }
+
+  if (hal.display) {
+    hal.display->clear();
+    hal.display->drawText(0, 0, "RescueNet AI", 1);
+    hal.display->drawText(0, 16, "Initializing...", 1);
+    hal.display->flush();
+  }
+
+  // Sensor FIFOs first so they are drained ahead of slower work
+  ppgId = scheduler.every(MONITOR_PPG_TASK_MS, ppgTask, this, PSTR("ppg"));
+  motionId = scheduler.every(MONITOR_MOTION_TASK_MS, motionTask, this, PSTR("motion"));
+  buttonId = scheduler.every(MONITOR_BUTTON_TASK_MS, buttonTask, this, PSTR("button"));
+  if (hal.channel) channelId = network.every(MONITOR_CHANNEL_TASK_MS, channelTask, this, PSTR("channel"));
+  if (hal.modem) modemId = network.every(MONITOR_MODEM_TASK_MS, modemTask, this, PSTR("modem"));
+  alarmId = scheduler.every(MONITOR_ALARM_TASK_MS, alarmTask, this, PSTR("alarm"));
+  vitalsId = scheduler.every(MONITOR_VITALS_TASK_MS, vitalsTask, this, PSTR("vitals"), MONITOR_VITALS_TASK_MS);
+  scheduler.every(MONITOR_DISPLAY_TASK_MS, displayTask, this, PSTR("display"), MONITOR_DISPLAY_TASK_MS);
+  // Dormant until a frame is flushed; the splash above is one already
+  if (hal.display) {
+    displayPollId = scheduler.dormant(displayPollTask, this, PSTR("display poll"));
+    scheduler.wake(displayPollId, 0);
+  }
+  if (hal.gps) scheduler.every(MONITOR_GPS_TASK_MS, gpsTask, this, PSTR("gps"));
+  if (pipelined()) {
+    scheduler.every(MONITOR_EVENTS_TASK_MS, eventsTask, this, PSTR("events"));
+    network.every(MONITOR_JOBS_TASK_MS, jobsTask, this, PSTR("jobs"));
+  }
+  // Registered last, so it is the first to fail when the table is full
+  uploadId = network.every(MONITOR_UPLOAD_TASK_MS, uploadTask, this, PSTR("upload"));
+  if (uploadId == NO_TASK) {
+    LOG_PORT.println("Scheduler full; raise SCHEDULER_MAX_TASKS");
+  }
+
+  duty.begin(config.powerPolicy, millis());
+  // Pipelined, the network loop applies its part on its first pass
+  applyProfile();
+}
+
+void HealthMonitor::loop() {
+  runLoop(scheduler);
+}
+
+void HealthMonitor::networkLoop() {
+#if MONITOR_PIPELINE_ENABLED
+  // The acquisition loop changed the profile since the last pass
+  uint8_t policy, level;
+  if (pipelined() && pipeline.takeProfile(policy, level)) {
+    applyNetworkProfile(dutyProfile((PowerPolicy)policy, (ActivityLevel)level));
+  }
+#endif
+  runLoop(networkTasks());
+}
+
+void HealthMonitor::runLoop(Scheduler& tasks) {
+  tasks.run();
+  uint32_t idle = tasks.idleMs();
+  // The board only sleeps when both cores are idle, and the acquisition
+  // loop's periods are the shorter ones
+  if (&tasks == &scheduler) duty.idle(idle);
+  if (idle) delay(idle);
+}
+
+void HealthMonitor::wakeUp() {
+  if (duty.poke(millis())) applyProfile();
+}
+
+void HealthMonitor::updateDuty() {
+  // Close to a threshold is reason enough to watch closely
+  bool nearLimit = current.temperature > temperatureTracker.highLimit() - DUTY_TEMP_MARGIN ||
+                   current.temperature < temperatureTracker.lowLimit() + DUTY_TEMP_MARGIN;
+  // A rate too doubtful to alert on is too doubtful to wake up for
+  float heartRate = current.heartRateConfidence >= HR_ALERT_MIN_CONFIDENCE ? current.heartRate : 0;
+  if (heartRate > 0) {
+    nearLimit |= heartRate > heartRateTracker.highLimit() - DUTY_HR_MARGIN ||
+                 heartRate < heartRateTracker.lowLimit() + DUTY_HR_MARGIN;
+  }
+  DutyInputs in = {heartRate, current.temperature, motion.stats().samplesProcessed,
+                   motion.stats().movingSamples, nearLimit, emergencyDetected};
+  if (duty.update(in, batteryLevel, millis())) applyProfile();
+}
+
+void HealthMonitor::applyProfile() {
+  const DutyProfile& profile = duty.profile();
+  uint8_t stretch = profile.pollStretch;
+
+  if (hal.ppg && ppg.outputRateHz() != profile.ppgRateHz / profile.ppgAveraging) {
+    // Whatever was sampled at the old rate goes through first
+    while (ppg.poll()) ppg.process();
+    ppg.process();
+    ppg.setRate(profile.ppgRateHz, profile.ppgAveraging);
+  }
+  uint16_t ppgDepth = PPG_RING_SIZE < PPG_FIFO_DEPTH ? PPG_RING_SIZE : PPG_FIFO_DEPTH;
+  scheduler.setPeriod(ppgId, drainPeriod(MONITOR_PPG_TASK_MS, stretch, ppg.outputRateHz(), ppgDepth));
+  scheduler.setPeriod(motionId, drainPeriod(MONITOR_MOTION_TASK_MS, stretch, motion.outputRateHz(), MOTION_RING_SIZE));
+  scheduler.setPeriod(buttonId, MONITOR_BUTTON_TASK_MS * stretch);
+  scheduler.setPeriod(alarmId, MONITOR_ALARM_TASK_MS * stretch);
+  scheduler.setPeriod(vitalsId, profile.vitalsMs);
+  if (hal.lowPower) hal.lowPower(profile.lightSleep);
+
+#if MONITOR_PIPELINE_ENABLED
+  if (pipelined()) {
+    pipeline.publishProfile(duty.policy(), duty.level());
+    return;
+  }
+#endif
+  applyNetworkProfile(profile);
+}
+
+void HealthMonitor::applyNetworkProfile(const DutyProfile& profile) {
+  Scheduler& network = networkTasks();
+  network.setPeriod(channelId, MONITOR_CHANNEL_TASK_MS * profile.pollStretch);
+  network.setPeriod(modemId, MONITOR_MODEM_TASK_MS * profile.pollStretch);
+  uploader.setBatching(profile.uploadBatch, profile.uploadAgeMs);
+}
+
+Scheduler& HealthMonitor::networkTasks() {
+#if MONITOR_PIPELINE_ENABLED
+  if (pipelined()) return networkScheduler;
+#endif
+  return scheduler;
+}
+
+void HealthMonitor::ppgTask(void* self) {
+  // Drain the PPG FIFO and run beat detection on every new sample
+  HealthMonitor* monitor = static_cast<HealthMonitor*>(self);
+  while (monitor->ppg.poll()) monitor->ppg.process();
+  monitor->ppg.process();
+}
+
+void HealthMonitor::motionTask(void* self) {
+  // Same for the IMU FIFO; a confirmed fall is acted on right away
+  HealthMonitor* monitor = static_cast<HealthMonitor*>(self);
+  while (monitor->motion.poll()) monitor->motion.process();
+  monitor->motion.process();
+  if (monitor->motion.takeFall()) {
+    monitor->fallDetected = true;
+    if (!monitor->emergencyDetected) monitor->triggerEmergency("Fall detected");
+  }
+}
+
+void HealthMonitor::buttonTask(void* self) {
+  static_cast<HealthMonitor*>(self)->checkEmergencyButton();
+}
+
+void HealthMonitor::channelTask(void* self) {
+  // Handle WebSocket
+  static_cast<HealthMonitor*>(self)->hal.channel->loop();
+}
+
+void HealthMonitor::modemTask(void* self) {
+  // Advance SIM800L setup, SMS and status checks
+  static_cast<HealthMonitor*>(self)->hal.modem->poll();
+}
+
+void HealthMonitor::alarmTask(void* self) {
+  HealthMonitor* monitor = static_cast<HealthMonitor*>(self);
+  if (monitor->responseFlashes > 0) {
+    // Flash LED to indicate a response from the dashboard
+    monitor->responseFlashes--;
+    digitalWrite(monitor->config.emergencyLedPin, monitor->responseFlashes % 2 ? HIGH : LOW);
+  } else if (monitor->emergencyDetected) {
+    monitor->handleEmergency();
+  }
+}
+
+void HealthMonitor::vitalsTask(void* self) {
+  HealthMonitor* monitor = static_cast<HealthMonitor*>(self);
+  monitor->readSensors();
+  monitor->detectEmergency();
+  monitor->updateDuty();
+  // Every reading goes into the upload batch
+  TelemetryRecord record;
+  monitor->fillRecord(record, TELEMETRY_HEALTH, nullptr);
+  if (!monitor->handOff(PIPELINE_JOB_READING, record)) monitor->uploader.add(record);
+}
+
+void HealthMonitor::displayTask(void* self) {
+  HealthMonitor* monitor = static_cast<HealthMonitor*>(self);
+  // Leave a displayMessage() up for its hold time
+  if ((long)(millis() - monitor->displayHoldUntil) < 0) return;
+  monitor->updateDisplay();
+}
+
+void HealthMonitor::displayPollTask(void* self) {
+  HealthMonitor* monitor = static_cast<HealthMonitor*>(self);
+  // One I2C transaction per run; back to sleep once the frame is out
+  if (monitor->hal.display->poll()) monitor->scheduler.wake(monitor->displayPollId, MONITOR_DISPLAY_POLL_MS);
+}
+
+void HealthMonitor::gpsTask(void* self) {
+  HealthMonitor* monitor = static_cast<HealthMonitor*>(self);
+  monitor->hal.gps->poll();
+}
+
+void HealthMonitor::uploadTask(void* self) {
+  HealthMonitor* monitor = static_cast<HealthMonitor*>(self);
+  uint32_t busy = monitor->uploader.stats().busyMsTotal;
+  monitor->uploader.poll(monitor->wifiConnected);
+  monitor->addRadio(monitor->uploader.stats().busyMsTotal - busy);
+  // A post going out in steps takes the next one soon
+  if (monitor->uploader.busy()) monitor->networkTasks().wake(monitor->uploadId, MONITOR_UPLOAD_STEP_MS);
+}
+
+void HealthMonitor::eventsTask(void* self) {
+#if MONITOR_PIPELINE_ENABLED
+  HealthMonitor* monitor = static_cast<HealthMonitor*>(self);
+  monitor->pipeline.retryHeld();
+  monitor->duty.addRadio(monitor->pipeline.takeRadioMs());
+  PipelineEvent event;
+  while (monitor->pipeline.takeEvent(event)) monitor->showEvent(event.kind, event.ok, event.text);
+#endif
+}
+
+void HealthMonitor::jobsTask(void* self) {
+#if MONITOR_PIPELINE_ENABLED
+  HealthMonitor* monitor = static_cast<HealthMonitor*>(self);
+  PipelineJob job;
+  while (monitor->pipeline.takeJob(job)) {
+    TelemetryRecord record;
+    char userId[TELEMETRY_USER_ID_MAX + 1];
+    char reason[TELEMETRY_REASON_MAX + 1];
+    if (!decodeTelemetry(job.record, job.length, record, userId, reason)) continue;
+    if (job.kind == PIPELINE_JOB_READING) {
+      monitor->uploader.add(record);
+      continue;
+    }
+    uint32_t started = micros();
+    monitor->sendEmergencyAlert(record, job.record, job.length);
+    monitor->sendEmergencySMS(record);
+    monitor->pipeline.alertWork().add(micros() - started);
+  }
+#endif
+}
+
+void HealthMonitor::readSensors() {
+  if (hal.batteryLevel) batteryLevel = hal.batteryLevel();
+
+  // The conversion the last reading started is done by now; the next
+  // one runs until the reading after
+  if (hal.temp) {
+    temps.poll();
+    current.temperature = temps.celsius();
+    if (current.temperature == TEMP_DISCONNECTED_C) {
+      current.temperature = 36.5 + random(-10, 10) / 10.0;  // Fallback simulation
+    }
+  }
+
+  // Latest accelerometer sample from the IMU stream
+  if (hal.imu) {
+    const ImuSample& motionSample = motion.lastSample();
+    current.accelX = motionSample.ax * (9.80665 / IMU_ACCEL_LSB_PER_G);
+    current.accelY = motionSample.ay * (9.80665 / IMU_ACCEL_LSB_PER_G);
+    current.accelZ = motionSample.az * (9.80665 / IMU_ACCEL_LSB_PER_G);
+  }
+
+  // Moving since the last reading: a raised heart rate or skin
+  // temperature is no deviation then
+  const MotionStats& motionStats = motion.stats();
+  uint32_t samples = motionStats.samplesProcessed - exertionSamples;
+  uint32_t moving = motionStats.movingSamples - exertionMoving;
+  exertionSamples = motionStats.samplesProcessed;
+  exertionMoving = motionStats.movingSamples;
+  exertion = samples > 0 && moving * 100 > samples * DUTY_MOVING_PERCENT;
+
+  // Heart rate and SpO2 are tracked continuously by the PPG stream
+  current.heartRate = ppg.heartRate();
+  current.heartRateConfidence = ppg.heartRateConfidence();
+#if !HR_FUSION_ENABLED
+  // Nothing cancels the motion artifact here, so a rate measured while
+  // moving may be the step rate: keep it, but not for alerting
+  if (exertion) current.heartRateConfidence = 0;
+#endif
+  current.spO2 = ppg.spo2().spO2Tenths() / 10.0;
+
+  // Simulate blood pressure (would need actual BP sensor)
+  current.bloodPressure = 100 + random(-20, 40);
+
+  LOG_PORT.print("Vitals - HR: ");
+  LOG_PORT.print(current.heartRate, 1);
+  LOG_PORT.print(" (");
+  LOG_PORT.print(current.heartRateConfidence);
+  LOG_PORT.print("%), SpO2: ");
+  LOG_PORT.print(current.spO2, 1);
+  LOG_PORT.print(", Temp: ");
+  LOG_PORT.print(current.temperature, 1);
+  LOG_PORT.print("C, BP: ");
+  LOG_PORT.print(current.bloodPressure, 1);
+  LOG_PORT.print(", Accel: ");
+  LOG_PORT.print(current.accelX, 1);
+  LOG_PORT.print(",");
+  LOG_PORT.print(current.accelY, 1);
+  LOG_PORT.print(",");
+  LOG_PORT.println(current.accelZ, 1);
+}
+
+void HealthMonitor::detectEmergency() {
+  bool emergency = false;
+  TextBuffer<ALERT_REASON_MAX> reason;
+
+
+  // Check vital signs against the wearer's baselines; 0 means no beat
+  // has been measured yet, a low confidence one the motion may have made
+  bool heartRateTrusted = current.heartRate > 0 && current.heartRateConfidence >= HR_ALERT_MIN_CONFIDENCE;
+  if (heartRateTrusted && heartRateTracker.update(current.heartRate, exertion)) {
+    emergency = true;
+    formatMessage(reason, PSTR(ALERT_HEART_RATE_TEMPLATE), current.heartRate);
+  }
+
+  if (temperatureTracker.update(current.temperature, exertion)) {
+    emergency = true;
+    if (reason.length() > 0) reason.add(ALERT_REASON_SEPARATOR);
+    formatMessage(reason, PSTR(ALERT_TEMPERATURE_TEMPLATE), current.temperature);
+  }
+
+  // Falls are handled in motionTask() by the fall detector, on every IMU sample
+
+  if (emergency && !emergencyDetected) {
+    emergencyDetected = true;
+    triggerEmergency(reason.c_str());
+  }
+}
+
+void HealthMonitor::checkEmergencyButton() {
+  if (manualEmergencyRequested) {
+    manualEmergencyRequested = false;
+    wakeUp();
+    triggerEmergency("Manual emergency button pressed");
+  }
+
+  if (config.buttonPin == NO_PIN) return;
+
+  bool currentState = digitalRead(config.buttonPin) == LOW;
+
+  if (currentState && !buttonPressed) {
+    buttonPressTime = millis();
+    buttonPressed = true;
+    // Polled at the active rate while held, so a release is seen on time
+    wakeUp();
+  } else if (!currentState && buttonPressed) {
+    buttonPressed = false;
+    // Check if button was held for more than 2 seconds
+    if (millis() - buttonPressTime > 2000) {
+      triggerEmergency("Manual emergency button pressed");
+    }
+  }
+}
+
+void HealthMonitor::triggerEmergency(const char* reason) {
+  LOG_PORT.print("EMERGENCY TRIGGERED: ");
+  LOG_PORT.println(reason);
+
+  emergencyDetected = true;
+  wakeUp();
+
+  // Visual and audio alerts
+  digitalWrite(config.emergencyLedPin, HIGH);
+  tone(config.buzzerPin, 2000, 1000);
+
+  TextBuffer<20> shortReason;
+  shortReason.add(reason);
+  displayMessage("EMERGENCY!", shortReason.c_str());
+
+  TelemetryRecord alert;
+  fillRecord(alert, TELEMETRY_EMERGENCY, reason);
+  if (handOff(PIPELINE_JOB_ALERT, alert)) return;
+
+  // Send emergency notification to the server
+  uint8_t record[TELEMETRY_MAX_SIZE];
+  size_t length = encodeTelemetry(alert, record, sizeof(record));
+  sendEmergencyAlert(alert, record, length);
+
+  // Send emergency SMS
+  sendEmergencySMS(alert);
+}
+
+void HealthMonitor::handleEmergency() {
+  // Flash emergency LED
+  static unsigned long lastFlash = 0;
+  if (millis() - lastFlash > 500) {
+    digitalWrite(config.emergencyLedPin, !digitalRead(config.emergencyLedPin));
+    lastFlash = millis();
+  }
+
+  // Periodic emergency beep
+  static unsigned long lastBeep = 0;
+  if (millis() - lastBeep > 5000) {
+    tone(config.buzzerPin, 1500, 200);
+    lastBeep = millis();
+  }
+}
+
+void HealthMonitor::fillRecord(TelemetryRecord& record, uint8_t kind, const char* reason) {
+  memset(&record, 0, sizeof(record));
+  record.kind = kind;
+  record.sequence = telemetrySequence++;
+  record.userId = config.userId;
+  record.reason = reason;
+
+  struct tm timeinfo;
+  if (hal.localTime && hal.localTime(&timeinfo)) {
+    record.timestamp = telemetrySeconds(timeinfo);
+    record.flags |= TELEMETRY_FLAG_WALL_CLOCK;
+  } else if (hal.gps && hal.gps->hasFix() && hal.gps->fix().utcSeconds) {
+    // No NTP: the last fix's UTC, moved on by the time since
+    const GpsFix& fix = hal.gps->fix();
+    record.timestamp = fix.utcSeconds + (millis() - fix.receivedMs + fix.utcMillis) / 1000;
+    record.flags |= TELEMETRY_FLAG_WALL_CLOCK;
+  } else {
+    record.timestamp = millis();
+  }
+  if (fallDetected) record.flags |= TELEMETRY_FLAG_FALL;
+  if (emergencyDetected) record.flags |= TELEMETRY_FLAG_EMERGENCY;
+
+  record.heartRate = current.heartRate;
+  record.spO2 = current.spO2;
+  record.temperature = current.temperature;
+  record.bloodPressureSys = current.bloodPressure;
+  if (hal.gps && hal.gps->hasFix()) {
+    const GpsFix& fix = hal.gps->fix();
+    record.flags |= TELEMETRY_FLAG_LOCATION;
+    record.latitude = fix.latitude / 1e7;
+    record.longitude = fix.longitude / 1e7;
+    record.altitude = fix.altitudeMm / 1000.0f;
+  }
+  record.accelX = current.accelX;
+  record.accelY = current.accelY;
+  record.accelZ = current.accelZ;
+  record.batteryLevel = batteryLevel;
+}
+
+bool HealthMonitor::handOff(uint8_t kind, const TelemetryRecord& record) {
+#if MONITOR_PIPELINE_ENABLED
+  if (pipelined()) {
+    uint8_t bytes[TELEMETRY_MAX_SIZE];
+    pipeline.submit(kind, bytes, encodeTelemetry(record, bytes, sizeof(bytes)));
+    return true;
+  }
+#endif
+  return false;
+}
+
+void HealthMonitor::sendHealthData() {
+  TelemetryRecord record;
+  fillRecord(record, TELEMETRY_HEALTH, nullptr);
+  // Pipelined, the network loop's upload task sends it
+  if (handOff(PIPELINE_JOB_READING, record)) return;
+  uploader.add(record);
+  // Over HTTP only: the server relays readings to the dashboard
+  if (wifiConnected) {
+    uint32_t busy = uploader.stats().busyMsTotal;
+    uploader.flush();
+    addRadio(uploader.stats().busyMsTotal - busy);
+  }
+}
+
+void HealthMonitor::sendEmergencyAlert(const TelemetryRecord& alert, const uint8_t* record, size_t length) {
+  int httpResponseCode = -1;
+  if (wifiConnected && hal.http) {
+    uint32_t started = millis();
+    if (config.binaryTelemetry) {
+      httpResponseCode = hal.http->post(config.emergencyUrl, TELEMETRY_CONTENT_TYPE, (const char*)record, length);
+    } else {
+      httpResponseCode = postAlertJson(alert);
+    }
+    addRadio(millis() - started);
+
+    LOG_PORT.print(httpResponseCode > 0 ? "Emergency alert sent: " : "Failed to send emergency alert: ");
+    LOG_PORT.println(httpResponseCode);
+  }
+
+  // Replayed as a binary record, which the server takes from any device
+  if ((httpResponseCode < 200 || httpResponseCode >= 300) && uploader.storeAlert(record, length)) {
+    LOG_PORT.println("Emergency alert stored for later");
+  }
+}
+
+void HealthMonitor::addRadio(uint32_t ms) {
+#if MONITOR_PIPELINE_ENABLED
+  // The ledger belongs to the acquisition loop, which takes it from there
+  if (pipelined()) {
+    pipeline.addRadioMs(ms);
+    return;
+  }
+#endif
+  duty.addRadio(ms);
+}
+
+int HealthMonitor::postAlertJson(const TelemetryRecord& alert) {
+  // Its own frame, so boards posting binary records never carry the buffer
+  TextBuffer<ALERT_JSON_MAX> json;
+  writeAlertJson(json, alert);
+  return hal.http->post(config.emergencyUrl, "application/json", json.c_str(), json.length());
+}
+
+void HealthMonitor::sendEmergencySMS(const TelemetryRecord& alert) {
+  if (!hal.modem || !hal.modem->isReady()) {
+    LOG_PORT.println("Cannot send emergency SMS - SIM800L not ready");
+    return;
+  }
+
+  // The modem keeps its own copy until the message is out
+  TextBuffer<EMERGENCY_SMS_MAX> emergencyMessage;
+  formatMessage(emergencyMessage, PSTR(EMERGENCY_SMS_TEMPLATE), config.userId,
+                messageTime(alert.timestamp, (alert.flags & TELEMETRY_FLAG_WALL_CLOCK) != 0), alert.heartRate,
+                alert.temperature, alert.spO2);
+  if (alert.flags & TELEMETRY_FLAG_LOCATION) {
+    formatMessage(emergencyMessage, PSTR(EMERGENCY_SMS_LOCATION_TEMPLATE), alert.latitude, alert.longitude);
+  } else {
+    formatMessage(emergencyMessage, PSTR(EMERGENCY_SMS_NO_LOCATION));
+  }
+  formatMessage(emergencyMessage, PSTR(EMERGENCY_SMS_END));
+
+  // Send to emergency contact; the modem reports back from its task
+  if (!hal.modem->sendSMS(config.emergencyContact, emergencyMessage.c_str(), smsResult, this)) {
+    smsResult(false, this);
+  }
+}
+
+void HealthMonitor::smsResult(bool sent, void* self) {
+  HealthMonitor* monitor = static_cast<HealthMonitor*>(self);
+  LOG_PORT.println(sent ? "Emergency SMS sent successfully" : "Failed to send emergency SMS");
+#if MONITOR_PIPELINE_ENABLED
+  if (monitor->pipelined()) {
+    monitor->pipeline.post(PIPELINE_EVENT_SMS, sent, nullptr);
+    return;
+  }
+#endif
+  monitor->showEvent(PIPELINE_EVENT_SMS, sent, nullptr);
+}
+
+void HealthMonitor::handleServerMessage(const char* type, const char* message) {
+  uint8_t kind;
+  if (strcmp(type, "emergency_response") == 0) {
+    kind = PIPELINE_EVENT_RESPONSE;
+  } else if (strcmp(type, "health_alert") == 0) {
+    kind = PIPELINE_EVENT_ALERT;
+  } else {
+    return;
+  }
+#if MONITOR_PIPELINE_ENABLED
+  if (pipelined()) {
+    pipeline.post(kind, true, message);
+    return;
+  }
+#endif
+  showEvent(kind, true, message);
+}
+
+void HealthMonitor::showEvent(uint8_t kind, bool ok, const char* text) {
+  // Someone is dealing with the wearer
+  wakeUp();
+  switch (kind) {
+    case PIPELINE_EVENT_RESPONSE:
+      LOG_PORT.println("Emergency response received!");
+      displayMessage("Emergency", "Help is coming!");
+      // Flash LED to indicate response; ten flashes from the alarm task
+      responseFlashes = 20;
+      break;
+    case PIPELINE_EVENT_ALERT:
+      displayMessage("Health Alert", text);
+      tone(config.buzzerPin, 1000, 500);
+      break;
+    case PIPELINE_EVENT_SMS:
+      if (ok) {
+        displayMessage("Emergency SMS", "Sent to contact");
+      } else {
+        displayMessage("SMS Failed", "Check SIM card");
+      }
+      break;
+  }
+}
+
+void HealthMonitor::updateDisplay() {
+  if (!hal.display) return;
+
+  hal.display->clear();
+
+  // Title and WiFi status
+  hal.display->drawText(0, 0, "RescueNet AI", 1);
+  hal.display->drawText(85, 0, wifiConnected ? "WiFi OK" : "No WiFi", 1);
+
+  // Vitals
+  TextBuffer<DISPLAY_LINE_MAX> line;
+  formatMessage(line, PSTR(DISPLAY_HEART_RATE_TEMPLATE), current.heartRate);
+  hal.display->drawText(0, 16, line.c_str(), 2);
+  line.clear();
+  formatMessage(line, PSTR(DISPLAY_TEMPERATURE_TEMPLATE), current.temperature);
+  hal.display->drawText(0, 32, line.c_str(), 2);
+  hal.display->drawText(0, 48, emergencyDetected ? "Status: EMERGENCY" : "Status: Normal", 1);
+
+  hal.display->flush();
+  scheduler.wake(displayPollId, 0);
+}
+
+void HealthMonitor::displayMessage(const char* title, const char* message) {
+  if (!hal.display) return;
+
+  hal.display->clear();
+  hal.display->drawText(0, 0, title, 2);
+  hal.display->drawText(0, 20, message, 1);
+  hal.display->flush();
+  scheduler.wake(displayPollId, 0);
+  displayHoldUntil = millis() + config.messageHoldMs;
+}
@@ -0,0 +1,246 @@
+/*
+ * RescueNet AI - Health monitor core
+ *
+ * The sensor polling, emergency detection and reporting logic shared by
+ * the ESP32 and Nano sketches. Everything board specific is reached
+ * through the HAL (hal.h), so this file builds unchanged for both boards
+ * and for the host simulator.
+ *
+ * On the ESP32 the work can be split over both cores (monitor_pipeline.h):
+ * begin(MONITOR_PIPELINED) puts sensing, detection and the local alarm
+ * on tasks() and run by loop(), and uploads, the alert POST, the SMS and
+ * the dashboard channel on networkTasks() and run by networkLoop(), each
+ * loop on a FreeRTOS task of its own.
+ *
+ * config.powerPolicy lets the readings drive the task periods, the PPG
+ * sample rate and light sleep (duty_cycle.h).
+ */
+
+#ifndef RESCUENET_HEALTH_MONITOR_H
+#define RESCUENET_HEALTH_MONITOR_H
+
+#include "anomaly_detector.h"
+#include "duty_cycle.h"
+#include "gps_receiver.h"
+#include "hal.h"
+#include "messages.h"
+#include "monitor_pipeline.h"
+#include "motion_acquisition.h"
+#include "ppg_acquisition.h"
+#include "scheduler.h"
+#include "sim800l.h"
+#include "telemetry.h"
+#include "telemetry_uploader.h"
+#include "temp_probes.h"
+
+#define NO_PIN 0xFF
+
+struct Vitals {
+  float heartRate;
+  uint8_t heartRateConfidence;  // 0..100, HeartRateFusion; 0 while moving without it
+  float temperature;
+  float bloodPressure;  // Simulated; there is no BP sensor yet
+  float spO2;
+  float accelX, accelY, accelZ;
+};
+
+// Board drivers; any pointer may be null when the board lacks the part
+struct MonitorHal {
+  PpgSensor* ppg;
+  ImuSensor* imu;
+  TempSensor* temp;
+  HttpPort* http;
+  MessageChannel* channel;
+  Sim800l* modem;
+  TextDisplay* display;
+  LocalTimeFn localTime;
+  RecordLog* backlog;  // Keeps readings and alerts through offline periods
+  BatteryLevelFn batteryLevel;
+  LowPowerFn lowPower;
+  GpsReceiver* gps;    // Location and, without NTP, the time for records
+};
+
+struct MonitorConfig {
+  const char* userId;
+  const char* healthDataUrl;
+  const char* emergencyUrl;
+  const char* emergencyContact;
+  uint8_t buzzerPin;
+  uint8_t statusLedPin;
+  uint8_t emergencyLedPin;
+  uint8_t buttonPin;        // NO_PIN when the sketch reports presses itself
+  unsigned long messageHoldMs;  // How long displayMessage() keeps a message up
+  bool binaryTelemetry;         // Post telemetry.h records instead of JSON
+  uint8_t powerPolicy;          // PowerPolicy (duty_cycle.h); POWER_FIXED is the fixed schedule
+};
+
+// Task periods; sensor FIFOs must be drained well inside their depth.
+// The duty cycle stretches the polls and sets the vitals period.
+#define MONITOR_PPG_TASK_MS 40
+#define MONITOR_MOTION_TASK_MS 40
+#define MONITOR_BUTTON_TASK_MS 20
+#define MONITOR_CHANNEL_TASK_MS 10
+#define MONITOR_MODEM_TASK_MS 50
+#define MONITOR_ALARM_TASK_MS 100
+#define MONITOR_VITALS_TASK_MS 5000
+#define MONITOR_DISPLAY_TASK_MS 2000
+#define MONITOR_DISPLAY_POLL_MS 5     // While a frame goes out in steps (oled_renderer.h)
+#define MONITOR_UPLOAD_TASK_MS 1000  // Checks the batch; see telemetry_uploader.h
+#define MONITOR_UPLOAD_STEP_MS 10    // While a post goes out in steps (esp8266_http.h)
+#define MONITOR_GPS_TASK_MS 100      // Inside the UART ring at 9600 baud (gps_receiver.h)
+#define MONITOR_EVENTS_TASK_MS 20    // Pipelined: network results to the display
+#define MONITOR_JOBS_TASK_MS 10      // Pipelined: readings and alerts to send
+
+enum MonitorMode {
+  MONITOR_SINGLE_LOOP,
+  MONITOR_PIPELINED  // Two loops; ignored where MONITOR_PIPELINE_ENABLED is 0
+};
+
+// Emergency thresholds: the band until the wearer's own is learned
+// (anomaly_detector.h)
+const float HEART_RATE_MIN = 50.0;
+const float HEART_RATE_MAX = 120.0;
+const float TEMP_MIN = 35.0;
+const float TEMP_MAX = 38.5;
+// Thresholds, hard limits two readings in a row alert at, least standard deviation
+const VitalLimits HEART_RATE_LIMITS = {HEART_RATE_MIN, HEART_RATE_MAX, 35.0f, 170.0f, 5.0f};
+const VitalLimits TEMP_LIMITS = {TEMP_MIN, TEMP_MAX, 34.5f, 39.5f, 0.25f};
+// Heart rates less trusted than this are reported but never alerted on
+#ifndef HR_ALERT_MIN_CONFIDENCE
+#define HR_ALERT_MIN_CONFIDENCE 50
+#endif
+
+class HealthMonitor {
+public:
+  HealthMonitor(const MonitorHal& hal, const MonitorConfig& config);
+
+  // Registers the monitor's tasks with the scheduler, or both schedulers
+  void begin(MonitorMode mode = MONITOR_SINGLE_LOOP);
+  // Runs whatever is due, then sleeps until the next release. Pipelined,
+  // this is the acquisition loop and networkLoop() the other one.
+  void loop();
+  void networkLoop();
+
+  void readSensors();
+  void detectEmergency();
+  // Queues the current readings and posts the batch right away
+  void sendHealthData();
+  // Alarm and display, then the alert POST and the SMS, handed to the
+  // network loop when pipelined
+  void triggerEmergency(const char* reason);
+
+  // Button pressed on boards that latch it in an ISR
+  void requestManualEmergency() { manualEmergencyRequested = true; }
+  // Message pushed by the dashboard ("emergency_response", "health_alert").
+  // Pipelined, call it from the network loop only.
+  void handleServerMessage(const char* type, const char* message);
+
+  void setNetworkConnected(bool connected) { wifiConnected = connected; }
+  void displayMessage(const char* title, const char* message);
+
+  const Vitals& vitals() const { return current; }
+  const PpgAcquisition& ppgStream() const { return ppg; }
+  const MotionAcquisition& motionStream() const { return motion; }
+  // Probe 0 is the body temperature; sketches may set the others' uses
+  TempProbes& temperatureProbes() { return temps; }
+  const TelemetryUploader& uploads() const { return uploader; }
+  bool inEmergency() const { return emergencyDetected; }
+  const VitalTracker& heartRateBaseline() const { return heartRateTracker; }
+  const VitalTracker& temperatureBaseline() const { return temperatureTracker; }
+  const DutyCycle& dutyCycle() const { return duty; }
+#if POWER_LEDGER_ENABLED
+  // What the monitor did that costs charge since begin() or the last reset
+  const PowerLedger& powerLedger() { return duty.ledger(millis()); }
+  void resetPowerLedger() { duty.resetLedger(millis()); }
+#endif
+  // Sketches may add their own tasks (up to SCHEDULER_MAX_TASKS in all)
+  Scheduler& tasks() { return scheduler; }
+  const Scheduler& tasks() const { return scheduler; }
+  // The network loop's tasks; the same as tasks() in a single loop
+  Scheduler& networkTasks();
+  bool pipelined() const { return mode == MONITOR_PIPELINED; }
+#if MONITOR_PIPELINE_ENABLED
+  const MonitorPipeline& handoff() const { return pipeline; }
+#endif
+
+private:
+  static void ppgTask(void* self);
+  static void motionTask(void* self);
+  static void buttonTask(void* self);
+  static void channelTask(void* self);
+  static void modemTask(void* self);
+  static void alarmTask(void* self);
+  static void vitalsTask(void* self);
+  static void displayTask(void* self);
+  static void displayPollTask(void* self);
+  static void gpsTask(void* self);
+  static void uploadTask(void* self);
+  static void eventsTask(void* self);
+  static void jobsTask(void* self);
+  static void smsResult(bool sent, void* self);
+
+  void checkEmergencyButton();
+  void handleEmergency();
+  void updateDisplay();
+  // Current readings as a telemetry.h record
+  void fillRecord(TelemetryRecord& record, uint8_t kind, const char* reason);
+  // Pipelined: hands the record to the network loop. False in a single
+  // loop, where the caller sends it.
+  bool handOff(uint8_t kind, const TelemetryRecord& record);
+  // Network side of an alert: the POST, or the backlog, then the SMS
+  void sendEmergencyAlert(const TelemetryRecord& alert, const uint8_t* record, size_t length);
+  int postAlertJson(const TelemetryRecord& alert);
+  void sendEmergencySMS(const TelemetryRecord& alert);
+  // Display, LED and buzzer for a result from the network side
+  void showEvent(uint8_t kind, bool ok, const char* text);
+  void runLoop(Scheduler& tasks);
+  // Something is happening: back to the active profile
+  void wakeUp();
+  void updateDuty();
+  // The duty cycle's profile on each loop's tasks; pipelined, the network
+  // loop takes it from the pipeline and applies it itself
+  void applyProfile();
+  void applyNetworkProfile(const DutyProfile& profile);
+  // Time inside HTTP requests, from either loop, for the power ledger
+  void addRadio(uint32_t ms);
+
+  MonitorHal hal;
+  MonitorConfig config;
+  PpgAcquisition ppg;
+  MotionAcquisition motion;
+  TempProbes temps;
+#if HR_FUSION_ENABLED
+  HeartRateFusion fusion;
+#endif
+  Scheduler scheduler;
+  TelemetryUploader uploader;
+  MonitorMode mode;
+  VitalTracker heartRateTracker;
+  VitalTracker temperatureTracker;
+  uint32_t exertionSamples;  // MotionStats at the last reading
+  uint32_t exertionMoving;
+  bool exertion;             // Mostly moving since the reading before
+  DutyCycle duty;
+  TaskId ppgId, motionId, buttonId, alarmId, vitalsId;
+  TaskId channelId, modemId;
+  TaskId displayPollId;
+  TaskId uploadId;
+#if MONITOR_PIPELINE_ENABLED
+  Scheduler networkScheduler;
+  MonitorPipeline pipeline;
+#endif
+
+  Vitals current;
+  bool emergencyDetected;
+  bool fallDetected;
+  volatile bool wifiConnected;  // Set from the network side
+  volatile bool manualEmergencyRequested;
+  unsigned long displayHoldUntil;  // displayMessage() text stays up until then
+  uint8_t responseFlashes;         // LED toggles left after an emergency response
+  unsigned long buttonPressTime;
+  bool buttonPressed;
+  uint16_t telemetrySequence;
+  uint8_t batteryLevel;
+};
+
+#endif
@@ -0,0 +1,192 @@
+/*
+ * RescueNet AI - Motion-aware heart rate fusion
+ */
+
+#include "heart_rate_fusion.h"
+
+#include <math.h>
+#include <string.h>
+
+static_assert(sizeof(HeartRateFusion) <= HR_FUSION_RAM_BUDGET,
+              "HeartRateFusion exceeds its RAM budget on this target");
+
+namespace {
+
+// Same DC tracker as the beat detector: 1/64 per sample
+const uint8_t HP_SHIFT = 6;
+
+// Keeps the NLMS step finite when the reference is all but flat
+const float POWER_FLOOR = HR_FUSION_TAPS * 20.0f * 20.0f;
+
+const float MAX_VARIANCE = 10000.0f;
+
+}  // namespace
+
+HeartRateFusion::HeartRateFusion() : ppgRate(100), motionRate(100) {
+  memset(weights, 0, sizeof(weights));
+  memset(history, 0, sizeof(history));
+  power = 0;
+  motionPower = 0;
+  refSum = 0;
+  refPhase = 0;
+  refCount = 0;
+  dcQ4 = 0;
+  primed = false;
+  rejected = 0;
+  reset();
+}
+
+void HeartRateFusion::reset() {
+  rate = 0;
+  variance = 0;
+  sinceBeat = 0;
+  sinceUpdate = 0;
+  rejectSide = 0;
+  rejectRun = 0;
+  tracking = false;
+}
+
+void HeartRateFusion::setPpgRate(uint16_t hz) {
+  // A restarted PPG FIFO pairs with the next reference, not the queued ones
+  int16_t stale;
+  while (refs.pop(stale)) {
+  }
+  // The rate estimate stays; its timers are in samples
+  uint16_t next = hz ? hz : 1;
+  sinceBeat = (uint16_t)((uint32_t)sinceBeat * next / ppgRate);
+  sinceUpdate = (uint16_t)((uint32_t)sinceUpdate * next / ppgRate);
+  ppgRate = next;
+  refPhase = 0;
+  refSum = 0;
+  refCount = 0;
+  primed = false;
+}
+
+void HeartRateFusion::setMotionRate(uint16_t hz) {
+  motionRate = hz ? hz : 1;
+  refPhase = 0;
+  refSum = 0;
+  refCount = 0;
+}
+
+void HeartRateFusion::addMotion(const ImuSample& sample) {
+  float x = sample.ax;
+  float y = sample.ay;
+  float z = sample.az;
+  float g = sqrtf(x * x + y * y + z * z) / IMU_ACCEL_LSB_PER_G;
+  float mg = (g - 1.0f) * 1000.0f;
+  if (mg > 8000) mg = 8000;
+  if (mg < -8000) mg = -8000;
+  motionPower += (mg * mg - motionPower) / motionRate;
+
+  // One reference per PPG sample: the mean of the IMU samples it spans
+  refSum += (int16_t)mg;
+  refCount++;
+  refPhase += ppgRate;
+  if (refPhase < motionRate) return;
+  int16_t mean = (int16_t)(refSum / refCount);
+  while (refPhase >= motionRate) {
+    refs.push(mean);
+    refPhase -= motionRate;
+  }
+  refSum = 0;
+  refCount = 0;
+}
+
+int32_t HeartRateFusion::cancel(int32_t ir) {
+  if (sinceBeat < 0xFFFF) sinceBeat++;
+  if (sinceUpdate < 0xFFFF) sinceUpdate++;
+
+  int16_t ref = 0;
+  refs.pop(ref);
+  power -= (uint32_t)((int32_t)history[HR_FUSION_TAPS - 1] * history[HR_FUSION_TAPS - 1]);
+  memmove(history + 1, history, sizeof(history) - sizeof(history[0]));
+  history[0] = ref;
+  power += (uint32_t)((int32_t)ref * ref);
+
+  int32_t xQ4 = ir * 16;
+  if (!primed) {
+    dcQ4 = xQ4;
+    primed = true;
+  }
+  dcQ4 += (xQ4 - dcQ4) >> HP_SHIFT;
+  float ac = (xQ4 - dcQ4) / 16.0f;
+
+  float artifact = 0;
+  for (uint8_t i = 0; i < HR_FUSION_TAPS; i++) artifact += weights[i] * history[i];
+
+  // At rest the pulse is all there is in ac: nothing to learn from it
+  if (motionPower > (float)HR_FUSION_MOVING_MG * HR_FUSION_MOVING_MG) {
+    float step = HR_FUSION_STEP * (ac - artifact) / (power + POWER_FLOOR);
+    for (uint8_t i = 0; i < HR_FUSION_TAPS; i++) weights[i] += step * history[i];
+  }
+  return ir - (int32_t)lroundf(artifact);
+}
+
+void HeartRateFusion::addBeat() {
+  uint16_t interval = sinceBeat;
+  sinceBeat = 0;
+  // Same plausible range as the detector: 20..240 BPM
+  if (interval < ppgRate / 4 || interval > ppgRate * 3) return;
+  float measured = 60.0f * ppgRate / interval;
+  float noise = HR_FUSION_BEAT_SD * HR_FUSION_BEAT_SD +
+                HR_FUSION_MOTION_BPM_PER_G * HR_FUSION_MOTION_BPM_PER_G * motionPower / 1.0e6f;
+
+  if (!tracking || sinceUpdate > HR_FUSION_STALE_S * ppgRate) {
+    // One interval is no rate yet: start unsure, the next beats settle it
+    rate = measured;
+    variance = HR_FUSION_ZERO_SD * HR_FUSION_ZERO_SD;
+    if (variance < noise) variance = noise;
+    sinceUpdate = 0;
+    tracking = true;
+    return;
+  }
+
+  float predicted = variance + HR_FUSION_DRIFT_BPM2_PER_S * sinceUpdate / ppgRate;
+  float spread = predicted + noise;
+  float innovation = measured - rate;
+  if (innovation * innovation > HR_FUSION_GATE_SD * HR_FUSION_GATE_SD * spread) {
+    // An extra or missed beat, or the rate really moved: the next beats
+    // tell which, with a wider gate
+    rejected++;
+    int8_t side = innovation > 0 ? 1 : -1;
+    rejectRun = side == rejectSide ? rejectRun + 1 : 1;
+    rejectSide = side;
+    if (rejectRun >= HR_FUSION_RESYNC_BEATS) {
+      rate = measured;
+      variance = noise;
+      sinceUpdate = 0;
+      rejectRun = 0;
+      return;
+    }
+    variance = variance * 2 < MAX_VARIANCE ? variance * 2 : MAX_VARIANCE;
+    if (variance < noise) variance = noise;
+    return;
+  }
+  rejectRun = 0;
+  float gain = predicted / spread;
+  rate += gain * innovation;
+  variance = (1 - gain) * predicted;
+  sinceUpdate = 0;
+}
+
+float HeartRateFusion::heartRate() const {
+  if (!tracking || sinceUpdate > HR_FUSION_STALE_S * ppgRate) return 0;
+  return rate;
+}
+
+float HeartRateFusion::deviation() const {
+  return sqrtf(variance + HR_FUSION_DRIFT_BPM2_PER_S * sinceUpdate / ppgRate);
+}
+
+uint8_t HeartRateFusion::confidence() const {
+  if (heartRate() <= 0) return 0;
+  float sd = deviation();
+  if (sd <= HR_FUSION_FULL_SD) return 100;
+  if (sd >= HR_FUSION_ZERO_SD) return 0;
+  return (uint8_t)(100.0f * (HR_FUSION_ZERO_SD - sd) / (HR_FUSION_ZERO_SD - HR_FUSION_FULL_SD) + 0.5f);
+}
+
+float HeartRateFusion::motionLevel() const {
+  return sqrtf(motionPower) / 1000.0f;
+}
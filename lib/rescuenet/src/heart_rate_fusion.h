@@ -0,0 +1,127 @@
+/*
+ * RescueNet AI - Motion-aware heart rate fusion
+ *
+ * Moving the wrist or finger moves the PPG sensor against the skin, and
+ * the light path changes with every step: an artifact larger than the
+ * pulse at the step rate, which the beat detector happily counts. The
+ * IMU sees the same motion, so the two streams are fused in two stages:
+ *
+ *   1. cancel   an adaptive noise canceller on the IR samples before
+ *               the beat detector. The reference is the acceleration
+ *               magnitude minus 1 g, resampled to the PPG rate and paired
+ *               with the PPG stream sample for sample (both FIFOs start
+ *               together and neither loses samples in normal running).
+ *               A HR_FUSION_TAPS-tap NLMS filter learns how the
+ *               reference shows up in the IR counts and subtracts it; it
+ *               only adapts while the wearer moves, so at rest the pulse
+ *               is passed untouched and the weights keep what was learned.
+ *   2. track    a scalar Kalman filter on the rate, one measurement per
+ *               detected beat (60 / interval). The measurement noise
+ *               grows with the motion power over the last second, so
+ *               beats during movement move the estimate less; a beat
+ *               further than HR_FUSION_GATE_SD from the prediction is
+ *               rejected and doubles the estimate's variance instead,
+ *               which drops a lone extra or missed beat. A real jump
+ *               shows up as HR_FUSION_RESYNC_BEATS rejections in a row
+ *               on the same side, and the estimate restarts there.
+ *
+ * confidence() turns the estimate's standard deviation, grown by the
+ * process noise since the last accepted beat, into 0..100; downstream
+ * alerting gates on it. Per PPG sample the cost is the TAPS-long dot
+ * product and, while moving, the update; per IMU sample one square root.
+ */
+
+#ifndef RESCUENET_HEART_RATE_FUSION_H
+#define RESCUENET_HEART_RATE_FUSION_H
+
+#include "hal.h"
+#include "ram_budget.h"
+#include "spsc_ring.h"
+
+// HealthMonitor fuses where there is RAM for it; the Nano passes the
+// detector's rate through, with confidence 100 at rest and 0 while moving
+#ifndef HR_FUSION_ENABLED
+#if defined(__AVR__)
+#define HR_FUSION_ENABLED 0
+#else
+#define HR_FUSION_ENABLED 1
+#endif
+#endif
+
+#ifndef HR_FUSION_TAPS
+#define HR_FUSION_TAPS 8  // 80 ms of reference at 100 Hz
+#endif
+#ifndef HR_FUSION_REF_RING
+#define HR_FUSION_REF_RING 16
+#endif
+#define HR_FUSION_STEP 0.02f          // NLMS step size
+#define HR_FUSION_MOVING_MG 40        // Reference power (RMS, milli-g) the canceller adapts above
+#define HR_FUSION_BEAT_SD 4.0f        // Beat-to-beat spread of the rate at rest, BPM
+#define HR_FUSION_MOTION_BPM_PER_G 25.0f  // Added measurement SD per g RMS of motion
+#define HR_FUSION_DRIFT_BPM2_PER_S 2.0f   // Process noise: variance the rate gains per second
+#define HR_FUSION_GATE_SD 3.0f
+#define HR_FUSION_RESYNC_BEATS 3
+#define HR_FUSION_FULL_SD 3.0f        // Confidence 100 at or under this SD
+#define HR_FUSION_ZERO_SD 12.0f       // ... and 0 at or over this one
+#define HR_FUSION_STALE_S 4           // No accepted beat for this long: no rate
+
+class HeartRateFusion {
+public:
+  HeartRateFusion();
+
+  // Forgets the rate; the canceller weights are a property of how the
+  // sensor sits and are kept
+  void reset();
+  // Keeps the rate estimate through a change of the PPG rate
+  void setPpgRate(uint16_t hz);
+  void setMotionRate(uint16_t hz);
+
+  // IMU side: one accelerometer sample
+  void addMotion(const ImuSample& sample);
+  // The PPG side has a reference to pair its next sample with
+  bool referenceReady() const { return !refs.empty(); }
+
+  // PPG side: one IR sample, motion artifact removed
+  int32_t cancel(int32_t ir);
+  // The detector found a beat on the last sample passed to cancel()
+  void addBeat();
+
+  // Fused rate in BPM, 0 until known or once stale
+  float heartRate() const;
+  // 0..100: how far the rate can be trusted
+  uint8_t confidence() const;
+  // RMS acceleration off 1 g over about the last second, in g
+  float motionLevel() const;
+  uint32_t beatsRejected() const { return rejected; }
+
+private:
+  float deviation() const;
+
+  // Reference resampling: IMU rate to PPG rate, box-averaged
+  SpscRing<int16_t, HR_FUSION_REF_RING> refs;
+  int32_t refSum;
+  uint16_t refPhase;
+  uint8_t refCount;
+  uint16_t ppgRate;
+  uint16_t motionRate;
+
+  // Canceller
+  int16_t history[HR_FUSION_TAPS];  // Reference in milli-g, newest first
+  float weights[HR_FUSION_TAPS];    // IR counts per milli-g
+  uint32_t power;                   // Sum of history squared
+  float motionPower;                // Mean square over ~1 s, milli-g squared
+  int32_t dcQ4;
+  bool primed;
+
+  // Rate estimate
+  float rate;
+  float variance;
+  uint16_t sinceBeat;    // Samples
+  uint16_t sinceUpdate;  // Samples since the last accepted beat
+  uint32_t rejected;
+  int8_t rejectSide;  // Of the rejections in a row
+  uint8_t rejectRun;
+  bool tracking;
+};
+
+#endif
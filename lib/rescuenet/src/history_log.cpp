@@ -0,0 +1,413 @@
+/*
+ * RescueNet AI - Vitals history on SD
+ */
+
+#include "history_log.h"
+
+#include "crc16.h"
+
+namespace {
+
+const uint32_t NO_PAGE = 0xFFFFFFFFUL;
+const uint8_t HISTORY_VERSION = 1;
+
+void put16(uint8_t* out, uint16_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+}
+
+void put32(uint8_t* out, uint32_t value) {
+  put16(out, (uint16_t)value);
+  put16(out + 2, (uint16_t)(value >> 16));
+}
+
+uint16_t get16(const uint8_t* in) {
+  return (uint16_t)(in[0] | ((uint16_t)in[1] << 8));
+}
+
+uint32_t get32(const uint8_t* in) {
+  return get16(in) | ((uint32_t)get16(in + 2) << 16);
+}
+
+int32_t scaled(float value, float scale, int32_t low, int32_t high) {
+  float v = value * scale;
+  if (!(v == v)) return 0;  // NaN
+  if (v <= low) return low;
+  if (v >= high) return high;
+  return (int32_t)(v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+bool blank(const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    if (data[i] != 0xFF) return false;
+  }
+  return true;
+}
+
+bool validHeader(const uint8_t* header, uint32_t& page, uint32_t& firstTime) {
+  if (header[0] != 'R' || header[1] != 'H' || header[2] != HISTORY_VERSION || header[3] != HISTORY_SAMPLE_SIZE ||
+      get16(header + 14) != crc16Ccitt(header, 14)) {
+    return false;
+  }
+  page = get32(header + 4);
+  firstTime = get32(header + 8);
+  return true;
+}
+
+void encodeSample(const HistorySample& sample, uint32_t timestamp, uint8_t* out) {
+  put32(out, timestamp);
+  put16(out + 4, (uint16_t)scaled(sample.heartRate, 10, 0, 65535));
+  put16(out + 6, (uint16_t)scaled(sample.spO2, 10, 0, 1000));
+  put16(out + 8, (uint16_t)(int16_t)scaled(sample.temperature, 100, -32768, 32767));
+  out[10] = sample.bloodPressureSys;
+  out[11] = sample.bloodPressureDia;
+  out[12] = sample.flags;
+  out[13] = sample.batteryLevel;
+  put16(out + 14, crc16Ccitt(out, 14));
+}
+
+bool decodeSample(const uint8_t* in, HistorySample& sample) {
+  if (get16(in + 14) != crc16Ccitt(in, 14)) return false;
+  sample.timestamp = get32(in);
+  sample.heartRate = get16(in + 4) / 10.0f;
+  sample.spO2 = get16(in + 6) / 10.0f;
+  sample.temperature = (int16_t)get16(in + 8) / 100.0f;
+  sample.bloodPressureSys = in[10];
+  sample.bloodPressureDia = in[11];
+  sample.flags = in[12];
+  sample.batteryLevel = in[13];
+  return true;
+}
+
+}  // namespace
+
+HistoryLog::HistoryLog(LogStorage* storage)
+  : storage(storage), mounted(false), started(false), pages(0), pagesPerBlock(1), indexStride(1), headPage(0),
+    fill(0), synced(0), headOpen(false), lastTimestamp(0), dirtySinceMs(0), checkNext(false) {
+  memset(&counters, 0, sizeof(counters));
+}
+
+bool HistoryLog::begin() {
+  mounted = started = headOpen = false;
+  fill = synced = 0;
+  lastTimestamp = 0;
+  headPage = 0;
+  if (!storage) return false;
+  uint32_t block = storage->eraseSize();
+  if (block == 0 || block % HISTORY_PAGE_SIZE != 0) return false;
+  pagesPerBlock = block / HISTORY_PAGE_SIZE;
+  pages = storage->size() / HISTORY_PAGE_SIZE;
+  if (pages < 2 * pagesPerBlock) return false;
+  indexStride = (pages + HISTORY_INDEX_ENTRIES - 1) / HISTORY_INDEX_ENTRIES;
+
+  // Headers of the indexed slots; the newest is at most a stride behind
+  // the head
+  uint32_t newest = NO_PAGE;
+  uint32_t newestSlot = 0;
+  for (uint32_t k = 0; k < HISTORY_INDEX_ENTRIES; k++) {
+    index[k].page = NO_PAGE;
+    index[k].firstTime = 0;
+    uint32_t slot = k * indexStride;
+    if (slot >= pages) continue;
+    uint32_t page, firstTime;
+    if (!readHeader(slot, page, firstTime) || slotOf(page) != slot) continue;
+    index[k].page = page;
+    index[k].firstTime = firstTime;
+    if (newest == NO_PAGE || page > newest) {
+      newest = page;
+      newestSlot = slot;
+    }
+  }
+  mounted = true;
+  if (newest == NO_PAGE) return true;
+
+  // Slots after it hold its successors up to the head, then older pages
+  uint32_t low = 0;
+  uint32_t high = indexStride < pages - newestSlot ? indexStride : pages - newestSlot;
+  while (high - low > 1) {
+    uint32_t mid = low + (high - low) / 2;
+    uint32_t page, firstTime;
+    if (readHeader((newestSlot + mid) % pages, page, firstTime) && page == newest + mid) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+  headPage = newest + low;
+  // A torn header skipped at runtime leaves a gap before the next erase
+  // block; the head may lie past it
+  for (;;) {
+    uint32_t next = headPage + pagesPerBlock - slotOf(headPage) % pagesPerBlock;
+    uint32_t page, firstTime;
+    if (!readHeader(slotOf(next), page, firstTime) || page != next) break;
+    headPage = next;
+    while (readHeader(slotOf(headPage + 1), page, firstTime) && page == headPage + 1) headPage++;
+  }
+  started = true;
+
+  // Pick up the head page after its last good sample
+  if (!storage->read(offsetOf(headPage), page, sizeof(page))) return false;
+  counters.pageReads++;
+  uint32_t check, firstTime;
+  validHeader(page, check, firstTime);
+  lastTimestamp = firstTime;
+  uint8_t count = 0;
+  bool damaged = false;
+  HistorySample sample;
+  for (; count < HISTORY_SAMPLES_PER_PAGE; count++) {
+    const uint8_t* at = page + HISTORY_PAGE_HEADER + count * HISTORY_SAMPLE_SIZE;
+    if (blank(at, HISTORY_SAMPLE_SIZE)) break;
+    if (!decodeSample(at, sample)) {
+      damaged = true;
+      break;
+    }
+    lastTimestamp = sample.timestamp;
+  }
+  fill = synced = (uint16_t)(HISTORY_PAGE_HEADER + count * HISTORY_SAMPLE_SIZE);
+  headOpen = !damaged && count < HISTORY_SAMPLES_PER_PAGE;
+  if (count == 0 && headPage > oldestPage()) {
+    // A header alone carries the time of a sample that never made it;
+    // the newest sample is the last of the page before
+    uint8_t header[HISTORY_PAGE_HEADER];
+    memcpy(header, page, sizeof(header));
+    if (loadPage(headPage - 1, page)) {
+      for (uint8_t i = 0; i < HISTORY_SAMPLES_PER_PAGE; i++) {
+        if (!decodeSample(page + HISTORY_PAGE_HEADER + i * HISTORY_SAMPLE_SIZE, sample)) break;
+        lastTimestamp = sample.timestamp;
+      }
+    }
+    memset(page, 0xFF, sizeof(page));
+    memcpy(page, header, sizeof(header));
+  }
+  // The next slot may hold a header cut short by the same reset
+  checkNext = true;
+  return true;
+}
+
+bool HistoryLog::append(const HistorySample& sample) {
+  if (!mounted) return false;
+  uint32_t timestamp = sample.timestamp < lastTimestamp ? lastTimestamp : sample.timestamp;
+  if (!headOpen && !startPage(timestamp)) return false;
+  uint8_t encoded[HISTORY_SAMPLE_SIZE];
+  encodeSample(sample, timestamp, encoded);
+  if (!put(encoded, sizeof(encoded))) return false;
+  lastTimestamp = timestamp;
+  counters.appended++;
+  if (fill == HISTORY_PAGE_SIZE) {
+    // A full page goes out whole and is not touched again
+    headOpen = false;
+    return sync();
+  }
+  return true;
+}
+
+bool HistoryLog::sync() {
+  if (!mounted) return false;
+  if (fill == synced) return true;
+  bool ok = storage->write(offsetOf(headPage) + synced, page + synced, fill - synced);
+  counters.writes++;
+  counters.bytesWritten += fill - synced;
+  synced = fill;
+  return ok;
+}
+
+void HistoryLog::poll() {
+  if (mounted && fill != synced && millis() - dirtySinceMs >= HISTORY_SYNC_MS) sync();
+}
+
+bool HistoryLog::seek(HistoryCursor& cursor, uint32_t from, uint32_t to) {
+  if (!mounted || !started || from > to || lastTimestamp < from) return false;
+  uint32_t oldest = oldestPage();
+
+  // Coarse step: the newest indexed page that starts no later than from
+  uint32_t low = oldest;
+  for (uint32_t k = 0; k < HISTORY_INDEX_ENTRIES; k++) {
+    const IndexEntry& entry = index[k];
+    if (entry.page == NO_PAGE || entry.page < oldest || entry.page > headPage) continue;
+    if (entry.firstTime <= from && entry.page > low) low = entry.page;
+  }
+
+  // Fine step: binary search the stride after it by page headers
+  uint32_t high = low + indexStride < headPage + 1 ? low + indexStride : headPage + 1;
+  while (high - low > 1) {
+    uint32_t mid = low + (high - low) / 2;
+    uint32_t page, firstTime;
+    bool valid = mid == headPage ? validHeader(this->page, page, firstTime)
+                                 : readHeader(slotOf(mid), page, firstTime) && page == mid;
+    if (valid && firstTime <= from) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+
+  cursor.page = low;
+  cursor.sample = 0;
+  cursor.loaded = false;
+  cursor.from = from;
+  cursor.to = to;
+  return true;
+}
+
+bool HistoryLog::next(HistoryCursor& cursor, HistorySample& sample) {
+  for (;;) {
+    if (!cursor.loaded) {
+      // A reader the writer has lapped skips to what is left
+      uint32_t oldest = oldestPage();
+      if (cursor.page < oldest) {
+        cursor.page = oldest;
+        cursor.sample = 0;
+      }
+      if (!started || cursor.page > headPage) return false;
+      if (!loadPage(cursor.page, cursor.data)) {
+        if (cursor.page == headPage) return false;
+        cursor.page++;
+        cursor.sample = 0;
+        continue;
+      }
+      cursor.loaded = true;
+    }
+    bool live = cursor.page == headPage && headOpen;
+    const uint8_t* at = cursor.data + HISTORY_PAGE_HEADER + cursor.sample * HISTORY_SAMPLE_SIZE;
+    if (cursor.sample >= HISTORY_SAMPLES_PER_PAGE || blank(at, HISTORY_SAMPLE_SIZE) || !decodeSample(at, sample)) {
+      if (live) {
+        // Come back for samples appended to the head later
+        cursor.loaded = false;
+        return false;
+      }
+      cursor.page++;
+      cursor.sample = 0;
+      cursor.loaded = false;
+      continue;
+    }
+    if (sample.timestamp > cursor.to) return false;
+    cursor.sample++;
+    if (sample.timestamp >= cursor.from) return true;
+  }
+}
+
+uint32_t HistoryLog::oldestTimestamp() {
+  if (!started) return 0;
+  uint32_t oldest = oldestPage();
+  for (uint32_t p = oldest; p <= headPage; p++) {
+    uint32_t page, firstTime;
+    if (p == headPage) return validHeader(this->page, page, firstTime) ? firstTime : lastTimestamp;
+    if (readHeader(slotOf(p), page, firstTime) && page == p) return firstTime;
+  }
+  return lastTimestamp;
+}
+
+bool HistoryLog::readHeader(uint32_t slot, uint32_t& page, uint32_t& firstTime) {
+  uint8_t header[HISTORY_PAGE_HEADER];
+  counters.pageReads++;
+  return storage->read(slot * HISTORY_PAGE_SIZE, header, sizeof(header)) && validHeader(header, page, firstTime);
+}
+
+bool HistoryLog::loadPage(uint32_t number, uint8_t* out) {
+  if (started && number == headPage) {
+    memcpy(out, page, fill);
+    memset(out + fill, 0xFF, HISTORY_PAGE_SIZE - fill);
+    return fill >= HISTORY_PAGE_HEADER;
+  }
+  counters.pageReads++;
+  uint32_t check, firstTime;
+  return storage->read(offsetOf(number), out, HISTORY_PAGE_SIZE) && validHeader(out, check, firstTime) &&
+         check == number;
+}
+
+uint32_t HistoryLog::oldestPage() const {
+  // Pages later in the head's erase block went with its erase
+  uint32_t inBlock = slotOf(headPage) % pagesPerBlock;
+  if (!started || headPage + pagesPerBlock < pages + inBlock) return 0;
+  return headPage + pagesPerBlock - inBlock - pages;
+}
+
+bool HistoryLog::startPage(uint32_t timestamp) {
+  uint32_t number = started ? headPage + 1 : headPage;
+  uint8_t header[HISTORY_PAGE_HEADER];
+  if (checkNext) {
+    // Bytes left by a cut write cannot be programmed over; move on to the
+    // next erase block
+    checkNext = false;
+    if (slotOf(number) % pagesPerBlock != 0 &&
+        (!storage->read(offsetOf(number), header, sizeof(header)) || !blank(header, sizeof(header)))) {
+      number += pagesPerBlock - slotOf(number) % pagesPerBlock;
+    }
+  }
+  uint32_t slot = slotOf(number);
+  if (slot % pagesPerBlock == 0) {
+    // Entering an erase block: clear it unless it is still blank
+    if (!storage->read(offsetOf(number), header, sizeof(header))) return false;
+    if (!blank(header, sizeof(header)) || number >= pages) {
+      if (!storage->erase(offsetOf(number))) return false;
+      counters.erases++;
+    }
+    for (uint32_t s = slot; s < slot + pagesPerBlock; s++) {
+      if (s % indexStride == 0) index[s / indexStride].page = NO_PAGE;
+    }
+  }
+
+  headPage = number;
+  started = true;
+  headOpen = true;
+  fill = synced = 0;
+  memset(page, 0xFF, sizeof(page));
+  header[0] = 'R';
+  header[1] = 'H';
+  header[2] = HISTORY_VERSION;
+  header[3] = HISTORY_SAMPLE_SIZE;
+  put32(header + 4, number);
+  put32(header + 8, timestamp);
+  header[12] = header[13] = 0xFF;
+  put16(header + 14, crc16Ccitt(header, 14));
+  if (slot % indexStride == 0) {
+    index[slot / indexStride].page = number;
+    index[slot / indexStride].firstTime = timestamp;
+  }
+  return put(header, sizeof(header));
+}
+
+bool HistoryLog::put(const uint8_t* data, size_t length) {
+  if (fill + length > HISTORY_PAGE_SIZE) return false;
+  if (fill == synced) dirtySinceMs = millis();
+  memcpy(page + fill, data, length);
+  fill = (uint16_t)(fill + length);
+  return true;
+}
+
+size_t formatHistoryLine(const HistorySample& sample, char* out, size_t capacity) {
+  char line[112];
+  char* p = line;
+  const char* parts[] = {"{\"t\":", ",\"hr\":", ",\"spo2\":", ",\"temp\":", ",\"bp\":[", ",", "],\"flags\":"};
+  int32_t values[] = {0, scaled(sample.heartRate, 10, 0, 65535), scaled(sample.spO2, 10, 0, 1000),
+                      scaled(sample.temperature, 100, -32768, 32767), sample.bloodPressureSys,
+                      sample.bloodPressureDia, sample.flags};
+  const uint8_t decimals[] = {0, 1, 1, 2, 0, 0, 0};
+  for (uint8_t i = 0; i < 7; i++) {
+    size_t n = strlen(parts[i]);
+    memcpy(p, parts[i], n);
+    p += n;
+    uint32_t magnitude;
+    if (i == 0) {
+      magnitude = sample.timestamp;
+    } else {
+      if (values[i] < 0) *p++ = '-';
+      magnitude = (uint32_t)(values[i] < 0 ? -values[i] : values[i]);
+    }
+    // Digits backwards, with the decimal point in place
+    char digits[12];
+    uint8_t count = 0;
+    for (uint8_t d = 0; magnitude > 0 || d <= decimals[i]; d++) {
+      if (decimals[i] && d == decimals[i]) digits[count++] = '.';
+      digits[count++] = (char)('0' + magnitude % 10);
+      magnitude /= 10;
+    }
+    while (count) *p++ = digits[--count];
+  }
+  *p++ = '}';
+  *p++ = '\n';
+  size_t length = (size_t)(p - line);
+  if (length > capacity) return 0;
+  memcpy(out, line, length);
+  return length;
+}
@@ -0,0 +1,156 @@
+/*
+ * RescueNet AI - Vitals history on SD
+ *
+ * A time series of fixed-width vitals samples in 512-byte pages, the
+ * sector size of an SD card, so every write lands on whole card blocks.
+ * The storage (a LogStorage, normally a preallocated file) is a ring of
+ * pages; page n lives in slot n % pages. Each page is
+ *
+ *   off size field
+ *     0   2  magic "RH"
+ *     2   1  version (1)
+ *     3   1  sample size (16)
+ *     4   4  page sequence number
+ *     8   4  timestamp of the first sample
+ *    12   2  reserved (0xFFFF)
+ *    14   2  CRC-16/CCITT of the header
+ *    16 496  31 samples of 16 bytes:
+ *              0  4  seconds since 1970 (local wall clock)
+ *              4  2  heart rate, 0.1 BPM
+ *              6  2  SpO2, 0.1 %
+ *              8  2  body temperature, signed, 0.01 C
+ *             10  2  blood pressure systolic / diastolic, mmHg
+ *             12  1  flags (TELEMETRY_FLAG_*)
+ *             13  1  battery level in %, 255 when unknown
+ *             14  2  CRC-16/CCITT of the sample
+ *
+ * Samples are assembled in a RAM page and written when it fills, or on
+ * sync()/poll() every HISTORY_SYNC_MS; a sync writes only the samples
+ * added since the last one. Timestamps never go backwards (a sample
+ * older than the last is stamped with the last time), so pages are
+ * sorted by time.
+ *
+ * A sparse index of HISTORY_INDEX_ENTRIES first-timestamps, one for
+ * every stride-th slot, stays in RAM. A range read looks up its start in
+ * the index, binary searches the stride of pages it points to by their
+ * headers and then streams pages in order: about log2(stride) + pages
+ * in range block reads instead of a scan from the start. begin() reads
+ * the indexed headers and binary searches for the newest page. A sample
+ * or header with a bad CRC (cut by a reset) closes its page.
+ */
+
+#ifndef RESCUENET_HISTORY_LOG_H
+#define RESCUENET_HISTORY_LOG_H
+
+#include "hal.h"
+
+#define HISTORY_PAGE_SIZE 512
+#define HISTORY_SAMPLE_SIZE 16
+#define HISTORY_PAGE_HEADER 16
+#define HISTORY_SAMPLES_PER_PAGE ((HISTORY_PAGE_SIZE - HISTORY_PAGE_HEADER) / HISTORY_SAMPLE_SIZE)
+
+#ifndef HISTORY_INDEX_ENTRIES
+#define HISTORY_INDEX_ENTRIES 256
+#endif
+
+#ifndef HISTORY_SYNC_MS
+#define HISTORY_SYNC_MS 60000
+#endif
+
+struct HistorySample {
+  uint32_t timestamp;
+  float heartRate;
+  float spO2;
+  float temperature;
+  uint8_t bloodPressureSys;
+  uint8_t bloodPressureDia;
+  uint8_t flags;
+  uint8_t batteryLevel;
+};
+
+struct HistoryStats {
+  uint32_t appended;
+  uint32_t writes;        // Storage write() calls
+  uint32_t bytesWritten;
+  uint32_t erases;
+  uint32_t pageReads;     // Block reads by begin() and range reads
+};
+
+// A range read in progress; holds one page, so keep it off small stacks
+struct HistoryCursor {
+  uint32_t page;          // Sequence number of the page being read
+  uint8_t sample;         // Next sample in it
+  bool loaded;
+  uint32_t from;
+  uint32_t to;
+  uint8_t data[HISTORY_PAGE_SIZE];
+};
+
+class HistoryLog {
+public:
+  explicit HistoryLog(LogStorage* storage);
+
+  // Finds the newest page; false when the storage is missing or its
+  // geometry does not fit (a whole number of pages per erase block)
+  bool begin();
+  bool ready() const { return mounted; }
+
+  bool append(const HistorySample& sample);
+  // Writes the samples added since the last write
+  bool sync();
+  // Syncs samples left in RAM for HISTORY_SYNC_MS
+  void poll();
+
+  // Starts a read of the samples stamped from..to, inclusive; false when
+  // the log holds none that recent
+  bool seek(HistoryCursor& cursor, uint32_t from, uint32_t to);
+  // Next sample of the range, in time order. A cursor at the end picks up
+  // samples appended later.
+  bool next(HistoryCursor& cursor, HistorySample& sample);
+
+  bool empty() const { return !started; }
+  uint32_t oldestTimestamp();
+  uint32_t newestTimestamp() const { return lastTimestamp; }
+  const HistoryStats& stats() const { return counters; }
+  uint32_t stride() const { return indexStride; }
+
+private:
+  struct IndexEntry {
+    uint32_t page;       // Sequence number, NO_PAGE when the slot is empty
+    uint32_t firstTime;
+  };
+
+  bool readHeader(uint32_t slot, uint32_t& page, uint32_t& firstTime);
+  bool loadPage(uint32_t page, uint8_t* out);
+  uint32_t oldestPage() const;
+  bool startPage(uint32_t timestamp);
+  bool put(const uint8_t* data, size_t length);
+  uint32_t slotOf(uint32_t page) const { return page % pages; }
+  uint32_t offsetOf(uint32_t page) const { return slotOf(page) * HISTORY_PAGE_SIZE; }
+
+  LogStorage* storage;
+  bool mounted;
+  bool started;               // Some page has been written
+  uint32_t pages;             // Slots in the ring
+  uint32_t pagesPerBlock;     // Per erase block
+  uint32_t indexStride;
+
+  uint32_t headPage;          // Sequence number of the page in RAM
+  uint8_t page[HISTORY_PAGE_SIZE];
+  uint16_t fill;
+  uint16_t synced;
+  bool headOpen;              // page holds a header and room for samples
+  uint32_t lastTimestamp;
+  uint32_t dirtySinceMs;
+  bool checkNext;             // The slot after the head may be torn
+
+  IndexEntry index[HISTORY_INDEX_ENTRIES];
+  HistoryStats counters;
+};
+
+// One sample as a line of NDJSON:
+//   {"t":1700000000,"hr":72.5,"spo2":97.0,"temp":36.61,"bp":[118,76],"flags":8}
+// Returns its length, or 0 when it does not fit in capacity
+size_t formatHistoryLine(const HistorySample& sample, char* out, size_t capacity);
+
+#endif
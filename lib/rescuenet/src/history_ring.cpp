@@ -0,0 +1,49 @@
+/*
+ * RescueNet AI - Recent vitals history in RAM
+ */
+
+#include "history_ring.h"
+
+HistoryRing::HistoryRing() : appended(0), count(0) {}
+
+void HistoryRing::clear() {
+  appended = 0;
+  count = 0;
+}
+
+void HistoryRing::append(const HistorySample& sample) {
+  HistorySample& slot = samples[appended % HISTORY_RING_SAMPLES];
+  uint32_t newest = count ? newestTimestamp() : 0;
+  slot = sample;
+  if (slot.timestamp < newest) slot.timestamp = newest;
+  appended++;
+  if (count < HISTORY_RING_SAMPLES) count++;
+}
+
+bool HistoryRing::get(uint32_t sequence, HistorySample& out) const {
+  if (sequence - first() >= count) return false;
+  out = at(sequence);
+  return true;
+}
+
+uint32_t HistoryRing::find(uint32_t timestamp) const {
+  uint32_t low = first();
+  uint32_t high = end();
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    if (at(middle).timestamp < timestamp) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+uint32_t HistoryRing::oldestTimestamp() const {
+  return count ? at(first()).timestamp : 0;
+}
+
+uint32_t HistoryRing::newestTimestamp() const {
+  return count ? at(end() - 1).timestamp : 0;
+}
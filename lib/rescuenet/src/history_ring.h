@@ -0,0 +1,48 @@
+/*
+ * RescueNet AI - Recent vitals history in RAM
+ *
+ * The last HISTORY_RING_SAMPLES samples, for http_server.h to stream
+ * without touching the SD card. Samples are numbered by a free-running
+ * sequence; the oldest are overwritten once the ring is full. Timestamps
+ * never go backwards, like in HistoryLog, so find() is a binary search.
+ *
+ * Not thread safe: append and read from the same loop.
+ */
+
+#ifndef RESCUENET_HISTORY_RING_H
+#define RESCUENET_HISTORY_RING_H
+
+#include "history_log.h"
+
+// An hour of samples every 5 s
+#ifndef HISTORY_RING_SAMPLES
+#define HISTORY_RING_SAMPLES 720
+#endif
+
+class HistoryRing {
+public:
+  HistoryRing();
+
+  void append(const HistorySample& sample);
+  void clear();
+
+  // Sequence numbers held: first() up to, not including, end()
+  uint32_t first() const { return end() - count; }
+  uint32_t end() const { return appended; }
+  bool empty() const { return count == 0; }
+  bool get(uint32_t sequence, HistorySample& out) const;
+  // The first sample stamped at or after timestamp; end() when none is
+  uint32_t find(uint32_t timestamp) const;
+
+  uint32_t oldestTimestamp() const;
+  uint32_t newestTimestamp() const;
+
+private:
+  const HistorySample& at(uint32_t sequence) const { return samples[sequence % HISTORY_RING_SAMPLES]; }
+
+  HistorySample samples[HISTORY_RING_SAMPLES];
+  uint32_t appended;
+  uint16_t count;
+};
+
+#endif
@@ -0,0 +1,471 @@
+/*
+ * RescueNet AI - Non-blocking HTTP server for the local dashboard
+ */
+
+#include "http_server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+enum State {
+  CLOSED,
+  READING,
+  WRITING,
+  STREAMING
+};
+
+enum Body {
+  BODY_NONE,
+  BODY_ASSET,
+  BODY_HISTORY,
+  BODY_ARCHIVE,
+  BODY_EVENTS
+};
+
+enum Method {
+  METHOD_GET,
+  METHOD_HEAD,
+  METHOD_OTHER
+};
+
+// Chunk size as four hex digits and CRLF, ahead of each chunk's data
+const uint8_t CHUNK_HEADER = 6;
+const char CHUNK_END[] = "0\r\n\r\n";
+// Room a history line needs: the line, and a ',' or '[' before it
+const uint8_t HISTORY_LINE_ROOM = 114;
+const uint16_t DEFAULT_MINUTES = 60;
+
+static_assert(HTTP_CHUNK_BYTES >= 512, "headers and a few history lines must fit a chunk");
+static_assert(HTTP_CHUNK_BYTES <= 0xFFFF, "chunk sizes are sent as four hex digits");
+
+bool startsWithNoCase(const char* text, const char* prefix) {
+  return strncasecmp(text, prefix, strlen(prefix)) == 0;
+}
+
+// The value of name in a query string (a=1&b=2), or nullptr
+const char* queryParam(const char* query, const char* name) {
+  size_t length = strlen(name);
+  for (const char* p = query; p && *p;) {
+    if (strncmp(p, name, length) == 0 && p[length] == '=') return p + length + 1;
+    p = strchr(p, '&');
+    if (p) p++;
+  }
+  return nullptr;
+}
+
+const char* connectionHeader(bool keepAlive) {
+  return keepAlive ? "keep-alive" : "close";
+}
+
+}  // namespace
+
+HttpServer::HttpServer(TcpServerPort& port, HistoryRing& ring)
+  : port(port), ring(ring), assets(nullptr), assetCount(0), archive(nullptr), archiveCursor(nullptr),
+    archiveOwner(-1) {
+  memset(slots, 0, sizeof(slots));
+  memset(&counters, 0, sizeof(counters));
+}
+
+void HttpServer::setAssets(const HttpAsset* list, uint8_t count) {
+  assets = list;
+  assetCount = count;
+}
+
+void HttpServer::attachArchive(HistoryLog* log, HistoryCursor* cursor) {
+  archive = log;
+  archiveCursor = cursor;
+}
+
+uint8_t HttpServer::connections() const {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+    if (slots[i].state != CLOSED) n++;
+  }
+  return n;
+}
+
+uint8_t HttpServer::subscribers() const {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+    if (slots[i].state == STREAMING) n++;
+  }
+  return n;
+}
+
+void HttpServer::poll() {
+  for (int id = port.accept(); id >= 0; id = port.accept()) {
+    if (id >= HTTP_MAX_CONNECTIONS || slots[id].state != CLOSED) {
+      port.close((uint8_t)id);
+      counters.refused++;
+      continue;
+    }
+    Connection& c = slots[id];
+    c.state = READING;
+    c.lineLength = 0;
+    c.target[0] = 0;
+    c.activeMs = millis();
+    counters.accepted++;
+  }
+  for (uint8_t id = 0; id < HTTP_MAX_CONNECTIONS; id++) {
+    if (slots[id].state != CLOSED) serve(id);
+  }
+}
+
+void HttpServer::serve(uint8_t id) {
+  Connection& c = slots[id];
+  if (c.state == READING) {
+    readRequest(id, c);
+    if (c.state == CLOSED) return;
+  } else if (port.read(id, nullptr, 0) < 0) {
+    drop(id, c);
+    return;
+  }
+  if (c.state == READING) {
+    if (millis() - c.activeMs > HTTP_IDLE_TIMEOUT_MS) {
+      counters.timeouts++;
+      drop(id, c);
+    }
+    return;
+  }
+
+  if (flush(id, c)) {
+    if (c.state == STREAMING) {
+      if (millis() - c.activeMs >= HTTP_EVENT_PING_MS) {
+        append(c, ": ping\n\n");
+        flush(id, c);
+      }
+      return;
+    }
+    bool more = false;
+    if (c.body == BODY_ASSET && c.sent < c.asset->length) {
+      // Straight from flash; the transport keeps a reference, not a copy
+      size_t n = port.write(id, c.asset->data + c.sent, c.asset->length - c.sent, true);
+      c.sent += n;
+      counters.bytesSent += n;
+      counters.bytesStable += n;
+      if (n) c.activeMs = millis();
+      more = c.sent < c.asset->length;
+    } else if (c.body == BODY_HISTORY || c.body == BODY_ARCHIVE) {
+      // One chunk per poll
+      fillHistory(c);
+      flush(id, c);
+      return;
+    }
+    if (!more) {
+      finish(id, c);
+      return;
+    }
+  }
+  if (millis() - c.activeMs > HTTP_IDLE_TIMEOUT_MS) {
+    counters.timeouts++;
+    drop(id, c);
+  }
+}
+
+void HttpServer::readRequest(uint8_t id, Connection& c) {
+  uint8_t buffer[HTTP_READ_BYTES];
+  int n = port.read(id, buffer, sizeof(buffer));
+  if (n < 0) {
+    drop(id, c);
+    return;
+  }
+  if (n == 0) return;
+  c.activeMs = millis();
+  for (int i = 0; i < n; i++) {
+    uint8_t byte = buffer[i];
+    if (byte == '\n') {
+      bool done = c.target[0] && c.lineLength == 0;
+      endLine(c);
+      if (done) {
+        // Anything after the request would be a pipelined one
+        respond(id, c);
+        return;
+      }
+    } else if (byte != '\r') {
+      if (c.lineLength < HTTP_TARGET_MAX - 1) {
+        c.line[c.lineLength++] = (char)byte;
+      } else {
+        c.lineOverflow = true;
+      }
+    }
+  }
+}
+
+void HttpServer::endLine(Connection& c) {
+  c.line[c.lineLength] = 0;
+  if (!c.target[0]) {
+    if (c.lineLength == 0) return;  // Blank lines ahead of a request
+    c.status = 0;
+    c.keepAlive = true;
+    c.notModified = false;
+    c.asset = nullptr;
+    if (c.lineOverflow) {
+      c.status = 414;
+    }
+    if (strncmp(c.line, "GET ", 4) == 0) {
+      c.method = METHOD_GET;
+    } else if (strncmp(c.line, "HEAD ", 5) == 0) {
+      c.method = METHOD_HEAD;
+    } else {
+      c.method = METHOD_OTHER;
+    }
+    const char* start = strchr(c.line, ' ');
+    start = start ? start + 1 : c.line;
+    const char* stop = strchr(start, ' ');
+    size_t length = stop ? (size_t)(stop - start) : strlen(start);
+    if (length == 0) length = 1;  // Keeps target non-empty: a request line was seen
+    memcpy(c.target, start, length);
+    c.target[length] = 0;
+    if (stop && strcmp(stop + 1, "HTTP/1.0") == 0) c.keepAlive = false;
+
+    size_t pathLength = strcspn(c.target, "?");
+    for (uint8_t i = 0; i < assetCount; i++) {
+      if (strlen(assets[i].path) == pathLength && strncmp(assets[i].path, c.target, pathLength) == 0) {
+        c.asset = &assets[i];
+      }
+    }
+  } else if (startsWithNoCase(c.line, "Connection:")) {
+    if (strstr(c.line, "close") || strstr(c.line, "Close")) c.keepAlive = false;
+    if (strstr(c.line, "keep-alive") || strstr(c.line, "Keep-Alive")) c.keepAlive = true;
+  } else if (startsWithNoCase(c.line, "If-None-Match:")) {
+    if (c.asset && strstr(c.line, c.asset->etag)) c.notModified = true;
+  }
+  c.lineLength = 0;
+  c.lineOverflow = false;
+}
+
+void HttpServer::respond(uint8_t id, Connection& c) {
+  counters.requests++;
+  c.outLength = 0;
+  c.outSent = 0;
+  c.sent = 0;
+  c.body = BODY_NONE;
+  c.state = WRITING;
+  c.activeMs = millis();
+
+  char* query = strchr(c.target, '?');
+  if (query) *query++ = 0;
+
+  if (c.status) {
+    c.keepAlive = false;
+    startError(c, c.status, "URI Too Long");
+  } else if (c.method == METHOD_OTHER) {
+    startError(c, 405, "Method Not Allowed");
+  } else if (c.asset && c.notModified) {
+    char header[160];
+    snprintf(header, sizeof(header),
+             "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nCache-Control: no-cache\r\nConnection: %s\r\n\r\n",
+             c.asset->etag, connectionHeader(c.keepAlive));
+    append(c, header);
+    counters.notModified++;
+  } else if (c.asset) {
+    char header[256];
+    snprintf(header, sizeof(header),
+             "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %lu\r\n%sETag: %s\r\n"
+             "Cache-Control: no-cache\r\nConnection: %s\r\n\r\n",
+             c.asset->contentType, (unsigned long)c.asset->length, c.asset->gzip ? "Content-Encoding: gzip\r\n" : "",
+             c.asset->etag, connectionHeader(c.keepAlive));
+    append(c, header);
+    if (c.method == METHOD_GET) c.body = BODY_ASSET;
+  } else if (strcmp(c.target, "/history") == 0) {
+    startHistory(c, query ? query : "");
+    if (c.body == BODY_ARCHIVE) archiveOwner = (int8_t)id;
+  } else if (strcmp(c.target, "/events") == 0) {
+    append(c, "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-store\r\n"
+              "Connection: keep-alive\r\n\r\nretry: 5000\n\n");
+    if (c.method == METHOD_GET) {
+      c.state = STREAMING;
+      c.body = BODY_EVENTS;
+    } else {
+      c.keepAlive = false;
+    }
+  } else {
+    startError(c, 404, "Not Found");
+  }
+  flush(id, c);
+}
+
+void HttpServer::startHistory(Connection& c, const char* query) {
+  const char* value = queryParam(query, "to");
+  uint32_t newest = ring.newestTimestamp();
+  if (archive && archive->ready() && archive->newestTimestamp() > newest) newest = archive->newestTimestamp();
+  uint32_t to = value ? strtoul(value, nullptr, 10) : newest;
+  uint32_t from;
+  value = queryParam(query, "from");
+  if (value) {
+    from = strtoul(value, nullptr, 10);
+  } else {
+    value = queryParam(query, "minutes");
+    uint32_t span = (value ? strtoul(value, nullptr, 10) : DEFAULT_MINUTES) * 60UL;
+    from = to > span ? to - span : 0;
+  }
+  value = queryParam(query, "format");
+  c.json = value && strncmp(value, "json", 4) == 0;
+  c.to = to;
+  c.first = true;
+
+  bool inRing = !ring.empty() && from >= ring.oldestTimestamp();
+  bool archived = archive && archive->ready() && !archive->empty();
+  if (!inRing && archived && to >= archive->oldestTimestamp()) {
+    if (archiveOwner >= 0) {
+      startError(c, 503, "Busy");
+      return;
+    }
+    if (archive->seek(*archiveCursor, from, to)) {
+      c.body = BODY_ARCHIVE;
+    }
+  }
+  if (c.body != BODY_ARCHIVE) {
+    c.next = ring.find(from);
+    HistorySample sample;
+    if (!ring.get(c.next, sample) || sample.timestamp > to) {
+      char header[96];
+      snprintf(header, sizeof(header), "HTTP/1.1 204 No Content\r\nConnection: %s\r\n\r\n",
+               connectionHeader(c.keepAlive));
+      append(c, header);
+      return;
+    }
+    c.body = BODY_HISTORY;
+  }
+
+  char header[192];
+  snprintf(header, sizeof(header),
+           "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nTransfer-Encoding: chunked\r\nCache-Control: no-store\r\n"
+           "Connection: %s\r\n\r\n",
+           c.json ? "application/json" : "application/x-ndjson", connectionHeader(c.keepAlive));
+  append(c, header);
+  if (c.method == METHOD_HEAD) c.body = BODY_NONE;
+}
+
+void HttpServer::startError(Connection& c, uint16_t status, const char* reason) {
+  char text[192];
+  snprintf(text, sizeof(text),
+           "HTTP/1.1 %u %s\r\nContent-Type: text/plain\r\nContent-Length: %u\r\n%sConnection: %s\r\n\r\n%s\n",
+           status, reason, (unsigned)strlen(reason) + 1, status == 503 ? "Retry-After: 1\r\n" : "",
+           connectionHeader(c.keepAlive), c.method == METHOD_HEAD ? "" : reason);
+  if (c.method == METHOD_HEAD) text[strlen(text) - 1] = 0;
+  append(c, text);
+  counters.errors++;
+}
+
+void HttpServer::fillHistory(Connection& c) {
+  char* data = (char*)c.out;
+  size_t used = CHUNK_HEADER;
+  // Leaves room for the chunk's CRLF and the last chunk
+  size_t limit = HTTP_CHUNK_BYTES - 2 - (sizeof(CHUNK_END) - 1);
+  bool done = false;
+  while (used + HISTORY_LINE_ROOM <= limit) {
+    HistorySample sample;
+    bool more;
+    if (c.body == BODY_ARCHIVE) {
+      more = archive->next(*archiveCursor, sample) && sample.timestamp <= c.to;
+    } else {
+      // Samples overwritten while the client was slow are skipped
+      if (c.next < ring.first()) c.next = ring.first();
+      more = ring.get(c.next, sample) && sample.timestamp <= c.to;
+      if (more) c.next++;
+    }
+    if (!more) {
+      done = true;
+      break;
+    }
+    if (c.json) data[used++] = c.first ? '[' : ',';
+    used += formatHistoryLine(sample, data + used, limit - used);
+    c.first = false;
+  }
+  if (done && c.json) {
+    if (c.first) data[used++] = '[';
+    data[used++] = ']';
+    data[used++] = '\n';
+  }
+
+  size_t length = used - CHUNK_HEADER;
+  size_t start = 0;
+  if (length) {
+    char size[12];
+    snprintf(size, sizeof(size), "%04X\r\n", (unsigned)length);
+    memcpy(data, size, CHUNK_HEADER);
+    data[used++] = '\r';
+    data[used++] = '\n';
+  } else {
+    start = CHUNK_HEADER;
+  }
+  if (done) {
+    memcpy(data + used, CHUNK_END, sizeof(CHUNK_END) - 1);
+    used += sizeof(CHUNK_END) - 1;
+    if (c.body == BODY_ARCHIVE) archiveOwner = -1;
+    c.body = BODY_NONE;
+  }
+  c.outSent = (uint16_t)start;
+  c.outLength = (uint16_t)used;
+}
+
+bool HttpServer::flush(uint8_t id, Connection& c) {
+  if (c.outSent < c.outLength) {
+    size_t n = port.write(id, c.out + c.outSent, c.outLength - c.outSent, false);
+    c.outSent += (uint16_t)n;
+    counters.bytesSent += n;
+    if (n) c.activeMs = millis();
+    if (c.outSent < c.outLength) return false;
+  }
+  c.outSent = 0;
+  c.outLength = 0;
+  return true;
+}
+
+void HttpServer::publish(const HistorySample& sample) {
+  char event[128];
+  memcpy(event, "data: ", 6);
+  size_t length = 6 + formatHistoryLine(sample, event + 6, sizeof(event) - 7);
+  event[length++] = '\n';
+  for (uint8_t id = 0; id < HTTP_MAX_CONNECTIONS; id++) {
+    Connection& c = slots[id];
+    if (c.state != STREAMING) continue;
+    if (c.outSent) {
+      memmove(c.out, c.out + c.outSent, c.outLength - c.outSent);
+      c.outLength -= c.outSent;
+      c.outSent = 0;
+    }
+    if (c.outLength + length > HTTP_CHUNK_BYTES) {
+      counters.eventsDropped++;
+      continue;
+    }
+    memcpy(c.out + c.outLength, event, length);
+    c.outLength += (uint16_t)length;
+    counters.eventsSent++;
+    flush(id, c);
+  }
+}
+
+size_t HttpServer::append(Connection& c, const char* text) {
+  size_t length = strlen(text);
+  if (c.outLength + length > HTTP_CHUNK_BYTES) length = HTTP_CHUNK_BYTES - c.outLength;
+  memcpy(c.out + c.outLength, text, length);
+  c.outLength += (uint16_t)length;
+  return length;
+}
+
+void HttpServer::finish(uint8_t id, Connection& c) {
+  if (!c.keepAlive) {
+    drop(id, c);
+    return;
+  }
+  c.state = READING;
+  c.body = BODY_NONE;
+  c.lineLength = 0;
+  c.lineOverflow = false;
+  c.target[0] = 0;
+  c.activeMs = millis();
+}
+
+void HttpServer::drop(uint8_t id, Connection& c) {
+  if (archiveOwner == (int8_t)id) archiveOwner = -1;
+  port.close(id);
+  c.state = CLOSED;
+  c.body = BODY_NONE;
+  c.outLength = 0;
+  c.outSent = 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * RescueNet AI - Non-blocking HTTP server for the local dashboard
+ *
+ * The sketches served the dashboard with the synchronous WebServer: one
+ * client at a time, the page built in a String on every request, and a
+ * /data snapshot to poll. This server keeps up to HTTP_MAX_CONNECTIONS
+ * connections going at once over a TcpServerPort and never waits on any
+ * of them; poll() does whatever each one is ready for and returns.
+ *
+ *   assets     gzipped files compiled into flash (HttpAsset), sent
+ *              straight from flash without a copy, with an ETag; a
+ *              matching If-None-Match gets 304 and no body
+ *   /history   the samples of the last ?minutes=60, or ?from=..&to=..
+ *              (seconds), as NDJSON, or a JSON array with ?format=json,
+ *              in HTTP_CHUNK_BYTES chunks from the HistoryRing in RAM. A
+ *              range older than the ring comes from the SD card history
+ *              (attachArchive()), one such request at a time.
+ *   /events    Server-Sent Events: every publish()ed sample, as the same
+ *              JSON as a history line. A subscriber too slow to take one
+ *              misses it rather than holding the others up.
+ *
+ * Connections are kept alive between requests; requests are not
+ * pipelined. Each poll() fills at most one chunk per connection, so its
+ * cost is bounded whatever the clients do.
+ */
+
+#ifndef RESCUENET_HTTP_SERVER_H
+#define RESCUENET_HTTP_SERVER_H
+
+#include "hal.h"
+#include "history_log.h"
+#include "history_ring.h"
+
+#ifndef HTTP_MAX_CONNECTIONS
+#define HTTP_MAX_CONNECTIONS 8
+#endif
+
+// Method, path and query; longer request lines get 414
+#define HTTP_TARGET_MAX 96
+// Buffer per connection for headers, history chunks and events
+#ifndef HTTP_CHUNK_BYTES
+#define HTTP_CHUNK_BYTES 1024
+#endif
+// Bytes taken from a connection per poll()
+#define HTTP_READ_BYTES 256
+// A connection waiting for a request, or unable to take any bytes, is
+// closed after this long
+#define HTTP_IDLE_TIMEOUT_MS 15000
+// Comment line that keeps an idle event stream open through proxies
+#define HTTP_EVENT_PING_MS 15000
+
+struct HttpAsset {
+  const char* path;
+  const char* contentType;
+  const uint8_t* data;  // In flash (PROGMEM)
+  uint32_t length;
+  const char* etag;     // Quoted, e.g. "\"3f2a9c1e\""
+  bool gzip;
+};
+
+struct HttpServerStats {
+  uint32_t accepted;
+  uint32_t refused;       // All connections busy
+  uint32_t requests;
+  uint32_t notModified;   // 304s
+  uint32_t errors;        // 4xx and 5xx
+  uint32_t timeouts;
+  uint32_t bytesSent;
+  uint32_t bytesStable;   // Of bytesSent, sent from flash without a copy
+  uint32_t eventsSent;    // Event copies queued, one per subscriber
+  uint32_t eventsDropped; // Subscribers that had no room for one
+};
+
+class HttpServer {
+public:
+  HttpServer(TcpServerPort& port, HistoryRing& ring);
+
+  void setAssets(const HttpAsset* assets, uint8_t count);
+  // SD history for ranges that begin before the ring; the cursor holds a
+  // page, so there is one, shared by the requests in turn
+  void attachArchive(HistoryLog* log, HistoryCursor* cursor);
+
+  // Accepts, reads and writes what it can without blocking; call every
+  // few milliseconds
+  void poll();
+  // A live sample to every /events subscriber
+  void publish(const HistorySample& sample);
+
+  uint8_t connections() const;
+  uint8_t subscribers() const;
+  const HttpServerStats& stats() const { return counters; }
+
+private:
+  struct Connection {
+    uint8_t state;
+    uint8_t body;            // What follows the headers
+    uint8_t method;
+    uint16_t status;         // Set while reading when the request cannot be served
+    bool keepAlive;
+    bool notModified;
+    bool lineOverflow;
+    uint8_t lineLength;
+    char line[HTTP_TARGET_MAX];  // Request line, then each header in turn
+    char target[HTTP_TARGET_MAX];
+    const HttpAsset* asset;
+    uint32_t sent;           // Of the asset
+    uint32_t next;           // History: next ring sequence
+    uint32_t to;             // History: last timestamp wanted
+    bool json;
+    bool first;              // No history line sent yet
+    unsigned long activeMs;  // Last progress
+    uint16_t outLength;
+    uint16_t outSent;
+    uint8_t out[HTTP_CHUNK_BYTES];
+  };
+
+  void serve(uint8_t id);
+  void readRequest(uint8_t id, Connection& c);
+  void endLine(Connection& c);
+  void respond(uint8_t id, Connection& c);
+  void startHistory(Connection& c, const char* query);
+  void startError(Connection& c, uint16_t status, const char* reason);
+  bool flush(uint8_t id, Connection& c);
+  void fillHistory(Connection& c);
+  void finish(uint8_t id, Connection& c);
+  void drop(uint8_t id, Connection& c);
+  size_t append(Connection& c, const char* text);
+
+  TcpServerPort& port;
+  HistoryRing& ring;
+  const HttpAsset* assets;
+  uint8_t assetCount;
+  HistoryLog* archive;
+  HistoryCursor* archiveCursor;
+  int8_t archiveOwner;       // Connection reading the archive, or -1
+  Connection slots[HTTP_MAX_CONNECTIONS];
+  HttpServerStats counters;
+};
+
+#endif
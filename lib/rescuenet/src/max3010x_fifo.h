@@ -0,0 +1,139 @@
+/*
+ * RescueNet AI - MAX3010x FIFO burst reader
+ *
+ * SparkFun's check() copies the FIFO into a 4-sample buffer and silently
+ * drops the rest, so the sketches read the FIFO registers themselves:
+ * one transaction for the write pointer / overflow counter / read
+ * pointer, then 6-byte red+IR samples in bursts sized to the Wire buffer.
+ * max3010xBegin() and max3010xConfigure() set the chip up the way
+ * SparkFun's setup() does for the sketches, for the Nano, which has no
+ * RAM for that driver's own sample buffer.
+ * Header only; the host build never includes it.
+ */
+
+#ifndef RESCUENET_MAX3010X_FIFO_H
+#define RESCUENET_MAX3010X_FIFO_H
+
+#include <Wire.h>
+
+#include "hal.h"
+
+#define MAX3010X_ADDRESS 0x57
+#define MAX3010X_FIFO_WR_PTR 0x04
+#define MAX3010X_FIFO_OVF 0x05
+#define MAX3010X_FIFO_RD_PTR 0x06
+#define MAX3010X_FIFO_DATA 0x07
+#define MAX3010X_FIFO_CONFIG 0x08
+#define MAX3010X_MODE_CONFIG 0x09
+#define MAX3010X_SPO2_CONFIG 0x0A
+#define MAX3010X_LED_RED 0x0C
+#define MAX3010X_LED_IR 0x0D
+#define MAX3010X_LED_GREEN 0x0E
+#define MAX3010X_LED_PILOT 0x10
+#define MAX3010X_PART_ID 0xFF
+
+#define MAX3010X_PART 0x15
+#define MAX3010X_LED_CURRENT 0x1F  // 6.4 mA, red and IR alike
+
+#if defined(BUFFER_LENGTH)
+#define MAX3010X_BURST_SAMPLES (BUFFER_LENGTH / 6)
+#else
+#define MAX3010X_BURST_SAMPLES 5
+#endif
+
+inline bool max3010xWrite(TwoWire& wire, uint8_t reg, uint8_t value) {
+  wire.beginTransmission(MAX3010X_ADDRESS);
+  wire.write(reg);
+  wire.write(value);
+  return wire.endTransmission() == 0;
+}
+
+// Resets the chip; false when no MAX3010x answers at 0x57
+inline bool max3010xBegin(TwoWire& wire) {
+  wire.beginTransmission(MAX3010X_ADDRESS);
+  wire.write(MAX3010X_PART_ID);
+  if (wire.endTransmission(false) != 0) return false;
+  if (wire.requestFrom((uint8_t)MAX3010X_ADDRESS, (uint8_t)1) != 1) return false;
+  if (wire.read() != MAX3010X_PART) return false;
+  if (!max3010xWrite(wire, MAX3010X_MODE_CONFIG, 0x40)) return false;
+  // The reset bit clears itself within a millisecond
+  for (uint8_t tries = 0; tries < 10; tries++) {
+    delay(1);
+    wire.beginTransmission(MAX3010X_ADDRESS);
+    wire.write(MAX3010X_MODE_CONFIG);
+    if (wire.endTransmission(false) != 0) return false;
+    if (wire.requestFrom((uint8_t)MAX3010X_ADDRESS, (uint8_t)1) != 1) return false;
+    if (!(wire.read() & 0x40)) return true;
+  }
+  return false;
+}
+
+// SpO2 mode (red + IR), 411 us pulses, 4096 nA full scale, FIFO rollover
+// on and the FIFO emptied; sampleRateHz 50..3200, averaging 1..32
+inline bool max3010xConfigure(TwoWire& wire, uint16_t sampleRateHz, uint8_t averaging) {
+  uint8_t rate;
+  switch (sampleRateHz) {
+    case 50: rate = 0; break;
+    case 100: rate = 1; break;
+    case 200: rate = 2; break;
+    case 400: rate = 3; break;
+    case 800: rate = 4; break;
+    case 1000: rate = 5; break;
+    case 1600: rate = 6; break;
+    case 3200: rate = 7; break;
+    default: return false;
+  }
+  uint8_t average = 0;
+  while (average < 6 && (1 << average) != averaging) average++;
+  if (average == 6) return false;
+  return max3010xWrite(wire, MAX3010X_FIFO_CONFIG, (uint8_t)(average << 5 | 0x10)) &&
+         max3010xWrite(wire, MAX3010X_MODE_CONFIG, 0x03) &&
+         max3010xWrite(wire, MAX3010X_SPO2_CONFIG, (uint8_t)(0x20 | rate << 2 | 0x03)) &&
+         max3010xWrite(wire, MAX3010X_LED_RED, MAX3010X_LED_CURRENT) &&
+         max3010xWrite(wire, MAX3010X_LED_IR, MAX3010X_LED_CURRENT) &&
+         max3010xWrite(wire, MAX3010X_LED_GREEN, 0) &&
+         max3010xWrite(wire, MAX3010X_LED_PILOT, MAX3010X_LED_CURRENT) &&
+         max3010xWrite(wire, MAX3010X_FIFO_WR_PTR, 0) &&
+         max3010xWrite(wire, MAX3010X_FIFO_OVF, 0) &&
+         max3010xWrite(wire, MAX3010X_FIFO_RD_PTR, 0);
+}
+
+inline uint32_t max3010xRead18(TwoWire& wire) {
+  uint32_t value = (uint32_t)wire.read() << 16;
+  value |= (uint32_t)wire.read() << 8;
+  value |= (uint32_t)wire.read();
+  return value & 0x3FFFF;
+}
+
+// Reads up to maxSamples red/IR pairs (SpO2 LED mode) from the FIFO
+inline uint8_t max3010xReadFifo(TwoWire& wire, PpgSample* out, uint8_t maxSamples, uint8_t& overflowed) {
+  wire.beginTransmission(MAX3010X_ADDRESS);
+  wire.write(MAX3010X_FIFO_WR_PTR);
+  if (wire.endTransmission(false) != 0) return 0;
+  if (wire.requestFrom((uint8_t)MAX3010X_ADDRESS, (uint8_t)3) != 3) return 0;
+  uint8_t writePtr = wire.read() & 0x1F;
+  overflowed = wire.read() & 0x1F;
+  uint8_t readPtr = wire.read() & 0x1F;
+
+  uint8_t queued = (writePtr - readPtr) & 0x1F;
+  if (queued == 0 && overflowed) queued = 32;  // Pointers meet when the FIFO is full
+  if (queued > maxSamples) queued = maxSamples;
+
+  uint8_t done = 0;
+  while (done < queued) {
+    uint8_t burst = queued - done;
+    if (burst > MAX3010X_BURST_SAMPLES) burst = MAX3010X_BURST_SAMPLES;
+    wire.beginTransmission(MAX3010X_ADDRESS);
+    wire.write(MAX3010X_FIFO_DATA);
+    if (wire.endTransmission(false) != 0) break;
+    if (wire.requestFrom((uint8_t)MAX3010X_ADDRESS, (uint8_t)(burst * 6)) != burst * 6) break;
+    for (uint8_t i = 0; i < burst; i++) {
+      out[done].red = max3010xRead18(wire);
+      out[done].ir = max3010xRead18(wire);
+      done++;
+    }
+  }
+  return done;
+}
+
+#endif
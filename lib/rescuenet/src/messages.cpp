@@ -0,0 +1,32 @@
+/*
+ * RescueNet AI - Message templates
+ */
+
+#include "messages.h"
+
+#include <Arduino.h>
+
+static_assert(ALERT_REASON_MAX <= MESSAGE_TEXT_MAX, "alert reasons must fit a %s field");
+
+namespace {
+
+MessageArg timeOf(const TelemetryRecord& record) {
+  return messageTime(record.timestamp, (record.flags & TELEMETRY_FLAG_WALL_CLOCK) != 0);
+}
+
+}  // namespace
+
+void writeAlertJson(TextWriter& out, const TelemetryRecord& record) {
+  formatMessage(out, PSTR(ALERT_JSON_TEMPLATE), record.userId, record.reason ? record.reason : "", timeOf(record),
+                record.latitude, record.longitude, record.heartRate, record.temperature, record.spO2,
+                record.bloodPressureSys);
+}
+
+void writeHealthJson(TextWriter& out, const TelemetryRecord& record) {
+  formatMessage(out, PSTR(HEALTH_JSON_TEMPLATE), record.userId, timeOf(record), record.heartRate, record.temperature,
+                record.spO2, record.bloodPressureSys);
+  if (record.flags & TELEMETRY_FLAG_LOCATION) {
+    formatMessage(out, PSTR(HEALTH_JSON_LOCATION_TEMPLATE), record.latitude, record.longitude);
+  }
+  formatMessage(out, PSTR(HEALTH_JSON_MOTION_TEMPLATE), record.accelX, record.accelY, record.accelZ);
+}
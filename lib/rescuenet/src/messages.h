@@ -0,0 +1,70 @@
+/*
+ * RescueNet AI - Message templates
+ *
+ * The texts the device sends, as formatMessage() templates (text_format.h)
+ * with the longest result of each worked out at compile time:
+ *
+ *   ALERT_*_TEMPLATE      reasons detectEmergency() gives for an alert
+ *   EMERGENCY_SMS_*       the SMS to the emergency contact
+ *   ALERT_JSON_*          the alert posted to the emergency URL
+ *   HEALTH_JSON_*         one reading in the JSON array of a health batch
+ *   DISPLAY_*_TEMPLATE    vitals lines of the status display
+ *
+ * The JSON bodies are filled in from a telemetry record by the write
+ * functions; a TextBuffer of the matching *_MAX always has room. Callers
+ * pass the templates as PSTR(TEMPLATE), which keeps them in flash.
+ */
+
+#ifndef RESCUENET_MESSAGES_H
+#define RESCUENET_MESSAGES_H
+
+#include "telemetry.h"
+#include "text_format.h"
+
+#define ALERT_HEART_RATE_TEMPLATE "Abnormal heart rate: %f BPM"
+#define ALERT_TEMPERATURE_TEMPLATE "Abnormal temperature: %fC"
+#define ALERT_REASON_SEPARATOR "; "
+const size_t ALERT_REASON_MAX = messageMax(ALERT_HEART_RATE_TEMPLATE) + sizeof(ALERT_REASON_SEPARATOR) - 1 +
+                                messageMax(ALERT_TEMPERATURE_TEMPLATE);
+
+// User id, time, heart rate, temperature, SpO2; then the latitude and
+// longitude of a GPS fix, or the unknown location, and the closing line
+#define EMERGENCY_SMS_TEMPLATE                   \
+  "EMERGENCY ALERT - RescueNet AI\n"             \
+  "User: %u\n"                                   \
+  "Time: %t\n"                                   \
+  "Heart Rate: %i BPM\n"                         \
+  "Temperature: %1C\n"                           \
+  "SpO2: %i%%\n"
+#define EMERGENCY_SMS_LOCATION_TEMPLATE "Location: %4,%4\n"
+#define EMERGENCY_SMS_NO_LOCATION "Location: unknown\n"
+#define EMERGENCY_SMS_END "Please respond immediately!"
+const size_t EMERGENCY_SMS_MAX = messageMax(EMERGENCY_SMS_TEMPLATE) + messageMax(EMERGENCY_SMS_LOCATION_TEMPLATE) +
+                                 messageMax(EMERGENCY_SMS_END);
+static_assert(messageMax(EMERGENCY_SMS_NO_LOCATION) <= messageMax(EMERGENCY_SMS_LOCATION_TEMPLATE),
+              "the unknown location must fit the room of a known one");
+
+#define ALERT_JSON_TEMPLATE                                            \
+  "{\"userId\":\"%u\",\"reason\":\"%s\",\"timestamp\":\"%t\","         \
+  "\"location\":{\"lat\":%4,\"lng\":%4},"                              \
+  "\"vitals\":{\"heartRate\":%f,\"temperature\":%f,\"spO2\":%1,"       \
+  "\"bloodPressure\":%f}}"
+const size_t ALERT_JSON_MAX = messageMax(ALERT_JSON_TEMPLATE);
+
+#define HEALTH_JSON_TEMPLATE                                           \
+  "{\"userId\":\"%u\",\"timestamp\":\"%t\","                           \
+  "\"vitals\":{\"heartRate\":%f,\"temperature\":%f,\"spO2\":%1,"       \
+  "\"bloodPressure\":%f},"
+#define HEALTH_JSON_LOCATION_TEMPLATE "\"location\":{\"lat\":%4,\"lng\":%4},"
+#define HEALTH_JSON_MOTION_TEMPLATE "\"accelerometer\":{\"x\":%f,\"y\":%f,\"z\":%f}}"
+const size_t HEALTH_JSON_MAX = messageMax(HEALTH_JSON_TEMPLATE) + messageMax(HEALTH_JSON_LOCATION_TEMPLATE) +
+                               messageMax(HEALTH_JSON_MOTION_TEMPLATE);
+
+#define DISPLAY_HEART_RATE_TEMPLATE "HR: %i"
+#define DISPLAY_TEMPERATURE_TEMPLATE "Temp: %1C"
+const size_t DISPLAY_LINE_MAX = messageMax(DISPLAY_TEMPERATURE_TEMPLATE);
+
+void writeAlertJson(TextWriter& out, const TelemetryRecord& record);
+void writeHealthJson(TextWriter& out, const TelemetryRecord& record);
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * RescueNet AI - Two-core monitor pipeline
+ */
+
+#include "monitor_pipeline.h"
+
+#if MONITOR_PIPELINE_ENABLED
+
+#include <string.h>
+
+MonitorPipeline::MonitorPipeline()
+  : holding(false), profile(PIPELINE_NO_PROFILE), profileTaken(PIPELINE_NO_PROFILE), radioMs(0) {
+  memset(&counters, 0, sizeof(counters));
+}
+
+bool MonitorPipeline::submit(uint8_t kind, const uint8_t* record, size_t length) {
+  retryHeld();
+  if (length > TELEMETRY_MAX_SIZE) length = TELEMETRY_MAX_SIZE;
+  // Checked before push() so a refusal is only counted here
+  if (holding || jobs.space() == 0) {
+    if (kind != PIPELINE_JOB_ALERT) {
+      counters.readingsDropped++;
+      return false;
+    }
+    if (holding) {
+      counters.alertsDropped++;
+      return false;
+    }
+    held.kind = kind;
+    held.length = (uint8_t)length;
+    held.queuedUs = micros();
+    memcpy(held.record, record, length);
+    holding = true;
+    counters.alertsHeld++;
+    return true;
+  }
+  PipelineJob job;
+  job.kind = kind;
+  job.length = (uint8_t)length;
+  job.queuedUs = micros();
+  memcpy(job.record, record, length);
+  return jobs.push(job);
+}
+
+void MonitorPipeline::retryHeld() {
+  if (holding && jobs.space() > 0) {
+    jobs.push(held);
+    holding = false;
+  }
+}
+
+bool MonitorPipeline::takeEvent(PipelineEvent& event) {
+  if (!events.pop(event)) return false;
+  counters.eventWait.add(micros() - event.queuedUs);
+  return true;
+}
+
+void MonitorPipeline::publishProfile(uint8_t policy, uint8_t level) {
+  profile.store((uint8_t)(policy << 1 | (level & 1)), std::memory_order_release);
+}
+
+bool MonitorPipeline::takeProfile(uint8_t& policy, uint8_t& level) {
+  uint8_t latest = profile.load(std::memory_order_acquire);
+  if (latest == profileTaken) return false;
+  profileTaken = latest;
+  policy = latest >> 1;
+  level = latest & 1;
+  return true;
+}
+
+bool MonitorPipeline::takeJob(PipelineJob& job) {
+  if (!jobs.pop(job)) return false;
+  counters.jobWait.add(micros() - job.queuedUs);
+  return true;
+}
+
+void MonitorPipeline::post(uint8_t kind, bool ok, const char* text) {
+  if (events.space() == 0) {
+    counters.eventsDropped++;
+    return;
+  }
+  PipelineEvent event;
+  event.kind = kind;
+  event.ok = ok;
+  event.queuedUs = micros();
+  strncpy(event.text, text ? text : "", PIPELINE_TEXT_MAX);
+  event.text[PIPELINE_TEXT_MAX] = '\0';
+  events.push(event);
+}
+
+#endif
@@ -0,0 +1,146 @@
+/*
+ * RescueNet AI - Two-core monitor pipeline
+ *
+ * On the ESP32 the health monitor can run as two loops instead of one:
+ * acquisition (sensor FIFOs, detection, button, alarm, display) on one
+ * core at high priority and network (uploads, alert POST, SMS, dashboard
+ * channel) on the other, so a slow POST or modem exchange no longer
+ * holds up sensor reads. The loops share nothing but two SpscRings and
+ * two atomic words:
+ *
+ *   jobs    acquisition -> network: readings to upload and alerts to
+ *           send, as encoded telemetry.h records
+ *   events  network -> acquisition: dashboard messages and SMS outcomes
+ *           for the display, LEDs and buzzer
+ *   profile acquisition -> network: the DutyCycle policy and level the
+ *           network tasks run at, the latest one only
+ *   radio   network -> acquisition: time inside HTTP requests not yet
+ *           in the power ledger
+ *
+ * A full jobs ring is backpressure: readings are dropped and counted. An
+ * alert that finds no room waits in a slot of its own and goes in as
+ * soon as there is; readings are dropped while it waits so it keeps its
+ * place, as is a second alert. Events that find no room are dropped and
+ * counted.
+ *
+ * Every handoff is stamped with micros(), which gives the time each
+ * stage takes (StageLatency): the wait in each ring and the network
+ * work for an alert.
+ */
+
+#ifndef RESCUENET_MONITOR_PIPELINE_H
+#define RESCUENET_MONITOR_PIPELINE_H
+
+#include <Arduino.h>
+
+#include "spsc_ring.h"
+#include "telemetry.h"
+
+// The Nano has one core and no room for the rings
+#ifndef MONITOR_PIPELINE_ENABLED
+#if defined(__AVR__)
+#define MONITOR_PIPELINE_ENABLED 0
+#else
+#define MONITOR_PIPELINE_ENABLED 1
+#endif
+#endif
+
+#ifndef PIPELINE_JOB_RING
+#define PIPELINE_JOB_RING 8
+#endif
+#ifndef PIPELINE_EVENT_RING
+#define PIPELINE_EVENT_RING 4
+#endif
+// Dashboard message text carried to the display
+#define PIPELINE_TEXT_MAX 40
+#define PIPELINE_NO_PROFILE 0xFF
+
+enum PipelineJobKind {
+  PIPELINE_JOB_READING = 1,
+  PIPELINE_JOB_ALERT = 2   // Alert POST, then the SMS
+};
+
+enum PipelineEventKind {
+  PIPELINE_EVENT_RESPONSE = 1,  // Dashboard "emergency_response"
+  PIPELINE_EVENT_ALERT = 2,     // Dashboard "health_alert" with text
+  PIPELINE_EVENT_SMS = 3        // SMS outcome in ok
+};
+
+struct PipelineJob {
+  uint8_t kind;
+  uint8_t length;
+  uint32_t queuedUs;
+  uint8_t record[TELEMETRY_MAX_SIZE];
+};
+
+struct PipelineEvent {
+  uint8_t kind;
+  bool ok;
+  uint32_t queuedUs;
+  char text[PIPELINE_TEXT_MAX + 1];
+};
+
+struct StageLatency {
+  uint32_t count;
+  uint32_t totalUs;
+  uint32_t maxUs;
+
+  void add(uint32_t us) {
+    count++;
+    totalUs += us;
+    if (us > maxUs) maxUs = us;
+  }
+  uint32_t meanUs() const { return count ? totalUs / count : 0; }
+};
+
+struct PipelineStats {
+  StageLatency jobWait;    // Queued on acquisition to taken on network
+  StageLatency alertWork;  // Alert POST and SMS hand-off on network
+  StageLatency eventWait;  // Queued on network to applied on acquisition
+  uint32_t readingsDropped;
+  uint32_t alertsHeld;     // Alerts that had to wait for room
+  uint32_t alertsDropped;  // Raised while another was still held
+  uint32_t eventsDropped;
+};
+
+#if MONITOR_PIPELINE_ENABLED
+
+class MonitorPipeline {
+public:
+  MonitorPipeline();
+
+  // Acquisition side
+  bool submit(uint8_t kind, const uint8_t* record, size_t length);
+  // Moves a held alert into the ring once there is room
+  void retryHeld();
+  bool takeEvent(PipelineEvent& event);
+  void publishProfile(uint8_t policy, uint8_t level);
+  // Radio time added since the last call
+  uint32_t takeRadioMs() { return radioMs.exchange(0, std::memory_order_relaxed); }
+
+  // Network side
+  bool takeJob(PipelineJob& job);
+  void post(uint8_t kind, bool ok, const char* text);
+  StageLatency& alertWork() { return counters.alertWork; }
+  // The profile published last; false when it was taken already
+  bool takeProfile(uint8_t& policy, uint8_t& level);
+  void addRadioMs(uint32_t ms) { radioMs.fetch_add(ms, std::memory_order_relaxed); }
+
+  size_t jobHighWater() const { return jobs.highWaterMark(); }
+  size_t eventHighWater() const { return events.highWaterMark(); }
+  const PipelineStats& stats() const { return counters; }
+
+private:
+  SpscRing<PipelineJob, PIPELINE_JOB_RING> jobs;
+  SpscRing<PipelineEvent, PIPELINE_EVENT_RING> events;
+  PipelineJob held;
+  bool holding;
+  std::atomic<uint8_t> profile;  // policy << 1 | level, PIPELINE_NO_PROFILE before the first
+  uint8_t profileTaken;          // Network side's copy
+  std::atomic<uint32_t> radioMs;
+  PipelineStats counters;
+};
+
+#endif
+
+#endif
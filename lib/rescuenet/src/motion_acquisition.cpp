@@ -0,0 +1,85 @@
+/*
+ * RescueNet AI - Streaming IMU acquisition
+ */
+
+#include "motion_acquisition.h"
+
+namespace {
+
+// Samples pulled per drain call; 12 bytes each
+const uint8_t DRAIN_CHUNK = 8;
+
+}  // namespace
+
+MotionAcquisition::MotionAcquisition(ImuSensor* sensor)
+  : sensor(sensor), fusion(nullptr), rateHz(0), lastDrainUs(0), fallPending(false) {
+  memset(&latest, 0, sizeof(latest));
+  memset(&counters, 0, sizeof(counters));
+}
+
+bool MotionAcquisition::begin(uint16_t sampleRateHz) {
+  if (!sensor || sampleRateHz == 0) return false;
+  if (!sensor->configure(sampleRateHz)) return false;
+  rateHz = sampleRateHz;
+  detector.setSampleRate(rateHz);
+  detector.reset();
+  if (fusion) fusion->setMotionRate(rateHz);
+  lastDrainUs = micros();
+  return true;
+}
+
+bool MotionAcquisition::poll() {
+  if (!sensor || rateHz == 0) return false;
+
+  ImuSample burst[DRAIN_CHUNK];
+  uint16_t drained = 0;
+  bool full = false;
+  bool overflowed = false;
+  for (;;) {
+    // As in PpgAcquisition: what the ring has no room for stays in the FIFO
+    uint8_t want = ring.space() < DRAIN_CHUNK ? (uint8_t)ring.space() : DRAIN_CHUNK;
+    if (want == 0) {
+      full = true;
+      break;
+    }
+    bool lost = false;
+    uint8_t n = sensor->readFifo(burst, want, lost);
+    overflowed |= lost;
+    for (uint8_t i = 0; i < n; i++) {
+      ring.push(burst[i]);
+    }
+    drained += n;
+    if (n < want) break;
+  }
+
+  unsigned long now = micros();
+  if (overflowed) {
+    // The FIFO was reset; everything since the last drain is gone
+    uint32_t expected = (uint32_t)((uint64_t)(now - lastDrainUs) * rateHz / 1000000UL);
+    if (expected > drained) counters.fifoOverflows += expected - drained;
+  }
+  lastDrainUs = now;
+
+  counters.samplesRead += drained;
+  counters.ringDrops = ring.droppedCount();
+  counters.drains++;
+  if (drained > counters.maxBurst) counters.maxBurst = drained > 255 ? 255 : (uint8_t)drained;
+  return full;
+}
+
+void MotionAcquisition::process() {
+  ImuSample sample;
+  while (ring.pop(sample)) {
+    latest = sample;
+    counters.samplesProcessed++;
+    if (!detector.isStill(sample)) counters.movingSamples++;
+    if (detector.addSample(sample)) fallPending = true;
+    if (fusion) fusion->addMotion(sample);
+  }
+}
+
+bool MotionAcquisition::takeFall() {
+  if (!fallPending) return false;
+  fallPending = false;
+  return true;
+}
@@ -0,0 +1,73 @@
+/*
+ * RescueNet AI - Streaming IMU acquisition
+ *
+ * The MPU6050 samples accel + gyro into its 1 KB FIFO (85 samples).
+ * poll() drains it in bursts into a lock-free ring, as far as the ring
+ * has room; process() runs the fall detector on every queued sample and
+ * latches confirmed falls until the monitor takes them. Same split as
+ * PpgAcquisition: poll() may run from a timer task while process() runs
+ * in the main loop. process() also hands every sample to an attached
+ * HeartRateFusion as its motion reference.
+ */
+
+#ifndef RESCUENET_MOTION_ACQUISITION_H
+#define RESCUENET_MOTION_ACQUISITION_H
+
+#include "hal.h"
+#include "fall_detector.h"
+#include "heart_rate_fusion.h"
+#include "spsc_ring.h"
+
+#ifndef MOTION_RING_SIZE
+#if defined(__AVR__)
+#define MOTION_RING_SIZE 4  // The FIFO holds 85; the motion task drains it in steps
+#else
+#define MOTION_RING_SIZE 64
+#endif
+#endif
+
+struct MotionStats {
+  uint32_t samplesRead;       // Drained from the sensor FIFO
+  uint32_t samplesProcessed;  // Run through fall detection
+  uint32_t fifoOverflows;     // Samples lost to FIFO overflow (estimated)
+  uint32_t ringDrops;         // Lost because process() fell behind
+  uint32_t movingSamples;     // Processed outside the fall detector's still band
+  uint32_t drains;
+  uint8_t maxBurst;           // Most samples found in the FIFO by one drain
+};
+
+class MotionAcquisition {
+public:
+  explicit MotionAcquisition(ImuSensor* sensor);
+
+  bool begin(uint16_t sampleRateHz = 100);
+  // Before begin(); null detaches
+  void setFusion(HeartRateFusion* value) { fusion = value; }
+
+  // Producer: move what the hardware FIFO holds into the ring. True when
+  // the ring filled up first: call process() and poll again.
+  bool poll();
+  // Consumer: fall detection on every queued sample
+  void process();
+
+  // True once per confirmed fall
+  bool takeFall();
+
+  const ImuSample& lastSample() const { return latest; }
+  const FallDetector& falls() const { return detector; }
+  uint16_t outputRateHz() const { return rateHz; }
+  const MotionStats& stats() const { return counters; }
+
+private:
+  ImuSensor* sensor;
+  HeartRateFusion* fusion;
+  SpscRing<ImuSample, MOTION_RING_SIZE> ring;
+  FallDetector detector;
+  uint16_t rateHz;
+  unsigned long lastDrainUs;
+  bool fallPending;
+  ImuSample latest;
+  MotionStats counters;
+};
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * RescueNet AI - MPU6050 FIFO configuration and burst reader
+ *
+ * Neither driver library the sketches used exposes the FIFO, so the
+ * registers are programmed directly: 1 kHz internal rate (DLPF 44 Hz)
+ * divided down to the requested rate, +-8 g / +-500 deg/s, and accel +
+ * gyro pushed into the FIFO as 12-byte samples. A FIFO overflow breaks
+ * the 12-byte alignment, so the FIFO is reset and the loss reported.
+ * Header only; the host build never includes it.
+ */
+
+#ifndef RESCUENET_MPU6050_FIFO_H
+#define RESCUENET_MPU6050_FIFO_H
+
+#include <Wire.h>
+
+#include "hal.h"
+
+#define MPU6050_ADDRESS 0x68
+#define MPU6050_SMPLRT_DIV 0x19
+#define MPU6050_CONFIG 0x1A
+#define MPU6050_GYRO_CONFIG 0x1B
+#define MPU6050_ACCEL_CONFIG 0x1C
+#define MPU6050_FIFO_EN 0x23
+#define MPU6050_INT_STATUS 0x3A
+#define MPU6050_USER_CTRL 0x6A
+#define MPU6050_PWR_MGMT_1 0x6B
+#define MPU6050_FIFO_COUNT_H 0x72
+#define MPU6050_FIFO_R_W 0x74
+#define MPU6050_WHO_AM_I 0x75
+
+#define MPU6050_SAMPLE_BYTES 12
+
+#if defined(BUFFER_LENGTH)
+#define MPU6050_BURST_SAMPLES (BUFFER_LENGTH / MPU6050_SAMPLE_BYTES)
+#else
+#define MPU6050_BURST_SAMPLES 2
+#endif
+
+inline bool mpu6050Write(TwoWire& wire, uint8_t reg, uint8_t value) {
+  wire.beginTransmission(MPU6050_ADDRESS);
+  wire.write(reg);
+  wire.write(value);
+  return wire.endTransmission() == 0;
+}
+
+inline bool mpu6050Read(TwoWire& wire, uint8_t reg, uint8_t length) {
+  wire.beginTransmission(MPU6050_ADDRESS);
+  wire.write(reg);
+  if (wire.endTransmission(false) != 0) return false;
+  return wire.requestFrom((uint8_t)MPU6050_ADDRESS, length) == length;
+}
+
+inline int16_t mpu6050Read16(TwoWire& wire) {
+  uint16_t value = (uint16_t)wire.read() << 8;
+  value |= (uint16_t)wire.read();
+  return (int16_t)value;
+}
+
+// Wakes the chip on the gyro PLL; false when nothing answers at 0x68
+inline bool mpu6050Begin(TwoWire& wire) {
+  if (!mpu6050Read(wire, MPU6050_WHO_AM_I, 1)) return false;
+  if ((wire.read() & 0x7E) != MPU6050_ADDRESS) return false;
+  return mpu6050Write(wire, MPU6050_PWR_MGMT_1, 0x01);
+}
+
+inline bool mpu6050ConfigureFifo(TwoWire& wire, uint16_t sampleRateHz) {
+  if (sampleRateHz == 0 || sampleRateHz > 1000) return false;
+  uint8_t divider = (uint8_t)(1000 / sampleRateHz - 1);
+  return mpu6050Write(wire, MPU6050_CONFIG, 0x03) &&         // DLPF 44 Hz, 1 kHz internal
+         mpu6050Write(wire, MPU6050_SMPLRT_DIV, divider) &&
+         mpu6050Write(wire, MPU6050_ACCEL_CONFIG, 0x10) &&   // +-8 g
+         mpu6050Write(wire, MPU6050_GYRO_CONFIG, 0x08) &&    // +-500 deg/s
+         mpu6050Write(wire, MPU6050_FIFO_EN, 0x78) &&        // XG, YG, ZG, accel
+         mpu6050Write(wire, MPU6050_USER_CTRL, 0x04) &&      // FIFO reset
+         mpu6050Write(wire, MPU6050_USER_CTRL, 0x40);        // FIFO enable
+}
+
+// Reads up to maxSamples accel + gyro samples from the FIFO
+inline uint8_t mpu6050ReadFifo(TwoWire& wire, ImuSample* out, uint8_t maxSamples, bool& overflowed) {
+  overflowed = false;
+  if (!mpu6050Read(wire, MPU6050_INT_STATUS, 1)) return 0;
+  if (wire.read() & 0x10) {
+    // FIFO_OFLOW: the oldest bytes were overwritten mid-sample
+    overflowed = true;
+    mpu6050Write(wire, MPU6050_USER_CTRL, 0x44);
+    return 0;
+  }
+
+  if (!mpu6050Read(wire, MPU6050_FIFO_COUNT_H, 2)) return 0;
+  uint16_t count = (uint16_t)wire.read() << 8;
+  count |= (uint16_t)wire.read();
+  uint16_t queued = count / MPU6050_SAMPLE_BYTES;
+  if (queued > maxSamples) queued = maxSamples;
+
+  uint8_t done = 0;
+  while (done < queued) {
+    uint8_t burst = queued - done;
+    if (burst > MPU6050_BURST_SAMPLES) burst = MPU6050_BURST_SAMPLES;
+    if (!mpu6050Read(wire, MPU6050_FIFO_R_W, (uint8_t)(burst * MPU6050_SAMPLE_BYTES))) break;
+    for (uint8_t i = 0; i < burst; i++) {
+      out[done].ax = mpu6050Read16(wire);
+      out[done].ay = mpu6050Read16(wire);
+      out[done].az = mpu6050Read16(wire);
+      out[done].gx = mpu6050Read16(wire);
+      out[done].gy = mpu6050Read16(wire);
+      out[done].gz = mpu6050Read16(wire);
+      done++;
+    }
+  }
+  return done;
+}
+
+#endif
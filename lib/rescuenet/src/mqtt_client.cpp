@@ -0,0 +1,451 @@
+/*
+ * RescueNet AI - Non-blocking MQTT client with a persistent outbox
+ */
+
+#include "mqtt_client.h"
+
+#include "telemetry.h"
+
+namespace {
+
+// Control packet types, in the high nibble of the first byte
+const uint8_t CONNECT = 0x10;
+const uint8_t CONNACK = 0x20;
+const uint8_t PUBLISH = 0x30;
+const uint8_t PUBACK = 0x40;
+const uint8_t SUBSCRIBE = 0x82;  // Flags 0010, as the protocol requires
+const uint8_t SUBACK = 0x90;
+const uint8_t PINGREQ = 0xC0;
+const uint8_t PINGRESP = 0xD0;
+const uint8_t DISCONNECT = 0xE0;
+
+// CONNECT flags
+const uint8_t FLAG_USERNAME = 0x80;
+const uint8_t FLAG_PASSWORD = 0x40;
+const uint8_t FLAG_WILL_RETAIN = 0x20;
+const uint8_t FLAG_WILL_QOS1 = 0x08;
+const uint8_t FLAG_WILL = 0x04;
+
+const uint8_t PUBLISH_DUP = 0x08;
+const uint8_t PUBLISH_RETAIN = 0x01;
+
+enum RxStage {
+  RX_TYPE,
+  RX_LENGTH,
+  RX_BODY
+};
+
+const char* const TOPIC_LEAVES[MQTT_TOPIC_COUNT] = {"telemetry", "alert"};
+const char STATUS_LEAF[] = "status";
+const char COMMAND_LEAF[] = "command";
+const char ONLINE[] = "online";
+const char OFFLINE[] = "offline";
+
+uint8_t lengthBytes(size_t remaining) {
+  return remaining < 128 ? 1 : remaining < 16384 ? 2 : 3;
+}
+
+// A telemetry.h record's length from its first bytes, 0 when they are
+// not one
+size_t recordLength(const uint8_t* data, size_t available) {
+  if (available < TELEMETRY_HEALTH_SIZE || data[0] != 'R' || data[1] != 'N') return 0;
+  if (data[3] != TELEMETRY_EMERGENCY) return TELEMETRY_HEALTH_SIZE;
+  size_t length = TELEMETRY_HEALTH_SIZE + 1 + data[TELEMETRY_HEALTH_SIZE - 2];
+  return length <= available ? length : 0;
+}
+
+}  // namespace
+
+MqttClient::MqttClient(TcpClientPort& tcp, RecordLog& outbox, const MqttConfig& config)
+  : tcp(tcp), outbox(outbox), config(config), handler(nullptr), handlerContext(nullptr), current(MQTT_WAITING),
+    started(false), stateSinceMs(0), retryAtMs(0), backoff(MQTT_BACKOFF_MIN_MS), lastSentMs(0), pingSentMs(0),
+    pinging(false), nextId(1), window(0), sent(0), inFlightMax(MQTT_INFLIGHT_MAX), rxType(0), rxRemaining(0),
+    rxLength(0), rxShift(0), rxStage(RX_TYPE), txLength(0) {
+  memset(&counters, 0, sizeof(counters));
+}
+
+void MqttClient::onMessage(MqttMessageFn fn, void* context) {
+  handler = fn;
+  handlerContext = context;
+}
+
+void MqttClient::setInFlight(uint8_t limit) {
+  inFlightMax = limit < 1 ? 1 : limit > MQTT_INFLIGHT_MAX ? MQTT_INFLIGHT_MAX : limit;
+}
+
+void MqttClient::begin() {
+  started = true;
+  current = MQTT_WAITING;
+  retryAtMs = millis();
+}
+
+bool MqttClient::publish(uint8_t topic, const uint8_t* payload, size_t length) {
+  if (topic >= MQTT_TOPIC_COUNT || length == 0 || length > MQTT_MESSAGE_MAX || !outbox.ready()) return false;
+  uint8_t entry[LOG_RECORD_MAX];
+  entry[0] = topic;
+  memcpy(entry + 1, payload, length);
+  if (!outbox.append(entry, length + 1)) return false;
+  if (topic == MQTT_ALERT) outbox.sync();
+  return true;
+}
+
+void MqttClient::poll() {
+  outbox.poll();
+  if (!started) return;
+  unsigned long now = millis();
+
+  switch (current) {
+    case MQTT_WAITING:
+      if ((long)(now - retryAtMs) >= 0) startConnect();
+      return;
+
+    case MQTT_CONNECTING: {
+      uint8_t status = tcp.status();
+      if (status == TCP_CONNECTED) {
+        if (!queueConnect()) {
+          fail();
+          return;
+        }
+        flush();
+        current = MQTT_HANDSHAKE;
+      } else if (status == TCP_CLOSED || now - stateSinceMs > MQTT_CONNECT_TIMEOUT_MS) {
+        fail();
+      }
+      return;
+    }
+
+    case MQTT_HANDSHAKE:
+      flush();
+      receive();
+      if (current == MQTT_HANDSHAKE &&
+          (tcp.status() != TCP_CONNECTED || now - stateSinceMs > MQTT_CONNECT_TIMEOUT_MS)) {
+        fail();
+      }
+      return;
+
+    case MQTT_CONNECTED:
+      if (tcp.status() != TCP_CONNECTED) {
+        disconnect();
+        return;
+      }
+      receive();
+      if (current != MQTT_CONNECTED) return;
+      // A PUBACK or PINGRESP this late means the link is dead
+      if ((sent && !acked[0] && now - sentMs[0] > MQTT_ACK_TIMEOUT_MS) ||
+          (pinging && now - pingSentMs > MQTT_PING_TIMEOUT_MS)) {
+        disconnect();
+        return;
+      }
+      sendOutbox();
+      if (!pinging && now - lastSentMs >= MQTT_KEEPALIVE_S * 1000UL && queueShort(PINGREQ, 0)) {
+        pinging = true;
+        pingSentMs = now;
+      }
+      flush();
+      return;
+  }
+}
+
+void MqttClient::startConnect() {
+  txLength = 0;
+  rxStage = RX_TYPE;
+  stateSinceMs = millis();
+  if (!tcp.connect(config.host, config.port)) {
+    fail();
+    return;
+  }
+  current = MQTT_CONNECTING;
+}
+
+void MqttClient::fail() {
+  tcp.close();
+  counters.failures++;
+  current = MQTT_WAITING;
+  // Half the delay fixed, half random
+  retryAtMs = millis() + backoff / 2 + (uint32_t)random((long)(backoff / 2) + 1);
+  backoff = backoff * 2 > MQTT_BACKOFF_MAX_MS ? MQTT_BACKOFF_MAX_MS : backoff * 2;
+}
+
+void MqttClient::disconnect() {
+  tcp.close();
+  counters.disconnects++;
+  // What was sent goes again on the next connection
+  outbox.rewind();
+  sent = 0;
+  pinging = false;
+  current = MQTT_WAITING;
+  backoff = MQTT_BACKOFF_MIN_MS;
+  retryAtMs = millis() + (uint32_t)random(MQTT_BACKOFF_MIN_MS + 1);
+}
+
+void MqttClient::receive() {
+  uint8_t buffer[MQTT_POLL_BYTES];
+  int n = tcp.read(buffer, sizeof(buffer));
+  if (n <= 0) return;
+  counters.bytesReceived += (uint32_t)n;
+  for (int i = 0; i < n && (current == MQTT_HANDSHAKE || current == MQTT_CONNECTED); i++) {
+    uint8_t byte = buffer[i];
+    if (rxStage == RX_TYPE) {
+      rxType = byte;
+      rxRemaining = 0;
+      rxShift = 0;
+      rxStage = RX_LENGTH;
+      continue;
+    }
+    if (rxStage == RX_LENGTH) {
+      rxRemaining |= (uint32_t)(byte & 0x7F) << rxShift;
+      rxShift += 7;
+      if (byte & 0x80) {
+        // Malformed: the link is out of step
+        if (rxShift > 21) {
+          if (current == MQTT_CONNECTED) disconnect();
+          else fail();
+        }
+        continue;
+      }
+      rxLength = 0;
+      rxStage = RX_BODY;
+      if (rxRemaining > MQTT_RX_BYTES) counters.skipped++;
+      if (rxRemaining > 0) continue;
+    } else {
+      if (rxLength < MQTT_RX_BYTES) rx[rxLength] = byte;
+      rxLength++;
+      if (rxLength < rxRemaining) continue;
+    }
+    rxStage = RX_TYPE;
+    if (rxRemaining <= MQTT_RX_BYTES) handlePacket(rxType, rx, rxRemaining);
+  }
+}
+
+void MqttClient::handlePacket(uint8_t type, const uint8_t* body, size_t length) {
+  switch (type & 0xF0) {
+    case CONNACK:
+      if (current != MQTT_HANDSHAKE || length < 2) return;
+      if (body[1] != 0) {
+        // Refused: bad credentials or client id; keep backing off
+        fail();
+        return;
+      }
+      current = MQTT_CONNECTED;
+      counters.connects++;
+      backoff = MQTT_BACKOFF_MIN_MS;
+      pinging = false;
+      lastSentMs = millis();
+      {
+        char topic[MQTT_TOPIC_MAX];
+        topicName(COMMAND_LEAF, topic);
+        queueSubscribe(topic);
+        topicName(STATUS_LEAF, topic);
+        queuePublish(topic, (const uint8_t*)ONLINE, sizeof(ONLINE) - 1, 0, 0, false, true);
+      }
+      return;
+    case PUBACK:
+      if (length >= 2) acknowledge((uint16_t)(body[0] << 8 | body[1]));
+      return;
+    case PINGRESP:
+      pinging = false;
+      return;
+    case PUBLISH:
+      handlePublish(type & 0x0F, body, length);
+      return;
+    case SUBACK:
+    default:
+      return;
+  }
+}
+
+void MqttClient::handlePublish(uint8_t flags, const uint8_t* body, size_t length) {
+  uint8_t qos = (flags >> 1) & 0x03;
+  if (length < 2) return;
+  size_t topicLength = (size_t)(body[0] << 8 | body[1]);
+  size_t offset = 2 + topicLength + (qos ? 2 : 0);
+  if (offset > length || topicLength >= MQTT_TOPIC_MAX) return;
+  if (qos) queueShort(PUBACK, (uint16_t)(body[2 + topicLength] << 8 | body[3 + topicLength]));
+  char topic[MQTT_TOPIC_MAX];
+  memcpy(topic, body + 2, topicLength);
+  topic[topicLength] = 0;
+  counters.received++;
+  if (handler) handler(topic, body + offset, length - offset, handlerContext);
+}
+
+void MqttClient::acknowledge(uint16_t id) {
+  for (uint8_t i = 0; i < sent; i++) {
+    if (ids[i] != id || acked[i]) continue;
+    acked[i] = true;
+    uint32_t ms = millis() - sentMs[i];
+    counters.acked++;
+    counters.ackMsTotal += ms;
+    if (ms > counters.ackMsMax) counters.ackMsMax = ms;
+    break;
+  }
+  // The broker acknowledges in order, so this is normally one
+  uint8_t done = 0;
+  while (done < window && done < sent && acked[done]) done++;
+  if (!done) return;
+  outbox.commit(done);
+  for (uint8_t i = done; i < window; i++) {
+    ids[i - done] = ids[i];
+    sentMs[i - done] = sentMs[i];
+    acked[i - done] = acked[i];
+  }
+  window -= done;
+  sent -= done;
+}
+
+void MqttClient::sendOutbox() {
+  uint8_t entry[LOG_RECORD_MAX];
+  char topic[MQTT_TOPIC_MAX];
+  while (sent < inFlightMax) {
+    size_t length = outbox.peek(entry, sizeof(entry));
+    if (length == 0) return;
+    if (length < 2 || entry[0] >= MQTT_TOPIC_COUNT) {
+      // Not one of ours: it takes a place in the window, already acked,
+      // so it is committed in its turn
+      outbox.read(entry, sizeof(entry));
+      if (sent == window) {
+        ids[window] = 0;
+        acked[window] = true;
+        window++;
+      }
+      sentMs[sent++] = millis();
+      acknowledge(0);
+      continue;
+    }
+    // Sent before this connection: same id, DUP set
+    bool again = sent < window;
+    uint16_t id = again ? ids[sent] : nextId;
+    topicName(TOPIC_LEAVES[entry[0]], topic);
+    if (!queuePublish(topic, entry + 1, length - 1, 1, id, again, false)) return;
+    outbox.read(entry, sizeof(entry));
+    if (!again) {
+      ids[window] = id;
+      acked[window] = false;
+      window++;
+      nextId = nextId == 0xFFFF ? 1 : nextId + 1;
+    } else {
+      counters.resent++;
+    }
+    sentMs[sent] = millis();
+    sent++;
+    counters.published++;
+  }
+}
+
+void MqttClient::flush() {
+  if (txLength == 0) return;
+  size_t n = tcp.write(tx, txLength);
+  if (n == 0) return;
+  counters.bytesSent += (uint32_t)n;
+  memmove(tx, tx + n, txLength - n);
+  txLength -= (uint16_t)n;
+  lastSentMs = millis();
+}
+
+size_t MqttClient::topicName(const char* leaf, char* out) const {
+  size_t prefix = strlen(config.topicPrefix);
+  size_t length = strlen(leaf);
+  if (prefix + 1 + length >= MQTT_TOPIC_MAX) prefix = MQTT_TOPIC_MAX - 2 - length;
+  memcpy(out, config.topicPrefix, prefix);
+  out[prefix] = '/';
+  memcpy(out + prefix + 1, leaf, length + 1);
+  return prefix + 1 + length;
+}
+
+bool MqttClient::queueConnect() {
+  char will[MQTT_TOPIC_MAX];
+  size_t willLength = topicName(STATUS_LEAF, will);
+  size_t idLength = strlen(config.clientId);
+  size_t userLength = config.username ? strlen(config.username) : 0;
+  size_t passwordLength = config.password ? strlen(config.password) : 0;
+  size_t remaining = 10 + 2 + idLength + 2 + willLength + 2 + sizeof(OFFLINE) - 1;
+  if (config.username) remaining += 2 + userLength;
+  if (config.password) remaining += 2 + passwordLength;
+  if (!startPacket(CONNECT, remaining)) return false;
+  putString("MQTT", 4);
+  put(4);  // 3.1.1
+  // Clean session off: the broker keeps the subscription and our QoS 1 state
+  put((uint8_t)(FLAG_WILL | FLAG_WILL_QOS1 | FLAG_WILL_RETAIN | (config.username ? FLAG_USERNAME : 0) |
+                (config.password ? FLAG_PASSWORD : 0)));
+  put16(MQTT_KEEPALIVE_S);
+  putString(config.clientId, idLength);
+  putString(will, willLength);
+  putString(OFFLINE, sizeof(OFFLINE) - 1);
+  if (config.username) putString(config.username, userLength);
+  if (config.password) putString(config.password, passwordLength);
+  return true;
+}
+
+bool MqttClient::queuePublish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos, uint16_t id,
+                              bool dup, bool retain) {
+  size_t topicLength = strlen(topic);
+  size_t remaining = 2 + topicLength + (qos ? 2 : 0) + length;
+  uint8_t flags = (uint8_t)(qos << 1) | (dup ? PUBLISH_DUP : 0) | (retain ? PUBLISH_RETAIN : 0);
+  if (!startPacket(PUBLISH | flags, remaining)) return false;
+  putString(topic, topicLength);
+  if (qos) put16(id);
+  memcpy(tx + txLength, payload, length);
+  txLength += (uint16_t)length;
+  return true;
+}
+
+bool MqttClient::queueSubscribe(const char* topic) {
+  size_t topicLength = strlen(topic);
+  if (!startPacket(SUBSCRIBE, 2 + 2 + topicLength + 1)) return false;
+  put16(nextId);
+  nextId = nextId == 0xFFFF ? 1 : nextId + 1;
+  putString(topic, topicLength);
+  put(1);  // QoS 1 at most
+  return true;
+}
+
+bool MqttClient::queueShort(uint8_t type, uint16_t id) {
+  bool withId = type == PUBACK;
+  if (!startPacket(type, withId ? 2 : 0)) return false;
+  if (withId) put16(id);
+  return true;
+}
+
+bool MqttClient::startPacket(uint8_t type, size_t remaining) {
+  if ((size_t)txLength + 1 + lengthBytes(remaining) + remaining > MQTT_TX_BYTES) return false;
+  put(type);
+  do {
+    uint8_t byte = remaining & 0x7F;
+    remaining >>= 7;
+    put(remaining ? byte | 0x80 : byte);
+  } while (remaining);
+  return true;
+}
+
+void MqttClient::put16(uint16_t value) {
+  put((uint8_t)(value >> 8));
+  put((uint8_t)value);
+}
+
+void MqttClient::putString(const char* text, size_t length) {
+  put16((uint16_t)length);
+  memcpy(tx + txLength, text, length);
+  txLength += (uint16_t)length;
+}
+
+int MqttPort::post(const char* url, const char* contentType, const char* body, size_t length) {
+  if (strcmp(contentType, TELEMETRY_CONTENT_TYPE) != 0) return 415;
+  uint8_t topic = 0;
+  while (topic < MQTT_TOPIC_COUNT && strcmp(url, TOPIC_LEAVES[topic]) != 0) topic++;
+  if (topic == MQTT_TOPIC_COUNT) return 404;
+
+  const uint8_t* data = (const uint8_t*)body;
+  while (length) {
+    // As many whole records as one message holds
+    size_t take = 0;
+    while (take < length) {
+      size_t record = recordLength(data + take, length - take);
+      if (record == 0) return 400;
+      if (take + record > MQTT_MESSAGE_MAX) break;
+      take += record;
+    }
+    if (!client.publish(topic, data, take)) return 503;
+    data += take;
+    length -= take;
+  }
+  return 202;
+}
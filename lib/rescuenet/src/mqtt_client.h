@@ -0,0 +1,198 @@
+/*
+ * RescueNet AI - Non-blocking MQTT client with a persistent outbox
+ *
+ * The v4.0 sketch kept PubSubClient connected with a loop of connect()
+ * and delay(5000), so a dead broker stopped the sensors, the alarm and
+ * the emergency button for as long as it stayed down. MqttClient is a
+ * state machine that poll() moves along without ever waiting:
+ *
+ *   waiting     until the backoff delay is up: MQTT_BACKOFF_MIN_MS after
+ *               a failure, doubling up to MQTT_BACKOFF_MAX_MS, half of
+ *               it random so a fleet does not reconnect in step
+ *   connecting  TCP, then CONNECT (persistent session, retained
+ *               "offline" will on <prefix>/status) and CONNACK, all
+ *               within MQTT_CONNECT_TIMEOUT_MS
+ *   connected   subscribes to <prefix>/command, publishes "online",
+ *               sends the outbox, pings when the link is idle
+ *
+ * Messages go to <prefix>/telemetry and <prefix>/alert at QoS 1 (MQTT
+ * 3.1.1). publish() only appends them to the outbox, a RecordLog on
+ * flash, where they stay across resets until the broker has them. Up to
+ * MQTT_INFLIGHT_MAX are sent ahead of their PUBACKs; each PUBACK commits
+ * the oldest. After a reconnect the ones not acknowledged go again with
+ * the DUP flag and the same packet ids, so delivery is at least once
+ * and in order. A PUBACK later than MQTT_ACK_TIMEOUT_MS, or no PINGRESP,
+ * counts as a dead link.
+ *
+ * MqttPort puts the client behind the HttpPort the monitor posts
+ * through, so batches and alerts take MQTT without the monitor knowing.
+ */
+
+#ifndef RESCUENET_MQTT_CLIENT_H
+#define RESCUENET_MQTT_CLIENT_H
+
+#include "hal.h"
+#include "record_log.h"
+
+// Messages sent ahead of their PUBACKs
+#ifndef MQTT_INFLIGHT_MAX
+#define MQTT_INFLIGHT_MAX 4
+#endif
+
+#define MQTT_KEEPALIVE_S 30
+#define MQTT_CONNECT_TIMEOUT_MS 10000
+#define MQTT_ACK_TIMEOUT_MS 10000
+#define MQTT_PING_TIMEOUT_MS 10000
+#define MQTT_BACKOFF_MIN_MS 1000
+#define MQTT_BACKOFF_MAX_MS 60000
+
+// Topic prefix plus the longest leaf, "/telemetry"
+#define MQTT_TOPIC_MAX 64
+// Payload of one message: an outbox record less its topic byte
+#define MQTT_MESSAGE_MAX (LOG_RECORD_MAX - 1)
+// Longest packet taken in; longer ones are skipped
+#define MQTT_RX_BYTES 256
+// Packets waiting for the transport; holds CONNECT or a whole PUBLISH
+#define MQTT_TX_BYTES 512
+// Bytes taken from the transport per poll()
+#define MQTT_POLL_BYTES 256
+
+enum MqttTopic {
+  MQTT_TELEMETRY,
+  MQTT_ALERT,
+  MQTT_TOPIC_COUNT
+};
+
+enum MqttState {
+  MQTT_WAITING,
+  MQTT_CONNECTING,  // TCP
+  MQTT_HANDSHAKE,   // CONNECT sent
+  MQTT_CONNECTED
+};
+
+struct MqttConfig {
+  const char* host;
+  uint16_t port;
+  const char* clientId;
+  const char* topicPrefix;  // e.g. "rescuenet/<user id>"
+  const char* username;     // Both may be null
+  const char* password;
+};
+
+struct MqttStats {
+  uint32_t connects;     // Sessions established
+  uint32_t failures;     // Attempts that did not get a CONNACK
+  uint32_t disconnects;  // Established sessions lost
+  uint32_t published;    // PUBLISH packets from the outbox, resends included
+  uint32_t resent;
+  uint32_t acked;
+  uint32_t received;     // Messages on the command topic
+  uint32_t skipped;      // Incoming packets too long for MQTT_RX_BYTES
+  uint32_t bytesSent;
+  uint32_t bytesReceived;
+  uint32_t ackMsTotal;   // PUBLISH to PUBACK, over acked
+  uint32_t ackMsMax;
+};
+
+// A message on <prefix>/command; topic and payload are only valid
+// during the call
+typedef void (*MqttMessageFn)(const char* topic, const uint8_t* payload, size_t length, void* context);
+
+class MqttClient {
+public:
+  // The outbox must be begun before the client is polled
+  MqttClient(TcpClientPort& tcp, RecordLog& outbox, const MqttConfig& config);
+
+  void onMessage(MqttMessageFn fn, void* context);
+  // Messages sent ahead of their PUBACKs, 1 to MQTT_INFLIGHT_MAX
+  void setInFlight(uint8_t limit);
+  // Connects on the next poll() and keeps the session up from then on
+  void begin();
+  // Does what is due and returns; call every few milliseconds
+  void poll();
+
+  // Queues a message for the broker; false when the outbox cannot take it.
+  // Alerts are synced to flash straight away.
+  bool publish(uint8_t topic, const uint8_t* payload, size_t length);
+
+  uint8_t state() const { return current; }
+  bool connected() const { return current == MQTT_CONNECTED; }
+  uint8_t inFlight() const { return window; }
+  // Delay before the next attempt after a failure
+  uint32_t backoffMs() const { return backoff; }
+  const MqttStats& stats() const { return counters; }
+
+private:
+  void startConnect();
+  void fail();
+  void disconnect();
+  void receive();
+  void handlePacket(uint8_t type, const uint8_t* body, size_t length);
+  void handlePublish(uint8_t flags, const uint8_t* body, size_t length);
+  void acknowledge(uint16_t id);
+  void sendOutbox();
+  void flush();
+
+  size_t topicName(const char* leaf, char* out) const;
+  bool queueConnect();
+  bool queuePublish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos, uint16_t id,
+                    bool dup, bool retain);
+  bool queueSubscribe(const char* topic);
+  bool queueShort(uint8_t type, uint16_t id);
+  bool startPacket(uint8_t type, size_t remaining);
+  void put(uint8_t byte) { tx[txLength++] = byte; }
+  void put16(uint16_t value);
+  void putString(const char* text, size_t length);
+
+  TcpClientPort& tcp;
+  RecordLog& outbox;
+  MqttConfig config;
+  MqttMessageFn handler;
+  void* handlerContext;
+
+  uint8_t current;
+  bool started;
+  unsigned long stateSinceMs;
+  unsigned long retryAtMs;
+  uint32_t backoff;
+  unsigned long lastSentMs;
+  unsigned long pingSentMs;
+  bool pinging;
+  uint16_t nextId;
+
+  // The window, oldest first: in the outbox, read and not yet committed
+  uint16_t ids[MQTT_INFLIGHT_MAX];
+  unsigned long sentMs[MQTT_INFLIGHT_MAX];
+  bool acked[MQTT_INFLIGHT_MAX];
+  uint8_t window;
+  uint8_t sent;  // Of the window, sent on this connection
+  uint8_t inFlightMax;
+
+  // Incoming packet
+  uint8_t rxType;
+  uint32_t rxRemaining;
+  uint32_t rxLength;
+  uint8_t rxShift;
+  uint8_t rxStage;
+  uint8_t rx[MQTT_RX_BYTES];
+
+  uint16_t txLength;
+  uint8_t tx[MQTT_TX_BYTES];
+  MqttStats counters;
+};
+
+// The client as the board's HttpPort: telemetry.h records posted to
+// "telemetry" or "alert" (MonitorConfig's URLs) are split into outbox
+// messages of whole records. Answers 202 once they are queued, 415 for
+// anything but binary records.
+class MqttPort : public HttpPort {
+public:
+  explicit MqttPort(MqttClient& client) : client(client) {}
+
+  int post(const char* url, const char* contentType, const char* body, size_t length) override;
+
+private:
+  MqttClient& client;
+};
+
+#endif
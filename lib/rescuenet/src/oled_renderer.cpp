@@ -0,0 +1,353 @@
+/*
+ * RescueNet AI - Retained-mode SSD1306 renderer
+ */
+
+#include "oled_renderer.h"
+
+#include <string.h>
+
+namespace {
+
+// Classic 5x7 font, ' ' to '~', one byte per column, top pixel in bit 0
+const uint8_t FONT[][5] PROGMEM = {
+  {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+  {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+  {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+  {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x08, 0x2A, 0x1C, 0x2A, 0x08}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+  {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00},
+  {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+  {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+  {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+  {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00},
+  {0x00, 0x56, 0x36, 0x00, 0x00}, {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14},
+  {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, {0x32, 0x49, 0x79, 0x41, 0x3E},
+  {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+  {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01},
+  {0x3E, 0x41, 0x49, 0x49, 0x7A}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+  {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+  {0x7F, 0x02, 0x0C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+  {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+  {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+  {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+  {0x07, 0x08, 0x70, 0x08, 0x07}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},
+  {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04},
+  {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78},
+  {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20}, {0x38, 0x44, 0x44, 0x48, 0x7F},
+  {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x0C, 0x52, 0x52, 0x52, 0x3E},
+  {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3D, 0x00},
+  {0x7F, 0x10, 0x28, 0x44, 0x00}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78},
+  {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0x7C, 0x14, 0x14, 0x14, 0x08},
+  {0x08, 0x14, 0x14, 0x18, 0x7C}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+  {0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C},
+  {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0C, 0x50, 0x50, 0x50, 0x3C},
+  {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x7F, 0x00, 0x00},
+  {0x00, 0x41, 0x36, 0x08, 0x00}, {0x08, 0x04, 0x08, 0x10, 0x08},
+};
+
+// A nibble with every bit doubled: the vertical half of a size 2 column
+const uint8_t DOUBLED[16] PROGMEM = {
+  0x00, 0x03, 0x0C, 0x0F, 0x30, 0x33, 0x3C, 0x3F, 0xC0, 0xC3, 0xCC, 0xCF, 0xF0, 0xF3, 0xFC, 0xFF,
+};
+
+// 128x64, charge pump on, horizontal addressing
+const uint8_t INIT[] PROGMEM = {
+  0xAE, 0xD5, 0x80, 0xA8, 0x3F, 0xD3, 0x00, 0x40, 0x8D, 0x14, 0x20, 0x00,
+  0xDA, 0x12, 0x81, 0xCF, 0xD9, 0xF1, 0xDB, 0x40, 0xA4, 0xA6,
+};
+
+const uint8_t UNKNOWN = 0xFF;
+
+uint8_t glyphColumn(char c, uint8_t column) {
+  return pgm_read_byte(&FONT[c - ' '][column]);
+}
+
+uint8_t cellWidth(uint8_t size) {
+  return size == 2 ? OLED_LARGE_CELL_WIDTH : OLED_CELL_WIDTH;
+}
+
+uint8_t cellCount(uint8_t size) {
+  return size == 2 ? OLED_LARGE_CELLS : OLED_CELLS;
+}
+
+#if !OLED_SHOWN_TEXT
+// Fletcher-16 over the size and the cells of a row
+uint16_t rowSum(uint8_t size, const char* text) {
+  uint8_t a = size;
+  uint8_t b = size;
+  for (uint8_t i = 0; i < OLED_CELLS; i++) {
+    a = (uint8_t)((a + (uint8_t)text[i]) % 255);
+    b = (uint8_t)((b + a) % 255);
+  }
+  return (uint16_t)(b << 8 | a);
+}
+#endif
+
+// Column of a size 2 cell: each font column twice, then the gap
+uint8_t largeColumn(char c, uint8_t page, uint8_t offset) {
+  if (offset >= 10) return 0;
+  uint8_t bits = glyphColumn(c, offset / 2);
+  return pgm_read_byte(&DOUBLED[page ? bits >> 4 : bits & 0x0F]);
+}
+
+}  // namespace
+
+static_assert(sizeof(OledRenderer) <=
+                OLED_RENDERER_RAM_BUDGET + (OLED_GLYPH_CACHE ? 11 * 2 * OLED_LARGE_CELL_WIDTH : 0),
+              "OledRenderer exceeds its RAM budget on this target");
+
+OledRenderer::OledRenderer(OledBus& bus)
+  : bus(bus), runRow(0), runPage(0), runStart(0), runEnd(0), cursor(0), windowed(false), sending(false),
+    ready(false), drawing(false), retries(0) {
+#if OLED_STATS
+  renderUs = 0;
+  bytesAtFrame = 0;
+  transfersAtFrame = 0;
+  memset(&counters, 0, sizeof(counters));
+#endif
+  memset(&run, 0, sizeof(run));
+#if OLED_GLYPH_CACHE
+  for (uint8_t g = 0; g < 11; g++) {
+    char c = g < 10 ? '0' + g : '.';
+    for (uint8_t page = 0; page < 2; page++) {
+      for (uint8_t x = 0; x < OLED_LARGE_CELL_WIDTH; x++) largeGlyphs[g][page][x] = largeColumn(c, page, x);
+    }
+  }
+#endif
+  invalidate();
+  clear();
+  drawing = false;
+}
+
+bool OledRenderer::begin(bool flipped) {
+  uint8_t init[sizeof(INIT) + 3];
+  for (uint8_t i = 0; i < sizeof(INIT); i++) init[i] = pgm_read_byte(&INIT[i]);
+  // Segment remap and COM scan direction
+  init[sizeof(INIT)] = flipped ? 0xA0 : 0xA1;
+  init[sizeof(INIT) + 1] = flipped ? 0xC0 : 0xC8;
+  init[sizeof(INIT) + 2] = 0xAF;
+  sending = false;
+  ready = false;
+  bool ok = transfer(true, init, sizeof(init));
+  // Display RAM holds noise after power up
+  invalidate();
+  clear();
+  flush();
+  return ok;
+}
+
+void OledRenderer::invalidate() {
+#if OLED_SHOWN_TEXT
+  for (uint8_t r = 0; r < OLED_ROWS; r++) shown[r].size = UNKNOWN;
+#else
+  shownKnown = 0;
+#endif
+}
+
+void OledRenderer::clear() {
+  for (uint8_t r = 0; r < OLED_ROWS; r++) {
+    draft[r].size = 1;
+    memset(draft[r].text, ' ', OLED_CELLS);
+  }
+  drawing = true;
+}
+
+void OledRenderer::drawText(int16_t x, int16_t y, const char* text, uint8_t size) {
+  drawing = true;
+  if (x < 0 || y < 0 || y >= OLED_ROWS * 8 || x >= OLED_WIDTH) return;
+  uint8_t r = y / 8;
+  if (size > 1 && r + 1 < OLED_ROWS) {
+    size = 2;
+  } else {
+    size = 1;
+  }
+
+  // Re-lay the rows this text lands on; a size 2 row above gives up
+  // the row it covered
+  if (draft[r].size == 0) {
+    draft[r - 1].size = 1;
+    memset(draft[r - 1].text + OLED_LARGE_CELLS, ' ', OLED_CELLS - OLED_LARGE_CELLS);
+  }
+  if (draft[r].size != size) {
+    if (draft[r].size == 2) {
+      draft[r + 1].size = 1;
+      memset(draft[r + 1].text, ' ', OLED_CELLS);
+    }
+    draft[r].size = size;
+    memset(draft[r].text, ' ', OLED_CELLS);
+    if (size == 2) {
+      if (draft[r + 1].size == 2 && r + 2 < OLED_ROWS) {
+        draft[r + 2].size = 1;
+        memset(draft[r + 2].text, ' ', OLED_CELLS);
+      }
+      draft[r + 1].size = 0;
+    }
+  }
+
+  uint8_t cells = cellCount(size);
+  for (uint8_t cell = x / cellWidth(size); cell < cells && *text; cell++, text++) {
+    char c = *text;
+    draft[r].text[cell] = c >= ' ' && c <= '~' ? c : '?';
+  }
+}
+
+void OledRenderer::flush() {
+  drawing = false;
+#if OLED_STATS
+  if (!busy()) {
+    bytesAtFrame = counters.bytesTotal;
+    transfersAtFrame = counters.transfersTotal;
+    renderUs = 0;
+  }
+#endif
+  ready = true;
+}
+
+bool OledRenderer::poll() {
+#if OLED_STATS
+  uint32_t start = micros();
+#endif
+  if (!sending) {
+    // Half drawn: wait for flush()
+    if (!ready || drawing) return false;
+    if (!nextRun()) {
+#if OLED_STATS
+      renderUs += micros() - start;
+#endif
+      finishFrame();
+      return false;
+    }
+  }
+
+  uint8_t chunk[OLED_CHUNK_BYTES > 6 ? OLED_CHUNK_BYTES : 6];
+  uint8_t length = 0;
+  if (!windowed) {
+    uint8_t page = runRow + runPage;
+    chunk[length++] = 0x21;  // Column address
+    chunk[length++] = runStart;
+    chunk[length++] = runEnd;
+    chunk[length++] = 0x22;  // Page address
+    chunk[length++] = page;
+    chunk[length++] = page;
+  } else {
+    for (uint16_t x = cursor; x <= runEnd && length < OLED_CHUNK_BYTES; x++) chunk[length++] = column(x);
+  }
+#if OLED_STATS
+  renderUs += micros() - start;
+#endif
+
+  if (!transfer(!windowed, chunk, length)) {
+    if (++retries < OLED_MAX_RETRIES) return true;
+    // The panel is gone or wedged: resend all of it with the next frame
+    retries = 0;
+    sending = false;
+    ready = false;
+    invalidate();
+#if OLED_STATS
+    counters.dropped++;
+#endif
+    return false;
+  }
+  retries = 0;
+
+  if (!windowed) {
+    windowed = true;
+    cursor = runStart;
+    return true;
+  }
+  if ((uint16_t)cursor + length <= runEnd) {
+    cursor += length;
+    return true;
+  }
+  // Page done; the lower page of a size 2 row next, or the row is shown
+  if (++runPage < run.size) {
+    windowed = false;
+    return true;
+  }
+#if OLED_SHOWN_TEXT
+  shown[runRow] = run;
+  if (run.size == 2) shown[runRow + 1].size = 0;
+#else
+  shownSum[runRow] = rowSum(run.size, run.text);
+  shownKnown |= 1 << runRow;
+  if (run.size == 2) shownKnown &= ~(1 << (runRow + 1));
+#endif
+  sending = false;
+  return true;
+}
+
+bool OledRenderer::nextRun() {
+  for (uint8_t r = 0; r < OLED_ROWS; r++) {
+    const Row& want = draft[r];
+    if (want.size == 0) continue;  // Sent with the row above
+
+    uint8_t start;
+    uint8_t end;
+#if OLED_SHOWN_TEXT
+    const Row& have = shown[r];
+    if (want.size != have.size) {
+      // The whole width, so nothing of the old layout is left
+      start = 0;
+      end = OLED_WIDTH - 1;
+    } else {
+      uint8_t cells = cellCount(want.size);
+      uint8_t first = 0;
+      while (first < cells && want.text[first] == have.text[first]) first++;
+      if (first == cells) continue;
+      uint8_t last = cells - 1;
+      while (want.text[last] == have.text[last]) last--;
+      uint8_t width = cellWidth(want.size);
+      start = first * width;
+      end = (last + 1) * width - 1;
+    }
+#else
+    if ((shownKnown & (1 << r)) && shownSum[r] == rowSum(want.size, want.text)) continue;
+    start = 0;
+    end = OLED_WIDTH - 1;
+#endif
+
+    run = want;
+    runRow = r;
+    runPage = 0;
+    runStart = start;
+    runEnd = end;
+    windowed = false;
+    sending = true;
+    return true;
+  }
+  return false;
+}
+
+uint8_t OledRenderer::column(uint8_t x) const {
+  uint8_t width = cellWidth(run.size);
+  uint8_t cell = x / width;
+  if (cell >= cellCount(run.size)) return 0;
+  uint8_t offset = x - cell * width;
+  char c = run.text[cell];
+  if (run.size == 1) return offset < 5 ? glyphColumn(c, offset) : 0;
+#if OLED_GLYPH_CACHE
+  if (c >= '0' && c <= '9') return largeGlyphs[c - '0'][runPage][offset];
+  if (c == '.') return largeGlyphs[10][runPage][offset];
+#endif
+  return largeColumn(c, runPage, offset);
+}
+
+bool OledRenderer::transfer(bool command, const uint8_t* bytes, uint8_t length) {
+  bool ok = command ? bus.command(bytes, length) : bus.data(bytes, length);
+#if OLED_STATS
+  // Address and control byte ahead of the payload
+  counters.bytesTotal += length + 2;
+  counters.transfersTotal++;
+  if (!ok) counters.failures++;
+#endif
+  return ok;
+}
+
+void OledRenderer::finishFrame() {
+  ready = false;
+#if OLED_STATS
+  counters.frames++;
+  counters.frameBytes = (uint16_t)(counters.bytesTotal - bytesAtFrame);
+  counters.frameTransfers = (uint16_t)(counters.transfersTotal - transfersAtFrame);
+  counters.frameRenderUs = renderUs;
+#endif
+}
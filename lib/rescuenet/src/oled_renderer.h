@@ -0,0 +1,162 @@
+/*
+ * RescueNet AI - Retained-mode SSD1306 renderer
+ *
+ * The display drivers the sketches used clear a 1 KB frame buffer, draw
+ * the whole screen into it and push all of it over I2C on every update,
+ * though between two updates usually only a digit or two of the heart
+ * rate changes. This renderer keeps the screen as text instead of
+ * pixels and sends only what changed:
+ *
+ *   - the 128x64 panel is eight rows of text, one SSD1306 page each: 21
+ *     cells of the 5x7 font, or 11 cells at size 2 over two pages
+ *   - drawText() writes into the draft; flush() hands it over. poll()
+ *     compares it with what the panel shows, row by row, and sends the
+ *     changed cells of a row (page by page, only their columns) in one
+ *     I2C transaction per call: a column/page window or at most
+ *     OLED_CHUNK_BYTES of display RAM. The loop is never held up longer
+ *     than that.
+ *   - columns are rendered as they are sent, straight from the font; no
+ *     frame buffer. The large digits are pre-rendered once where there
+ *     is RAM for them (OLED_GLYPH_CACHE).
+ *   - without OLED_SHOWN_TEXT (the Nano) only a checksum of each shown
+ *     row is kept, and a row that changed is sent whole
+ *
+ * It is a TextDisplay, so HealthMonitor draws on it the way it drew on
+ * the frame-buffer drivers; x and y are rounded down to the cell grid.
+ * Text stays within its row. stats() counts bytes and transactions per
+ * frame and the CPU time spent rendering them (OLED_STATS).
+ */
+
+#ifndef RESCUENET_OLED_RENDERER_H
+#define RESCUENET_OLED_RENDERER_H
+
+#include "hal.h"
+#include "ram_budget.h"
+
+#define OLED_WIDTH 128
+#define OLED_ROWS 8                      // One SSD1306 page each
+#define OLED_CELL_WIDTH 6                // 5x7 glyph and a gap
+#define OLED_CELLS (OLED_WIDTH / OLED_CELL_WIDTH)
+#define OLED_LARGE_CELL_WIDTH 11         // Doubled to 10x14, and a gap
+#define OLED_LARGE_CELLS (OLED_WIDTH / OLED_LARGE_CELL_WIDTH)
+
+// Display RAM bytes per transaction; the AVR Wire buffer holds 32 in all
+#ifndef OLED_CHUNK_BYTES
+#if defined(__AVR__)
+#define OLED_CHUNK_BYTES 16
+#else
+#define OLED_CHUNK_BYTES 32
+#endif
+#endif
+
+// Size 2 digits pre-rendered in RAM; the Nano doubles them as it goes
+#ifndef OLED_GLYPH_CACHE
+#if defined(__AVR__)
+#define OLED_GLYPH_CACHE 0
+#else
+#define OLED_GLYPH_CACHE 1
+#endif
+#endif
+
+// The panel's text kept to send only the changed cells; otherwise a
+// checksum per row
+#ifndef OLED_SHOWN_TEXT
+#if defined(__AVR__)
+#define OLED_SHOWN_TEXT 0
+#else
+#define OLED_SHOWN_TEXT 1
+#endif
+#endif
+
+// Failed transactions in a row after which a frame is given up
+#define OLED_MAX_RETRIES 3
+
+// Byte, transaction and render-time counters: 36 bytes the Nano goes without
+#ifndef OLED_STATS
+#if defined(__AVR__)
+#define OLED_STATS 0
+#else
+#define OLED_STATS 1
+#endif
+#endif
+
+struct OledStats {
+  uint32_t frames;          // Flushed frames completely on the panel
+  uint32_t bytesTotal;      // Over I2C, commands and control bytes included
+  uint32_t transfersTotal;  // I2C transactions
+  uint16_t frameBytes;      // Of the last frame
+  uint16_t frameTransfers;
+  uint32_t frameRenderUs;   // CPU time of the last frame, the bus excluded
+  uint16_t failures;        // Transactions the bus refused
+  uint16_t dropped;         // Frames given up after OLED_MAX_RETRIES
+};
+
+class OledRenderer : public TextDisplay {
+public:
+  explicit OledRenderer(OledBus& bus);
+
+  // Sends the SSD1306 init sequence and queues a blank screen. flipped
+  // turns the picture by 180 degrees.
+  bool begin(bool flipped = false);
+  // Sends every cell with the next frame, e.g. after the panel was reset
+  void invalidate();
+
+  void clear() override;
+  void drawText(int16_t x, int16_t y, const char* text, uint8_t size) override;
+  void flush() override;
+  bool poll() override;
+
+  // A flushed frame is not completely on the panel yet
+  bool busy() const { return ready || sending; }
+#if OLED_STATS
+  const OledStats& stats() const { return counters; }
+#endif
+
+private:
+  struct Row {
+    uint8_t size;  // 0: covered by a size 2 row above
+    char text[OLED_CELLS];
+  };
+
+  // The next row that differs from the panel, latched; false when none
+  bool nextRun();
+  uint8_t column(uint8_t x) const;
+  bool transfer(bool command, const uint8_t* bytes, uint8_t length);
+  void finishFrame();
+
+  OledBus& bus;
+  Row draft[OLED_ROWS];
+#if OLED_SHOWN_TEXT
+  Row shown[OLED_ROWS];
+#else
+  uint16_t shownSum[OLED_ROWS];
+  uint8_t shownKnown;  // Bit per row: shownSum holds what the panel shows
+#endif
+
+  // Row being sent: a copy, so drawing the next frame cannot tear it
+  Row run;
+  uint8_t runRow;
+  uint8_t runPage;   // 0, or 1 for the lower half of size 2
+  uint8_t runStart;  // Columns
+  uint8_t runEnd;
+  uint8_t cursor;    // Next column to send
+  bool windowed;     // The page's column window is set
+  bool sending;
+
+  bool ready;    // Flushed and not yet all sent
+  bool drawing;  // Between clear() and flush()
+  uint8_t retries;
+#if OLED_STATS
+  uint32_t renderUs;
+  uint32_t bytesAtFrame;
+  uint32_t transfersAtFrame;
+  OledStats counters;
+#endif
+
+#if OLED_GLYPH_CACHE
+  // '0'..'9' and '.': two pages of their columns
+  uint8_t largeGlyphs[11][2][OLED_LARGE_CELL_WIDTH];
+#endif
+};
+
+#endif
@@ -0,0 +1,37 @@
+/*
+ * RescueNet AI - SSD1306 I2C transport
+ *
+ * OledBus over Wire for oled_renderer.h: each call is one transaction,
+ * the control byte and then the payload, which the renderer keeps within
+ * the Wire buffer. Header only; the host build never includes it.
+ */
+
+#ifndef RESCUENET_OLED_WIRE_H
+#define RESCUENET_OLED_WIRE_H
+
+#include <Wire.h>
+
+#include "hal.h"
+
+#define SSD1306_ADDRESS 0x3C
+
+class WireOledBus : public OledBus {
+public:
+  explicit WireOledBus(TwoWire& wire, uint8_t address = SSD1306_ADDRESS) : wire(wire), address(address) {}
+
+  bool command(const uint8_t* bytes, uint8_t length) override { return send(0x00, bytes, length); }
+  bool data(const uint8_t* bytes, uint8_t length) override { return send(0x40, bytes, length); }
+
+private:
+  bool send(uint8_t control, const uint8_t* bytes, uint8_t length) {
+    wire.beginTransmission(address);
+    wire.write(control);
+    wire.write(bytes, length);
+    return wire.endTransmission() == 0;
+  }
+
+  TwoWire& wire;
+  uint8_t address;
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ * RescueNet AI - Streaming PPG acquisition
+ */
+
+#include "ppg_acquisition.h"
+
+namespace {
+
+// Samples pulled per I2C burst; 8 x 6 bytes fits the AVR Wire buffer twice
+const uint8_t DRAIN_CHUNK = 8;
+
+}  // namespace
+
+PpgAcquisition::PpgAcquisition(PpgSensor* sensor)
+  : sensor(sensor), fusion(nullptr), rateHz(0), lastDrainUs(0) {
+  memset(&latest, 0, sizeof(latest));
+  memset(&counters, 0, sizeof(counters));
+}
+
+bool PpgAcquisition::begin(uint16_t sampleRateHz, uint8_t averaging) {
+  if (!sensor || averaging == 0) return false;
+  if (!sensor->configure(sampleRateHz, averaging)) return false;
+  rateHz = sampleRateHz / averaging;
+  detector.setSampleRate(rateHz);
+  detector.reset();
+  oximeter.setSampleRate(rateHz);
+  oximeter.reset();
+#if SPECTRAL_HR_ENABLED
+  spectrum.setSampleRate(rateHz);
+#endif
+  if (fusion) {
+    fusion->setPpgRate(rateHz);
+    fusion->reset();
+  }
+  lastDrainUs = micros();
+  return true;
+}
+
+bool PpgAcquisition::setRate(uint16_t sampleRateHz, uint8_t averaging) {
+  if (rateHz == 0) return begin(sampleRateHz, averaging);
+  if (!sensor || averaging == 0) return false;
+  if (!sensor->configure(sampleRateHz, averaging)) return false;
+  uint16_t hz = sampleRateHz / averaging;
+  if (hz == rateHz) return true;
+  rateHz = hz;
+  detector.setSampleRate(rateHz);
+  oximeter.setSampleRate(rateHz);
+#if SPECTRAL_HR_ENABLED
+  spectrum.setSampleRate(rateHz);
+#endif
+  if (fusion) fusion->setPpgRate(rateHz);
+  lastDrainUs = micros();
+  return true;
+}
+
+bool PpgAcquisition::poll() {
+  if (!sensor || rateHz == 0) return false;
+
+  PpgSample burst[DRAIN_CHUNK];
+  uint16_t drained = 0;
+  bool full = false;
+  uint16_t overflowTotal = 0;
+  for (;;) {
+    // No more than the ring takes: the rest waits in the sensor's FIFO,
+    // the deeper of the two on the Nano
+    uint8_t want = ring.space() < DRAIN_CHUNK ? (uint8_t)ring.space() : DRAIN_CHUNK;
+    if (want == 0) {
+      full = true;
+      break;
+    }
+    uint8_t overflowed = 0;
+    uint8_t n = sensor->readFifo(burst, want, overflowed);
+    overflowTotal += overflowed;
+    for (uint8_t i = 0; i < n; i++) ring.push(burst[i]);
+    drained += n;
+    if (n < want) break;
+  }
+
+  unsigned long now = micros();
+  if (overflowTotal >= 31) {
+    // OVF_COUNTER saturates at 31; estimate the real loss from elapsed time
+    uint32_t expected = (uint32_t)((uint64_t)(now - lastDrainUs) * rateHz / 1000000UL);
+    if (expected > drained + overflowTotal) overflowTotal = expected - drained;
+  }
+  lastDrainUs = now;
+
+  counters.fifoOverflows += overflowTotal;
+  counters.samplesRead += drained;
+  counters.ringDrops = ring.droppedCount();
+  counters.drains++;
+  if (drained > counters.maxBurst) counters.maxBurst = drained > 255 ? 255 : (uint8_t)drained;
+  return full;
+}
+
+void PpgAcquisition::process() {
+  PpgSample sample;
+  for (;;) {
+    // Wait for the motion reference unless that would fill the ring
+    if (fusion && !fusion->referenceReady() && ring.size() < PPG_RING_SIZE / 2) break;
+    if (!ring.pop(sample)) break;
+    onSample(sample);
+  }
+}
+
+float PpgAcquisition::beatRate() const {
+  return fusion ? fusion->heartRate() : detector.bpmTenths() / 10.0f;
+}
+
+bool PpgAcquisition::spectralStandIn() const {
+#if SPECTRAL_HR_ENABLED
+  return beatRate() <= 0 && spectrum.quality() >= SPECTRAL_HR_MIN_QUALITY;
+#else
+  return false;
+#endif
+}
+
+float PpgAcquisition::heartRate() const {
+#if SPECTRAL_HR_ENABLED
+  if (spectralStandIn()) return spectrum.heartRate();
+#endif
+  return beatRate();
+}
+
+uint8_t PpgAcquisition::heartRateConfidence() const {
+#if SPECTRAL_HR_ENABLED
+  if (spectralStandIn()) return spectrum.quality();
+#endif
+  if (fusion) return fusion->confidence();
+  return detector.bpmTenths() ? 100 : 0;
+}
+
+void PpgAcquisition::onSample(const PpgSample& sample) {
+  latest = sample;
+  counters.samplesProcessed++;
+  // Every sample takes its reference, so the pairing holds through gaps
+  int32_t ir = (int32_t)(sample.ir & 0x3FFFF);
+  if (fusion) ir = fusion->cancel(ir);
+
+  if (!fingerPresent()) {
+    // Nothing to measure; forget the old rate instead of reporting it
+    if (detector.beats()) detector.reset();
+    if (oximeter.cycles()) oximeter.reset();
+    if (fusion) fusion->reset();
+#if SPECTRAL_HR_ENABLED
+    spectrum.reset();
+#endif
+    return;
+  }
+
+#if SPECTRAL_HR_ENABLED
+  spectrum.addSample(ir);
+#endif
+
+  oximeter.addSample(sample.red, sample.ir);
+  if (detector.addSample(ir)) {
+    counters.beats++;
+    if (fusion) fusion->addBeat();
+  }
+}
@@ -0,0 +1,110 @@
+/*
+ * RescueNet AI - Streaming PPG acquisition
+ *
+ * The MAX3010x samples continuously into its 32-entry FIFO. poll()
+ * drains that FIFO in bursts into a lock-free ring, as far as the ring
+ * has room; process() runs the integer beat detector and the SpO2
+ * estimator on every queued sample.
+ * Intervals are counted in samples, not millis(), so the rate does not
+ * depend on when the loop happens to look. poll() may run from a timer
+ * task or a FIFO-almost-full interrupt handler while process() runs in
+ * the main loop.
+ *
+ * With a HeartRateFusion attached, every IR sample goes through its
+ * motion canceller before beat detection and each beat feeds its rate
+ * estimate; process() then holds PPG samples back until the IMU side has
+ * queued the reference to pair them with, up to half the ring.
+ *
+ * Where SPECTRAL_HR_ENABLED, the same samples also feed the spectral
+ * estimator (spectral_hr.h). Its rate stands in while the beat path has
+ * none, with its quality as the confidence, once that is at least
+ * SPECTRAL_HR_MIN_QUALITY.
+ */
+
+#ifndef RESCUENET_PPG_ACQUISITION_H
+#define RESCUENET_PPG_ACQUISITION_H
+
+#include "hal.h"
+#include "heart_rate_fusion.h"
+#include "pulse_detector.h"
+#include "spectral_hr.h"
+#include "spo2_estimator.h"
+#include "spsc_ring.h"
+
+#ifndef PPG_RING_SIZE
+#if defined(__AVR__)
+#define PPG_RING_SIZE 4  // The FIFO holds 32; the PPG task drains it in steps
+#else
+#define PPG_RING_SIZE 64
+#endif
+#endif
+
+// IR level below which no finger is on the sensor (SparkFun examples use the same)
+#define PPG_FINGER_THRESHOLD 50000UL
+
+#define SPECTRAL_HR_MIN_QUALITY 50
+
+struct PpgStats {
+  uint32_t samplesRead;       // Drained from the sensor FIFO
+  uint32_t samplesProcessed;  // Run through beat detection
+  uint32_t fifoOverflows;     // Lost inside the sensor before a drain
+  uint32_t ringDrops;         // Lost because process() fell behind
+  uint32_t beats;
+  uint32_t drains;
+  uint8_t maxBurst;           // Most samples found in the FIFO by one drain
+};
+
+class PpgAcquisition {
+public:
+  explicit PpgAcquisition(PpgSensor* sensor);
+
+  // Default 400 Hz ADC with 4x averaging gives 100 samples/s
+  bool begin(uint16_t sampleRateHz = 400, uint8_t averaging = 4);
+  // Another rate once running: the sensor is reconfigured and the
+  // estimators carry on at it, keeping the rate and SpO2 they have
+  bool setRate(uint16_t sampleRateHz, uint8_t averaging);
+  // Before begin(); null detaches
+  void setFusion(HeartRateFusion* value) { fusion = value; }
+
+  // Producer: move what the hardware FIFO holds into the ring. True when
+  // the ring filled up first: call process() and poll again.
+  bool poll();
+  // Consumer: beat detection and SpO2 on every queued sample
+  void process();
+
+  // Fused rate when a HeartRateFusion is attached, the detector's
+  // otherwise; the spectral one while neither has a rate
+  float heartRate() const;
+  // 0..100; without fusion 100 for any measured rate, which HealthMonitor
+  // drops to 0 while the wearer moves
+  uint8_t heartRateConfidence() const;
+  bool fingerPresent() const { return latest.ir >= PPG_FINGER_THRESHOLD; }
+  const PpgSample& lastSample() const { return latest; }
+  const PulseDetector& beats() const { return detector; }
+  const Spo2Estimator& spo2() const { return oximeter; }
+#if SPECTRAL_HR_ENABLED
+  const SpectralHeartRate& spectral() const { return spectrum; }
+#endif
+  uint16_t outputRateHz() const { return rateHz; }
+  const PpgStats& stats() const { return counters; }
+
+private:
+  void onSample(const PpgSample& sample);
+  float beatRate() const;
+  bool spectralStandIn() const;
+
+  PpgSensor* sensor;
+  HeartRateFusion* fusion;
+  SpscRing<PpgSample, PPG_RING_SIZE> ring;
+  PulseDetector detector;
+  Spo2Estimator oximeter;
+#if SPECTRAL_HR_ENABLED
+  SpectralHeartRate spectrum;
+#endif
+  uint16_t rateHz;
+  unsigned long lastDrainUs;
+  PpgSample latest;
+  PpgStats counters;
+};
+
+#endif
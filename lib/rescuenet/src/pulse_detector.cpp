@@ -0,0 +1,237 @@
+/*
+ * RescueNet AI - Integer beat detector
+ */
+
+#include "pulse_detector.h"
+
+#include <string.h>
+
+static_assert(sizeof(PulseDetector) <= PULSE_DETECTOR_RAM_BUDGET,
+              "PulseDetector exceeds its RAM budget on this target");
+
+namespace {
+
+// High-pass DC tracker: 1/64 per sample, ~0.25 Hz corner at 100 Hz
+const uint8_t HP_SHIFT = 6;
+
+// Band-passed signal is clamped so the 8-tap sum stays in 16 bits
+const int16_t AC_LIMIT = 4095;
+
+// Drift a peak level towards a new peak by 1/2^shift, unsigned-safe
+uint32_t blend(uint32_t level, uint32_t peak, uint8_t shift) {
+  if (peak > level) return level + ((peak - level) >> shift);
+  return level - ((level - peak) >> shift);
+}
+
+}  // namespace
+
+PulseDetector::PulseDetector(uint16_t sampleRateHz) : sampleRate(0) {
+  setSampleRate(sampleRateHz);
+  reset();
+}
+
+void PulseDetector::setSampleRate(uint16_t sampleRateHz) {
+  if (sampleRate && sampleRateHz && sampleRateHz != sampleRate) rescale(sampleRateHz);
+  sampleRate = sampleRateHz;
+  // 250 ms: nothing faster than 240 BPM
+  refractory = sampleRateHz / 4;
+  // Dicrotic notch and wave come 250..450 ms after the systolic upstroke
+  dicroticWindow = (uint16_t)(sampleRateHz * 6UL / 10);
+}
+
+void PulseDetector::rescale(uint16_t sampleRateHz) {
+  uint32_t from = sampleRate;
+  uint32_t to = sampleRateHz;
+  // Counts of samples
+  sinceBeat = (uint16_t)(sinceBeat * to / from);
+  candidateAge = (uint16_t)(candidateAge * to / from);
+  learnSamples = (uint16_t)(learnSamples * to / from);
+  lastRr = (uint16_t)(lastRr * to / from);
+  searchBackAfter = (uint16_t)(searchBackAfter * to / from);
+  for (uint8_t i = 0; i < PULSE_RR_HISTORY; i++) rrRing[i] = (uint16_t)(rrRing[i] * to / from);
+  // The intervals in use are the rrCount before rrIndex
+  rrSum = 0;
+  for (uint8_t i = 1; i <= rrCount; i++) rrSum += rrRing[(rrIndex + PULSE_RR_HISTORY - i) % PULSE_RR_HISTORY];
+
+  // The slope per sample goes with 1 / rate, its square with 1 / rate^2
+  float energy = (float)(from * from) / (float)(to * to);
+  spki = (uint32_t)(spki * energy);
+  npki = (uint32_t)(npki * energy);
+  lastBeatPeak = (uint32_t)(lastBeatPeak * energy);
+  candidatePeak = (uint32_t)(candidatePeak * energy);
+  mwiSum = 0;
+  for (uint8_t i = 0; i < PULSE_MWI_TAPS; i++) {
+    mwiRing[i] = (uint32_t)(mwiRing[i] * energy);
+    mwiSum += mwiRing[i];
+  }
+  mwiPrev = (uint32_t)(mwiPrev * energy);
+  updateThreshold();
+}
+
+void PulseDetector::reset() {
+  dcQ4 = 0;
+  memset(lpRing, 0, sizeof(lpRing));
+  lpSum = 0;
+  lpPrev1 = 0;
+  lpPrev2 = 0;
+  memset(mwiRing, 0, sizeof(mwiRing));
+  mwiSum = 0;
+  mwiPrev = 0;
+  lpIndex = 0;
+  mwiIndex = 0;
+  rising = false;
+  primed = false;
+  spki = 0;
+  npki = 0;
+  thresholdI1 = 0;
+  lastBeatPeak = 0;
+  learnSamples = 0;
+  candidatePeak = 0;
+  candidateAge = 0;
+  sinceBeat = 0;
+  lastRr = 0;
+  searchBackAfter = 0;
+  memset(rrRing, 0, sizeof(rrRing));
+  rrSum = 0;
+  rrIndex = 0;
+  rrCount = 0;
+  beatCount = 0;
+  haveBeat = false;
+}
+
+bool PulseDetector::addSample(int32_t sample) {
+  int32_t xQ4 = sample * 16;
+  if (!primed) {
+    dcQ4 = xQ4;
+    primed = true;
+  }
+
+  // 1. High-pass
+  dcQ4 += (xQ4 - dcQ4) >> HP_SHIFT;
+  int32_t ac = (xQ4 - dcQ4) >> 4;
+  if (ac > AC_LIMIT) ac = AC_LIMIT;
+  if (ac < -AC_LIMIT) ac = -AC_LIMIT;
+
+  // 2. Low-pass: running sum over the last PULSE_LP_TAPS samples
+  lpSum += (int16_t)ac - lpRing[lpIndex];
+  lpRing[lpIndex] = (int16_t)ac;
+  lpIndex = (uint8_t)((lpIndex + 1) % PULSE_LP_TAPS);
+  int16_t lp = lpSum / PULSE_LP_TAPS;
+
+  // 3. Derivative, rising edges only; 4. squaring
+  int16_t slope = lp - lpPrev2;
+  lpPrev2 = lpPrev1;
+  lpPrev1 = lp;
+  uint32_t energy = slope > 0 ? (uint32_t)((int32_t)slope * slope) : 0;
+
+  // 4. Moving-window integration
+  mwiSum += energy - mwiRing[mwiIndex];
+  mwiRing[mwiIndex] = energy;
+  mwiIndex = (uint8_t)((mwiIndex + 1) % PULSE_MWI_TAPS);
+  uint32_t mwi = mwiSum / PULSE_MWI_TAPS;
+
+  if (sinceBeat < 0xFFFF) sinceBeat++;
+  if (candidatePeak && candidateAge < 0xFFFF) candidateAge++;
+
+  // 5. Local maximum of the integrated signal, one sample late
+  bool beat = false;
+  if (mwi > mwiPrev) {
+    rising = true;
+  } else if (mwi < mwiPrev && rising) {
+    rising = false;
+    beat = onPeak(mwiPrev);
+  }
+  mwiPrev = mwi;
+
+  if (learnSamples < sampleRate * 2) {
+    learnSamples++;
+    if (learnSamples == sampleRate * 2) {
+      // Training over: seed the levels from the largest peak seen
+      npki = spki / 8;
+      spki = spki / 2;
+      updateThreshold();
+    }
+    return false;
+  }
+
+  // Search-back: a beat is overdue, take the best sub-threshold peak
+  if (!beat && rrCount && sinceBeat > searchBackAfter && candidatePeak > thresholdI1 / 2) {
+    acceptBeat(candidatePeak, sinceBeat - candidateAge, true);
+    sinceBeat = candidateAge;
+    beat = true;
+  }
+
+  // Pulse lost for three seconds (finger moved, contact pressure changed):
+  // relax the levels so a weaker signal is picked up again
+  if (sinceBeat > sampleRate * 3) {
+    spki >>= 1;
+    npki >>= 1;
+    updateThreshold();
+    sinceBeat = 0;
+    haveBeat = false;
+    rrCount = 0;
+    rrSum = 0;
+    candidatePeak = 0;
+  }
+  return beat;
+}
+
+bool PulseDetector::onPeak(uint32_t peak) {
+  if (learnSamples < sampleRate * 2) {
+    if (peak > spki) spki = peak;
+    return false;
+  }
+  if (haveBeat && sinceBeat < refractory) return false;
+
+  // Dicrotic wave: an early peak under half the last beat's is the
+  // same pulse (the T-wave rule in Pan-Tompkins)
+  bool dicrotic = haveBeat && sinceBeat < dicroticWindow && peak < lastBeatPeak / 2;
+
+  if (peak > thresholdI1 && !dicrotic) {
+    acceptBeat(peak, sinceBeat, false);
+    sinceBeat = 0;
+    return true;
+  }
+
+  npki = blend(npki, peak, 3);
+  updateThreshold();
+  if (peak > candidatePeak) {
+    candidatePeak = peak;
+    candidateAge = 0;
+  }
+  return false;
+}
+
+void PulseDetector::acceptBeat(uint32_t peak, uint16_t interval, bool searchBack) {
+  // Search-back beats pull the signal level down faster (Pan-Tompkins: 0.25 vs 0.125)
+  spki = blend(spki, peak, searchBack ? 2 : 3);
+  updateThreshold();
+  lastBeatPeak = peak;
+  candidatePeak = 0;
+  beatCount++;
+
+  bool plausible = interval >= refractory && interval <= sampleRate * 3;
+  if (haveBeat && plausible) {
+    if (rrCount == PULSE_RR_HISTORY) {
+      rrSum -= rrRing[rrIndex];
+    } else {
+      rrCount++;
+    }
+    rrRing[rrIndex] = interval;
+    rrIndex = (uint8_t)((rrIndex + 1) % PULSE_RR_HISTORY);
+    rrSum += interval;
+    lastRr = interval;
+    // 166 % of the average interval
+    searchBackAfter = (uint16_t)((uint32_t)rrSum * 166 / (100UL * rrCount));
+  }
+  haveBeat = true;
+}
+
+void PulseDetector::updateThreshold() {
+  thresholdI1 = spki > npki ? npki + ((spki - npki) >> 2) : npki;
+}
+
+uint16_t PulseDetector::bpmTenths() const {
+  if (!rrCount || !rrSum) return 0;
+  return (uint16_t)(600UL * sampleRate * rrCount / rrSum);
+}
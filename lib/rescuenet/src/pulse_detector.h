@@ -0,0 +1,105 @@
+/*
+ * RescueNet AI - Integer beat detector
+ *
+ * Pan-Tompkins style pipeline adapted to the PPG pulse, sized for the
+ * ATmega328 (2 KB RAM, no FPU) and used on every board:
+ *
+ *   1. high-pass: DC tracker, ~0.25 Hz at 100 Hz
+ *   2. low-pass: 8-tap moving average (null at fs/8)
+ *   3. derivative: y[n] - y[n-2], rising edges only
+ *   4. squaring, then an 8-tap moving-window integrator (~80 ms)
+ *   5. adaptive thresholds: signal and noise peak levels (SPKI/NPKI)
+ *      updated per peak, threshold = NPKI + (SPKI - NPKI) / 4, a 250 ms
+ *      refractory period, the T-wave rule applied to the dicrotic wave
+ *      (an early peak under half the last beat's is not a beat) and
+ *      search-back at half threshold when no beat arrives within 166 %
+ *      of the average interval
+ *
+ * Intervals are counted in samples and averaged over the last
+ * PULSE_RR_HISTORY beats. Per sample there are only integer adds,
+ * shifts, compares and one 16x16 -> 32 bit square; no floats, divisions
+ * happen once per beat, nothing touches the heap. The object size is
+ * checked at compile time against PULSE_DETECTOR_RAM_BUDGET
+ * (ram_budget.h).
+ *
+ * Works on raw 10-bit ADC readings from an analog pulse sensor as well
+ * as on 18-bit MAX3010x IR counts; the pulse polarity does not matter
+ * because the rate comes from the one steep edge per cycle.
+ */
+
+#ifndef RESCUENET_PULSE_DETECTOR_H
+#define RESCUENET_PULSE_DETECTOR_H
+
+#include "ram_budget.h"
+
+#include <stdint.h>
+
+#define PULSE_LP_TAPS 8
+#define PULSE_MWI_TAPS 8
+#define PULSE_RR_HISTORY 8
+
+class PulseDetector {
+public:
+  explicit PulseDetector(uint16_t sampleRateHz = 100);
+
+  void reset();
+  // Mid-stream the learned levels and intervals are carried over, scaled
+  // to the new rate, so the rate is not lost
+  void setSampleRate(uint16_t sampleRateHz);
+
+  // Feed one raw sample; returns true when a beat is detected
+  bool addSample(int32_t sample);
+
+  // Average rate in tenths of a BPM over the interval history, 0 until known
+  uint16_t bpmTenths() const;
+  uint16_t lastInterval() const { return lastRr; }
+  uint16_t beats() const { return beatCount; }
+  uint32_t threshold() const { return thresholdI1; }
+
+private:
+  void rescale(uint16_t sampleRateHz);
+  bool onPeak(uint32_t peak);
+  void acceptBeat(uint32_t peak, uint16_t interval, bool searchBack);
+  void updateThreshold();
+
+  // Filter state
+  int32_t dcQ4;
+  int16_t lpRing[PULSE_LP_TAPS];
+  int16_t lpSum;
+  int16_t lpPrev1;
+  int16_t lpPrev2;
+  uint32_t mwiRing[PULSE_MWI_TAPS];
+  uint32_t mwiSum;
+  uint32_t mwiPrev;
+  uint8_t lpIndex;
+  uint8_t mwiIndex;
+  bool rising;
+  bool primed;
+
+  // Adaptive thresholds
+  uint32_t spki;
+  uint32_t npki;
+  uint32_t thresholdI1;
+  uint32_t lastBeatPeak;
+  uint16_t learnSamples;  // Counts up to two seconds; SPKI holds the running max meanwhile
+
+  // Search-back candidate: largest sub-threshold peak since the last beat
+  uint32_t candidatePeak;
+  uint16_t candidateAge;
+
+  // Timing, all in samples
+  uint16_t sampleRate;
+  uint16_t refractory;
+  uint16_t dicroticWindow;
+  uint16_t sinceBeat;
+  uint16_t lastRr;
+  uint16_t searchBackAfter;
+  uint16_t rrRing[PULSE_RR_HISTORY];
+  uint16_t rrSum;
+  uint8_t rrIndex;
+  uint8_t rrCount;
+  uint16_t beatCount;
+  bool haveBeat;
+};
+
+#endif
@@ -0,0 +1,32 @@
+/*
+ * RescueNet AI - RAM budget
+ *
+ * The Arduino Nano (ATmega328P) has 2048 bytes of SRAM for everything:
+ * globals, the Wire and Serial buffers, the heap and the stack. The
+ * shares below are what the parts that run on it may take. Each is
+ * checked with a static_assert next to the class, on every target, and
+ * the sketch as a whole against what the core and the stack leave.
+ */
+
+#ifndef RESCUENET_RAM_BUDGET_H
+#define RESCUENET_RAM_BUDGET_H
+
+#define NANO_RAM_BYTES 2048
+// The Arduino core's own: the Wire and twi buffers (160), SoftwareSerial's
+// receive buffer (64), millis() and malloc. Serial is not linked in while
+// RESCUENET_LOG is 0.
+#define NANO_CORE_RAM_BYTES 290
+#define NANO_STACK_RAM_BYTES 256
+// What the sketch's objects may take all together; nano_enhanced.ino checks
+// it as it builds. The nano_size target (host/nano_size.cmake) checks the
+// linked sketch with avr-size, the core's buffers, strings and vtables
+// included: NANO_STACK_RAM_BYTES must be left. AVR copies every string
+// constant to RAM, so the library keeps them in flash (PSTR(), PROGMEM).
+#define NANO_SKETCH_RAM_BUDGET (NANO_RAM_BYTES - NANO_CORE_RAM_BYTES - NANO_STACK_RAM_BYTES)
+
+#define PULSE_DETECTOR_RAM_BUDGET 192
+#define HR_FUSION_RAM_BUDGET 160
+// Besides the glyph cache; the driver it replaced took 1024 for pixels
+#define OLED_RENDERER_RAM_BUDGET 448
+
+#endif
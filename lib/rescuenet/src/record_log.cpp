@@ -0,0 +1,368 @@
+/*
+ * RescueNet AI - Crash-safe store-and-forward log
+ */
+
+#include "record_log.h"
+
+#include "crc16.h"
+
+namespace {
+
+const uint8_t FRAME_DATA = 1;
+const uint8_t FRAME_ACK = 2;
+const uint8_t ERASED = 0xFF;
+const uint8_t LOG_VERSION = 1;
+
+// Sector header: "RL", version, reserved, generation, CRC
+const uint32_t HEADER_SIZE = 10;
+const uint32_t FRAME_HEAD = 6;
+const uint32_t FRAME_OVERHEAD = FRAME_HEAD + 2;
+
+void putU32(uint8_t* out, uint32_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+  out[2] = (uint8_t)(value >> 16);
+  out[3] = (uint8_t)(value >> 24);
+}
+
+uint32_t getU32(const uint8_t* in) {
+  return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+}  // namespace
+
+RecordLog::RecordLog(LogStorage* storage)
+  : storage(storage), sectorSize(0), sectors(0), mounted(false), head(0), used(0), generation(0),
+    writeOffset(0), pageBase(0), fill(0), synced(0), dirtySinceMs(0), lastSequence(0), ackedSequence(0),
+    aheadSequence(0), pendingCount(0), aheadCount(0) {
+  cursor.sector = ahead.sector = 0;
+  cursor.offset = ahead.offset = 0;
+  memset(&counters, 0, sizeof(counters));
+}
+
+bool RecordLog::begin() {
+  mounted = false;
+  if (!storage) return false;
+  sectorSize = storage->eraseSize();
+  if (sectorSize == 0 || sectorSize % LOG_PAGE_SIZE != 0 ||
+      sectorSize < HEADER_SIZE + FRAME_OVERHEAD + LOG_RECORD_MAX) {
+    return false;
+  }
+  uint32_t count = storage->size() / sectorSize;
+  if (count < 2 || count > 0xFFFF) return false;
+  sectors = (uint16_t)count;
+  // Set before scanning so load() does not overlay a stale page
+  fill = synced = 0;
+  pageBase = 0;
+
+  // The newest sector is the head; the ring runs from the first valid
+  // sector after it round to it
+  bool found = false;
+  generation = 0;
+  for (uint16_t s = 0; s < sectors; s++) {
+    uint32_t g;
+    if (sectorValid(s, &g) && (!found || g > generation)) {
+      found = true;
+      head = s;
+      generation = g;
+    }
+  }
+  lastSequence = ackedSequence = 0;
+  pendingCount = aheadCount = 0;
+  if (!found) {
+    used = 0;
+    if (!startSector(0)) return false;
+    mounted = true;
+    cursor.sector = head;
+    cursor.offset = writeOffset;
+    ahead = cursor;
+    return sync();
+  }
+
+  uint16_t tail = (uint16_t)((head + 1) % sectors);
+  while (tail != head && !sectorValid(tail, nullptr)) tail = (uint16_t)((tail + 1) % sectors);
+  used = (uint16_t)((head + sectors - tail) % sectors + 1);
+
+  // First pass: sequence numbers, the last acknowledgement and the end
+  // of the head sector
+  bool headDamaged = false;
+  writeOffset = sectorSize;
+  for (uint16_t i = 0, s = tail; i < used; i++, s = (uint16_t)((s + 1) % sectors)) {
+    if (s != head && !sectorValid(s, nullptr)) continue;
+    uint32_t offset = HEADER_SIZE;
+    Frame frame;
+    FrameStatus status;
+    while ((status = frameAt(s, offset, frame)) == FRAME_OK) {
+      if (frame.type == FRAME_DATA && frame.sequence > lastSequence) lastSequence = frame.sequence;
+      if (frame.type == FRAME_ACK && frame.sequence > ackedSequence) ackedSequence = frame.sequence;
+      offset += FRAME_OVERHEAD + frame.length;
+    }
+    if (status == FRAME_BAD) counters.damaged++;
+    if (s == head) {
+      writeOffset = offset;
+      headDamaged = status == FRAME_BAD;
+    }
+  }
+  if (ackedSequence > lastSequence) lastSequence = ackedSequence;
+
+  // Pick the page up where it was left
+  pageBase = sectorBase(head) + writeOffset / LOG_PAGE_SIZE * LOG_PAGE_SIZE;
+  fill = synced = (uint16_t)(sectorBase(head) + writeOffset - pageBase);
+  memset(page, ERASED, sizeof(page));
+  if (fill && !storage->read(pageBase, page, fill)) return false;
+  mounted = true;
+
+  // Second pass: the cursor is the first record past the acknowledgement
+  cursor.sector = head;
+  cursor.offset = writeOffset;
+  Position at = {tail, HEADER_SIZE};
+  Frame frame;
+  bool first = true;
+  while (nextData(at, frame)) {
+    if (frame.sequence > ackedSequence) {
+      if (first) cursor = at;
+      first = false;
+      pendingCount++;
+    }
+    at.offset += FRAME_OVERHEAD + frame.length;
+  }
+  ahead = cursor;
+  counters.recovered += pendingCount;
+
+  // A torn frame leaves the rest of the head unwritable
+  if (headDamaged || writeOffset + FRAME_OVERHEAD > sectorSize) return openNextSector();
+  return true;
+}
+
+bool RecordLog::append(const uint8_t* data, size_t length) {
+  if (!mounted || length == 0 || length > LOG_RECORD_MAX) return false;
+  if (!writeFrame(FRAME_DATA, lastSequence + 1, data, length)) return false;
+  lastSequence++;
+  pendingCount++;
+  counters.appended++;
+  counters.payloadBytes += length;
+  return true;
+}
+
+bool RecordLog::sync() {
+  if (!storage) return false;
+  if (fill == synced) return true;
+  bool ok = storage->write(pageBase + synced, page + synced, fill - synced);
+  counters.writes++;
+  counters.bytesWritten += fill - synced;
+  synced = fill;
+  return ok;
+}
+
+void RecordLog::poll() {
+  if (mounted && fill != synced && millis() - dirtySinceMs >= LOG_SYNC_MS) sync();
+}
+
+size_t RecordLog::peek(uint8_t* out, size_t capacity) {
+  Frame frame;
+  return fetch(out, capacity, frame);
+}
+
+size_t RecordLog::read(uint8_t* out, size_t capacity) {
+  Frame frame;
+  size_t length = fetch(out, capacity, frame);
+  if (length == 0) return 0;
+  aheadSequence = frame.sequence;
+  ahead.offset += FRAME_OVERHEAD + (uint32_t)length;
+  aheadCount++;
+  return length;
+}
+
+void RecordLog::commit() {
+  if (!mounted || aheadCount == 0) return;
+  cursor = ahead;
+  pendingCount -= aheadCount;
+  aheadCount = 0;
+  ackedSequence = aheadSequence;
+  writeFrame(FRAME_ACK, ackedSequence, nullptr, 0);
+}
+
+void RecordLog::commit(uint32_t count) {
+  if (!mounted || count == 0) return;
+  if (count >= aheadCount) {
+    commit();
+    return;
+  }
+  Frame frame;
+  for (uint32_t i = 0; i < count; i++) {
+    if (!nextData(cursor, frame)) return;
+    cursor.offset += FRAME_OVERHEAD + frame.length;
+  }
+  pendingCount -= count;
+  aheadCount -= count;
+  ackedSequence = frame.sequence;
+  writeFrame(FRAME_ACK, ackedSequence, nullptr, 0);
+}
+
+void RecordLog::rewind() {
+  ahead = cursor;
+  aheadCount = 0;
+}
+
+float RecordLog::writeAmplification() const {
+  return counters.payloadBytes ? (float)counters.bytesWritten / counters.payloadBytes : 0;
+}
+
+size_t RecordLog::fetch(uint8_t* out, size_t capacity, Frame& frame) {
+  if (!mounted || aheadCount >= pendingCount) return 0;
+  if (!nextData(ahead, frame) || frame.length > capacity) return 0;
+  if (!load(sectorBase(ahead.sector) + ahead.offset + FRAME_HEAD, out, frame.length)) return 0;
+  return frame.length;
+}
+
+bool RecordLog::load(uint32_t offset, uint8_t* data, size_t length) {
+  uint32_t end = offset + length;
+  uint32_t pageEnd = pageBase + fill;
+  if (offset >= pageBase && end <= pageEnd) {
+    memcpy(data, page + (offset - pageBase), length);
+    return true;
+  }
+  if (!storage->read(offset, data, length)) return false;
+  // The page buffer is newer than the storage behind it
+  uint32_t from = offset > pageBase ? offset : pageBase;
+  uint32_t to = end < pageEnd ? end : pageEnd;
+  if (from < to) memcpy(data + (from - offset), page + (from - pageBase), to - from);
+  return true;
+}
+
+bool RecordLog::sectorValid(uint16_t sector, uint32_t* generationOut) {
+  uint8_t header[HEADER_SIZE];
+  if (!load(sectorBase(sector), header, sizeof(header))) return false;
+  if (header[0] != 'R' || header[1] != 'L' || header[2] != LOG_VERSION) return false;
+  uint16_t crc = (uint16_t)(header[8] | header[9] << 8);
+  if (crc != crc16Ccitt(header, 8)) return false;
+  if (generationOut) *generationOut = getU32(header + 4);
+  return true;
+}
+
+RecordLog::FrameStatus RecordLog::frameAt(uint16_t sector, uint32_t offset, Frame& frame) {
+  if (offset + FRAME_OVERHEAD > sectorSize) return FRAME_END;
+  uint32_t base = sectorBase(sector) + offset;
+  uint8_t bytes[FRAME_HEAD];
+  if (!load(base, bytes, sizeof(bytes))) return FRAME_BAD;
+  if (bytes[0] == ERASED) return FRAME_END;
+
+  frame.length = bytes[0];
+  frame.type = bytes[1];
+  frame.sequence = getU32(bytes + 2);
+  if ((frame.type != FRAME_DATA && frame.type != FRAME_ACK) || (frame.type == FRAME_DATA && frame.length == 0) ||
+      offset + FRAME_OVERHEAD + frame.length > sectorSize) {
+    return FRAME_BAD;
+  }
+
+  // CRC over the payload in small pieces, so no record sized buffer
+  uint16_t crc = crc16Ccitt(bytes, sizeof(bytes));
+  uint8_t chunk[32];
+  for (uint32_t done = 0; done < frame.length;) {
+    uint32_t n = frame.length - done < sizeof(chunk) ? frame.length - done : sizeof(chunk);
+    if (!load(base + FRAME_HEAD + done, chunk, n)) return FRAME_BAD;
+    crc = crc16Ccitt(chunk, n, crc);
+    done += n;
+  }
+  uint8_t stored[2];
+  if (!load(base + FRAME_HEAD + frame.length, stored, 2)) return FRAME_BAD;
+  return crc == (uint16_t)(stored[0] | stored[1] << 8) ? FRAME_OK : FRAME_BAD;
+}
+
+bool RecordLog::nextData(Position& at, Frame& frame) {
+  // Moves at onto the next data frame, stepping over ACKs and sector ends
+  for (;;) {
+    if (at.sector == head && at.offset >= writeOffset) return false;
+    FrameStatus status = at.offset == HEADER_SIZE && at.sector != head && !sectorValid(at.sector, nullptr)
+                           ? FRAME_END
+                           : frameAt(at.sector, at.offset, frame);
+    if (status == FRAME_OK) {
+      if (frame.type == FRAME_DATA) return true;
+      at.offset += FRAME_OVERHEAD + frame.length;
+      continue;
+    }
+    if (at.sector == head) return false;
+    at.sector = (uint16_t)((at.sector + 1) % sectors);
+    at.offset = HEADER_SIZE;
+  }
+}
+
+bool RecordLog::writeFrame(uint8_t type, uint32_t sequence, const uint8_t* data, size_t length) {
+  if (writeOffset + FRAME_OVERHEAD + length > sectorSize && !openNextSector()) return false;
+  uint8_t bytes[FRAME_HEAD];
+  bytes[0] = (uint8_t)length;
+  bytes[1] = type;
+  putU32(bytes + 2, sequence);
+  uint16_t crc = crc16Ccitt(bytes, sizeof(bytes));
+  if (length) crc = crc16Ccitt(data, length, crc);
+  uint8_t check[2] = {(uint8_t)crc, (uint8_t)(crc >> 8)};
+  return put(bytes, sizeof(bytes)) && (length == 0 || put(data, length)) && put(check, sizeof(check));
+}
+
+bool RecordLog::put(const uint8_t* data, size_t length) {
+  if (fill == synced) dirtySinceMs = millis();
+  while (length) {
+    size_t room = LOG_PAGE_SIZE - fill;
+    size_t n = room < length ? room : length;
+    memcpy(page + fill, data, n);
+    fill = (uint16_t)(fill + n);
+    writeOffset += n;
+    data += n;
+    length -= n;
+    if (fill == LOG_PAGE_SIZE) {
+      // A full page goes out in one write
+      if (!sync()) return false;
+      pageBase += LOG_PAGE_SIZE;
+      fill = synced = 0;
+      memset(page, ERASED, sizeof(page));
+      dirtySinceMs = millis();
+    }
+  }
+  return true;
+}
+
+bool RecordLog::startSector(uint16_t sector) {
+  bool ok = storage->erase(sectorBase(sector));
+  counters.erases++;
+  head = sector;
+  used++;
+  generation++;
+  pageBase = sectorBase(sector);
+  fill = synced = 0;
+  writeOffset = 0;
+  memset(page, ERASED, sizeof(page));
+
+  // Written with the first page, so a sector with no header is empty
+  uint8_t header[HEADER_SIZE] = {'R', 'L', LOG_VERSION, 0};
+  putU32(header + 4, generation);
+  uint16_t crc = crc16Ccitt(header, 8);
+  header[8] = (uint8_t)crc;
+  header[9] = (uint8_t)(crc >> 8);
+  return ok && put(header, sizeof(header));
+}
+
+bool RecordLog::openNextSector() {
+  if (!sync()) return false;
+  uint16_t next = (uint16_t)((head + 1) % sectors);
+  if (used == sectors) {
+    dropSector(next);
+    used--;
+  }
+  return startSector(next);
+}
+
+void RecordLog::dropSector(uint16_t sector) {
+  // The oldest sector goes; so does any backlog still in it
+  if (cursor.sector != sector) return;
+  rewind();
+  Frame frame;
+  Position at = cursor;
+  while (at.sector == sector && nextData(at, frame) && at.sector == sector) {
+    pendingCount--;
+    counters.dropped++;
+    at.offset += FRAME_OVERHEAD + frame.length;
+  }
+  cursor.sector = (uint16_t)((sector + 1) % sectors);
+  cursor.offset = HEADER_SIZE;
+  ahead = cursor;
+}
@@ -0,0 +1,153 @@
+/*
+ * RescueNet AI - Crash-safe store-and-forward log
+ *
+ * Keeps records the device could not send (telemetry.h readings and
+ * alerts) in a LogStorage until they are acknowledged, across resets and
+ * power loss. The storage is a ring of erase blocks ("sectors"); each
+ * starts with a header carrying a generation number, followed by frames:
+ *
+ *   off size field
+ *     0   1  payload length (0xFF is erased space)
+ *     1   1  type: 1 data, 2 acknowledgement
+ *     2   4  sequence number: of the record, or the last one acknowledged
+ *     6   n  payload
+ *   6+n   2  CRC-16/CCITT of everything above
+ *
+ * The log is append only. Frames are assembled in a page buffer of
+ * LOG_PAGE_SIZE bytes that is written when it fills, on sync(), or when
+ * poll() finds it LOG_SYNC_MS old, so every byte is programmed once and
+ * a reading costs a fraction of a page write rather than one each. The
+ * read cursor is persisted the same way, as acknowledgement frames in
+ * the ring, so there is no fixed cursor location to wear out. A sector
+ * is erased only when the head moves into it: over a full pass of the
+ * ring every sector takes one erase. When the ring is full the oldest
+ * sector makes room and its unacknowledged records count as dropped.
+ *
+ * begin() rebuilds the state from the storage: the newest valid sector
+ * header is the head, the largest acknowledged sequence the cursor. A
+ * frame with a bad CRC (a write cut by a reset) ends its sector; when it
+ * is the head, writing resumes in a fresh sector. Records whose ACK was
+ * still in the page buffer at a crash are replayed again, so delivery is
+ * at least once; the telemetry sequence numbers let the server tell.
+ *
+ * Replay reads ahead of the cursor in batches: read() the next records,
+ * then commit() once the server has them or rewind() to read them again.
+ */
+
+#ifndef RESCUENET_RECORD_LOG_H
+#define RESCUENET_RECORD_LOG_H
+
+#include "hal.h"
+
+// Bytes assembled in RAM per storage write; a divisor of the erase size
+#ifndef LOG_PAGE_SIZE
+#if defined(__AVR__)
+#define LOG_PAGE_SIZE 64
+#else
+#define LOG_PAGE_SIZE 256
+#endif
+#endif
+
+// Longest a partly filled page stays in RAM
+#ifndef LOG_SYNC_MS
+#define LOG_SYNC_MS 30000
+#endif
+
+#define LOG_RECORD_MAX 254
+
+struct LogStats {
+  uint32_t appended;      // Records taken by append()
+  uint32_t payloadBytes;  // Their length
+  uint32_t bytesWritten;  // Programmed into the storage: headers, frames, ACKs
+  uint32_t writes;        // Storage write() calls
+  uint32_t erases;
+  uint32_t dropped;       // Unacknowledged records lost when the ring wrapped
+  uint32_t recovered;     // Unacknowledged records found by begin()
+  uint32_t damaged;       // Torn or corrupt frames begin() stopped at
+};
+
+class RecordLog {
+public:
+  explicit RecordLog(LogStorage* storage);
+
+  // Mounts the storage, formatting it when it holds no log; false when
+  // the storage is missing or its geometry does not fit
+  bool begin();
+  bool ready() const { return mounted; }
+
+  // Buffers one record of 1..LOG_RECORD_MAX bytes
+  bool append(const uint8_t* data, size_t length);
+  // Writes whatever is buffered; data and cursor survive a reset after this
+  bool sync();
+  // Syncs a page left partly filled for LOG_SYNC_MS
+  void poll();
+
+  // Next record past those already read, without taking it; its length,
+  // or 0 when there is none or it does not fit in capacity
+  size_t peek(uint8_t* out, size_t capacity);
+  // Same, and moves past it
+  size_t read(uint8_t* out, size_t capacity);
+  // Acknowledges every record read so far
+  void commit();
+  // Acknowledges the oldest count of them; the rest stay read
+  void commit(uint32_t count);
+  // Forgets the reads since the last commit()
+  void rewind();
+
+  // Unacknowledged records, read or not
+  uint32_t pending() const { return pendingCount; }
+  const LogStats& stats() const { return counters; }
+  // Storage bytes written per payload byte appended
+  float writeAmplification() const;
+
+private:
+  struct Position {
+    uint16_t sector;
+    uint32_t offset;
+  };
+  struct Frame {
+    uint8_t type;
+    uint8_t length;
+    uint32_t sequence;
+  };
+  enum FrameStatus { FRAME_OK, FRAME_END, FRAME_BAD };
+
+  size_t fetch(uint8_t* out, size_t capacity, Frame& frame);
+  bool load(uint32_t offset, uint8_t* data, size_t length);
+  bool sectorValid(uint16_t sector, uint32_t* generation);
+  FrameStatus frameAt(uint16_t sector, uint32_t offset, Frame& frame);
+  bool nextData(Position& at, Frame& frame);
+  bool writeFrame(uint8_t type, uint32_t sequence, const uint8_t* data, size_t length);
+  bool put(const uint8_t* data, size_t length);
+  bool startSector(uint16_t sector);
+  bool openNextSector();
+  void dropSector(uint16_t sector);
+  uint32_t sectorBase(uint16_t sector) const { return (uint32_t)sector * sectorSize; }
+
+  LogStorage* storage;
+  uint32_t sectorSize;
+  uint16_t sectors;
+  bool mounted;
+
+  uint16_t head;            // Sector being written
+  uint16_t used;            // Sectors in the ring, tail to head
+  uint32_t generation;      // Of the head sector
+  uint32_t writeOffset;     // Next frame in the head sector
+
+  uint8_t page[LOG_PAGE_SIZE];
+  uint32_t pageBase;        // Storage offset of page[0]
+  uint16_t fill;            // Bytes in page
+  uint16_t synced;          // Of those, already written
+  uint32_t dirtySinceMs;
+
+  uint32_t lastSequence;    // Of the newest record
+  uint32_t ackedSequence;
+  Position cursor;          // First unacknowledged record
+  Position ahead;           // First record not yet read
+  uint32_t aheadSequence;   // Of the last record read
+  uint32_t pendingCount;
+  uint32_t aheadCount;      // Records read since the last commit()
+  LogStats counters;
+};
+
+#endif
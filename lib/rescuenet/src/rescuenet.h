@@ -0,0 +1,31 @@
+/*
+ * RescueNet AI - firmware library
+ *
+ * Include this from a sketch to get the HAL interfaces and the shared
+ * health monitor. Install by linking lib/rescuenet into the Arduino
+ * libraries folder (see doc/INSTALL.md).
+ */
+
+#ifndef RESCUENET_H
+#define RESCUENET_H
+
+#include "hal.h"
+#include "health_monitor.h"
+#include "sim800l.h"
+#include "esp8266_http.h"
+#include "gps_receiver.h"
+#include "history_log.h"
+#include "history_ring.h"
+#include "http_server.h"
+#include "mqtt_client.h"
+#include "oled_renderer.h"
+#include "ram_budget.h"
+#include "record_log.h"
+#include "sensor_link.h"
+#include "sensor_trace.h"
+#include "telemetry.h"
+#include "temp_probes.h"
+#include "text_format.h"
+#include "trace_recorder.h"
+
+#endif
@@ -0,0 +1,302 @@
+/*
+ * RescueNet AI - Cooperative deadline scheduler
+ */
+
+#include "scheduler.h"
+
+#include <string.h>
+
+namespace {
+
+const uint8_t WHEEL_MASK = SCHEDULER_WHEEL_SLOTS - 1;
+
+const uint8_t TASK_USED = 0x01;
+const uint8_t TASK_ARMED = 0x02;  // In the wheel
+
+// Wrap-safe "a is at or before b"
+bool notAfter(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) <= 0;
+}
+
+// Task names are in flash
+void printName(Print& out, const char* name) {
+  char c;
+  while ((c = (char)pgm_read_byte(name++)) != 0) out.print(c);
+}
+
+#if SCHEDULER_STATS
+void printMeanMax(Print& out, uint32_t total, uint32_t runs, uint32_t max) {
+  out.print(runs ? total / runs : 0UL);
+  out.print('/');
+  out.print(max);
+}
+#endif
+
+}  // namespace
+
+Scheduler::Scheduler() {
+  memset(tasks, 0, sizeof(tasks));
+  memset(wheel, NO_TASK, sizeof(wheel));
+  cursorMs = millis() - 1;
+#if SCHEDULER_STATS
+  dispatchCount = 0;
+#endif
+  dispatching = false;
+}
+
+TaskId Scheduler::every(uint32_t periodMs, TaskFn fn, void* context, const char* name,
+                        uint32_t firstDelayMs, uint16_t deadlineMs) {
+  if (periodMs == 0) periodMs = 1;
+  if (deadlineMs == 0) deadlineMs = periodMs > 0xFFFF ? 0xFFFF : (uint16_t)periodMs;
+  return add(periodMs, firstDelayMs, fn, context, name, deadlineMs, true);
+}
+
+TaskId Scheduler::after(uint32_t delayMs, TaskFn fn, void* context, const char* name, uint16_t deadlineMs) {
+  return add(0, delayMs, fn, context, name, deadlineMs, true);
+}
+
+TaskId Scheduler::dormant(TaskFn fn, void* context, const char* name, uint16_t deadlineMs) {
+  return add(0, 0, fn, context, name, deadlineMs, false);
+}
+
+TaskId Scheduler::add(uint32_t periodMs, uint32_t delayMs, TaskFn fn, void* context, const char* name,
+                      uint16_t deadlineMs, bool armed) {
+  if (!fn) return NO_TASK;
+  if (taskCount() == 0) cursorMs = millis() - 1;  // First task; the clock may have moved since construction
+  for (TaskId id = 0; id < SCHEDULER_MAX_TASKS; id++) {
+    Task& task = tasks[id];
+    if (task.flags & TASK_USED) continue;
+    memset(&task, 0, sizeof(task));
+    task.fn = fn;
+    task.context = context;
+    task.name = name ? name : PSTR("task");
+    task.periodMs = periodMs;
+    // One-shots without a deadline only count lateness, never misses
+    task.deadlineMs = deadlineMs;
+    task.next = NO_TASK;
+    task.flags = TASK_USED;
+    if (armed) {
+      task.dueMs = millis() + delayMs;
+      insert(id);
+    }
+    return id;
+  }
+  return NO_TASK;
+}
+
+bool Scheduler::valid(TaskId id) const {
+  return id >= 0 && id < SCHEDULER_MAX_TASKS && (tasks[id].flags & TASK_USED);
+}
+
+void Scheduler::insert(TaskId id) {
+  Task& task = tasks[id];
+  // Anything already due goes in the first slot run() has not visited yet
+  uint32_t slotMs = notAfter(task.dueMs, cursorMs) ? cursorMs + 1 : task.dueMs;
+  uint8_t slot = slotMs & WHEEL_MASK;
+  task.next = wheel[slot];
+  wheel[slot] = id;
+  task.flags |= TASK_ARMED;
+}
+
+void Scheduler::unlink(TaskId id) {
+  Task& task = tasks[id];
+  if (!(task.flags & TASK_ARMED)) return;
+  for (uint8_t slot = 0; slot < SCHEDULER_WHEEL_SLOTS; slot++) {
+    int8_t* link = &wheel[slot];
+    while (*link != NO_TASK) {
+      if (*link == id) {
+        *link = task.next;
+        task.next = NO_TASK;
+        task.flags &= ~TASK_ARMED;
+        return;
+      }
+      link = &tasks[*link].next;
+    }
+  }
+}
+
+bool Scheduler::wake(TaskId id, uint32_t delayMs) {
+  if (!valid(id)) return false;
+  unlink(id);
+  tasks[id].dueMs = millis() + delayMs;
+  insert(id);
+  return true;
+}
+
+bool Scheduler::setPeriod(TaskId id, uint32_t periodMs) {
+  if (!valid(id) || tasks[id].periodMs == 0) return false;
+  if (periodMs == 0) periodMs = 1;
+  Task& task = tasks[id];
+  if (task.deadlineMs == (task.periodMs > 0xFFFF ? 0xFFFF : task.periodMs)) {
+    task.deadlineMs = periodMs > 0xFFFF ? 0xFFFF : (uint16_t)periodMs;
+  }
+  task.periodMs = periodMs;
+  if ((task.flags & TASK_ARMED) && (int32_t)(task.dueMs - (millis() + periodMs)) > 0) wake(id, periodMs);
+  return true;
+}
+
+void Scheduler::sleep(TaskId id) {
+  if (valid(id)) unlink(id);
+}
+
+void Scheduler::cancel(TaskId id) {
+  if (!valid(id)) return;
+  unlink(id);
+  tasks[id].flags = 0;
+}
+
+bool Scheduler::pending(TaskId id) const {
+  return valid(id) && (tasks[id].flags & TASK_ARMED);
+}
+
+void Scheduler::run() {
+  if (dispatching) return;  // A task called run(); finish the current pass first
+  uint32_t now = millis();
+
+  // Collect every released task from the slots between the cursor and now,
+  // ordered by absolute deadline
+  TaskId ready[SCHEDULER_MAX_TASKS];
+  uint32_t readyDeadline[SCHEDULER_MAX_TASKS];
+  uint8_t readyCount = 0;
+  uint32_t span = now - cursorMs;
+  if ((int32_t)span < 0 || span > SCHEDULER_WHEEL_SLOTS) span = SCHEDULER_WHEEL_SLOTS;
+  for (uint32_t step = 1; step <= span; step++) {
+    int8_t* link = &wheel[(cursorMs + step) & WHEEL_MASK];
+    while (*link != NO_TASK) {
+      TaskId id = *link;
+      Task& task = tasks[id];
+      if (!notAfter(task.dueMs, now)) {
+        link = &task.next;  // A later revolution
+        continue;
+      }
+      *link = task.next;
+      task.next = NO_TASK;
+      task.flags &= ~TASK_ARMED;
+
+      uint32_t deadline = task.dueMs + task.deadlineMs;
+      uint8_t at = readyCount++;
+      while (at > 0 && (int32_t)(readyDeadline[at - 1] - deadline) > 0) {
+        ready[at] = ready[at - 1];
+        readyDeadline[at] = readyDeadline[at - 1];
+        at--;
+      }
+      ready[at] = id;
+      readyDeadline[at] = deadline;
+    }
+  }
+  // The current millisecond stays open: tasks released while these run
+  // land in its slot and are picked up by the next run()
+  cursorMs = now - 1;
+
+  dispatching = true;
+  for (uint8_t i = 0; i < readyCount; i++) {
+    // An earlier task may have cancelled or re-armed this one
+    if (valid(ready[i]) && !(tasks[ready[i]].flags & TASK_ARMED)) dispatch(ready[i], now);
+  }
+  dispatching = false;
+}
+
+void Scheduler::dispatch(TaskId id, uint32_t nowMs) {
+  Task& task = tasks[id];
+  uint32_t releaseMs = task.dueMs;
+
+  // Re-arm before running so the task can override it with wake() or cancel()
+  if (task.periodMs) {
+    task.dueMs += task.periodMs;
+    if (notAfter(task.dueMs, nowMs)) {
+      uint32_t behind = (nowMs - task.dueMs) / task.periodMs + 1;
+#if SCHEDULER_STATS
+      task.stats.skipped += behind;
+#endif
+      task.dueMs += behind * task.periodMs;
+    }
+    insert(id);
+  }
+
+  uint32_t startUs = micros();
+  // millis() and micros() come from the same timer, so the release time in
+  // microseconds is the millisecond count scaled (modulo 2^32)
+  int32_t late = (int32_t)(startUs - releaseMs * 1000UL);
+  uint32_t lateUs = late > 0 ? (uint32_t)late : 0;
+  TaskFn fn = task.fn;
+  void* context = task.context;
+  fn(context);
+  uint32_t runUs = micros() - startUs;
+#if SCHEDULER_STATS
+  dispatchCount++;
+#endif
+
+  if (!(task.flags & TASK_USED)) return;  // Cancelled itself
+  TaskStats& s = task.stats;
+  if (lateUs > s.lateUsMax) s.lateUsMax = lateUs;
+  if (task.deadlineMs && lateUs + runUs > (uint32_t)task.deadlineMs * 1000UL) s.missedDeadlines++;
+#if SCHEDULER_STATS
+  s.runs++;
+  s.runUsTotal += runUs;
+  if (runUs > s.runUsMax) s.runUsMax = runUs;
+  s.lateUsTotal += lateUs;
+#endif
+}
+
+uint32_t Scheduler::idleMs() const {
+  uint32_t now = millis();
+  uint32_t idle = 0xFFFFFFFFUL;
+  for (uint8_t id = 0; id < SCHEDULER_MAX_TASKS; id++) {
+    const Task& task = tasks[id];
+    if (!(task.flags & TASK_ARMED)) continue;
+    if (notAfter(task.dueMs, now)) return 0;
+    uint32_t wait = task.dueMs - now;
+    if (wait < idle) idle = wait;
+  }
+  // Nothing armed: check back soon, something may call wake()
+  return idle == 0xFFFFFFFFUL ? 1 : idle;
+}
+
+const TaskStats* Scheduler::stats(TaskId id) const {
+  return valid(id) ? &tasks[id].stats : nullptr;
+}
+
+const char* Scheduler::name(TaskId id) const {
+  return valid(id) ? tasks[id].name : nullptr;
+}
+
+uint8_t Scheduler::taskCount() const {
+  uint8_t count = 0;
+  for (uint8_t id = 0; id < SCHEDULER_MAX_TASKS; id++) {
+    if (tasks[id].flags & TASK_USED) count++;
+  }
+  return count;
+}
+
+void Scheduler::resetStats() {
+  for (uint8_t id = 0; id < SCHEDULER_MAX_TASKS; id++) memset(&tasks[id].stats, 0, sizeof(TaskStats));
+#if SCHEDULER_STATS
+  dispatchCount = 0;
+#endif
+}
+
+void Scheduler::report(Print& out) const {
+  for (uint8_t id = 0; id < SCHEDULER_MAX_TASKS; id++) {
+    const Task& task = tasks[id];
+    if (!(task.flags & TASK_USED)) continue;
+    const TaskStats& s = task.stats;
+    printName(out, task.name);
+#if SCHEDULER_STATS
+    out.print(": runs ");
+    out.print(s.runs);
+    out.print(", run us ");
+    printMeanMax(out, s.runUsTotal, s.runs, s.runUsMax);
+    out.print(", late us ");
+    printMeanMax(out, s.lateUsTotal, s.runs, s.lateUsMax);
+    out.print(", missed ");
+    out.print(s.missedDeadlines);
+    out.print(", skipped ");
+    out.println(s.skipped);
+#else
+    out.print(": late us max ");
+    out.print(s.lateUsMax);
+    out.print(", missed ");
+    out.println(s.missedDeadlines);
+#endif
+  }
+}
@@ -0,0 +1,143 @@
+/*
+ * RescueNet AI - Cooperative deadline scheduler
+ *
+ * Replaces the delay()-paced loop: every subsystem registers periodic or
+ * one-shot tasks and loop() only calls run(). Tasks must return quickly
+ * and keep their own state between calls instead of waiting inside.
+ *
+ *   - fixed task table (SCHEDULER_MAX_TASKS), plain function pointers
+ *     with a context pointer, nothing on the heap
+ *   - releases are kept in a hashed timer wheel of 1 ms slots, so run()
+ *     only looks at the slots whose time has come
+ *   - tasks released together run earliest deadline first; a deadline
+ *     defaults to the task's period
+ *   - periodic releases do not drift: the next one is the previous
+ *     release plus the period; releases that are already past when a
+ *     task finally runs are skipped and counted
+ *
+ * Per task it records the worst lateness (start minus release, i.e.
+ * jitter) and deadline misses, and where there is RAM for them
+ * (SCHEDULER_STATS) run time, mean lateness and skipped releases.
+ */
+
+#ifndef RESCUENET_SCHEDULER_H
+#define RESCUENET_SCHEDULER_H
+
+#include <Arduino.h>
+
+#ifndef SCHEDULER_MAX_TASKS
+#if defined(__AVR__)
+#define SCHEDULER_MAX_TASKS 8
+#else
+#define SCHEDULER_MAX_TASKS 16
+#endif
+#endif
+
+// Run time, mean lateness and skips per task: 18 bytes a task, which the
+// Nano needs elsewhere
+#ifndef SCHEDULER_STATS
+#if defined(__AVR__)
+#define SCHEDULER_STATS 0
+#else
+#define SCHEDULER_STATS 1
+#endif
+#endif
+
+// Timer wheel size; one slot per millisecond, power of two
+#ifndef SCHEDULER_WHEEL_SLOTS
+#if defined(__AVR__)
+#define SCHEDULER_WHEEL_SLOTS 16
+#else
+#define SCHEDULER_WHEEL_SLOTS 32
+#endif
+#endif
+
+#define NO_TASK -1
+
+typedef void (*TaskFn)(void* context);
+typedef int8_t TaskId;
+
+struct TaskStats {
+  uint32_t lateUsMax;        // Start minus release time
+  uint16_t missedDeadlines;  // Finished after release + deadline
+#if SCHEDULER_STATS
+  uint16_t skipped;          // Periodic releases that passed while the task was late
+  uint32_t runs;
+  uint32_t runUsTotal;
+  uint32_t runUsMax;
+  uint32_t lateUsTotal;
+#endif
+};
+
+class Scheduler {
+public:
+  Scheduler();
+
+  // Task names are for report() and stay in flash: pass PSTR("name").
+  // Periodic task, first released firstDelayMs from now
+  TaskId every(uint32_t periodMs, TaskFn fn, void* context, const char* name,
+               uint32_t firstDelayMs = 0, uint16_t deadlineMs = 0);
+  // One-shot task released delayMs from now. It stays registered after it
+  // runs, dormant until wake() releases it again.
+  TaskId after(uint32_t delayMs, TaskFn fn, void* context, const char* name, uint16_t deadlineMs = 0);
+  // Registered but dormant one-shot task
+  TaskId dormant(TaskFn fn, void* context, const char* name, uint16_t deadlineMs = 0);
+
+  // Moves the next release of a task to delayMs from now
+  bool wake(TaskId id, uint32_t delayMs);
+  // New period for a periodic task from its next release on; a release
+  // further out than the new period is brought in. A deadline left at
+  // the old period follows it.
+  bool setPeriod(TaskId id, uint32_t periodMs);
+  // Takes a task out of the wheel without freeing it
+  void sleep(TaskId id);
+  void cancel(TaskId id);
+  bool pending(TaskId id) const;
+
+  // Runs every released task, earliest deadline first
+  void run();
+  // Milliseconds until the next release; 0 when one is due
+  uint32_t idleMs() const;
+
+  const TaskStats* stats(TaskId id) const;
+  // In flash (pgm_read_byte() on AVR)
+  const char* name(TaskId id) const;
+  uint8_t taskCount() const;
+#if SCHEDULER_STATS
+  uint32_t dispatches() const { return dispatchCount; }
+#endif
+  void resetStats();
+  // One line per task: runs, run time and lateness mean/max, misses;
+  // the worst lateness and misses without SCHEDULER_STATS
+  void report(Print& out) const;
+
+private:
+  struct Task {
+    TaskFn fn;
+    void* context;
+    const char* name;
+    uint32_t dueMs;
+    uint32_t periodMs;   // 0 for one-shot
+    uint16_t deadlineMs;
+    int8_t next;         // Next task in the same wheel slot
+    uint8_t flags;
+    TaskStats stats;
+  };
+
+  TaskId add(uint32_t periodMs, uint32_t delayMs, TaskFn fn, void* context, const char* name,
+             uint16_t deadlineMs, bool armed);
+  void insert(TaskId id);
+  void unlink(TaskId id);
+  void dispatch(TaskId id, uint32_t nowMs);
+  bool valid(TaskId id) const;
+
+  Task tasks[SCHEDULER_MAX_TASKS];
+  int8_t wheel[SCHEDULER_WHEEL_SLOTS];
+  uint32_t cursorMs;  // Wheel slots up to this time are done with
+#if SCHEDULER_STATS
+  uint32_t dispatchCount;
+#endif
+  bool dispatching;
+};
+
+#endif
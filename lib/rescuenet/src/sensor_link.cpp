@@ -0,0 +1,310 @@
+/*
+ * RescueNet AI - Framed sensor link between two boards
+ */
+
+#include "sensor_link.h"
+
+#include "crc16.h"
+
+#include <string.h>
+
+namespace {
+
+const size_t COMMAND_RAW_SIZE = 4 + LINK_COMMAND_SIZE + 2;
+
+static_assert(LINK_FRAME_MAX <= 255, "frame lengths are kept in a byte");
+
+void put16(uint8_t* out, uint16_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+}
+
+void put32(uint8_t* out, uint32_t value) {
+  put16(out, (uint16_t)value);
+  put16(out + 2, (uint16_t)(value >> 16));
+}
+
+uint16_t get16(const uint8_t* in) {
+  return (uint16_t)(in[0] | ((uint16_t)in[1] << 8));
+}
+
+uint32_t get32(const uint8_t* in) {
+  return get16(in) | ((uint32_t)get16(in + 2) << 16);
+}
+
+// value * scale rounded to the nearest integer and clamped to [low, high]
+int32_t scaled(float value, float scale, int32_t low, int32_t high) {
+  float v = value * scale;
+  if (!(v == v)) return 0;  // NaN
+  if (v <= low) return low;
+  if (v >= high) return high;
+  return (int32_t)(v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+// Type, sequence and count, then the CRC over length bytes
+void finishRaw(uint8_t* raw, uint8_t type, uint16_t sequence, uint8_t count, size_t length) {
+  raw[0] = type;
+  put16(raw + 1, sequence);
+  raw[3] = count;
+  put16(raw + length, crc16Ccitt(raw, length));
+}
+
+// COBS between two delimiters
+size_t frameRaw(const uint8_t* raw, size_t length, uint8_t* out) {
+  out[0] = 0;
+  size_t n = cobsEncode(raw, length, out + 1);
+  out[n + 1] = 0;
+  return n + 2;
+}
+
+// Counts the frames a sequence number says are missing. A jump backwards
+// is the other board restarting, not a loss.
+void track(uint16_t sequence, uint16_t& expected, bool& seen, LinkStats& stats) {
+  uint16_t gap = (uint16_t)(sequence - expected);
+  if (seen && gap != 0 && gap < 0x8000) stats.lost += gap;
+  seen = true;
+  expected = (uint16_t)(sequence + 1);
+}
+
+}  // namespace
+
+size_t cobsEncode(const uint8_t* in, size_t length, uint8_t* out) {
+  size_t codeAt = 0;
+  size_t o = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < length; i++) {
+    if (in[i] == 0) {
+      out[codeAt] = code;
+      codeAt = o++;
+      code = 1;
+      continue;
+    }
+    out[o++] = in[i];
+    if (++code == 0xFF) {
+      out[codeAt] = code;
+      codeAt = o++;
+      code = 1;
+    }
+  }
+  out[codeAt] = code;
+  return o;
+}
+
+size_t cobsDecode(const uint8_t* in, size_t length, uint8_t* out) {
+  size_t i = 0;
+  size_t o = 0;
+  while (i < length) {
+    uint8_t code = in[i++];
+    if (code == 0) return 0;
+    for (uint8_t k = 1; k < code; k++) {
+      if (i >= length || in[i] == 0) return 0;
+      out[o++] = in[i++];
+    }
+    if (code != 0xFF && i < length) out[o++] = 0;
+  }
+  return o;
+}
+
+// ---------------------------------------------------------------- decoder
+
+LinkDecoder::LinkDecoder() : length(0), filled(0), overrun(false) {}
+
+uint16_t LinkDecoder::sequence() const {
+  return get16(frame + 1);
+}
+
+bool LinkDecoder::feed(uint8_t byte, LinkStats& stats) {
+  if (byte != 0) {
+    if (filled < sizeof(frame)) {
+      frame[filled++] = byte;
+    } else {
+      overrun = true;
+    }
+    return false;
+  }
+  size_t encoded = filled;
+  filled = 0;
+  if (overrun) {
+    overrun = false;
+    stats.overruns++;
+    return false;
+  }
+  // Delimiters on their own are padding
+  if (encoded == 0) return false;
+
+  length = cobsDecode(frame, encoded, frame);
+  if (length < COMMAND_RAW_SIZE || get16(frame + length - 2) != crc16Ccitt(frame, length - 2)) {
+    stats.badFrames++;
+    return false;
+  }
+  bool valid = false;
+  if (type() == LINK_FRAME_SAMPLES) {
+    valid = count() >= 1 && count() <= LINK_BATCH_SAMPLES &&
+            length == LINK_HEADER_SIZE + (size_t)count() * LINK_SAMPLE_SIZE + 2;
+  } else if (type() == LINK_FRAME_COMMAND) {
+    valid = count() == 1 && length == COMMAND_RAW_SIZE;
+  }
+  if (!valid) {
+    stats.badFrames++;
+    return false;
+  }
+  stats.frames++;
+  return true;
+}
+
+// ---------------------------------------------------------------- sender
+
+LinkSender::LinkSender(uint8_t batchSamples)
+  : batchSamples(batchSamples == 0 ? 1 : batchSamples > LINK_BATCH_SAMPLES ? LINK_BATCH_SAMPLES : batchSamples),
+    count(0), sequence(0), readPosition(0), expectedCommand(0), commandSeen(false), commandHandler(nullptr),
+    commandContext(nullptr) {
+  memset(&counters, 0, sizeof(counters));
+  memset(&commandCounters, 0, sizeof(commandCounters));
+}
+
+bool LinkSender::add(const LinkSample& sample) {
+  // Sample offsets are 16 bits of ms
+  if (count > 0 && sample.timestamp - get32(batch + 4) > 0xFFFF) seal();
+  if (count >= batchSamples && !seal()) {
+    counters.dropped++;
+    return false;
+  }
+  if (count == 0) put32(batch + 4, sample.timestamp);
+  uint8_t* p = batch + LINK_HEADER_SIZE + (size_t)count * LINK_SAMPLE_SIZE;
+  put16(p, (uint16_t)(sample.timestamp - get32(batch + 4)));
+  put16(p + 2, (uint16_t)scaled(sample.heartRate, 10, 0, 65535));
+  put16(p + 4, (uint16_t)scaled(sample.spO2, 10, 0, 65535));
+  put16(p + 6, (uint16_t)scaled(sample.temperature, 100, -32768, 32767));
+  put16(p + 8, (uint16_t)scaled(sample.accelX, 100, -32768, 32767));
+  put16(p + 10, (uint16_t)scaled(sample.accelY, 100, -32768, 32767));
+  put16(p + 12, (uint16_t)scaled(sample.accelZ, 100, -32768, 32767));
+  p[14] = sample.flags;
+  count++;
+  counters.samples++;
+  if (count >= batchSamples) seal();
+  return true;
+}
+
+bool LinkSender::seal() {
+  if (count == 0) return true;
+  if (frames.space() == 0) return false;
+  size_t length = LINK_HEADER_SIZE + (size_t)count * LINK_SAMPLE_SIZE;
+  finishRaw(batch, LINK_FRAME_SAMPLES, sequence, count, length);
+  Frame frame;
+  frame.length = (uint8_t)frameRaw(batch, length + 2, frame.bytes);
+  frames.push(frame);
+  sequence++;
+  count = 0;
+  counters.frames++;
+  return true;
+}
+
+void LinkSender::flush(SerialPort& port) {
+  const Frame* frame;
+  while ((frame = frames.peek()) != nullptr) {
+    size_t left = frame->length - readPosition;
+    size_t written = port.write(frame->bytes + readPosition, left);
+    if (written < left) {
+      readPosition = (uint8_t)(readPosition + written);
+      return;
+    }
+    readPosition = 0;
+    frames.discard();
+  }
+}
+
+uint8_t LinkSender::copyReady(uint8_t* out, uint8_t max) {
+  uint8_t copied = 0;
+  uint8_t n = 0;
+  while (n < max) {
+    const Frame* frame = frames.peek();
+    if (!frame) {
+      memset(out + n, 0, max - n);
+      break;
+    }
+    uint8_t take = (uint8_t)(frame->length - readPosition);
+    if (take > max - n) take = (uint8_t)(max - n);
+    memcpy(out + n, frame->bytes + readPosition, take);
+    n = (uint8_t)(n + take);
+    copied = (uint8_t)(copied + take);
+    readPosition = (uint8_t)(readPosition + take);
+    if (readPosition == frame->length) {
+      readPosition = 0;
+      frames.discard();
+    }
+  }
+  return copied;
+}
+
+void LinkSender::onCommand(CommandHandler handler, void* context) {
+  commandHandler = handler;
+  commandContext = context;
+}
+
+void LinkSender::receive(SerialPort& port) {
+  while (port.available() > 0) {
+    uint8_t byte = (uint8_t)port.read();
+    receive(&byte, 1);
+  }
+}
+
+void LinkSender::receive(const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    if (!decoder.feed(data[i], commandCounters) || decoder.type() != LINK_FRAME_COMMAND) continue;
+    track(decoder.sequence(), expectedCommand, commandSeen, commandCounters);
+    LinkCommand command;
+    command.code = decoder.body()[0];
+    command.value = get16(decoder.body() + 1);
+    if (commandHandler) commandHandler(command, commandContext);
+  }
+}
+
+// ---------------------------------------------------------------- receiver
+
+LinkReceiver::LinkReceiver(SampleHandler handler, void* context)
+  : handler(handler), context(context), expected(0), seen(false), commandSequence(0) {
+  memset(&counters, 0, sizeof(counters));
+}
+
+void LinkReceiver::poll(SerialPort& port) {
+  while (port.available() > 0) {
+    uint8_t byte = (uint8_t)port.read();
+    feed(&byte, 1);
+  }
+}
+
+void LinkReceiver::feed(const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    if (decoder.feed(data[i], counters) && decoder.type() == LINK_FRAME_SAMPLES) deliver();
+  }
+}
+
+void LinkReceiver::deliver() {
+  track(decoder.sequence(), expected, seen, counters);
+  const uint8_t* body = decoder.body();
+  uint32_t first = get32(body);
+  for (uint8_t i = 0; i < decoder.count(); i++) {
+    const uint8_t* p = body + 4 + (size_t)i * LINK_SAMPLE_SIZE;
+    LinkSample sample;
+    sample.timestamp = first + get16(p);
+    sample.heartRate = get16(p + 2) / 10.0f;
+    sample.spO2 = get16(p + 4) / 10.0f;
+    sample.temperature = (int16_t)get16(p + 6) / 100.0f;
+    sample.accelX = (int16_t)get16(p + 8) / 100.0f;
+    sample.accelY = (int16_t)get16(p + 10) / 100.0f;
+    sample.accelZ = (int16_t)get16(p + 12) / 100.0f;
+    sample.flags = p[14];
+    counters.samples++;
+    if (handler) handler(sample, context);
+  }
+}
+
+bool LinkReceiver::sendCommand(SerialPort& port, uint8_t code, uint16_t value) {
+  uint8_t raw[COMMAND_RAW_SIZE];
+  raw[4] = code;
+  put16(raw + 5, value);
+  finishRaw(raw, LINK_FRAME_COMMAND, commandSequence++, 1, COMMAND_RAW_SIZE - 2);
+  uint8_t out[COMMAND_RAW_SIZE + 4];
+  size_t length = frameRaw(raw, sizeof(raw), out);
+  return port.write(out, length) == length;
+}
@@ -0,0 +1,200 @@
+/*
+ * RescueNet AI - Framed sensor link between two boards
+ *
+ * Carries readings from a sensor board (a Nano with the probes) to a
+ * network board (an ESP32) over a UART or I2C, and commands back. The
+ * sensor side pushes: it batches timestamped samples into one frame,
+ * encodes the frame completely in the main loop, and the transport only
+ * copies ready bytes out, so an I2C onRequest handler does no sensor
+ * work and no formatting. Each frame before framing:
+ *
+ *   off size field
+ *     0   1  type: 1 samples, 2 command
+ *     1   2  sequence number per type, wraps; a gap is a lost frame
+ *     3   1  count of samples, 1 for a command
+ *     4   4  samples: millis() on the sensor board of the first sample
+ *     8  15  samples: one per count, see below
+ *   end   2  CRC-16/CCITT of everything above
+ *
+ *   sample: time after the first sample (2, ms), heart rate (2, 0.1 BPM),
+ *   SpO2 (2, 0.1 %), temperature (2, signed, 0.01 C), acceleration x, y,
+ *   z (6, signed, cm/s^2), flags (1, TELEMETRY_FLAG_*)
+ *
+ *   command: code (1), value (2)
+ *
+ * Integers are little-endian like telemetry.h. On the wire a frame is
+ * COBS encoded between two 0x00 bytes, so a receiver that starts
+ * mid-stream or loses bytes resynchronises at the next zero, and a lost
+ * delimiter costs one frame, not the one after it as well. Frames that
+ * fail the CRC are dropped and counted; empty frames are padding.
+ */
+
+#ifndef RESCUENET_SENSOR_LINK_H
+#define RESCUENET_SENSOR_LINK_H
+
+#include "hal.h"
+#include "spsc_ring.h"
+#include "telemetry.h"
+
+// Samples per frame
+#ifndef LINK_BATCH_SAMPLES
+#if defined(__AVR__)
+#define LINK_BATCH_SAMPLES 4
+#else
+#define LINK_BATCH_SAMPLES 8
+#endif
+#endif
+
+#define LINK_HEADER_SIZE 8
+#define LINK_SAMPLE_SIZE 15
+#define LINK_COMMAND_SIZE 3
+#define LINK_RAW_MAX (LINK_HEADER_SIZE + LINK_BATCH_SAMPLES * LINK_SAMPLE_SIZE + 2)
+// COBS adds one byte per 254, then the two delimiters
+#define LINK_FRAME_MAX (LINK_RAW_MAX + LINK_RAW_MAX / 254 + 3)
+
+enum LinkFrameType {
+  LINK_FRAME_SAMPLES = 1,
+  LINK_FRAME_COMMAND = 2
+};
+
+enum LinkCommandCode {
+  LINK_COMMAND_PING = 1,
+  LINK_COMMAND_SAMPLE_PERIOD = 2,  // value: ms between samples
+  LINK_COMMAND_BUZZER = 3,         // value: 0 off, 1 on
+  LINK_COMMAND_FLUSH = 4           // send the open batch now
+};
+
+struct LinkSample {
+  uint32_t timestamp;  // millis() on the sensor board
+  float heartRate;
+  float spO2;
+  float temperature;
+  float accelX;  // m/s^2
+  float accelY;
+  float accelZ;
+  uint8_t flags;
+};
+
+struct LinkCommand {
+  uint8_t code;
+  uint16_t value;
+};
+
+struct LinkStats {
+  uint32_t frames;      // Frames passed on
+  uint32_t samples;
+  uint32_t lost;        // Frames missing by sequence number
+  uint32_t badFrames;   // Bad COBS, CRC or layout
+  uint32_t overruns;    // Longer than LINK_FRAME_MAX
+  uint32_t dropped;     // Sender: samples refused while both frame buffers were full
+};
+
+// COBS, without the delimiter. encode writes at most length + length / 254 + 1
+// bytes; decode returns 0 for malformed input and may work in place.
+size_t cobsEncode(const uint8_t* in, size_t length, uint8_t* out);
+size_t cobsDecode(const uint8_t* in, size_t length, uint8_t* out);
+
+// Collects bytes up to each delimiter and checks the frame
+class LinkDecoder {
+public:
+  LinkDecoder();
+
+  // True when byte completed a valid frame; read it before the next feed()
+  bool feed(uint8_t byte, LinkStats& stats);
+
+  uint8_t type() const { return frame[0]; }
+  uint16_t sequence() const;
+  uint8_t count() const { return frame[3]; }
+  const uint8_t* body() const { return frame + 4; }
+  size_t bodyLength() const { return length - 6; }
+
+private:
+  uint8_t frame[LINK_FRAME_MAX];
+  size_t length;  // Of the decoded frame
+  size_t filled;  // Encoded bytes since the last delimiter
+  bool overrun;
+};
+
+// Sensor board side
+class LinkSender {
+public:
+  typedef void (*CommandHandler)(const LinkCommand& command, void* context);
+
+  // batchSamples is capped at LINK_BATCH_SAMPLES
+  explicit LinkSender(uint8_t batchSamples = LINK_BATCH_SAMPLES);
+
+  // Adds to the open batch and seals it when full. False when the
+  // transport has fallen two frames behind and the sample was dropped.
+  bool add(const LinkSample& sample);
+  // Seals the open batch, if any, as a frame of its own
+  bool seal();
+
+  // UART: writes every sealed frame
+  void flush(SerialPort& port);
+  // I2C slave onRequest: copies up to max bytes of sealed frames, padding
+  // with delimiters when there is nothing to send. Safe from an ISR.
+  uint8_t copyReady(uint8_t* out, uint8_t max);
+  // Sealed frames waiting for the transport
+  uint8_t framesReady() const { return (uint8_t)frames.size(); }
+
+  // Commands from the network board; handler runs from receive()
+  void onCommand(CommandHandler handler, void* context);
+  void receive(SerialPort& port);
+  void receive(const uint8_t* data, size_t length);
+
+  // Frames and samples sent, and samples dropped
+  const LinkStats& stats() const { return counters; }
+  // Command frames received, lost and rejected
+  const LinkStats& commandStats() const { return commandCounters; }
+
+private:
+  struct Frame {
+    uint8_t length;
+    uint8_t bytes[LINK_FRAME_MAX];
+  };
+
+  uint8_t batchSamples;
+  uint8_t batch[LINK_RAW_MAX];
+  uint8_t count;
+  uint16_t sequence;
+  SpscRing<Frame, 2> frames;
+  // Owned by the transport: how much of the oldest frame is out
+  volatile uint8_t readPosition;
+
+  LinkDecoder decoder;
+  uint16_t expectedCommand;
+  bool commandSeen;
+  CommandHandler commandHandler;
+  void* commandContext;
+  LinkStats counters;
+  LinkStats commandCounters;
+};
+
+// Network board side
+class LinkReceiver {
+public:
+  typedef void (*SampleHandler)(const LinkSample& sample, void* context);
+
+  LinkReceiver(SampleHandler handler, void* context);
+
+  void poll(SerialPort& port);
+  void feed(const uint8_t* data, size_t length);
+
+  // Sends one command frame; false if the port took fewer bytes
+  bool sendCommand(SerialPort& port, uint8_t code, uint16_t value);
+
+  const LinkStats& stats() const { return counters; }
+
+private:
+  void deliver();
+
+  SampleHandler handler;
+  void* context;
+  LinkDecoder decoder;
+  uint16_t expected;
+  bool seen;
+  uint16_t commandSequence;
+  LinkStats counters;
+};
+
+#endif
@@ -0,0 +1,319 @@
+/*
+ * RescueNet AI - Sensor traces for record and replay
+ */
+
+#include "sensor_trace.h"
+
+#include "crc16.h"
+
+namespace {
+
+const char MAGIC[4] = {'R', 'N', 'T', 'R'};
+const uint8_t PPG_BYTES = 6;
+const uint8_t IMU_BYTES = 12;
+const uint8_t ROM_BYTES = 8;
+
+void put16(uint8_t* out, uint16_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+}
+
+void put24(uint8_t* out, uint32_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+  out[2] = (uint8_t)(value >> 16);
+}
+
+void put32(uint8_t* out, uint32_t value) {
+  put16(out, (uint16_t)value);
+  put16(out + 2, (uint16_t)(value >> 16));
+}
+
+uint16_t get16(const uint8_t* in) {
+  return (uint16_t)(in[0] | in[1] << 8);
+}
+
+uint32_t get24(const uint8_t* in) {
+  return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16;
+}
+
+uint32_t get32(const uint8_t* in) {
+  return (uint32_t)get16(in) | (uint32_t)get16(in + 2) << 16;
+}
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------- writer
+
+TraceWriter::TraceWriter()
+  : lostSince(0), pendingLabel(0), labelTime(0), pendingAlert(false), alertTime(0), have(0) {
+  memset(&counters, 0, sizeof(counters));
+}
+
+void TraceWriter::start(const char* name) {
+  uint8_t payload[32];
+  memcpy(payload, MAGIC, sizeof(MAGIC));
+  payload[4] = TRACE_VERSION;
+  size_t length = strlen(name);
+  if (length > sizeof(payload) - 5) length = sizeof(payload) - 5;
+  memcpy(payload + 5, name, length);
+  record(TRACE_START, micros(), payload, (uint8_t)(5 + length));
+}
+
+void TraceWriter::ppgRate(uint32_t time, uint16_t sampleRateHz, uint8_t averaging) {
+  uint8_t payload[3];
+  put16(payload, sampleRateHz);
+  payload[2] = averaging;
+  record(TRACE_PPG_RATE, time, payload, sizeof(payload));
+}
+
+void TraceWriter::imuRate(uint32_t time, uint16_t sampleRateHz) {
+  uint8_t payload[2];
+  put16(payload, sampleRateHz);
+  record(TRACE_IMU_RATE, time, payload, sizeof(payload));
+}
+
+void TraceWriter::ppg(uint32_t time, const PpgSample* samples, uint8_t count, uint8_t overflowed) {
+  uint8_t payload[1 + TRACE_PPG_PER_RECORD * PPG_BYTES];
+  do {
+    uint8_t n = count < TRACE_PPG_PER_RECORD ? count : TRACE_PPG_PER_RECORD;
+    payload[0] = overflowed;
+    for (uint8_t i = 0; i < n; i++) {
+      put24(payload + 1 + i * PPG_BYTES, samples[i].red);
+      put24(payload + 4 + i * PPG_BYTES, samples[i].ir);
+    }
+    record(TRACE_PPG, time, payload, (uint8_t)(1 + n * PPG_BYTES));
+    samples += n;
+    count -= n;
+    overflowed = 0;
+  } while (count);
+}
+
+void TraceWriter::imu(uint32_t time, const ImuSample* samples, uint8_t count, bool overflowed) {
+  uint8_t payload[1 + TRACE_IMU_PER_RECORD * IMU_BYTES];
+  do {
+    uint8_t n = count < TRACE_IMU_PER_RECORD ? count : TRACE_IMU_PER_RECORD;
+    payload[0] = overflowed ? 1 : 0;
+    for (uint8_t i = 0; i < n; i++) {
+      const ImuSample& s = samples[i];
+      uint8_t* p = payload + 1 + i * IMU_BYTES;
+      put16(p, (uint16_t)s.ax);
+      put16(p + 2, (uint16_t)s.ay);
+      put16(p + 4, (uint16_t)s.az);
+      put16(p + 6, (uint16_t)s.gx);
+      put16(p + 8, (uint16_t)s.gy);
+      put16(p + 10, (uint16_t)s.gz);
+    }
+    record(TRACE_IMU, time, payload, (uint8_t)(1 + n * IMU_BYTES));
+    samples += n;
+    count -= n;
+    overflowed = false;
+  } while (count);
+}
+
+void TraceWriter::tempRoms(uint32_t time, const TempProbeRom* roms, uint8_t count) {
+  uint8_t payload[255 / ROM_BYTES * ROM_BYTES];
+  uint8_t n = 0;
+  for (; n < count && n < sizeof(payload) / ROM_BYTES; n++) {
+    memcpy(payload + n * ROM_BYTES, roms[n].bytes, ROM_BYTES);
+  }
+  record(TRACE_TEMP_ROMS, time, payload, (uint8_t)(n * ROM_BYTES));
+}
+
+void TraceWriter::temp(uint32_t time, const TempProbeRom& rom, bool answered, int16_t sixteenths) {
+  uint8_t payload[ROM_BYTES + 3];
+  memcpy(payload, rom.bytes, ROM_BYTES);
+  payload[ROM_BYTES] = answered ? 1 : 0;
+  put16(payload + ROM_BYTES + 1, (uint16_t)(answered ? sixteenths : 0));
+  record(TRACE_TEMP, time, payload, sizeof(payload));
+}
+
+void TraceWriter::gps(uint32_t time, const uint8_t* bytes, uint8_t length) {
+  if (length) record(TRACE_GPS, time, bytes, length);
+}
+
+void TraceWriter::label(uint8_t label) {
+  labelTime = micros();
+  pendingLabel = label;
+}
+
+void TraceWriter::alert() {
+  alertTime = micros();
+  pendingAlert = true;
+}
+
+bool TraceWriter::record(uint8_t type, uint32_t time, const uint8_t* payload, uint8_t length) {
+  // What the other loop marked goes first, at the time it was marked
+  if (pendingLabel) {
+    uint8_t label = pendingLabel;
+    pendingLabel = 0;
+    record(TRACE_LABEL, labelTime, &label, 1);
+  }
+  if (pendingAlert) {
+    pendingAlert = false;
+    record(TRACE_ALERT, alertTime, nullptr, 0);
+  }
+
+  size_t size = TRACE_HEADER_SIZE + length + 2;
+  if (lostSince) {
+    // Reported once there is room for both
+    if (ring.space() < size + TRACE_HEADER_SIZE + 4 + 2) {
+      lostSince++;
+      counters.lost++;
+      return false;
+    }
+    uint8_t count[4];
+    put32(count, lostSince);
+    lostSince = 0;
+    record(TRACE_LOST, time, count, sizeof(count));
+  }
+  if (ring.space() < size) {
+    lostSince++;
+    counters.lost++;
+    return false;
+  }
+
+  uint8_t header[TRACE_HEADER_SIZE];
+  header[0] = type;
+  header[1] = length;
+  put32(header + 2, time);
+  uint16_t crc = crc16Ccitt(header, sizeof(header));
+  crc = crc16Ccitt(payload, length, crc);
+  for (uint8_t i = 0; i < sizeof(header); i++) ring.push(header[i]);
+  for (uint8_t i = 0; i < length; i++) ring.push(payload[i]);
+  ring.push((uint8_t)crc);
+  ring.push((uint8_t)(crc >> 8));
+  counters.records++;
+  return true;
+}
+
+size_t TraceWriter::drain(Print& output, bool text, size_t maxBytes) {
+  size_t before = counters.bytes;
+  while (counters.bytes - before < maxBytes) {
+    // The header first, for the length, then the rest
+    size_t need = have < 2 ? 2 : TRACE_HEADER_SIZE + out[1] + 2;
+    if (have == need && need > 2) {
+      emit(output, text);
+      have = 0;
+      continue;
+    }
+    if (!ring.pop(out[have])) break;
+    have++;
+  }
+  return counters.bytes - before;
+}
+
+void TraceWriter::emit(Print& output, bool text) {
+  if (!text) {
+    counters.bytes += output.write(out, have);
+    return;
+  }
+  static const char DIGITS[] = "0123456789ABCDEF";
+  // One write per line, so the sketch's own messages land between lines
+  char line[sizeof(TRACE_LINE_PREFIX) + TRACE_RECORD_MAX * 2 + 2];
+  size_t n = sizeof(TRACE_LINE_PREFIX) - 1;
+  memcpy(line, TRACE_LINE_PREFIX, n);
+  for (uint16_t i = 0; i < have; i++) {
+    line[n++] = DIGITS[out[i] >> 4];
+    line[n++] = DIGITS[out[i] & 0x0F];
+  }
+  line[n++] = '\r';
+  line[n++] = '\n';
+  counters.bytes += output.write((const uint8_t*)line, n);
+}
+
+const TraceWriterStats& TraceWriter::stats() const {
+  counters.ringHighWater = (uint16_t)ring.highWaterMark();
+  return counters;
+}
+
+// ---------------------------------------------------------------- reader
+
+TraceReader::TraceReader(const uint8_t* data, size_t length)
+  : data(data), length(length), offset(0), started(false), lastTime(0), elapsedUs(0) {
+  memset(&counters, 0, sizeof(counters));
+}
+
+bool TraceReader::next(TraceRecord& record) {
+  while (offset + TRACE_HEADER_SIZE + 2 <= length) {
+    const uint8_t* p = data + offset;
+    size_t size = TRACE_HEADER_SIZE + p[1] + 2;
+    if (offset + size > length) break;
+    uint16_t crc = crc16Ccitt(p, size - 2);
+    if (p[0] < TRACE_START || p[0] > TRACE_LOST || get16(p + size - 2) != crc) {
+      // Lost bytes on the way: look for the next record one byte on
+      counters.damaged++;
+      offset++;
+      continue;
+    }
+    uint32_t time = get32(p + 2);
+    if (started) elapsedUs += (uint32_t)(time - lastTime);
+    started = true;
+    lastTime = time;
+
+    record.type = p[0];
+    record.length = p[1];
+    record.timeUs = elapsedUs;
+    record.payload = p + TRACE_HEADER_SIZE;
+    offset += size;
+    counters.records++;
+    return true;
+  }
+  counters.truncated = (uint32_t)(length - offset);
+  return false;
+}
+
+uint8_t traceDecodePpg(const TraceRecord& record, PpgSample* out, uint8_t max, uint8_t& overflowed) {
+  if (record.type != TRACE_PPG || record.length < 1) return 0;
+  overflowed = record.payload[0];
+  uint8_t n = 0;
+  for (; n < max && 1 + (n + 1) * PPG_BYTES <= record.length; n++) {
+    out[n].red = get24(record.payload + 1 + n * PPG_BYTES);
+    out[n].ir = get24(record.payload + 4 + n * PPG_BYTES);
+  }
+  return n;
+}
+
+uint8_t traceDecodeImu(const TraceRecord& record, ImuSample* out, uint8_t max, bool& overflowed) {
+  if (record.type != TRACE_IMU || record.length < 1) return 0;
+  overflowed = record.payload[0] != 0;
+  uint8_t n = 0;
+  for (; n < max && 1 + (n + 1) * IMU_BYTES <= record.length; n++) {
+    const uint8_t* p = record.payload + 1 + n * IMU_BYTES;
+    out[n].ax = (int16_t)get16(p);
+    out[n].ay = (int16_t)get16(p + 2);
+    out[n].az = (int16_t)get16(p + 4);
+    out[n].gx = (int16_t)get16(p + 6);
+    out[n].gy = (int16_t)get16(p + 8);
+    out[n].gz = (int16_t)get16(p + 10);
+  }
+  return n;
+}
+
+bool traceDecodeTemp(const TraceRecord& record, TempProbeRom& rom, bool& answered, int16_t& sixteenths) {
+  if (record.type != TRACE_TEMP || record.length < ROM_BYTES + 3) return false;
+  memcpy(rom.bytes, record.payload, ROM_BYTES);
+  answered = record.payload[ROM_BYTES] != 0;
+  sixteenths = (int16_t)get16(record.payload + ROM_BYTES + 1);
+  return true;
+}
+
+size_t traceDecodeLine(const char* hex, size_t length, uint8_t* out, size_t max) {
+  // Line ends and stray spaces are not part of it
+  while (length && (hex[length - 1] == '\r' || hex[length - 1] == '\n' || hex[length - 1] == ' ')) length--;
+  if (length % 2 || length / 2 > max || length / 2 < TRACE_HEADER_SIZE + 2) return 0;
+  for (size_t i = 0; i < length / 2; i++) {
+    int high = hexValue(hex[2 * i]);
+    int low = hexValue(hex[2 * i + 1]);
+    if (high < 0 || low < 0) return 0;
+    out[i] = (uint8_t)(high << 4 | low);
+  }
+  return length / 2;
+}
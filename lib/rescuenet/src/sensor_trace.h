@@ -0,0 +1,184 @@
+/*
+ * RescueNet AI - Sensor traces for record and replay
+ *
+ * What the sensors handed the monitor, with the time it was asked for,
+ * so a stretch of wear can be run again through the detection code on
+ * the host (host/sim/trace_replay.h, host/bench/replay_bench.cpp). The
+ * recorder sits between the monitor and the drivers (trace_recorder.h);
+ * a trace holds each FIFO burst of PPG and IMU samples, each probe read,
+ * the GPS UART bytes, and labels saying when something really happened.
+ * A trace is a run of records, little-endian:
+ *
+ *   off size field
+ *     0   1  type (TraceRecordType)
+ *     1   1  payload length n
+ *     2   4  micros() when the driver was called; the reader unwraps it
+ *     6   n  payload
+ *   6+n   2  CRC-16/CCITT of everything above
+ *
+ *   type              payload
+ *   TRACE_START       "RNTR", version (1), the device's name
+ *   TRACE_PPG_RATE    sample rate Hz (2), averaging (1)
+ *   TRACE_IMU_RATE    sample rate Hz (2)
+ *   TRACE_PPG         samples the FIFO lost (1), then red and IR per
+ *                     sample, 3 bytes each
+ *   TRACE_IMU         1 when the FIFO overflowed (1), then ax ay az gx
+ *                     gy gz per sample, 2 bytes each
+ *   TRACE_TEMP_ROMS   the ROMs a bus search found, 8 bytes each
+ *   TRACE_TEMP        ROM (8), 1 when the probe answered (1), 1/16 C (2)
+ *   TRACE_GPS         UART bytes as they were read
+ *   TRACE_LABEL       TraceLabel: what started at this time
+ *   TRACE_ALERT       none: the device raised an alert
+ *   TRACE_LOST        records there was no room for since the last one (4)
+ *
+ * On a card the records go out as they are. On a console they go out as
+ * lines of TRACE_LINE_PREFIX and the record in hex, so they can share
+ * the port with the sketch's messages and be picked out of a capture.
+ *
+ * TraceWriter queues records in a lock-free ring: the acquisition loop
+ * adds them without waiting, and drain() hands them to the card or the
+ * console from the network loop. A record there is no room for is
+ * counted and reported in a TRACE_LOST record. label() and alert() may
+ * be called from either loop; they go out with the next sensor record.
+ */
+
+#ifndef RESCUENET_SENSOR_TRACE_H
+#define RESCUENET_SENSOR_TRACE_H
+
+#include "hal.h"
+#include "spsc_ring.h"
+
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 6
+#define TRACE_RECORD_MAX (TRACE_HEADER_SIZE + 255 + 2)
+#define TRACE_LINE_PREFIX "@T "
+
+// Samples per record; longer bursts are split
+#define TRACE_PPG_PER_RECORD 42
+#define TRACE_IMU_PER_RECORD 21
+
+// Ring between the loops, a power of two. At 100 Hz PPG and IMU a trace
+// runs at about 2.5 KB/s, so the ESP32's ring covers three seconds of
+// a slow card.
+#ifndef TRACE_RING_BYTES
+#if defined(__AVR__)
+#define TRACE_RING_BYTES 128
+#else
+#define TRACE_RING_BYTES 8192
+#endif
+#endif
+
+enum TraceRecordType {
+  TRACE_START = 1,
+  TRACE_PPG_RATE = 2,
+  TRACE_IMU_RATE = 3,
+  TRACE_PPG = 4,
+  TRACE_IMU = 5,
+  TRACE_TEMP_ROMS = 6,
+  TRACE_TEMP = 7,
+  TRACE_GPS = 8,
+  TRACE_LABEL = 9,
+  TRACE_ALERT = 10,
+  TRACE_LOST = 11
+};
+
+// Ground truth, marked by whoever wears or watches the device
+enum TraceLabel {
+  TRACE_LABEL_FALL = 1,
+  TRACE_LABEL_HEART_RATE = 2,
+  TRACE_LABEL_TEMPERATURE = 3
+};
+
+struct TraceWriterStats {
+  uint32_t records;
+  uint32_t bytes;       // Handed to drain()'s output, framing included
+  uint32_t lost;        // Records the ring had no room for
+  uint16_t ringHighWater;
+};
+
+class TraceWriter {
+public:
+  TraceWriter();
+
+  // Producer side: the acquisition loop, or setup() before it starts.
+  // time is micros() when the driver was called.
+  void start(const char* name);
+  void ppgRate(uint32_t time, uint16_t sampleRateHz, uint8_t averaging);
+  void imuRate(uint32_t time, uint16_t sampleRateHz);
+  void ppg(uint32_t time, const PpgSample* samples, uint8_t count, uint8_t overflowed);
+  void imu(uint32_t time, const ImuSample* samples, uint8_t count, bool overflowed);
+  void tempRoms(uint32_t time, const TempProbeRom* roms, uint8_t count);
+  void temp(uint32_t time, const TempProbeRom& rom, bool answered, int16_t sixteenths);
+  void gps(uint32_t time, const uint8_t* bytes, uint8_t length);
+
+  // Either loop
+  void label(uint8_t label);
+  void alert();
+
+  // Consumer side: writes queued records to out, as they are or as text
+  // lines, until at least maxBytes have gone; returns the bytes written
+  size_t drain(Print& out, bool text, size_t maxBytes);
+  bool idle() const { return ring.empty() && have == 0; }
+
+  const TraceWriterStats& stats() const;
+
+private:
+  bool record(uint8_t type, uint32_t time, const uint8_t* payload, uint8_t length);
+  void emit(Print& out, bool text);
+
+  SpscRing<uint8_t, TRACE_RING_BYTES> ring;
+  uint32_t lostSince;  // Not reported yet
+  volatile uint8_t pendingLabel;
+  volatile uint32_t labelTime;
+  volatile bool pendingAlert;
+  volatile uint32_t alertTime;
+
+  // A record coming out of the ring, taken over several drain() calls
+  // when the producer is still adding it
+  uint8_t out[TRACE_RECORD_MAX];
+  uint16_t have;
+  mutable TraceWriterStats counters;
+};
+
+struct TraceRecord {
+  uint8_t type;
+  uint8_t length;
+  uint64_t timeUs;  // Since the first record
+  const uint8_t* payload;
+};
+
+struct TraceReaderStats {
+  uint32_t records;
+  uint32_t damaged;    // Bytes skipped to find the next good record
+  uint32_t truncated;  // Bytes at the end that were not a whole record
+};
+
+// Walks the records of a binary trace in memory
+class TraceReader {
+public:
+  TraceReader(const uint8_t* data, size_t length);
+
+  // The next record with a good CRC; false at the end
+  bool next(TraceRecord& record);
+  const TraceReaderStats& stats() const { return counters; }
+
+private:
+  const uint8_t* data;
+  size_t length;
+  size_t offset;
+  bool started;
+  uint32_t lastTime;
+  uint64_t elapsedUs;
+  TraceReaderStats counters;
+};
+
+// Payload decoders; each returns how many samples it wrote
+uint8_t traceDecodePpg(const TraceRecord& record, PpgSample* out, uint8_t max, uint8_t& overflowed);
+uint8_t traceDecodeImu(const TraceRecord& record, ImuSample* out, uint8_t max, bool& overflowed);
+bool traceDecodeTemp(const TraceRecord& record, TempProbeRom& rom, bool& answered, int16_t& sixteenths);
+
+// Hex digits of one line (without TRACE_LINE_PREFIX) back to the record;
+// returns its length, 0 when the line is not one
+size_t traceDecodeLine(const char* hex, size_t length, uint8_t* out, size_t max);
+
+#endif
@@ -0,0 +1,212 @@
+/*
+ * RescueNet AI - SIM800L GSM modem (SMS alerts)
+ */
+
+#include "sim800l.h"
+
+#include <stdlib.h>
+
+#include "text_format.h"
+
+namespace {
+
+const char* const CONFIG_COMMANDS[] = {
+  "ATE0",                // No echo
+  "AT+CMGF=1",           // SMS text mode
+  "AT+CSCS=\"GSM\"",     // Character set
+  "AT+CNMI=2,1,0,0,0",   // Announce new messages with +CMTI
+  "AT+CREG=1",           // Announce registration changes with +CREG
+  "AT+CREG?",            // Network registration
+  "AT+CSQ"               // Signal strength
+};
+const uint8_t CONFIG_COUNT = sizeof(CONFIG_COMMANDS) / sizeof(CONFIG_COMMANDS[0]);
+
+// Last comma separated number on a line ("+CREG: 0,1" -> 1, "+CREG: 5" -> 5)
+int lastNumber(const char* line) {
+  const char* comma = strrchr(line, ',');
+  const char* colon = strchr(line, ':');
+  const char* start = comma ? comma + 1 : (colon ? colon + 1 : line);
+  return atoi(start);
+}
+
+}  // namespace
+
+Sim800l::Sim800l(SerialPort& port, uint8_t powerPin, uint8_t resetPin)
+  : at(port), powerPin(powerPin), resetPin(resetPin), ready(false), step(OFF), stepStart(0), stepWait(0),
+    configIndex(0), lastSignalCheck(0), regStatus(SIM800L_REG_UNKNOWN), rssi(99), incoming(0),
+    lastIncomingIndex(-1), smsInFlight(false), smsDone(nullptr), smsContext(nullptr) {
+  at.onUrc(onUrc, this);
+}
+
+void Sim800l::begin() {
+  LOG_PORT.println("Initializing SIM800L GSM Module...");
+  ready = false;
+  at.clear();
+
+  // Power cycle SIM800L
+  digitalWrite(powerPin, LOW);
+  enter(POWER_LOW, 1000);
+}
+
+void Sim800l::enter(Step next, unsigned long waitMs) {
+  step = next;
+  stepStart = millis();
+  stepWait = waitMs;
+}
+
+void Sim800l::poll() {
+  at.poll();
+
+  switch (step) {
+    case POWER_LOW:
+      if (!expired()) break;
+      digitalWrite(powerPin, HIGH);
+      enter(POWER_HIGH, 2000);
+      break;
+
+    case POWER_HIGH:
+      if (!expired()) break;
+      // Reset SIM800L
+      digitalWrite(resetPin, LOW);
+      enter(RESET_LOW, 100);
+      break;
+
+    case RESET_LOW:
+      if (!expired()) break;
+      digitalWrite(resetPin, HIGH);
+      // Boot plus letting the UART settle after the reset
+      enter(RESET_SETTLE, 6000);
+      break;
+
+    case RESET_SETTLE:
+      if (!expired()) break;
+      // Check if SIM800L is responsive
+      enter(STARTING, 0);
+      at.send("AT", onProbe, this);
+      break;
+
+    case IDLE:
+      // Check signal strength periodically
+      if (millis() - lastSignalCheck > SIM800L_STATUS_INTERVAL_MS && at.idle()) {
+        lastSignalCheck = millis();
+        at.send("AT+CSQ", onSignal, this);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+void Sim800l::onProbe(const AtResult& result, void* self) {
+  Sim800l* modem = static_cast<Sim800l*>(self);
+  if (result.status != AT_OK) {
+    LOG_PORT.println(result.status == AT_TIMEOUT ? "SIM800L: No response" : "SIM800L: Failed to respond");
+    modem->enter(OFF, 0);
+    return;
+  }
+  LOG_PORT.println("SIM800L: Connected successfully");
+  LOG_PORT.println("Configuring SMS settings...");
+  modem->configIndex = 0;
+  modem->at.send(CONFIG_COMMANDS[0], onConfig, modem);
+}
+
+void Sim800l::onConfig(const AtResult& result, void* self) {
+  // Like the old fixed delays, a refused setting does not stop the setup
+  Sim800l* modem = static_cast<Sim800l*>(self);
+  if (result.info[0]) {
+    modem->parseRegistration(result.info);
+    modem->parseSignal(result.info);
+  }
+  if (++modem->configIndex < CONFIG_COUNT) {
+    modem->at.send(CONFIG_COMMANDS[modem->configIndex], onConfig, modem);
+    return;
+  }
+  LOG_PORT.println("SMS configuration complete");
+  modem->ready = true;
+  modem->lastSignalCheck = millis();
+  modem->enter(IDLE, 0);
+}
+
+void Sim800l::onSignal(const AtResult& result, void* self) {
+  if (result.status != AT_OK) return;
+  static_cast<Sim800l*>(self)->parseSignal(result.info);
+  LOG_PORT.print("Signal strength: ");
+  LOG_PORT.println(result.info);
+}
+
+void Sim800l::parseRegistration(const char* line) {
+  if (strncmp(line, "+CREG:", 6) == 0) regStatus = (uint8_t)lastNumber(line);
+}
+
+void Sim800l::parseSignal(const char* line) {
+  // "+CSQ: <rssi>,<ber>"
+  if (strncmp(line, "+CSQ:", 5) == 0) rssi = (uint8_t)atoi(line + 5);
+}
+
+void Sim800l::onUrc(const char* line, void* self) {
+  Sim800l* modem = static_cast<Sim800l*>(self);
+  if (strncmp(line, "+CMTI:", 6) == 0) {
+    // +CMTI: "SM",<index>
+    modem->incoming++;
+    modem->lastIncomingIndex = (int16_t)lastNumber(line);
+    LOG_PORT.print("SMS received, index ");
+    LOG_PORT.println(modem->lastIncomingIndex);
+  } else if (strncmp(line, "+CREG:", 6) == 0) {
+    modem->parseRegistration(line);
+    LOG_PORT.print("Network registration: ");
+    LOG_PORT.println(modem->regStatus);
+  } else if (strncmp(line, "NORMAL POWER DOWN", 17) == 0 || strncmp(line, "UNDER-VOLTAGE", 13) == 0) {
+    LOG_PORT.println("SIM800L powered down");
+    modem->ready = false;
+    modem->enter(OFF, 0);
+  }
+}
+
+bool Sim800l::sendSMS(const char* phoneNumber, const char* message, SmsCallback done, void* context) {
+  if (!ready) {
+    LOG_PORT.println("SIM800L not ready");
+    return false;
+  }
+  if (smsInFlight) {
+    LOG_PORT.println("SIM800L busy with another SMS");
+    return false;
+  }
+
+  LOG_PORT.print("Sending SMS to: ");
+  LOG_PORT.println(phoneNumber);
+  LOG_PORT.print("Message: ");
+  LOG_PORT.println(message);
+  // Set SMS recipient; the text and Ctrl+Z go out on the '>' prompt
+  TextWriter command(smsCommand, sizeof(smsCommand));
+  command.add("AT+CMGS=\"").add(phoneNumber).add('"');
+  if (command.truncated()) {
+    LOG_PORT.println("Phone number too long");
+    return false;
+  }
+  TextWriter text(smsText, sizeof(smsText));
+  text.add(message);
+  smsDone = done;
+  smsContext = context;
+  if (!at.sendWithPayload(smsCommand, smsText, SIM800L_PROMPT_TIMEOUT_MS,
+                          SIM800L_SMS_TIMEOUT_MS, onSms, this)) {
+    LOG_PORT.println("Failed to send SMS");
+    return false;
+  }
+  smsInFlight = true;
+  return true;
+}
+
+void Sim800l::onSms(const AtResult& result, void* self) {
+  Sim800l* modem = static_cast<Sim800l*>(self);
+  bool sent = result.status == AT_OK;
+  if (result.info[0]) {
+    LOG_PORT.print("SMS Response: ");
+    LOG_PORT.println(result.info);
+  }
+  LOG_PORT.println(sent ? "SMS sent successfully" : "Failed to send SMS");
+  modem->smsInFlight = false;
+  SmsCallback done = modem->smsDone;
+  modem->smsDone = nullptr;
+  if (done) done(sent, modem->smsContext);
+}
@@ -0,0 +1,104 @@
+/*
+ * RescueNet AI - SIM800L GSM modem (SMS alerts)
+ *
+ * AT command sequences from the original esp32_enhanced.ino, driven over
+ * the SerialPort HAL so they can run against a scripted modem on the host.
+ *
+ * Nothing here waits: begin() only starts the power cycle and poll()
+ * carries it out, then hands every exchange to the AT engine, which
+ * moves on as soon as the modem answers. Unsolicited results keep the
+ * network registration (+CREG) and incoming message (+CMTI) state
+ * current. Call poll() every few tens of ms.
+ */
+
+#ifndef RESCUENET_SIM800L_H
+#define RESCUENET_SIM800L_H
+
+#include "at_engine.h"
+
+// The '>' prompt after AT+CMGS and the final result after Ctrl+Z
+#define SIM800L_PROMPT_TIMEOUT_MS 5000
+#define SIM800L_SMS_TIMEOUT_MS 60000
+#define SIM800L_STATUS_INTERVAL_MS 60000
+
+// Longest message sendSMS() keeps; longer text is cut off
+#ifndef SIM800L_SMS_MAX
+#define SIM800L_SMS_MAX 255
+#endif
+#define SIM800L_NUMBER_MAX 20
+
+// +CREG <stat> values
+#define SIM800L_REG_NONE 0
+#define SIM800L_REG_HOME 1
+#define SIM800L_REG_SEARCHING 2
+#define SIM800L_REG_DENIED 3
+#define SIM800L_REG_ROAMING 5
+#define SIM800L_REG_UNKNOWN 0xFF
+
+class Sim800l {
+public:
+  typedef void (*SmsCallback)(bool sent, void* context);
+
+  Sim800l(SerialPort& port, uint8_t powerPin, uint8_t resetPin);
+
+  // Starts the power cycle, "AT" probe and SMS setup (~10 s of poll() calls)
+  void begin();
+  void poll();
+
+  // Queues one message; done runs from poll() with the outcome. False when
+  // the modem is not ready or another message is still in flight. Both
+  // strings are copied.
+  bool sendSMS(const char* phoneNumber, const char* message, SmsCallback done = nullptr,
+               void* context = nullptr);
+
+  bool isReady() const { return ready; }
+  bool smsPending() const { return smsInFlight; }
+
+  uint8_t registration() const { return regStatus; }
+  bool registered() const { return regStatus == SIM800L_REG_HOME || regStatus == SIM800L_REG_ROAMING; }
+  // +CSQ rssi: 0-31, 99 when unknown
+  uint8_t signalQuality() const { return rssi; }
+  // Messages announced by +CMTI and the storage index of the last one
+  uint16_t messagesReceived() const { return incoming; }
+  int16_t lastMessageIndex() const { return lastIncomingIndex; }
+
+  const AtStats& atStats() const { return at.stats(); }
+
+private:
+  enum Step { OFF, POWER_LOW, POWER_HIGH, RESET_LOW, RESET_SETTLE, STARTING, IDLE };
+
+  void enter(Step next, unsigned long waitMs);
+  bool expired() const { return millis() - stepStart >= stepWait; }
+  void parseRegistration(const char* line);
+  void parseSignal(const char* line);
+
+  static void onProbe(const AtResult& result, void* self);
+  static void onConfig(const AtResult& result, void* self);
+  static void onSignal(const AtResult& result, void* self);
+  static void onSms(const AtResult& result, void* self);
+  static void onUrc(const char* line, void* self);
+
+  AtEngine at;
+  uint8_t powerPin;
+  uint8_t resetPin;
+  bool ready;
+  Step step;
+  unsigned long stepStart;
+  unsigned long stepWait;
+  uint8_t configIndex;
+  unsigned long lastSignalCheck;
+
+  uint8_t regStatus;
+  uint8_t rssi;
+  uint16_t incoming;
+  int16_t lastIncomingIndex;
+
+  bool smsInFlight;
+  // AT+CMGS="<number>"
+  char smsCommand[10 + SIM800L_NUMBER_MAX + 1];
+  char smsText[SIM800L_SMS_MAX + 1];
+  SmsCallback smsDone;
+  void* smsContext;
+};
+
+#endif
@@ -0,0 +1,226 @@
+/*
+ * RescueNet AI - Spectral heart rate estimator
+ */
+
+#include "spectral_hr.h"
+
+#if SPECTRAL_HR_ENABLED
+
+#include <math.h>
+#include <string.h>
+
+#ifndef SPECTRAL_HR_ESP_DSP
+#if defined(ESP_PLATFORM) && defined(__has_include)
+#if __has_include(<esp_dsp.h>)
+#define SPECTRAL_HR_ESP_DSP 1
+#endif
+#endif
+#endif
+#ifndef SPECTRAL_HR_ESP_DSP
+#define SPECTRAL_HR_ESP_DSP 0
+#endif
+
+#if SPECTRAL_HR_ESP_DSP
+#include <esp_dsp.h>
+#endif
+
+static_assert((SPECTRAL_HR_FFT_SIZE & (SPECTRAL_HR_FFT_SIZE - 1)) == 0, "SPECTRAL_HR_FFT_SIZE must be a power of two");
+static_assert(SPECTRAL_HR_MAX_WINDOW <= SPECTRAL_HR_FFT_SIZE, "The window must fit the FFT");
+
+namespace {
+
+const float PI_F = 3.14159265358979f;
+// Complex points of the half-size FFT
+const uint16_t POINTS = SPECTRAL_HR_FFT_SIZE / 2;
+const uint16_t BINS = SPECTRAL_HR_FFT_SIZE / 4;
+
+}  // namespace
+
+SpectralHeartRate::SpectralHeartRate()
+  : inputRate(0), decimation(1), window(SPECTRAL_HR_MAX_WINDOW), hop(SPECTRAL_HR_RATE_HZ) {
+  for (uint16_t k = 0; k < BINS; k++) {
+    cosTable[k] = cosf(2 * PI_F * k / POINTS);
+    sinTable[k] = sinf(2 * PI_F * k / POINTS);
+  }
+#if SPECTRAL_HR_ESP_DSP
+  // Its own twiddle table; a second init (another instance) is harmless
+  dsps_fft2r_init_fc32(nullptr, POINTS);
+#endif
+  setSampleRate(100);
+}
+
+void SpectralHeartRate::setSampleRate(uint16_t sampleRateHz) {
+  uint16_t previous = inputRate / decimation;
+  inputRate = sampleRateHz ? sampleRateHz : 1;
+  uint16_t factor = inputRate / SPECTRAL_HR_RATE_HZ;
+  decimation = factor < 1 ? 1 : factor > 255 ? 255 : (uint8_t)factor;
+  decimated = 0;
+  decimateSum = 0;
+  // The window holds decimated samples: still good at the same output rate
+  if (inputRate / decimation != previous) reset();
+}
+
+bool SpectralHeartRate::configure(uint16_t windowSamples, uint16_t hopSamples) {
+  if (windowSamples < 16 || windowSamples > SPECTRAL_HR_MAX_WINDOW) return false;
+  if (hopSamples == 0 || hopSamples > windowSamples) return false;
+  window = windowSamples;
+  hop = hopSamples;
+  reset();
+  return true;
+}
+
+void SpectralHeartRate::reset() {
+  decimated = 0;
+  decimateSum = 0;
+  ringSum = 0;
+  head = 0;
+  filled = 0;
+  sinceHop = 0;
+  rate = 0;
+  score = 0;
+  transformCount = 0;
+}
+
+bool SpectralHeartRate::addSample(int32_t sample) {
+  decimateSum += sample;
+  if (++decimated < decimation) return false;
+  int32_t value = decimateSum / decimation;
+  decimated = 0;
+  decimateSum = 0;
+
+  if (filled == window) {
+    ringSum -= ring[head];
+  } else {
+    filled++;
+  }
+  ring[head] = value;
+  ringSum += value;
+  head = head + 1 == window ? 0 : head + 1;
+
+  if (++sinceHop < hop || filled < window) return false;
+  sinceHop = 0;
+  transform();
+  return true;
+}
+
+void SpectralHeartRate::transform() {
+  // The window, oldest first, straight out of the ring: real samples in
+  // the even/odd slots of the complex buffer, zero padding after it
+  float mean = (float)ringSum / window;
+  uint16_t at = head;  // Oldest
+  for (uint16_t n = 0; n < window; n++) {
+    float hann = 0.5f - 0.5f * cosf(2 * PI_F * n / (window - 1));
+    buffer[n] = ((float)ring[at] - mean) * hann;
+    at = at + 1 == window ? 0 : at + 1;
+  }
+  memset(buffer + window, 0, (SPECTRAL_HR_FFT_SIZE - window) * sizeof(float));
+
+  fft(buffer, POINTS);
+
+  float binBpm = 60.0f * outputRateHz() / SPECTRAL_HR_FFT_SIZE;
+  uint16_t low = (uint16_t)(SPECTRAL_HR_MIN_BPM / binBpm);
+  uint16_t high = (uint16_t)(SPECTRAL_HR_MAX_BPM / binBpm) + 1;
+  if (high > POINTS - 2) high = POINTS - 2;
+  // Half the Hann main lobe, in zero-padded bins
+  uint16_t lobe = 2 * SPECTRAL_HR_FFT_SIZE / window;
+  uint16_t last = SPECTRAL_HR_HARMONICS * high + lobe;
+  if (last > POINTS - 1) last = POINTS - 1;
+
+  // Real spectrum X[k] = E[k] + W^k O[k] from Z[k] and Z[M - k], for the
+  // band and its harmonics; W^k by rotation, not a sine per bin
+  float stepR = cosf(PI_F / POINTS), stepI = -sinf(PI_F / POINTS);
+  float wr = 1, wi = 0;
+  for (uint16_t k = 1; k <= last; k++) {
+    float nextR = wr * stepR - wi * stepI;
+    wi = wr * stepI + wi * stepR;
+    wr = nextR;
+    float zr = buffer[2 * k], zi = buffer[2 * k + 1];
+    float cr = buffer[2 * (POINTS - k)], ci = -buffer[2 * (POINTS - k) + 1];
+    float er = (zr + cr) / 2, ei = (zi + ci) / 2;
+    // O = (Z - conj Z[M-k]) / 2j
+    float or_ = (zi - ci) / 2, oi = -(zr - cr) / 2;
+    float xr = er + wr * or_ - wi * oi;
+    float xi = ei + wr * oi + wi * or_;
+    power[k] = xr * xr + xi * xi;
+  }
+
+  // The pulse is no sine: the rate is the bin whose harmonics together
+  // are strongest, not the strongest bin, which may be the second harmonic
+  float total = 0;
+  for (uint16_t k = low; k <= last; k++) total += power[k];
+  if (total <= 0) return;
+  uint16_t peak = low;
+  float best = 0;
+  for (uint16_t k = low; k <= high; k++) {
+    float sum = 0;
+    for (uint8_t h = 1; h <= SPECTRAL_HR_HARMONICS && h * k <= last; h++) sum += power[h * k];
+    if (sum > best) {
+      best = sum;
+      peak = k;
+    }
+  }
+
+  // Parabola through the log magnitudes around the peak
+  float offset = 0;
+  if (peak > 1 && power[peak - 1] > 0 && power[peak + 1] > 0) {
+    float a = logf(power[peak - 1]), b = logf(power[peak]), c = logf(power[peak + 1]);
+    float denominator = a - 2 * b + c;
+    if (denominator < 0) offset = 0.5f * (a - c) / denominator;
+  }
+  rate = (peak + offset) * binBpm;
+
+  // Quality: the share of the power in the main lobes of those harmonics
+  float around = 0;
+  uint16_t from = low;
+  for (uint8_t h = 1; h <= SPECTRAL_HR_HARMONICS; h++) {
+    uint16_t centre = h * peak;
+    uint16_t lo = centre > lobe ? centre - lobe : 0;
+    if (lo < from) lo = from;
+    uint16_t hi = centre + lobe < last ? centre + lobe : last;
+    for (uint16_t k = lo; k <= hi; k++) around += power[k];
+    from = hi + 1;
+  }
+  float share = around / total;
+  score = (uint8_t)(share >= 1 ? 100 : share * 100 + 0.5f);
+  transformCount++;
+}
+
+void SpectralHeartRate::fft(float* data, uint16_t points) {
+#if SPECTRAL_HR_ESP_DSP
+  dsps_fft2r_fc32(data, points);
+  dsps_bit_rev_fc32(data, points);
+#else
+  // Bit reversal, then radix-2 butterflies in place
+  for (uint16_t i = 1, j = 0; i < points; i++) {
+    uint16_t bit = points >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      float tr = data[2 * i], ti = data[2 * i + 1];
+      data[2 * i] = data[2 * j];
+      data[2 * i + 1] = data[2 * j + 1];
+      data[2 * j] = tr;
+      data[2 * j + 1] = ti;
+    }
+  }
+  for (uint16_t length = 2; length <= points; length <<= 1) {
+    uint16_t half = length / 2;
+    uint16_t stride = points / length;
+    for (uint16_t start = 0; start < points; start += length) {
+      for (uint16_t j = 0; j < half; j++) {
+        float wr = cosTable[j * stride], wi = -sinTable[j * stride];
+        float* a = data + 2 * (start + j);
+        float* b = data + 2 * (start + j + half);
+        float tr = b[0] * wr - b[1] * wi;
+        float ti = b[0] * wi + b[1] * wr;
+        b[0] = a[0] - tr;
+        b[1] = a[1] - ti;
+        a[0] += tr;
+        a[1] += ti;
+      }
+    }
+  }
+#endif
+}
+
+#endif  // SPECTRAL_HR_ENABLED
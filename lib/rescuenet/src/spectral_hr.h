@@ -0,0 +1,118 @@
+/*
+ * RescueNet AI - Spectral heart rate estimator
+ *
+ * The beat detector times single pulses; this finds the pulse rate as the
+ * strongest frequency of the last several seconds of PPG, which holds up
+ * where single beats are hard to pick (weak perfusion, noise, an odd
+ * extra or missed beat). Too big for the Nano; the ESP32 and the host
+ * have the RAM and the floating point:
+ *
+ *   1. decimate   the PPG samples are box-averaged down to
+ *                 SPECTRAL_HR_RATE_HZ (4:1 at 100 Hz) and written into a
+ *                 window ring, with a running sum for its mean. The ring
+ *                 is never shifted.
+ *   2. transform  every hop, the window is read out of the ring in place
+ *                 (oldest first, mean removed, Hann weighted) into a
+ *                 zero-padded SPECTRAL_HR_FFT_SIZE real FFT: a complex
+ *                 FFT of half the size on the even/odd pairs, split into
+ *                 the real spectrum for the bins of the heart rate band
+ *                 only. ESP-DSP runs the complex FFT where it is
+ *                 installed; the portable radix-2 kernel elsewhere.
+ *   3. pick       the bin between SPECTRAL_HR_MIN_BPM and
+ *                 SPECTRAL_HR_MAX_BPM whose first SPECTRAL_HR_HARMONICS
+ *                 harmonics carry the most power together (a pulse is
+ *                 rich in harmonics; the second can outweigh the first),
+ *                 refined by a parabola through the log magnitudes
+ *                 around it.
+ *
+ * Per sample that is an add and a store; the FFT runs once per hop. The
+ * window sets the latency (a rate change shows after about half of it)
+ * and the resolution, the hop how often the estimate moves.
+ *
+ * quality() is 0..100, the share of the power from the band up that sits
+ * in the main lobes of the rate's harmonics.
+ */
+
+#ifndef RESCUENET_SPECTRAL_HR_H
+#define RESCUENET_SPECTRAL_HR_H
+
+#include <stdint.h>
+
+// The Nano has 2 KB of RAM in all
+#ifndef SPECTRAL_HR_ENABLED
+#if defined(__AVR__)
+#define SPECTRAL_HR_ENABLED 0
+#else
+#define SPECTRAL_HR_ENABLED 1
+#endif
+#endif
+
+#if SPECTRAL_HR_ENABLED
+
+#ifndef SPECTRAL_HR_RATE_HZ
+#define SPECTRAL_HR_RATE_HZ 25
+#endif
+#ifndef SPECTRAL_HR_MAX_WINDOW
+#define SPECTRAL_HR_MAX_WINDOW 256  // 10.24 s at 25 Hz
+#endif
+#ifndef SPECTRAL_HR_FFT_SIZE
+#define SPECTRAL_HR_FFT_SIZE 1024   // Zero-padded: 1.46 BPM bins at 25 Hz
+#endif
+#define SPECTRAL_HR_MIN_BPM 35
+#define SPECTRAL_HR_MAX_BPM 220
+#define SPECTRAL_HR_HARMONICS 3
+
+class SpectralHeartRate {
+public:
+  SpectralHeartRate();
+
+  // Input rate; the decimation is rate / SPECTRAL_HR_RATE_HZ, at least 1.
+  // The window is kept when the decimated rate stays the same.
+  void setSampleRate(uint16_t sampleRateHz);
+  // Window and hop in decimated samples; false when out of range
+  bool configure(uint16_t windowSamples, uint16_t hopSamples);
+  void reset();
+
+  // Feed one raw sample; returns true when the estimate was updated
+  bool addSample(int32_t sample);
+
+  // BPM, 0 until the first full window
+  float heartRate() const { return rate; }
+  uint8_t quality() const { return score; }
+  uint32_t transforms() const { return transformCount; }
+  // Decimated samples per second
+  float outputRateHz() const { return (float)inputRate / decimation; }
+
+private:
+  void transform();
+  void fft(float* data, uint16_t points);
+
+  // Decimation
+  uint16_t inputRate;
+  uint8_t decimation;
+  uint8_t decimated;
+  int32_t decimateSum;
+
+  // Window ring and its running sum
+  int32_t ring[SPECTRAL_HR_MAX_WINDOW];
+  int64_t ringSum;
+  uint16_t window;
+  uint16_t hop;
+  uint16_t head;
+  uint16_t filled;
+  uint16_t sinceHop;
+
+  // Interleaved complex working buffer and the twiddles of its FFT
+  float buffer[SPECTRAL_HR_FFT_SIZE];
+  float cosTable[SPECTRAL_HR_FFT_SIZE / 4];
+  float sinTable[SPECTRAL_HR_FFT_SIZE / 4];
+  float power[SPECTRAL_HR_FFT_SIZE / 2];  // Bins up to Nyquist
+
+  float rate;
+  uint8_t score;
+  uint32_t transformCount;
+};
+
+#endif  // SPECTRAL_HR_ENABLED
+
+#endif
@@ -0,0 +1,170 @@
+/*
+ * RescueNet AI - Streaming SpO2 estimator
+ */
+
+#include "spo2_estimator.h"
+
+#include <string.h>
+
+namespace {
+
+// DC tracker time constant: 1/64 per sample, ~0.6 s at 100 Hz
+const uint8_t DC_SHIFT = 6;
+
+// Plausible ratio-of-ratios range in Q10 (R 0.2 .. 3.0)
+const uint16_t RATIO_MIN_Q10 = 205;
+const uint16_t RATIO_MAX_Q10 = 3072;
+
+uint16_t isqrt32(uint32_t value) {
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > value) bit >>= 2;
+  while (bit) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint16_t)root;
+}
+
+}  // namespace
+
+Spo2Estimator::Spo2Estimator(uint16_t sampleRateHz) {
+  setSampleRate(sampleRateHz);
+  reset();
+}
+
+void Spo2Estimator::setSampleRate(uint16_t sampleRateHz) {
+  // Accept pulses between 240 and 30 BPM
+  minCycleSamples = sampleRateHz / 4;
+  maxCycleSamples = sampleRateHz * 2;
+}
+
+void Spo2Estimator::reset() {
+  dcRedQ8 = 0;
+  dcIrQ8 = 0;
+  primed = false;
+  redMax = irMax = INT32_MIN;
+  redMin = irMin = INT32_MAX;
+  lastIrP2p = 0;
+  armed = false;
+  cycleSamples = 0;
+  memset(window, 0, sizeof(window));
+  windowHead = 0;
+  windowCount = 0;
+  ratioSum = 0;
+  ratioSquareSum = 0;
+  spo2Tenths = 0;
+  perfusionBp = 0;
+  qualityScore = 0;
+  cycleCount = 0;
+  rejectedCount = 0;
+}
+
+bool Spo2Estimator::addSample(uint32_t red, uint32_t ir) {
+  int32_t redQ8 = (int32_t)(red & 0x3FFFF) << 8;
+  int32_t irQ8 = (int32_t)(ir & 0x3FFFF) << 8;
+  if (!primed) {
+    dcRedQ8 = redQ8;
+    dcIrQ8 = irQ8;
+    primed = true;
+  }
+
+  dcRedQ8 += (redQ8 - dcRedQ8) >> DC_SHIFT;
+  dcIrQ8 += (irQ8 - dcIrQ8) >> DC_SHIFT;
+  int32_t redAc = (redQ8 - dcRedQ8) >> 8;
+  int32_t irAc = (irQ8 - dcIrQ8) >> 8;
+
+  if (redAc > redMax) redMax = redAc;
+  if (redAc < redMin) redMin = redAc;
+  if (irAc > irMax) irMax = irAc;
+  if (irAc < irMin) irMin = irAc;
+  cycleSamples++;
+
+  // A cycle ends on the systolic upstroke: IR AC rises through half the
+  // previous peak-to-peak after having been below baseline. The level sits
+  // above the dicrotic wave, so that does not split a cycle.
+  if (irAc < 0) armed = true;
+  int32_t trigger = lastIrP2p / 2;
+  if (armed && irAc > trigger && cycleSamples >= minCycleSamples) {
+    endCycle();
+    return true;
+  }
+  if (cycleSamples > maxCycleSamples) {
+    // No pulse for too long (motion, finger lifted): start over
+    rejectedCount++;
+    lastIrP2p = 0;
+    startCycle();
+  }
+  return false;
+}
+
+void Spo2Estimator::startCycle() {
+  redMax = irMax = INT32_MIN;
+  redMin = irMin = INT32_MAX;
+  armed = false;
+  cycleSamples = 0;
+}
+
+void Spo2Estimator::endCycle() {
+  cycleCount++;
+  int32_t redP2p = redMax - redMin;
+  int32_t irP2p = irMax - irMin;
+  uint32_t dcRed = (uint32_t)(dcRedQ8 >> 8);
+  uint32_t dcIr = (uint32_t)(dcIrQ8 >> 8);
+  lastIrP2p = irP2p;
+  startCycle();
+
+  if (redP2p <= 0 || irP2p <= 0 || dcRed == 0 || dcIr == 0) {
+    rejectedCount++;
+    return;
+  }
+
+  perfusionBp = (uint16_t)((uint32_t)irP2p * 10000UL / dcIr);
+
+  // Once per pulse, so the 64-bit divide is affordable even on AVR
+  uint64_t num = (uint64_t)(uint32_t)redP2p * dcIr * 1024ULL;
+  uint64_t den = (uint64_t)(uint32_t)irP2p * dcRed;
+  uint32_t ratio = (uint32_t)(num / den);
+  if (ratio < RATIO_MIN_Q10 || ratio > RATIO_MAX_Q10) {
+    rejectedCount++;
+    return;
+  }
+
+  if (windowCount == SPO2_WINDOW_BEATS) {
+    uint16_t oldest = window[windowHead];
+    ratioSum -= oldest;
+    ratioSquareSum -= (uint32_t)oldest * oldest;
+  } else {
+    windowCount++;
+  }
+  window[windowHead] = (uint16_t)ratio;
+  windowHead = (uint8_t)((windowHead + 1) % SPO2_WINDOW_BEATS);
+  ratioSum += ratio;
+  ratioSquareSum += ratio * ratio;
+
+  // SpO2 = 110 - 25 R, in tenths of a percent
+  int32_t tenths = 1100 - (int32_t)((250UL * ratioQ10() + 512) / 1024);
+  if (tenths < 0) tenths = 0;
+  if (tenths > 1000) tenths = 1000;
+  spo2Tenths = (uint16_t)tenths;
+
+  updateQuality();
+}
+
+void Spo2Estimator::updateQuality() {
+  uint32_t mean = ratioSum / windowCount;
+  uint32_t meanSquare = ratioSquareSum / windowCount;
+  uint32_t variance = meanSquare > mean * mean ? meanSquare - mean * mean : 0;
+  uint32_t cvPercent = mean ? (uint32_t)isqrt32(variance) * 100UL / mean : 100;
+
+  // 20 % ratio spread across the window means the readings are noise
+  uint8_t consistency = cvPercent >= 20 ? 0 : (uint8_t)(100 - cvPercent * 5);
+  uint8_t perfusion = perfusionBp >= SPO2_GOOD_PERFUSION_BP
+                        ? 100 : (uint8_t)(perfusionBp * 100UL / SPO2_GOOD_PERFUSION_BP);
+  qualityScore = consistency < perfusion ? consistency : perfusion;
+}
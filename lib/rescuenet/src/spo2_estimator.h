@@ -0,0 +1,88 @@
+/*
+ * RescueNet AI - Streaming SpO2 estimator
+ *
+ * Ratio-of-ratios pulse oximetry on paired red/IR samples, in integer
+ * arithmetic so the same code runs on the Nano:
+ *
+ *   - DC of each channel tracked by a first-order IIR (Q8 state)
+ *   - AC peak-to-peak tracked as running min/max inside each pulse
+ *     cycle; a cycle ends on the next systolic upstroke of the IR AC
+ *   - per cycle R = (ACred / DCred) / (ACir / DCir) in Q10
+ *   - R averaged over the last SPO2_WINDOW_BEATS cycles with a running
+ *     sum, SpO2 = 110 - 25 R (the usual empirical calibration)
+ *
+ * Every sample costs a fixed handful of adds, shifts and compares; the
+ * divisions happen once per pulse. Nothing re-scans the window.
+ *
+ * quality() is 0..100: the lower of a perfusion score (IR AC/DC) and a
+ * consistency score (coefficient of variation of R across the window).
+ * Alerting should ignore SpO2 readings with low quality.
+ */
+
+#ifndef RESCUENET_SPO2_ESTIMATOR_H
+#define RESCUENET_SPO2_ESTIMATOR_H
+
+#include <stdint.h>
+
+#ifndef SPO2_WINDOW_BEATS
+#define SPO2_WINDOW_BEATS 4
+#endif
+
+// Perfusion index (basis points of IR AC/DC) that earns a full perfusion score
+#define SPO2_GOOD_PERFUSION_BP 50
+
+class Spo2Estimator {
+public:
+  explicit Spo2Estimator(uint16_t sampleRateHz = 100);
+
+  void reset();
+  void setSampleRate(uint16_t sampleRateHz);
+
+  // Feed one red/IR pair; returns true when a pulse cycle completed
+  bool addSample(uint32_t red, uint32_t ir);
+
+  // True once the window holds SPO2_WINDOW_BEATS usable cycles
+  bool valid() const { return windowCount >= SPO2_WINDOW_BEATS; }
+  // Saturation in tenths of a percent (e.g. 975 = 97.5 %), 0 when not valid
+  uint16_t spO2Tenths() const { return valid() ? spo2Tenths : 0; }
+  uint8_t spO2Percent() const { return (uint8_t)((spO2Tenths() + 5) / 10); }
+  // Mean ratio-of-ratios over the window, Q10 (1024 = 1.0)
+  uint16_t ratioQ10() const { return windowCount ? (uint16_t)(ratioSum / windowCount) : 0; }
+  uint16_t perfusionIndexBp() const { return perfusionBp; }
+  uint8_t quality() const { return valid() ? qualityScore : 0; }
+  uint32_t cycles() const { return cycleCount; }
+  uint32_t rejectedCycles() const { return rejectedCount; }
+
+private:
+  void startCycle();
+  void endCycle();
+  void updateQuality();
+
+  uint16_t minCycleSamples;
+  uint16_t maxCycleSamples;
+
+  int32_t dcRedQ8;
+  int32_t dcIrQ8;
+  bool primed;
+
+  // Current pulse cycle
+  int32_t redMax, redMin, irMax, irMin;
+  int32_t lastIrP2p;
+  bool armed;
+  uint16_t cycleSamples;
+
+  // Window of per-cycle ratios (Q10) with running sums
+  uint16_t window[SPO2_WINDOW_BEATS];
+  uint8_t windowHead;
+  uint8_t windowCount;
+  uint32_t ratioSum;
+  uint32_t ratioSquareSum;
+
+  uint16_t spo2Tenths;
+  uint16_t perfusionBp;
+  uint8_t qualityScore;
+  uint32_t cycleCount;
+  uint32_t rejectedCount;
+};
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * RescueNet AI - Lock-free single-producer / single-consumer ring buffer
+ *
+ * One context pushes (sensor drain, ISR, acquisition task), another pops
+ * (detection, network task). Indices are free-running counters; only the
+ * producer writes head and only the consumer writes tail, so no lock is
+ * needed. Capacity must be a power of two. When the ring is full push()
+ * refuses the item and counts it as dropped, which is the backpressure
+ * signal for the producer.
+ *
+ * On the ESP32 and the host the indices are std::atomic with
+ * acquire/release ordering so the two sides may run on different cores.
+ * The AVR toolchain has no <atomic>; there the indices are single bytes
+ * (atomic loads/stores on an 8-bit core) and capacity is limited to 128.
+ */
+
+#ifndef RESCUENET_SPSC_RING_H
+#define RESCUENET_SPSC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__AVR__)
+#define SPSC_RING_ATOMIC 0
+#else
+#define SPSC_RING_ATOMIC 1
+#include <atomic>
+#endif
+
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+#if !SPSC_RING_ATOMIC
+  static_assert(N <= 128, "SpscRing on AVR uses 8-bit indices");
+#endif
+
+public:
+  SpscRing() : head(0), tail(0), dropped(0), highWater(0) {}
+
+  // Producer side
+  bool push(const T& item) {
+    Index h = loadRelaxed(head);
+    Index t = loadAcquire(tail);
+    Index used = (Index)(h - t);
+    if (used >= N) {
+      dropped++;
+      return false;
+    }
+    slots[h & (N - 1)] = item;
+    storeRelease(head, (Index)(h + 1));
+    if (used + 1 > highWater) highWater = used + 1;
+    return true;
+  }
+
+  // Free slots as seen by the producer
+  size_t space() const { return N - size(); }
+
+  // Consumer side
+  bool pop(T& out) {
+    Index t = loadRelaxed(tail);
+    Index h = loadAcquire(head);
+    if (h == t) return false;
+    out = slots[t & (N - 1)];
+    storeRelease(tail, (Index)(t + 1));
+    return true;
+  }
+
+  // Oldest queued item without removing it
+  const T* peek() const {
+    Index t = loadRelaxed(tail);
+    Index h = loadAcquire(head);
+    return h == t ? nullptr : &slots[t & (N - 1)];
+  }
+
+  // Removes the oldest item once it has been read in place through peek()
+  bool discard() {
+    Index t = loadRelaxed(tail);
+    Index h = loadAcquire(head);
+    if (h == t) return false;
+    storeRelease(tail, (Index)(t + 1));
+    return true;
+  }
+
+  size_t size() const { return (Index)(loadAcquire(head) - loadAcquire(tail)); }
+  bool empty() const { return size() == 0; }
+  static size_t capacity() { return N; }
+
+  // Items refused because the ring was full (written by the producer only)
+  uint32_t droppedCount() const { return dropped; }
+  // Deepest fill level seen by the producer
+  size_t highWaterMark() const { return highWater; }
+
+private:
+#if SPSC_RING_ATOMIC
+  typedef uint32_t Index;
+  typedef std::atomic<Index> Counter;
+  static Index loadRelaxed(const Counter& c) { return c.load(std::memory_order_relaxed); }
+  static Index loadAcquire(const Counter& c) { return c.load(std::memory_order_acquire); }
+  static void storeRelease(Counter& c, Index v) { c.store(v, std::memory_order_release); }
+#else
+  typedef uint8_t Index;
+  typedef volatile Index Counter;
+  static Index loadRelaxed(const Counter& c) { return c; }
+  static Index loadAcquire(const Counter& c) {
+    Index v = c;
+    __asm__ __volatile__("" ::: "memory");
+    return v;
+  }
+  static void storeRelease(Counter& c, Index v) {
+    __asm__ __volatile__("" ::: "memory");
+    c = v;
+  }
+#endif
+
+  T slots[N];
+  Counter head;
+  Counter tail;
+  uint32_t dropped;
+  size_t highWater;
+};
+
+#endif
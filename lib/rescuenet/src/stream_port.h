@@ -0,0 +1,26 @@
+/*
+ * RescueNet AI - SerialPort adapter for Arduino Streams
+ *
+ * Wraps a HardwareSerial or SoftwareSerial so modem drivers can use it
+ * through the HAL. Header only: the host build has no Stream class and
+ * never includes this file.
+ */
+
+#ifndef RESCUENET_STREAM_PORT_H
+#define RESCUENET_STREAM_PORT_H
+
+#include "hal.h"
+
+class StreamPort : public SerialPort {
+public:
+  explicit StreamPort(Stream& stream) : stream(stream) {}
+
+  int available() override { return stream.available(); }
+  int read() override { return stream.read(); }
+  size_t write(const uint8_t* data, size_t length) override { return stream.write(data, length); }
+
+private:
+  Stream& stream;
+};
+
+#endif
@@ -0,0 +1,155 @@
+/*
+ * RescueNet AI - Binary telemetry records
+ */
+
+#include "telemetry.h"
+
+#include "crc16.h"
+
+#include <string.h>
+#include <time.h>
+
+namespace {
+
+const uint8_t OFFSET_USER_ID = 12;
+const uint8_t OFFSET_HEART_RATE = 28;
+const uint8_t OFFSET_BODY = 54;  // Fixed part ends; reason or CRC follows
+
+void put16(uint8_t* out, uint16_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+}
+
+void put32(uint8_t* out, uint32_t value) {
+  put16(out, (uint16_t)value);
+  put16(out + 2, (uint16_t)(value >> 16));
+}
+
+uint16_t get16(const uint8_t* in) {
+  return (uint16_t)(in[0] | ((uint16_t)in[1] << 8));
+}
+
+uint32_t get32(const uint8_t* in) {
+  return get16(in) | ((uint32_t)get16(in + 2) << 16);
+}
+
+// value * scale rounded to the nearest integer and clamped to [low, high]
+int32_t scaled(double value, double scale, int32_t low, int32_t high) {
+  double v = value * scale;
+  if (!(v == v)) return 0;  // NaN
+  if (v <= low) return low;
+  if (v >= high) return high;
+  return (int32_t)(v < 0 ? v - 0.5 : v + 0.5);
+}
+
+size_t textLength(const char* text, size_t max) {
+  size_t n = 0;
+  if (text) {
+    while (n < max && text[n]) n++;
+  }
+  return n;
+}
+
+}  // namespace
+
+size_t encodeTelemetry(const TelemetryRecord& record, uint8_t* out, size_t capacity) {
+  size_t reasonLength = 0;
+  size_t size = TELEMETRY_HEALTH_SIZE;
+  if (record.kind == TELEMETRY_EMERGENCY) {
+    reasonLength = textLength(record.reason, TELEMETRY_REASON_MAX);
+    size += 1 + reasonLength;
+  }
+  if (capacity < size) return 0;
+
+  out[0] = 'R';
+  out[1] = 'N';
+  out[2] = TELEMETRY_VERSION;
+  out[3] = record.kind;
+  put16(out + 4, record.sequence);
+  out[6] = record.flags;
+  out[7] = record.batteryLevel;
+  put32(out + 8, record.timestamp);
+
+  size_t idLength = textLength(record.userId, TELEMETRY_USER_ID_MAX);
+  memset(out + OFFSET_USER_ID, 0, TELEMETRY_USER_ID_MAX);
+  if (idLength) memcpy(out + OFFSET_USER_ID, record.userId, idLength);
+
+  uint8_t* p = out + OFFSET_HEART_RATE;
+  put16(p, (uint16_t)scaled(record.heartRate, 10, 0, 65535));
+  put16(p + 2, (uint16_t)scaled(record.spO2, 10, 0, 65535));
+  put16(p + 4, (uint16_t)scaled(record.temperature, 100, -32768, 32767));
+  put16(p + 6, (uint16_t)scaled(record.bloodPressureSys, 1, 0, 65535));
+  put16(p + 8, (uint16_t)scaled(record.bloodPressureDia, 1, 0, 65535));
+  put32(p + 10, (uint32_t)scaled(record.latitude, 1e7, -900000000L, 900000000L));
+  put32(p + 14, (uint32_t)scaled(record.longitude, 1e7, -1800000000L, 1800000000L));
+  put16(p + 18, (uint16_t)scaled(record.altitude, 1, -32768, 32767));
+  put16(p + 20, (uint16_t)scaled(record.accelX, 100, -32768, 32767));
+  put16(p + 22, (uint16_t)scaled(record.accelY, 100, -32768, 32767));
+  put16(p + 24, (uint16_t)scaled(record.accelZ, 100, -32768, 32767));
+
+  size_t at = OFFSET_BODY;
+  if (record.kind == TELEMETRY_EMERGENCY) {
+    out[at++] = (uint8_t)reasonLength;
+    if (reasonLength) memcpy(out + at, record.reason, reasonLength);
+    at += reasonLength;
+  }
+  put16(out + at, crc16Ccitt(out, at));
+  return size;
+}
+
+bool decodeTelemetry(const uint8_t* data, size_t length, TelemetryRecord& record, char* userId, char* reason) {
+  if (length < TELEMETRY_HEALTH_SIZE || data[0] != 'R' || data[1] != 'N' || data[2] != TELEMETRY_VERSION) {
+    return false;
+  }
+  size_t reasonLength = 0;
+  if (data[3] == TELEMETRY_EMERGENCY) {
+    reasonLength = data[OFFSET_BODY];
+    if (reasonLength > TELEMETRY_REASON_MAX || length != TELEMETRY_HEALTH_SIZE + 1 + reasonLength) return false;
+  } else if (data[3] != TELEMETRY_HEALTH || length != TELEMETRY_HEALTH_SIZE) {
+    return false;
+  }
+  if (get16(data + length - 2) != crc16Ccitt(data, length - 2)) return false;
+
+  record.kind = data[3];
+  record.sequence = get16(data + 4);
+  record.flags = data[6];
+  record.batteryLevel = data[7];
+  record.timestamp = get32(data + 8);
+
+  memcpy(userId, data + OFFSET_USER_ID, TELEMETRY_USER_ID_MAX);
+  userId[TELEMETRY_USER_ID_MAX] = '\0';
+  record.userId = userId;
+
+  const uint8_t* p = data + OFFSET_HEART_RATE;
+  record.heartRate = get16(p) / 10.0f;
+  record.spO2 = get16(p + 2) / 10.0f;
+  record.temperature = (int16_t)get16(p + 4) / 100.0f;
+  record.bloodPressureSys = get16(p + 6);
+  record.bloodPressureDia = get16(p + 8);
+  record.latitude = (int32_t)get32(p + 10) / 1e7;
+  record.longitude = (int32_t)get32(p + 14) / 1e7;
+  record.altitude = (int16_t)get16(p + 18);
+  record.accelX = (int16_t)get16(p + 20) / 100.0f;
+  record.accelY = (int16_t)get16(p + 22) / 100.0f;
+  record.accelZ = (int16_t)get16(p + 24) / 100.0f;
+
+  if (reasonLength) memcpy(reason, data + OFFSET_BODY + 1, reasonLength);
+  reason[reasonLength] = '\0';
+  record.reason = reason;
+  return true;
+}
+
+uint32_t telemetrySeconds(const struct tm& time) {
+  // Days from civil (proleptic Gregorian), without the C library's
+  // time zone handling, which the AVR library lacks
+  int32_t year = time.tm_year + 1900;
+  int32_t month = time.tm_mon + 1;
+  if (month <= 2) year--;
+  int32_t era = (year >= 0 ? year : year - 399) / 400;
+  int32_t yearOfEra = year - era * 400;
+  int32_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + time.tm_mday - 1;
+  int32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  int32_t days = era * 146097 + dayOfEra - 719468;
+  return (uint32_t)days * 86400UL + (uint32_t)time.tm_hour * 3600UL + (uint32_t)time.tm_min * 60UL +
+         (uint32_t)time.tm_sec;
+}
@@ -0,0 +1,91 @@
+/*
+ * RescueNet AI - Binary telemetry records
+ *
+ * A fixed-layout alternative to the JSON health and emergency payloads,
+ * covering the HealthData fields of v4.0 plus SpO2. Every field is a
+ * scaled integer, little-endian, at a fixed offset; the record ends in
+ * a CRC-16/CCITT over all bytes before it. Version 1:
+ *
+ *   off size field
+ *     0   2  magic "RN"
+ *     2   1  version (1)
+ *     3   1  kind: 1 health, 2 emergency
+ *     4   2  sequence number, wraps
+ *     6   1  flags (TELEMETRY_FLAG_*)
+ *     7   1  battery level in %, 255 when unknown
+ *     8   4  timestamp: seconds since 1970 of the local wall clock with
+ *            TELEMETRY_FLAG_WALL_CLOCK, otherwise millis()
+ *    12  16  user id, ASCII, zero padded (not terminated when 16 long)
+ *    28   2  heart rate, 0.1 BPM
+ *    30   2  SpO2, 0.1 %
+ *    32   2  body temperature, signed, 0.01 C
+ *    34   2  blood pressure systolic, mmHg
+ *    36   2  blood pressure diastolic, mmHg
+ *    38   4  latitude, signed, 1e-7 degree
+ *    42   4  longitude, signed, 1e-7 degree
+ *    46   2  altitude, signed, m
+ *    48   6  acceleration x, y, z, signed, cm/s^2
+ *    54      emergency only: reason length (1 byte) and reason text
+ *   end   2  CRC-16 of everything above
+ *
+ * A health record is TELEMETRY_HEALTH_SIZE (56) bytes against roughly
+ * 220 bytes of JSON. Values outside a field's range are clamped. New
+ * fields go in a new version; decoders reject versions they do not
+ * know. utils/telemetryCodec.js decodes the same layout on the server.
+ */
+
+#ifndef RESCUENET_TELEMETRY_H
+#define RESCUENET_TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_CONTENT_TYPE "application/vnd.rescuenet.telemetry"
+#define TELEMETRY_USER_ID_MAX 16
+#define TELEMETRY_REASON_MAX 64
+#define TELEMETRY_HEALTH_SIZE 56
+#define TELEMETRY_MAX_SIZE (TELEMETRY_HEALTH_SIZE + 1 + TELEMETRY_REASON_MAX)
+#define TELEMETRY_BATTERY_UNKNOWN 0xFF
+
+enum TelemetryKind {
+  TELEMETRY_HEALTH = 1,
+  TELEMETRY_EMERGENCY = 2
+};
+
+#define TELEMETRY_FLAG_FALL 0x01        // Fall detected
+#define TELEMETRY_FLAG_EMERGENCY 0x02   // Emergency active on the device
+#define TELEMETRY_FLAG_LOCATION 0x04    // Latitude/longitude/altitude are set
+#define TELEMETRY_FLAG_WALL_CLOCK 0x08  // Timestamp is wall clock time
+
+struct TelemetryRecord {
+  uint8_t kind;
+  uint8_t flags;
+  uint16_t sequence;
+  uint32_t timestamp;
+  const char* userId;
+  float heartRate;
+  float spO2;
+  float temperature;
+  float bloodPressureSys;
+  float bloodPressureDia;
+  double latitude;
+  double longitude;
+  float altitude;
+  float accelX, accelY, accelZ;  // m/s^2
+  uint8_t batteryLevel;
+  const char* reason;            // Emergency records; cut at TELEMETRY_REASON_MAX
+};
+
+// Writes the record to out; its size, or 0 when capacity is too small
+size_t encodeTelemetry(const TelemetryRecord& record, uint8_t* out, size_t capacity);
+
+// Reads a record, checking magic, version, kind, length and CRC. The
+// texts are copied to userId (TELEMETRY_USER_ID_MAX + 1 bytes) and
+// reason (TELEMETRY_REASON_MAX + 1 bytes), which the record points to.
+bool decodeTelemetry(const uint8_t* data, size_t length, TelemetryRecord& record, char* userId, char* reason);
+
+// Seconds since 1970 for a broken-down time, taken as UTC
+uint32_t telemetrySeconds(const struct tm& time);
+
+#endif
@@ -0,0 +1,261 @@
+/*
+ * RescueNet AI - Batched telemetry uploader
+ */
+
+#include "telemetry_uploader.h"
+
+#if UPLOAD_JSON_ENABLED
+namespace {
+
+// One JSON batch at a time, built at flush time
+char jsonBody[UPLOAD_JSON_MAX + 1];
+
+}  // namespace
+#endif
+
+TelemetryUploader::TelemetryUploader(HttpPort* http, const char* url, UploadFormat format, uint8_t batchSamples,
+                                     uint32_t maxAgeMs)
+  : http(http), url(url), format(UPLOAD_JSON_ENABLED ? format : UPLOAD_BINARY),
+    batchSamples(batchSamples == 0 ? 1 : batchSamples > UPLOAD_BATCH_SAMPLES ? UPLOAD_BATCH_SAMPLES : batchSamples),
+    maxAgeMs(maxAgeMs), count(0), inFlight(0), sending(SEND_NONE), sendStartedMs(0), retryAt(0), retrying(false),
+    backlog(nullptr), emergencyUrl(nullptr) {
+  resetStats();
+}
+
+void TelemetryUploader::resetStats() {
+  memset(&counters, 0, sizeof(counters));
+  counters.sinceMs = millis();
+}
+
+void TelemetryUploader::setBacklog(RecordLog* log, const char* url) {
+  backlog = log && log->ready() ? log : nullptr;
+  emergencyUrl = url;
+}
+
+void TelemetryUploader::setBatching(uint8_t samples, uint32_t ageMs) {
+  batchSamples = samples == 0 ? 1 : samples > UPLOAD_BATCH_SAMPLES ? UPLOAD_BATCH_SAMPLES : samples;
+  maxAgeMs = ageMs;
+}
+
+void TelemetryUploader::add(const TelemetryRecord& record) {
+  if (count == UPLOAD_BATCH_SAMPLES && !backlog) {
+    // Nothing could be sent for a while; the newest readings matter most.
+    // Those on their way stay put: the oldest of the rest makes room, or
+    // this one goes when there is none.
+    counters.dropped++;
+    if (inFlight == count) {
+      counters.samples++;
+      return;
+    }
+    uint8_t* oldest = records + (size_t)inFlight * TELEMETRY_HEALTH_SIZE;
+    memmove(oldest, oldest + TELEMETRY_HEALTH_SIZE, (size_t)(count - inFlight - 1) * TELEMETRY_HEALTH_SIZE);
+    memmove(addedMs + inFlight, addedMs + inFlight + 1, (count - inFlight - 1) * sizeof(addedMs[0]));
+    count--;
+  }
+  if (count == UPLOAD_BATCH_SAMPLES) spill();
+  TelemetryRecord health = record;
+  health.kind = TELEMETRY_HEALTH;
+  counters.samples++;
+  // Still full when every reading is on its way
+  if (spooling() || count == UPLOAD_BATCH_SAMPLES) {
+    // Behind the backlog, so replay keeps the order
+    uint8_t encoded[TELEMETRY_HEALTH_SIZE];
+    encodeTelemetry(health, encoded, sizeof(encoded));
+    if (backlog->append(encoded, sizeof(encoded))) {
+      counters.spooled++;
+    } else {
+      counters.dropped++;
+    }
+    return;
+  }
+  encodeTelemetry(health, records + (size_t)count * TELEMETRY_HEALTH_SIZE, TELEMETRY_HEALTH_SIZE);
+  addedMs[count++] = millis();
+}
+
+bool TelemetryUploader::storeAlert(const uint8_t* record, size_t length) {
+  if (!backlog) return false;
+  spill();
+  // An alert is worth a write of its own
+  return backlog->append(record, length) && backlog->sync();
+}
+
+void TelemetryUploader::poll(bool online) {
+  if (backlog) backlog->poll();
+  if (!http) return;
+  if (busy()) {
+    int status = http->pollPost();
+    if (status != HTTP_PENDING) finish(status);
+    return;
+  }
+  uint32_t now = millis();
+  if (retrying && (int32_t)(now - retryAt) < 0) return;
+  if (spooling()) {
+    if (online) send();
+    return;
+  }
+  if (count == 0) return;
+  if (!retrying && count < batchSamples && now - addedMs[0] < maxAgeMs) return;
+  if (online) {
+    send();
+  } else if (backlog) {
+    // Due but offline: into the log, where a reset cannot lose it
+    spill();
+  }
+}
+
+bool TelemetryUploader::flush() {
+  // A post under way is seen through first
+  if (busy()) finish(wait());
+  int status;
+  if (!start(status)) return false;
+  if (status == HTTP_PENDING) status = wait();
+  return finish(status);
+}
+
+void TelemetryUploader::send() {
+  int status;
+  if (start(status) && status != HTTP_PENDING) finish(status);
+}
+
+int TelemetryUploader::wait() {
+  int status;
+  while ((status = http->pollPost()) == HTTP_PENDING) delay(1);
+  return status;
+}
+
+bool TelemetryUploader::start(int& status) {
+  if (!http) return false;
+  sendStartedMs = millis();
+  if (!spooling()) {
+    if (count == 0) return false;
+    inFlight = count;
+    sending = SEND_BATCH;
+    status = post();
+    return true;
+  }
+
+  // The batch buffer is free: while the backlog drains, readings go to it
+  size_t length = backlog->peek(records, sizeof(records));
+  if (length == 0) return false;
+  if (length != TELEMETRY_HEALTH_SIZE) {
+    backlog->read(records, sizeof(records));
+    sending = SEND_ALERT;
+    counters.bodyBytes += length;
+    status = http->startPost(emergencyUrl, TELEMETRY_CONTENT_TYPE, (const char*)records, length);
+    return true;
+  }
+  // Readings up to the next alert, which does not fit a health slot
+  while (count < UPLOAD_BATCH_SAMPLES &&
+         backlog->read(records + (size_t)count * TELEMETRY_HEALTH_SIZE, TELEMETRY_HEALTH_SIZE)) {
+    count++;
+  }
+  inFlight = count;
+  sending = SEND_REPLAY;
+  status = post();
+  return true;
+}
+
+bool TelemetryUploader::finish(int status) {
+  Sending sent = sending;
+  uint8_t posted = inFlight;
+  sending = SEND_NONE;
+  inFlight = 0;
+  uint32_t now = millis();
+  counters.requests++;
+  counters.busyMsTotal += now - sendStartedMs;
+  bool ok = status >= 200 && status < 300;
+
+  if (sent == SEND_BATCH) {
+    if (!ok) {
+      LOG_PORT.print("Error sending data: ");
+      LOG_PORT.println(status);
+      counters.failures++;
+      retrying = true;
+      retryAt = now + UPLOAD_RETRY_MS;
+      if (backlog) spill();
+      return false;
+    }
+    LOG_PORT.print("Data sent successfully: ");
+    LOG_PORT.println(status);
+
+    for (uint8_t i = 0; i < posted; i++) {
+      uint32_t latency = now - addedMs[i];
+      counters.latencyMsTotal += latency;
+      if (latency > counters.latencyMsMax) counters.latencyMsMax = latency;
+    }
+    counters.delivered += posted;
+    // What came in while the post was out moves up
+    count -= posted;
+    memmove(records, records + (size_t)posted * TELEMETRY_HEALTH_SIZE, (size_t)count * TELEMETRY_HEALTH_SIZE);
+    memmove(addedMs, addedMs + posted, count * sizeof(addedMs[0]));
+    retrying = false;
+    return true;
+  }
+
+  uint8_t taken = sent == SEND_ALERT ? 1 : posted;
+  count = 0;
+  if (!ok) {
+    LOG_PORT.print("Error sending backlog: ");
+    LOG_PORT.println(status);
+    counters.failures++;
+    retrying = true;
+    retryAt = now + UPLOAD_RETRY_MS;
+    backlog->rewind();
+    return false;
+  }
+  LOG_PORT.print("Backlog sent: ");
+  LOG_PORT.println(status);
+  backlog->commit();
+  counters.delivered += taken;
+  counters.replayed += taken;
+  retrying = false;
+  // The cursor is on storage once the backlog is empty
+  if (backlog->pending() == 0) backlog->sync();
+  return true;
+}
+
+void TelemetryUploader::spill() {
+  for (uint8_t i = inFlight; i < count; i++) {
+    if (backlog->append(records + (size_t)i * TELEMETRY_HEALTH_SIZE, TELEMETRY_HEALTH_SIZE)) {
+      counters.spooled++;
+    } else {
+      counters.dropped++;
+    }
+  }
+  count = inFlight;
+}
+
+int TelemetryUploader::post() {
+  if (format == UPLOAD_BINARY) {
+    size_t length = (size_t)inFlight * TELEMETRY_HEALTH_SIZE;
+    counters.bodyBytes += length;
+    return http->startPost(url, TELEMETRY_CONTENT_TYPE, (const char*)records, length);
+  }
+#if UPLOAD_JSON_ENABLED
+  // The objects HealthMonitor used to post one at a time, as an array
+  TextWriter body(jsonBody, sizeof(jsonBody));
+  char userId[TELEMETRY_USER_ID_MAX + 1];
+  char reason[1];
+  body.add('[');
+  for (uint8_t i = 0; i < inFlight; i++) {
+    TelemetryRecord r;
+    decodeTelemetry(records + (size_t)i * TELEMETRY_HEALTH_SIZE, TELEMETRY_HEALTH_SIZE, r, userId, reason);
+    if (i > 0) body.add(',');
+    writeHealthJson(body, r);
+  }
+  body.add(']');
+  counters.bodyBytes += body.length();
+  return http->startPost(url, "application/json", body.c_str(), body.length());
+#else
+  return -1;
+#endif
+}
+
+float TelemetryUploader::requestsPerMinute() const {
+  uint32_t elapsed = millis() - counters.sinceMs;
+  return elapsed ? counters.requests * 60000.0f / elapsed : 0;
+}
+
+uint32_t TelemetryUploader::meanLatencyMs() const {
+  return counters.delivered ? counters.latencyMsTotal / counters.delivered : 0;
+}
@@ -0,0 +1,168 @@
+/*
+ * RescueNet AI - Batched telemetry uploader
+ *
+ * Collects health samples as telemetry.h records and posts them in one
+ * request per batch, through the single HttpPort of the board (whose
+ * connection is kept alive between requests). A batch goes out when it
+ * holds batchSamples samples or when its oldest sample is maxAgeMs old,
+ * whichever comes first.
+ *
+ * The body is the records back to back (UPLOAD_BINARY), or a JSON array
+ * of the health objects the server has always taken (UPLOAD_JSON), built
+ * only at flush time in one static buffer. A failed post keeps the batch and tries again
+ * after UPLOAD_RETRY_MS. Up to UPLOAD_BATCH_SAMPLES readings are held,
+ * so a batch threshold below that rides out short outages; beyond it
+ * the oldest reading makes room for the newest and is counted as
+ * dropped.
+ *
+ * With a backlog (record_log.h) attached nothing is dropped: a batch
+ * that fails, falls due while offline, or overflows goes to the log, and
+ * so does every later reading until the log has drained, which keeps
+ * them in order. Once online the log is replayed UPLOAD_BATCH_SAMPLES
+ * records per request, one request per poll(); stored alerts go to the
+ * emergency URL on their own, as binary records.
+ *
+ * Posts go out with HttpPort::startPost(). Over a transport that sends
+ * in steps (esp8266_http.h) poll() only starts one, and the polls after
+ * it move it on until the status is in (busy()), so the loop is never
+ * held up by the network. The readings on their way stay put meanwhile:
+ * add() queues behind them, and a full batch makes room among the rest.
+ *
+ * UploadStats keeps requests, body bytes and the upload latency of each
+ * sample delivered straight from RAM, from add() to the server's answer.
+ */
+
+#ifndef RESCUENET_TELEMETRY_UPLOADER_H
+#define RESCUENET_TELEMETRY_UPLOADER_H
+
+#include "hal.h"
+#include "messages.h"
+#include "record_log.h"
+#include "telemetry.h"
+
+// Readings held, and so the most one request carries. Two fit in the
+// buffer a replayed alert needs anyway (TELEMETRY_MAX_SIZE)
+#ifndef UPLOAD_BATCH_SAMPLES
+#if defined(__AVR__)
+#define UPLOAD_BATCH_SAMPLES 2
+#else
+#define UPLOAD_BATCH_SAMPLES 12
+#endif
+#endif
+
+#ifndef UPLOAD_MAX_AGE_MS
+#define UPLOAD_MAX_AGE_MS 30000
+#endif
+
+#define UPLOAD_RETRY_MS 5000
+
+// JSON bodies need a static buffer of UPLOAD_JSON_MAX bytes; without it
+// every batch is posted as binary records
+#ifndef UPLOAD_JSON_ENABLED
+#if defined(__AVR__)
+#define UPLOAD_JSON_ENABLED 0
+#else
+#define UPLOAD_JSON_ENABLED 1
+#endif
+#endif
+
+// "[", the objects with a comma between, "]"
+#define UPLOAD_JSON_MAX (2 + UPLOAD_BATCH_SAMPLES * (HEALTH_JSON_MAX + 1))
+
+// The batch, or an alert replayed from the backlog while it is empty
+#define UPLOAD_BATCH_BYTES (UPLOAD_BATCH_SAMPLES * TELEMETRY_HEALTH_SIZE)
+#define UPLOAD_BUFFER_BYTES (UPLOAD_BATCH_BYTES > TELEMETRY_MAX_SIZE ? UPLOAD_BATCH_BYTES : TELEMETRY_MAX_SIZE)
+
+enum UploadFormat {
+  UPLOAD_JSON,
+  UPLOAD_BINARY
+};
+
+struct UploadStats {
+  uint32_t samples;         // Taken by add()
+  uint32_t delivered;       // Acknowledged by the server
+  uint32_t dropped;         // Pushed out of a full batch that could not be sent
+  uint32_t spooled;         // Written to the backlog
+  uint32_t replayed;        // Delivered from the backlog
+  uint32_t requests;
+  uint32_t failures;
+  uint32_t bodyBytes;       // Request bodies handed to the transport
+  uint32_t busyMsTotal;     // From the start of each post to its status
+  uint32_t latencyMsTotal;  // add() to acknowledgement, over delivered samples
+  uint32_t latencyMsMax;
+  uint32_t sinceMs;         // millis() at the last resetStats()
+};
+
+class TelemetryUploader {
+public:
+  // batchSamples is capped at UPLOAD_BATCH_SAMPLES
+  TelemetryUploader(HttpPort* http, const char* url, UploadFormat format,
+                    uint8_t batchSamples = UPLOAD_BATCH_SAMPLES, uint32_t maxAgeMs = UPLOAD_MAX_AGE_MS);
+
+  // Queues a health record (its kind is forced to TELEMETRY_HEALTH)
+  void add(const TelemetryRecord& record);
+  // Flushes a full or old enough batch, or moves the post under way on;
+  // call often, e.g. from a task
+  void poll(bool online);
+  // Posts whatever is queued now, or the next backlog batch, and waits
+  // for the answer; true when it was acknowledged
+  bool flush();
+  // A post has started and its status is not in yet
+  bool busy() const { return sending != SEND_NONE; }
+
+  // New batch thresholds, for the next poll(); batchSamples is capped
+  void setBatching(uint8_t batchSamples, uint32_t maxAgeMs);
+
+  // Store-and-forward log for what cannot be sent; it must be begun
+  void setBacklog(RecordLog* log, const char* emergencyUrl);
+  // Keeps an encoded alert that could not be sent for replay, behind the
+  // readings taken before it; false without a backlog
+  bool storeAlert(const uint8_t* record, size_t length);
+
+  uint8_t pending() const { return count; }
+  const UploadStats& stats() const { return counters; }
+  void resetStats();
+  float requestsPerMinute() const;
+  uint32_t meanLatencyMs() const;
+
+private:
+  enum Sending : uint8_t {
+    SEND_NONE,
+    SEND_BATCH,   // The first inFlight readings
+    SEND_REPLAY,  // Readings read from the backlog
+    SEND_ALERT    // An alert read from the backlog
+  };
+
+  // Starts the next post, if there is anything to send; status is what
+  // startPost() returned
+  bool start(int& status);
+  int post();
+  void send();
+  // Steps the post under way through to its status
+  int wait();
+  // Acts on the status of the post under way; true when acknowledged
+  bool finish(int status);
+  // The readings not on their way, into the backlog
+  void spill();
+  bool spooling() const { return backlog && backlog->pending() > 0; }
+
+  HttpPort* http;
+  const char* url;
+  UploadFormat format;
+  uint8_t batchSamples;
+  uint32_t maxAgeMs;
+
+  uint8_t records[UPLOAD_BUFFER_BYTES];
+  uint32_t addedMs[UPLOAD_BATCH_SAMPLES];
+  uint8_t count;
+  uint8_t inFlight;  // Readings at the front of records being posted
+  Sending sending;
+  uint32_t sendStartedMs;
+  uint32_t retryAt;
+  bool retrying;
+  RecordLog* backlog;
+  const char* emergencyUrl;
+  UploadStats counters;
+};
+
+#endif
@@ -0,0 +1,169 @@
+/*
+ * RescueNet AI - DS18B20 probes converted in the background
+ */
+
+#include "temp_probes.h"
+
+TempProbes::TempProbes(TempSensor* bus) : bus(bus), found(0), converting(false), searchDue(false), startedMs(0) {
+  memset(probes, 0, sizeof(probes));
+  for (uint8_t i = 0; i < TEMP_PROBES_MAX; i++) uses[i] = i == 0 ? TEMP_USE_BODY : TEMP_USE_AMBIENT;
+#if TEMP_STATS
+  memset(&counters, 0, sizeof(counters));
+#endif
+}
+
+uint8_t TempProbes::begin() {
+  if (!bus) return 0;
+  bus->begin();
+  // Searches, as nothing is found yet
+  poll();
+  return found;
+}
+
+void TempProbes::setUse(uint8_t index, const TempUse& use) {
+  if (index >= TEMP_PROBES_MAX || use.bits < 9 || use.bits > 12 || use.smoothing == 0) return;
+  uses[index] = use;
+  if (index < found) {
+    probes[index].use = use;
+    bus->setResolution(probes[index].rom, use.bits);
+  }
+}
+
+void TempProbes::poll() {
+  if (!bus) return;
+#if TEMP_STATS
+  uint32_t started = micros();
+#endif
+  bool running = false;
+  if (converting) {
+    unsigned long elapsed = millis() - startedMs;
+    for (uint8_t i = 0; i < found; i++) {
+      TempProbe& probe = probes[i];
+      if (!probe.pending) continue;
+      if (elapsed >= TEMP_CONVERSION_MS(probe.use.bits)) {
+        collect(probe);
+      } else {
+        running = true;
+      }
+    }
+  }
+  if (searchDue || found == 0) {
+    // Drops what is still converting; it starts again below
+    search();
+    running = false;
+  }
+  if (running) {
+    // Convert T again would restart the ones still going
+#if TEMP_STATS
+    counters.early++;
+#endif
+  } else if (found && bus->startConversion()) {
+    converting = true;
+    startedMs = millis();
+    for (uint8_t i = 0; i < found; i++) probes[i].pending = true;
+#if TEMP_STATS
+    counters.conversions++;
+#endif
+  } else {
+    converting = false;
+  }
+
+#if TEMP_STATS
+  uint32_t busUs = micros() - started;
+  if (busUs > counters.busUsMax) counters.busUsMax = busUs;
+#endif
+}
+
+float TempProbes::celsius(uint8_t index) const {
+  if (index >= found || !probes[index].valid) return TEMP_DISCONNECTED_C;
+  return probes[index].celsius;
+}
+
+void TempProbes::search() {
+  TempProbeRom roms[TEMP_PROBES_MAX];
+  uint8_t n = bus->search(roms, TEMP_PROBES_MAX);
+#if TEMP_STATS
+  counters.searches++;
+#endif
+  searchDue = false;
+  converting = false;
+
+  // Probes still there keep their use, readings and filters, in the new
+  // order; new ones take the use set for their place
+  TempProbe previous[TEMP_PROBES_MAX];
+  memcpy(previous, probes, sizeof(probes));
+  uint8_t previousCount = found;
+  for (uint8_t i = 0; i < n; i++) {
+    TempProbe& probe = probes[i];
+    uint8_t j = 0;
+    while (j < previousCount && memcmp(previous[j].rom.bytes, roms[i].bytes, sizeof(roms[i].bytes)) != 0) j++;
+    if (j < previousCount) {
+      probe = previous[j];
+    } else {
+      memset(&probe, 0, sizeof(probe));
+      probe.rom = roms[i];
+      probe.use = uses[i];
+    }
+    probe.pending = false;
+    probe.failures = 0;
+    bus->setResolution(probe.rom, probe.use.bits);
+  }
+  found = n;
+}
+
+void TempProbes::collect(TempProbe& probe) {
+  int16_t raw;
+#if TEMP_STATS
+  counters.reads++;
+#endif
+  probe.pending = false;
+  if (!bus->readRaw(probe.rom, raw)) {
+#if TEMP_STATS
+    counters.failedReads++;
+#endif
+    if (++probe.failures >= TEMP_FAIL_LIMIT) {
+      // Unplugged or replaced: stop reporting it and look again
+      probe.valid = false;
+      searchDue = true;
+    }
+    return;
+  }
+  probe.failures = 0;
+  accept(probe, raw);
+}
+
+void TempProbes::accept(TempProbe& probe, int16_t raw) {
+  // Below 12 bits the low bits are undefined
+  raw &= (int16_t)~((1 << (12 - probe.use.bits)) - 1);
+  probe.lastRaw = raw;
+  float value = raw / 16.0f;
+
+  // A probe that lost power reads 85 C until it converts again
+  if (raw == TEMP_POWER_ON_RAW && !(probe.valid && probe.celsius > 80.0f)) {
+#if TEMP_STATS
+    counters.rejected++;
+#endif
+    return;
+  }
+  if (probe.valid && fabs(value - probe.celsius) > TEMP_STEP_MAX_C) {
+    // One reading far off is a glitch; two close together are real
+    if (probe.holding && abs(raw - probe.heldRaw) <= (int)(TEMP_STEP_MAX_C * 16)) {
+      probe.celsius = value;
+      probe.holding = false;
+      return;
+    }
+    probe.heldRaw = raw;
+    probe.holding = true;
+#if TEMP_STATS
+    counters.rejected++;
+#endif
+    return;
+  }
+  probe.holding = false;
+  if (!probe.valid) {
+    probe.celsius = value;
+    probe.valid = true;
+    return;
+  }
+  probe.celsius += (value - probe.celsius) / probe.use.smoothing;
+}
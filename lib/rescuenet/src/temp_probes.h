@@ -0,0 +1,128 @@
+/*
+ * RescueNet AI - DS18B20 probes converted in the background
+ *
+ * The sketches read the temperature with DallasTemperature's blocking
+ * requestTemperatures(), which sits out the whole conversion (750 ms at
+ * 12 bits), and then getTempCByIndex(0), which searches the bus again
+ * to find probe 0 before reading it. On every vitals reading the loop
+ * stopped for most of a second and the sensor FIFOs overflowed behind it.
+ *
+ * TempProbes splits the reading in two. poll() collects every probe
+ * whose conversion has had its time, then starts the next conversion
+ * on all of them and returns; the monitor calls it once per reading, so
+ * each reading takes the result of the conversion the last one started.
+ * A poll() that comes too soon leaves the conversion running.
+ *
+ * The bus is searched once in begin() and the ROM addresses are kept;
+ * a probe that stops answering TEMP_FAIL_LIMIT times in a row has the
+ * bus searched again, which also finds a probe plugged in later. Each
+ * probe has a use that sets its resolution and how much it is smoothed:
+ * probe 0 is the body probe, at 12 bits for the fever trend, the rest
+ * default to ambient at 9 bits. Readings go through a spike gate that
+ * drops the 85 C power-on value and a lone jump of more than
+ * TEMP_STEP_MAX_C, then an exponential moving average.
+ */
+
+#ifndef RESCUENET_TEMP_PROBES_H
+#define RESCUENET_TEMP_PROBES_H
+
+#include "hal.h"
+
+#ifndef TEMP_PROBES_MAX
+#if defined(__AVR__)
+#define TEMP_PROBES_MAX 1  // The Nano has the body probe only
+#else
+#define TEMP_PROBES_MAX 4
+#endif
+#endif
+
+// Missed reads in a row before the bus is searched again
+#define TEMP_FAIL_LIMIT 3
+// A reading this far from the smoothed value waits for a second one
+#define TEMP_STEP_MAX_C 2.0f
+// The scratchpad's value after power-on, before any conversion
+#define TEMP_POWER_ON_RAW (85 * 16)
+
+// Conversion time at a resolution, rounded up: 94, 188, 375 or 750 ms
+#define TEMP_CONVERSION_MS(bits) (((1500U >> (12 - (bits))) + 1) / 2)
+
+// What a probe is for
+struct TempUse {
+  uint8_t bits;       // 9 to 12: 0.5 to 0.0625 C
+  uint8_t smoothing;  // Readings averaged over, roughly; 1 is none
+};
+
+const TempUse TEMP_USE_BODY = {12, 4};     // Fever trend; readings 5 s apart
+const TempUse TEMP_USE_AMBIENT = {9, 2};   // Room or skin-side reference
+const TempUse TEMP_USE_FAST = {10, 1};     // Quick checks, unsmoothed
+
+struct TempProbe {
+  TempProbeRom rom;
+  TempUse use;
+  float celsius;       // Smoothed
+  int16_t lastRaw;     // 1/16 C
+  int16_t heldRaw;     // A jump waiting for confirmation
+  bool valid;
+  bool holding;
+  bool pending;        // Converting, not read yet
+  uint8_t failures;    // In a row
+};
+
+// Read, reject and bus time counters: 20 bytes the Nano goes without
+#ifndef TEMP_STATS
+#if defined(__AVR__)
+#define TEMP_STATS 0
+#else
+#define TEMP_STATS 1
+#endif
+#endif
+
+struct TempProbesStats {
+  uint32_t conversions;
+  uint32_t reads;
+  uint16_t failedReads;   // No answer or bad CRC
+  uint16_t rejected;      // Power-on values and unconfirmed jumps
+  uint16_t early;         // poll() calls that found the conversion running
+  uint16_t searches;
+  uint32_t busUsMax;      // Longest poll(), bus time included
+};
+
+class TempProbes {
+public:
+  explicit TempProbes(TempSensor* bus);
+
+  // Finds and sets up the probes, and starts the first conversion;
+  // returns how many were found
+  uint8_t begin();
+  // Before or after begin(); index is in the order the search found them
+  void setUse(uint8_t index, const TempUse& use);
+
+  // Collects finished conversions and starts the next; never waits
+  void poll();
+
+  // Smoothed temperature, TEMP_DISCONNECTED_C until a probe has a reading
+  float celsius(uint8_t index = 0) const;
+  uint8_t count() const { return found; }
+  const TempProbe& probe(uint8_t index) const { return probes[index]; }
+#if TEMP_STATS
+  const TempProbesStats& stats() const { return counters; }
+#endif
+
+private:
+  void search();
+  void collect(TempProbe& probe);
+  void accept(TempProbe& probe, int16_t raw);
+
+  TempSensor* bus;
+  TempProbe probes[TEMP_PROBES_MAX];
+  TempUse uses[TEMP_PROBES_MAX];
+  uint8_t found;
+  bool converting;
+  bool searchDue;
+  unsigned long startedMs;
+#if TEMP_STATS
+  TempProbesStats counters;
+#endif
+};
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * RescueNet AI - Fixed-capacity text formatting
+ */
+
+#include "text_format.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+namespace {
+
+char* putDigits(char* out, uint32_t value, uint8_t width) {
+  for (uint8_t i = width; i > 0; i--) {
+    out[i - 1] = (char)('0' + value % 10);
+    value /= 10;
+  }
+  return out + width;
+}
+
+}  // namespace
+
+TextWriter::TextWriter(char* buffer, size_t capacity)
+  : text(buffer), capacity(capacity), used(0), overflow(false) {
+  if (capacity) text[0] = 0;
+}
+
+void TextWriter::clear() {
+  used = 0;
+  overflow = false;
+  if (capacity) text[0] = 0;
+}
+
+TextWriter& TextWriter::add(const char* text, size_t length) {
+  size_t room = capacity ? capacity - 1 - used : 0;
+  if (length > room) {
+    length = room;
+    overflow = true;
+  }
+  memcpy(this->text + used, text, length);
+  used += length;
+  if (capacity) this->text[used] = 0;
+  return *this;
+}
+
+TextWriter& TextWriter::add(const char* text) {
+  return text ? add(text, strlen(text)) : *this;
+}
+
+TextWriter& TextWriter::add(char c) {
+  return add(&c, 1);
+}
+
+TextWriter& TextWriter::addUnsigned(unsigned long value) {
+  char digits[10];
+  uint8_t count = 0;
+  do {
+    digits[count++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value);
+  char out[10];
+  for (uint8_t i = 0; i < count; i++) out[i] = digits[count - 1 - i];
+  return add(out, count);
+}
+
+TextWriter& TextWriter::addInt(long value) {
+  if (value < 0) {
+    add('-');
+    return addUnsigned(0UL - (unsigned long)value);
+  }
+  return addUnsigned((unsigned long)value);
+}
+
+TextWriter& TextWriter::addNumber(double value, uint8_t decimals) {
+  // Same steps as Print::printFloat
+  if (value != value) return add("nan");
+  if (value - value != 0) return add("inf");
+  if (value > 4294967040.0 || value < -4294967040.0) return add("ovf");
+  if (value < 0) {
+    add('-');
+    value = -value;
+  }
+  double rounding = 0.5;
+  for (uint8_t i = 0; i < decimals; i++) rounding /= 10.0;
+  value += rounding;
+  unsigned long whole = (unsigned long)value;
+  double rest = value - (double)whole;
+  addUnsigned(whole);
+  if (decimals) add('.');
+  for (uint8_t i = 0; i < decimals; i++) {
+    rest *= 10.0;
+    uint8_t digit = (uint8_t)rest;
+    add((char)('0' + digit));
+    rest -= digit;
+  }
+  return *this;
+}
+
+TextWriter& TextWriter::addIsoTime(uint32_t seconds) {
+  int32_t days = (int32_t)(seconds / 86400UL);
+  uint32_t rest = seconds % 86400UL;
+  // Civil from days (proleptic Gregorian)
+  days += 719468;
+  int32_t era = days / 146097;
+  int32_t dayOfEra = days - era * 146097;
+  int32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  int32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  int32_t mp = (5 * dayOfYear + 2) / 153;
+  int32_t day = dayOfYear - (153 * mp + 2) / 5 + 1;
+  int32_t month = mp < 10 ? mp + 3 : mp - 9;
+  int32_t year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+  char time[MESSAGE_TIME_MAX];
+  char* out = putDigits(time, (uint32_t)year, 4);
+  *out++ = '-';
+  out = putDigits(out, (uint32_t)month, 2);
+  *out++ = '-';
+  out = putDigits(out, (uint32_t)day, 2);
+  *out++ = 'T';
+  out = putDigits(out, rest / 3600, 2);
+  *out++ = ':';
+  out = putDigits(out, rest / 60 % 60, 2);
+  *out++ = ':';
+  out = putDigits(out, rest % 60, 2);
+  memcpy(out, ".000Z", 5);
+  return add(time, sizeof(time));
+}
+
+MessageArg messageTime(uint32_t timestamp, bool wallClock) {
+  MessageArg arg((unsigned long)timestamp);
+  arg.kind = MessageArg::TIME;
+  arg.wallClock = wallClock;
+  arg.value.seconds = timestamp;
+  return arg;
+}
+
+void formatMessage(TextWriter& out, const char* format, const MessageArg* args, uint8_t count) {
+  uint8_t next = 0;
+  for (;;) {
+    // Literal text up to the next placeholder, a few characters at a time
+    char literal[16];
+    size_t length = 0;
+    char c;
+    while ((c = (char)pgm_read_byte(format)) != 0 && c != '%') {
+      literal[length++] = c;
+      format++;
+      if (length == sizeof(literal)) {
+        out.add(literal, length);
+        length = 0;
+      }
+    }
+    out.add(literal, length);
+    if (c == 0) return;
+    char placeholder = (char)pgm_read_byte(format + 1);
+    if (placeholder == 0) {
+      out.add('%');
+      return;
+    }
+    format += 2;
+    if (placeholder == '%') {
+      out.add('%');
+      continue;
+    }
+    if (next >= count) continue;
+    const MessageArg& arg = args[next++];
+    switch (arg.kind) {
+      case MessageArg::TEXT:
+        out.add(arg.value.text);
+        break;
+      case MessageArg::INTEGER:
+        if (placeholder == 'i') {
+          out.addInt(arg.value.integer);
+        } else {
+          out.addNumber((double)arg.value.integer, placeholder == '1' ? 1 : placeholder == '4' ? 4 : 2);
+        }
+        break;
+      case MessageArg::NUMBER:
+        if (placeholder == 'i') {
+          out.addInt((long)arg.value.number);
+        } else {
+          out.addNumber(arg.value.number, placeholder == '1' ? 1 : placeholder == '4' ? 4 : 2);
+        }
+        break;
+      case MessageArg::TIME:
+        if (arg.wallClock) {
+          out.addIsoTime(arg.value.seconds);
+        } else {
+          out.addUnsigned(arg.value.seconds);
+        }
+        break;
+    }
+  }
+}
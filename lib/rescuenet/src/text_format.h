@@ -0,0 +1,141 @@
+/*
+ * RescueNet AI - Fixed-capacity text formatting
+ *
+ * Builds messages in caller-owned buffers instead of Arduino String, so
+ * nothing is allocated on the heap. TextWriter appends to a buffer of
+ * fixed capacity and stops at its end, flagging the text as truncated;
+ * TextBuffer<N> is a writer with room for N characters of its own, for
+ * the stack or a member.
+ *
+ * formatMessage() fills in a template: literal text with placeholders
+ *
+ *   %i  integer                     %t  timestamp (messageTime())
+ *   %f  number, 2 decimals          %s  text, up to MESSAGE_TEXT_MAX
+ *   %1  number, 1 decimal           %u  user id, up to TELEMETRY_USER_ID_MAX
+ *   %4  number, 4 decimals          %%  a percent sign
+ *
+ * taking one argument per placeholder in order. Numbers print as
+ * Print::print(float, digits) does ("nan", "inf", "ovf" out of range).
+ * messageMax() works out the longest text a template can give at
+ * compile time, so a TextBuffer<messageMax(TEMPLATE)> always holds it.
+ *
+ * The template is read from flash: pass PSTR(TEMPLATE), so AVR does not
+ * copy it to RAM at startup. %s and %u arguments are ordinary strings.
+ */
+
+#ifndef RESCUENET_TEXT_FORMAT_H
+#define RESCUENET_TEXT_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry.h"
+
+// Widest %s argument a template is sized for
+#ifndef MESSAGE_TEXT_MAX
+#define MESSAGE_TEXT_MAX 80
+#endif
+
+// "-2147483648"
+#define MESSAGE_INTEGER_MAX 11
+// "-4294967040." and the decimals
+#define MESSAGE_NUMBER_MAX(decimals) (12 + (decimals))
+// "2024-01-31T23:59:59.000Z"
+#define MESSAGE_TIME_MAX 24
+
+class TextWriter {
+public:
+  // capacity counts the terminating NUL
+  TextWriter(char* buffer, size_t capacity);
+
+  TextWriter& add(const char* text);
+  TextWriter& add(const char* text, size_t length);
+  TextWriter& add(char c);
+  TextWriter& addInt(long value);
+  TextWriter& addUnsigned(unsigned long value);
+  TextWriter& addNumber(double value, uint8_t decimals = 2);
+  // Seconds since 1970 as "YYYY-MM-DDTHH:MM:SS.000Z"
+  TextWriter& addIsoTime(uint32_t seconds);
+
+  const char* c_str() const { return text; }
+  size_t length() const { return used; }
+  // Something did not fit and was left out
+  bool truncated() const { return overflow; }
+  void clear();
+
+private:
+  TextWriter(const TextWriter&);
+  TextWriter& operator=(const TextWriter&);
+
+  char* text;
+  size_t capacity;
+  size_t used;
+  bool overflow;
+};
+
+template <size_t N>
+class TextBuffer : public TextWriter {
+public:
+  TextBuffer() : TextWriter(storage, N + 1) {}
+
+private:
+  char storage[N + 1];
+};
+
+// One argument to formatMessage()
+struct MessageArg {
+  enum Kind { TEXT, INTEGER, NUMBER, TIME };
+
+  MessageArg(const char* text) : kind(TEXT), wallClock(false) { value.text = text; }
+  MessageArg(int number) : kind(INTEGER), wallClock(false) { value.integer = number; }
+  MessageArg(long number) : kind(INTEGER), wallClock(false) { value.integer = number; }
+  MessageArg(unsigned int number) : kind(INTEGER), wallClock(false) { value.integer = (long)number; }
+  MessageArg(unsigned long number) : kind(INTEGER), wallClock(false) { value.integer = (long)number; }
+  MessageArg(float number) : kind(NUMBER), wallClock(false) { value.number = number; }
+  MessageArg(double number) : kind(NUMBER), wallClock(false) { value.number = number; }
+
+  Kind kind;
+  bool wallClock;
+  union {
+    const char* text;
+    long integer;
+    double number;
+    uint32_t seconds;
+  } value;
+};
+
+// A record's timestamp for %t: ISO time on the wall clock, else millis()
+MessageArg messageTime(uint32_t timestamp, bool wallClock);
+
+void formatMessage(TextWriter& out, const char* format, const MessageArg* args, uint8_t count);
+
+inline void formatMessage(TextWriter& out, const char* format) {
+  formatMessage(out, format, nullptr, 0);
+}
+
+template <typename... Args>
+void formatMessage(TextWriter& out, const char* format, const Args&... args) {
+  const MessageArg list[] = {MessageArg(args)...};
+  formatMessage(out, format, list, (uint8_t)sizeof...(args));
+}
+
+constexpr size_t messageFieldMax(char placeholder) {
+  return placeholder == 'i'   ? MESSAGE_INTEGER_MAX
+         : placeholder == 'f' ? MESSAGE_NUMBER_MAX(2)
+         : placeholder == '1' ? MESSAGE_NUMBER_MAX(1)
+         : placeholder == '4' ? MESSAGE_NUMBER_MAX(4)
+         : placeholder == 't' ? MESSAGE_TIME_MAX
+         : placeholder == 's' ? MESSAGE_TEXT_MAX
+         : placeholder == 'u' ? TELEMETRY_USER_ID_MAX
+                              : 1;
+}
+
+// Longest text format can produce, not counting the NUL
+constexpr size_t messageMax(const char* format) {
+  return *format == 0     ? 0
+         : *format != '%' ? 1 + messageMax(format + 1)
+         : format[1] == 0 ? 1
+                          : messageFieldMax(format[1]) + messageMax(format + 2);
+}
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * RescueNet AI - Sensor trace recorder
+ */
+
+#include "trace_recorder.h"
+
+bool TracingPpg::configure(uint16_t sampleRateHz, uint8_t averaging) {
+  uint32_t now = micros();
+  bool ok = sensor.configure(sampleRateHz, averaging);
+  if (ok) trace.ppgRate(now, sampleRateHz, averaging);
+  return ok;
+}
+
+uint8_t TracingPpg::readFifo(PpgSample* out, uint8_t maxSamples, uint8_t& overflowed) {
+  uint32_t now = micros();
+  uint8_t n = sensor.readFifo(out, maxSamples, overflowed);
+  if (n || overflowed) trace.ppg(now, out, n, overflowed);
+  return n;
+}
+
+bool TracingImu::configure(uint16_t sampleRateHz) {
+  uint32_t now = micros();
+  bool ok = sensor.configure(sampleRateHz);
+  if (ok) trace.imuRate(now, sampleRateHz);
+  return ok;
+}
+
+uint8_t TracingImu::readFifo(ImuSample* out, uint8_t maxSamples, bool& overflowed) {
+  uint32_t now = micros();
+  uint8_t n = sensor.readFifo(out, maxSamples, overflowed);
+  if (n || overflowed) trace.imu(now, out, n, overflowed);
+  return n;
+}
+
+uint8_t TracingTemp::search(TempProbeRom* roms, uint8_t max) {
+  uint32_t now = micros();
+  uint8_t n = bus.search(roms, max);
+  trace.tempRoms(now, roms, n);
+  return n;
+}
+
+bool TracingTemp::readRaw(const TempProbeRom& rom, int16_t& sixteenths) {
+  uint32_t now = micros();
+  bool answered = bus.readRaw(rom, sixteenths);
+  trace.temp(now, rom, answered, sixteenths);
+  return answered;
+}
+
+int TracingSerial::available() {
+  int n = port.available();
+  if (n <= 0) flush();
+  return n;
+}
+
+int TracingSerial::read() {
+  int c = port.read();
+  if (c < 0) return c;
+  if (length == 0) firstAt = micros();
+  chunk[length++] = (uint8_t)c;
+  if (length == sizeof(chunk)) flush();
+  return c;
+}
+
+void TracingSerial::flush() {
+  if (length == 0) return;
+  trace.gps(firstAt, chunk, length);
+  length = 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * RescueNet AI - Sensor trace recorder
+ *
+ * Drivers that pass every call through to the real one and put what it
+ * returned in a TraceWriter (sensor_trace.h). A sketch records a trace
+ * by giving the monitor these in place of its drivers:
+ *
+ *   TraceWriter trace;
+ *   TracingPpg tracedPpg(particleSensor, trace);
+ *   MonitorHal hal = {&tracedPpg, ...};
+ *
+ * and draining the writer to a card or the console. Only calls that
+ * return something are recorded: empty FIFO reads and GPS polls that
+ * found no bytes cost nothing in the trace.
+ */
+
+#ifndef RESCUENET_TRACE_RECORDER_H
+#define RESCUENET_TRACE_RECORDER_H
+
+#include "hal.h"
+#include "sensor_trace.h"
+
+// GPS bytes gathered into one record; a poll that reads more makes several
+#define TRACE_GPS_CHUNK 64
+
+class TracingPpg : public PpgSensor {
+public:
+  TracingPpg(PpgSensor& sensor, TraceWriter& trace) : sensor(sensor), trace(trace) {}
+
+  bool begin() override { return sensor.begin(); }
+  bool configure(uint16_t sampleRateHz, uint8_t averaging) override;
+  uint8_t readFifo(PpgSample* out, uint8_t maxSamples, uint8_t& overflowed) override;
+
+private:
+  PpgSensor& sensor;
+  TraceWriter& trace;
+};
+
+class TracingImu : public ImuSensor {
+public:
+  TracingImu(ImuSensor& sensor, TraceWriter& trace) : sensor(sensor), trace(trace) {}
+
+  bool begin() override { return sensor.begin(); }
+  bool configure(uint16_t sampleRateHz) override;
+  uint8_t readFifo(ImuSample* out, uint8_t maxSamples, bool& overflowed) override;
+
+private:
+  ImuSensor& sensor;
+  TraceWriter& trace;
+};
+
+class TracingTemp : public TempSensor {
+public:
+  TracingTemp(TempSensor& bus, TraceWriter& trace) : bus(bus), trace(trace) {}
+
+  void begin() override { bus.begin(); }
+  uint8_t search(TempProbeRom* roms, uint8_t max) override;
+  bool setResolution(const TempProbeRom& rom, uint8_t bits) override { return bus.setResolution(rom, bits); }
+  bool startConversion() override { return bus.startConversion(); }
+  bool readRaw(const TempProbeRom& rom, int16_t& sixteenths) override;
+
+private:
+  TempSensor& bus;
+  TraceWriter& trace;
+};
+
+// The GPS receiver's UART. Bytes are gathered as they are read and go in
+// a record when the port runs dry, at the time the first was read.
+class TracingSerial : public SerialPort {
+public:
+  TracingSerial(SerialPort& port, TraceWriter& trace) : port(port), trace(trace), length(0), firstAt(0) {}
+
+  int available() override;
+  int read() override;
+  size_t write(const uint8_t* data, size_t count) override { return port.write(data, count); }
+  using SerialPort::write;
+
+private:
+  void flush();
+
+  SerialPort& port;
+  TraceWriter& trace;
+  uint8_t chunk[TRACE_GPS_CHUNK];
+  uint8_t length;
+  uint32_t firstAt;
+};
+
+#endif
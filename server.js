@@ -11,6 +11,7 @@ const twilio = require('twilio');
 const nodemailer = require('nodemailer');
 const EmergencyServices = require('./utils/emergencyServices');
 const HealthAnalytics = require('./utils/healthAnalytics');
+const TelemetryCodec = require('./utils/telemetryCodec');
 const bcrypt = require('bcryptjs');
 const jwt = require('jsonwebtoken');
 const crypto = require('crypto');
@@ -36,6 +37,8 @@ app.use('/api/', limiter);
 // Middleware
 app.use(cors());
 app.use(bodyParser.json({ limit: '10mb' }));
+// Binary telemetry records from the devices, decoded into the JSON shape
+app.use('/api/', express.raw({ type: TelemetryCodec.CONTENT_TYPE, limit: '1kb' }), TelemetryCodec.middleware());
 app.use(express.static('public'));
 
 // MongoDB connection
@@ -589,59 +592,70 @@ app.get('/api/user/:phone', async (req, res) => {
  }
 });
 
-// Health data endpoint with anomaly detection
+// Health data endpoint with anomaly detection; takes one reading or a batch
 app.post('/api/health-data', async (req, res) => {
   try {
-    const healthData = new HealthData(req.body);
-    await healthData.save();
-      // Check for anomalies and trigger emergency if needed
-    const anomalies = detectHealthAnomalies(healthData);
-    if (anomalies.length > 0) {
-      const user = await User.findOne({ phone: healthData.userId });
-      if (user) {
-        const emergency = new Emergency({
-          userId: healthData.userId,
-          reason: `Health anomaly detected: ${anomalies.join(', ')}`,
-          location: healthData.location,
-          vitals: healthData.vitals,
-          autoDetected: true
-        });
-        
-        await emergency.save();
-        
-        // Send emergency notifications (including SMS)
-        await handleEmergencyNotifications(user, emergency);
-        
-        // Send emergency SMS if enabled
-        if (user.emergencyContact) {
-          await EmergencyServices.sendEmergencySMS(
-            user.emergencyContact,
-            emergency,
-            user
-          );
-        }
-        
-        // Broadcast emergency alert
-        broadcast({
-          type: 'emergency',
-          data: emergency
-        });
-      }
+    const samples = Array.isArray(req.body) ? req.body : [req.body];
+    const anomalies = [];
+    for (const sample of samples) {
+      anomalies.push(...await saveHealthSample(sample));
     }
-    
-    // Broadcast real-time data
-    broadcast({
-      type: 'health_data',
-      data: healthData
-    });
-    
-    res.json({ success: true, message: 'Health data saved successfully', anomalies });
+
+    res.json({ success: true, message: 'Health data saved successfully', anomalies, saved: samples.length });
   } catch (error) {
     console.error('Health data error:', error);
     res.status(500).json({ success: false, message: error.message });
   }
 });
 
+// Store one reading, raise an emergency on anomalies and relay it to the dashboard
+async function saveHealthSample(sample) {
+  const healthData = new HealthData(sample);
+  await healthData.save();
+  // Check for anomalies and trigger emergency if needed
+  const anomalies = detectHealthAnomalies(healthData);
+  if (anomalies.length > 0) {
+    const user = await User.findOne({ phone: healthData.userId });
+    if (user) {
+      const emergency = new Emergency({
+        userId: healthData.userId,
+        reason: `Health anomaly detected: ${anomalies.join(', ')}`,
+        location: healthData.location,
+        vitals: healthData.vitals,
+        autoDetected: true
+      });
+      
+      await emergency.save();
+      
+      // Send emergency notifications (including SMS)
+      await handleEmergencyNotifications(user, emergency);
+      
+      // Send emergency SMS if enabled
+      if (user.emergencyContact) {
+        await EmergencyServices.sendEmergencySMS(
+          user.emergencyContact,
+          emergency,
+          user
+        );
+      }
+      
+      // Broadcast emergency alert
+      broadcast({
+        type: 'emergency',
+        data: emergency
+      });
+    }
+  }
+  
+  // Broadcast real-time data
+  broadcast({
+    type: 'health_data',
+    data: healthData
+  });
+  
+  return anomalies;
+}
+
 // Function to detect health anomalies
 function detectHealthAnomalies(healthData) {
   const anomalies = [];
@@ -878,7 +892,7 @@ app.get('/', (req, res) => {
  res.sendFile(path.join(__dirname, 'public', 'index.html'));
 });
 
-app.listen(PORT, () => {
+const server = app.listen(PORT, () => {
   console.log(`🚀 RescueNet AI Server running on port ${PORT}`);
   console.log(`📡 WebSocket server running on port ${WEBSOCKET_PORT}`);
   console.log(`🌐 Dashboard: http://localhost:${PORT}`);
@@ -890,4 +904,9 @@ app.listen(PORT, () => {
     console.log(`   Twilio SMS: ${twilioClient ? '✅ Configured' : '❌ Not configured'}`);
     console.log(`   Email: ${emailTransporter ? '✅ Configured' : '❌ Not configured'}`);
   }
-});
\ No newline at end of file
+});
+
+// Keep device connections open across upload periods (Node's default is 5 s);
+// headersTimeout has to exceed keepAliveTimeout
+server.keepAliveTimeout = 65000;
+server.headersTimeout = 66000;
@@ -0,0 +1,85 @@
+// Dashboard Asset Embedder
+//
+// Gzips the files in codes/web and writes them to codes/web_assets.h as
+// PROGMEM byte arrays with an HttpAsset table (lib/rescuenet/src/
+// http_server.h), so the ESP32 serves them from flash as they are. The
+// ETag is a hash of the compressed bytes, so it changes exactly when the
+// file does. Run after editing anything in codes/web:
+//
+//   node utils/embedAssets.js
+
+const crypto = require('crypto');
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+
+const SOURCE_DIR = path.join(__dirname, '..', 'codes', 'web');
+const OUTPUT = path.join(__dirname, '..', 'codes', 'web_assets.h');
+const BYTES_PER_LINE = 16;
+
+const CONTENT_TYPES = {
+  '.html': 'text/html; charset=utf-8',
+  '.css': 'text/css',
+  '.js': 'application/javascript',
+  '.json': 'application/json',
+  '.svg': 'image/svg+xml',
+  '.ico': 'image/x-icon'
+};
+
+function symbolFor(file) {
+  return 'ASSET_' + file.replace(/[^A-Za-z0-9]/g, '_').toUpperCase();
+}
+
+function byteLines(buffer) {
+  const lines = [];
+  for (let i = 0; i < buffer.length; i += BYTES_PER_LINE) {
+    const row = Array.from(buffer.subarray(i, i + BYTES_PER_LINE), b => '0x' + b.toString(16).padStart(2, '0'));
+    lines.push('  ' + row.join(', ') + ',');
+  }
+  return lines.join('\n');
+}
+
+function embed() {
+  const files = fs.readdirSync(SOURCE_DIR).filter(f => CONTENT_TYPES[path.extname(f)]).sort();
+  const parts = [
+    '/*',
+    ' * RescueNet AI - Dashboard assets',
+    ' *',
+    ' * Generated by utils/embedAssets.js from codes/web; do not edit.',
+    ' */',
+    '',
+    '#ifndef RESCUENET_WEB_ASSETS_H',
+    '#define RESCUENET_WEB_ASSETS_H',
+    '',
+    '#include <http_server.h>',
+    ''
+  ];
+  const table = [];
+
+  for (const file of files) {
+    const raw = fs.readFileSync(path.join(SOURCE_DIR, file));
+    const gzip = zlib.gzipSync(raw, { level: 9 });
+    // The gzip header carries no timestamp, so the output is reproducible
+    gzip.writeUInt32LE(0, 4);
+    const etag = crypto.createHash('sha1').update(gzip).digest('hex').slice(0, 16);
+    const symbol = symbolFor(file);
+    const route = file === 'index.html' ? '/' : '/' + file;
+
+    parts.push(`// ${file}: ${raw.length} bytes, ${gzip.length} gzipped`);
+    parts.push(`static const uint8_t ${symbol}[] PROGMEM = {`);
+    parts.push(byteLines(gzip));
+    parts.push('};', '');
+    table.push(`  {"${route}", "${CONTENT_TYPES[path.extname(file)]}", ${symbol}, sizeof(${symbol}), "\\"${etag}\\"", true},`);
+  }
+
+  parts.push('static const HttpAsset WEB_ASSETS[] = {');
+  parts.push(...table);
+  parts.push('};');
+  parts.push('#define WEB_ASSET_COUNT (sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0]))');
+  parts.push('', '#endif', '');
+
+  fs.writeFileSync(OUTPUT, parts.join('\n'));
+  console.log(`Wrote ${files.length} asset(s) to ${path.relative(process.cwd(), OUTPUT)}`);
+}
+
+embed();
@@ -0,0 +1,168 @@
+// Binary Telemetry Record Decoder
+//
+// Reference decoder for the fixed-layout records the devices post with
+// Content-Type application/vnd.rescuenet.telemetry. The layout (version 1)
+// is documented in lib/rescuenet/src/telemetry.h; all fields are
+// little-endian scaled integers and the record ends in a CRC-16/CCITT.
+
+const CONTENT_TYPE = 'application/vnd.rescuenet.telemetry';
+const VERSION = 1;
+const HEALTH_SIZE = 56;
+const REASON_MAX = 64;
+const BATTERY_UNKNOWN = 0xff;
+
+const KIND = { HEALTH: 1, EMERGENCY: 2 };
+
+const FLAGS = {
+  FALL: 0x01,
+  EMERGENCY: 0x02,
+  LOCATION: 0x04,
+  WALL_CLOCK: 0x08
+};
+
+class TelemetryCodec {
+
+  static crc16(buffer, length) {
+    let crc = 0xffff;
+    for (let i = 0; i < length; i++) {
+      crc ^= buffer[i] << 8;
+      for (let bit = 0; bit < 8; bit++) {
+        crc = crc & 0x8000 ? ((crc << 1) ^ 0x1021) & 0xffff : (crc << 1) & 0xffff;
+      }
+    }
+    return crc;
+  }
+
+  // Decode one record; throws on a malformed, corrupted or unknown record
+  static decode(buffer) {
+    if (!Buffer.isBuffer(buffer) || buffer.length < HEALTH_SIZE) {
+      throw new Error('Telemetry record too short');
+    }
+    if (buffer[0] !== 0x52 || buffer[1] !== 0x4e) {
+      throw new Error('Not a telemetry record');
+    }
+    if (buffer[2] !== VERSION) {
+      throw new Error(`Unsupported telemetry version ${buffer[2]}`);
+    }
+
+    const kind = buffer[3];
+    let reasonLength = 0;
+    if (kind === KIND.EMERGENCY) {
+      reasonLength = buffer[54];
+      if (reasonLength > REASON_MAX || buffer.length !== HEALTH_SIZE + 1 + reasonLength) {
+        throw new Error('Bad emergency record length');
+      }
+    } else if (kind !== KIND.HEALTH || buffer.length !== HEALTH_SIZE) {
+      throw new Error('Bad telemetry record kind or length');
+    }
+
+    const end = buffer.length - 2;
+    if (buffer.readUInt16LE(end) !== this.crc16(buffer, end)) {
+      throw new Error('Telemetry record CRC mismatch');
+    }
+
+    const flags = buffer[6];
+    const userIdEnd = buffer.indexOf(0, 12);
+    const record = {
+      kind: kind === KIND.EMERGENCY ? 'emergency' : 'health',
+      sequence: buffer.readUInt16LE(4),
+      flags,
+      fallDetected: !!(flags & FLAGS.FALL),
+      emergencyActive: !!(flags & FLAGS.EMERGENCY),
+      batteryLevel: buffer[7] === BATTERY_UNKNOWN ? null : buffer[7],
+      wallClock: !!(flags & FLAGS.WALL_CLOCK),
+      timestamp: buffer.readUInt32LE(8),
+      userId: buffer.toString('ascii', 12, userIdEnd >= 12 && userIdEnd < 28 ? userIdEnd : 28),
+      heartRate: buffer.readUInt16LE(28) / 10,
+      spO2: buffer.readUInt16LE(30) / 10,
+      temperature: buffer.readInt16LE(32) / 100,
+      bloodPressureSys: buffer.readUInt16LE(34),
+      bloodPressureDia: buffer.readUInt16LE(36),
+      location: null,
+      accelerometer: {
+        x: buffer.readInt16LE(48) / 100,
+        y: buffer.readInt16LE(50) / 100,
+        z: buffer.readInt16LE(52) / 100
+      },
+      reason: kind === KIND.EMERGENCY ? buffer.toString('utf8', 55, 55 + reasonLength) : null
+    };
+    if (flags & FLAGS.LOCATION) {
+      record.location = {
+        lat: buffer.readInt32LE(38) / 1e7,
+        lng: buffer.readInt32LE(42) / 1e7,
+        altitude: buffer.readInt16LE(46)
+      };
+    }
+    return record;
+  }
+
+  // Split a body of back to back records (an upload batch) and decode each
+  static decodeAll(buffer) {
+    const records = [];
+    let offset = 0;
+    while (offset < buffer.length) {
+      if (buffer.length - offset < HEALTH_SIZE) {
+        throw new Error('Telemetry record too short');
+      }
+      const size = buffer[offset + 3] === KIND.EMERGENCY
+        ? HEALTH_SIZE + 1 + buffer[offset + 54]
+        : HEALTH_SIZE;
+      records.push(this.decode(buffer.subarray(offset, offset + size)));
+      offset += size;
+    }
+    return records;
+  }
+
+  // The JSON body the same device would have posted, so the existing
+  // /api/health-data and /api/emergency handlers take either
+  static toPayload(record) {
+    const payload = {
+      userId: record.userId,
+      // Wall clock seconds are local time, formatted like the firmware does
+      timestamp: record.wallClock
+        ? new Date(record.timestamp * 1000).toISOString()
+        : String(record.timestamp),
+      vitals: {
+        heartRate: record.heartRate,
+        temperature: record.temperature,
+        spO2: record.spO2,
+        bloodPressure: record.bloodPressureSys
+      },
+      sequence: record.sequence
+    };
+    if (record.location) {
+      payload.location = { lat: record.location.lat, lng: record.location.lng };
+    }
+    if (record.kind === 'emergency') {
+      payload.reason = record.reason;
+    } else {
+      payload.accelerometer = record.accelerometer;
+      payload.fallDetected = record.fallDetected;
+      if (record.batteryLevel !== null) payload.batteryLevel = record.batteryLevel;
+    }
+    return payload;
+  }
+
+  // Express middleware: replaces a raw binary body with the decoded payload,
+  // or an array of them for a batch of several records
+  static middleware() {
+    return (req, res, next) => {
+      if (!Buffer.isBuffer(req.body) || !req.is(CONTENT_TYPE)) {
+        return next();
+      }
+      try {
+        const payloads = this.decodeAll(req.body).map(record => this.toPayload(record));
+        req.body = payloads.length === 1 ? payloads[0] : payloads;
+        next();
+      } catch (error) {
+        res.status(400).json({ success: false, message: error.message });
+      }
+    };
+  }
+}
+
+TelemetryCodec.CONTENT_TYPE = CONTENT_TYPE;
+TelemetryCodec.KIND = KIND;
+TelemetryCodec.FLAGS = FLAGS;
+
+module.exports = TelemetryCodec;